@@ -15,10 +15,12 @@
 #include <mop/core/light.h>
 #include <mop/core/material.h>
 #include <mop/core/material_graph.h>
+#include <mop/core/mesh_optimize.h>
 #include <mop/core/meshlet.h>
 #include <mop/core/overlay.h>
 #include <mop/core/pipeline.h>
 #include <mop/core/scene.h>
+#include <mop/core/simplify.h>
 #include <mop/core/text.h>
 #include <mop/core/texture_pipeline.h>
 #include <mop/core/theme.h>
@@ -11,6 +11,10 @@
  * shader source which is then compiled to SPIR-V and registered as a
  * shader plugin.
  *
+ * Attached to a mesh, the graph is also lowered to a per-pixel program
+ * the CPU backend evaluates while shading, so surfaces can vary with UVs,
+ * vertex colors, view angle and texture samples.
+ *
  * Built-in material types (metallic-roughness, specular-glossiness,
  * unlit) are provided as pre-built graphs.
  *
@@ -174,6 +178,16 @@ bool mop_mat_graph_from_json(MopMaterialGraph *graph, const char *json);
 bool mop_mat_graph_compile(MopMaterialGraph *graph, MopViewport *viewport,
                            MopMaterial *out_material);
 
+/* Attach a graph to a mesh.  The flat result of mop_mat_graph_compile
+ * becomes the mesh material; on the CPU backend the graph is additionally
+ * lowered to a per-pixel program (constant-folded, dead nodes removed)
+ * that supplies base color, metallic, roughness and emissive for every
+ * pixel of smooth-shaded draws.  Graphs over the program limits keep the
+ * flat material only, with a warning.  graph = NULL detaches the program
+ * and leaves the material as is.  Returns false if compilation fails;
+ * the mesh is then unchanged.  mop_mesh_set_material detaches too. */
+bool mop_mesh_set_material_graph(MopMesh *mesh, MopMaterialGraph *graph);
+
 /* Free any allocated resources in the graph (compiled GLSL, etc.) */
 void mop_mat_graph_destroy(MopMaterialGraph *graph);
 
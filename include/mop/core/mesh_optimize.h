@@ -0,0 +1,122 @@
+/*
+ * Master of Puppets — Backend-Agnostic Viewport Rendering Engine
+ * mesh_optimize.h — Index and vertex reordering for cache, overdraw, fetch
+ *
+ * Three independent passes over an indexed triangle list, none of which
+ * change the rendered image:
+ *
+ *   vertex cache  — Tipsify triangle order so consecutive triangles share
+ *                   vertices (fewer vertex-shader invocations on GPUs)
+ *   overdraw      — splits the cache-ordered list into clusters and sorts
+ *                   them outward-facing first, so the depth test rejects
+ *                   more hidden pixels before they are shaded
+ *   vertex fetch  — renumbers vertices in first-use order so vertex reads
+ *                   stream through memory; drops unreferenced vertices
+ *
+ * The index functions work on any index buffer; mop_mesh_optimize runs
+ * the selected passes over a whole mesh, and MopMeshDesc.optimize applies
+ * it at mop_viewport_add_mesh time.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef MOP_CORE_MESH_OPTIMIZE_H
+#define MOP_CORE_MESH_OPTIMIZE_H
+
+#include <mop/core/vertex_format.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Post-transform cache size the cache passes and statistics model */
+#define MOP_VERTEX_CACHE_SIZE 16
+
+/* -------------------------------------------------------------------------
+ * Passes (bit flags for mop_mesh_optimize / MopMeshDesc.optimize)
+ * ------------------------------------------------------------------------- */
+
+typedef enum MopMeshOptFlags {
+  MOP_MESH_OPT_NONE = 0,
+  MOP_MESH_OPT_VERTEX_CACHE = 1 << 0,
+  MOP_MESH_OPT_OVERDRAW = 1 << 1, /* implies VERTEX_CACHE */
+  MOP_MESH_OPT_VERTEX_FETCH = 1 << 2,
+  MOP_MESH_OPT_ALL = 0x7,
+} MopMeshOptFlags;
+
+/* -------------------------------------------------------------------------
+ * Statistics
+ * ------------------------------------------------------------------------- */
+
+typedef struct MopMeshStats {
+  float acmr;      /* cache misses per triangle (0.5 best, 3 worst) */
+  float atvr;      /* cache misses per referenced vertex (1 = ideal) */
+  float overdraw;  /* shaded / covered pixels over 6 axis views (>= 1) */
+  float overfetch; /* vertex bytes fetched / bytes referenced (>= 1) */
+} MopMeshStats;
+
+typedef struct MopMeshOptStats {
+  MopMeshStats before;
+  MopMeshStats after;
+  uint32_t vertices_removed; /* unreferenced vertices dropped by FETCH */
+} MopMeshOptStats;
+
+/* -------------------------------------------------------------------------
+ * Index buffer passes
+ *
+ * dst may alias indices.  positions points at the first vertex's float3
+ * position; position_stride is the byte distance between vertices.
+ * Indices >= vertex_count are rejected: the reorders copy the input
+ * unchanged and vertex_fetch returns 0.
+ * ------------------------------------------------------------------------- */
+
+/* Reorder triangles for post-transform cache reuse (Tipsify). */
+void mop_optimize_vertex_cache(uint32_t *dst, const uint32_t *indices,
+                               uint32_t index_count, uint32_t vertex_count);
+
+/* Reorder cache-optimized triangles to reduce overdraw.  threshold is the
+ * cache-miss ratio the reorder may cost relative to the input, e.g. 1.05
+ * allows 5% more misses in exchange for finer clusters. */
+void mop_optimize_overdraw(uint32_t *dst, const uint32_t *indices,
+                           uint32_t index_count, const float *positions,
+                           uint32_t vertex_count, size_t position_stride,
+                           float threshold);
+
+/* Renumber vertices in first-use order.  Rewrites indices in place,
+ * writes the reordered vertices to dst (must not alias vertices) and
+ * returns the number written — referenced vertices only. */
+uint32_t mop_optimize_vertex_fetch(void *dst, uint32_t *indices,
+                                   uint32_t index_count, const void *vertices,
+                                   uint32_t vertex_count, size_t vertex_size);
+
+/* -------------------------------------------------------------------------
+ * Whole-mesh helpers
+ *
+ * format NULL = standard MopVertex layout, as in MopMeshDesc.
+ * ------------------------------------------------------------------------- */
+
+/* Measure cache, overdraw and fetch efficiency of an index order.
+ * Returns false (and zeroes out) on invalid input. */
+bool mop_mesh_analyze(const void *vertices, uint32_t vertex_count,
+                      const MopVertexFormat *format, const uint32_t *indices,
+                      uint32_t index_count, MopMeshStats *out);
+
+/* Run the passes selected by flags (MopMeshOptFlags) in place.  Returns
+ * the new vertex count (smaller only with VERTEX_FETCH), or 0 on invalid
+ * input, leaving the data untouched.  stats is optional.
+ *
+ * VERTEX_FETCH renumbers vertices: per-vertex data attached to the mesh
+ * afterwards (bone weights, morph targets) must use the new order. */
+uint32_t mop_mesh_optimize(void *vertices, uint32_t vertex_count,
+                           const MopVertexFormat *format, uint32_t *indices,
+                           uint32_t index_count, uint32_t flags,
+                           MopMeshOptStats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MOP_CORE_MESH_OPTIMIZE_H */
@@ -11,8 +11,12 @@
  *   - A compact list of local triangle indices (3 uint8 per triangle)
  *   - A bounding sphere and normal cone for GPU culling
  *
- * The meshlet generation algorithm greedily builds clusters that maximize
- * spatial locality, then computes per-meshlet culling bounds.
+ * Triangles are ordered along a Morton curve and split into spatial
+ * partitions that are clustered independently (in parallel when a worker
+ * pool is available).  Within a partition, meshlets grow across shared
+ * vertices, preferring triangles close to the cluster center and aligned
+ * with its normal, which keeps culling bounds tight.  The result does not
+ * depend on the number of threads.
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -28,6 +32,8 @@
 extern "C" {
 #endif
 
+typedef struct MopViewport MopViewport;
+
 /* -------------------------------------------------------------------------
  * Meshlet limits (matching VK_EXT_mesh_shader recommendations)
  * ------------------------------------------------------------------------- */
@@ -101,6 +107,13 @@ bool mop_meshlet_build(const MopVertex *vertices, uint32_t vertex_count,
                        const uint32_t *indices, uint32_t index_count,
                        MopMeshletData *out);
 
+/* As mop_meshlet_build, spreading partitions over the viewport's worker
+ * pool.  viewport NULL builds on the calling thread; the output is the
+ * same either way. */
+bool mop_meshlet_build_ex(MopViewport *viewport, const MopVertex *vertices,
+                          uint32_t vertex_count, const uint32_t *indices,
+                          uint32_t index_count, MopMeshletData *out);
+
 /* Free all memory allocated by mop_meshlet_build. */
 void mop_meshlet_free(MopMeshletData *data);
 
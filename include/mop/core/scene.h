@@ -9,6 +9,7 @@
 #define MOP_CORE_SCENE_H
 
 #include <mop/core/display.h>
+#include <mop/core/mesh_optimize.h>
 #include <mop/core/vertex_format.h>
 #include <mop/types.h>
 
@@ -33,6 +34,8 @@ typedef struct MopMesh MopMesh;
  * indices      : array of uint32_t triangle indices, owned by application
  * index_count  : number of indices (must be a multiple of 3)
  * object_id    : unique identifier for picking (0 = no object)
+ * optimize     : MopMeshOptFlags passes run on the engine's copy (see
+ *                mop/core/mesh_optimize.h), 0 = keep the given order
  *
  * The engine copies vertex and index data during mop_viewport_add_mesh.
  * The application may free its arrays after the call returns.
@@ -51,6 +54,12 @@ typedef struct MopMeshDesc {
    * the old `MopMeshDescEx` path. Lets hosts pass custom attribute sets
    * through the primary API without switching descriptors. */
   const MopVertexFormat *vertex_format;
+
+  /* Opt-in reordering at creation.  With MOP_MESH_OPT_VERTEX_FETCH the
+   * mesh's vertex order differs from `vertices`; attach per-vertex data
+   * (bone weights, morph targets) in the optimized order, or leave that
+   * pass out. */
+  uint32_t optimize;
 } MopMeshDesc;
 
 /* -------------------------------------------------------------------------
@@ -72,6 +81,10 @@ typedef struct MopMeshDesc {
  * when the owning viewport is destroyed. */
 MopMesh *mop_viewport_add_mesh(MopViewport *viewport, const MopMeshDesc *desc);
 
+/* Statistics of the optimize passes run at creation.  Returns false if
+ * the mesh was created without MopMeshDesc.optimize. */
+bool mop_mesh_get_optimize_stats(const MopMesh *mesh, MopMeshOptStats *out);
+
 /* -------------------------------------------------------------------------
  * Extended mesh descriptor — flexible vertex format
  *
@@ -280,11 +293,63 @@ void mop_viewport_remove_instanced_mesh(MopViewport *viewport,
 int32_t mop_mesh_add_lod(MopMesh *mesh, MopViewport *viewport,
                          const MopMeshDesc *desc, float screen_threshold);
 
+/* Generate up to `levels` LOD levels by simplifying the base mesh (see
+ * mop/core/simplify.h).  Level i targets ratio^i of the base triangle
+ * count, 0 < ratio < 1.  Screen thresholds are derived from each level's
+ * simplification error so a level is used only while that error stays
+ * under about one pixel.  Levels run in parallel on the viewport's
+ * worker pool.  Replaces any existing LOD levels; levels that fail to
+ * reduce the mesh further are skipped.  Returns the number of levels
+ * added, or -1 on failure.  Standard MopVertex meshes only. */
+int32_t mop_mesh_generate_lods(MopMesh *mesh, uint32_t levels, float ratio);
+
 /* Set the global LOD bias for a viewport.
  * Positive values shift towards lower detail; negative towards higher. */
 void mop_viewport_set_lod_bias(MopViewport *viewport, float bias);
 float mop_viewport_get_lod_bias(const MopViewport *viewport);
 
+/* Set the LOD hysteresis band, relative to each screen threshold
+ * (default 0.1, clamped to [0, 0.5]).  A mesh coarsens only once its
+ * projected diameter drops below threshold * (1 - band) and refines only
+ * once it grows past threshold * (1 + band), so meshes hovering at a
+ * threshold stop flipping levels every frame. */
+void mop_viewport_set_lod_hysteresis(MopViewport *viewport, float band);
+float mop_viewport_get_lod_hysteresis(const MopViewport *viewport);
+
+/* Cross-fade LOD switches over `frames` frames (default 0 = switch
+ * instantly, max 64).  During a fade the outgoing and incoming levels are
+ * both drawn with complementary screen-door dither patterns.  CPU backend
+ * only; other backends switch instantly. */
+void mop_viewport_set_lod_fade_frames(MopViewport *viewport, uint32_t frames);
+uint32_t mop_viewport_get_lod_fade_frames(const MopViewport *viewport);
+
+/* -------------------------------------------------------------------------
+ * Meshlet culling
+ *
+ * mop_mesh_build_meshlets splits the base mesh into meshlets (see
+ * mop/core/meshlet.h).  The CPU backend then culls whole meshlets against
+ * the view frustum, their normal cones and a coarse depth pyramid before
+ * transforming any vertex, so a large mesh that is partly off-screen,
+ * mostly facing away or hidden behind nearer geometry pays only for its
+ * visible clusters.  The rendered image is unchanged.
+ *
+ * Meshlets are dropped by mop_mesh_update_geometry (build them again
+ * afterwards) and ignored while the mesh is skinned or morphed, or drawn
+ * at a LOD level other than 0.  Culling results are reported in
+ * MopFrameStats.
+ * ------------------------------------------------------------------------- */
+
+/* Build (or rebuild) the mesh's meshlets.  Returns the meshlet count, or
+ * 0 on failure.  Standard MopVertex meshes only. */
+uint32_t mop_mesh_build_meshlets(MopMesh *mesh);
+
+/* Number of meshlets built for the mesh (0 = none) */
+uint32_t mop_mesh_get_meshlet_count(const MopMesh *mesh);
+
+/* Enable or disable meshlet culling for the viewport (default on). */
+void mop_viewport_set_meshlet_culling(MopViewport *viewport, bool enabled);
+bool mop_viewport_get_meshlet_culling(const MopViewport *viewport);
+
 /* Set debug visualization mode for the viewport. */
 void mop_viewport_set_debug_viz(MopViewport *viewport, MopDebugViz mode);
 MopDebugViz mop_viewport_get_debug_viz(const MopViewport *viewport);
@@ -0,0 +1,64 @@
+/*
+ * Master of Puppets — Backend-Agnostic Viewport Rendering Engine
+ * simplify.h — Quadric error metric mesh simplification
+ *
+ * Edge-collapse simplifier in the style of Garland & Heckbert: every
+ * vertex carries an area-weighted quadric of the planes around it, and
+ * the cheapest collapses are applied until the triangle budget or the
+ * error budget is reached.  Collapses are half-edge collapses — a vertex
+ * moves onto one of its neighbours — so the output indexes the input
+ * vertex array and no new vertices (or attributes) are invented.
+ *
+ * Attribute seams (vertices that share a position but differ in normal,
+ * UV or color) are always locked, so textures never tear.  Open borders
+ * may be locked too, or slide along themselves.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef MOP_CORE_SIMPLIFY_H
+#define MOP_CORE_SIMPLIFY_H
+
+#include <mop/types.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* -------------------------------------------------------------------------
+ * Simplification parameters
+ * ------------------------------------------------------------------------- */
+
+typedef struct MopSimplifyDesc {
+  uint32_t target_index_count; /* stop at or below this many indices */
+  float target_error;     /* max error, fraction of mesh extent (0 = none) */
+  float attribute_weight; /* weight of normal/UV/color change in the cost */
+  bool lock_border;       /* keep open-boundary vertices in place */
+} MopSimplifyDesc;
+
+/* -------------------------------------------------------------------------
+ * API
+ * ------------------------------------------------------------------------- */
+
+/* Simplify an indexed triangle mesh.
+ *
+ * Writes the simplified index buffer to out_indices, which must hold
+ * index_count entries, and returns the number of indices written.  The
+ * output references the input vertex array.  out_error (optional)
+ * receives the largest geometric error introduced, as a fraction of the
+ * mesh's largest bounding-box extent.
+ *
+ * Stops when target_index_count is reached, when the next collapse would
+ * exceed target_error, or when no valid collapse remains. */
+uint32_t mop_mesh_simplify(const MopVertex *vertices, uint32_t vertex_count,
+                           const uint32_t *indices, uint32_t index_count,
+                           const MopSimplifyDesc *desc, uint32_t *out_indices,
+                           float *out_error);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MOP_CORE_SIMPLIFY_H */
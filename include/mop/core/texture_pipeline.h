@@ -56,6 +56,23 @@ typedef struct MopTextureDesc {
   bool srgb;           /* interpret as sRGB (true for albedo/emissive) */
 } MopTextureDesc;
 
+/* -------------------------------------------------------------------------
+ * Mip chain generation
+ * ------------------------------------------------------------------------- */
+
+typedef enum MopMipFilter {
+  MOP_MIP_FILTER_BOX = 0, /* 2x2 average — fastest, softest */
+  MOP_MIP_FILTER_KAISER,  /* Kaiser-windowed sinc, radius 3, alpha 4 */
+  MOP_MIP_FILTER_LANCZOS, /* Lanczos-3 — sharpest, may ring slightly */
+} MopMipFilter;
+
+typedef struct MopMipDesc {
+  MopMipFilter filter;
+  bool srgb;          /* RGB is sRGB-encoded: filter in linear space */
+  bool normal_map;    /* RGB is a [-1,1] vector: renormalize every texel */
+  float alpha_cutoff; /* > 0: preserve alpha-test coverage at this cutoff */
+} MopMipDesc;
+
 /* -------------------------------------------------------------------------
  * Streaming state
  * ------------------------------------------------------------------------- */
@@ -117,6 +134,24 @@ void mop_tex_cache_flush(MopViewport *viewport, uint32_t max_age_frames);
 bool mop_tex_read_rgba8(MopViewport *viewport, MopTexture *texture,
                         uint8_t *out_buf, size_t buf_size);
 
+/* Build a full RGBA8 mip chain from `rgba_data` (mip 0).  Returns a
+ * malloc'd buffer holding every level packed back to back, mip 0 first
+ * (free with free()).  *out_total_size receives its size in bytes and
+ * *out_levels the level count including mip 0.  Returns NULL on invalid
+ * arguments or OOM.
+ *
+ * Rows of each level are filtered in parallel on `viewport`'s worker
+ * pool; pass NULL to run on the calling thread.  A NULL `desc` means
+ * box filtering with no color-space conversion. */
+uint8_t *mop_tex_generate_mips_ex(MopViewport *viewport,
+                                  const uint8_t *rgba_data, int width,
+                                  int height, const MopMipDesc *desc,
+                                  size_t *out_total_size, int *out_levels);
+
+/* Shorthand for mop_tex_generate_mips_ex(NULL, ..., NULL, ...). */
+uint8_t *mop_tex_generate_mips(const uint8_t *rgba_data, int width, int height,
+                               size_t *out_total_size, int *out_levels);
+
 #ifdef __cplusplus
 }
 #endif
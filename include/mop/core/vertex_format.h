@@ -7,6 +7,10 @@
  * bone weights, tangent frames, custom float channels) without
  * changing the fixed MopVertex struct used by existing code.
  *
+ * Compact formats (16-bit normalized, octahedral, half float, RGBA8) let
+ * meshes stay quantized in memory; the CPU backend decodes them as it
+ * transforms, so an 18-byte vertex never expands to a 48-byte MopVertex.
+ *
  * SPDX-License-Identifier: Apache-2.0
  */
 
@@ -49,6 +53,13 @@ typedef enum MopAttribFormat {
   MOP_FORMAT_FLOAT3 = 2, /* 12 bytes (3 floats) */
   MOP_FORMAT_FLOAT4 = 3, /* 16 bytes (4 floats) */
   MOP_FORMAT_UBYTE4 = 4, /*  4 bytes (packed)   */
+
+  /* Compact formats, decoded to floats on read */
+  MOP_FORMAT_UNORM16X2 = 5, /*  4 bytes (2x uint16 / 65535)      */
+  MOP_FORMAT_UNORM16X3 = 6, /*  6 bytes (3x uint16 / 65535)      */
+  MOP_FORMAT_OCT16 = 7,     /*  4 bytes (octahedral unit vector) */
+  MOP_FORMAT_HALF2 = 8,     /*  4 bytes (2x half float)          */
+  MOP_FORMAT_UNORM8X4 = 9,  /*  4 bytes (4x uint8 / 255)         */
 } MopAttribFormat;
 
 /* -------------------------------------------------------------------------
@@ -71,6 +82,13 @@ typedef struct MopVertexFormat {
   MopVertexAttrib attribs[MOP_MAX_VERTEX_ATTRIBS];
   uint32_t attrib_count;
   uint32_t stride; /* bytes per vertex */
+
+  /* Dequantization of UNORM16X3 positions to object space:
+   * p = pos_offset + q * pos_scale, q in [0, 1] per axis (a diagonal
+   * matrix plus translation, typically the mesh bounding box).  Ignored
+   * for float positions. */
+  float pos_scale[3];
+  float pos_offset[3];
 } MopVertexFormat;
 
 /* -------------------------------------------------------------------------
@@ -92,6 +110,13 @@ MopVertexFormat mop_vertex_format_pos_normal(void);
  * Stride = 32 bytes. Common for untextured-color-free meshes. */
 MopVertexFormat mop_vertex_format_pos_normal_uv(void);
 
+/* Preset matching MopQuantizedVertex in .mop v2 files (18 bytes):
+ *   POSITION (unorm16x3) + NORMAL (oct16) + COLOR (unorm8x4) +
+ *   TEXCOORD0 (unorm16x2)
+ * Positions dequantize to the box [bbox_min, bbox_max]. */
+MopVertexFormat mop_vertex_format_quantized(MopVec3 bbox_min,
+                                            MopVec3 bbox_max);
+
 /* Find an attribute by semantic.  Returns NULL if not present. */
 const MopVertexAttrib *mop_vertex_format_find(const MopVertexFormat *fmt,
                                               MopAttribSemantic sem);
@@ -99,6 +124,13 @@ const MopVertexAttrib *mop_vertex_format_find(const MopVertexFormat *fmt,
 /* Return the byte size of a given attribute format. */
 uint32_t mop_attrib_format_size(MopAttribFormat fmt);
 
+/* Decode one attribute of the vertex at `vertex` to floats.  Components
+ * the format lacks read as (0, 0, 0, 1); UNORM16X3 positions are
+ * dequantized with the format's pos_scale/pos_offset. */
+void mop_vertex_attrib_read(const MopVertexFormat *fmt,
+                            const MopVertexAttrib *attr, const void *vertex,
+                            float out[4]);
+
 #ifdef __cplusplus
 }
 #endif
@@ -56,7 +56,8 @@ void mop_mesh_extrude_faces(MopMesh *mesh, MopViewport *vp,
                             const uint32_t *face_indices, uint32_t count,
                             float distance);
 
-/* Inset faces — shrink each face by `inset` and create surrounding quads. */
+/* Inset faces — shrink each face by `inset` and create surrounding quads.
+ * A face listed more than once is inset once. */
 void mop_mesh_inset_faces(MopMesh *mesh, MopViewport *vp,
                           const uint32_t *face_indices, uint32_t count,
                           float inset);
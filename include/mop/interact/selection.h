@@ -50,6 +50,39 @@ void mop_viewport_deselect_object(MopViewport *vp, uint32_t id);
 bool mop_viewport_is_object_selected(const MopViewport *vp, uint32_t id);
 uint32_t mop_viewport_get_selected_count(const MopViewport *vp);
 
+/* Region (rectangle / lasso) selection */
+typedef enum MopSelectOp {
+  MOP_SELECT_REPLACE = 0,  /* selection becomes what the region hits */
+  MOP_SELECT_ADD = 1,      /* union */
+  MOP_SELECT_SUBTRACT = 2, /* difference */
+} MopSelectOp;
+
+typedef struct MopSelectRegion {
+  /* Viewport pixel coordinates as x, y pairs.  Two points are opposite
+   * corners of a rectangle; three or more are a lasso polygon, closed
+   * implicitly and filled even-odd. */
+  const float *points;
+  uint32_t point_count;
+  MopSelectOp op;
+  bool through; /* also select what is hidden behind other geometry */
+} MopSelectRegion;
+
+/* Select the objects inside the region.  Visible objects are read from the
+ * last rendered frame's object-id buffer; with `through`, meshes with a
+ * vertex projecting into the region are added.  Returns the number of
+ * objects the region hit. */
+uint32_t mop_viewport_select_region(MopViewport *vp,
+                                    const MopSelectRegion *region);
+
+/* Select the elements of a mesh inside the region, per its edit mode:
+ * vertices projecting into it, edges with both ends in it, faces whose
+ * centroid is in it.  Unless `through`, only elements not hidden by the
+ * last rendered frame count.  Makes the mesh the edited one, starting a
+ * fresh element selection if it was not.  Returns the number of elements
+ * the region hit, 0 when the mesh is not in edit mode. */
+uint32_t mop_mesh_select_region(MopMesh *mesh, MopViewport *vp,
+                                const MopSelectRegion *region);
+
 #ifdef __cplusplus
 }
 #endif
@@ -1,12 +1,15 @@
 /*
  * Master of Puppets — Backend-Agnostic Viewport Rendering Engine
- * undo.h — Undo/redo for TRS transform operations
+ * undo.h — Undo/redo for transforms, materials and mesh edits
  *
  * The undo system records mesh TRS snapshots before gizmo manipulations.
  * Calling undo restores the previous state; redo re-applies it.
  *
- * The history is a fixed-size ring buffer of 256 entries.  Older entries
- * are silently discarded when the buffer wraps.
+ * Mesh edit operations (mesh_edit.h) record themselves: each pushes one
+ * entry holding only the vertex and face ranges it changed.
+ *
+ * The history is bounded by bytes rather than entries (64 MiB by
+ * default).  The oldest entries are silently discarded past the budget.
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -42,6 +45,13 @@ void mop_viewport_undo(MopViewport *viewport);
 /* Redo the most recently undone change.  No-op if nothing to redo. */
 void mop_viewport_redo(MopViewport *viewport);
 
+/* Cap the memory held by undo and redo history, discarding the oldest
+ * entries now if it is over.  0 disables undo. */
+void mop_viewport_set_undo_budget(MopViewport *viewport, size_t bytes);
+
+/* Bytes currently held by undo and redo history. */
+size_t mop_viewport_get_undo_usage(MopViewport *viewport);
+
 #ifdef __cplusplus
 }
 #endif
@@ -3,7 +3,7 @@
  * mop_scene.h — .mop v2 scene file format
  *
  * Multi-mesh scene format with camera, lights, materials, and transforms.
- * Supports quantized vertices (20 bytes vs 48 bytes) and mmap loading.
+ * Supports quantized vertices (18 bytes vs 48 bytes) and mmap loading.
  *
  * File layout (all sections 8-byte aligned for mmap):
  *   [0..63]      Scene header (magic, version, section_count, flags)
@@ -46,10 +46,10 @@ typedef enum MopSectionType {
  * ------------------------------------------------------------------------- */
 
 #define MOP_VTX_RAW 0x00       /* 48-byte MopVertex as-is */
-#define MOP_VTX_QUANTIZED 0x01 /* 20-byte quantized vertex */
+#define MOP_VTX_QUANTIZED 0x01 /* 18-byte quantized vertex */
 
 /* -------------------------------------------------------------------------
- * Quantized vertex: 20 bytes vs 48 bytes (2.4x smaller)
+ * Quantized vertex: 18 bytes vs 48 bytes (2.7x smaller)
  *
  *   position: 3x uint16 relative to mesh bbox (0.01mm precision at 650m)
  *   normal:   2x int16 octahedral encoding (14-bit precision)
@@ -62,7 +62,7 @@ typedef struct MopQuantizedVertex {
   int16_t nrm[2];     /* octahedral normal encoding */
   uint8_t color[4];   /* RGBA8 */
   uint16_t uv[2];     /* quantized UV */
-} MopQuantizedVertex; /* exactly 20 bytes */
+} MopQuantizedVertex; /* exactly 18 bytes */
 
 /* -------------------------------------------------------------------------
  * Opaque scene file handle
@@ -72,6 +72,7 @@ typedef struct MopSceneFile MopSceneFile;
 
 /* Forward declarations */
 typedef struct MopViewport MopViewport;
+typedef struct MopMesh MopMesh;
 typedef struct MopLoadedMesh MopLoadedMesh;
 
 /* -------------------------------------------------------------------------
@@ -102,6 +103,13 @@ uint32_t mop_scene_mesh_count(const MopSceneFile *s);
 bool mop_scene_get_mesh(const MopSceneFile *s, uint32_t idx,
                         MopLoadedMesh *out);
 
+/* Add mesh idx to a viewport.  Quantized meshes are uploaded as they are
+ * stored (mop_vertex_format_quantized over the mesh bounding box) instead
+ * of being expanded to MopVertex; raw meshes go through
+ * mop_viewport_add_mesh.  Returns NULL on failure. */
+MopMesh *mop_scene_add_mesh(const MopSceneFile *s, uint32_t idx,
+                            MopViewport *vp, uint32_t object_id);
+
 /* Get camera parameters.  Returns true if a camera section exists. */
 bool mop_scene_get_camera(const MopSceneFile *s, MopVec3 *eye, MopVec3 *target,
                           MopVec3 *up, float *fov, float *near_p, float *far_p);
@@ -27,11 +27,11 @@ typedef struct MopDecalDesc {
   int32_t texture_idx; /* bindless texture index, or -1 for white */
 } MopDecalDesc;
 
-/* Maximum decal ID value (fixed-capacity array in GPU backend). */
+/* Maximum decal ID value (fixed-capacity array in the backend). */
 #define MOP_MAX_DECALS 256
 
 /* Add a decal to the scene.  Returns a decal ID (0..MOP_MAX_DECALS-1),
- * or -1 on failure (capacity exceeded, no GPU backend). */
+ * or -1 on failure (capacity exceeded, backend without decals). */
 int32_t mop_viewport_add_decal(MopViewport *vp, const MopDecalDesc *desc);
 
 /* Remove a previously added decal by ID. */
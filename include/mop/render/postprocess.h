@@ -52,6 +52,21 @@ float mop_viewport_get_exposure(const MopViewport *viewport);
 void mop_viewport_set_bloom(MopViewport *viewport, float threshold,
                             float intensity);
 
+/* Order-independent transparency mode for the CPU backend
+ * (MOP_POST_OIT).  GPU backends always use weighted blended OIT.
+ *   WEIGHTED — weighted blended OIT: one pass, fixed memory, approximate
+ *              where overlapping layers differ strongly in color
+ *   EXACT    — per-pixel fragment lists sorted at resolve; exact up to
+ *              16 layers per pixel, memory grows with transparent
+ *              fragments
+ * Default: MOP_OIT_WEIGHTED. */
+typedef enum MopOitMode {
+  MOP_OIT_WEIGHTED = 0,
+  MOP_OIT_EXACT = 1
+} MopOitMode;
+
+void mop_viewport_set_oit_mode(MopViewport *viewport, MopOitMode mode);
+
 /* Screen-Space Reflections control.
  * intensity: reflection strength (0..1).  Default: 0.5. */
 void mop_viewport_set_ssr(MopViewport *viewport, float intensity);
@@ -22,6 +22,14 @@
  *   — animating procedural content, driving meshes you already added via
  *   mop_viewport_add_mesh, ticking shader-plugin-owned simulations.
  *
+ * CPU shading:
+ *   On the CPU backend a plugin can also replace per-vertex and per-pixel
+ *   shading of the meshes it is bound to (mop_mesh_set_shader_plugin).
+ *   Its callbacks receive structure-of-arrays blocks of vertices or
+ *   covered pixels plus the uniform block bound with the mesh, and run
+ *   inside the tiled rasterizer — false-colour analysis, stress maps and
+ *   similar views cost about as much as the built-in shading.
+ *
  * SPDX-License-Identifier: Apache-2.0
  */
 
@@ -39,6 +47,7 @@ extern "C" {
 
 /* Forward declarations */
 typedef struct MopViewport MopViewport;
+typedef struct MopMesh MopMesh;
 typedef struct MopRhiShader MopRhiShader;
 
 /* -------------------------------------------------------------------------
@@ -90,6 +99,56 @@ typedef struct MopShaderDrawContext {
 typedef void (*MopShaderDrawFn)(const MopShaderDrawContext *ctx,
                                 void *user_data);
 
+/* -------------------------------------------------------------------------
+ * CPU shading callbacks — invoked by the CPU backend per block
+ *
+ * Blocks hold up to MOP_SHADER_BLOCK lanes, one array per attribute; only
+ * the first `count` lanes are valid.  Fragment blocks are produced on the
+ * rasterizer's worker threads, so callbacks run concurrently: they must
+ * be reentrant and treat uniforms and user_data as read-only.  GPU
+ * backends ignore these callbacks.
+ * ------------------------------------------------------------------------- */
+
+#define MOP_SHADER_BLOCK 8
+#define MOP_SHADER_UNIFORMS_MAX 256 /* bytes per mesh binding */
+
+/* Vertex block — transformed vertices of one draw, before clipping.
+ * All fields are in/out; positions written here are reprojected. */
+typedef struct MopShaderVertexBlock {
+  uint32_t count;
+  float px[MOP_SHADER_BLOCK], py[MOP_SHADER_BLOCK], pz[MOP_SHADER_BLOCK];
+  float nx[MOP_SHADER_BLOCK], ny[MOP_SHADER_BLOCK], nz[MOP_SHADER_BLOCK];
+  float r[MOP_SHADER_BLOCK], g[MOP_SHADER_BLOCK], b[MOP_SHADER_BLOCK];
+  float a[MOP_SHADER_BLOCK];
+  float u[MOP_SHADER_BLOCK], v[MOP_SHADER_BLOCK];
+} MopShaderVertexBlock;
+
+/* Fragment block — covered pixels of one triangle row that passed the
+ * depth test, in world space.  out_* is the pixel written: linear HDR
+ * color and opacity, preset to the built-in lit color when the plugin
+ * asked for it (cpu_fragment_lit), else to the unlit base color, and to
+ * the mesh opacity.  A lane left with out_a <= 0 is discarded. */
+typedef struct MopShaderFragmentBlock {
+  uint32_t count;
+  /* Pixel in the internal framebuffer (scaled by ssaa_factor) */
+  int32_t x[MOP_SHADER_BLOCK], y[MOP_SHADER_BLOCK];
+  float depth[MOP_SHADER_BLOCK];                    /* 0 near .. 1 far */
+  float px[MOP_SHADER_BLOCK], py[MOP_SHADER_BLOCK], pz[MOP_SHADER_BLOCK];
+  float nx[MOP_SHADER_BLOCK], ny[MOP_SHADER_BLOCK], nz[MOP_SHADER_BLOCK];
+  float u[MOP_SHADER_BLOCK], v[MOP_SHADER_BLOCK];
+  /* Base color: the interpolated vertex color, or the attached material
+   * graph's */
+  float r[MOP_SHADER_BLOCK], g[MOP_SHADER_BLOCK], b[MOP_SHADER_BLOCK];
+  float a[MOP_SHADER_BLOCK];
+  float out_r[MOP_SHADER_BLOCK], out_g[MOP_SHADER_BLOCK];
+  float out_b[MOP_SHADER_BLOCK], out_a[MOP_SHADER_BLOCK];
+} MopShaderFragmentBlock;
+
+typedef void (*MopShaderVertexFn)(MopShaderVertexBlock *block,
+                                  const void *uniforms, void *user_data);
+typedef void (*MopShaderFragmentFn)(MopShaderFragmentBlock *block,
+                                    const void *uniforms, void *user_data);
+
 /* -------------------------------------------------------------------------
  * Plugin descriptor — passed to mop_viewport_register_shader
  * ------------------------------------------------------------------------- */
@@ -108,9 +167,16 @@ typedef struct MopShaderPluginDesc {
   const uint32_t *compute_spirv; /* optional */
   size_t compute_spirv_size;     /* bytes */
 
-  /* Draw callback — invoked once per frame at the registered stage. */
+  /* Draw callback — invoked once per frame at the registered stage.
+   * Optional when a CPU shading callback is given. */
   MopShaderDrawFn draw;
   void *user_data;
+
+  /* CPU shading (optional) — applied to meshes bound with
+   * mop_mesh_set_shader_plugin.  Either callback may be NULL. */
+  MopShaderVertexFn cpu_vertex;
+  MopShaderFragmentFn cpu_fragment;
+  bool cpu_fragment_lit; /* preset out_* to the built-in lit color */
 } MopShaderPluginDesc;
 
 /* -------------------------------------------------------------------------
@@ -131,10 +197,20 @@ MopShaderPlugin *mop_viewport_register_shader(MopViewport *vp,
                                               const MopShaderPluginDesc *desc);
 
 /* Unregister and destroy a shader plugin.
- * Releases shader modules and removes the plugin from the render graph.
- * The plugin pointer is invalid after this call. */
+ * Releases shader modules, removes the plugin from the render graph and
+ * unbinds it from every mesh.  The plugin pointer is invalid after this
+ * call. */
 void mop_viewport_unregister_shader(MopViewport *vp, MopShaderPlugin *plugin);
 
+/* Shade mesh with plugin's CPU callbacks, passing them a copy of
+ * uniforms (uniform_size <= MOP_SHADER_UNIFORMS_MAX bytes; NULL / 0 for
+ * none).  Call again to update the uniforms; plugin NULL unbinds.
+ * Returns false if the plugin has no CPU callback or the uniform block
+ * is too large.  Vertex callbacks see the mesh's transformed vertices;
+ * fragment callbacks cover filled triangles in every shading mode. */
+bool mop_mesh_set_shader_plugin(MopMesh *mesh, MopShaderPlugin *plugin,
+                                const void *uniforms, size_t uniform_size);
+
 /* -------------------------------------------------------------------------
  * Accessors — query plugin state
  * ------------------------------------------------------------------------- */
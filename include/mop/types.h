@@ -114,6 +114,17 @@ MopMat4 mop_mat4_scale(MopVec3 s);
 MopMat4 mop_mat4_multiply(MopMat4 a, MopMat4 b);
 MopVec4 mop_mat4_mul_vec4(MopMat4 m, MopVec4 v);
 
+/* Transform count points by m with w = 1: out[i] = m * (p, 1), no
+ * perspective divide.  Points are read `stride` bytes apart, so
+ * &vertices[0].position with sizeof(MopVertex) walks a vertex array in
+ * place; stride 0 means tightly packed MopVec3. */
+void mop_mat4_transform_points(const MopMat4 *m, const MopVec3 *points,
+                               size_t stride, size_t count, MopVec4 *out);
+
+/* out[i] = a * b[i] for count matrices.  out may be b (in place). */
+void mop_mat4_multiply_batch(const MopMat4 *a, const MopMat4 *b, size_t count,
+                             MopMat4 *out);
+
 /* Compose a TRS matrix: T * Rz * Ry * Rx * S.
  * rotation components are euler angles in radians. */
 MopMat4 mop_mat4_compose_trs(MopVec3 position, MopVec3 rotation, MopVec3 scale);
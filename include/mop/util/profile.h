@@ -75,6 +75,12 @@ typedef struct MopFrameStats {
   /* LOD statistics */
   uint32_t lod_transitions; /* meshes that changed LOD this frame */
 
+  /* Meshlet culling (CPU backend, meshes with mop_mesh_build_meshlets) */
+  uint32_t meshlets_visible;
+  uint32_t meshlets_culled_frustum;
+  uint32_t meshlets_culled_backface;
+  uint32_t meshlets_culled_occlusion;
+
   /* Memory usage (bytes, 0 if not available) */
   uint64_t gpu_memory_used;
   uint64_t gpu_memory_budget;
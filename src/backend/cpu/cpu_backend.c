@@ -11,12 +11,19 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include "backend/cpu/cpu_bc.h"
+#include "backend/cpu/cpu_meshlet.h"
+#include "backend/cpu/cpu_vertex.h"
+#include "core/thread_pool.h"
+#include "math/math_simd.h"
 #include "rasterizer/rasterizer.h"
+#include "rasterizer/rasterizer_material.h"
 #include "rasterizer/rasterizer_mt.h"
 #include "rhi/rhi.h"
 
 #include <math.h>
 #include <mop/core/vertex_format.h>
+#include <mop/render/decal.h>
 #include <mop/util/log.h>
 #include <stdlib.h>
 #include <string.h>
@@ -26,8 +33,31 @@
  * Internal types
  * ------------------------------------------------------------------------- */
 
+/* Projected decal box: local [-0.5, 0.5]^3, as mop_decal.frag */
+typedef struct MopCpuDecal {
+  bool active;
+  MopMat4 model;
+  MopMat4 inv_model; /* world -> decal local */
+  float opacity;
+  int32_t texture_idx;
+  int x0, y0, x1, y1; /* pixel bounds this draw (x1, y1 exclusive) */
+} MopCpuDecal;
+
 struct MopRhiDevice {
-  MopSwThreadPool *threadpool; /* tile-based parallel rasterizer */
+  MopSwThreadPool *threadpool;      /* tile-based parallel rasterizer */
+  MopRhiMeshletStats meshlet_stats; /* since the last frame_begin */
+  MopCpuVertexStream vertex_stream; /* per-draw transformed vertices */
+
+  /* Decal texture indices, as the Vulkan bindless table: 0 = white,
+   * 1 = black, 2 + i = the i-th texture created (NULL once destroyed) */
+  MopRhiTexture **textures;
+  uint32_t texture_count;
+  uint32_t texture_capacity;
+
+  MopCpuDecal decals[MOP_MAX_DECALS];
+  uint32_t decal_count; /* active */
+  uint32_t *decal_bins; /* per-tile decal lists, see cpu_draw_decals */
+  size_t decal_bins_capacity;
 };
 
 struct MopRhiBuffer {
@@ -38,6 +68,15 @@ struct MopRhiBuffer {
 struct MopRhiFramebuffer {
   MopSwFramebuffer fb;
   uint8_t *readback; /* RGBA8 readback copy (same as fb.color) */
+
+  /* Depth pyramid for meshlet occlusion culling.  depth_draws counts
+   * depth-writing draws since the last clear; the pyramid is rebuilt
+   * lazily when a meshlet draw finds it older than that, and dropped by
+   * draws that write depth without testing it. */
+  MopCpuHiZ hiz;
+  bool hiz_valid;     /* pyramid built since the last clear */
+  uint32_t hiz_stamp; /* depth_draws when the pyramid was built */
+  uint32_t depth_draws;
 };
 
 struct MopRhiTexture {
@@ -46,8 +85,86 @@ struct MopRhiTexture {
   uint8_t *data;   /* RGBA8, row-major (NULL for HDR-only textures) */
   float *hdr_data; /* RGBA float, row-major (NULL for LDR textures) */
   bool is_hdr;
+  bool borrowed; /* data belongs to the texture store — never written/freed */
+
+  /* Block-compressed textures keep mip 0 as BC blocks; data stays NULL
+   * and texels are decoded on demand (see cpu_bc.h). */
+  int bc_format;     /* MopTexFormat value (0 = not compressed) */
+  uint8_t *blocks;   /* BC blocks, row-major (NULL = not compressed) */
+  int blocks_x;      /* blocks per row */
+  uint32_t bc_uid;   /* block cache key */
+
+  int32_t registry_index; /* decal texture index, -1 = unregistered */
 };
 
+/* Fetch texel (x, y) as RGBA8.  Coordinates must already be clamped. */
+static inline void cpu_tex_fetch(const MopRhiTexture *tex, int x, int y,
+                                 uint8_t out[4]) {
+  if (tex->blocks) {
+    mop_cpu_bc_fetch(tex->blocks, tex->bc_format, tex->blocks_x,
+                     tex->bc_uid, x, y, out);
+    return;
+  }
+  memcpy(out, tex->data + ((size_t)y * (size_t)tex->width + (size_t)x) * 4,
+         4);
+}
+
+/* Texel as RGBA 0..1 floats, from LDR, BC or HDR storage */
+static void cpu_tex_texel(const MopRhiTexture *tex, int x, int y,
+                          float out[4]) {
+  if (tex->data || tex->blocks) {
+    uint8_t t[4];
+    cpu_tex_fetch(tex, x, y, t);
+    for (int i = 0; i < 4; i++)
+      out[i] = (float)t[i] / 255.0f;
+  } else {
+    memcpy(out, tex->hdr_data + ((size_t)y * tex->width + x) * 4,
+           4 * sizeof(float));
+  }
+}
+
+static inline int cpu_tex_wrap(int i, int n, bool wrap) {
+  if (wrap) {
+    i %= n;
+    return i < 0 ? i + n : i;
+  }
+  return i < 0 ? 0 : (i >= n ? n - 1 : i);
+}
+
+/* Bilinear sample at (u, v), repeating or clamped to the edge */
+static void cpu_tex_bilinear(const MopRhiTexture *tex, float u, float v,
+                             bool wrap, float out[4]) {
+  float fx = u * (float)tex->width - 0.5f, fy = v * (float)tex->height - 0.5f;
+  float flx = floorf(fx), fly = floorf(fy);
+  float tx = fx - flx, ty = fy - fly;
+  int x0 = (int)flx, y0 = (int)fly;
+  int xs[2] = {cpu_tex_wrap(x0, tex->width, wrap),
+               cpu_tex_wrap(x0 + 1, tex->width, wrap)};
+  int ys[2] = {cpu_tex_wrap(y0, tex->height, wrap),
+               cpu_tex_wrap(y0 + 1, tex->height, wrap)};
+  float wgt[4] = {(1 - tx) * (1 - ty), tx * (1 - ty), (1 - tx) * ty, tx * ty};
+  out[0] = out[1] = out[2] = out[3] = 0.0f;
+  for (int k = 0; k < 4; k++) {
+    float t[4];
+    cpu_tex_texel(tex, xs[k & 1], ys[k >> 1], t);
+    for (int i = 0; i < 4; i++)
+      out[i] += t[i] * wgt[k];
+  }
+}
+
+/* MopSwMatSampleFn for material programs: handles are MopRhiTexture */
+static void cpu_material_sample(const void *handle, float u, float v,
+                                float out[4]) {
+  const MopRhiTexture *tex = handle;
+  if (tex->width < 1 || tex->height < 1 ||
+      (!tex->data && !tex->blocks && !tex->hdr_data)) {
+    out[0] = out[1] = out[2] = out[3] = 1.0f;
+    return;
+  }
+  /* Keep far-off UVs in range before the float -> int conversion */
+  cpu_tex_bilinear(tex, u - floorf(u), v - floorf(v), true, out);
+}
+
 /* -------------------------------------------------------------------------
  * Device lifecycle
  * ------------------------------------------------------------------------- */
@@ -80,6 +197,9 @@ static void cpu_device_destroy(MopRhiDevice *device) {
   if (device->threadpool) {
     mop_sw_threadpool_destroy(device->threadpool);
   }
+  mop_cpu_vertex_stream_free(&device->vertex_stream);
+  free(device->textures);
+  free(device->decal_bins);
   free(device);
 }
 
@@ -139,8 +259,24 @@ cpu_framebuffer_create(MopRhiDevice *device,
   return fb;
 }
 
+/* Shared store pixels are immutable: give a borrowed texture a private
+ * copy before anything writes to it */
+static bool cpu_texture_detach(MopRhiTexture *tex) {
+  if (!tex->borrowed)
+    return true;
+  size_t bytes = (size_t)tex->width * (size_t)tex->height * 4;
+  uint8_t *own = malloc(bytes);
+  if (!own)
+    return false;
+  memcpy(own, tex->data, bytes);
+  tex->data = own;
+  tex->borrowed = false;
+  return true;
+}
+
 /* Wrap a host-owned RGBA8 texture as the color attachment. Zero-copy:
- * the rasterizer writes directly into the host's pixel buffer. */
+ * the rasterizer writes directly into the host's pixel buffer, detached
+ * first if it was borrowed from the shared store. */
 static MopRhiFramebuffer *
 cpu_framebuffer_create_from_texture(MopRhiDevice *device, MopRhiTexture *color,
                                     int width, int height) {
@@ -158,6 +294,9 @@ cpu_framebuffer_create_from_texture(MopRhiDevice *device, MopRhiTexture *color,
     return NULL;
   }
 
+  if (!cpu_texture_detach(color))
+    return NULL;
+
   MopRhiFramebuffer *fb = calloc(1, sizeof(MopRhiFramebuffer));
   if (!fb)
     return NULL;
@@ -176,6 +315,7 @@ static void cpu_framebuffer_destroy(MopRhiDevice *device,
   if (!fb)
     return;
   mop_sw_framebuffer_free(&fb->fb);
+  mop_cpu_hiz_free(&fb->hiz);
   free(fb);
 }
 
@@ -188,6 +328,8 @@ static void cpu_framebuffer_resize(MopRhiDevice *device, MopRhiFramebuffer *fb,
   mop_sw_framebuffer_free(&fb->fb);
   mop_sw_framebuffer_alloc(&fb->fb, width, height);
   fb->readback = fb->fb.color;
+  fb->hiz_valid = false;
+  fb->depth_draws = 0;
 }
 
 /* -------------------------------------------------------------------------
@@ -196,8 +338,10 @@ static void cpu_framebuffer_resize(MopRhiDevice *device, MopRhiFramebuffer *fb,
 
 static void cpu_frame_begin(MopRhiDevice *device, MopRhiFramebuffer *fb,
                             MopColor clear_color) {
-  (void)device;
   mop_sw_framebuffer_clear(&fb->fb, clear_color);
+  fb->hiz_valid = false;
+  fb->depth_draws = 0;
+  device->meshlet_stats = (MopRhiMeshletStats){0};
 }
 
 static void cpu_frame_end(MopRhiDevice *device, MopRhiFramebuffer *fb) {
@@ -218,88 +362,59 @@ static void cpu_frame_submit(MopRhiDevice *device, MopRhiFramebuffer *fb) {
  * ------------------------------------------------------------------------- */
 
 /* -------------------------------------------------------------------------
- * Transform and prepare a single triangle from a draw call
+ * Vertex stage and triangle assembly
+ *
+ * Vertices are transformed once per draw into an SoA stream (see
+ * cpu_vertex.h); triangles then only gather their three corners.
  * ------------------------------------------------------------------------- */
 
-static bool cpu_prepare_triangle(const MopRhiDrawCall *call,
-                                 const MopVertex *v0, const MopVertex *v1,
-                                 const MopVertex *v2, MopSwPreparedTri *out) {
-  /* Transform vertices to clip space */
-  MopVec4 pos0 = {v0->position.x, v0->position.y, v0->position.z, 1.0f};
-  MopVec4 pos1 = {v1->position.x, v1->position.y, v1->position.z, 1.0f};
-  MopVec4 pos2 = {v2->position.x, v2->position.y, v2->position.z, 1.0f};
-
-  out->vertices[0].position = mop_mat4_mul_vec4(call->mvp, pos0);
-  out->vertices[1].position = mop_mat4_mul_vec4(call->mvp, pos1);
-  out->vertices[2].position = mop_mat4_mul_vec4(call->mvp, pos2);
-
-  /* Apply depth bias — push clip-space Z slightly farther to avoid Z-fighting
-   * with coplanar scene geometry (e.g. grid vs objects at Y=0). */
-  if (call->depth_bias != 0.0f) {
-    for (int k = 0; k < 3; k++)
-      out->vertices[k].position.z +=
-          call->depth_bias * out->vertices[k].position.w;
+/* Nearest-neighbor texture sample at each vertex's UV, modulating the
+ * vertex color */
+static void cpu_modulate_texture(const MopRhiTexture *tex,
+                                 MopCpuVertexStream *s) {
+  float *const *c = s->c;
+  for (uint32_t k = 0; k < s->count; k++) {
+    float tu = c[MOP_CPU_VS_U][k] - floorf(c[MOP_CPU_VS_U][k]);
+    float tv = c[MOP_CPU_VS_V][k] - floorf(c[MOP_CPU_VS_V][k]);
+    int tx = (int)(tu * (float)(tex->width - 1) + 0.5f);
+    int ty = (int)(tv * (float)(tex->height - 1) + 0.5f);
+    if (tx < 0)
+      tx = 0;
+    if (tx >= tex->width)
+      tx = tex->width - 1;
+    if (ty < 0)
+      ty = 0;
+    if (ty >= tex->height)
+      ty = tex->height - 1;
+    uint8_t texel[4];
+    cpu_tex_fetch(tex, tx, ty, texel);
+    c[MOP_CPU_VS_R][k] *= (float)texel[0] / 255.0f;
+    c[MOP_CPU_VS_G][k] *= (float)texel[1] / 255.0f;
+    c[MOP_CPU_VS_B][k] *= (float)texel[2] / 255.0f;
+    c[MOP_CPU_VS_A][k] *= (float)texel[3] / 255.0f;
   }
+}
 
-  /* World-space positions for point/spot light attenuation */
-  MopVec4 wp0 = mop_mat4_mul_vec4(call->model, pos0);
-  MopVec4 wp1 = mop_mat4_mul_vec4(call->model, pos1);
-  MopVec4 wp2 = mop_mat4_mul_vec4(call->model, pos2);
-  out->vertices[0].world_pos = (MopVec3){wp0.x, wp0.y, wp0.z};
-  out->vertices[1].world_pos = (MopVec3){wp1.x, wp1.y, wp1.z};
-  out->vertices[2].world_pos = (MopVec3){wp2.x, wp2.y, wp2.z};
-
-  /* Transform normals by model matrix (upper 3x3) */
-  MopVec4 n0 = {v0->normal.x, v0->normal.y, v0->normal.z, 0.0f};
-  MopVec4 n1 = {v1->normal.x, v1->normal.y, v1->normal.z, 0.0f};
-  MopVec4 n2 = {v2->normal.x, v2->normal.y, v2->normal.z, 0.0f};
-
-  MopVec4 tn0 = mop_mat4_mul_vec4(call->model, n0);
-  MopVec4 tn1 = mop_mat4_mul_vec4(call->model, n1);
-  MopVec4 tn2 = mop_mat4_mul_vec4(call->model, n2);
-
-  out->vertices[0].normal = (MopVec3){tn0.x, tn0.y, tn0.z};
-  out->vertices[1].normal = (MopVec3){tn1.x, tn1.y, tn1.z};
-  out->vertices[2].normal = (MopVec3){tn2.x, tn2.y, tn2.z};
-
-  out->vertices[0].color = v0->color;
-  out->vertices[1].color = v1->color;
-  out->vertices[2].color = v2->color;
-
-  out->vertices[0].u = v0->u;
-  out->vertices[0].v = v0->v;
-  out->vertices[1].u = v1->u;
-  out->vertices[1].v = v1->v;
-  out->vertices[2].u = v2->u;
-  out->vertices[2].v = v2->v;
-
-  /* Nearest-neighbor texture sampling — modulate vertex color */
-  if (call->texture && call->texture->width >= 1 &&
-      call->texture->height >= 1) {
-    MopRhiTexture *tex = call->texture;
-    for (int t = 0; t < 3; t++) {
-      float tu = out->vertices[t].u - floorf(out->vertices[t].u);
-      float tv = out->vertices[t].v - floorf(out->vertices[t].v);
-      int tx = (int)(tu * (float)(tex->width - 1) + 0.5f);
-      int ty = (int)(tv * (float)(tex->height - 1) + 0.5f);
-      if (tx < 0)
-        tx = 0;
-      if (tx >= tex->width)
-        tx = tex->width - 1;
-      if (ty < 0)
-        ty = 0;
-      if (ty >= tex->height)
-        ty = tex->height - 1;
-      size_t tidx = ((size_t)ty * (size_t)tex->width + (size_t)tx) * 4;
-      float tr_f = (float)tex->data[tidx + 0] / 255.0f;
-      float tg_f = (float)tex->data[tidx + 1] / 255.0f;
-      float tb_f = (float)tex->data[tidx + 2] / 255.0f;
-      float ta_f = (float)tex->data[tidx + 3] / 255.0f;
-      out->vertices[t].color.r *= tr_f;
-      out->vertices[t].color.g *= tg_f;
-      out->vertices[t].color.b *= tb_f;
-      out->vertices[t].color.a *= ta_f;
-    }
+static void cpu_prepare_triangle(const MopRhiDrawCall *call,
+                                 const MopCpuVertexStream *s, uint32_t i0,
+                                 uint32_t i1, uint32_t i2,
+                                 MopSwPreparedTri *out) {
+  const uint32_t idx[3] = {i0, i1, i2};
+  float *const *c = s->c;
+  for (int t = 0; t < 3; t++) {
+    uint32_t k = idx[t];
+    MopSwClipVertex *v = &out->vertices[t];
+    v->position = (MopVec4){c[MOP_CPU_VS_CX][k], c[MOP_CPU_VS_CY][k],
+                            c[MOP_CPU_VS_CZ][k], c[MOP_CPU_VS_CW][k]};
+    v->world_pos = (MopVec3){c[MOP_CPU_VS_WX][k], c[MOP_CPU_VS_WY][k],
+                             c[MOP_CPU_VS_WZ][k]};
+    v->normal = (MopVec3){c[MOP_CPU_VS_NX][k], c[MOP_CPU_VS_NY][k],
+                          c[MOP_CPU_VS_NZ][k]};
+    v->color = (MopColor){c[MOP_CPU_VS_R][k], c[MOP_CPU_VS_G][k],
+                          c[MOP_CPU_VS_B][k], c[MOP_CPU_VS_A][k]};
+    v->u = c[MOP_CPU_VS_U][k];
+    v->v = c[MOP_CPU_VS_V][k];
+    v->tangent = (MopVec3){0, 0, 0};
   }
 
   out->object_id = call->object_id;
@@ -319,219 +434,79 @@ static bool cpu_prepare_triangle(const MopRhiDrawCall *call,
   out->roughness = call->roughness;
   out->line_width = call->line_width;
   out->depth_bias = call->depth_bias;
-
-  return true;
 }
 
-/* -------------------------------------------------------------------------
- * Flexible vertex format: read vertex attributes by offset from raw bytes.
- * Falls back to defaults for missing attributes.
- * ------------------------------------------------------------------------- */
-
-static void read_attrib_float3(const uint8_t *base, uint32_t offset,
-                               MopAttribFormat fmt, float out[3]) {
-  const float *f = (const float *)(base + offset);
-  switch (fmt) {
-  case MOP_FORMAT_FLOAT3:
-  case MOP_FORMAT_FLOAT4:
-    out[0] = f[0];
-    out[1] = f[1];
-    out[2] = f[2];
-    break;
-  case MOP_FORMAT_FLOAT2:
-    out[0] = f[0];
-    out[1] = f[1];
-    out[2] = 0.0f;
-    break;
-  case MOP_FORMAT_FLOAT:
-    out[0] = f[0];
-    out[1] = 0.0f;
-    out[2] = 0.0f;
-    break;
-  default:
-    out[0] = out[1] = out[2] = 0.0f;
-    break;
-  }
-}
-
-static void read_attrib_float4(const uint8_t *base, uint32_t offset,
-                               MopAttribFormat fmt, float out[4]) {
-  const float *f = (const float *)(base + offset);
-  switch (fmt) {
-  case MOP_FORMAT_FLOAT4:
-    out[0] = f[0];
-    out[1] = f[1];
-    out[2] = f[2];
-    out[3] = f[3];
-    break;
-  case MOP_FORMAT_FLOAT3:
-    out[0] = f[0];
-    out[1] = f[1];
-    out[2] = f[2];
-    out[3] = 1.0f;
-    break;
-  case MOP_FORMAT_FLOAT2:
-    out[0] = f[0];
-    out[1] = f[1];
-    out[2] = 0.0f;
-    out[3] = 1.0f;
-    break;
-  case MOP_FORMAT_FLOAT:
-    out[0] = f[0];
-    out[1] = 0.0f;
-    out[2] = 0.0f;
-    out[3] = 1.0f;
-    break;
-  default:
-    out[0] = out[1] = out[2] = 0.0f;
-    out[3] = 1.0f;
-    break;
+/* Depth pyramid for a meshlet draw of tri_count triangles, or NULL.
+ *
+ * Depth-tested writes only move depth nearer, so a pyramid built earlier
+ * in the frame is still conservative, merely less effective (untested
+ * writes invalidate it, see cpu_depth_written).  Rebuilding
+ * reads the whole depth buffer, so it is only done for draws large
+ * enough to repay it: at least one triangle per HIZ_PIXELS_PER_TRI
+ * pixels.  Before the first depth write nothing can be occluded. */
+#define HIZ_PIXELS_PER_TRI 64
+
+static const MopCpuHiZ *cpu_hiz_for_draw(MopRhiFramebuffer *fb,
+                                         uint32_t tri_count) {
+  if (fb->depth_draws == 0)
+    return NULL;
+  bool stale = !fb->hiz_valid || fb->hiz_stamp != fb->depth_draws;
+  size_t pixels = (size_t)fb->fb.width * (size_t)fb->fb.height;
+  if (stale && (size_t)tri_count * HIZ_PIXELS_PER_TRI >= pixels) {
+    fb->hiz_valid = mop_cpu_hiz_build(&fb->hiz, fb->fb.depth, fb->fb.width,
+                                      fb->fb.height);
+    fb->hiz_stamp = fb->depth_draws;
   }
+  return fb->hiz_valid ? &fb->hiz : NULL;
 }
 
-static void read_attrib_float2(const uint8_t *base, uint32_t offset,
-                               MopAttribFormat fmt, float out[2]) {
-  const float *f = (const float *)(base + offset);
-  switch (fmt) {
-  case MOP_FORMAT_FLOAT2:
-  case MOP_FORMAT_FLOAT3:
-  case MOP_FORMAT_FLOAT4:
-    out[0] = f[0];
-    out[1] = f[1];
-    break;
-  case MOP_FORMAT_FLOAT:
-    out[0] = f[0];
-    out[1] = 0.0f;
-    break;
-  default:
-    out[0] = out[1] = 0.0f;
-    break;
-  }
+/* Record a draw that wrote depth.  With depth_test off the writes can
+ * move depth farther, so an older pyramid could hold nearer values than
+ * the buffer and reject visible meshlets: drop it until the next rebuild. */
+static void cpu_depth_written(MopRhiFramebuffer *fb,
+                              const MopRhiDrawCall *call) {
+  fb->depth_draws++;
+  if (!call->depth_test)
+    fb->hiz_valid = false;
 }
 
-static bool cpu_prepare_triangle_ex(const MopRhiDrawCall *call,
-                                    const uint8_t *raw, uint32_t stride,
-                                    uint32_t i0, uint32_t i1, uint32_t i2,
-                                    MopSwPreparedTri *out) {
-  const MopVertexFormat *fmt = call->vertex_format;
-  const uint8_t *v[3] = {raw + (size_t)i0 * stride, raw + (size_t)i1 * stride,
-                         raw + (size_t)i2 * stride};
-
-  const MopVertexAttrib *pos_attr =
-      mop_vertex_format_find(fmt, MOP_ATTRIB_POSITION);
-  if (!pos_attr)
-    return false;
-
-  const MopVertexAttrib *nrm_attr =
-      mop_vertex_format_find(fmt, MOP_ATTRIB_NORMAL);
-  const MopVertexAttrib *col_attr =
-      mop_vertex_format_find(fmt, MOP_ATTRIB_COLOR);
-  const MopVertexAttrib *uv_attr =
-      mop_vertex_format_find(fmt, MOP_ATTRIB_TEXCOORD0);
-
-  for (int t = 0; t < 3; t++) {
-    /* Position → clip space + world space */
-    float pos[3];
-    read_attrib_float3(v[t], pos_attr->offset, pos_attr->format, pos);
-    MopVec4 p = {pos[0], pos[1], pos[2], 1.0f};
-    out->vertices[t].position = mop_mat4_mul_vec4(call->mvp, p);
-    if (call->depth_bias != 0.0f)
-      out->vertices[t].position.z +=
-          call->depth_bias * out->vertices[t].position.w;
-    MopVec4 wp = mop_mat4_mul_vec4(call->model, p);
-    out->vertices[t].world_pos = (MopVec3){wp.x, wp.y, wp.z};
-
-    /* Normal → world space */
-    if (nrm_attr) {
-      float n[3];
-      read_attrib_float3(v[t], nrm_attr->offset, nrm_attr->format, n);
-      MopVec4 nv = {n[0], n[1], n[2], 0.0f};
-      MopVec4 tn = mop_mat4_mul_vec4(call->model, nv);
-      out->vertices[t].normal = (MopVec3){tn.x, tn.y, tn.z};
-    } else {
-      out->vertices[t].normal = (MopVec3){0.0f, 1.0f, 0.0f};
-    }
-
-    /* Color */
-    if (col_attr) {
-      float c[4];
-      read_attrib_float4(v[t], col_attr->offset, col_attr->format, c);
-      out->vertices[t].color = (MopColor){c[0], c[1], c[2], c[3]};
-    } else {
-      out->vertices[t].color = (MopColor){1.0f, 1.0f, 1.0f, 1.0f};
-    }
-
-    /* UV */
-    if (uv_attr) {
-      float uv[2];
-      read_attrib_float2(v[t], uv_attr->offset, uv_attr->format, uv);
-      out->vertices[t].u = uv[0];
-      out->vertices[t].v = uv[1];
-    } else {
-      out->vertices[t].u = 0.0f;
-      out->vertices[t].v = 0.0f;
+static void cpu_draw(MopRhiDevice *device, MopRhiFramebuffer *fb,
+                     const MopRhiDrawCall *call) {
+  const uint32_t *indices = (const uint32_t *)call->index_buffer->data;
+  uint32_t index_count = call->index_count;
+  uint32_t tri_count = index_count / 3;
+
+  /* Meshlet culling: swap in the surviving meshlets' triangles before
+   * any vertex is transformed */
+  uint32_t *meshlet_indices = NULL;
+  if (call->meshlets && call->meshlets->meshlet_count > 0) {
+    meshlet_indices =
+        malloc(call->meshlets->prim_index_count * sizeof(uint32_t));
+    if (meshlet_indices) {
+      const MopCpuHiZ *hiz =
+          call->depth_test ? cpu_hiz_for_draw(fb, tri_count) : NULL;
+      index_count = mop_cpu_meshlet_cull(call, hiz, meshlet_indices,
+                                         &device->meshlet_stats);
+      indices = meshlet_indices;
+      tri_count = index_count / 3;
     }
-
-    out->vertices[t].tangent = (MopVec3){0, 0, 0};
   }
 
-  /* Texture sampling (same as standard path) */
-  if (call->texture && call->texture->width >= 1 &&
-      call->texture->height >= 1) {
-    MopRhiTexture *tex = call->texture;
-    for (int t = 0; t < 3; t++) {
-      float tu = out->vertices[t].u - floorf(out->vertices[t].u);
-      float tv = out->vertices[t].v - floorf(out->vertices[t].v);
-      int tx = (int)(tu * (float)(tex->width - 1) + 0.5f);
-      int ty = (int)(tv * (float)(tex->height - 1) + 0.5f);
-      if (tx < 0)
-        tx = 0;
-      if (tx >= tex->width)
-        tx = tex->width - 1;
-      if (ty < 0)
-        ty = 0;
-      if (ty >= tex->height)
-        ty = tex->height - 1;
-      size_t tidx = ((size_t)ty * (size_t)tex->width + (size_t)tx) * 4;
-      float tr_f = (float)tex->data[tidx + 0] / 255.0f;
-      float tg_f = (float)tex->data[tidx + 1] / 255.0f;
-      float tb_f = (float)tex->data[tidx + 2] / 255.0f;
-      float ta_f = (float)tex->data[tidx + 3] / 255.0f;
-      out->vertices[t].color.r *= tr_f;
-      out->vertices[t].color.g *= tg_f;
-      out->vertices[t].color.b *= tb_f;
-      out->vertices[t].color.a *= ta_f;
-    }
+  /* Transform each referenced vertex once; indices now address the
+   * stream and out-of-range ones are >= stream->count */
+  MopCpuVertexStream *stream = &device->vertex_stream;
+  if (!mop_cpu_vertex_stream_build(stream, call, call->vertex_buffer->data,
+                                   indices, index_count, &indices)) {
+    if (call->vertex_count > 0)
+      MOP_WARN("vertex stage failed, draw skipped");
+    free(meshlet_indices);
+    return;
   }
-
-  out->object_id = call->object_id;
-  out->wireframe = call->wireframe;
-  out->depth_test = call->depth_test;
-  out->depth_write = call->depth_write;
-  out->cull_back = call->backface_cull;
-  out->light_dir = call->light_dir;
-  out->ambient = call->ambient;
-  out->opacity = call->opacity;
-  out->smooth_shading = (call->shading_mode == MOP_SHADING_SMOOTH);
-  out->blend_mode = call->blend_mode;
-  out->lights = call->lights;
-  out->light_count = call->light_count;
-  out->cam_eye = call->cam_eye;
-  out->metallic = call->metallic;
-  out->roughness = call->roughness;
-  out->line_width = call->line_width;
-  out->depth_bias = call->depth_bias;
-
-  return true;
-}
-
-static void cpu_draw(MopRhiDevice *device, MopRhiFramebuffer *fb,
-                     const MopRhiDrawCall *call) {
-  const uint8_t *raw_data = (const uint8_t *)call->vertex_buffer->data;
-  const MopVertex *vertices = (const MopVertex *)raw_data;
-  const uint32_t *indices = (const uint32_t *)call->index_buffer->data;
-  uint32_t tri_count = call->index_count / 3;
-  bool use_flex = (call->vertex_format != NULL);
+  /* A material program samples its own textures per pixel */
+  if (call->texture && call->texture->width >= 1 &&
+      call->texture->height >= 1 && !call->material_program)
+    cpu_modulate_texture(call->texture, stream);
+  mop_cpu_vertex_stream_shade(stream, call, call->shader);
 
   /* depth_write=false: save depth buffer, render, restore (read-only depth) */
   float *saved_depth = NULL;
@@ -543,29 +518,31 @@ static void cpu_draw(MopRhiDevice *device, MopRhiFramebuffer *fb,
       memcpy(saved_depth, fb->fb.depth, depth_size);
   }
 
+  /* Screen-door dither (LOD cross-fade), the material program and the
+   * shader plugin apply to this draw only */
+  mop_sw_dither_set(call->dither_threshold, call->dither_invert);
+  if (call->material_program)
+    mop_sw_material_set(call->material_program, cpu_material_sample);
+  mop_sw_shader_set(call->shader);
+
   /* Use tiled path if threadpool exists and enough triangles */
   if (device->threadpool && tri_count > 100) {
     /* Prepare all triangles */
     MopSwPreparedTri *prepared = malloc(tri_count * sizeof(MopSwPreparedTri));
     if (prepared) {
       uint32_t prepared_count = 0;
-      for (uint32_t i = 0; i + 2 < call->index_count; i += 3) {
+      for (uint32_t i = 0; i + 2 < index_count; i += 3) {
         uint32_t i0 = indices[i + 0];
         uint32_t i1 = indices[i + 1];
         uint32_t i2 = indices[i + 2];
 
-        if (i0 >= call->vertex_count || i1 >= call->vertex_count ||
-            i2 >= call->vertex_count) {
+        if (i0 >= stream->count || i1 >= stream->count ||
+            i2 >= stream->count) {
           continue;
         }
 
-        if (use_flex) {
-          cpu_prepare_triangle_ex(call, raw_data, call->vertex_format->stride,
-                                  i0, i1, i2, &prepared[prepared_count]);
-        } else {
-          cpu_prepare_triangle(call, &vertices[i0], &vertices[i1],
-                               &vertices[i2], &prepared[prepared_count]);
-        }
+        cpu_prepare_triangle(call, stream, i0, i1, i2,
+                             &prepared[prepared_count]);
         prepared_count++;
       }
 
@@ -577,7 +554,13 @@ static void cpu_draw(MopRhiDevice *device, MopRhiFramebuffer *fb,
             (size_t)fb->fb.width * (size_t)fb->fb.height * sizeof(float);
         memcpy(fb->fb.depth, saved_depth, depth_size);
         free(saved_depth);
+      } else {
+        cpu_depth_written(fb, call);
       }
+      free(meshlet_indices);
+      mop_sw_dither_clear();
+      mop_sw_material_clear();
+      mop_sw_shader_clear();
       return;
     }
     /* malloc failed — fall through to single-threaded path */
@@ -586,26 +569,19 @@ static void cpu_draw(MopRhiDevice *device, MopRhiFramebuffer *fb,
   }
 
   /* Single-threaded fallback */
-  for (uint32_t i = 0; i + 2 < call->index_count; i += 3) {
+  for (uint32_t i = 0; i + 2 < index_count; i += 3) {
     uint32_t i0 = indices[i + 0];
     uint32_t i1 = indices[i + 1];
     uint32_t i2 = indices[i + 2];
 
-    if (i0 >= call->vertex_count || i1 >= call->vertex_count ||
-        i2 >= call->vertex_count) {
+    if (i0 >= stream->count || i1 >= stream->count || i2 >= stream->count) {
       continue;
     }
 
     MopSwPreparedTri tri;
-    if (use_flex) {
-      cpu_prepare_triangle_ex(call, raw_data, call->vertex_format->stride, i0,
-                              i1, i2, &tri);
-    } else {
-      cpu_prepare_triangle(call, &vertices[i0], &vertices[i1], &vertices[i2],
-                           &tri);
-    }
+    cpu_prepare_triangle(call, stream, i0, i1, i2, &tri);
 
-    if (tri.lights && tri.light_count > 0) {
+    if ((tri.lights && tri.light_count > 0) || mop_sw_shader_current()) {
       mop_sw_rasterize_triangle_full(
           tri.vertices, tri.object_id, tri.wireframe, tri.depth_test,
           tri.cull_back, tri.light_dir, tri.ambient, tri.opacity,
@@ -625,7 +601,13 @@ static void cpu_draw(MopRhiDevice *device, MopRhiFramebuffer *fb,
         (size_t)fb->fb.width * (size_t)fb->fb.height * sizeof(float);
     memcpy(fb->fb.depth, saved_depth, depth_size);
     free(saved_depth);
+  } else {
+    cpu_depth_written(fb, call);
   }
+  free(meshlet_indices);
+  mop_sw_dither_clear();
+  mop_sw_material_clear();
+  mop_sw_shader_clear();
 }
 
 /* -------------------------------------------------------------------------
@@ -642,17 +624,23 @@ static void cpu_draw_instanced(MopRhiDevice *device, MopRhiFramebuffer *fb,
   if (!call || !instance_transforms || instance_count == 0)
     return;
 
-  for (uint32_t inst = 0; inst < instance_count; inst++) {
-    /* Build a per-instance draw call with overridden model/mvp */
-    MopRhiDrawCall inst_call = *call;
-    inst_call.model = instance_transforms[inst];
-
-    /* Recompute MVP: projection * view * instance_model */
-    MopMat4 view_model =
-        mop_mat4_multiply(call->view, instance_transforms[inst]);
-    inst_call.mvp = mop_mat4_multiply(call->projection, view_model);
-
-    cpu_draw(device, fb, &inst_call);
+  /* MVP = projection * (view * instance_model), computed a chunk of
+   * instances at a time */
+  MopMat4 mvp[64];
+  for (uint32_t base = 0; base < instance_count; base += 64) {
+    uint32_t n = instance_count - base;
+    if (n > 64)
+      n = 64;
+    mop_mat4_multiply_batch(&call->view, instance_transforms + base, n, mvp);
+    mop_mat4_multiply_batch(&call->projection, mvp, n, mvp);
+
+    for (uint32_t k = 0; k < n; k++) {
+      /* Per-instance draw call with overridden model/mvp */
+      MopRhiDrawCall inst_call = *call;
+      inst_call.model = instance_transforms[base + k];
+      inst_call.mvp = mvp[k];
+      cpu_draw(device, fb, &inst_call);
+    }
   }
 }
 
@@ -747,6 +735,9 @@ static bool cpu_framebuffer_copy_to_texture(MopRhiDevice *device,
   int fbw = fb->fb.width, fbh = fb->fb.height;
   int tw = target->width, th = target->height;
 
+  if (!cpu_texture_detach(target))
+    return false;
+
   /* Same size: direct memcpy. */
   if (tw == fbw && th == fbh) {
     memcpy(target->data, fb->fb.color, (size_t)fbw * (size_t)fbh * 4);
@@ -792,11 +783,18 @@ static bool cpu_framebuffer_copy_to_texture(MopRhiDevice *device,
 static bool cpu_texture_read_rgba8(MopRhiDevice *device, MopRhiTexture *texture,
                                    uint8_t *out_buf, size_t buf_size) {
   (void)device;
-  if (!texture || !texture->data || !out_buf)
+  if (!texture || (!texture->data && !texture->blocks) || !out_buf)
     return false;
   size_t needed = (size_t)texture->width * (size_t)texture->height * 4;
   if (buf_size < needed)
     return false;
+  if (texture->blocks) {
+    for (int y = 0; y < texture->height; y++)
+      for (int x = 0; x < texture->width; x++)
+        cpu_tex_fetch(texture, x, y,
+                      out_buf + ((size_t)y * texture->width + x) * 4);
+    return true;
+  }
   memcpy(out_buf, texture->data, needed);
   return true;
 }
@@ -805,10 +803,28 @@ static bool cpu_texture_read_rgba8(MopRhiDevice *device, MopRhiTexture *texture,
  * Texture management
  * ------------------------------------------------------------------------- */
 
+/* Give tex the next decal texture index; unregistered on failure */
+static MopRhiTexture *cpu_texture_register(MopRhiDevice *device,
+                                          MopRhiTexture *tex) {
+  if (!tex)
+    return NULL;
+  tex->registry_index = -1;
+  if (device->texture_count == device->texture_capacity) {
+    uint32_t cap = device->texture_capacity ? device->texture_capacity * 2 : 16;
+    MopRhiTexture **t = realloc(device->textures, cap * sizeof(*t));
+    if (!t)
+      return tex;
+    device->textures = t;
+    device->texture_capacity = cap;
+  }
+  tex->registry_index = (int32_t)device->texture_count + 2;
+  device->textures[device->texture_count++] = tex;
+  return tex;
+}
+
 static MopRhiTexture *cpu_texture_create(MopRhiDevice *device, int width,
                                          int height, const uint8_t *rgba_data) {
-  (void)device;
-  MopRhiTexture *tex = malloc(sizeof(MopRhiTexture));
+  MopRhiTexture *tex = calloc(1, sizeof(MopRhiTexture));
   if (!tex)
     return NULL;
 
@@ -822,13 +838,29 @@ static MopRhiTexture *cpu_texture_create(MopRhiDevice *device, int width,
   memcpy(tex->data, rgba_data, byte_count);
   tex->width = width;
   tex->height = height;
-  return tex;
+  return cpu_texture_register(device, tex);
+}
+
+static MopRhiTexture *cpu_texture_create_shared(MopRhiDevice *device,
+                                                int width, int height,
+                                                const uint8_t *rgba_data) {
+  if (!rgba_data)
+    return NULL;
+  MopRhiTexture *tex = calloc(1, sizeof(MopRhiTexture));
+  if (!tex)
+    return NULL;
+  /* Sampling only ever reads tex->data; render targets and the
+   * copy-to-texture path detach before writing. */
+  tex->data = (uint8_t *)rgba_data;
+  tex->width = width;
+  tex->height = height;
+  tex->borrowed = true;
+  return cpu_texture_register(device, tex);
 }
 
 static MopRhiTexture *cpu_texture_create_hdr(MopRhiDevice *device, int width,
                                              int height,
                                              const float *rgba_float_data) {
-  (void)device;
   MopRhiTexture *tex = calloc(1, sizeof(MopRhiTexture));
   if (!tex)
     return NULL;
@@ -844,178 +876,7 @@ static MopRhiTexture *cpu_texture_create_hdr(MopRhiDevice *device, int width,
   tex->width = width;
   tex->height = height;
   tex->is_hdr = true;
-  return tex;
-}
-
-/* -------------------------------------------------------------------------
- * Software BC texture decompression (CPU fallback for compressed formats)
- * ------------------------------------------------------------------------- */
-
-/* Decode RGB565 to R8G8B8 */
-static void bc_decode_rgb565(uint16_t c, uint8_t out[3]) {
-  out[0] = (uint8_t)(((c >> 11) & 0x1F) * 255 / 31);
-  out[1] = (uint8_t)(((c >> 5) & 0x3F) * 255 / 63);
-  out[2] = (uint8_t)((c & 0x1F) * 255 / 31);
-}
-
-/* Decode a BC1 (DXT1) 4x4 block (8 bytes) into 16 RGBA pixels */
-static void bc1_decode_block(const uint8_t *src, uint8_t *dst, int dst_stride) {
-  uint16_t c0 = (uint16_t)(src[0] | (src[1] << 8));
-  uint16_t c1 = (uint16_t)(src[2] | (src[3] << 8));
-  uint32_t lut =
-      (uint32_t)(src[4] | (src[5] << 8) | (src[6] << 16) | (src[7] << 24));
-
-  uint8_t color[4][4]; /* [index][RGBA] */
-  bc_decode_rgb565(c0, color[0]);
-  color[0][3] = 255;
-  bc_decode_rgb565(c1, color[1]);
-  color[1][3] = 255;
-
-  if (c0 > c1) {
-    for (int i = 0; i < 3; i++) {
-      color[2][i] = (uint8_t)((2 * color[0][i] + color[1][i] + 1) / 3);
-      color[3][i] = (uint8_t)((color[0][i] + 2 * color[1][i] + 1) / 3);
-    }
-    color[2][3] = 255;
-    color[3][3] = 255;
-  } else {
-    for (int i = 0; i < 3; i++)
-      color[2][i] = (uint8_t)((color[0][i] + color[1][i]) / 2);
-    color[2][3] = 255;
-    color[3][0] = 0;
-    color[3][1] = 0;
-    color[3][2] = 0;
-    color[3][3] = 0; /* transparent black */
-  }
-
-  for (int y = 0; y < 4; y++) {
-    for (int x = 0; x < 4; x++) {
-      int idx = (y * 4 + x) * 2;
-      int ci = (lut >> idx) & 3;
-      uint8_t *p = dst + y * dst_stride + x * 4;
-      p[0] = color[ci][0];
-      p[1] = color[ci][1];
-      p[2] = color[ci][2];
-      p[3] = color[ci][3];
-    }
-  }
-}
-
-/* Decode a BC4 channel block (8 bytes) into 16 uint8 values */
-static void bc4_decode_block(const uint8_t *src, uint8_t *dst, int dst_stride,
-                             int channel_offset) {
-  uint8_t a0 = src[0];
-  uint8_t a1 = src[1];
-
-  /* 48-bit index table (6 bytes, 3 bits per texel) */
-  uint64_t bits = 0;
-  for (int i = 0; i < 6; i++)
-    bits |= (uint64_t)src[2 + i] << (i * 8);
-
-  uint8_t palette[8];
-  palette[0] = a0;
-  palette[1] = a1;
-  if (a0 > a1) {
-    for (int i = 1; i <= 6; i++)
-      palette[1 + i] = (uint8_t)(((7 - i) * a0 + i * a1 + 3) / 7);
-  } else {
-    for (int i = 1; i <= 4; i++)
-      palette[1 + i] = (uint8_t)(((5 - i) * a0 + i * a1 + 2) / 5);
-    palette[6] = 0;
-    palette[7] = 255;
-  }
-
-  for (int y = 0; y < 4; y++) {
-    for (int x = 0; x < 4; x++) {
-      int texel = y * 4 + x;
-      int ai = (int)((bits >> (texel * 3)) & 7);
-      dst[y * dst_stride + x * 4 + channel_offset] = palette[ai];
-    }
-  }
-}
-
-/* Decode a BC3 (DXT5) 4x4 block (16 bytes) into 16 RGBA pixels */
-static void bc3_decode_block(const uint8_t *src, uint8_t *dst, int dst_stride) {
-  /* First 8 bytes: alpha (BC4 format) */
-  /* Last 8 bytes: color (BC1/DXT1 format) */
-  bc1_decode_block(src + 8, dst, dst_stride);
-  bc4_decode_block(src, dst, dst_stride, 3); /* alpha channel */
-}
-
-/* Decode a BC5 4x4 block (16 bytes) into 16 RGBA pixels (R,G channels) */
-static void bc5_decode_block(const uint8_t *src, uint8_t *dst, int dst_stride) {
-  /* Initialize output to (0, 0, 0, 255) */
-  for (int y = 0; y < 4; y++) {
-    for (int x = 0; x < 4; x++) {
-      uint8_t *p = dst + y * dst_stride + x * 4;
-      p[0] = 0;
-      p[1] = 0;
-      p[2] = 0;
-      p[3] = 255;
-    }
-  }
-  bc4_decode_block(src, dst, dst_stride, 0);     /* red channel */
-  bc4_decode_block(src + 8, dst, dst_stride, 1); /* green channel */
-}
-
-/* Decompress a full BC-compressed image to RGBA8 */
-static uint8_t *bc_decompress_to_rgba8(const uint8_t *data, int width,
-                                       int height, int format) {
-  int bw = (width + 3) / 4;
-  int bh = (height + 3) / 4;
-  size_t block_size = (format == 1) ? 8 : 16; /* BC1=8, BC3/BC5/BC7=16 */
-  size_t out_size = (size_t)width * (size_t)height * 4;
-  uint8_t *out = calloc(1, out_size);
-  if (!out)
-    return NULL;
-
-  for (int by = 0; by < bh; by++) {
-    for (int bx = 0; bx < bw; bx++) {
-      size_t block_idx = (size_t)by * (size_t)bw + (size_t)bx;
-      const uint8_t *block = data + block_idx * block_size;
-
-      /* Decode into a temporary 4x4 RGBA buffer */
-      uint8_t tmp[4 * 4 * 4]; /* 16 pixels * 4 channels */
-      int tmp_stride = 4 * 4;
-
-      switch (format) {
-      case 1: /* BC1 */
-        bc1_decode_block(block, tmp, tmp_stride);
-        break;
-      case 2: /* BC3 */
-        bc3_decode_block(block, tmp, tmp_stride);
-        break;
-      case 3: /* BC5 */
-        bc5_decode_block(block, tmp, tmp_stride);
-        break;
-      default:
-        /* BC7 — too complex for software decode, fill magenta */
-        for (int i = 0; i < 16; i++) {
-          tmp[i * 4 + 0] = 255;
-          tmp[i * 4 + 1] = 0;
-          tmp[i * 4 + 2] = 255;
-          tmp[i * 4 + 3] = 255;
-        }
-        break;
-      }
-
-      /* Copy decoded 4x4 block to output image (clamped to image bounds) */
-      int px = bx * 4;
-      int py = by * 4;
-      for (int ty = 0; ty < 4 && (py + ty) < height; ty++) {
-        for (int tx = 0; tx < 4 && (px + tx) < width; tx++) {
-          uint8_t *src_px = tmp + ty * tmp_stride + tx * 4;
-          uint8_t *dst_px = out + ((py + ty) * width + (px + tx)) * 4;
-          dst_px[0] = src_px[0];
-          dst_px[1] = src_px[1];
-          dst_px[2] = src_px[2];
-          dst_px[3] = src_px[3];
-        }
-      }
-    }
-  }
-
-  return out;
+  return cpu_texture_register(device, tex);
 }
 
 static MopRhiTexture *cpu_texture_create_ex(MopRhiDevice *device, int width,
@@ -1023,7 +884,6 @@ static MopRhiTexture *cpu_texture_create_ex(MopRhiDevice *device, int width,
                                             int mip_levels, const uint8_t *data,
                                             size_t data_size) {
   (void)mip_levels;
-  (void)data_size;
 
   /* RGBA8: delegate to the standard path */
   if (format == 0)
@@ -1034,40 +894,50 @@ static MopRhiTexture *cpu_texture_create_ex(MopRhiDevice *device, int width,
     return NULL;
   }
 
-  /* BC7 is too complex for software decode */
-  if (format == 4) {
-    MOP_WARN("cpu_texture_create_ex: BC7 software decode not supported, "
-             "returning NULL");
+  size_t block_bytes = mop_cpu_bc_block_bytes(format);
+  if (block_bytes == 0) {
+    MOP_WARN("cpu_texture_create_ex: unknown format %d", format);
     return NULL;
   }
 
-  /* Validate format range */
-  if (format < 1 || format > 4) {
-    MOP_WARN("cpu_texture_create_ex: unknown format %d", format);
+  /* Keep mip 0 compressed; the sampler decodes blocks on demand.  Lower
+   * mips in `data` are dropped — the CPU sampler is single-level. */
+  int bw = (width + 3) / 4;
+  int bh = (height + 3) / 4;
+  size_t mip0_bytes = (size_t)bw * (size_t)bh * block_bytes;
+  if (data_size && data_size < mip0_bytes) {
+    MOP_WARN("cpu_texture_create_ex: %zu bytes for %dx%d format %d, "
+             "need %zu",
+             data_size, width, height, format, mip0_bytes);
     return NULL;
   }
 
-  /* Decompress to RGBA8 */
-  uint8_t *rgba = bc_decompress_to_rgba8(data, width, height, format);
-  if (!rgba) {
-    MOP_WARN("cpu_texture_create_ex: BC%d decompression failed (OOM)",
-             format == 1   ? 1
-             : format == 2 ? 3
-                           : 5);
+  MopRhiTexture *tex = calloc(1, sizeof(MopRhiTexture));
+  if (!tex)
+    return NULL;
+  tex->blocks = malloc(mip0_bytes);
+  if (!tex->blocks) {
+    free(tex);
     return NULL;
   }
-
-  MopRhiTexture *tex = cpu_texture_create(device, width, height, rgba);
-  free(rgba);
-  return tex;
+  memcpy(tex->blocks, data, mip0_bytes);
+  tex->width = width;
+  tex->height = height;
+  tex->bc_format = format;
+  tex->blocks_x = bw;
+  tex->bc_uid = mop_cpu_bc_new_uid();
+  return cpu_texture_register(device, tex);
 }
 
 static void cpu_texture_destroy(MopRhiDevice *device, MopRhiTexture *texture) {
-  (void)device;
   if (!texture)
     return;
-  free(texture->data);
+  if (texture->registry_index >= 2)
+    device->textures[texture->registry_index - 2] = NULL;
+  if (!texture->borrowed)
+    free(texture->data);
   free(texture->hdr_data);
+  free(texture->blocks);
   free(texture);
 }
 
@@ -1084,6 +954,10 @@ static float cpu_frame_gpu_time_ms(MopRhiDevice *device) {
   return 0.0f;
 }
 
+static void cpu_meshlet_stats(MopRhiDevice *device, MopRhiMeshletStats *out) {
+  *out = device->meshlet_stats;
+}
+
 static void cpu_set_exposure(MopRhiDevice *device, float exposure) {
   (void)device;
   (void)exposure;
@@ -1289,6 +1163,253 @@ static void cpu_draw_overlays(MopRhiDevice *dev, MopRhiFramebuffer *fb,
   }
 }
 
+/* -------------------------------------------------------------------------
+ * Decals
+ *
+ * Deferred and screen-space, as mop_decal.frag: each pixel's world
+ * position is rebuilt from the depth buffer and tested against the decal
+ * boxes.  Boxes are projected to pixel bounds and binned into tiles
+ * first, so a pixel only visits the decals whose bounds cover its tile
+ * and the cost follows the covered area, not the decal count.
+ * ------------------------------------------------------------------------- */
+
+#define CPU_DECAL_TILE 32          /* binning granularity, pixels */
+#define CPU_DECAL_FAR_DEPTH 0.9999f /* beyond: background, never decaled */
+
+static int32_t cpu_add_decal(MopRhiDevice *dev, const float *transform,
+                             float opacity, int32_t texture_idx) {
+  for (int32_t i = 0; i < MOP_MAX_DECALS; i++) {
+    MopCpuDecal *d = &dev->decals[i];
+    if (d->active)
+      continue;
+    memset(d, 0, sizeof(*d));
+    d->active = true;
+    memcpy(d->model.d, transform, sizeof(d->model.d));
+    d->inv_model = mop_mat4_inverse(d->model);
+    d->opacity = opacity;
+    d->texture_idx = texture_idx;
+    dev->decal_count++;
+    return i;
+  }
+  return -1;
+}
+
+static void cpu_remove_decal(MopRhiDevice *dev, int32_t decal_id) {
+  if (decal_id < 0 || decal_id >= MOP_MAX_DECALS)
+    return;
+  if (dev->decals[decal_id].active) {
+    dev->decals[decal_id].active = false;
+    dev->decal_count--;
+  }
+}
+
+static void cpu_clear_decals(MopRhiDevice *dev) {
+  for (int i = 0; i < MOP_MAX_DECALS; i++)
+    dev->decals[i].active = false;
+  dev->decal_count = 0;
+}
+
+/* Pixel bounds of the decal box; the whole framebuffer if a corner is
+ * behind the eye.  Returns false if the box is off screen. */
+static bool cpu_decal_bounds(MopCpuDecal *d, const MopMat4 *view_proj,
+                             int w, int h) {
+  MopMat4 mvp;
+  mop_m4_mul(view_proj, &d->model, &mvp);
+  float lo_x = 1e30f, lo_y = 1e30f, hi_x = -1e30f, hi_y = -1e30f;
+  bool behind = false;
+  for (int i = 0; i < 8; i++) {
+    MopVec4 o = mop_m4_mul_xyzw(&mvp, (i & 1) ? 0.5f : -0.5f,
+                                (i & 2) ? 0.5f : -0.5f,
+                                (i & 4) ? 0.5f : -0.5f, 1.0f);
+    if (o.w <= 1e-6f) {
+      behind = true;
+      break;
+    }
+    float sx = (o.x / o.w * 0.5f + 0.5f) * (float)w;
+    float sy = (0.5f - o.y / o.w * 0.5f) * (float)h;
+    lo_x = fminf(lo_x, sx);
+    hi_x = fmaxf(hi_x, sx);
+    lo_y = fminf(lo_y, sy);
+    hi_y = fmaxf(hi_y, sy);
+  }
+  if (behind) {
+    d->x0 = d->y0 = 0;
+    d->x1 = w;
+    d->y1 = h;
+    return true;
+  }
+  d->x0 = lo_x > 0.0f ? (int)lo_x : 0;
+  d->y0 = lo_y > 0.0f ? (int)lo_y : 0;
+  d->x1 = hi_x < (float)w ? (int)hi_x + 1 : w;
+  d->y1 = hi_y < (float)h ? (int)hi_y + 1 : h;
+  return d->x0 < d->x1 && d->y0 < d->y1;
+}
+
+typedef struct CpuDecalCtx {
+  const MopRhiDevice *dev;
+  MopSwFramebuffer *fb;
+  MopMat4 inv_vp;
+  int tiles_x;
+  const uint32_t *start; /* tile t: list[start[t] .. start[t + 1]) */
+  const uint32_t *list;  /* decal slots, ascending per tile */
+} CpuDecalCtx;
+
+static float cpu_decal_fade(float a) {
+  float t = (fabsf(a) - 0.4f) * 10.0f; /* smoothstep(0.4, 0.5, |a|) */
+  t = t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t);
+  return 1.0f - t * t * (3.0f - 2.0f * t);
+}
+
+/* Bilinear, clamped to the edge */
+static void cpu_decal_sample(const MopRhiDevice *dev, int32_t idx, float u,
+                             float v, float out[4]) {
+  const MopRhiTexture *tex = NULL;
+  if (idx >= 2 && (uint32_t)(idx - 2) < dev->texture_count)
+    tex = dev->textures[idx - 2];
+  if (!tex || (!tex->data && !tex->blocks && !tex->hdr_data)) {
+    float c = idx == 1 ? 0.0f : 1.0f; /* black, else the white fallback */
+    out[0] = out[1] = out[2] = c;
+    out[3] = 1.0f;
+    return;
+  }
+  cpu_tex_bilinear(tex, u, v, false, out);
+}
+
+static void cpu_decal_tile_row(void *ctx_ptr, int ty) {
+  const CpuDecalCtx *c = (const CpuDecalCtx *)ctx_ptr;
+  MopSwFramebuffer *fb = c->fb;
+  int w = fb->width, h = fb->height;
+  const float *m = c->inv_vp.d;
+  for (int tx = 0; tx < c->tiles_x; tx++) {
+    size_t t = (size_t)ty * c->tiles_x + tx;
+    uint32_t first = c->start[t], end = c->start[t + 1];
+    if (first == end)
+      continue;
+    int px0 = tx * CPU_DECAL_TILE, py0 = ty * CPU_DECAL_TILE;
+    int px1 = px0 + CPU_DECAL_TILE < w ? px0 + CPU_DECAL_TILE : w;
+    int py1 = py0 + CPU_DECAL_TILE < h ? py0 + CPU_DECAL_TILE : h;
+    for (int y = py0; y < py1; y++) {
+      float ny = 1.0f - ((float)y + 0.5f) * 2.0f / (float)h;
+      for (int x = px0; x < px1; x++) {
+        size_t idx = (size_t)y * w + x;
+        float depth = fb->depth[idx];
+        if (depth > CPU_DECAL_FAR_DEPTH)
+          continue;
+        float nx = ((float)x + 0.5f) * 2.0f / (float)w - 1.0f;
+        float nz = depth * 2.0f - 1.0f;
+        float iw = 1.0f / (m[3] * nx + m[7] * ny + m[11] * nz + m[15]);
+        float wp[3];
+        for (int r = 0; r < 3; r++)
+          wp[r] = (m[r] * nx + m[4 + r] * ny + m[8 + r] * nz + m[12 + r]) * iw;
+
+        float *hdr = fb->color_hdr + idx * 4;
+        for (uint32_t k = first; k < end; k++) {
+          const MopCpuDecal *d = &c->dev->decals[c->list[k]];
+          if (x < d->x0 || x >= d->x1 || y < d->y0 || y >= d->y1)
+            continue;
+          const float *im = d->inv_model.d;
+          float l[3];
+          for (int r = 0; r < 3; r++)
+            l[r] = im[r] * wp[0] + im[4 + r] * wp[1] + im[8 + r] * wp[2] +
+                   im[12 + r];
+          if (fabsf(l[0]) > 0.5f || fabsf(l[1]) > 0.5f || fabsf(l[2]) > 0.5f)
+            continue;
+          float s[4];
+          cpu_decal_sample(c->dev, d->texture_idx, l[0] + 0.5f, l[1] + 0.5f,
+                           s);
+          float a = s[3] * d->opacity * cpu_decal_fade(l[0]) *
+                    cpu_decal_fade(l[1]) * cpu_decal_fade(l[2]);
+          if (a <= 0.0f)
+            continue;
+          for (int i = 0; i < 3; i++)
+            hdr[i] += (s[i] - hdr[i]) * a;
+        }
+      }
+    }
+  }
+}
+
+/* Decals blend into the HDR color; the RGBA8 buffer is rebuilt from it
+ * by the HDR resolve at frame end. */
+static void cpu_draw_decals(MopRhiDevice *dev, MopRhiFramebuffer *fb,
+                            const float *view_proj, MopThreadPool *pool) {
+  MopSwFramebuffer *sw = &fb->fb;
+  if (dev->decal_count == 0 || !sw->color_hdr || !sw->depth)
+    return;
+  int w = sw->width, h = sw->height;
+  int tiles_x = (w + CPU_DECAL_TILE - 1) / CPU_DECAL_TILE;
+  int tiles_y = (h + CPU_DECAL_TILE - 1) / CPU_DECAL_TILE;
+  size_t tiles = (size_t)tiles_x * tiles_y;
+
+  MopMat4 vp;
+  memcpy(vp.d, view_proj, sizeof(vp.d));
+
+  /* Bounds and tile coverage, then one counting-sort pass into per-tile
+   * lists (slots stay ascending, so decals blend in ID order) */
+  size_t entries = 0;
+  for (int i = 0; i < MOP_MAX_DECALS; i++) {
+    MopCpuDecal *d = &dev->decals[i];
+    if (!d->active)
+      continue;
+    if (!cpu_decal_bounds(d, &vp, w, h)) {
+      d->x1 = d->x0; /* empty: skipped below */
+      continue;
+    }
+    entries += (size_t)((d->x1 - 1) / CPU_DECAL_TILE -
+                        d->x0 / CPU_DECAL_TILE + 1) *
+               (size_t)((d->y1 - 1) / CPU_DECAL_TILE -
+                        d->y0 / CPU_DECAL_TILE + 1);
+  }
+  if (entries == 0)
+    return;
+
+  size_t need = tiles + 1 + entries;
+  if (need > dev->decal_bins_capacity) {
+    uint32_t *bins = realloc(dev->decal_bins, need * sizeof(uint32_t));
+    if (!bins) {
+      MOP_WARN("decals: out of memory for %zu tile entries, skipped",
+               entries);
+      return;
+    }
+    dev->decal_bins = bins;
+    dev->decal_bins_capacity = need;
+  }
+  uint32_t *start = dev->decal_bins, *list = start + tiles + 1;
+  memset(start, 0, (tiles + 1) * sizeof(uint32_t));
+
+  for (int pass = 0; pass < 2; pass++) {
+    for (uint32_t i = 0; i < MOP_MAX_DECALS; i++) {
+      const MopCpuDecal *d = &dev->decals[i];
+      if (!d->active || d->x1 <= d->x0)
+        continue;
+      for (int ty = d->y0 / CPU_DECAL_TILE;
+           ty <= (d->y1 - 1) / CPU_DECAL_TILE; ty++)
+        for (int tx = d->x0 / CPU_DECAL_TILE;
+             tx <= (d->x1 - 1) / CPU_DECAL_TILE; tx++) {
+          size_t t = (size_t)ty * tiles_x + tx;
+          if (pass == 0)
+            start[t + 1]++;
+          else
+            list[start[t]++] = i;
+        }
+    }
+    if (pass == 0)
+      for (size_t t = 0; t < tiles; t++)
+        start[t + 1] += start[t];
+  }
+  /* The fill advanced each start to the next tile's; shift back */
+  memmove(start + 1, start, tiles * sizeof(uint32_t));
+  start[0] = 0;
+
+  CpuDecalCtx ctx = {.dev = dev,
+                     .fb = sw,
+                     .inv_vp = mop_mat4_inverse(vp),
+                     .tiles_x = tiles_x,
+                     .start = start,
+                     .list = list};
+  mop_threadpool_parallel_rows(pool, tiles_y, cpu_decal_tile_row, &ctx);
+}
+
 /* -------------------------------------------------------------------------
  * Backend function table
  * ------------------------------------------------------------------------- */
@@ -1315,19 +1436,21 @@ static const MopRhiBackend CPU_BACKEND = {
     .texture_create = cpu_texture_create,
     .texture_create_hdr = cpu_texture_create_hdr,
     .texture_create_ex = cpu_texture_create_ex,
+    .texture_create_shared = cpu_texture_create_shared,
     .texture_destroy = cpu_texture_destroy,
     .draw_instanced = cpu_draw_instanced,
     .buffer_update = cpu_buffer_update,
     .buffer_read = cpu_buffer_read,
     .frame_gpu_time_ms = cpu_frame_gpu_time_ms,
     .set_exposure = cpu_set_exposure,
-    .set_bloom = NULL,      /* bloom is GPU-only */
-    .set_ssao = NULL,       /* SSAO is GPU-only */
+    .set_bloom = NULL,      /* CPU bloom is a viewport pass (render/bloom.c) */
+    .set_ssao = NULL,       /* CPU SSAO is a viewport pass (render/ssao.c) */
     .set_ssr = NULL,        /* SSR is GPU-only */
-    .set_oit = NULL,        /* OIT is GPU-only */
-    .add_decal = NULL,      /* decals are GPU-only */
-    .remove_decal = NULL,   /* decals are GPU-only */
-    .clear_decals = NULL,   /* decals are GPU-only */
+    .set_oit = NULL,        /* CPU OIT is a viewport pass */
+    .add_decal = cpu_add_decal,
+    .remove_decal = cpu_remove_decal,
+    .clear_decals = cpu_clear_decals,
+    .draw_decals = cpu_draw_decals,
     .set_volumetric = NULL, /* volumetric fog is GPU-only */
     .set_ibl_textures = cpu_set_ibl_textures,
     .draw_skybox = cpu_draw_skybox,
@@ -1338,6 +1461,7 @@ static const MopRhiBackend CPU_BACKEND = {
     .texture_read_rgba8 = cpu_texture_read_rgba8,
     .set_gpu_driven_rendering =
         NULL, /* CPU backend doesn't use indirect draw */
+    .meshlet_stats = cpu_meshlet_stats,
 };
 
 const MopRhiBackend *mop_rhi_backend_cpu(void) { return &CPU_BACKEND; }
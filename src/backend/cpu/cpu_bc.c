@@ -0,0 +1,402 @@
+/*
+ * Master of Puppets — CPU Backend
+ * cpu_bc.c — On-demand BC1/BC3/BC5/BC7 block decoding for the CPU sampler
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "backend/cpu/cpu_bc.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <string.h>
+
+/* -------------------------------------------------------------------------
+ * BC1 / BC4 / BC3 / BC5
+ * ------------------------------------------------------------------------- */
+
+/* Decode RGB565 to R8G8B8 */
+static void bc_decode_rgb565(uint16_t c, uint8_t out[3]) {
+  out[0] = (uint8_t)(((c >> 11) & 0x1F) * 255 / 31);
+  out[1] = (uint8_t)(((c >> 5) & 0x3F) * 255 / 63);
+  out[2] = (uint8_t)((c & 0x1F) * 255 / 31);
+}
+
+/* Decode a BC1 (DXT1) 4x4 block (8 bytes) into 16 RGBA pixels */
+static void bc1_decode_block(const uint8_t *src, uint8_t *dst) {
+  uint16_t c0 = (uint16_t)(src[0] | (src[1] << 8));
+  uint16_t c1 = (uint16_t)(src[2] | (src[3] << 8));
+  uint32_t lut =
+      (uint32_t)(src[4] | (src[5] << 8) | (src[6] << 16) | (src[7] << 24));
+
+  uint8_t color[4][4]; /* [index][RGBA] */
+  bc_decode_rgb565(c0, color[0]);
+  color[0][3] = 255;
+  bc_decode_rgb565(c1, color[1]);
+  color[1][3] = 255;
+
+  if (c0 > c1) {
+    for (int i = 0; i < 3; i++) {
+      color[2][i] = (uint8_t)((2 * color[0][i] + color[1][i] + 1) / 3);
+      color[3][i] = (uint8_t)((color[0][i] + 2 * color[1][i] + 1) / 3);
+    }
+    color[2][3] = 255;
+    color[3][3] = 255;
+  } else {
+    for (int i = 0; i < 3; i++)
+      color[2][i] = (uint8_t)((color[0][i] + color[1][i]) / 2);
+    color[2][3] = 255;
+    color[3][0] = 0;
+    color[3][1] = 0;
+    color[3][2] = 0;
+    color[3][3] = 0; /* transparent black */
+  }
+
+  for (int i = 0; i < 16; i++)
+    memcpy(dst + i * 4, color[(lut >> (i * 2)) & 3], 4);
+}
+
+/* Decode a BC4 channel block (8 bytes) into one channel of 16 pixels */
+static void bc4_decode_block(const uint8_t *src, uint8_t *dst,
+                             int channel_offset) {
+  uint8_t a0 = src[0];
+  uint8_t a1 = src[1];
+
+  /* 48-bit index table (6 bytes, 3 bits per texel) */
+  uint64_t bits = 0;
+  for (int i = 0; i < 6; i++)
+    bits |= (uint64_t)src[2 + i] << (i * 8);
+
+  uint8_t palette[8];
+  palette[0] = a0;
+  palette[1] = a1;
+  if (a0 > a1) {
+    for (int i = 1; i <= 6; i++)
+      palette[1 + i] = (uint8_t)(((7 - i) * a0 + i * a1 + 3) / 7);
+  } else {
+    for (int i = 1; i <= 4; i++)
+      palette[1 + i] = (uint8_t)(((5 - i) * a0 + i * a1 + 2) / 5);
+    palette[6] = 0;
+    palette[7] = 255;
+  }
+
+  for (int i = 0; i < 16; i++)
+    dst[i * 4 + channel_offset] = palette[(bits >> (i * 3)) & 7];
+}
+
+/* Decode a BC3 (DXT5) 4x4 block (16 bytes) into 16 RGBA pixels */
+static void bc3_decode_block(const uint8_t *src, uint8_t *dst) {
+  /* First 8 bytes: alpha (BC4 format) */
+  /* Last 8 bytes: color (BC1/DXT1 format) */
+  bc1_decode_block(src + 8, dst);
+  bc4_decode_block(src, dst, 3); /* alpha channel */
+}
+
+/* Decode a BC5 4x4 block (16 bytes) into 16 RGBA pixels (R,G channels) */
+static void bc5_decode_block(const uint8_t *src, uint8_t *dst) {
+  /* Initialize output to (0, 0, 0, 255) */
+  for (int i = 0; i < 16; i++) {
+    dst[i * 4 + 2] = 0;
+    dst[i * 4 + 3] = 255;
+  }
+  bc4_decode_block(src, dst, 0);     /* red channel */
+  bc4_decode_block(src + 8, dst, 1); /* green channel */
+}
+
+/* -------------------------------------------------------------------------
+ * BC7
+ *
+ * Eight modes trading subsets, endpoint precision and index precision.
+ * Reference: Khronos Data Format Specification, "BC7".
+ * ------------------------------------------------------------------------- */
+
+typedef struct Bc7Mode {
+  uint8_t subsets;        /* 1..3 */
+  uint8_t partition_bits; /* partition-table selector width */
+  uint8_t rotation_bits;  /* channel rotation (modes 4, 5) */
+  uint8_t isb_bits;       /* index selection bit (mode 4) */
+  uint8_t color_bits;     /* per-channel endpoint precision */
+  uint8_t alpha_bits;     /* 0 = opaque */
+  uint8_t endpoint_pbits; /* one P-bit per endpoint */
+  uint8_t shared_pbits;   /* one P-bit per subset */
+  uint8_t index_bits;     /* primary index width */
+  uint8_t index2_bits;    /* secondary index width (modes 4, 5) */
+} Bc7Mode;
+
+static const Bc7Mode k_bc7_modes[8] = {
+    {3, 4, 0, 0, 4, 0, 1, 0, 3, 0}, {2, 6, 0, 0, 6, 0, 0, 1, 3, 0},
+    {3, 6, 0, 0, 5, 0, 0, 0, 2, 0}, {2, 6, 0, 0, 7, 0, 1, 0, 2, 0},
+    {1, 0, 2, 1, 5, 6, 0, 0, 2, 3}, {1, 0, 2, 0, 7, 8, 0, 0, 2, 2},
+    {1, 0, 0, 0, 7, 7, 1, 0, 4, 0}, {2, 6, 0, 0, 5, 5, 1, 0, 2, 0},
+};
+
+/* Two-subset partitions: bit i set = texel i belongs to subset 1 */
+static const uint16_t k_bc7_partition2[64] = {
+    0xCCCC, 0x8888, 0xEEEE, 0xECC8, 0xC880, 0xFEEC, 0xFEC8, 0xEC80,
+    0xC800, 0xFFEC, 0xFE80, 0xE800, 0xFFE8, 0xFF00, 0xFFF0, 0xF000,
+    0xF710, 0x008E, 0x7100, 0x08CE, 0x008C, 0x7310, 0x3100, 0x8CCE,
+    0x088C, 0x3110, 0x6666, 0x366C, 0x17E8, 0x0FF0, 0x718E, 0x399C,
+    0xAAAA, 0xF0F0, 0x5A5A, 0x33CC, 0x3C3C, 0x55AA, 0x9696, 0xA55A,
+    0x73CE, 0x13C8, 0x324C, 0x3BDC, 0x6996, 0xC33C, 0x9966, 0x0660,
+    0x0272, 0x04E4, 0x4E40, 0x2720, 0xC936, 0x936C, 0x39C6, 0x639C,
+    0x9336, 0x9CC6, 0x817E, 0xE718, 0xCCF0, 0x0FCC, 0x7744, 0xEE22,
+};
+
+/* Three-subset partitions: 2 bits per texel, texel 0 in the low bits */
+static const uint32_t k_bc7_partition3[64] = {
+    0xAA685050, 0x6A5A5040, 0x5A5A4200, 0x5450A0A8, 0xA5A50000, 0xA0A05050,
+    0x5555A0A0, 0x5A5A5050, 0xAA550000, 0xAA555500, 0xAAAA5500, 0x90909090,
+    0x94949494, 0xA4A4A4A4, 0xA9A59450, 0x2A0A4250, 0xA5945040, 0x0A425054,
+    0xA5A5A500, 0x55A0A0A0, 0xA8A85454, 0x6A6A4040, 0xA4A45000, 0x1A1A0500,
+    0x0050A4A4, 0xAAA59090, 0x14696914, 0x69691400, 0xA08585A0, 0xAA821414,
+    0x50A4A450, 0x6A5A0200, 0xA9A58000, 0x5090A0A8, 0xA8A09050, 0x24242424,
+    0x00AA5500, 0x24924924, 0x24499224, 0x50A50A50, 0x500AA550, 0xAAAA4444,
+    0x66660000, 0xA5A0A5A0, 0x50A050A0, 0x69286928, 0x44AAAA44, 0x66666600,
+    0xAA444444, 0x54A854A8, 0x95809580, 0x96969600, 0xA85454A8, 0x80959580,
+    0xAA141414, 0x96960000, 0xAAAA1414, 0xA05050A0, 0xA0A5A5A0, 0x96000000,
+    0x40804080, 0xA9A8A9A8, 0xAAAAAA44, 0x2A4A5254,
+};
+
+/* Anchor (implicit high bit) texel of subset 1 for two-subset modes */
+static const uint8_t k_bc7_anchor2[64] = {
+    15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+    15, 2,  8,  2,  2,  8,  8,  15, 2,  8,  2,  2,  8,  8,  2,  2,
+    15, 15, 6,  8,  2,  8,  15, 15, 2,  8,  2,  2,  2,  15, 15, 6,
+    6,  2,  6,  8,  15, 15, 2,  2,  15, 15, 15, 15, 15, 2,  2,  15,
+};
+
+/* Anchor texels of subsets 1 and 2 for three-subset modes */
+static const uint8_t k_bc7_anchor3a[64] = {
+    3,  3,  15, 15, 8,  3,  15, 15, 8,  8,  6,  6,  6,  5,  3,  3,
+    3,  3,  8,  15, 3,  3,  6,  10, 5,  8,  8,  6,  8,  5,  15, 15,
+    8,  15, 3,  5,  6,  10, 8,  15, 15, 3,  15, 5,  15, 15, 15, 15,
+    3,  15, 5,  5,  5,  8,  5,  10, 5,  10, 8,  13, 15, 12, 3,  3,
+};
+static const uint8_t k_bc7_anchor3b[64] = {
+    15, 8,  8,  3,  15, 15, 3,  8,  15, 15, 15, 15, 15, 15, 15, 8,
+    15, 8,  15, 3,  15, 8,  15, 8,  3,  15, 6,  10, 15, 15, 10, 8,
+    15, 3,  15, 10, 10, 8,  9,  10, 6,  15, 8,  15, 3,  6,  6,  8,
+    15, 3,  15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 3,  15, 15, 8,
+};
+
+static const uint8_t k_bc7_weights2[4] = {0, 21, 43, 64};
+static const uint8_t k_bc7_weights3[8] = {0, 9, 18, 27, 37, 46, 55, 64};
+static const uint8_t k_bc7_weights4[16] = {0,  4,  9,  13, 17, 21, 26, 30,
+                                           34, 38, 43, 47, 51, 55, 60, 64};
+
+typedef struct Bc7Bits {
+  const uint8_t *data;
+  uint32_t pos;
+} Bc7Bits;
+
+static uint32_t bc7_read(Bc7Bits *b, uint32_t count) {
+  uint32_t v = 0;
+  for (uint32_t i = 0; i < count; i++, b->pos++)
+    v |= (uint32_t)((b->data[b->pos >> 3] >> (b->pos & 7)) & 1) << i;
+  return v;
+}
+
+static const uint8_t *bc7_weights(uint32_t bits) {
+  return bits == 2 ? k_bc7_weights2
+         : bits == 3 ? k_bc7_weights3
+                     : k_bc7_weights4;
+}
+
+/* Expand an n-bit endpoint component to 8 bits by bit replication */
+static uint8_t bc7_unquantize(uint32_t v, uint32_t n) {
+  v <<= 8 - n;
+  return (uint8_t)(v | (v >> n));
+}
+
+static void bc7_decode_block(const uint8_t *src, uint8_t *dst) {
+  uint32_t mode = 0;
+  while (mode < 8 && !(src[0] & (1u << mode)))
+    mode++;
+  if (mode == 8) {
+    /* Reserved encoding: the spec mandates transparent black */
+    memset(dst, 0, 64);
+    return;
+  }
+
+  const Bc7Mode *m = &k_bc7_modes[mode];
+  Bc7Bits bits = {src, mode + 1};
+  uint32_t partition = bc7_read(&bits, m->partition_bits);
+  uint32_t rotation = bc7_read(&bits, m->rotation_bits);
+  uint32_t isb = bc7_read(&bits, m->isb_bits);
+
+  /* Endpoints: [subset * 2 + end][channel], all R, then G, B, A */
+  uint32_t ns = m->subsets;
+  uint32_t ep[6][4];
+  for (uint32_t c = 0; c < 3; c++)
+    for (uint32_t e = 0; e < ns * 2; e++)
+      ep[e][c] = bc7_read(&bits, m->color_bits);
+  for (uint32_t e = 0; e < ns * 2; e++)
+    ep[e][3] = m->alpha_bits ? bc7_read(&bits, m->alpha_bits) : 255;
+
+  uint32_t cbits = m->color_bits, abits = m->alpha_bits;
+  if (m->endpoint_pbits || m->shared_pbits) {
+    uint32_t pbit[6];
+    if (m->endpoint_pbits) {
+      for (uint32_t e = 0; e < ns * 2; e++)
+        pbit[e] = bc7_read(&bits, 1);
+    } else {
+      for (uint32_t s = 0; s < ns; s++)
+        pbit[s * 2] = pbit[s * 2 + 1] = bc7_read(&bits, 1);
+    }
+    for (uint32_t e = 0; e < ns * 2; e++) {
+      for (uint32_t c = 0; c < 3; c++)
+        ep[e][c] = (ep[e][c] << 1) | pbit[e];
+      if (abits)
+        ep[e][3] = (ep[e][3] << 1) | pbit[e];
+    }
+    cbits++;
+    if (abits)
+      abits++;
+  }
+  for (uint32_t e = 0; e < ns * 2; e++) {
+    for (uint32_t c = 0; c < 3; c++)
+      ep[e][c] = bc7_unquantize(ep[e][c], cbits);
+    if (abits)
+      ep[e][3] = bc7_unquantize(ep[e][3], abits);
+  }
+
+  /* Per-texel subset and anchor texels (whose index MSB is implicit) */
+  uint8_t subset[16];
+  uint32_t anchor[3] = {0, 0, 0};
+  for (uint32_t i = 0; i < 16; i++) {
+    if (ns == 2)
+      subset[i] = (uint8_t)((k_bc7_partition2[partition] >> i) & 1);
+    else if (ns == 3)
+      subset[i] = (uint8_t)((k_bc7_partition3[partition] >> (i * 2)) & 3);
+    else
+      subset[i] = 0;
+  }
+  if (ns == 2) {
+    anchor[1] = k_bc7_anchor2[partition];
+  } else if (ns == 3) {
+    anchor[1] = k_bc7_anchor3a[partition];
+    anchor[2] = k_bc7_anchor3b[partition];
+  }
+
+  uint8_t idx[16], idx2[16];
+  for (uint32_t i = 0; i < 16; i++) {
+    bool is_anchor = i == anchor[subset[i]];
+    idx[i] = (uint8_t)bc7_read(&bits, m->index_bits - (is_anchor ? 1 : 0));
+  }
+  if (m->index2_bits) {
+    for (uint32_t i = 0; i < 16; i++)
+      idx2[i] = (uint8_t)bc7_read(&bits, m->index2_bits - (i == 0 ? 1 : 0));
+  }
+
+  /* Modes 4/5 carry a second index set; mode 4's ISB swaps which one
+   * drives color and which drives alpha. */
+  const uint8_t *w_color = bc7_weights(m->index_bits);
+  const uint8_t *w_alpha = w_color;
+  const uint8_t *ci = idx, *ai = idx;
+  if (m->index2_bits) {
+    const uint8_t *w2 = bc7_weights(m->index2_bits);
+    if (isb) {
+      ci = idx2;
+      w_alpha = w_color;
+      w_color = w2;
+    } else {
+      ai = idx2;
+      w_alpha = w2;
+    }
+  }
+
+  for (uint32_t i = 0; i < 16; i++) {
+    const uint32_t *e0 = ep[subset[i] * 2];
+    const uint32_t *e1 = ep[subset[i] * 2 + 1];
+    uint32_t wc = w_color[ci[i]], wa = w_alpha[ai[i]];
+    uint8_t *p = dst + i * 4;
+    for (uint32_t c = 0; c < 3; c++)
+      p[c] = (uint8_t)(((64 - wc) * e0[c] + wc * e1[c] + 32) >> 6);
+    p[3] = (uint8_t)(((64 - wa) * e0[3] + wa * e1[3] + 32) >> 6);
+    if (rotation) {
+      uint8_t t = p[3];
+      p[3] = p[rotation - 1];
+      p[rotation - 1] = t;
+    }
+  }
+}
+
+/* -------------------------------------------------------------------------
+ * Public entry points
+ * ------------------------------------------------------------------------- */
+
+size_t mop_cpu_bc_block_bytes(int format) {
+  switch (format) {
+  case 1:
+    return 8;
+  case 2:
+  case 3:
+  case 4:
+    return 16;
+  default:
+    return 0;
+  }
+}
+
+void mop_cpu_bc_decode_block(int format, const uint8_t *block,
+                             uint8_t out[64]) {
+  switch (format) {
+  case 1: /* BC1 */
+    bc1_decode_block(block, out);
+    break;
+  case 2: /* BC3 */
+    bc3_decode_block(block, out);
+    break;
+  case 3: /* BC5 */
+    bc5_decode_block(block, out);
+    break;
+  case 4: /* BC7 */
+    bc7_decode_block(block, out);
+    break;
+  default:
+    memset(out, 0, 64);
+    break;
+  }
+}
+
+static atomic_uint s_next_uid = 1;
+
+uint32_t mop_cpu_bc_new_uid(void) {
+  uint32_t uid = atomic_fetch_add(&s_next_uid, 1);
+  return uid ? uid : atomic_fetch_add(&s_next_uid, 1); /* skip 0 on wrap */
+}
+
+/* -------------------------------------------------------------------------
+ * Per-thread decoded-block cache
+ *
+ * Direct-mapped, 64 blocks (4 KB of texels) per thread.  Keys pack the
+ * texture uid with the block index; 0 never occurs because uids start
+ * at 1, so a zeroed cache is empty.
+ * ------------------------------------------------------------------------- */
+
+#define BC_CACHE_SLOTS 64
+
+typedef struct BcCacheSlot {
+  uint64_t key;
+  uint8_t texels[64];
+} BcCacheSlot;
+
+static _Thread_local BcCacheSlot s_bc_cache[BC_CACHE_SLOTS];
+
+void mop_cpu_bc_fetch(const uint8_t *blocks, int format, int blocks_x,
+                      uint32_t uid, int x, int y, uint8_t out[4]) {
+  uint32_t block = (uint32_t)(y >> 2) * (uint32_t)blocks_x + (uint32_t)(x >> 2);
+  uint64_t key = (uint64_t)uid << 32 | block;
+
+  /* Neighbouring blocks land in distinct slots; the uid term spreads
+   * textures sampled in the same draw. */
+  uint32_t slot = (block ^ (uid * 0x9E3779B1u)) & (BC_CACHE_SLOTS - 1);
+  BcCacheSlot *s = &s_bc_cache[slot];
+  if (s->key != key) {
+    mop_cpu_bc_decode_block(
+        format, blocks + (size_t)block * mop_cpu_bc_block_bytes(format),
+        s->texels);
+    s->key = key;
+  }
+  memcpy(out, s->texels + ((y & 3) * 4 + (x & 3)) * 4, 4);
+}
@@ -0,0 +1,38 @@
+/*
+ * Master of Puppets — CPU Backend
+ * cpu_bc.h — On-demand BC1/BC3/BC5/BC7 block decoding for the CPU sampler
+ *
+ * Compressed textures stay compressed in RAM.  The sampler fetches a
+ * texel by decoding its 4x4 block into a small per-thread cache of
+ * recently decoded blocks, so neighbouring fetches (same triangle,
+ * same tile) decode each block once.
+ *
+ * Formats use MopTexFormat values: 1 = BC1, 2 = BC3, 3 = BC5, 4 = BC7.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef MOP_CPU_BC_H
+#define MOP_CPU_BC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Bytes per 4x4 block (8 for BC1, 16 for BC3/BC5/BC7, 0 if unknown) */
+size_t mop_cpu_bc_block_bytes(int format);
+
+/* Decode one block into 16 RGBA8 texels, row-major (64 bytes). */
+void mop_cpu_bc_decode_block(int format, const uint8_t *block,
+                             uint8_t out[64]);
+
+/* Allocate a texture id for block cache keys.  Ids are never reused, so
+ * a freed texture's cached blocks can never alias a new texture's. */
+uint32_t mop_cpu_bc_new_uid(void);
+
+/* Fetch texel (x, y) of a block-compressed image whose rows are
+ * `blocks_x` blocks wide.  Decodes through the calling thread's block
+ * cache.  No bounds checking — the caller clamps x/y. */
+void mop_cpu_bc_fetch(const uint8_t *blocks, int format, int blocks_x,
+                      uint32_t uid, int x, int y, uint8_t out[4]);
+
+#endif /* MOP_CPU_BC_H */
@@ -0,0 +1,291 @@
+/*
+ * Master of Puppets — CPU Backend
+ * cpu_meshlet.c — Meshlet frustum, normal-cone and depth-pyramid culling
+ *
+ * All tests run in the mesh's object space so bounding spheres and cones
+ * are used as built: frustum planes come straight from the MVP rows, and
+ * the camera is moved into object space once per draw.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "backend/cpu/cpu_meshlet.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#define M(mat, r, c) ((mat).d[(c) * 4 + (r)])
+
+/* -------------------------------------------------------------------------
+ * Depth pyramid
+ * ------------------------------------------------------------------------- */
+
+bool mop_cpu_hiz_build(MopCpuHiZ *hiz, const float *depth, int width,
+                       int height) {
+  hiz->level_count = 0;
+  if (!depth || width <= 0 || height <= 0)
+    return false;
+
+  /* Level sizes: ceil(fb / TILE), then ceil-halved down to 1x1 */
+  int w = (width + MOP_CPU_HIZ_TILE - 1) / MOP_CPU_HIZ_TILE;
+  int h = (height + MOP_CPU_HIZ_TILE - 1) / MOP_CPU_HIZ_TILE;
+  size_t total = 0;
+  int levels = 0;
+  for (;;) {
+    hiz->width[levels] = w;
+    hiz->height[levels] = h;
+    hiz->offset[levels] = total;
+    total += (size_t)w * (size_t)h;
+    levels++;
+    if ((w == 1 && h == 1) || levels == MOP_CPU_HIZ_MAX_LEVELS)
+      break;
+    w = (w + 1) / 2;
+    h = (h + 1) / 2;
+  }
+
+  if (total > hiz->capacity) {
+    float *grown = realloc(hiz->data, total * sizeof(float));
+    if (!grown)
+      return false;
+    hiz->data = grown;
+    hiz->capacity = total;
+  }
+
+  /* Level 0: farthest depth per tile, one row of tiles at a time */
+  float *l0 = hiz->data;
+  int w0 = hiz->width[0];
+  for (int ty = 0; ty < hiz->height[0]; ty++) {
+    float *row = l0 + (size_t)ty * w0;
+    for (int tx = 0; tx < w0; tx++)
+      row[tx] = 0.0f;
+    int y_end = (ty + 1) * MOP_CPU_HIZ_TILE;
+    if (y_end > height)
+      y_end = height;
+    for (int y = ty * MOP_CPU_HIZ_TILE; y < y_end; y++) {
+      const float *src = depth + (size_t)y * width;
+      for (int tx = 0; tx < w0; tx++) {
+        int x = tx * MOP_CPU_HIZ_TILE;
+        int x_end = (x + MOP_CPU_HIZ_TILE < width) ? x + MOP_CPU_HIZ_TILE
+                                                   : width;
+        float m = row[tx];
+        for (; x < x_end; x++)
+          m = fmaxf(m, src[x]);
+        row[tx] = m;
+      }
+    }
+  }
+
+  /* Coarser levels: max of each 2x2 block, clamped at odd edges */
+  for (int l = 1; l < levels; l++) {
+    const float *src = hiz->data + hiz->offset[l - 1];
+    float *dst = hiz->data + hiz->offset[l];
+    int sw = hiz->width[l - 1], sh = hiz->height[l - 1];
+    for (int y = 0; y < hiz->height[l]; y++) {
+      int y0 = y * 2, y1 = (y * 2 + 1 < sh) ? y * 2 + 1 : y * 2;
+      for (int x = 0; x < hiz->width[l]; x++) {
+        int x0 = x * 2, x1 = (x * 2 + 1 < sw) ? x * 2 + 1 : x * 2;
+        float a = fmaxf(src[y0 * sw + x0], src[y0 * sw + x1]);
+        float b = fmaxf(src[y1 * sw + x0], src[y1 * sw + x1]);
+        dst[y * hiz->width[l] + x] = fmaxf(a, b);
+      }
+    }
+  }
+
+  hiz->level_count = levels;
+  hiz->fb_width = width;
+  hiz->fb_height = height;
+  return true;
+}
+
+void mop_cpu_hiz_free(MopCpuHiZ *hiz) {
+  if (!hiz)
+    return;
+  free(hiz->data);
+  hiz->data = NULL;
+  hiz->capacity = 0;
+  hiz->level_count = 0;
+}
+
+/* Farthest pyramid depth over the pixel rectangle [x0,x1] x [y0,y1].
+ * Picks the finest level at which the rectangle spans at most 4x4
+ * texels, so every lookup reads a bounded number of values. */
+static float hiz_max_depth(const MopCpuHiZ *hiz, int x0, int y0, int x1,
+                           int y1) {
+  int tx0 = x0 / MOP_CPU_HIZ_TILE, tx1 = x1 / MOP_CPU_HIZ_TILE;
+  int ty0 = y0 / MOP_CPU_HIZ_TILE, ty1 = y1 / MOP_CPU_HIZ_TILE;
+  int l = 0;
+  while (l + 1 < hiz->level_count &&
+         ((tx1 >> l) - (tx0 >> l) > 3 || (ty1 >> l) - (ty0 >> l) > 3))
+    l++;
+
+  const float *lv = hiz->data + hiz->offset[l];
+  int lw = hiz->width[l];
+  float zmax = 0.0f;
+  for (int y = ty0 >> l; y <= (ty1 >> l); y++)
+    for (int x = tx0 >> l; x <= (tx1 >> l); x++)
+      zmax = fmaxf(zmax, lv[y * lw + x]);
+  return zmax;
+}
+
+/* -------------------------------------------------------------------------
+ * Per-draw culling setup
+ * ------------------------------------------------------------------------- */
+
+typedef struct CullView {
+  float planes[6][4]; /* object-space frustum planes, unnormalized */
+  float plane_len[6]; /* |plane.xyz|, scales the sphere radius */
+  bool cone;          /* normal-cone test enabled */
+  float eye[3];       /* camera position in object space */
+} CullView;
+
+static void cull_view_init(CullView *cv, const MopRhiDrawCall *call) {
+  /* Gribb-Hartmann: clip-space planes w +- x, w +- y, w +- z pulled back
+   * through the MVP land in object space */
+  for (int p = 0; p < 6; p++) {
+    int axis = p / 2;
+    float sign = (p & 1) ? -1.0f : 1.0f;
+    for (int c = 0; c < 4; c++)
+      cv->planes[p][c] = M(call->mvp, 3, c) + sign * M(call->mvp, axis, c);
+    cv->plane_len[p] = sqrtf(cv->planes[p][0] * cv->planes[p][0] +
+                             cv->planes[p][1] * cv->planes[p][1] +
+                             cv->planes[p][2] * cv->planes[p][2]);
+  }
+
+  /* The cone test is the point-camera backface test, so it needs a
+   * perspective projection.  A mirroring model flips the winding the
+   * rasterizer culls by, which the object-space cones do not model. */
+  const MopMat4 *m = &call->model;
+  float det = M(*m, 0, 0) * (M(*m, 1, 1) * M(*m, 2, 2) -
+                             M(*m, 1, 2) * M(*m, 2, 1)) -
+              M(*m, 0, 1) * (M(*m, 1, 0) * M(*m, 2, 2) -
+                             M(*m, 1, 2) * M(*m, 2, 0)) +
+              M(*m, 0, 2) * (M(*m, 1, 0) * M(*m, 2, 1) -
+                             M(*m, 1, 1) * M(*m, 2, 0));
+  cv->cone = call->backface_cull && !call->wireframe && det > 0.0f &&
+             call->projection.d[15] == 0.0f;
+  if (cv->cone) {
+    MopMat4 inv = mop_mat4_inverse(call->model);
+    MopVec4 e = mop_mat4_mul_vec4(
+        inv, (MopVec4){call->cam_eye.x, call->cam_eye.y, call->cam_eye.z, 1});
+    cv->eye[0] = e.x;
+    cv->eye[1] = e.y;
+    cv->eye[2] = e.z;
+  }
+}
+
+static bool outside_frustum(const CullView *cv, const MopMeshlet *ml) {
+  for (int p = 0; p < 6; p++) {
+    const float *pl = cv->planes[p];
+    float d = pl[0] * ml->center[0] + pl[1] * ml->center[1] +
+              pl[2] * ml->center[2] + pl[3];
+    if (d < -ml->radius * cv->plane_len[p])
+      return true;
+  }
+  return false;
+}
+
+/* Every triangle faces away when the camera sits inside the cone's
+ * "back" region, widened by the bounding sphere since the cone apex is
+ * the sphere center rather than a true apex.  Cones of 90 degrees or
+ * wider (cutoff <= 0) never cull. */
+static bool backfacing(const CullView *cv, const MopMeshlet *ml,
+                       const MopMeshletCone *cone) {
+  if (cone->cutoff <= 0.0f)
+    return false;
+  float v[3] = {ml->center[0] - cv->eye[0], ml->center[1] - cv->eye[1],
+                ml->center[2] - cv->eye[2]};
+  float len = sqrtf(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+  float sin_a = sqrtf(1.0f - cone->cutoff * cone->cutoff);
+  float d = v[0] * cone->axis[0] + v[1] * cone->axis[1] + v[2] * cone->axis[2];
+  return d >= sin_a * len + ml->radius;
+}
+
+/* Project the sphere's bounding cube and compare its nearest depth with
+ * the farthest pyramid depth under its screen rectangle.  Bounds that
+ * reach the near plane are never occluded. */
+static bool occluded(const MopCpuHiZ *hiz, const MopMat4 *mvp,
+                     const MopMeshlet *ml) {
+  float r = ml->radius;
+  MopVec4 cc = mop_mat4_mul_vec4(
+      *mvp, (MopVec4){ml->center[0], ml->center[1], ml->center[2], 1.0f});
+  float c[4] = {cc.x, cc.y, cc.z, cc.w};
+  float ax[3][4];
+  for (int a = 0; a < 3; a++)
+    for (int k = 0; k < 4; k++)
+      ax[a][k] = M(*mvp, k, a) * r;
+
+  float hw = 0.5f * (float)hiz->fb_width, hh = 0.5f * (float)hiz->fb_height;
+  float xmin = INFINITY, xmax = -INFINITY, ymin = INFINITY, ymax = -INFINITY;
+  float zmin = INFINITY;
+  for (int i = 0; i < 8; i++) {
+    float sx = (i & 1) ? 1.0f : -1.0f;
+    float sy = (i & 2) ? 1.0f : -1.0f;
+    float sz = (i & 4) ? 1.0f : -1.0f;
+    float p[4];
+    for (int k = 0; k < 4; k++)
+      p[k] = c[k] + sx * ax[0][k] + sy * ax[1][k] + sz * ax[2][k];
+    if (p[3] <= 1e-6f || p[2] < -p[3])
+      return false;
+    float inv_w = 1.0f / p[3];
+    float px = (p[0] * inv_w + 1.0f) * hw;
+    float py = (1.0f - p[1] * inv_w) * hh;
+    float pz = (p[2] * inv_w + 1.0f) * 0.5f;
+    xmin = fminf(xmin, px);
+    xmax = fmaxf(xmax, px);
+    ymin = fminf(ymin, py);
+    ymax = fmaxf(ymax, py);
+    zmin = fminf(zmin, pz);
+  }
+
+  int x0 = (int)floorf(xmin), x1 = (int)floorf(xmax);
+  int y0 = (int)floorf(ymin), y1 = (int)floorf(ymax);
+  if (x0 < 0)
+    x0 = 0;
+  if (y0 < 0)
+    y0 = 0;
+  if (x1 > hiz->fb_width - 1)
+    x1 = hiz->fb_width - 1;
+  if (y1 > hiz->fb_height - 1)
+    y1 = hiz->fb_height - 1;
+  if (x0 > x1 || y0 > y1)
+    return false; /* off screen — the frustum test's call */
+  return zmin > hiz_max_depth(hiz, x0, y0, x1, y1);
+}
+
+/* -------------------------------------------------------------------------
+ * Meshlet culling
+ * ------------------------------------------------------------------------- */
+
+uint32_t mop_cpu_meshlet_cull(const MopRhiDrawCall *call,
+                              const MopCpuHiZ *hiz, uint32_t *out_indices,
+                              MopRhiMeshletStats *stats) {
+  const MopMeshletData *md = call->meshlets;
+  CullView cv;
+  cull_view_init(&cv, call);
+  if (hiz && hiz->level_count == 0)
+    hiz = NULL;
+
+  uint32_t n = 0;
+  for (uint32_t i = 0; i < md->meshlet_count; i++) {
+    const MopMeshlet *ml = &md->meshlets[i];
+    if (outside_frustum(&cv, ml)) {
+      stats->frustum++;
+      continue;
+    }
+    if (cv.cone && backfacing(&cv, ml, &md->cones[i])) {
+      stats->backface++;
+      continue;
+    }
+    if (hiz && occluded(hiz, &call->mvp, ml)) {
+      stats->occlusion++;
+      continue;
+    }
+    stats->visible++;
+
+    const uint32_t *verts = md->vertex_indices + ml->vertex_offset;
+    const uint8_t *prims = md->prim_indices + ml->triangle_offset;
+    for (uint32_t k = 0; k < ml->triangle_count * 3; k++)
+      out_indices[n++] = verts[prims[k]];
+  }
+  return n;
+}
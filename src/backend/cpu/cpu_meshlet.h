@@ -0,0 +1,57 @@
+/*
+ * Master of Puppets — CPU Backend
+ * cpu_meshlet.h — Meshlet frustum, normal-cone and depth-pyramid culling
+ *
+ * Draw calls that carry meshlets are culled cluster by cluster before any
+ * vertex is transformed.  A meshlet is dropped when its bounding sphere
+ * lies outside the view frustum, when its normal cone faces away from the
+ * camera (backface-culled draws only), or when the nearest point of its
+ * bounds is behind every depth value it covers in a coarse depth pyramid.
+ *
+ * The pyramid stores the farthest depth of each 8x8 pixel tile, then
+ * halves in each direction per level.  Taking the farthest depth keeps
+ * the test conservative: a meshlet is only rejected if it is hidden in
+ * every covered pixel.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef MOP_CPU_MESHLET_H
+#define MOP_CPU_MESHLET_H
+
+#include "rhi/rhi.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define MOP_CPU_HIZ_TILE 8        /* pixels per level-0 texel, each axis */
+#define MOP_CPU_HIZ_MAX_LEVELS 16
+
+typedef struct MopCpuHiZ {
+  float *data;      /* all levels back to back, level 0 first */
+  size_t capacity;  /* floats allocated */
+  int level_count;
+  int width[MOP_CPU_HIZ_MAX_LEVELS];
+  int height[MOP_CPU_HIZ_MAX_LEVELS];
+  size_t offset[MOP_CPU_HIZ_MAX_LEVELS]; /* level start in data */
+  int fb_width;     /* source depth buffer size */
+  int fb_height;
+} MopCpuHiZ;
+
+/* (Re)build the pyramid from a depth buffer.  Returns false on allocation
+ * failure, leaving the pyramid empty (level_count 0). */
+bool mop_cpu_hiz_build(MopCpuHiZ *hiz, const float *depth, int width,
+                       int height);
+
+void mop_cpu_hiz_free(MopCpuHiZ *hiz);
+
+/* Cull call->meshlets and write the global indices of the surviving
+ * triangles to out_indices, which must hold prim_index_count entries.
+ * hiz NULL skips the occlusion test.  Adds the per-meshlet outcome to
+ * stats and returns the number of indices written. */
+uint32_t mop_cpu_meshlet_cull(const MopRhiDrawCall *call,
+                              const MopCpuHiZ *hiz, uint32_t *out_indices,
+                              MopRhiMeshletStats *stats);
+
+#endif /* MOP_CPU_MESHLET_H */
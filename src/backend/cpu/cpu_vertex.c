@@ -0,0 +1,419 @@
+/*
+ * Master of Puppets — CPU Backend
+ * cpu_vertex.c — Vertex stage: format-specialized fetch, batched transform
+ *
+ * Vertices are processed VS_BATCH at a time: each attribute's fetch
+ * routine decodes the batch into component arrays, then one loop
+ * transforms the whole batch.  The transform loop has no per-vertex
+ * branches and writes through restrict pointers, so the compiler
+ * vectorizes it at the target's native width.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "backend/cpu/cpu_vertex.h"
+#include "rasterizer/rasterizer.h"
+
+#include <mop/core/vertex_format.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define VS_BATCH 64
+
+/* -------------------------------------------------------------------------
+ * Attribute fetch
+ *
+ * A fetch routine decodes one attribute of n vertices, given each vertex's
+ * base address, into four component arrays.  Components the attribute
+ * does not carry are filled with (0, 0, 0, 1).
+ * ------------------------------------------------------------------------- */
+
+typedef struct VsFetch VsFetch;
+typedef void (*VsFetchFn)(const VsFetch *f, const uint8_t *const *v,
+                          uint32_t n, float *const out[4]);
+
+struct VsFetch {
+  VsFetchFn fn;
+  uint32_t offset;
+  float scale[3]; /* unorm16x3: p = bias + q * scale */
+  float bias[3];
+  float value[4]; /* absent attribute: constant */
+  const MopVertexFormat *fmt; /* generic fallback */
+  const MopVertexAttrib *attr;
+};
+
+static void fetch_const(const VsFetch *f, const uint8_t *const *v,
+                        uint32_t n, float *const out[4]) {
+  (void)v;
+  for (int c = 0; c < 4; c++)
+    for (uint32_t k = 0; k < n; k++)
+      out[c][k] = f->value[c];
+}
+
+static void fetch_float2(const VsFetch *f, const uint8_t *const *v,
+                         uint32_t n, float *const out[4]) {
+  for (uint32_t k = 0; k < n; k++) {
+    float t[2];
+    memcpy(t, v[k] + f->offset, sizeof(t));
+    out[0][k] = t[0];
+    out[1][k] = t[1];
+    out[2][k] = 0.0f;
+    out[3][k] = 1.0f;
+  }
+}
+
+static void fetch_float3(const VsFetch *f, const uint8_t *const *v,
+                         uint32_t n, float *const out[4]) {
+  for (uint32_t k = 0; k < n; k++) {
+    float t[3];
+    memcpy(t, v[k] + f->offset, sizeof(t));
+    out[0][k] = t[0];
+    out[1][k] = t[1];
+    out[2][k] = t[2];
+    out[3][k] = 1.0f;
+  }
+}
+
+static void fetch_float4(const VsFetch *f, const uint8_t *const *v,
+                         uint32_t n, float *const out[4]) {
+  for (uint32_t k = 0; k < n; k++) {
+    float t[4];
+    memcpy(t, v[k] + f->offset, sizeof(t));
+    out[0][k] = t[0];
+    out[1][k] = t[1];
+    out[2][k] = t[2];
+    out[3][k] = t[3];
+  }
+}
+
+static void fetch_unorm16x2(const VsFetch *f, const uint8_t *const *v,
+                            uint32_t n, float *const out[4]) {
+  for (uint32_t k = 0; k < n; k++) {
+    uint16_t q[2];
+    memcpy(q, v[k] + f->offset, sizeof(q));
+    out[0][k] = (float)q[0] * (1.0f / 65535.0f);
+    out[1][k] = (float)q[1] * (1.0f / 65535.0f);
+    out[2][k] = 0.0f;
+    out[3][k] = 1.0f;
+  }
+}
+
+static void fetch_unorm16x3(const VsFetch *f, const uint8_t *const *v,
+                            uint32_t n, float *const out[4]) {
+  for (uint32_t k = 0; k < n; k++) {
+    uint16_t q[3];
+    memcpy(q, v[k] + f->offset, sizeof(q));
+    for (int c = 0; c < 3; c++)
+      out[c][k] = f->bias[c] + (float)q[c] * (1.0f / 65535.0f) * f->scale[c];
+    out[3][k] = 1.0f;
+  }
+}
+
+static void fetch_unorm8x4(const VsFetch *f, const uint8_t *const *v,
+                           uint32_t n, float *const out[4]) {
+  for (uint32_t k = 0; k < n; k++) {
+    const uint8_t *p = v[k] + f->offset;
+    for (int c = 0; c < 4; c++)
+      out[c][k] = (float)p[c] * (1.0f / 255.0f);
+  }
+}
+
+/* Octahedral, half-float, ubyte4 and scalar attributes are rare enough
+ * that the shared per-vertex decoder is fine */
+static void fetch_generic(const VsFetch *f, const uint8_t *const *v,
+                          uint32_t n, float *const out[4]) {
+  for (uint32_t k = 0; k < n; k++) {
+    float t[4];
+    mop_vertex_attrib_read(f->fmt, f->attr, v[k], t);
+    for (int c = 0; c < 4; c++)
+      out[c][k] = t[c];
+  }
+}
+
+/* Pick the fetch routine for semantic sem.  Returns false if fmt lacks
+ * the attribute, leaving a constant fetch of def. */
+static bool fetch_resolve(const MopVertexFormat *fmt, MopAttribSemantic sem,
+                          const float def[4], VsFetch *f) {
+  memset(f, 0, sizeof(*f));
+  f->fn = fetch_const;
+  memcpy(f->value, def, sizeof(f->value));
+  const MopVertexAttrib *attr = mop_vertex_format_find(fmt, sem);
+  if (!attr)
+    return false;
+
+  f->offset = attr->offset;
+  f->fmt = fmt;
+  f->attr = attr;
+  for (int c = 0; c < 3; c++) {
+    bool pos = sem == MOP_ATTRIB_POSITION;
+    f->scale[c] = pos ? fmt->pos_scale[c] : 1.0f;
+    f->bias[c] = pos ? fmt->pos_offset[c] : 0.0f;
+  }
+  switch (attr->format) {
+  case MOP_FORMAT_FLOAT2:
+    f->fn = fetch_float2;
+    break;
+  case MOP_FORMAT_FLOAT3:
+    f->fn = fetch_float3;
+    break;
+  case MOP_FORMAT_FLOAT4:
+    f->fn = fetch_float4;
+    break;
+  case MOP_FORMAT_UNORM16X2:
+    f->fn = fetch_unorm16x2;
+    break;
+  case MOP_FORMAT_UNORM16X3:
+    f->fn = fetch_unorm16x3;
+    break;
+  case MOP_FORMAT_UNORM8X4:
+    f->fn = fetch_unorm8x4;
+    break;
+  default:
+    f->fn = fetch_generic;
+    break;
+  }
+  return true;
+}
+
+/* -------------------------------------------------------------------------
+ * Batched transform
+ * ------------------------------------------------------------------------- */
+
+static void transform_batch(const MopRhiDrawCall *call,
+                            const float *restrict px, const float *restrict py,
+                            const float *restrict pz, const float *restrict nx,
+                            const float *restrict ny, const float *restrict nz,
+                            uint32_t n, float *const c[MOP_CPU_VS_COMPONENTS],
+                            uint32_t first) {
+  /* Matrices are column-major: row r, column col is d[col * 4 + r] */
+  const float *p = call->mvp.d, *m = call->model.d;
+  const float p0 = p[0], p1 = p[1], p2 = p[2], p3 = p[3];
+  const float p4 = p[4], p5 = p[5], p6 = p[6], p7 = p[7];
+  const float p8 = p[8], p9 = p[9], p10 = p[10], p11 = p[11];
+  const float p12 = p[12], p13 = p[13], p14 = p[14], p15 = p[15];
+  const float m0 = m[0], m1 = m[1], m2 = m[2];
+  const float m4 = m[4], m5 = m[5], m6 = m[6];
+  const float m8 = m[8], m9 = m[9], m10 = m[10];
+  const float m12 = m[12], m13 = m[13], m14 = m[14];
+  const float bias = call->depth_bias;
+
+  float *restrict cx = c[MOP_CPU_VS_CX] + first;
+  float *restrict cy = c[MOP_CPU_VS_CY] + first;
+  float *restrict cz = c[MOP_CPU_VS_CZ] + first;
+  float *restrict cw = c[MOP_CPU_VS_CW] + first;
+  float *restrict wx = c[MOP_CPU_VS_WX] + first;
+  float *restrict wy = c[MOP_CPU_VS_WY] + first;
+  float *restrict wz = c[MOP_CPU_VS_WZ] + first;
+  float *restrict ox = c[MOP_CPU_VS_NX] + first;
+  float *restrict oy = c[MOP_CPU_VS_NY] + first;
+  float *restrict oz = c[MOP_CPU_VS_NZ] + first;
+
+  for (uint32_t k = 0; k < n; k++) {
+    float x = px[k], y = py[k], z = pz[k];
+    float w = p3 * x + p7 * y + p11 * z + p15;
+    cx[k] = p0 * x + p4 * y + p8 * z + p12;
+    cy[k] = p1 * x + p5 * y + p9 * z + p13;
+    cz[k] = p2 * x + p6 * y + p10 * z + p14 + bias * w;
+    cw[k] = w;
+    wx[k] = m0 * x + m4 * y + m8 * z + m12;
+    wy[k] = m1 * x + m5 * y + m9 * z + m13;
+    wz[k] = m2 * x + m6 * y + m10 * z + m14;
+    float a = nx[k], b = ny[k], d = nz[k];
+    ox[k] = m0 * a + m4 * b + m8 * d;
+    oy[k] = m1 * a + m5 * b + m9 * d;
+    oz[k] = m2 * a + m6 * b + m10 * d;
+  }
+}
+
+/* -------------------------------------------------------------------------
+ * Scratch management
+ * ------------------------------------------------------------------------- */
+
+static bool stream_reserve(MopCpuVertexStream *s, uint32_t count) {
+  if (count > s->capacity || !s->storage) {
+    size_t cap = (size_t)count + count / 4 + 16;
+    if (cap > UINT32_MAX)
+      cap = UINT32_MAX;
+    float *storage = malloc(cap * MOP_CPU_VS_COMPONENTS * sizeof(float));
+    if (!storage)
+      return false;
+    free(s->storage);
+    s->storage = storage;
+    s->capacity = (uint32_t)cap;
+  }
+  for (int k = 0; k < MOP_CPU_VS_COMPONENTS; k++)
+    s->c[k] = s->storage + (size_t)k * s->capacity;
+  return true;
+}
+
+static bool grow(void **p, size_t count, size_t elem) {
+  void *q = realloc(*p, count * elem);
+  if (!q)
+    return false;
+  *p = q;
+  return true;
+}
+
+/* Collect the distinct in-range vertices of indices, in first-use order,
+ * into s->ids and write the remapped index list to s->indices.  Returns
+ * the number of distinct vertices, or -1 on allocation failure. */
+static int64_t stream_compact(MopCpuVertexStream *s, const uint32_t *indices,
+                              uint32_t index_count, uint32_t vertex_count) {
+  size_t words = ((size_t)vertex_count + 63) / 64;
+  if (vertex_count > s->mesh_capacity) {
+    if (!grow((void **)&s->mark, words, sizeof(uint64_t)) ||
+        !grow((void **)&s->remap, vertex_count, sizeof(uint32_t)))
+      return -1;
+    s->mesh_capacity = vertex_count;
+  }
+  if (index_count > s->index_capacity) {
+    if (!grow((void **)&s->ids, index_count, sizeof(uint32_t)) ||
+        !grow((void **)&s->indices, index_count, sizeof(uint32_t)))
+      return -1;
+    s->index_capacity = index_count;
+  }
+
+  memset(s->mark, 0, words * sizeof(uint64_t));
+  uint32_t n = 0;
+  for (uint32_t i = 0; i < index_count; i++) {
+    uint32_t id = indices[i];
+    if (id >= vertex_count) {
+      s->indices[i] = UINT32_MAX;
+      continue;
+    }
+    uint64_t bit = (uint64_t)1 << (id & 63);
+    if (!(s->mark[id >> 6] & bit)) {
+      s->mark[id >> 6] |= bit;
+      s->remap[id] = n;
+      s->ids[n++] = id;
+    }
+    s->indices[i] = s->remap[id];
+  }
+  return n;
+}
+
+/* -------------------------------------------------------------------------
+ * Public API
+ * ------------------------------------------------------------------------- */
+
+bool mop_cpu_vertex_stream_build(MopCpuVertexStream *s,
+                                 const MopRhiDrawCall *call,
+                                 const void *vertex_data,
+                                 const uint32_t *indices,
+                                 uint32_t index_count,
+                                 const uint32_t **out_indices) {
+  MopVertexFormat standard;
+  const MopVertexFormat *fmt = call->vertex_format;
+  if (!fmt) {
+    standard = mop_vertex_format_standard();
+    fmt = &standard;
+  }
+
+  static const float pos_def[4] = {0, 0, 0, 1};
+  static const float nrm_def[4] = {0, 1, 0, 0};
+  static const float col_def[4] = {1, 1, 1, 1};
+  static const float uv_def[4] = {0, 0, 0, 1};
+  VsFetch pos, nrm, col, uv;
+  if (!fetch_resolve(fmt, MOP_ATTRIB_POSITION, pos_def, &pos))
+    return false;
+  fetch_resolve(fmt, MOP_ATTRIB_NORMAL, nrm_def, &nrm);
+  fetch_resolve(fmt, MOP_ATTRIB_COLOR, col_def, &col);
+  fetch_resolve(fmt, MOP_ATTRIB_TEXCOORD0, uv_def, &uv);
+
+  /* Transforming every vertex costs one transform each; per-corner work
+   * on a sparse index list would cost fewer, so compact those first. */
+  uint32_t count = call->vertex_count;
+  const uint32_t *ids = NULL;
+  *out_indices = indices;
+  if (index_count < count) {
+    int64_t n = stream_compact(s, indices, index_count, count);
+    if (n < 0)
+      return false;
+    count = (uint32_t)n;
+    ids = s->ids;
+    *out_indices = s->indices;
+  }
+  if (!stream_reserve(s, count))
+    return false;
+  s->count = count;
+
+  const uint8_t *base = (const uint8_t *)vertex_data;
+  size_t stride = fmt->stride;
+  float px[VS_BATCH], py[VS_BATCH], pz[VS_BATCH];
+  float nx[VS_BATCH], ny[VS_BATCH], nz[VS_BATCH];
+  float unused[VS_BATCH];
+  const uint8_t *v[VS_BATCH];
+  float *const *c = s->c;
+
+  for (uint32_t first = 0; first < count; first += VS_BATCH) {
+    uint32_t n = count - first < VS_BATCH ? count - first : VS_BATCH;
+    for (uint32_t k = 0; k < n; k++)
+      v[k] = base + (size_t)(ids ? ids[first + k] : first + k) * stride;
+
+    pos.fn(&pos, v, n, (float *const[4]){px, py, pz, unused});
+    nrm.fn(&nrm, v, n, (float *const[4]){nx, ny, nz, unused});
+    col.fn(&col, v, n,
+           (float *const[4]){c[MOP_CPU_VS_R] + first, c[MOP_CPU_VS_G] + first,
+                             c[MOP_CPU_VS_B] + first,
+                             c[MOP_CPU_VS_A] + first});
+    uv.fn(&uv, v, n,
+          (float *const[4]){c[MOP_CPU_VS_U] + first, c[MOP_CPU_VS_V] + first,
+                            unused, unused});
+    transform_batch(call, px, py, pz, nx, ny, nz, n, s->c, first);
+  }
+  return true;
+}
+
+void mop_cpu_vertex_stream_shade(MopCpuVertexStream *s,
+                                 const MopRhiDrawCall *call,
+                                 const MopSwShader *shader) {
+  if (!shader || !shader->vertex)
+    return;
+  /* Column-major: row r, column col is d[col * 4 + r] */
+  MopMat4 vp = mop_mat4_multiply(call->projection, call->view);
+  const float *p = vp.d;
+  const float bias = call->depth_bias;
+  const void *uniforms = shader->uniform_size ? shader->uniforms : NULL;
+  float *const *c = s->c;
+
+  /* The block's arrays map onto the stream components in this order */
+  static const int comp[12] = {
+      MOP_CPU_VS_WX, MOP_CPU_VS_WY, MOP_CPU_VS_WZ, MOP_CPU_VS_NX,
+      MOP_CPU_VS_NY, MOP_CPU_VS_NZ, MOP_CPU_VS_R,  MOP_CPU_VS_G,
+      MOP_CPU_VS_B,  MOP_CPU_VS_A,  MOP_CPU_VS_U,  MOP_CPU_VS_V};
+  MopShaderVertexBlock blk;
+  float *const arr[12] = {blk.px, blk.py, blk.pz, blk.nx, blk.ny, blk.nz,
+                          blk.r,  blk.g,  blk.b,  blk.a,  blk.u,  blk.v};
+
+  for (uint32_t first = 0; first < s->count; first += MOP_SHADER_BLOCK) {
+    uint32_t n = s->count - first;
+    if (n > MOP_SHADER_BLOCK)
+      n = MOP_SHADER_BLOCK;
+    blk.count = n;
+    for (int a = 0; a < 12; a++)
+      memcpy(arr[a], c[comp[a]] + first, n * sizeof(float));
+
+    shader->vertex(&blk, uniforms, shader->user_data);
+
+    for (int a = 0; a < 12; a++)
+      memcpy(c[comp[a]] + first, arr[a], n * sizeof(float));
+    for (uint32_t k = 0; k < n; k++) {
+      float x = blk.px[k], y = blk.py[k], z = blk.pz[k];
+      float w = p[3] * x + p[7] * y + p[11] * z + p[15];
+      c[MOP_CPU_VS_CX][first + k] = p[0] * x + p[4] * y + p[8] * z + p[12];
+      c[MOP_CPU_VS_CY][first + k] = p[1] * x + p[5] * y + p[9] * z + p[13];
+      c[MOP_CPU_VS_CZ][first + k] =
+          p[2] * x + p[6] * y + p[10] * z + p[14] + bias * w;
+      c[MOP_CPU_VS_CW][first + k] = w;
+    }
+  }
+}
+
+void mop_cpu_vertex_stream_free(MopCpuVertexStream *s) {
+  free(s->storage);
+  free(s->mark);
+  free(s->remap);
+  free(s->ids);
+  free(s->indices);
+  memset(s, 0, sizeof(*s));
+}
@@ -0,0 +1,86 @@
+/*
+ * Master of Puppets — CPU Backend
+ * cpu_vertex.h — Vertex stage: format-specialized fetch, batched transform
+ *
+ * Each draw transforms its vertices once, before triangle assembly, into
+ * a structure-of-arrays stream (one float array per component).  The
+ * vertex format is resolved once per draw into one fetch routine per
+ * attribute, so a custom or quantized layout costs a few batched decode
+ * loops rather than a format switch per triangle corner.
+ *
+ * Dense draws transform every vertex.  Draws that reference fewer
+ * corners than the mesh has vertices (culled meshlets, partial index
+ * ranges) transform only the referenced vertices and remap the indices
+ * onto the compacted stream.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef MOP_CPU_VERTEX_H
+#define MOP_CPU_VERTEX_H
+
+#include "rhi/rhi.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Stream components, in storage order */
+enum {
+  MOP_CPU_VS_CX, /* clip-space position (depth bias applied) */
+  MOP_CPU_VS_CY,
+  MOP_CPU_VS_CZ,
+  MOP_CPU_VS_CW,
+  MOP_CPU_VS_WX, /* world-space position */
+  MOP_CPU_VS_WY,
+  MOP_CPU_VS_WZ,
+  MOP_CPU_VS_NX, /* world-space normal (model upper 3x3) */
+  MOP_CPU_VS_NY,
+  MOP_CPU_VS_NZ,
+  MOP_CPU_VS_R, /* vertex color */
+  MOP_CPU_VS_G,
+  MOP_CPU_VS_B,
+  MOP_CPU_VS_A,
+  MOP_CPU_VS_U, /* texture coordinates */
+  MOP_CPU_VS_V,
+  MOP_CPU_VS_COMPONENTS
+};
+
+typedef struct MopCpuVertexStream {
+  float *c[MOP_CPU_VS_COMPONENTS]; /* component arrays, `count` valid */
+  uint32_t count;
+
+  /* Grow-only scratch, reused across draws */
+  float *storage;
+  uint32_t capacity;      /* vertices per component array */
+  uint64_t *mark;         /* sparse draws: referenced-vertex bitset */
+  uint32_t *remap;        /* sparse draws: mesh vertex -> stream slot */
+  uint32_t *ids;          /* sparse draws: stream slot -> mesh vertex */
+  uint32_t *indices;      /* sparse draws: remapped index list */
+  size_t mesh_capacity;   /* vertices covered by mark / remap */
+  size_t index_capacity;  /* entries in ids / indices */
+} MopCpuVertexStream;
+
+/* Transform the vertices referenced by indices into s.  vertex_data holds
+ * call->vertex_count vertices in call->vertex_format (NULL = MopVertex).
+ * On success *out_indices addresses the stream: either indices itself or
+ * a remapped copy owned by s.  Out-of-range indices map to values >=
+ * s->count.  Returns false if the format has no position or on
+ * allocation failure. */
+bool mop_cpu_vertex_stream_build(MopCpuVertexStream *s,
+                                 const MopRhiDrawCall *call,
+                                 const void *vertex_data,
+                                 const uint32_t *indices,
+                                 uint32_t index_count,
+                                 const uint32_t **out_indices);
+
+/* Run shader's vertex callback over the stream's vertices and reproject
+ * the world positions it returns through call->projection * call->view
+ * (depth bias applied). */
+void mop_cpu_vertex_stream_shade(MopCpuVertexStream *s,
+                                 const MopRhiDrawCall *call,
+                                 const struct MopSwShader *shader);
+
+void mop_cpu_vertex_stream_free(MopCpuVertexStream *s);
+
+#endif /* MOP_CPU_VERTEX_H */
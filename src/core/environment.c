@@ -3,16 +3,24 @@
  * environment.c — HDR environment map loading, IBL precomputation,
  *                 and procedural sky generation
  *
+ * IBL precomputation (SH irradiance, prefiltered specular, BRDF LUT) is
+ * row-parallel on the viewport thread pool and disk-cached per HDRI.
+ *
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include "core/thread_pool.h"
 #include "core/viewport_internal.h"
 #include "rhi/rhi.h"
 
 #include <math.h>
 #include <mop/util/log.h>
+#include <pthread.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 /* stb_image for .hdr loading (stbi_loadf) */
 #include "stb_image.h"
@@ -95,121 +103,318 @@ static void env_cleanup(MopViewport *vp) {
   vp->env_irradiance_data = NULL;
   free(vp->env_prefiltered_data);
   vp->env_prefiltered_data = NULL;
-  free(vp->env_brdf_lut_data);
-  vp->env_brdf_lut_data = NULL;
+  vp->env_brdf_lut_data = NULL; /* process-wide, not owned */
+  vp->env_irradiance_sh_valid = false;
   vp->env_width = 0;
   vp->env_height = 0;
 }
 
 /* -------------------------------------------------------------------------
- * IBL: Precompute diffuse irradiance map
+ * IBL worker dispatch
  *
- * Convolves the environment map with a cosine-weighted hemisphere integral
- * for each direction, producing a low-res irradiance map (64x32).
+ * Every precompute stage is expressed as an independent per-row function
+ * and fanned out over the viewport's generic thread pool with
+ * mop_threadpool_parallel_rows.  The caller holds the scene lock, so the
+ * render graph cannot be using the pool at the same time.  A NULL pool
+ * (thread creation failed) runs rows inline.
+ * ------------------------------------------------------------------------- */
+
+/* Hammersley point (i / n, radical inverse of i) */
+static void hammersley(uint32_t i, uint32_t n, float *xi1, float *xi2) {
+  uint32_t bits = i;
+  bits = (bits << 16u) | (bits >> 16u);
+  bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+  bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+  bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+  bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+  *xi1 = (float)i / (float)n;
+  *xi2 = (float)bits * 2.3283064365386963e-10f;
+}
+
+/* -------------------------------------------------------------------------
+ * Source pyramid
+ *
+ * 2x2 box-filtered mip chain of the equirectangular source.  Level 0
+ * aliases env_hdr_data; coarser levels are owned.  Prefiltering reads
+ * the level whose texel footprint matches each sample's solid angle
+ * (filtered importance sampling), so a handful of samples per texel
+ * converges without fireflies.
+ * ------------------------------------------------------------------------- */
+
+#define ENV_PYRAMID_MAX_LEVELS 16
+
+typedef struct EnvPyramid {
+  int count;
+  int w[ENV_PYRAMID_MAX_LEVELS];
+  int h[ENV_PYRAMID_MAX_LEVELS];
+  const float *data[ENV_PYRAMID_MAX_LEVELS];
+  float *owned[ENV_PYRAMID_MAX_LEVELS];
+} EnvPyramid;
+
+typedef struct EnvDownsampleCtx {
+  const float *src;
+  int sw, sh;
+  float *dst;
+  int dw;
+} EnvDownsampleCtx;
+
+static void env_downsample_row(void *ctx_ptr, int y) {
+  const EnvDownsampleCtx *ctx = (const EnvDownsampleCtx *)ctx_ptr;
+  int y0 = y * 2;
+  int y1 = y0 + 1 < ctx->sh ? y0 + 1 : ctx->sh - 1;
+  const float *r0 = ctx->src + (size_t)y0 * ctx->sw * 4;
+  const float *r1 = ctx->src + (size_t)y1 * ctx->sw * 4;
+  float *out = ctx->dst + (size_t)y * ctx->dw * 4;
+  for (int x = 0; x < ctx->dw; x++) {
+    int x0 = x * 2;
+    int x1 = (x0 + 1) % ctx->sw; /* horizontal wrap */
+    for (int c = 0; c < 4; c++) {
+      out[x * 4 + c] = 0.25f * (r0[x0 * 4 + c] + r0[x1 * 4 + c] +
+                                r1[x0 * 4 + c] + r1[x1 * 4 + c]);
+    }
+  }
+}
+
+static void env_pyramid_build(MopViewport *vp, EnvPyramid *pyr) {
+  memset(pyr, 0, sizeof(*pyr));
+  pyr->count = 1;
+  pyr->w[0] = vp->env_width;
+  pyr->h[0] = vp->env_height;
+  pyr->data[0] = vp->env_hdr_data;
+
+  while (pyr->count < ENV_PYRAMID_MAX_LEVELS) {
+    int l = pyr->count - 1;
+    if (pyr->w[l] <= 8 || pyr->h[l] <= 4)
+      break;
+    int dw = pyr->w[l] / 2;
+    int dh = pyr->h[l] / 2;
+    float *dst = malloc((size_t)dw * dh * 4 * sizeof(float));
+    if (!dst)
+      break; /* coarser levels are an optimization — clamp the chain */
+    EnvDownsampleCtx ctx = {
+        .src = pyr->data[l],
+        .sw = pyr->w[l],
+        .sh = pyr->h[l],
+        .dst = dst,
+        .dw = dw,
+    };
+    mop_threadpool_parallel_rows(vp->thread_pool, dh, env_downsample_row, &ctx);
+    pyr->w[l + 1] = dw;
+    pyr->h[l + 1] = dh;
+    pyr->data[l + 1] = dst;
+    pyr->owned[l + 1] = dst;
+    pyr->count++;
+  }
+}
+
+static void env_pyramid_free(EnvPyramid *pyr) {
+  for (int l = 0; l < pyr->count; l++)
+    free(pyr->owned[l]);
+  memset(pyr, 0, sizeof(*pyr));
+}
+
+/* Trilinear lookup: bilinear within the two pyramid levels around lod */
+static void env_pyramid_sample(const EnvPyramid *pyr, float dx, float dy,
+                               float dz, float lod, float out[3]) {
+  float u, v;
+  dir_to_equirect(dx, dy, dz, 0.0f, &u, &v);
+  float max_lod = (float)(pyr->count - 1);
+  if (lod < 0.0f)
+    lod = 0.0f;
+  if (lod > max_lod)
+    lod = max_lod;
+  int l0 = (int)lod;
+  int l1 = l0 + 1 < pyr->count ? l0 + 1 : l0;
+  float t = lod - (float)l0;
+
+  float a[4];
+  sample_hdr_bilinear(pyr->data[l0], pyr->w[l0], pyr->h[l0], u, v, a);
+  if (t <= 0.0f || l1 == l0) {
+    out[0] = a[0];
+    out[1] = a[1];
+    out[2] = a[2];
+    return;
+  }
+  float b[4];
+  sample_hdr_bilinear(pyr->data[l1], pyr->w[l1], pyr->h[l1], u, v, b);
+  out[0] = a[0] + (b[0] - a[0]) * t;
+  out[1] = a[1] + (b[1] - a[1]) * t;
+  out[2] = a[2] + (b[2] - a[2]) * t;
+}
+
+/* Orthonormal tangent frame around n (same convention as the GPU shaders:
+ * world = t * local.x + n * local.y + b * local.z) */
+static void env_tangent_frame(float nx, float ny, float nz, float t[3],
+                              float b[3]) {
+  float upx = 0.0f, upy = 1.0f, upz = 0.0f;
+  if (fabsf(ny) > 0.99f) {
+    upy = 0.0f;
+    upz = 1.0f;
+  }
+  t[0] = upy * nz - upz * ny;
+  t[1] = upz * nx - upx * nz;
+  t[2] = upx * ny - upy * nx;
+  float tlen = sqrtf(t[0] * t[0] + t[1] * t[1] + t[2] * t[2]);
+  if (tlen > 1e-6f) {
+    t[0] /= tlen;
+    t[1] /= tlen;
+    t[2] /= tlen;
+  }
+  b[0] = ny * t[2] - nz * t[1];
+  b[1] = nz * t[0] - nx * t[2];
+  b[2] = nx * t[1] - ny * t[0];
+}
+
+/* -------------------------------------------------------------------------
+ * IBL: Diffuse irradiance via 3rd-order spherical harmonics
+ *
+ * The source is projected onto the 9 real SH basis functions (bands
+ * l = 0..2), which capture a cosine-convolved irradiance signal to within
+ * ~3% (Ramamoorthi & Hanrahan).  Projection is a single pass over a
+ * downsampled pyramid level, split by rows; the irradiance map consumed
+ * by the backends is then evaluated from the 9 coefficients.
  * ------------------------------------------------------------------------- */
 
 #define IRR_W 64
 #define IRR_H 32
-#define IRR_SAMPLES 128
+#define SH_PROJECT_MAX_W 512
+
+/* Real SH basis, bands 0..2 */
+static void sh9_basis(float x, float y, float z, float out[9]) {
+  out[0] = 0.282095f;
+  out[1] = 0.488603f * y;
+  out[2] = 0.488603f * z;
+  out[3] = 0.488603f * x;
+  out[4] = 1.092548f * x * y;
+  out[5] = 1.092548f * y * z;
+  out[6] = 0.315392f * (3.0f * z * z - 1.0f);
+  out[7] = 1.092548f * x * z;
+  out[8] = 0.546274f * (x * x - y * y);
+}
 
-static void precompute_irradiance(MopViewport *vp) {
-  if (!vp->env_hdr_data)
+typedef struct EnvShCtx {
+  const float *src;
+  int w, h;
+  const float *cos_phi; /* per column */
+  const float *sin_phi;
+  double *partials; /* h rows x 27 */
+} EnvShCtx;
+
+static void env_sh_project_row(void *ctx_ptr, int y) {
+  const EnvShCtx *ctx = (const EnvShCtx *)ctx_ptr;
+  float theta = (((float)y + 0.5f) / (float)ctx->h - 0.5f) * (float)M_PI;
+  float ct = cosf(theta);
+  float st = sinf(theta);
+  /* Equirect texel solid angle: (2pi/w) * (pi/h) * cos(latitude) */
+  float d_omega = (2.0f * (float)M_PI / (float)ctx->w) *
+                  ((float)M_PI / (float)ctx->h) * ct;
+
+  float acc[27] = {0};
+  const float *row = ctx->src + (size_t)y * ctx->w * 4;
+  for (int x = 0; x < ctx->w; x++) {
+    float basis[9];
+    sh9_basis(ct * ctx->cos_phi[x], st, ct * ctx->sin_phi[x], basis);
+    float r = row[x * 4 + 0] * d_omega;
+    float g = row[x * 4 + 1] * d_omega;
+    float b = row[x * 4 + 2] * d_omega;
+    for (int k = 0; k < 9; k++) {
+      acc[k * 3 + 0] += r * basis[k];
+      acc[k * 3 + 1] += g * basis[k];
+      acc[k * 3 + 2] += b * basis[k];
+    }
+  }
+  double *out = ctx->partials + (size_t)y * 27;
+  for (int k = 0; k < 27; k++)
+    out[k] = (double)acc[k];
+}
+
+static bool project_irradiance_sh(MopViewport *vp, const EnvPyramid *pyr) {
+  int l = 0;
+  while (l + 1 < pyr->count && pyr->w[l] > SH_PROJECT_MAX_W)
+    l++;
+  int w = pyr->w[l], h = pyr->h[l];
+
+  double *partials = calloc((size_t)h * 27, sizeof(double));
+  float *phi_tab = malloc((size_t)w * 2 * sizeof(float));
+  if (!partials || !phi_tab) {
+    free(partials);
+    free(phi_tab);
+    return false;
+  }
+  for (int x = 0; x < w; x++) {
+    float phi = (((float)x + 0.5f) / (float)w - 0.5f) * 2.0f * (float)M_PI;
+    phi_tab[x] = cosf(phi);
+    phi_tab[w + x] = sinf(phi);
+  }
+
+  EnvShCtx ctx = {
+      .src = pyr->data[l],
+      .w = w,
+      .h = h,
+      .cos_phi = phi_tab,
+      .sin_phi = phi_tab + w,
+      .partials = partials,
+  };
+  mop_threadpool_parallel_rows(vp->thread_pool, h, env_sh_project_row, &ctx);
+
+  /* Reduce rows, then fold in the clamped-cosine convolution (A_l / pi,
+   * so evaluating the result gives mean cosine-weighted radiance — the
+   * same quantity the old hemisphere-sampled map stored). */
+  static const float band_scale[9] = {
+      1.0f,  2.0f / 3.0f, 2.0f / 3.0f, 2.0f / 3.0f, 0.25f,
+      0.25f, 0.25f,       0.25f,       0.25f,
+  };
+  for (int k = 0; k < 9; k++) {
+    for (int c = 0; c < 3; c++) {
+      double sum = 0.0;
+      for (int y = 0; y < h; y++)
+        sum += partials[(size_t)y * 27 + k * 3 + c];
+      vp->env_irradiance_sh[k][c] = (float)sum * band_scale[k];
+    }
+  }
+  vp->env_irradiance_sh_valid = true;
+
+  free(partials);
+  free(phi_tab);
+  return true;
+}
+
+static void sh9_eval(const float sh[9][3], float x, float y, float z,
+                     float out[3]) {
+  float basis[9];
+  sh9_basis(x, y, z, basis);
+  out[0] = out[1] = out[2] = 0.0f;
+  for (int k = 0; k < 9; k++) {
+    out[0] += sh[k][0] * basis[k];
+    out[1] += sh[k][1] * basis[k];
+    out[2] += sh[k][2] * basis[k];
+  }
+  /* L2 ringing can undershoot around very bright sources */
+  for (int c = 0; c < 3; c++)
+    if (out[c] < 0.0f)
+      out[c] = 0.0f;
+}
+
+/* Evaluate the SH coefficients into the equirect irradiance map that the
+ * CPU rasterizer and GPU backends sample. */
+static void bake_irradiance_map(MopViewport *vp) {
+  if (!vp->env_irradiance_sh_valid)
     return;
 
-  size_t size = (size_t)IRR_W * IRR_H * 4;
-  float *irr = calloc(size, sizeof(float));
+  float *irr = malloc((size_t)IRR_W * IRR_H * 4 * sizeof(float));
   if (!irr)
     return;
 
   for (int y = 0; y < IRR_H; y++) {
+    float theta = (((float)y + 0.5f) / (float)IRR_H - 0.5f) * (float)M_PI;
+    float ct = cosf(theta);
+    float st = sinf(theta);
     for (int x = 0; x < IRR_W; x++) {
-      /* Direction for this texel */
-      float u = ((float)x + 0.5f) / (float)IRR_W;
-      float v = ((float)y + 0.5f) / (float)IRR_H;
-      float phi = (u - 0.5f) * 2.0f * (float)M_PI;
-      float theta = (v - 0.5f) * (float)M_PI;
-      float ct = cosf(theta);
-      float nx = ct * cosf(phi);
-      float ny = sinf(theta);
-      float nz = ct * sinf(phi);
-      float len = sqrtf(nx * nx + ny * ny + nz * nz);
-      nx /= len;
-      ny /= len;
-      nz /= len;
-
-      /* Build tangent frame */
-      float upx = 0.0f, upy = 1.0f, upz = 0.0f;
-      if (fabsf(ny) > 0.99f) {
-        upx = 0.0f;
-        upy = 0.0f;
-        upz = 1.0f;
-      }
-      /* tangent = normalize(cross(up, n)) */
-      float tx = upy * nz - upz * ny;
-      float ty = upz * nx - upx * nz;
-      float tz = upx * ny - upy * nx;
-      float tlen = sqrtf(tx * tx + ty * ty + tz * tz);
-      if (tlen > 1e-6f) {
-        tx /= tlen;
-        ty /= tlen;
-        tz /= tlen;
-      }
-      /* bitangent = cross(n, tangent) */
-      float bx = ny * tz - nz * ty;
-      float by = nz * tx - nx * tz;
-      float bz = nx * ty - ny * tx;
-
-      float accum[3] = {0, 0, 0};
-      float total_weight = 0.0f;
-
-      /* Uniform hemisphere sampling with cosine weighting */
-      for (int s = 0; s < IRR_SAMPLES; s++) {
-        /* Low-discrepancy sequence (Hammersley) */
-        float xi1 = (float)s / (float)IRR_SAMPLES;
-        uint32_t bits = (uint32_t)s;
-        bits = (bits << 16u) | (bits >> 16u);
-        bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
-        bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
-        bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
-        bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
-        float xi2 = (float)bits * 2.3283064365386963e-10f;
-
-        /* Cosine-weighted hemisphere: theta = acos(sqrt(xi1)), phi = 2*pi*xi2
-         */
-        float cos_theta_s = sqrtf(xi1);
-        float sin_theta_s = sqrtf(1.0f - xi1);
-        float phi_s = 2.0f * (float)M_PI * xi2;
-
-        /* Local hemisphere direction */
-        float lx = sin_theta_s * cosf(phi_s);
-        float ly = cos_theta_s;
-        float lz = sin_theta_s * sinf(phi_s);
-
-        /* To world space via TBN */
-        float wx = tx * lx + nx * ly + bx * lz;
-        float wy = ty * lx + ny * ly + by * lz;
-        float wz = tz * lx + nz * ly + bz * lz;
-
-        float su, sv;
-        dir_to_equirect(wx, wy, wz, 0.0f, &su, &sv);
-        float sample[4];
-        sample_hdr_bilinear(vp->env_hdr_data, vp->env_width, vp->env_height, su,
-                            sv, sample);
-
-        /* Cosine-weighted: PDF = cos(theta)/pi, so weight = 1.0 for
-         * importance-sampled cosine distribution */
-        accum[0] += sample[0];
-        accum[1] += sample[1];
-        accum[2] += sample[2];
-        total_weight += 1.0f;
-      }
-
+      float phi =
+          (((float)x + 0.5f) / (float)IRR_W - 0.5f) * 2.0f * (float)M_PI;
       size_t idx = ((size_t)y * IRR_W + x) * 4;
-      if (total_weight > 0.0f) {
-        irr[idx + 0] = accum[0] / total_weight;
-        irr[idx + 1] = accum[1] / total_weight;
-        irr[idx + 2] = accum[2] / total_weight;
-      }
+      sh9_eval((const float(*)[3])vp->env_irradiance_sh, ct * cosf(phi), st,
+               ct * sinf(phi), &irr[idx]);
       irr[idx + 3] = 1.0f;
     }
   }
@@ -230,6 +435,12 @@ static void precompute_irradiance(MopViewport *vp) {
  * Generates mip levels where each level represents increasing roughness.
  * Level 0 = roughness 0 (mirror), level N = roughness 1.
  * All levels stored in a single flat buffer for CPU sampling.
+ *
+ * Under the split-sum V = N assumption the reflected direction in tangent
+ * space depends only on the sample index, so each level's sample set
+ * (direction, N.L weight, source lod) is tabulated once and every texel
+ * reduces to a frame rotation plus a pyramid lookup.  All rows of all
+ * levels are dispatched as one parallel job.
  * ------------------------------------------------------------------------- */
 
 #define PREFILT_BASE_W 128
@@ -237,149 +448,171 @@ static void precompute_irradiance(MopViewport *vp) {
 #define PREFILT_LEVELS 5
 #define PREFILT_SAMPLES 64
 
-static void precompute_prefiltered(MopViewport *vp) {
-  if (!vp->env_hdr_data)
+typedef struct PrefilterSample {
+  float lx, ly, lz; /* tangent space, y = normal */
+  float ndl;
+  float lod; /* source pyramid level */
+} PrefilterSample;
+
+typedef struct PrefilterLevel {
+  int w, h;
+  int row_base;  /* first global row of this level */
+  size_t offset; /* texel offset into the output buffer */
+  PrefilterSample samples[PREFILT_SAMPLES];
+  int sample_count;
+  float inv_weight;
+  float cos_phi[PREFILT_BASE_W];
+  float sin_phi[PREFILT_BASE_W];
+} PrefilterLevel;
+
+typedef struct PrefilterCtx {
+  const EnvPyramid *src;
+  float *out;
+  PrefilterLevel levels[PREFILT_LEVELS];
+} PrefilterCtx;
+
+static void prefilter_build_level(PrefilterLevel *lvl, int level,
+                                  const EnvPyramid *src) {
+  float roughness = (float)level / (float)(PREFILT_LEVELS - 1);
+  float alpha = roughness * roughness;
+  float alpha2 = alpha * alpha;
+
+  for (int x = 0; x < lvl->w; x++) {
+    float phi = (((float)x + 0.5f) / (float)lvl->w - 0.5f) * 2.0f * (float)M_PI;
+    lvl->cos_phi[x] = cosf(phi);
+    lvl->sin_phi[x] = sinf(phi);
+  }
+
+  /* Mirror level: a single tap along N at full resolution */
+  if (alpha2 < 1e-7f) {
+    lvl->samples[0] = (PrefilterSample){0.0f, 1.0f, 0.0f, 1.0f, 0.0f};
+    lvl->sample_count = 1;
+    lvl->inv_weight = 1.0f;
     return;
+  }
+
+  /* Solid angle of one level-0 source texel (latitude-averaged) */
+  float omega_p = 4.0f * (float)M_PI / ((float)src->w[0] * (float)src->h[0]);
+
+  float total = 0.0f;
+  int n = 0;
+  for (int s = 0; s < PREFILT_SAMPLES; s++) {
+    float xi1, xi2;
+    hammersley((uint32_t)s, PREFILT_SAMPLES, &xi1, &xi2);
+
+    float cos_theta_h = sqrtf((1.0f - xi1) / (1.0f + (alpha2 - 1.0f) * xi1));
+    float sin_theta_h = sqrtf(1.0f - cos_theta_h * cos_theta_h);
+    float phi_h = 2.0f * (float)M_PI * xi2;
+
+    /* H in tangent space; V = N = (0,1,0), so L = 2 (N.H) H - N */
+    float hx = sin_theta_h * cosf(phi_h);
+    float hy = cos_theta_h;
+    float hz = sin_theta_h * sinf(phi_h);
+    float lx = 2.0f * hy * hx;
+    float ly = 2.0f * hy * hy - 1.0f;
+    float lz = 2.0f * hy * hz;
+    if (ly <= 0.0f)
+      continue;
+
+    /* pdf(L) = D(h) * NdH / (4 VdH) = D / 4 with V = N */
+    float c2 = cos_theta_h * cos_theta_h;
+    float d = c2 * (alpha2 - 1.0f) + 1.0f;
+    float D = alpha2 / ((float)M_PI * d * d);
+    float pdf = D * 0.25f;
+    float omega_s = 1.0f / ((float)PREFILT_SAMPLES * pdf + 1e-6f);
+    float lod = 0.5f * log2f(omega_s / omega_p) + 1.0f;
+
+    lvl->samples[n++] = (PrefilterSample){lx, ly, lz, ly, lod};
+    total += ly;
+  }
+  lvl->sample_count = n;
+  lvl->inv_weight = total > 0.0f ? 1.0f / total : 0.0f;
+}
+
+static void prefilter_row(void *ctx_ptr, int row) {
+  const PrefilterCtx *ctx = (const PrefilterCtx *)ctx_ptr;
+  int level = PREFILT_LEVELS - 1;
+  while (level > 0 && row < ctx->levels[level].row_base)
+    level--;
+  const PrefilterLevel *lvl = &ctx->levels[level];
+  int y = row - lvl->row_base;
+
+  float theta = (((float)y + 0.5f) / (float)lvl->h - 0.5f) * (float)M_PI;
+  float ct = cosf(theta);
+  float ny = sinf(theta);
+
+  for (int x = 0; x < lvl->w; x++) {
+    float nx = ct * lvl->cos_phi[x];
+    float nz = ct * lvl->sin_phi[x];
+    float t[3], b[3];
+    env_tangent_frame(nx, ny, nz, t, b);
+
+    float accum[3] = {0, 0, 0};
+    for (int s = 0; s < lvl->sample_count; s++) {
+      const PrefilterSample *smp = &lvl->samples[s];
+      float wx = t[0] * smp->lx + nx * smp->ly + b[0] * smp->lz;
+      float wy = t[1] * smp->lx + ny * smp->ly + b[1] * smp->lz;
+      float wz = t[2] * smp->lx + nz * smp->ly + b[2] * smp->lz;
+      float c[3];
+      env_pyramid_sample(ctx->src, wx, wy, wz, smp->lod, c);
+      accum[0] += c[0] * smp->ndl;
+      accum[1] += c[1] * smp->ndl;
+      accum[2] += c[2] * smp->ndl;
+    }
+
+    float *dst = ctx->out + (lvl->offset + (size_t)y * lvl->w + x) * 4;
+    dst[0] = accum[0] * lvl->inv_weight;
+    dst[1] = accum[1] * lvl->inv_weight;
+    dst[2] = accum[2] * lvl->inv_weight;
+    dst[3] = 1.0f;
+  }
+}
 
-  /* Allocate storage for all mip levels concatenated */
-  size_t total_pixels = 0;
+static size_t prefiltered_texel_count(void) {
+  size_t total = 0;
   for (int l = 0; l < PREFILT_LEVELS; l++) {
     int w = PREFILT_BASE_W >> l;
     int h = PREFILT_BASE_H >> l;
-    if (w < 1)
-      w = 1;
-    if (h < 1)
-      h = 1;
-    total_pixels += (size_t)w * h;
+    total += (size_t)(w < 1 ? 1 : w) * (h < 1 ? 1 : h);
   }
+  return total;
+}
 
-  float *buf = calloc(total_pixels * 4, sizeof(float));
-  if (!buf)
+static void precompute_prefiltered(MopViewport *vp, const EnvPyramid *pyr) {
+  PrefilterCtx *ctx = calloc(1, sizeof(PrefilterCtx));
+  float *buf = malloc(prefiltered_texel_count() * 4 * sizeof(float));
+  if (!ctx || !buf) {
+    free(ctx);
+    free(buf);
     return;
+  }
 
+  ctx->src = pyr;
+  ctx->out = buf;
   size_t offset = 0;
+  int rows = 0;
   for (int l = 0; l < PREFILT_LEVELS; l++) {
-    int w = PREFILT_BASE_W >> l;
-    int h = PREFILT_BASE_H >> l;
-    if (w < 1)
-      w = 1;
-    if (h < 1)
-      h = 1;
-    float roughness = (float)l / (float)(PREFILT_LEVELS - 1);
-    float alpha = roughness * roughness;
-    float alpha2 = alpha * alpha;
-    if (alpha2 < 1e-7f)
-      alpha2 = 1e-7f;
-
-    for (int y = 0; y < h; y++) {
-      for (int x = 0; x < w; x++) {
-        float u = ((float)x + 0.5f) / (float)w;
-        float v = ((float)y + 0.5f) / (float)h;
-        float phi = (u - 0.5f) * 2.0f * (float)M_PI;
-        float theta = (v - 0.5f) * (float)M_PI;
-        float ct = cosf(theta);
-        float nx = ct * cosf(phi);
-        float ny = sinf(theta);
-        float nz = ct * sinf(phi);
-        float nlen = sqrtf(nx * nx + ny * ny + nz * nz);
-        nx /= nlen;
-        ny /= nlen;
-        nz /= nlen;
-
-        /* View = Normal (split-sum approximation) */
-        float vx = nx, vy = ny, vz = nz;
-
-        /* Build tangent frame */
-        float upx = 0.0f, upy = 1.0f, upz = 0.0f;
-        if (fabsf(ny) > 0.99f) {
-          upx = 0.0f;
-          upy = 0.0f;
-          upz = 1.0f;
-        }
-        float tax = upy * nz - upz * ny;
-        float tay = upz * nx - upx * nz;
-        float taz = upx * ny - upy * nx;
-        float tlen = sqrtf(tax * tax + tay * tay + taz * taz);
-        if (tlen > 1e-6f) {
-          tax /= tlen;
-          tay /= tlen;
-          taz /= tlen;
-        }
-        float bax = ny * taz - nz * tay;
-        float bay = nz * tax - nx * taz;
-        float baz = nx * tay - ny * tax;
-
-        float accum[3] = {0, 0, 0};
-        float total_weight = 0.0f;
-
-        for (int s = 0; s < PREFILT_SAMPLES; s++) {
-          float xi1 = (float)s / (float)PREFILT_SAMPLES;
-          uint32_t bits = (uint32_t)s;
-          bits = (bits << 16u) | (bits >> 16u);
-          bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
-          bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
-          bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
-          bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
-          float xi2 = (float)bits * 2.3283064365386963e-10f;
-
-          /* GGX importance sampling for half vector */
-          float cos_theta_h =
-              sqrtf((1.0f - xi1) / (1.0f + (alpha2 - 1.0f) * xi1));
-          float sin_theta_h = sqrtf(1.0f - cos_theta_h * cos_theta_h);
-          float phi_h = 2.0f * (float)M_PI * xi2;
-
-          /* Half vector in local space → world space */
-          float hx_l = sin_theta_h * cosf(phi_h);
-          float hy_l = cos_theta_h;
-          float hz_l = sin_theta_h * sinf(phi_h);
-          float hx = tax * hx_l + nx * hy_l + bax * hz_l;
-          float hy = tay * hx_l + ny * hy_l + bay * hz_l;
-          float hz = taz * hx_l + nz * hy_l + baz * hz_l;
-
-          /* Reflect view around half vector: L = 2 * dot(V,H) * H - V */
-          float vdh = vx * hx + vy * hy + vz * hz;
-          float lx = 2.0f * vdh * hx - vx;
-          float ly = 2.0f * vdh * hy - vy;
-          float lz = 2.0f * vdh * hz - vz;
-
-          float ndl = nx * lx + ny * ly + nz * lz;
-          if (ndl <= 0.0f)
-            continue;
-
-          float su, sv;
-          dir_to_equirect(lx, ly, lz, 0.0f, &su, &sv);
-          float sample[4];
-          sample_hdr_bilinear(vp->env_hdr_data, vp->env_width, vp->env_height,
-                              su, sv, sample);
-
-          accum[0] += sample[0] * ndl;
-          accum[1] += sample[1] * ndl;
-          accum[2] += sample[2] * ndl;
-          total_weight += ndl;
-        }
-
-        size_t idx = (offset + (size_t)y * w + x) * 4;
-        if (total_weight > 0.0f) {
-          buf[idx + 0] = accum[0] / total_weight;
-          buf[idx + 1] = accum[1] / total_weight;
-          buf[idx + 2] = accum[2] / total_weight;
-        }
-        buf[idx + 3] = 1.0f;
-      }
-    }
-    offset += (size_t)w * h;
+    PrefilterLevel *lvl = &ctx->levels[l];
+    lvl->w = PREFILT_BASE_W >> l;
+    lvl->h = PREFILT_BASE_H >> l;
+    if (lvl->w < 1)
+      lvl->w = 1;
+    if (lvl->h < 1)
+      lvl->h = 1;
+    lvl->row_base = rows;
+    lvl->offset = offset;
+    prefilter_build_level(lvl, l, pyr);
+    rows += lvl->h;
+    offset += (size_t)lvl->w * lvl->h;
   }
 
+  mop_threadpool_parallel_rows(vp->thread_pool, rows, prefilter_row, ctx);
+  free(ctx);
+
   vp->env_prefiltered_data = buf;
   vp->env_prefiltered_w = PREFILT_BASE_W;
   vp->env_prefiltered_h = PREFILT_BASE_H;
   vp->env_prefiltered_levels = PREFILT_LEVELS;
-
-  /* Create GPU texture from level 0 only (levels available via CPU sampling) */
-  if (vp->rhi->texture_create_hdr) {
-    vp->env_prefiltered = vp->rhi->texture_create_hdr(
-        vp->device, PREFILT_BASE_W, PREFILT_BASE_H, buf);
-  }
 }
 
 /* -------------------------------------------------------------------------
@@ -387,102 +620,305 @@ static void precompute_prefiltered(MopViewport *vp) {
  *
  * 256x256 texture, x = NdotV, y = roughness → (scale, bias) for
  * F0 * scale + bias approximation.
+ *
+ * The LUT depends on nothing but the BRDF, so it is computed once per
+ * process (on first use, rows in parallel) and shared read-only by every
+ * viewport.  Each viewport still owns its RHI texture.
  * ------------------------------------------------------------------------- */
 
 #define BRDF_LUT_SIZE 256
 #define BRDF_LUT_SAMPLES 64
 
-static void precompute_brdf_lut(MopViewport *vp) {
-  size_t px = (size_t)BRDF_LUT_SIZE * BRDF_LUT_SIZE;
-  float *lut = calloc(px * 4, sizeof(float));
-  if (!lut)
-    return;
+static pthread_mutex_t s_brdf_lut_mutex = PTHREAD_MUTEX_INITIALIZER;
+static float *s_brdf_lut; /* process lifetime, never freed */
+
+typedef struct BrdfLutCtx {
+  float *lut;
+  float cos_phi[BRDF_LUT_SAMPLES]; /* azimuth of H — roughness-independent */
+  float xi1[BRDF_LUT_SAMPLES];
+} BrdfLutCtx;
+
+static void brdf_lut_row(void *ctx_ptr, int y) {
+  const BrdfLutCtx *ctx = (const BrdfLutCtx *)ctx_ptr;
+  float roughness = ((float)y + 0.5f) / (float)BRDF_LUT_SIZE;
+  float alpha = roughness * roughness;
+  float alpha2 = alpha * alpha;
+  if (alpha2 < 1e-7f)
+    alpha2 = 1e-7f;
+  float k = alpha * 0.5f;
+
+  /* Per-row sample set: only theta_h depends on roughness.  V lies in the
+   * xz plane, so the y component of H never contributes to V.H. */
+  float sx[BRDF_LUT_SAMPLES], sz[BRDF_LUT_SAMPLES];
+  for (int s = 0; s < BRDF_LUT_SAMPLES; s++) {
+    float xi1 = ctx->xi1[s];
+    float cos_theta_h = sqrtf((1.0f - xi1) / (1.0f + (alpha2 - 1.0f) * xi1));
+    float sin_theta_h = sqrtf(1.0f - cos_theta_h * cos_theta_h);
+    sx[s] = sin_theta_h * ctx->cos_phi[s];
+    sz[s] = cos_theta_h;
+  }
 
-  for (int y = 0; y < BRDF_LUT_SIZE; y++) {
-    float roughness = ((float)y + 0.5f) / (float)BRDF_LUT_SIZE;
-    float alpha = roughness * roughness;
-    float alpha2 = alpha * alpha;
-    if (alpha2 < 1e-7f)
-      alpha2 = 1e-7f;
-    float k = alpha * 0.5f;
+  for (int x = 0; x < BRDF_LUT_SIZE; x++) {
+    float ndotv = ((float)x + 0.5f) / (float)BRDF_LUT_SIZE;
+    if (ndotv < 1e-4f)
+      ndotv = 1e-4f;
+
+    /* View vector in tangent space (N = (0,0,1)) */
+    float vx_t = sqrtf(1.0f - ndotv * ndotv), vz_t = ndotv;
+    float g1v = ndotv / (ndotv * (1.0f - k) + k);
+
+    float scale = 0.0f, bias = 0.0f;
+    for (int s = 0; s < BRDF_LUT_SAMPLES; s++) {
+      float hz = sz[s];
+      /* L = reflect(-V, H); N.L = lz */
+      float vdh = vx_t * sx[s] + vz_t * hz;
+      float ndl = 2.0f * vdh * hz - vz_t;
+      if (ndl <= 0.0f)
+        continue;
 
-    for (int x = 0; x < BRDF_LUT_SIZE; x++) {
-      float ndotv = ((float)x + 0.5f) / (float)BRDF_LUT_SIZE;
-      if (ndotv < 1e-4f)
-        ndotv = 1e-4f;
+      float vdh_c = vdh > 0.0f ? vdh : 0.0f;
 
-      /* View vector in tangent space (N = (0,0,1)) */
-      float sin_v = sqrtf(1.0f - ndotv * ndotv);
-      float vx_t = sin_v, vy_t = 0.0f, vz_t = ndotv;
+      /* Geometry term (Smith-Schlick) */
+      float g = g1v * (ndl / (ndl * (1.0f - k) + k));
 
-      float scale = 0.0f, bias = 0.0f;
+      /* Visibility = G * VdotH / (NdotH * NdotV) */
+      float vis = (g * vdh_c) / (hz * ndotv + 1e-6f);
+
+      /* Fresnel: (1 - VdotH)^5 */
+      float fc = 1.0f - vdh_c;
+      float fc2 = fc * fc;
+      float fc5 = fc2 * fc2 * fc;
+
+      scale += vis * (1.0f - fc5);
+      bias += vis * fc5;
+    }
+
+    size_t idx = ((size_t)y * BRDF_LUT_SIZE + x) * 4;
+    ctx->lut[idx + 0] = scale / (float)BRDF_LUT_SAMPLES;
+    ctx->lut[idx + 1] = bias / (float)BRDF_LUT_SAMPLES;
+    ctx->lut[idx + 2] = 0.0f;
+    ctx->lut[idx + 3] = 1.0f;
+  }
+}
 
+static const float *brdf_lut_shared(struct MopThreadPool *pool) {
+  pthread_mutex_lock(&s_brdf_lut_mutex);
+  if (!s_brdf_lut) {
+    float *lut =
+        malloc((size_t)BRDF_LUT_SIZE * BRDF_LUT_SIZE * 4 * sizeof(float));
+    BrdfLutCtx *ctx = malloc(sizeof(BrdfLutCtx));
+    if (lut && ctx) {
+      ctx->lut = lut;
       for (int s = 0; s < BRDF_LUT_SAMPLES; s++) {
-        float xi1 = (float)s / (float)BRDF_LUT_SAMPLES;
-        uint32_t bits = (uint32_t)s;
-        bits = (bits << 16u) | (bits >> 16u);
-        bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
-        bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
-        bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
-        bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
-        float xi2 = (float)bits * 2.3283064365386963e-10f;
-
-        /* GGX importance sample half vector in tangent space */
-        float cos_theta_h =
-            sqrtf((1.0f - xi1) / (1.0f + (alpha2 - 1.0f) * xi1));
-        float sin_theta_h = sqrtf(1.0f - cos_theta_h * cos_theta_h);
-        float phi_h = 2.0f * (float)M_PI * xi2;
-
-        float hx = sin_theta_h * cosf(phi_h);
-        float hy = sin_theta_h * sinf(phi_h);
-        float hz = cos_theta_h;
-
-        /* L = reflect(-V, H) */
-        float vdh = vx_t * hx + vy_t * hy + vz_t * hz;
-        /* float lx = 2.0f * vdh * hx - vx_t; — unused (N·L = lz) */
-        /* float ly = 2.0f * vdh * hy - vy_t; — unused (N·L = lz) */
-        float lz = 2.0f * vdh * hz - vz_t;
-
-        float ndl = lz; /* N = (0,0,1) in tangent space */
-        if (ndl <= 0.0f)
-          continue;
-
-        float ndh = hz;
-        float vdh_c = vdh > 0.0f ? vdh : 0.0f;
-
-        /* Geometry term (Smith-Schlick) */
-        float g1v_t = ndotv / (ndotv * (1.0f - k) + k);
-        float g1l_t = ndl / (ndl * (1.0f - k) + k);
-        float g = g1v_t * g1l_t;
-
-        /* Visibility = G * VdotH / (NdotH * NdotV) */
-        float vis = (g * vdh_c) / (ndh * ndotv + 1e-6f);
-
-        /* Fresnel: (1 - VdotH)^5 */
-        float fc = 1.0f - vdh_c;
-        float fc2 = fc * fc;
-        float fc5 = fc2 * fc2 * fc;
-
-        scale += vis * (1.0f - fc5);
-        bias += vis * fc5;
+        float xi2;
+        hammersley((uint32_t)s, BRDF_LUT_SAMPLES, &ctx->xi1[s], &xi2);
+        ctx->cos_phi[s] = cosf(2.0f * (float)M_PI * xi2);
       }
-
-      size_t idx = ((size_t)y * BRDF_LUT_SIZE + x) * 4;
-      lut[idx + 0] = scale / (float)BRDF_LUT_SAMPLES;
-      lut[idx + 1] = bias / (float)BRDF_LUT_SAMPLES;
-      lut[idx + 2] = 0.0f;
-      lut[idx + 3] = 1.0f;
+      mop_threadpool_parallel_rows(pool, BRDF_LUT_SIZE, brdf_lut_row, ctx);
+      s_brdf_lut = lut;
+    } else {
+      free(lut);
     }
+    free(ctx);
   }
+  pthread_mutex_unlock(&s_brdf_lut_mutex);
+  return s_brdf_lut;
+}
 
-  vp->env_brdf_lut_data = lut;
+static void acquire_brdf_lut(MopViewport *vp) {
+  if (!vp->env_brdf_lut_data)
+    vp->env_brdf_lut_data = brdf_lut_shared(vp->thread_pool);
+  if (vp->env_brdf_lut_data && !vp->env_brdf_lut &&
+      vp->rhi->texture_create_hdr) {
+    vp->env_brdf_lut = vp->rhi->texture_create_hdr(
+        vp->device, BRDF_LUT_SIZE, BRDF_LUT_SIZE, vp->env_brdf_lut_data);
+  }
+}
 
-  if (vp->rhi->texture_create_hdr) {
-    vp->env_brdf_lut = vp->rhi->texture_create_hdr(vp->device, BRDF_LUT_SIZE,
-                                                   BRDF_LUT_SIZE, lut);
+/* -------------------------------------------------------------------------
+ * IBL disk cache
+ *
+ * SH coefficients and the prefiltered chain are written to
+ * $HOME/.cache/mop/ibl/<hash>.bin (same root as the Vulkan pipeline
+ * cache), keyed by a hash of the decoded HDR pixels, so reloading an HDRI
+ * skips precomputation entirely.  Files carry the layout constants; any
+ * mismatch is treated as a miss and overwritten.
+ * ------------------------------------------------------------------------- */
+
+#define IBL_CACHE_MAGIC 0x4C42494Du /* "MIBL" */
+#define IBL_CACHE_VERSION 1u
+
+typedef struct IblCacheHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t content_hash;
+  int32_t prefilt_w, prefilt_h, prefilt_levels, prefilt_samples;
+} IblCacheHeader;
+
+/* 64-bit FNV-1a over 8-byte words with a final avalanche — byte-wise FNV
+ * is too slow for 100+ MB float images. */
+static uint64_t env_content_hash(const float *rgba, int w, int h) {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  hash = (hash ^ (uint64_t)(uint32_t)w) * 0x100000001b3ULL;
+  hash = (hash ^ (uint64_t)(uint32_t)h) * 0x100000001b3ULL;
+
+  const uint8_t *bytes = (const uint8_t *)rgba;
+  size_t len = (size_t)w * h * 4 * sizeof(float);
+  size_t i = 0;
+  for (; i + 8 <= len; i += 8) {
+    uint64_t word;
+    memcpy(&word, bytes + i, 8);
+    hash = ((hash << 27) | (hash >> 37)) ^ word;
+    hash *= 0x100000001b3ULL;
+  }
+  for (; i < len; i++)
+    hash = (hash ^ bytes[i]) * 0x100000001b3ULL;
+
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdULL;
+  hash ^= hash >> 33;
+  return hash ? hash : 1; /* 0 means "not cacheable" */
+}
+
+static bool ibl_cache_path(uint64_t hash, char *path, size_t size,
+                           bool create_dirs) {
+  const char *home = getenv("HOME");
+  if (!home)
+    return false;
+  if (create_dirs) {
+    char dir[512];
+    snprintf(dir, sizeof(dir), "%s/.cache", home);
+    mkdir(dir, 0755);
+    snprintf(dir, sizeof(dir), "%s/.cache/mop", home);
+    mkdir(dir, 0755);
+    snprintf(dir, sizeof(dir), "%s/.cache/mop/ibl", home);
+    mkdir(dir, 0755);
+  }
+  int n = snprintf(path, size, "%s/.cache/mop/ibl/%016llx.bin", home,
+                   (unsigned long long)hash);
+  return n > 0 && (size_t)n < size;
+}
+
+static IblCacheHeader ibl_cache_header(uint64_t hash) {
+  return (IblCacheHeader){
+      .magic = IBL_CACHE_MAGIC,
+      .version = IBL_CACHE_VERSION,
+      .content_hash = hash,
+      .prefilt_w = PREFILT_BASE_W,
+      .prefilt_h = PREFILT_BASE_H,
+      .prefilt_levels = PREFILT_LEVELS,
+      .prefilt_samples = PREFILT_SAMPLES,
+  };
+}
+
+static bool ibl_cache_load(MopViewport *vp, uint64_t hash) {
+  char path[512];
+  if (!ibl_cache_path(hash, path, sizeof(path), false))
+    return false;
+  FILE *f = fopen(path, "rb");
+  if (!f)
+    return false;
+
+  IblCacheHeader expect = ibl_cache_header(hash), got;
+  size_t texels = prefiltered_texel_count();
+  float *buf = NULL;
+  bool ok = fread(&got, sizeof(got), 1, f) == 1 &&
+            memcmp(&got, &expect, sizeof(got)) == 0 &&
+            fread(vp->env_irradiance_sh, sizeof(vp->env_irradiance_sh), 1,
+                  f) == 1 &&
+            (buf = malloc(texels * 4 * sizeof(float))) != NULL &&
+            fread(buf, sizeof(float), texels * 4, f) == texels * 4;
+  fclose(f);
+  if (!ok) {
+    free(buf);
+    return false;
+  }
+
+  vp->env_irradiance_sh_valid = true;
+  vp->env_prefiltered_data = buf;
+  vp->env_prefiltered_w = PREFILT_BASE_W;
+  vp->env_prefiltered_h = PREFILT_BASE_H;
+  vp->env_prefiltered_levels = PREFILT_LEVELS;
+  MOP_INFO("[env] IBL cache hit: %s", path);
+  return true;
+}
+
+static void ibl_cache_store(const MopViewport *vp, uint64_t hash) {
+  if (!vp->env_irradiance_sh_valid || !vp->env_prefiltered_data)
+    return;
+  char path[512], tmp[540];
+  if (!ibl_cache_path(hash, path, sizeof(path), true))
+    return;
+  /* Write-then-rename so a concurrent reader never sees a partial file */
+  snprintf(tmp, sizeof(tmp), "%s.%ld.tmp", path, (long)getpid());
+  FILE *f = fopen(tmp, "wb");
+  if (!f)
+    return;
+
+  IblCacheHeader hdr = ibl_cache_header(hash);
+  size_t texels = prefiltered_texel_count();
+  bool ok = fwrite(&hdr, sizeof(hdr), 1, f) == 1 &&
+            fwrite(vp->env_irradiance_sh, sizeof(vp->env_irradiance_sh), 1,
+                   f) == 1 &&
+            fwrite(vp->env_prefiltered_data, sizeof(float), texels * 4, f) ==
+                texels * 4;
+  ok = fclose(f) == 0 && ok;
+  if (ok && rename(tmp, path) == 0) {
+    MOP_INFO("[env] IBL cache stored: %s", path);
+  } else {
+    remove(tmp);
+    MOP_WARN("[env] IBL cache write failed: %s", path);
   }
 }
 
+/* -------------------------------------------------------------------------
+ * IBL entry points
+ * ------------------------------------------------------------------------- */
+
+static void env_release_ibl(MopViewport *vp) {
+  if (vp->env_irradiance) {
+    vp->rhi->texture_destroy(vp->device, vp->env_irradiance);
+    vp->env_irradiance = NULL;
+  }
+  if (vp->env_prefiltered) {
+    vp->rhi->texture_destroy(vp->device, vp->env_prefiltered);
+    vp->env_prefiltered = NULL;
+  }
+  free(vp->env_irradiance_data);
+  vp->env_irradiance_data = NULL;
+  free(vp->env_prefiltered_data);
+  vp->env_prefiltered_data = NULL;
+  vp->env_irradiance_sh_valid = false;
+}
+
+/* Build irradiance + prefiltered maps for env_hdr_data and bind the shared
+ * BRDF LUT.  cache_key == 0 disables the disk cache (procedural sky is
+ * regenerated on every parameter change and is cheap to rebuild). */
+static void env_precompute_ibl(MopViewport *vp, uint64_t cache_key) {
+  if (!vp->env_hdr_data)
+    return;
+
+  if (!cache_key || !ibl_cache_load(vp, cache_key)) {
+    EnvPyramid pyr;
+    env_pyramid_build(vp, &pyr);
+    project_irradiance_sh(vp, &pyr);
+    precompute_prefiltered(vp, &pyr);
+    env_pyramid_free(&pyr);
+    if (cache_key)
+      ibl_cache_store(vp, cache_key);
+  }
+
+  bake_irradiance_map(vp);
+
+  /* Create GPU texture from level 0 only (levels available via CPU sampling) */
+  if (vp->env_prefiltered_data && vp->rhi->texture_create_hdr) {
+    vp->env_prefiltered = vp->rhi->texture_create_hdr(
+        vp->device, PREFILT_BASE_W, PREFILT_BASE_H, vp->env_prefiltered_data);
+  }
+
+  acquire_brdf_lut(vp);
+}
+
 /* -------------------------------------------------------------------------
  * Procedural sky: Preetham analytical sky model
  *
@@ -720,9 +1156,7 @@ bool mop_viewport_set_environment(MopViewport *vp,
       };
     }
     generate_procedural_sky(vp);
-    precompute_irradiance(vp);
-    precompute_prefiltered(vp);
-    precompute_brdf_lut(vp);
+    env_precompute_ibl(vp, 0);
     MOP_VP_UNLOCK(vp);
     return true;
   }
@@ -834,10 +1268,8 @@ bool mop_viewport_set_environment(MopViewport *vp,
     }
   }
 
-  /* Precompute IBL maps */
-  precompute_irradiance(vp);
-  precompute_prefiltered(vp);
-  precompute_brdf_lut(vp);
+  /* Precompute IBL maps (or reload them from the disk cache) */
+  env_precompute_ibl(vp, env_content_hash(rgba, w, h));
 
   MOP_INFO("loaded %s environment: %dx%d (%s)", is_exr ? "EXR" : "HDR", w, h,
            desc->hdr_path);
@@ -886,22 +1318,9 @@ void mop_viewport_set_procedural_sky(MopViewport *vp,
   if (vp->env_type == MOP_ENV_PROCEDURAL_SKY) {
     /* Regenerate sky texture */
     generate_procedural_sky(vp);
-    /* Re-precompute IBL */
-    if (vp->env_irradiance) {
-      vp->rhi->texture_destroy(vp->device, vp->env_irradiance);
-      vp->env_irradiance = NULL;
-    }
-    free(vp->env_irradiance_data);
-    vp->env_irradiance_data = NULL;
-    precompute_irradiance(vp);
-
-    if (vp->env_prefiltered) {
-      vp->rhi->texture_destroy(vp->device, vp->env_prefiltered);
-      vp->env_prefiltered = NULL;
-    }
-    free(vp->env_prefiltered_data);
-    vp->env_prefiltered_data = NULL;
-    precompute_prefiltered(vp);
+    /* Re-precompute IBL (BRDF LUT is environment-independent) */
+    env_release_ibl(vp);
+    env_precompute_ibl(vp, 0);
   }
   MOP_VP_UNLOCK(vp);
 }
@@ -915,7 +1334,7 @@ void mop_viewport_set_procedural_sky(MopViewport *vp,
 void mop_env_sample_irradiance(const MopViewport *vp, MopVec3 normal,
                                float out[3]) {
   out[0] = out[1] = out[2] = 0.0f;
-  if (!vp->env_irradiance_data)
+  if (!vp->env_irradiance_data && !vp->env_irradiance_sh_valid)
     return;
 
   float len =
@@ -924,6 +1343,18 @@ void mop_env_sample_irradiance(const MopViewport *vp, MopVec3 normal,
     return;
   float nx = normal.x / len, ny = normal.y / len, nz = normal.z / len;
 
+  /* Evaluate SH directly — exact, and no map filtering at the seam.
+   * Rotating the lookup azimuth by +rotation matches dir_to_equirect. */
+  if (vp->env_irradiance_sh_valid) {
+    float cr = cosf(vp->env_rotation), sr = sinf(vp->env_rotation);
+    sh9_eval((const float(*)[3])vp->env_irradiance_sh, nx * cr - nz * sr, ny,
+             nx * sr + nz * cr, out);
+    out[0] *= vp->env_intensity;
+    out[1] *= vp->env_intensity;
+    out[2] *= vp->env_intensity;
+    return;
+  }
+
   float u, v;
   dir_to_equirect(nx, ny, nz, vp->env_rotation, &u, &v);
 
@@ -0,0 +1,185 @@
+/*
+ * Master of Puppets — Selection
+ * id_set.c — Hash set of uint32 ids indexing a dense list
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "core/id_set.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define ID_SET_MIN_CAPACITY 64u
+
+static inline uint32_t id_hash(uint32_t id) {
+  /* Murmur3 finalizer: packed edge ids and runs of indices spread well */
+  id ^= id >> 16;
+  id *= 0x85EBCA6Bu;
+  id ^= id >> 13;
+  id *= 0xC2B2AE35u;
+  id ^= id >> 16;
+  return id;
+}
+
+uint32_t mop_id_set_find(const MopIdSet *s, uint32_t id) {
+  if (!s)
+    return UINT32_MAX;
+  if (id == MOP_ID_SET_EMPTY)
+    return s->has_empty_key ? s->empty_key_index : UINT32_MAX;
+  if (s->capacity == 0)
+    return UINT32_MAX;
+  uint32_t mask = s->capacity - 1;
+  for (uint32_t i = id_hash(id) & mask;; i = (i + 1) & mask) {
+    if (s->keys[i] == id)
+      return s->index[i];
+    if (s->keys[i] == MOP_ID_SET_EMPTY)
+      return UINT32_MAX;
+  }
+}
+
+static bool id_set_rehash(MopIdSet *s, uint32_t capacity) {
+  uint32_t *keys = malloc((size_t)capacity * sizeof(uint32_t));
+  uint32_t *index = malloc((size_t)capacity * sizeof(uint32_t));
+  if (!keys || !index) {
+    free(keys);
+    free(index);
+    return false;
+  }
+  memset(keys, 0xFF, (size_t)capacity * sizeof(uint32_t));
+  uint32_t mask = capacity - 1;
+  for (uint32_t j = 0; j < s->capacity; j++) {
+    uint32_t id = s->keys[j];
+    if (id == MOP_ID_SET_EMPTY)
+      continue;
+    uint32_t i = id_hash(id) & mask;
+    while (keys[i] != MOP_ID_SET_EMPTY)
+      i = (i + 1) & mask;
+    keys[i] = id;
+    index[i] = s->index[j];
+  }
+  free(s->keys);
+  free(s->index);
+  s->keys = keys;
+  s->index = index;
+  s->capacity = capacity;
+  return true;
+}
+
+bool mop_id_set_put(MopIdSet *s, uint32_t id, uint32_t position) {
+  if (!s)
+    return false;
+  if (id == MOP_ID_SET_EMPTY) {
+    s->has_empty_key = true;
+    s->empty_key_index = position;
+    return true;
+  }
+  /* Moving a member never reallocates */
+  for (int pass = 0; pass < 2; pass++) {
+    if (s->capacity) {
+      uint32_t mask = s->capacity - 1;
+      uint32_t i = id_hash(id) & mask;
+      while (s->keys[i] != MOP_ID_SET_EMPTY && s->keys[i] != id)
+        i = (i + 1) & mask;
+      if (s->keys[i] == id || (s->count + 1) * 2 <= s->capacity) {
+        if (s->keys[i] != id) {
+          s->keys[i] = id;
+          s->count++;
+        }
+        s->index[i] = position;
+        return true;
+      }
+    }
+    uint32_t cap = s->capacity ? s->capacity * 2 : ID_SET_MIN_CAPACITY;
+    if (cap < s->capacity || !id_set_rehash(s, cap))
+      return false;
+  }
+  return false;
+}
+
+bool mop_id_set_remove(MopIdSet *s, uint32_t id) {
+  if (!s)
+    return false;
+  if (id == MOP_ID_SET_EMPTY) {
+    bool had = s->has_empty_key;
+    s->has_empty_key = false;
+    return had;
+  }
+  if (s->capacity == 0)
+    return false;
+  uint32_t mask = s->capacity - 1;
+  uint32_t i = id_hash(id) & mask;
+  while (s->keys[i] != id) {
+    if (s->keys[i] == MOP_ID_SET_EMPTY)
+      return false;
+    i = (i + 1) & mask;
+  }
+
+  /* Backward-shift: pull later entries of the probe run into the hole
+   * unless that would move them before their home slot */
+  for (uint32_t j = (i + 1) & mask;; j = (j + 1) & mask) {
+    uint32_t k = s->keys[j];
+    if (k == MOP_ID_SET_EMPTY)
+      break;
+    uint32_t home = id_hash(k) & mask;
+    if (((j - home) & mask) >= ((j - i) & mask)) {
+      s->keys[i] = k;
+      s->index[i] = s->index[j];
+      i = j;
+    }
+  }
+  s->keys[i] = MOP_ID_SET_EMPTY;
+  s->count--;
+  return true;
+}
+
+void mop_id_set_clear(MopIdSet *s) {
+  if (!s)
+    return;
+  if (s->capacity)
+    memset(s->keys, 0xFF, (size_t)s->capacity * sizeof(uint32_t));
+  s->count = 0;
+  s->has_empty_key = false;
+}
+
+void mop_id_set_free(MopIdSet *s) {
+  if (!s)
+    return;
+  free(s->keys);
+  free(s->index);
+  memset(s, 0, sizeof(*s));
+}
+
+bool mop_id_list_add(MopIdSet *s, uint32_t **list, uint32_t *count,
+                     uint32_t *capacity, uint32_t id) {
+  if (mop_id_set_contains(s, id))
+    return false;
+  if (*count == *capacity) {
+    uint32_t cap = *capacity ? *capacity * 2 : ID_SET_MIN_CAPACITY;
+    if (cap < *capacity)
+      return false;
+    uint32_t *grown = realloc(*list, (size_t)cap * sizeof(uint32_t));
+    if (!grown)
+      return false;
+    *list = grown;
+    *capacity = cap;
+  }
+  if (!mop_id_set_put(s, id, *count))
+    return false;
+  (*list)[(*count)++] = id;
+  return true;
+}
+
+bool mop_id_list_remove(MopIdSet *s, uint32_t *list, uint32_t *count,
+                        uint32_t id) {
+  uint32_t pos = mop_id_set_find(s, id);
+  if (pos == UINT32_MAX)
+    return false;
+  mop_id_set_remove(s, id);
+  uint32_t last = --(*count);
+  if (pos != last) {
+    list[pos] = list[last];
+    mop_id_set_put(s, list[pos], pos);
+  }
+  return true;
+}
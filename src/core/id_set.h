@@ -0,0 +1,62 @@
+/*
+ * Master of Puppets — Selection
+ * id_set.h — Hash set of uint32 ids indexing a dense list
+ *
+ * Selections keep their members in a plain array for iteration (the
+ * public MopSelection.elements, MopViewport.selected_ids) and this set on
+ * the side, mapping each id to its position in that array.  Membership,
+ * insertion and swap-remove are O(1), so selecting or deselecting a
+ * hundred thousand elements is linear instead of quadratic.
+ *
+ * Open addressing with linear probing and backward-shift deletion; the
+ * table stays at most half full.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef MOP_CORE_ID_SET_H
+#define MOP_CORE_ID_SET_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct MopIdSet {
+  uint32_t *keys;  /* MOP_ID_SET_EMPTY marks a free slot */
+  uint32_t *index; /* position of keys[i] in the owner's list */
+  uint32_t capacity; /* power of two, 0 before the first insert */
+  uint32_t count;
+  bool has_empty_key; /* MOP_ID_SET_EMPTY itself is a member */
+  uint32_t empty_key_index;
+} MopIdSet;
+
+#define MOP_ID_SET_EMPTY UINT32_MAX
+
+/* Position of id, or UINT32_MAX when it is not a member */
+uint32_t mop_id_set_find(const MopIdSet *s, uint32_t id);
+
+static inline bool mop_id_set_contains(const MopIdSet *s, uint32_t id) {
+  return mop_id_set_find(s, id) != UINT32_MAX;
+}
+
+/* Insert id at position, or move it there if already a member.  Returns
+ * false on allocation failure. */
+bool mop_id_set_put(MopIdSet *s, uint32_t id, uint32_t position);
+
+/* Returns false when id was not a member */
+bool mop_id_set_remove(MopIdSet *s, uint32_t id);
+
+/* Drop every member, keeping the table */
+void mop_id_set_clear(MopIdSet *s);
+
+void mop_id_set_free(MopIdSet *s);
+
+/* Add id to the end of list (growing it by doubling) unless it is already
+ * a member.  Returns true if it was added. */
+bool mop_id_list_add(MopIdSet *s, uint32_t **list, uint32_t *count,
+                     uint32_t *capacity, uint32_t id);
+
+/* Swap-remove id from list.  Returns true if it was a member. */
+bool mop_id_list_remove(MopIdSet *s, uint32_t *list, uint32_t *count,
+                        uint32_t id);
+
+#endif /* MOP_CORE_ID_SET_H */
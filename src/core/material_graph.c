@@ -5,6 +5,7 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include "core/material_program.h"
 #include "core/viewport_internal.h"
 
 #include <math.h>
@@ -1039,6 +1040,48 @@ bool mop_mat_graph_compile(MopMaterialGraph *graph, MopViewport *vp,
   return true;
 }
 
+/* -------------------------------------------------------------------------
+ * Mesh attachment — flat material plus the CPU per-pixel program
+ * ------------------------------------------------------------------------- */
+
+bool mop_mesh_set_material_graph(MopMesh *mesh, MopMaterialGraph *graph) {
+  if (!mesh)
+    return false;
+  MopViewport *vp = mesh->viewport;
+
+  if (!graph) {
+    MOP_VP_LOCK(vp);
+    free(mesh->material_program);
+    mesh->material_program = NULL;
+    MOP_VP_UNLOCK(vp);
+    return true;
+  }
+
+  MopMaterial material;
+  if (!mop_mat_graph_compile(graph, vp, &material))
+    return false;
+
+  /* Only the CPU rasterizer runs programs */
+  MopSwMatProgram *prog = NULL;
+  if (vp && vp->backend_type == MOP_BACKEND_CPU) {
+    prog = malloc(sizeof(*prog));
+    if (!prog) {
+      MOP_WARN("mop_mesh_set_material_graph: out of memory");
+    } else if (!mop_mat_program_compile(graph, vp, prog)) {
+      free(prog);
+      prog = NULL;
+    }
+  }
+
+  MOP_VP_LOCK(vp);
+  mesh->material = material;
+  mesh->has_material = true;
+  free(mesh->material_program);
+  mesh->material_program = prog;
+  MOP_VP_UNLOCK(vp);
+  return true;
+}
+
 /* -------------------------------------------------------------------------
  * Cleanup
  * ------------------------------------------------------------------------- */
@@ -0,0 +1,535 @@
+/*
+ * Master of Puppets — Material Graph
+ * material_program.c — Lowering material graphs to per-pixel programs
+ *
+ * Nodes are visited depth first from the output node, as in the flat
+ * compiler of material_graph.c, but each evaluates to a vector of
+ * operands — constants or registers — instead of numbers.  Operations
+ * on constant operands fold at compile time; the rest emit instructions
+ * into an SSA scratch program with a large register space.  Dead code
+ * elimination and register compaction then produce the final program.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "core/material_program.h"
+#include "core/viewport_internal.h"
+
+#include <math.h>
+#include <mop/core/texture_pipeline.h>
+#include <mop/util/log.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MP_MAX_REGS 1024 /* scratch register space, before compaction */
+#define MP_MAX_CODE 1024
+
+/* ---- operands and values ---- */
+
+typedef struct MpOperand {
+  bool is_k;
+  float k;      /* value when is_k */
+  uint16_t reg; /* register otherwise */
+} MpOperand;
+
+typedef struct MpValue {
+  int width; /* 1, 3 or 4 */
+  bool texel; /* straight from a texture sample (RGBA) */
+  MpOperand c[4];
+} MpValue;
+
+typedef struct MpInstr {
+  uint8_t op;
+  uint16_t dst, a, b, c; /* c is a texture slot for MOP_SW_MAT_OP_TEX */
+} MpInstr;
+
+typedef struct MpCtx {
+  const MopMaterialGraph *graph;
+  MopViewport *vp;
+  MopSwMatProgram *out;
+  bool failed;
+
+  MpInstr code[MP_MAX_CODE];
+  uint32_t code_count;
+  uint16_t reg_count;
+  bool is_const[MP_MAX_REGS];
+  float kval[MP_MAX_REGS];
+
+  MpValue cache[MOP_MAT_MAX_NODES];
+  bool cached[MOP_MAT_MAX_NODES];
+  bool on_stack[MOP_MAT_MAX_NODES];
+} MpCtx;
+
+static MpOperand mp_k(float k) { return (MpOperand){.is_k = true, .k = k}; }
+
+static MpOperand mp_r(uint16_t reg) { return (MpOperand){.reg = reg}; }
+
+static bool mp_is(MpOperand o, float k) { return o.is_k && o.k == k; }
+
+static bool mp_same(MpOperand a, MpOperand b) {
+  return a.is_k == b.is_k && (a.is_k ? a.k == b.k : a.reg == b.reg);
+}
+
+static MpValue mp_splat(MpOperand o, int width) {
+  MpValue v = {.width = width};
+  for (int i = 0; i < width; i++)
+    v.c[i] = o;
+  return v;
+}
+
+/* Component i, broadcasting scalars and clamping to the last component */
+static MpOperand mp_comp(const MpValue *v, int i) {
+  int last = v->width > 1 ? v->width - 1 : 0;
+  return v->c[i < last ? i : last];
+}
+
+/* Result width of a component-wise binary operation */
+static int mp_width(const MpValue *a, const MpValue *b) {
+  if (a->width == 1)
+    return b->width;
+  if (b->width == 1)
+    return a->width;
+  return a->width < b->width ? a->width : b->width;
+}
+
+/* ---- registers and emission ---- */
+
+static uint16_t mp_alloc(MpCtx *c, int n) {
+  if (c->reg_count + n > MP_MAX_REGS) {
+    c->failed = true;
+    return 0;
+  }
+  uint16_t r = c->reg_count;
+  c->reg_count = (uint16_t)(c->reg_count + n);
+  return r;
+}
+
+/* Register holding o; constants are interned once per value */
+static uint16_t mp_reg(MpCtx *c, MpOperand o) {
+  if (!o.is_k)
+    return o.reg;
+  for (uint16_t r = MOP_SW_MAT_REG_VARYINGS; r < c->reg_count; r++)
+    if (c->is_const[r] && memcmp(&c->kval[r], &o.k, sizeof(float)) == 0)
+      return r;
+  uint16_t r = mp_alloc(c, 1);
+  c->is_const[r] = true;
+  c->kval[r] = o.k;
+  return r;
+}
+
+static MpOperand mp_emit(MpCtx *c, MopSwMatOp op, MpOperand a, MpOperand b,
+                         MpOperand k) {
+  if (c->code_count >= MP_MAX_CODE) {
+    c->failed = true;
+    return mp_k(0.0f);
+  }
+  MpInstr in = {.op = (uint8_t)op};
+  in.a = mp_reg(c, a);
+  in.b = mp_reg(c, b);
+  in.c = (op == MOP_SW_MAT_OP_MAD || op == MOP_SW_MAT_OP_MIX) ? mp_reg(c, k)
+                                                               : 0;
+  in.dst = mp_alloc(c, 1);
+  c->code[c->code_count++] = in;
+  return mp_r(in.dst);
+}
+
+static MpOperand mp_mul(MpCtx *c, MpOperand a, MpOperand b) {
+  if (a.is_k && b.is_k)
+    return mp_k(a.k * b.k);
+  if (mp_is(a, 0.0f) || mp_is(b, 0.0f))
+    return mp_k(0.0f);
+  if (mp_is(a, 1.0f))
+    return b;
+  if (mp_is(b, 1.0f))
+    return a;
+  return mp_emit(c, MOP_SW_MAT_OP_MUL, a, b, mp_k(0.0f));
+}
+
+static MpOperand mp_add(MpCtx *c, MpOperand a, MpOperand b) {
+  if (a.is_k && b.is_k)
+    return mp_k(a.k + b.k);
+  if (mp_is(a, 0.0f))
+    return b;
+  if (mp_is(b, 0.0f))
+    return a;
+  return mp_emit(c, MOP_SW_MAT_OP_ADD, a, b, mp_k(0.0f));
+}
+
+static MpOperand mp_mad(MpCtx *c, MpOperand a, MpOperand b, MpOperand k) {
+  if ((a.is_k && b.is_k) || mp_is(a, 0.0f) || mp_is(b, 0.0f) ||
+      mp_is(a, 1.0f) || mp_is(b, 1.0f) || mp_is(k, 0.0f))
+    return mp_add(c, mp_mul(c, a, b), k);
+  return mp_emit(c, MOP_SW_MAT_OP_MAD, a, b, k);
+}
+
+static MpOperand mp_mix(MpCtx *c, MpOperand a, MpOperand b, MpOperand t) {
+  if (mp_is(t, 0.0f) || mp_same(a, b))
+    return a;
+  if (mp_is(t, 1.0f))
+    return b;
+  if (a.is_k && b.is_k && t.is_k)
+    return mp_k(a.k + (b.k - a.k) * t.k);
+  return mp_emit(c, MOP_SW_MAT_OP_MIX, a, b, t);
+}
+
+static MpOperand mp_schlick(MpCtx *c, MpOperand f0, MpOperand ndv) {
+  if (mp_is(f0, 1.0f))
+    return f0;
+  return mp_emit(c, MOP_SW_MAT_OP_SCHLICK, f0, ndv, mp_k(0.0f));
+}
+
+/* ---- nodes ---- */
+
+static int mp_find_input(const MopMaterialGraph *g, uint32_t node,
+                         uint32_t slot) {
+  for (uint32_t i = 0; i < g->connection_count; i++)
+    if (g->connections[i].dst_node == node &&
+        g->connections[i].dst_input == slot)
+      return (int)i;
+  return -1;
+}
+
+static MpValue mp_node(MpCtx *c, uint32_t idx);
+
+static MpValue mp_input(MpCtx *c, uint32_t node, uint32_t slot,
+                        MpValue fallback) {
+  int ci = mp_find_input(c->graph, node, slot);
+  if (ci < 0)
+    return fallback;
+  return mp_node(c, c->graph->connections[ci].src_node);
+}
+
+static MpValue mp_mesh_uv(void) {
+  MpValue v = {.width = 3};
+  v.c[0] = mp_r(MOP_SW_MAT_REG_U);
+  v.c[1] = mp_r(MOP_SW_MAT_REG_V);
+  v.c[2] = mp_k(0.0f);
+  return v;
+}
+
+/* UVs a texture sample node reads: its input 0, else the mesh UVs */
+static MpValue mp_sample_uv(MpCtx *c, uint32_t node) {
+  return mp_input(c, node, 0, mp_mesh_uv());
+}
+
+/* uv * scale, rotated, plus offset; a zero scale reads as 1 (unset) */
+static MpValue mp_uv_transform(MpCtx *c, const MopMatNode *n, MpValue uv) {
+  float su = n->params.uv_transform.scale[0];
+  float sv = n->params.uv_transform.scale[1];
+  su = su == 0.0f ? 1.0f : su;
+  sv = sv == 0.0f ? 1.0f : sv;
+  float cr = cosf(n->params.uv_transform.rotation);
+  float sr = sinf(n->params.uv_transform.rotation);
+  MpOperand u = mp_comp(&uv, 0), v = mp_comp(&uv, 1);
+  MpValue r = {.width = 3};
+  r.c[0] = mp_mad(c, mp_k(cr * su), u,
+                  mp_mad(c, mp_k(-sr * sv), v,
+                         mp_k(n->params.uv_transform.offset[0])));
+  r.c[1] = mp_mad(c, mp_k(sr * su), u,
+                  mp_mad(c, mp_k(cr * sv), v,
+                         mp_k(n->params.uv_transform.offset[1])));
+  r.c[2] = mp_k(0.0f);
+  return r;
+}
+
+static MpValue mp_texture(MpCtx *c, const MopMatNode *n, MpValue uv) {
+  MpValue white = mp_splat(mp_k(1.0f), 4);
+  const MopMaterialGraph *g = c->graph;
+  int32_t ti = n->params.texture_sample.texture_index;
+  if (!c->vp || ti < 0 || (uint32_t)ti >= g->texture_count)
+    return white;
+  MopTexture *tex = mop_tex_load_async(c->vp, g->texture_paths[ti]);
+  if (!tex || !tex->rhi_texture)
+    return white;
+
+  MopSwMatProgram *p = c->out;
+  uint32_t slot = 0;
+  while (slot < p->texture_count && p->textures[slot] != tex->rhi_texture)
+    slot++;
+  if (slot == p->texture_count) {
+    if (slot >= MOP_SW_MAT_MAX_TEXTURES)
+      return white;
+    p->textures[p->texture_count++] = tex->rhi_texture;
+  }
+  if (c->code_count >= MP_MAX_CODE) {
+    c->failed = true;
+    return white;
+  }
+
+  MpInstr in = {.op = MOP_SW_MAT_OP_TEX, .c = (uint16_t)slot};
+  in.a = mp_reg(c, mp_comp(&uv, 0));
+  in.b = mp_reg(c, mp_comp(&uv, 1));
+  in.dst = mp_alloc(c, 4);
+  c->code[c->code_count++] = in;
+
+  MpValue r = {.width = 4, .texel = true};
+  for (int i = 0; i < 4; i++)
+    r.c[i] = mp_r((uint16_t)(in.dst + i));
+  return r;
+}
+
+static MpValue mp_node(MpCtx *c, uint32_t idx) {
+  MpValue r = mp_splat(mp_k(0.0f), 1);
+  const MopMaterialGraph *g = c->graph;
+  if (idx >= g->node_count || c->failed)
+    return r;
+  if (c->on_stack[idx]) {
+    MOP_WARN("mop_mat_program_compile: cycle detected at node %u", idx);
+    c->failed = true;
+    return r;
+  }
+  if (c->cached[idx])
+    return c->cache[idx];
+
+  c->on_stack[idx] = true;
+  const MopMatNode *n = &g->nodes[idx];
+
+  switch (n->type) {
+  case MOP_MAT_NODE_CONSTANT_FLOAT:
+    r = mp_splat(mp_k(n->params.constant_float.value), 1);
+    break;
+
+  case MOP_MAT_NODE_CONSTANT_VEC3:
+    r.width = 3;
+    for (int i = 0; i < 3; i++)
+      r.c[i] = mp_k(n->params.constant_vec3.rgb[i]);
+    break;
+
+  case MOP_MAT_NODE_CONSTANT_VEC4:
+    r.width = 4;
+    for (int i = 0; i < 4; i++)
+      r.c[i] = mp_k(n->params.constant_vec4.rgba[i]);
+    break;
+
+  case MOP_MAT_NODE_TEXTURE_SAMPLE:
+    r = mp_texture(c, n, mp_sample_uv(c, idx));
+    break;
+
+  case MOP_MAT_NODE_NORMAL_MAP:
+    /* Pass-through, as in the flat compiler */
+    r = mp_input(c, idx, 0, r);
+    break;
+
+  case MOP_MAT_NODE_MIX: {
+    MpValue zero = mp_splat(mp_k(0.0f), 1);
+    MpValue a = mp_input(c, idx, 0, zero);
+    MpValue b = mp_input(c, idx, 1, zero);
+    MpValue f = mp_input(c, idx, 2, mp_splat(mp_k(n->params.mix.factor), 1));
+    MpOperand t = mp_comp(&f, 0);
+    r.width = mp_width(&a, &b);
+    for (int i = 0; i < r.width; i++)
+      r.c[i] = mp_mix(c, mp_comp(&a, i), mp_comp(&b, i), t);
+    break;
+  }
+
+  case MOP_MAT_NODE_MULTIPLY: {
+    MpValue one = mp_splat(mp_k(1.0f), 1);
+    MpValue a = mp_input(c, idx, 0, one);
+    MpValue b = mp_input(c, idx, 1, one);
+    r.width = mp_width(&a, &b);
+    for (int i = 0; i < r.width; i++)
+      r.c[i] = mp_mul(c, mp_comp(&a, i), mp_comp(&b, i));
+    break;
+  }
+
+  case MOP_MAT_NODE_ADD: {
+    MpValue zero = mp_splat(mp_k(0.0f), 1);
+    MpValue a = mp_input(c, idx, 0, zero);
+    MpValue b = mp_input(c, idx, 1, zero);
+    r.width = mp_width(&a, &b);
+    for (int i = 0; i < r.width; i++)
+      r.c[i] = mp_add(c, mp_comp(&a, i), mp_comp(&b, i));
+    break;
+  }
+
+  case MOP_MAT_NODE_FRESNEL: {
+    /* Schlick with F0 from the IOR, at the pixel's N.V */
+    float ior = n->params.fresnel.ior;
+    if (ior <= 0.0f)
+      ior = 1.5f;
+    float f0 = (ior - 1.0f) / (ior + 1.0f);
+    r = mp_splat(mp_schlick(c, mp_k(f0 * f0), mp_r(MOP_SW_MAT_REG_NDOTV)),
+                 1);
+    break;
+  }
+
+  case MOP_MAT_NODE_UV_TRANSFORM: {
+    /* Applied to a texture sample it moves the sample; on any other input
+     * it passes through as in the flat compiler; unconnected it yields
+     * the transformed mesh UVs (u, v, 0). */
+    int ci = mp_find_input(g, idx, 0);
+    if (ci < 0) {
+      r = mp_uv_transform(c, n, mp_mesh_uv());
+      break;
+    }
+    uint32_t src = g->connections[ci].src_node;
+    if (src < g->node_count &&
+        g->nodes[src].type == MOP_MAT_NODE_TEXTURE_SAMPLE &&
+        !c->on_stack[src]) {
+      c->on_stack[src] = true;
+      MpValue uv = mp_uv_transform(c, n, mp_sample_uv(c, src));
+      r = mp_texture(c, &g->nodes[src], uv);
+      c->on_stack[src] = false;
+    } else {
+      r = mp_node(c, src);
+    }
+    break;
+  }
+
+  case MOP_MAT_NODE_VERTEX_COLOR:
+    r.width = 4;
+    for (int i = 0; i < 4; i++)
+      r.c[i] = mp_r((uint16_t)(MOP_SW_MAT_REG_R + i));
+    break;
+
+  case MOP_MAT_NODE_OUTPUT:
+  case MOP_MAT_NODE_COUNT:
+    break;
+  }
+
+  c->on_stack[idx] = false;
+  c->cache[idx] = r;
+  c->cached[idx] = true;
+  return r;
+}
+
+/* ---- dead code elimination and register compaction ---- */
+
+static bool mp_finish(MpCtx *c, const uint16_t out_regs[MOP_SW_MAT_OUT_COUNT]) {
+  MopSwMatProgram *p = c->out;
+  bool live[MP_MAX_REGS] = {false};
+  bool keep[MP_MAX_CODE] = {false};
+
+  for (int i = 0; i < MOP_SW_MAT_OUT_COUNT; i++)
+    live[out_regs[i]] = true;
+  for (uint32_t i = c->code_count; i-- > 0;) {
+    const MpInstr *in = &c->code[i];
+    int defs = in->op == MOP_SW_MAT_OP_TEX ? 4 : 1;
+    for (int k = 0; k < defs; k++)
+      keep[i] = keep[i] || live[in->dst + k];
+    if (!keep[i])
+      continue;
+    live[in->a] = live[in->b] = true;
+    if (in->op == MOP_SW_MAT_OP_MAD || in->op == MOP_SW_MAT_OP_MIX)
+      live[in->c] = true;
+  }
+
+  /* Varyings keep their numbers, then live constants, then temporaries
+   * in definition order */
+  uint16_t map[MP_MAX_REGS];
+  uint32_t next = MOP_SW_MAT_REG_VARYINGS;
+  for (uint16_t r = 0; r < MOP_SW_MAT_REG_VARYINGS; r++) {
+    map[r] = r;
+    if (live[r])
+      p->varyings |= 1u << r;
+  }
+  for (uint16_t r = MOP_SW_MAT_REG_VARYINGS; r < c->reg_count; r++) {
+    if (!c->is_const[r] || !live[r])
+      continue;
+    if (next >= MOP_SW_MAT_MAX_REGS)
+      return false;
+    p->consts[next - MOP_SW_MAT_REG_VARYINGS] = c->kval[r];
+    map[r] = (uint16_t)next++;
+  }
+  p->const_count = next - MOP_SW_MAT_REG_VARYINGS;
+
+  for (uint32_t i = 0; i < c->code_count; i++) {
+    if (!keep[i])
+      continue;
+    const MpInstr *in = &c->code[i];
+    int defs = in->op == MOP_SW_MAT_OP_TEX ? 4 : 1;
+    if (next + (uint32_t)defs > MOP_SW_MAT_MAX_REGS ||
+        p->code_count >= MOP_SW_MAT_MAX_CODE)
+      return false;
+    for (int k = 0; k < defs; k++)
+      map[in->dst + k] = (uint16_t)(next + (uint32_t)k);
+    next += (uint32_t)defs;
+    MopSwMatInstr *o = &p->code[p->code_count++];
+    o->op = in->op;
+    o->dst = (uint8_t)map[in->dst];
+    o->a = (uint8_t)map[in->a];
+    o->b = (uint8_t)map[in->b];
+    o->c = in->op == MOP_SW_MAT_OP_TEX
+               ? (uint8_t)in->c
+               : (in->op == MOP_SW_MAT_OP_MAD || in->op == MOP_SW_MAT_OP_MIX
+                      ? (uint8_t)map[in->c]
+                      : 0);
+  }
+  p->reg_count = next;
+
+  for (int i = 0; i < MOP_SW_MAT_OUT_COUNT; i++)
+    p->out[i] = (uint8_t)map[out_regs[i]];
+  return true;
+}
+
+/* ---- entry point ---- */
+
+bool mop_mat_program_compile(const MopMaterialGraph *graph, MopViewport *vp,
+                             MopSwMatProgram *out) {
+  if (!graph || !out)
+    return false;
+  memset(out, 0, sizeof(*out));
+  if (graph->node_count == 0 || graph->nodes[0].type != MOP_MAT_NODE_OUTPUT) {
+    MOP_WARN("mop_mat_program_compile: no output node at index 0");
+    return false;
+  }
+
+  MpCtx *c = calloc(1, sizeof(MpCtx));
+  if (!c)
+    return false;
+  c->graph = graph;
+  c->vp = vp;
+  c->out = out;
+  c->reg_count = MOP_SW_MAT_REG_VARYINGS;
+
+  /* Output slots: 0 base color, 1 metallic, 2 roughness, 4 emissive.
+   * Normal (3) and AO (5) stay with the flat material.  Unconnected
+   * slots keep the CPU defaults: vertex color, metallic 0, roughness
+   * 0.5, no emission.  A texture feeding metallic / roughness is read
+   * as a glTF metallic-roughness map (blue / green). */
+  MpOperand outs[MOP_SW_MAT_OUT_COUNT];
+  for (int i = 0; i < 3; i++)
+    outs[MOP_SW_MAT_OUT_BASE_R + i] = mp_r((uint16_t)(MOP_SW_MAT_REG_R + i));
+  outs[MOP_SW_MAT_OUT_METALLIC] = mp_k(0.0f);
+  outs[MOP_SW_MAT_OUT_ROUGHNESS] = mp_k(0.5f);
+  for (int i = 0; i < 3; i++)
+    outs[MOP_SW_MAT_OUT_EMISSIVE_R + i] = mp_k(0.0f);
+
+  for (uint32_t slot = 0; slot < 6 && !c->failed; slot++) {
+    int ci = mp_find_input(graph, 0, slot);
+    if (ci < 0)
+      continue;
+    memset(c->on_stack, 0, sizeof(c->on_stack));
+    MpValue v = mp_node(c, graph->connections[ci].src_node);
+    switch (slot) {
+    case 0:
+      for (int i = 0; i < 3; i++)
+        outs[MOP_SW_MAT_OUT_BASE_R + i] = mp_comp(&v, i);
+      break;
+    case 1:
+      outs[MOP_SW_MAT_OUT_METALLIC] = mp_comp(&v, v.texel ? 2 : 0);
+      break;
+    case 2:
+      outs[MOP_SW_MAT_OUT_ROUGHNESS] = mp_comp(&v, v.texel ? 1 : 0);
+      break;
+    case 4:
+      for (int i = 0; i < 3; i++)
+        outs[MOP_SW_MAT_OUT_EMISSIVE_R + i] = mp_comp(&v, i);
+      break;
+    }
+  }
+
+  uint16_t out_regs[MOP_SW_MAT_OUT_COUNT];
+  for (int i = 0; i < MOP_SW_MAT_OUT_COUNT; i++)
+    out_regs[i] = mp_reg(c, outs[i]);
+
+  bool ok = !c->failed && mp_finish(c, out_regs);
+  free(c);
+  if (!ok) {
+    MOP_WARN("mop_mat_program_compile: graph '%s' exceeds the program "
+             "limits or is invalid",
+             graph->name);
+    memset(out, 0, sizeof(*out));
+  }
+  return ok;
+}
@@ -0,0 +1,36 @@
+/*
+ * Master of Puppets — Material Graph
+ * material_program.h — Lowering material graphs to per-pixel programs
+ *
+ * mop_mat_graph_compile folds a graph into one flat MopMaterial, which
+ * loses everything that varies across a surface.  This lowers the same
+ * graph into the straight-line register code of rasterizer_material.h
+ * so the CPU backend can evaluate it per pixel:
+ *
+ *   - only nodes reachable from the output node are visited
+ *   - subtrees without varying inputs fold to constants, and identities
+ *     (x * 1, x * 0, x + 0, mix by 0 or 1) fold away
+ *   - instructions whose results no output reads are removed and the
+ *     surviving registers renumbered densely
+ *
+ * Varying inputs are the mesh UVs, the vertex color and N.V (fresnel).
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef MOP_CORE_MATERIAL_PROGRAM_H
+#define MOP_CORE_MATERIAL_PROGRAM_H
+
+#include "rasterizer/rasterizer_material.h"
+
+#include <mop/core/material_graph.h>
+#include <stdbool.h>
+
+/* Lower graph into out.  Texture sample nodes resolve their paths through
+ * vp's texture pipeline (vp NULL or a failed load reads as white).
+ * Returns false with a warning on a missing output node, a cycle, or a
+ * program over the MOP_SW_MAT_MAX_CODE / MOP_SW_MAT_MAX_REGS limits. */
+bool mop_mat_program_compile(const MopMaterialGraph *graph, MopViewport *vp,
+                             MopSwMatProgram *out);
+
+#endif /* MOP_CORE_MATERIAL_PROGRAM_H */
@@ -0,0 +1,623 @@
+/*
+ * Master of Puppets — Backend-Agnostic Viewport Rendering Engine
+ * mesh_optimize.c — Tipsify cache order, overdraw clusters, fetch order
+ *
+ * Vertex cache: Sander, Nehab & Barczak, "Fast Triangle Reordering for
+ * Vertex Locality and Reduced Overdraw" (2007).  The fanning vertex walks
+ * the mesh emitting all of its live triangles, then moves to the
+ * neighbour that will still be in cache the longest; dead ends fall back
+ * to recently emitted vertices, then to a linear scan.  Runs in linear
+ * time.
+ *
+ * Overdraw: the cache order is cut into clusters — at every cache restart
+ * (hard boundary) and wherever a fresh cache would cost no more than
+ * `threshold` times the input's miss rate (soft boundary) — and clusters
+ * are sorted by how far out and outward-facing they are, which
+ * approximates front-to-back order from every direction at once.
+ *
+ * Overdraw statistics rasterize the mesh from the six axis directions
+ * into a small depth buffer and count depth-test passes per covered pixel.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <float.h>
+#include <math.h>
+#include <mop/core/mesh_optimize.h>
+#include <mop/types.h>
+#include <mop/util/log.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define OVERDRAW_RES 128    /* analysis depth buffer size per view */
+#define OVERDRAW_MIN_TRIS 8 /* smallest soft-boundary cluster */
+#define FETCH_LINE 64       /* bytes per simulated fetch cache line */
+#define FETCH_LINES 64      /* lines in the simulated fetch cache */
+
+/* -------------------------------------------------------------------------
+ * FIFO post-transform cache simulation
+ * ------------------------------------------------------------------------- */
+
+typedef struct VCache {
+  uint32_t *stamp; /* per vertex: time it entered the cache */
+  uint32_t time;   /* misses so far (FIFO position) */
+} VCache;
+
+/* Returns true on a cache miss (the vertex is then inserted) */
+static inline bool vcache_touch(VCache *c, uint32_t v) {
+  if (c->stamp[v] && c->time - c->stamp[v] < MOP_VERTEX_CACHE_SIZE)
+    return false;
+  c->stamp[v] = ++c->time;
+  return true;
+}
+
+/* Stamps are relative to `time`, so restarting is O(1): jumping the clock
+ * past the cache size invalidates every entry. */
+static inline void vcache_flush(VCache *c) {
+  c->time += MOP_VERTEX_CACHE_SIZE;
+}
+
+static uint32_t count_misses(const uint32_t *indices, uint32_t index_count,
+                             VCache *c) {
+  uint32_t misses = 0;
+  for (uint32_t i = 0; i < index_count; i++)
+    misses += vcache_touch(c, indices[i]);
+  return misses;
+}
+
+static bool indices_in_range(const uint32_t *indices, uint32_t index_count,
+                             uint32_t vertex_count) {
+  for (uint32_t i = 0; i < index_count; i++)
+    if (indices[i] >= vertex_count)
+      return false;
+  return true;
+}
+
+/* -------------------------------------------------------------------------
+ * Vertex -> triangle adjacency (CSR)
+ * ------------------------------------------------------------------------- */
+
+typedef struct Adjacency {
+  uint32_t *offset; /* vertex_count + 1 */
+  uint32_t *tris;   /* index_count */
+  uint32_t *live;   /* per vertex: triangles not yet emitted */
+} Adjacency;
+
+static bool adjacency_build(Adjacency *a, const uint32_t *indices,
+                            uint32_t index_count, uint32_t vertex_count) {
+  a->offset = calloc((size_t)vertex_count + 1, sizeof(uint32_t));
+  a->tris = malloc((size_t)index_count * sizeof(uint32_t));
+  a->live = calloc(vertex_count, sizeof(uint32_t));
+  if (!a->offset || !a->tris || !a->live)
+    return false;
+
+  for (uint32_t i = 0; i < index_count; i++)
+    a->live[indices[i]]++;
+  for (uint32_t v = 0; v < vertex_count; v++)
+    a->offset[v + 1] = a->offset[v] + a->live[v];
+
+  /* Fill using offset[v] as a cursor, then shift back */
+  for (uint32_t i = 0; i < index_count; i++)
+    a->tris[a->offset[indices[i]]++] = i / 3;
+  for (uint32_t v = vertex_count; v > 0; v--)
+    a->offset[v] = a->offset[v - 1];
+  a->offset[0] = 0;
+  return true;
+}
+
+static void adjacency_free(Adjacency *a) {
+  free(a->offset);
+  free(a->tris);
+  free(a->live);
+}
+
+/* -------------------------------------------------------------------------
+ * Vertex cache order (Tipsify)
+ * ------------------------------------------------------------------------- */
+
+void mop_optimize_vertex_cache(uint32_t *dst, const uint32_t *indices,
+                               uint32_t index_count, uint32_t vertex_count) {
+  if (!dst || !indices || index_count < 3 || vertex_count == 0)
+    return;
+  index_count -= index_count % 3;
+  uint32_t tri_count = index_count / 3;
+  if (!indices_in_range(indices, index_count, vertex_count)) {
+    MOP_WARN("vertex cache optimization: index out of range, order "
+             "unchanged");
+    if (dst != indices)
+      memcpy(dst, indices, (size_t)index_count * sizeof(uint32_t));
+    return;
+  }
+
+  Adjacency adj = {0};
+  uint32_t *stamp = calloc(vertex_count, sizeof(uint32_t));
+  uint32_t *dead_end = malloc((size_t)index_count * sizeof(uint32_t));
+  uint8_t *emitted = calloc(tri_count, 1);
+  uint32_t *out = malloc((size_t)index_count * sizeof(uint32_t));
+  if (!stamp || !dead_end || !emitted || !out ||
+      !adjacency_build(&adj, indices, index_count, vertex_count)) {
+    MOP_WARN("vertex cache optimization: out of memory, order unchanged");
+    if (dst != indices)
+      memcpy(dst, indices, (size_t)index_count * sizeof(uint32_t));
+    goto done;
+  }
+
+  const uint32_t k = MOP_VERTEX_CACHE_SIZE;
+  uint32_t time = k + 1; /* stamps older than time - k are out of cache */
+  uint32_t dead_top = 0;
+  uint32_t cursor = 0; /* linear scan position for exhausted dead ends */
+  uint32_t written = 0;
+  int64_t fan = 0;
+  while (fan >= 0) {
+    uint32_t f = (uint32_t)fan;
+    uint32_t cand_begin = dead_top;
+
+    for (uint32_t a = adj.offset[f]; a < adj.offset[f + 1]; a++) {
+      uint32_t t = adj.tris[a];
+      if (emitted[t])
+        continue;
+      emitted[t] = 1;
+      for (int c = 0; c < 3; c++) {
+        uint32_t v = indices[t * 3 + (uint32_t)c];
+        out[written++] = v;
+        dead_end[dead_top++] = v;
+        adj.live[v]--;
+        if (time - stamp[v] > k)
+          stamp[v] = time++;
+      }
+    }
+
+    /* Next fanning vertex: the candidate that stays in cache longest
+     * after its remaining triangles are emitted */
+    int64_t best = -1;
+    int64_t best_priority = -1;
+    for (uint32_t i = cand_begin; i < dead_top; i++) {
+      uint32_t v = dead_end[i];
+      if (adj.live[v] == 0)
+        continue;
+      int64_t priority = 0;
+      if (time - stamp[v] + 2 * adj.live[v] <= k)
+        priority = (int64_t)(time - stamp[v]);
+      if (priority > best_priority) {
+        best_priority = priority;
+        best = v;
+      }
+    }
+
+    if (best < 0) {
+      /* Dead end: most recently emitted vertex with work left, then any */
+      while (dead_top > 0 && best < 0) {
+        uint32_t v = dead_end[--dead_top];
+        if (adj.live[v] > 0)
+          best = v;
+      }
+      while (best < 0 && cursor < vertex_count) {
+        if (adj.live[cursor] > 0)
+          best = cursor;
+        else
+          cursor++;
+      }
+    }
+    fan = best;
+  }
+  memcpy(dst, out, (size_t)written * sizeof(uint32_t));
+
+done:
+  adjacency_free(&adj);
+  free(stamp);
+  free(dead_end);
+  free(emitted);
+  free(out);
+}
+
+/* -------------------------------------------------------------------------
+ * Overdraw order
+ * ------------------------------------------------------------------------- */
+
+static inline const float *vpos(const float *positions, size_t stride,
+                                uint32_t v) {
+  return (const float *)((const char *)positions + (size_t)v * stride);
+}
+
+typedef struct Cluster {
+  uint32_t first; /* first triangle */
+  uint32_t count; /* triangles */
+  float sort_key; /* larger = drawn earlier */
+} Cluster;
+
+static int cluster_cmp(const void *a, const void *b) {
+  float ka = ((const Cluster *)a)->sort_key;
+  float kb = ((const Cluster *)b)->sort_key;
+  if (ka != kb)
+    return ka > kb ? -1 : 1;
+  /* Stable: keep cache order among equals */
+  uint32_t fa = ((const Cluster *)a)->first, fb = ((const Cluster *)b)->first;
+  return fa < fb ? -1 : (fa > fb);
+}
+
+void mop_optimize_overdraw(uint32_t *dst, const uint32_t *indices,
+                           uint32_t index_count, const float *positions,
+                           uint32_t vertex_count, size_t position_stride,
+                           float threshold) {
+  if (!dst || !indices || !positions || index_count < 3 || vertex_count == 0)
+    return;
+  index_count -= index_count % 3;
+  uint32_t tri_count = index_count / 3;
+  if (threshold < 1.0f)
+    threshold = 1.0f;
+  if (!indices_in_range(indices, index_count, vertex_count)) {
+    MOP_WARN("overdraw optimization: index out of range, order unchanged");
+    if (dst != indices)
+      memcpy(dst, indices, (size_t)index_count * sizeof(uint32_t));
+    return;
+  }
+
+  uint32_t *stamp = calloc(vertex_count, sizeof(uint32_t));
+  Cluster *clusters = malloc((size_t)tri_count * sizeof(Cluster));
+  uint32_t *out = malloc((size_t)index_count * sizeof(uint32_t));
+  if (!stamp || !clusters || !out) {
+    MOP_WARN("overdraw optimization: out of memory, order unchanged");
+    if (dst != indices)
+      memcpy(dst, indices, (size_t)index_count * sizeof(uint32_t));
+    goto done;
+  }
+
+  /* Input miss rate sets the budget for soft boundaries */
+  VCache cache = {stamp, 0};
+  float input_acmr =
+      (float)count_misses(indices, index_count, &cache) / (float)tri_count;
+
+  /* Hard boundaries: triangles whose three vertices all miss — the input
+   * restarted there anyway, so cutting costs nothing.  Soft boundaries:
+   * a cluster may end once its own miss rate (from a cold cache) is
+   * within threshold of the input's. */
+  uint32_t cluster_count = 0;
+  memset(stamp, 0, (size_t)vertex_count * sizeof(uint32_t));
+  VCache ref = {stamp, 0};
+  uint32_t start = 0, misses = 0;
+  for (uint32_t t = 0; t < tri_count; t++) {
+    uint32_t m = 0;
+    for (int c = 0; c < 3; c++)
+      m += vcache_touch(&ref, indices[t * 3 + (uint32_t)c]);
+    if (m == 3 && t > start) {
+      clusters[cluster_count++] = (Cluster){start, t - start, 0.0f};
+      start = t;
+      misses = 0;
+      /* Cold cache for the new cluster; this triangle misses fully */
+      vcache_flush(&ref);
+      for (int c = 0; c < 3; c++)
+        vcache_touch(&ref, indices[t * 3 + (uint32_t)c]);
+    }
+    misses += m;
+    uint32_t n = t + 1 - start;
+    if (n >= OVERDRAW_MIN_TRIS &&
+        (float)misses <= threshold * input_acmr * (float)n) {
+      clusters[cluster_count++] = (Cluster){start, n, 0.0f};
+      start = t + 1;
+      misses = 0;
+      vcache_flush(&ref);
+    }
+  }
+  if (start < tri_count)
+    clusters[cluster_count++] = (Cluster){start, tri_count - start, 0.0f};
+
+  /* Mesh centroid (area weighted) */
+  double mc[3] = {0, 0, 0}, total_area = 0.0;
+  for (uint32_t t = 0; t < tri_count; t++) {
+    const float *a = vpos(positions, position_stride, indices[t * 3 + 0]);
+    const float *b = vpos(positions, position_stride, indices[t * 3 + 1]);
+    const float *c = vpos(positions, position_stride, indices[t * 3 + 2]);
+    float e1[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+    float e2[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+    float n[3] = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2],
+                  e1[0] * e2[1] - e1[1] * e2[0]};
+    double area = sqrt((double)n[0] * n[0] + (double)n[1] * n[1] +
+                       (double)n[2] * n[2]);
+    for (int k = 0; k < 3; k++)
+      mc[k] += area * (a[k] + b[k] + c[k]) / 3.0;
+    total_area += area;
+  }
+  if (total_area > 0.0)
+    for (int k = 0; k < 3; k++)
+      mc[k] /= total_area;
+
+  /* Sort key: how far the cluster sits out along its own normal */
+  for (uint32_t ci = 0; ci < cluster_count; ci++) {
+    Cluster *cl = &clusters[ci];
+    double cc[3] = {0, 0, 0}, cn[3] = {0, 0, 0}, area_sum = 0.0;
+    for (uint32_t t = cl->first; t < cl->first + cl->count; t++) {
+      const float *a = vpos(positions, position_stride, indices[t * 3 + 0]);
+      const float *b = vpos(positions, position_stride, indices[t * 3 + 1]);
+      const float *c = vpos(positions, position_stride, indices[t * 3 + 2]);
+      double e1[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+      double e2[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+      double n[3] = {e1[1] * e2[2] - e1[2] * e2[1],
+                     e1[2] * e2[0] - e1[0] * e2[2],
+                     e1[0] * e2[1] - e1[1] * e2[0]};
+      double area = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+      for (int k = 0; k < 3; k++) {
+        cc[k] += area * (a[k] + b[k] + c[k]) / 3.0;
+        cn[k] += n[k];
+      }
+      area_sum += area;
+    }
+    double nl = sqrt(cn[0] * cn[0] + cn[1] * cn[1] + cn[2] * cn[2]);
+    if (area_sum <= 0.0 || nl <= 0.0)
+      continue;
+    double key = 0.0;
+    for (int k = 0; k < 3; k++)
+      key += (cc[k] / area_sum - mc[k]) * (cn[k] / nl);
+    cl->sort_key = (float)key;
+  }
+  qsort(clusters, cluster_count, sizeof(Cluster), cluster_cmp);
+
+  uint32_t w = 0;
+  for (uint32_t ci = 0; ci < cluster_count; ci++) {
+    size_t n = (size_t)clusters[ci].count * 3;
+    memcpy(out + w, indices + (size_t)clusters[ci].first * 3,
+           n * sizeof(uint32_t));
+    w += (uint32_t)n;
+  }
+  memcpy(dst, out, (size_t)index_count * sizeof(uint32_t));
+
+done:
+  free(stamp);
+  free(clusters);
+  free(out);
+}
+
+/* -------------------------------------------------------------------------
+ * Vertex fetch order
+ * ------------------------------------------------------------------------- */
+
+uint32_t mop_optimize_vertex_fetch(void *dst, uint32_t *indices,
+                                   uint32_t index_count, const void *vertices,
+                                   uint32_t vertex_count, size_t vertex_size) {
+  if (!dst || !indices || !vertices || vertex_count == 0 || dst == vertices)
+    return 0;
+  if (!indices_in_range(indices, index_count, vertex_count)) {
+    MOP_WARN("vertex fetch optimization: index out of range");
+    return 0;
+  }
+  uint32_t *remap = malloc((size_t)vertex_count * sizeof(uint32_t));
+  if (!remap) {
+    MOP_WARN("vertex fetch optimization: out of memory");
+    return 0;
+  }
+  memset(remap, 0xFF, (size_t)vertex_count * sizeof(uint32_t));
+
+  uint32_t next = 0;
+  for (uint32_t i = 0; i < index_count; i++) {
+    uint32_t v = indices[i];
+    if (remap[v] == UINT32_MAX) {
+      remap[v] = next;
+      memcpy((char *)dst + (size_t)next * vertex_size,
+             (const char *)vertices + (size_t)v * vertex_size, vertex_size);
+      next++;
+    }
+    indices[i] = remap[v];
+  }
+  free(remap);
+  return next;
+}
+
+/* -------------------------------------------------------------------------
+ * Analysis
+ * ------------------------------------------------------------------------- */
+
+/* Rasterize into one axis view and count depth-test passes.  axis is the
+ * view direction's axis, sign which end the viewer sits at. */
+static void overdraw_view(const float *positions, size_t stride,
+                          const uint32_t *indices, uint32_t tri_count,
+                          const float bmin[3], const float bext[3], int axis,
+                          float sign, float *depth, uint64_t *shaded,
+                          uint64_t *covered) {
+  int ua = (axis + 1) % 3, va = (axis + 2) % 3;
+  float su = (float)OVERDRAW_RES / (bext[ua] > 0.0f ? bext[ua] : 1.0f);
+  float sv = (float)OVERDRAW_RES / (bext[va] > 0.0f ? bext[va] : 1.0f);
+  for (int i = 0; i < OVERDRAW_RES * OVERDRAW_RES; i++)
+    depth[i] = FLT_MAX;
+
+  for (uint32_t t = 0; t < tri_count; t++) {
+    float x[3], y[3], z[3];
+    for (int c = 0; c < 3; c++) {
+      const float *p = vpos(positions, stride, indices[t * 3 + (uint32_t)c]);
+      x[c] = (p[ua] - bmin[ua]) * su;
+      y[c] = (p[va] - bmin[va]) * sv;
+      z[c] = -sign * p[axis]; /* smaller = nearer the viewer */
+    }
+    /* (u, v, axis) is right-handed, so counter-clockwise in (x, y)
+     * faces +axis.  Back faces are culled as the rasterizer would. */
+    float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+    if (area * sign <= 0.0f)
+      continue;
+
+    int x0 = (int)fmaxf(floorf(fminf(x[0], fminf(x[1], x[2]))), 0.0f);
+    int y0 = (int)fmaxf(floorf(fminf(y[0], fminf(y[1], y[2]))), 0.0f);
+    int x1 = (int)fminf(ceilf(fmaxf(x[0], fmaxf(x[1], x[2]))),
+                        (float)(OVERDRAW_RES - 1));
+    int y1 = (int)fminf(ceilf(fmaxf(y[0], fmaxf(y[1], y[2]))),
+                        (float)(OVERDRAW_RES - 1));
+    float inv_area = 1.0f / area;
+    for (int py = y0; py <= y1; py++) {
+      for (int px = x0; px <= x1; px++) {
+        float cx = (float)px + 0.5f, cy = (float)py + 0.5f;
+        float w0 = ((x[1] - cx) * (y[2] - cy) - (x[2] - cx) * (y[1] - cy)) *
+                   inv_area;
+        float w1 = ((x[2] - cx) * (y[0] - cy) - (x[0] - cx) * (y[2] - cy)) *
+                   inv_area;
+        float w2 = 1.0f - w0 - w1;
+        if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f)
+          continue;
+        float zz = w0 * z[0] + w1 * z[1] + w2 * z[2];
+        float *d = &depth[py * OVERDRAW_RES + px];
+        if (zz < *d) {
+          if (*d == FLT_MAX)
+            (*covered)++;
+          *d = zz;
+          (*shaded)++;
+        }
+      }
+    }
+  }
+}
+
+static bool position_offset(const MopVertexFormat *format, size_t *offset,
+                            size_t *stride) {
+  if (!format) {
+    *offset = offsetof(MopVertex, position);
+    *stride = sizeof(MopVertex);
+    return true;
+  }
+  const MopVertexAttrib *pa =
+      mop_vertex_format_find(format, MOP_ATTRIB_POSITION);
+  if (!pa || pa->format != MOP_FORMAT_FLOAT3 || format->stride == 0)
+    return false;
+  *offset = pa->offset;
+  *stride = format->stride;
+  return true;
+}
+
+static bool indices_valid(const uint32_t *indices, uint32_t index_count,
+                          uint32_t vertex_count) {
+  return indices && index_count >= 3 && index_count % 3 == 0 &&
+         indices_in_range(indices, index_count, vertex_count);
+}
+
+bool mop_mesh_analyze(const void *vertices, uint32_t vertex_count,
+                      const MopVertexFormat *format, const uint32_t *indices,
+                      uint32_t index_count, MopMeshStats *out) {
+  if (!out)
+    return false;
+  memset(out, 0, sizeof(*out));
+  size_t pos_off, stride;
+  if (!vertices || vertex_count == 0 ||
+      !position_offset(format, &pos_off, &stride) ||
+      !indices_valid(indices, index_count, vertex_count))
+    return false;
+
+  uint32_t tri_count = index_count / 3;
+  uint32_t *stamp = calloc(vertex_count, sizeof(uint32_t));
+  float *depth = malloc(OVERDRAW_RES * OVERDRAW_RES * sizeof(float));
+  size_t line_count = ((size_t)vertex_count * stride + FETCH_LINE - 1) /
+                      FETCH_LINE;
+  uint32_t *line_stamp = calloc(line_count, sizeof(uint32_t));
+  if (!stamp || !depth || !line_stamp) {
+    free(stamp);
+    free(depth);
+    free(line_stamp);
+    return false;
+  }
+
+  /* Cache misses; a vertex counts as referenced the first time it misses */
+  VCache cache = {stamp, 0};
+  uint32_t misses = 0, unique = 0;
+  uint32_t fetch_time = 0, lines_fetched = 0;
+  for (uint32_t i = 0; i < index_count; i++) {
+    uint32_t v = indices[i];
+    bool first = (stamp[v] == 0);
+    if (!vcache_touch(&cache, v))
+      continue;
+    misses++;
+    unique += first;
+
+    /* Each transformed vertex reads its bytes through a FIFO line cache */
+    size_t lo = (size_t)v * stride / FETCH_LINE;
+    size_t hi = ((size_t)v * stride + stride - 1) / FETCH_LINE;
+    for (size_t l = lo; l <= hi; l++) {
+      if (line_stamp[l] && fetch_time - line_stamp[l] < FETCH_LINES)
+        continue;
+      line_stamp[l] = ++fetch_time;
+      lines_fetched++;
+    }
+  }
+  out->acmr = (float)misses / (float)tri_count;
+  out->atvr = unique ? (float)misses / (float)unique : 0.0f;
+  out->overfetch =
+      unique ? (float)((double)lines_fetched * FETCH_LINE /
+                       ((double)unique * (double)stride))
+             : 0.0f;
+
+  /* Overdraw from the six axis directions */
+  const float *positions =
+      (const float *)((const char *)vertices + pos_off);
+  float bmin[3] = {FLT_MAX, FLT_MAX, FLT_MAX};
+  float bmax[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+  for (uint32_t i = 0; i < index_count; i++) {
+    const float *p = vpos(positions, stride, indices[i]);
+    for (int k = 0; k < 3; k++) {
+      bmin[k] = fminf(bmin[k], p[k]);
+      bmax[k] = fmaxf(bmax[k], p[k]);
+    }
+  }
+  float bext[3] = {bmax[0] - bmin[0], bmax[1] - bmin[1], bmax[2] - bmin[2]};
+  uint64_t shaded = 0, covered = 0;
+  for (int axis = 0; axis < 3; axis++) {
+    overdraw_view(positions, stride, indices, tri_count, bmin, bext, axis,
+                  1.0f, depth, &shaded, &covered);
+    overdraw_view(positions, stride, indices, tri_count, bmin, bext, axis,
+                  -1.0f, depth, &shaded, &covered);
+  }
+  out->overdraw = covered ? (float)((double)shaded / (double)covered) : 0.0f;
+
+  free(stamp);
+  free(depth);
+  free(line_stamp);
+  return true;
+}
+
+/* -------------------------------------------------------------------------
+ * Whole mesh
+ * ------------------------------------------------------------------------- */
+
+uint32_t mop_mesh_optimize(void *vertices, uint32_t vertex_count,
+                           const MopVertexFormat *format, uint32_t *indices,
+                           uint32_t index_count, uint32_t flags,
+                           MopMeshOptStats *stats) {
+  size_t pos_off, stride;
+  if (!vertices || vertex_count == 0 ||
+      !position_offset(format, &pos_off, &stride) ||
+      !indices_valid(indices, index_count, vertex_count)) {
+    MOP_WARN("mesh optimize: invalid mesh, left unchanged");
+    return 0;
+  }
+  if (stats) {
+    memset(stats, 0, sizeof(*stats));
+    mop_mesh_analyze(vertices, vertex_count, format, indices, index_count,
+                     &stats->before);
+  }
+
+  const float *positions = (const float *)((const char *)vertices + pos_off);
+  if (flags & (MOP_MESH_OPT_VERTEX_CACHE | MOP_MESH_OPT_OVERDRAW))
+    mop_optimize_vertex_cache(indices, indices, index_count, vertex_count);
+  if (flags & MOP_MESH_OPT_OVERDRAW)
+    mop_optimize_overdraw(indices, indices, index_count, positions,
+                          vertex_count, stride, 1.05f);
+
+  uint32_t new_count = vertex_count;
+  if (flags & MOP_MESH_OPT_VERTEX_FETCH) {
+    void *tmp = malloc((size_t)vertex_count * stride);
+    uint32_t *idx_copy = malloc((size_t)index_count * sizeof(uint32_t));
+    if (tmp && idx_copy) {
+      memcpy(idx_copy, indices, (size_t)index_count * sizeof(uint32_t));
+      uint32_t n = mop_optimize_vertex_fetch(tmp, idx_copy, index_count,
+                                             vertices, vertex_count, stride);
+      if (n > 0) {
+        memcpy(vertices, tmp, (size_t)n * stride);
+        memcpy(indices, idx_copy, (size_t)index_count * sizeof(uint32_t));
+        new_count = n;
+      }
+    } else {
+      MOP_WARN("mesh optimize: out of memory, vertex order unchanged");
+    }
+    free(tmp);
+    free(idx_copy);
+  }
+
+  if (stats) {
+    stats->vertices_removed = vertex_count - new_count;
+    mop_mesh_analyze(vertices, new_count, format, indices, index_count,
+                     &stats->after);
+  }
+  return new_count;
+}
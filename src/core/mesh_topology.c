@@ -0,0 +1,400 @@
+/*
+ * Master of Puppets — Mesh Editing
+ * mesh_topology.c — Hashed half-edge adjacency with incremental updates
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "core/mesh_topology.h"
+#include "core/thread_pool.h"
+
+#include <stdlib.h>
+
+#define SLOT_EMPTY UINT64_MAX
+#define SLOT_TOMB (UINT64_MAX - 1)
+
+/* Half-edges per parallel twin-pass row */
+#define TWIN_CHUNK 4096
+
+static inline uint64_t edge_key(uint32_t src, uint32_t dst) {
+  return (uint64_t)src << 32 | dst;
+}
+
+/* splitmix64 finalizer */
+static inline uint32_t key_hash(uint64_t k) {
+  k = (k ^ (k >> 30)) * 0xbf58476d1ce4e5b9ull;
+  k = (k ^ (k >> 27)) * 0x94d049bb133111ebull;
+  return (uint32_t)(k ^ (k >> 31));
+}
+
+/* ---- hash ---- */
+
+static uint32_t slot_find(const MopMeshTopology *t, uint64_t key) {
+  uint32_t mask = t->slot_count - 1;
+  for (uint32_t i = key_hash(key) & mask;; i = (i + 1) & mask) {
+    uint64_t k = t->slots[i].key;
+    if (k == key)
+      return i;
+    if (k == SLOT_EMPTY)
+      return UINT32_MAX;
+  }
+}
+
+/* Slot holding key, or the slot to claim for it.  The table always has
+ * an empty slot (load <= 3/4), so the probe terminates. */
+static uint32_t slot_claim(const MopMeshTopology *t, uint64_t key) {
+  uint32_t mask = t->slot_count - 1;
+  uint32_t tomb = UINT32_MAX;
+  for (uint32_t i = key_hash(key) & mask;; i = (i + 1) & mask) {
+    uint64_t k = t->slots[i].key;
+    if (k == key)
+      return i;
+    if (k == SLOT_TOMB && tomb == UINT32_MAX)
+      tomb = i;
+    if (k == SLOT_EMPTY)
+      return tomb != UINT32_MAX ? tomb : i;
+  }
+}
+
+/* Make room for `extra` more keys, rehashing (and dropping tombstones)
+ * when the load would pass 3/4 */
+static bool slots_reserve(MopMeshTopology *t, uint32_t extra) {
+  uint64_t need = (uint64_t)t->slot_used + extra;
+  if (t->slots && need * 4 <= (uint64_t)t->slot_count * 3)
+    return true;
+
+  uint32_t count = 16;
+  while ((uint64_t)count * 3 < need * 4 || count < need * 2) {
+    if (count > UINT32_MAX / 2)
+      return false;
+    count *= 2;
+  }
+  MopTopologySlot *slots = malloc((size_t)count * sizeof(*slots));
+  if (!slots)
+    return false;
+  for (uint32_t i = 0; i < count; i++)
+    slots[i].key = SLOT_EMPTY;
+
+  MopTopologySlot *old = t->slots;
+  uint32_t old_count = t->slot_count;
+  t->slots = slots;
+  t->slot_count = count;
+  t->slot_used = 0;
+  for (uint32_t i = 0; i < old_count; i++) {
+    if (old[i].key >= SLOT_TOMB)
+      continue;
+    t->slots[slot_claim(t, old[i].key)] = old[i];
+    t->slot_used++;
+  }
+  free(old);
+  return true;
+}
+
+static bool faces_reserve(MopMeshTopology *t, uint32_t faces) {
+  if (faces <= t->face_capacity)
+    return true;
+  uint32_t cap = t->face_capacity ? t->face_capacity : 64;
+  while (cap < faces) {
+    if (cap > UINT32_MAX / 6)
+      return false;
+    cap *= 2;
+  }
+  MopHalfEdge *edges = realloc(t->edges, (size_t)cap * 3 * sizeof(*edges));
+  if (!edges)
+    return false;
+  t->edges = edges;
+  uint32_t *same = realloc(t->same, (size_t)cap * 3 * sizeof(*same));
+  if (!same)
+    return false;
+  t->same = same;
+  uint32_t *out = realloc(t->out_next, (size_t)cap * 3 * sizeof(*out));
+  if (!out)
+    return false;
+  t->out_next = out;
+  t->face_capacity = cap;
+  return true;
+}
+
+/* Room for vertex ids below the largest of indices[0, count) + 1 */
+static bool verts_reserve(MopMeshTopology *t, const uint32_t *indices,
+                          uint32_t count) {
+  uint32_t need = 0;
+  for (uint32_t i = 0; i < count; i++) {
+    if (indices[i] >= need)
+      need = indices[i] + 1;
+  }
+  if (need <= t->vertex_capacity)
+    return true;
+  uint32_t cap = t->vertex_capacity ? t->vertex_capacity : 64;
+  while (cap < need)
+    cap = cap > UINT32_MAX / 2 ? need : cap * 2;
+  uint32_t *head = realloc(t->out_head, (size_t)cap * sizeof(*head));
+  if (!head)
+    return false;
+  for (uint32_t v = t->vertex_capacity; v < cap; v++)
+    head[v] = MOP_INVALID_HE;
+  t->out_head = head;
+  t->vertex_capacity = cap;
+  return true;
+}
+
+static void write_face(MopMeshTopology *t, uint32_t f, const uint32_t *tri) {
+  for (uint32_t e = 0; e < 3; e++) {
+    uint32_t h = f * 3 + e;
+    uint32_t n = (e + 1) % 3;
+    t->edges[h] = (MopHalfEdge){.vertex = tri[n],
+                                .face = f,
+                                .next = f * 3 + n,
+                                .twin = MOP_INVALID_HE};
+    t->same[h] = MOP_INVALID_HE;
+    t->out_next[h] = MOP_INVALID_HE;
+  }
+}
+
+/* ---- linking ----
+ *
+ * Invariant: the head of key (a, b) and the head of key (b, a) are each
+ * other's twins; every other half-edge has no twin.  Degenerate
+ * half-edges (a == a) are listed under their vertex but have no key. */
+
+static uint32_t head_of(const MopMeshTopology *t, uint64_t key) {
+  uint32_t s = slot_find(t, key);
+  return s != UINT32_MAX ? t->slots[s].head : MOP_INVALID_HE;
+}
+
+static void link_he(MopMeshTopology *t, uint32_t h) {
+  uint32_t src = mop_topology_src(t, h);
+  uint32_t dst = t->edges[h].vertex;
+  t->out_next[h] = t->out_head[src];
+  t->out_head[src] = h;
+  t->same[h] = MOP_INVALID_HE;
+  t->edges[h].twin = MOP_INVALID_HE;
+  if (src == dst)
+    return;
+
+  uint64_t key = edge_key(src, dst);
+  uint32_t s = slot_claim(t, key);
+  if (t->slots[s].key == key) {
+    uint32_t x = t->slots[s].head;
+    while (t->same[x] != MOP_INVALID_HE)
+      x = t->same[x];
+    t->same[x] = h;
+    return;
+  }
+  if (t->slots[s].key == SLOT_EMPTY)
+    t->slot_used++;
+  t->slots[s] = (MopTopologySlot){.key = key, .head = h};
+
+  uint32_t o = head_of(t, edge_key(dst, src));
+  if (o != MOP_INVALID_HE) {
+    t->edges[h].twin = o;
+    t->edges[o].twin = h;
+  }
+}
+
+static void unlink_he(MopMeshTopology *t, uint32_t h) {
+  uint32_t src = mop_topology_src(t, h);
+  uint32_t dst = t->edges[h].vertex;
+  uint32_t *out = &t->out_head[src];
+  while (*out != MOP_INVALID_HE && *out != h)
+    out = &t->out_next[*out];
+  if (*out == h)
+    *out = t->out_next[h];
+  t->out_next[h] = MOP_INVALID_HE;
+  if (src == dst)
+    return;
+  uint32_t s = slot_find(t, edge_key(src, dst));
+  if (s == UINT32_MAX)
+    return;
+
+  uint32_t *p = &t->slots[s].head;
+  while (*p != MOP_INVALID_HE && *p != h)
+    p = &t->same[*p];
+  if (*p == MOP_INVALID_HE)
+    return;
+  bool was_head = p == &t->slots[s].head;
+  *p = t->same[h];
+  t->same[h] = MOP_INVALID_HE;
+  t->edges[h].twin = MOP_INVALID_HE;
+  if (!was_head)
+    return;
+
+  /* The next half-edge of the chain (if any) takes over the twin */
+  uint32_t nh = t->slots[s].head;
+  uint32_t o = head_of(t, edge_key(dst, src));
+  if (nh == MOP_INVALID_HE)
+    t->slots[s].key = SLOT_TOMB;
+  else
+    t->edges[nh].twin = o;
+  if (o != MOP_INVALID_HE)
+    t->edges[o].twin = nh;
+}
+
+/* ---- build ---- */
+
+typedef struct TwinPass {
+  MopMeshTopology *t;
+  uint32_t count;
+} TwinPass;
+
+static void twin_rows(void *ctx, int row) {
+  TwinPass *p = ctx;
+  MopMeshTopology *t = p->t;
+  uint32_t end = (uint32_t)(row + 1) * TWIN_CHUNK;
+  if (end > p->count)
+    end = p->count;
+  for (uint32_t h = (uint32_t)row * TWIN_CHUNK; h < end; h++) {
+    uint32_t src = mop_topology_src(t, h);
+    uint32_t dst = t->edges[h].vertex;
+    if (src == dst || head_of(t, edge_key(src, dst)) != h)
+      continue;
+    t->edges[h].twin = head_of(t, edge_key(dst, src));
+  }
+}
+
+MopMeshTopology *mop_topology_build(const uint32_t *indices,
+                                    uint32_t index_count,
+                                    struct MopThreadPool *pool) {
+  uint32_t face_count = index_count / 3;
+  if (!indices || face_count == 0)
+    return NULL;
+
+  MopMeshTopology *t = calloc(1, sizeof(*t));
+  if (!t)
+    return NULL;
+  if (!faces_reserve(t, face_count) || !slots_reserve(t, face_count * 3) ||
+      !verts_reserve(t, indices, face_count * 3)) {
+    mop_topology_free(t);
+    return NULL;
+  }
+  t->face_count = face_count;
+  for (uint32_t f = 0; f < face_count; f++)
+    write_face(t, f, &indices[f * 3]);
+
+  /* Register every half-edge under its key and source vertex.  Walking
+   * backwards and pushing at the front leaves each list in face order. */
+  uint32_t he_count = face_count * 3;
+  for (uint32_t h = he_count; h-- > 0;) {
+    uint32_t src = mop_topology_src(t, h);
+    uint32_t dst = t->edges[h].vertex;
+    t->out_next[h] = t->out_head[src];
+    t->out_head[src] = h;
+    if (src == dst)
+      continue;
+    uint64_t key = edge_key(src, dst);
+    uint32_t s = slot_claim(t, key);
+    if (t->slots[s].key == key) {
+      t->same[h] = t->slots[s].head;
+    } else {
+      t->slots[s].key = key;
+      t->slot_used++;
+    }
+    t->slots[s].head = h;
+  }
+
+  /* Twins: read-only lookups, each half-edge writes only its own entry */
+  TwinPass pass = {.t = t, .count = he_count};
+  mop_threadpool_parallel_rows(pool, (int)((he_count + TWIN_CHUNK - 1) /
+                                           TWIN_CHUNK),
+                               twin_rows, &pass);
+  return t;
+}
+
+void mop_topology_free(MopMeshTopology *t) {
+  if (!t)
+    return;
+  free(t->edges);
+  free(t->same);
+  free(t->out_next);
+  free(t->out_head);
+  free(t->slots);
+  free(t);
+}
+
+uint32_t mop_topology_find(const MopMeshTopology *t, uint32_t src,
+                           uint32_t dst) {
+  if (!t || src == dst)
+    return MOP_INVALID_HE;
+  return head_of(t, edge_key(src, dst));
+}
+
+/* ---- incremental updates ---- */
+
+bool mop_topology_set_faces(MopMeshTopology *t, uint32_t first,
+                            const uint32_t *indices, uint32_t count) {
+  if (!t || first > t->face_count)
+    return false;
+  uint32_t end = first + count;
+  uint32_t old_end = end < t->face_count ? end : t->face_count;
+
+  for (uint32_t h = first * 3; h < old_end * 3; h++)
+    unlink_he(t, h);
+  if (!faces_reserve(t, end) || !slots_reserve(t, count * 3) ||
+      !verts_reserve(t, indices, count * 3))
+    return false;
+
+  for (uint32_t i = 0; i < count; i++)
+    write_face(t, first + i, &indices[i * 3]);
+  if (end > t->face_count)
+    t->face_count = end;
+  for (uint32_t h = first * 3; h < end * 3; h++)
+    link_he(t, h);
+  return true;
+}
+
+void mop_topology_truncate(MopMeshTopology *t, uint32_t face_count) {
+  if (!t || face_count >= t->face_count)
+    return;
+  for (uint32_t h = face_count * 3; h < t->face_count * 3; h++)
+    unlink_he(t, h);
+  t->face_count = face_count;
+}
+
+bool mop_topology_remove_faces(MopMeshTopology *t, const bool *del) {
+  if (!t || !del)
+    return false;
+  uint32_t he_count = t->face_count * 3;
+  uint32_t *map = malloc((size_t)(he_count ? he_count : 1) * sizeof(*map));
+  if (!map)
+    return false;
+
+  for (uint32_t f = 0; f < t->face_count; f++) {
+    if (del[f])
+      for (uint32_t e = 0; e < 3; e++)
+        unlink_he(t, f * 3 + e);
+  }
+
+  /* Survivors move down in order; nothing links to a removed face any
+   * more, so every reference can go through the map */
+  uint32_t kept = 0;
+  for (uint32_t f = 0; f < t->face_count; f++) {
+    for (uint32_t e = 0; e < 3; e++)
+      map[f * 3 + e] = del[f] ? MOP_INVALID_HE : kept * 3 + e;
+    kept += !del[f];
+  }
+  for (uint32_t i = 0; i < t->slot_count; i++) {
+    if (t->slots[i].key < SLOT_TOMB)
+      t->slots[i].head = map[t->slots[i].head];
+  }
+  for (uint32_t v = 0; v < t->vertex_capacity; v++) {
+    if (t->out_head[v] != MOP_INVALID_HE)
+      t->out_head[v] = map[t->out_head[v]];
+  }
+  for (uint32_t h = 0; h < he_count; h++) {
+    uint32_t nh = map[h];
+    if (nh == MOP_INVALID_HE)
+      continue;
+    MopHalfEdge he = t->edges[h];
+    uint32_t same = t->same[h];
+    uint32_t out = t->out_next[h];
+    he.face = nh / 3;
+    he.next = nh - nh % 3 + (nh % 3 + 1) % 3;
+    he.twin = he.twin != MOP_INVALID_HE ? map[he.twin] : MOP_INVALID_HE;
+    t->edges[nh] = he;
+    t->same[nh] = same != MOP_INVALID_HE ? map[same] : MOP_INVALID_HE;
+    t->out_next[nh] = out != MOP_INVALID_HE ? map[out] : MOP_INVALID_HE;
+  }
+  t->face_count = kept;
+  free(map);
+  return true;
+}
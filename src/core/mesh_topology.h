@@ -0,0 +1,106 @@
+/*
+ * Master of Puppets — Mesh Editing
+ * mesh_topology.h — Half-edge adjacency kept per mesh across edits
+ *
+ * Three half-edges per triangle, half-edge 3f + e running from corner e
+ * to corner e + 1 of face f.  Twins are found through an open-addressing
+ * hash keyed by the directed (src, dst) vertex pair: the twin of a -> b
+ * is whatever half-edge is registered under b -> a.  Building is O(n):
+ * one sequential pass fills the hash, and a read-only pass over the
+ * thread pool resolves the twins.
+ *
+ * Every half-edge is also listed under its source vertex, which gives
+ * the faces around a vertex (its one-ring) without a scan.
+ *
+ * Non-manifold edges (several faces with the same directed edge) chain
+ * their half-edges under one key.  Only the head of each chain is
+ * twinned; the rest read as boundary but are still reachable through
+ * mop_topology_find and MopMeshTopology.same.
+ *
+ * The mesh owns the topology between edit operations (MopMesh.topology).
+ * Edit operations patch it face by face instead of rebuilding, and any
+ * other geometry upload drops it.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef MOP_CORE_MESH_TOPOLOGY_H
+#define MOP_CORE_MESH_TOPOLOGY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+struct MopThreadPool;
+
+#define MOP_INVALID_HE UINT32_MAX
+
+typedef struct MopHalfEdge {
+  uint32_t vertex; /* destination vertex */
+  uint32_t face;   /* adjacent face */
+  uint32_t next;   /* next half-edge in face */
+  uint32_t twin;   /* opposite half-edge (MOP_INVALID_HE if boundary) */
+} MopHalfEdge;
+
+typedef struct MopTopologySlot {
+  uint64_t key;  /* src << 32 | dst, or an empty / tombstone marker */
+  uint32_t head; /* first half-edge with this key */
+} MopTopologySlot;
+
+typedef struct MopMeshTopology {
+  MopHalfEdge *edges; /* face_count * 3 */
+  uint32_t *same;     /* next half-edge with the same key, or invalid */
+  uint32_t *out_next; /* next half-edge leaving the same vertex */
+  uint32_t face_count;
+  uint32_t face_capacity;
+
+  uint32_t *out_head; /* first half-edge leaving each vertex, or invalid */
+  uint32_t vertex_capacity;
+
+  MopTopologySlot *slots;
+  uint32_t slot_count; /* power of two */
+  uint32_t slot_used;  /* live keys plus tombstones */
+} MopMeshTopology;
+
+/* Build from a triangle index buffer.  The twin pass runs on pool (NULL
+ * runs inline) and must not be called from one of its tasks.  Returns
+ * NULL on allocation failure or an empty buffer. */
+MopMeshTopology *mop_topology_build(const uint32_t *indices,
+                                    uint32_t index_count,
+                                    struct MopThreadPool *pool);
+
+void mop_topology_free(MopMeshTopology *t);
+
+/* Source vertex of half-edge he */
+static inline uint32_t mop_topology_src(const MopMeshTopology *t,
+                                        uint32_t he) {
+  uint32_t base = he - he % 3;
+  return t->edges[base + (he - base + 2) % 3].vertex;
+}
+
+/* First half-edge leaving v, or MOP_INVALID_HE; continue through
+ * MopMeshTopology.out_next.  The face of each is a face around v. */
+static inline uint32_t mop_topology_first_out(const MopMeshTopology *t,
+                                              uint32_t v) {
+  return v < t->vertex_capacity ? t->out_head[v] : MOP_INVALID_HE;
+}
+
+/* First half-edge running src -> dst, or MOP_INVALID_HE */
+uint32_t mop_topology_find(const MopMeshTopology *t, uint32_t src,
+                           uint32_t dst);
+
+/* Replace faces [first, first + count) with the triangles of indices,
+ * appending past face_count (first must not exceed face_count).  Only the
+ * keys of the touched half-edges are relinked.  Returns false on
+ * allocation failure, leaving t unusable (free it). */
+bool mop_topology_set_faces(MopMeshTopology *t, uint32_t first,
+                            const uint32_t *indices, uint32_t count);
+
+/* Drop the faces from face_count on, as shrinking the index buffer would */
+void mop_topology_truncate(MopMeshTopology *t, uint32_t face_count);
+
+/* Remove the faces flagged in del (face_count entries) and close the gaps,
+ * keeping the survivors in order, as an index buffer compaction would.
+ * Returns false on allocation failure, leaving t unchanged. */
+bool mop_topology_remove_faces(MopMeshTopology *t, const bool *del);
+
+#endif /* MOP_CORE_MESH_TOPOLOGY_H */
@@ -2,23 +2,49 @@
  * Master of Puppets — Backend-Agnostic Viewport Rendering Engine
  * meshlet.c — Meshlet generation (Phase 10)
  *
- * Greedy meshlet builder: iterates triangles, packing into clusters
- * that respect the vertex/triangle limits.  Computes per-meshlet
- * bounding spheres and normal cones for GPU culling.
+ * Triangles are first sorted along a Morton curve through their
+ * centroids and cut into fixed-size spatial partitions.  Each partition
+ * is clustered independently — in parallel on a worker pool when one is
+ * available — by growing meshlets across shared vertices: triangles that
+ * add no new vertex are taken first, otherwise the one closest to the
+ * meshlet's center and best aligned with its average normal.  That keeps
+ * bounding spheres small and normal cones narrow, which is what the
+ * frustum, cone and occlusion tests of both backends feed on.
+ *
+ * Partition sizes are fixed, so the output does not depend on the number
+ * of worker threads.
  *
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include "core/thread_pool.h"
+#include "core/viewport_internal.h"
+
+#include <float.h>
 #include <math.h>
 #include <mop/core/meshlet.h>
 #include <mop/util/log.h>
 #include <stdlib.h>
 #include <string.h>
 
+/* Triangles per spatial partition: the unit of parallel work, and the
+ * window within which the greedy growth looks for neighbours. */
+#define PARTITION_TRIS 8192
+
+/* Weight of normal deviation against distance from the meshlet center
+ * when choosing the next triangle (0 = tightest spheres only). */
+#define CONE_WEIGHT 0.5f
+
 /* -------------------------------------------------------------------------
- * Bounding sphere computation (Ritter's algorithm)
+ * Bounding sphere — Ritter's sphere or the centroid sphere, whichever is
+ * smaller.  Both contain every vertex.
  * ------------------------------------------------------------------------- */
 
+static float dist2(const MopVec3 *a, const float c[3]) {
+  float dx = a->x - c[0], dy = a->y - c[1], dz = a->z - c[2];
+  return dx * dx + dy * dy + dz * dz;
+}
+
 static void compute_bounding_sphere(const MopVertex *vertices,
                                     const uint32_t *vert_indices,
                                     uint32_t vert_count, float out_center[3],
@@ -29,316 +55,691 @@ static void compute_bounding_sphere(const MopVertex *vertices,
     return;
   }
 
-  /* Initial center = centroid */
-  float cx = 0, cy = 0, cz = 0;
+  /* Centroid sphere */
+  float cc[3] = {0, 0, 0};
   for (uint32_t i = 0; i < vert_count; i++) {
     const MopVec3 *p = &vertices[vert_indices[i]].position;
-    cx += p->x;
-    cy += p->y;
-    cz += p->z;
+    cc[0] += p->x;
+    cc[1] += p->y;
+    cc[2] += p->z;
   }
   float inv_n = 1.0f / (float)vert_count;
-  cx *= inv_n;
-  cy *= inv_n;
-  cz *= inv_n;
-
-  /* Radius = max distance from center */
-  float r2 = 0.0f;
+  cc[0] *= inv_n;
+  cc[1] *= inv_n;
+  cc[2] *= inv_n;
+  float cr2 = 0.0f;
+  for (uint32_t i = 0; i < vert_count; i++)
+    cr2 = fmaxf(cr2, dist2(&vertices[vert_indices[i]].position, cc));
+
+  /* Ritter: diameter estimate from two far-apart points, then grow */
+  const MopVec3 *p0 = &vertices[vert_indices[0]].position;
+  float p0c[3] = {p0->x, p0->y, p0->z};
+  const MopVec3 *a = p0, *b = p0;
+  float best = -1.0f;
+  for (uint32_t i = 0; i < vert_count; i++) {
+    float d = dist2(&vertices[vert_indices[i]].position, p0c);
+    if (d > best) {
+      best = d;
+      a = &vertices[vert_indices[i]].position;
+    }
+  }
+  float ac[3] = {a->x, a->y, a->z};
+  best = -1.0f;
+  for (uint32_t i = 0; i < vert_count; i++) {
+    float d = dist2(&vertices[vert_indices[i]].position, ac);
+    if (d > best) {
+      best = d;
+      b = &vertices[vert_indices[i]].position;
+    }
+  }
+  float rc[3] = {(a->x + b->x) * 0.5f, (a->y + b->y) * 0.5f,
+                 (a->z + b->z) * 0.5f};
+  float rr = sqrtf(best) * 0.5f;
   for (uint32_t i = 0; i < vert_count; i++) {
     const MopVec3 *p = &vertices[vert_indices[i]].position;
-    float dx = p->x - cx, dy = p->y - cy, dz = p->z - cz;
-    float d2 = dx * dx + dy * dy + dz * dz;
-    if (d2 > r2)
-      r2 = d2;
+    float d = sqrtf(dist2(p, rc));
+    if (d > rr) {
+      /* Move the center toward p just enough to enclose it */
+      float nr = (rr + d) * 0.5f;
+      float k = (nr - rr) / d;
+      rc[0] += (p->x - rc[0]) * k;
+      rc[1] += (p->y - rc[1]) * k;
+      rc[2] += (p->z - rc[2]) * k;
+      rr = nr;
+    }
   }
 
-  out_center[0] = cx;
-  out_center[1] = cy;
-  out_center[2] = cz;
-  *out_radius = sqrtf(r2);
+  /* Guard against rounding in the incremental growth */
+  float rr2 = 0.0f;
+  for (uint32_t i = 0; i < vert_count; i++)
+    rr2 = fmaxf(rr2, dist2(&vertices[vert_indices[i]].position, rc));
+  rr = sqrtf(rr2);
+
+  float cr = sqrtf(cr2);
+  const float *c = (rr < cr) ? rc : cc;
+  out_center[0] = c[0];
+  out_center[1] = c[1];
+  out_center[2] = c[2];
+  *out_radius = fminf(rr, cr);
 }
 
 /* -------------------------------------------------------------------------
- * Normal cone computation
+ * Normal cone
  * ------------------------------------------------------------------------- */
 
+/* Unit face normal (zero for degenerate triangles) */
+static MopVec3 face_normal(const MopVertex *vertices, uint32_t i0, uint32_t i1,
+                           uint32_t i2) {
+  const MopVec3 *p0 = &vertices[i0].position;
+  const MopVec3 *p1 = &vertices[i1].position;
+  const MopVec3 *p2 = &vertices[i2].position;
+
+  float e1x = p1->x - p0->x, e1y = p1->y - p0->y, e1z = p1->z - p0->z;
+  float e2x = p2->x - p0->x, e2y = p2->y - p0->y, e2z = p2->z - p0->z;
+
+  float nx = e1y * e2z - e1z * e2y;
+  float ny = e1z * e2x - e1x * e2z;
+  float nz = e1x * e2y - e1y * e2x;
+
+  float len = sqrtf(nx * nx + ny * ny + nz * nz);
+  if (len <= 1e-8f)
+    return (MopVec3){0, 0, 0};
+  float inv = 1.0f / len;
+  return (MopVec3){nx * inv, ny * inv, nz * inv};
+}
+
+/* indices: meshlet-local triangle list resolved to global vertex ids */
 static void compute_normal_cone(const MopVertex *vertices,
                                 const uint32_t *indices, uint32_t tri_count,
                                 const float center[3], MopMeshletCone *cone) {
-  if (tri_count == 0) {
-    memset(cone, 0, sizeof(*cone));
-    cone->cutoff = -1.0f; /* never cull */
+  memset(cone, 0, sizeof(*cone));
+  cone->cutoff = -1.0f; /* never cull */
+  if (tri_count == 0)
     return;
-  }
 
-  /* Compute average normal */
-  float avg_nx = 0, avg_ny = 0, avg_nz = 0;
+  /* Axis: average face normal */
+  float ax = 0, ay = 0, az = 0;
   for (uint32_t t = 0; t < tri_count; t++) {
-    uint32_t i0 = indices[t * 3 + 0];
-    uint32_t i1 = indices[t * 3 + 1];
-    uint32_t i2 = indices[t * 3 + 2];
-
-    /* Face normal via cross product */
-    const MopVec3 *p0 = &vertices[i0].position;
-    const MopVec3 *p1 = &vertices[i1].position;
-    const MopVec3 *p2 = &vertices[i2].position;
-
-    float e1x = p1->x - p0->x, e1y = p1->y - p0->y, e1z = p1->z - p0->z;
-    float e2x = p2->x - p0->x, e2y = p2->y - p0->y, e2z = p2->z - p0->z;
-
-    float nx = e1y * e2z - e1z * e2y;
-    float ny = e1z * e2x - e1x * e2z;
-    float nz = e1x * e2y - e1y * e2x;
-
-    float len = sqrtf(nx * nx + ny * ny + nz * nz);
-    if (len > 1e-8f) {
-      float inv = 1.0f / len;
-      avg_nx += nx * inv;
-      avg_ny += ny * inv;
-      avg_nz += nz * inv;
-    }
+    MopVec3 n = face_normal(vertices, indices[t * 3 + 0], indices[t * 3 + 1],
+                            indices[t * 3 + 2]);
+    ax += n.x;
+    ay += n.y;
+    az += n.z;
   }
 
-  float alen = sqrtf(avg_nx * avg_nx + avg_ny * avg_ny + avg_nz * avg_nz);
+  float alen = sqrtf(ax * ax + ay * ay + az * az);
   if (alen > 1e-8f) {
     float inv = 1.0f / alen;
-    avg_nx *= inv;
-    avg_ny *= inv;
-    avg_nz *= inv;
+    ax *= inv;
+    ay *= inv;
+    az *= inv;
   } else {
-    avg_nx = 0;
-    avg_ny = 1;
-    avg_nz = 0;
+    ax = 0;
+    ay = 1;
+    az = 0;
   }
 
-  cone->axis[0] = avg_nx;
-  cone->axis[1] = avg_ny;
-  cone->axis[2] = avg_nz;
+  cone->axis[0] = ax;
+  cone->axis[1] = ay;
+  cone->axis[2] = az;
 
   /* Cutoff = minimum dot product of any face normal with the average */
   float min_dot = 1.0f;
+  bool any = false;
   for (uint32_t t = 0; t < tri_count; t++) {
-    uint32_t i0 = indices[t * 3 + 0];
-    uint32_t i1 = indices[t * 3 + 1];
-    uint32_t i2 = indices[t * 3 + 2];
-
-    const MopVec3 *p0 = &vertices[i0].position;
-    const MopVec3 *p1 = &vertices[i1].position;
-    const MopVec3 *p2 = &vertices[i2].position;
-
-    float e1x = p1->x - p0->x, e1y = p1->y - p0->y, e1z = p1->z - p0->z;
-    float e2x = p2->x - p0->x, e2y = p2->y - p0->y, e2z = p2->z - p0->z;
-
-    float nx = e1y * e2z - e1z * e2y;
-    float ny = e1z * e2x - e1x * e2z;
-    float nz = e1x * e2y - e1y * e2x;
-
-    float len = sqrtf(nx * nx + ny * ny + nz * nz);
-    if (len > 1e-8f) {
-      float inv = 1.0f / len;
-      float dot =
-          (nx * inv) * avg_nx + (ny * inv) * avg_ny + (nz * inv) * avg_nz;
-      if (dot < min_dot)
-        min_dot = dot;
-    }
+    MopVec3 n = face_normal(vertices, indices[t * 3 + 0], indices[t * 3 + 1],
+                            indices[t * 3 + 2]);
+    if (n.x == 0.0f && n.y == 0.0f && n.z == 0.0f)
+      continue;
+    min_dot = fminf(min_dot, n.x * ax + n.y * ay + n.z * az);
+    any = true;
   }
+  if (any)
+    cone->cutoff = min_dot;
 
-  cone->cutoff = min_dot;
-
-  /* Apex = center offset along -axis by radius/sin(angle) */
+  /* Apex at the sphere center; culling tests widen by the radius */
   cone->apex[0] = center[0];
   cone->apex[1] = center[1];
   cone->apex[2] = center[2];
 }
 
 /* -------------------------------------------------------------------------
- * Meshlet builder
+ * Morton ordering of triangle centroids
  * ------------------------------------------------------------------------- */
 
-uint32_t mop_meshlet_count_estimate(uint32_t triangle_count) {
-  if (triangle_count == 0)
-    return 0;
-  return (triangle_count + MOP_MESHLET_MAX_TRIANGLES - 1) /
-         MOP_MESHLET_MAX_TRIANGLES;
+/* Stable LSD radix sort of (key, value) pairs by key, 11 bits per pass.
+ * False on OOM, leaving the arrays untouched. */
+static bool sort_pairs(uint32_t *keys, uint32_t *vals, uint32_t count) {
+  uint32_t *tk = malloc((size_t)count * sizeof(uint32_t));
+  uint32_t *tv = malloc((size_t)count * sizeof(uint32_t));
+  if (!tk || !tv) {
+    free(tk);
+    free(tv);
+    return false;
+  }
+  uint32_t *sk = keys, *sv = vals, *dk = tk, *dv = tv;
+  for (int shift = 0; shift < 32; shift += 11) {
+    uint32_t bucket[2049] = {0};
+    for (uint32_t i = 0; i < count; i++)
+      bucket[((sk[i] >> shift) & 0x7FF) + 1]++;
+    for (int d = 0; d < 2048; d++)
+      bucket[d + 1] += bucket[d];
+    for (uint32_t i = 0; i < count; i++) {
+      uint32_t dst = bucket[(sk[i] >> shift) & 0x7FF]++;
+      dk[dst] = sk[i];
+      dv[dst] = sv[i];
+    }
+    uint32_t *swap = sk;
+    sk = dk, dk = swap;
+    swap = sv;
+    sv = dv, dv = swap;
+  }
+  /* Three passes: the sorted data ended up in the scratch arrays */
+  memcpy(keys, sk, (size_t)count * sizeof(uint32_t));
+  memcpy(vals, sv, (size_t)count * sizeof(uint32_t));
+  free(tk);
+  free(tv);
+  return true;
 }
 
-bool mop_meshlet_build(const MopVertex *vertices, uint32_t vertex_count,
-                       const uint32_t *indices, uint32_t index_count,
-                       MopMeshletData *out) {
-  if (!out)
-    return false;
-  memset(out, 0, sizeof(*out));
-  if (!vertices || !indices || vertex_count == 0 || index_count == 0) {
-    MOP_WARN("mop_meshlet_build: invalid input");
-    return false;
+/* Spread the low 10 bits of v to every third bit */
+static uint32_t morton_part(uint32_t v) {
+  v &= 0x3FF;
+  v = (v | (v << 16)) & 0x030000FF;
+  v = (v | (v << 8)) & 0x0300F00F;
+  v = (v | (v << 4)) & 0x030C30C3;
+  v = (v | (v << 2)) & 0x09249249;
+  return v;
+}
+
+/* Triangle ids sorted by the 30-bit Morton code of their centroids
+ * (stable, so ties keep index order).  NULL on OOM. */
+static uint32_t *morton_order(const MopVertex *vertices,
+                              const uint32_t *indices, uint32_t tri_count) {
+  uint32_t *keys = malloc(tri_count * sizeof(uint32_t));
+  uint32_t *order = malloc(tri_count * sizeof(uint32_t));
+  if (!keys || !order) {
+    free(keys);
+    free(order);
+    return NULL;
   }
-  if (index_count % 3 != 0) {
-    MOP_WARN("mop_meshlet_build: index_count must be multiple of 3");
-    return false;
+
+  float lo[3] = {FLT_MAX, FLT_MAX, FLT_MAX};
+  float hi[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+  for (uint32_t t = 0; t < tri_count; t++)
+    for (int k = 0; k < 3; k++) {
+      const MopVec3 *p = &vertices[indices[t * 3 + k]].position;
+      lo[0] = fminf(lo[0], p->x), hi[0] = fmaxf(hi[0], p->x);
+      lo[1] = fminf(lo[1], p->y), hi[1] = fmaxf(hi[1], p->y);
+      lo[2] = fminf(lo[2], p->z), hi[2] = fmaxf(hi[2], p->z);
+    }
+  /* One scale for all axes keeps cells cubic on elongated meshes */
+  float extent = fmaxf(hi[0] - lo[0], fmaxf(hi[1] - lo[1], hi[2] - lo[2]));
+  float scale = extent > 0.0f ? 1023.0f / extent : 0.0f;
+
+  for (uint32_t t = 0; t < tri_count; t++) {
+    const MopVec3 *a = &vertices[indices[t * 3 + 0]].position;
+    const MopVec3 *b = &vertices[indices[t * 3 + 1]].position;
+    const MopVec3 *c = &vertices[indices[t * 3 + 2]].position;
+    float cx = (a->x + b->x + c->x) * (1.0f / 3.0f);
+    float cy = (a->y + b->y + c->y) * (1.0f / 3.0f);
+    float cz = (a->z + b->z + c->z) * (1.0f / 3.0f);
+    uint32_t qx = (uint32_t)((cx - lo[0]) * scale + 0.5f);
+    uint32_t qy = (uint32_t)((cy - lo[1]) * scale + 0.5f);
+    uint32_t qz = (uint32_t)((cz - lo[2]) * scale + 0.5f);
+    keys[t] = morton_part(qx) | (morton_part(qy) << 1) |
+              (morton_part(qz) << 2);
+    order[t] = t;
   }
 
-  uint32_t tri_count = index_count / 3;
+  bool ok = sort_pairs(keys, order, tri_count);
+  free(keys);
+  if (!ok) {
+    free(order);
+    return NULL;
+  }
+  return order;
+}
 
-  /* Estimate max meshlets — must account for both the triangle limit
-   * (124 per meshlet) and the vertex limit (64 per meshlet).  Worst case
-   * for vertex limit: every triangle uses 3 unique vertices →
-   * floor(64/3) = 21 triangles per meshlet. */
-  uint32_t by_tris =
-      (tri_count + MOP_MESHLET_MAX_TRIANGLES - 1) / MOP_MESHLET_MAX_TRIANGLES;
-  uint32_t min_tris_per_vert_limit = MOP_MESHLET_MAX_VERTICES / 3;
-  uint32_t by_verts =
-      (tri_count + min_tris_per_vert_limit - 1) / min_tris_per_vert_limit;
-  uint32_t max_meshlets = (by_verts > by_tris ? by_verts : by_tris) + 1;
-
-  out->meshlets = (MopMeshlet *)calloc(max_meshlets, sizeof(MopMeshlet));
-  out->cones = (MopMeshletCone *)calloc(max_meshlets, sizeof(MopMeshletCone));
-  /* Worst case: every vertex unique per meshlet */
-  uint32_t max_vert_indices = max_meshlets * MOP_MESHLET_MAX_VERTICES;
-  out->vertex_indices = (uint32_t *)malloc(max_vert_indices * sizeof(uint32_t));
-  /* Worst case: max triangles per meshlet */
-  uint32_t max_prim = max_meshlets * MOP_MESHLET_MAX_INDICES;
-  out->prim_indices = (uint8_t *)malloc(max_prim);
-
-  if (!out->meshlets || !out->cones || !out->vertex_indices ||
-      !out->prim_indices) {
-    mop_meshlet_free(out);
+/* -------------------------------------------------------------------------
+ * Per-partition clustering
+ * ------------------------------------------------------------------------- */
+
+typedef struct BuildCtx {
+  const MopVertex *vertices;
+  const uint32_t *indices;
+  const uint32_t *order; /* Morton-sorted triangle ids */
+  struct Partition *parts;
+  uint32_t tri_count;
+  uint32_t part_count;
+} BuildCtx;
+
+typedef struct Partition {
+  uint32_t tri_begin, tri_end; /* range of BuildCtx.order */
+
+  /* Output, offsets relative to this partition */
+  MopMeshlet *meshlets;
+  MopMeshletCone *cones;
+  uint32_t meshlet_count;
+  uint32_t *vertex_indices;
+  uint32_t vertex_index_count;
+  uint8_t *prim_indices;
+  uint32_t prim_index_count;
+  bool ok;
+} Partition;
+
+/* Working state of one partition.  Vertices are renumbered 0..nv-1 over
+ * the partition so every table is sized by the partition, not the mesh. */
+typedef struct Cluster {
+  uint32_t n;          /* triangles */
+  uint32_t nv;         /* distinct vertices */
+  uint32_t *verts;     /* local vertex -> global id */
+  uint32_t *corners;   /* 3 local vertex ids per triangle */
+  uint32_t *adj_start; /* CSR: local vertex -> triangles using it */
+  uint32_t *adj;
+  uint32_t *live;      /* per vertex: triangles not yet emitted */
+  int32_t *slot;       /* per vertex: index in the open meshlet, or -1 */
+  float *centroid;     /* 3 per triangle */
+  float *normal;       /* 3 per triangle, unit or zero */
+  bool *emitted;
+  uint32_t *cand;      /* triangles touching the open meshlet */
+  uint32_t cand_count;
+  bool *queued;        /* per triangle: present in cand */
+} Cluster;
+
+static void cluster_free(Cluster *c) {
+  free(c->verts);
+  free(c->corners);
+  free(c->adj_start);
+  free(c->adj);
+  free(c->live);
+  free(c->slot);
+  free(c->centroid);
+  free(c->normal);
+  free(c->emitted);
+  free(c->cand);
+  free(c->queued);
+}
+
+static bool cluster_init(Cluster *c, const BuildCtx *ctx, const Partition *p) {
+  memset(c, 0, sizeof(*c));
+  uint32_t n = p->tri_end - p->tri_begin;
+  c->n = n;
+  c->verts = malloc((size_t)n * 3 * sizeof(uint32_t));
+  c->corners = malloc((size_t)n * 3 * sizeof(uint32_t));
+  c->centroid = malloc((size_t)n * 3 * sizeof(float));
+  c->normal = malloc((size_t)n * 3 * sizeof(float));
+  uint32_t *keys = malloc((size_t)n * 3 * sizeof(uint32_t));
+  c->emitted = calloc(n, sizeof(bool));
+  c->cand = malloc((size_t)n * sizeof(uint32_t));
+  c->queued = calloc(n, sizeof(bool));
+  if (!c->verts || !c->corners || !c->centroid || !c->normal || !keys ||
+      !c->emitted || !c->cand || !c->queued) {
+    free(keys);
     return false;
   }
 
-  /* Per-meshlet working state */
-  uint32_t local_verts[MOP_MESHLET_MAX_VERTICES];
-  uint32_t local_vert_count = 0;
-  uint8_t local_prims[MOP_MESHLET_MAX_INDICES];
-  uint32_t local_prim_count = 0;
+  for (uint32_t t = 0; t < n; t++) {
+    const uint32_t *tri =
+        ctx->indices + (size_t)ctx->order[p->tri_begin + t] * 3;
+    float *ce = &c->centroid[t * 3];
+    ce[0] = ce[1] = ce[2] = 0.0f;
+    for (int k = 0; k < 3; k++) {
+      const MopVec3 *pos = &ctx->vertices[tri[k]].position;
+      keys[t * 3 + k] = tri[k];
+      c->verts[t * 3 + k] = t * 3 + k;
+      ce[0] += pos->x * (1.0f / 3.0f);
+      ce[1] += pos->y * (1.0f / 3.0f);
+      ce[2] += pos->z * (1.0f / 3.0f);
+    }
+    MopVec3 nrm = face_normal(ctx->vertices, tri[0], tri[1], tri[2]);
+    c->normal[t * 3 + 0] = nrm.x;
+    c->normal[t * 3 + 1] = nrm.y;
+    c->normal[t * 3 + 2] = nrm.z;
+  }
 
-  /* Map from global vertex index to local meshlet index (-1 = not added) */
-  int32_t *vert_map = (int32_t *)malloc(vertex_count * sizeof(int32_t));
-  if (!vert_map) {
-    mop_meshlet_free(out);
-    return false;
+  /* Sort corners by vertex id; runs of equal ids become local vertices */
+  bool sorted = sort_pairs(keys, c->verts, n * 3);
+  uint32_t nv = 0;
+  for (uint32_t i = 0; sorted && i < n * 3; i++) {
+    uint32_t corner = c->verts[i]; /* read before nv - 1 <= i is written */
+    if (i == 0 || keys[i] != keys[i - 1])
+      c->verts[nv++] = keys[i];
+    c->corners[corner] = nv - 1;
   }
-  memset(vert_map, -1, vertex_count * sizeof(int32_t));
+  c->nv = nv;
+  free(keys);
+  if (!sorted)
+    return false;
 
-  /* Greedy pass: pack triangles into meshlets */
-  uint32_t meshlet_idx = 0;
-  uint32_t total_vert_indices = 0;
-  uint32_t total_prim_indices = 0;
+  /* Vertex -> triangle adjacency (one entry per corner) */
+  c->adj_start = calloc((size_t)nv + 1, sizeof(uint32_t));
+  c->adj = malloc((size_t)n * 3 * sizeof(uint32_t));
+  c->live = calloc(nv, sizeof(uint32_t));
+  c->slot = malloc((size_t)nv * sizeof(int32_t));
+  if (!c->adj_start || !c->adj || !c->live || !c->slot)
+    return false;
+  for (uint32_t i = 0; i < n * 3; i++)
+    c->adj_start[c->corners[i] + 1]++;
+  for (uint32_t v = 0; v < nv; v++)
+    c->adj_start[v + 1] += c->adj_start[v];
+  for (uint32_t i = 0; i < n * 3; i++) {
+    uint32_t v = c->corners[i];
+    c->adj[c->adj_start[v] + c->live[v]++] = i / 3;
+  }
+  memset(c->slot, -1, (size_t)nv * sizeof(int32_t));
+  return true;
+}
 
-  /* Original triangle indices for normal cone computation */
-  uint32_t meshlet_tri_start = 0;
+/* The meshlet being grown */
+typedef struct Open {
+  uint32_t verts[MOP_MESHLET_MAX_VERTICES]; /* local vertex ids */
+  uint32_t vert_count;
+  uint32_t tris[MOP_MESHLET_MAX_TRIANGLES]; /* partition triangle ids */
+  uint32_t tri_count;
+  float centroid_sum[3];
+  float normal_sum[3];
+  float radius; /* farthest triangle centroid from the running center */
+} Open;
+
+/* Vertices triangle t would add to the open meshlet */
+static uint32_t new_vertex_count(const Cluster *c, uint32_t t) {
+  const uint32_t *v = &c->corners[t * 3];
+  uint32_t extra = (c->slot[v[0]] < 0);
+  extra += (c->slot[v[1]] < 0 && v[1] != v[0]);
+  extra += (c->slot[v[2]] < 0 && v[2] != v[0] && v[2] != v[1]);
+  return extra;
+}
 
-  for (uint32_t t = 0; t < tri_count; t++) {
-    uint32_t i0 = indices[t * 3 + 0];
-    uint32_t i1 = indices[t * 3 + 1];
-    uint32_t i2 = indices[t * 3 + 2];
-
-    /* Count how many new vertices this triangle needs */
-    uint32_t new_verts = 0;
-    if (vert_map[i0] < 0)
-      new_verts++;
-    if (vert_map[i1] < 0)
-      new_verts++;
-    if (vert_map[i2] < 0)
-      new_verts++;
-
-    /* Check if triangle fits in current meshlet */
-    bool fits = (local_vert_count + new_verts <= MOP_MESHLET_MAX_VERTICES) &&
-                (local_prim_count / 3 + 1 <= MOP_MESHLET_MAX_TRIANGLES);
-
-    if (!fits && local_prim_count > 0) {
-      /* Emit current meshlet */
-      MopMeshlet *ml = &out->meshlets[meshlet_idx];
-      ml->vertex_offset = total_vert_indices;
-      ml->vertex_count = local_vert_count;
-      ml->triangle_offset = total_prim_indices;
-      ml->triangle_count = local_prim_count / 3;
-
-      /* Bounding sphere */
-      compute_bounding_sphere(vertices, local_verts, local_vert_count,
-                              ml->center, &ml->radius);
-
-      /* Normal cone */
-      compute_normal_cone(vertices, indices + meshlet_tri_start * 3,
-                          local_prim_count / 3, ml->center,
-                          &out->cones[meshlet_idx]);
-
-      /* Copy to output buffers */
-      memcpy(out->vertex_indices + total_vert_indices, local_verts,
-             local_vert_count * sizeof(uint32_t));
-      total_vert_indices += local_vert_count;
-
-      memcpy(out->prim_indices + total_prim_indices, local_prims,
-             local_prim_count);
-      total_prim_indices += local_prim_count;
-
-      meshlet_idx++;
-
-      /* Reset for next meshlet */
-      for (uint32_t v = 0; v < local_vert_count; v++)
-        vert_map[local_verts[v]] = -1;
-      local_vert_count = 0;
-      local_prim_count = 0;
-      meshlet_tri_start = t;
+static void open_add(Cluster *c, Open *o, uint32_t t) {
+  c->emitted[t] = true;
+  for (int k = 0; k < 3; k++) {
+    uint32_t v = c->corners[t * 3 + k];
+    c->live[v]--;
+    if (c->slot[v] >= 0)
+      continue;
+    c->slot[v] = (int32_t)o->vert_count;
+    o->verts[o->vert_count++] = v;
+    /* A new vertex brings its triangles into reach */
+    for (uint32_t a = c->adj_start[v]; a < c->adj_start[v + 1]; a++) {
+      uint32_t u = c->adj[a];
+      if (!c->emitted[u] && !c->queued[u]) {
+        c->queued[u] = true;
+        c->cand[c->cand_count++] = u;
+      }
     }
+  }
+  o->tris[o->tri_count++] = t;
+  const float *ce = &c->centroid[t * 3];
+  float inv = 1.0f / (float)o->tri_count;
+  float d2 = 0.0f;
+  for (int k = 0; k < 3; k++) {
+    o->centroid_sum[k] += ce[k];
+    o->normal_sum[k] += c->normal[t * 3 + k];
+    float d = ce[k] - o->centroid_sum[k] * inv;
+    d2 += d * d;
+  }
+  o->radius = fmaxf(o->radius, sqrtf(d2));
+}
 
-    /* Add vertices */
-    uint32_t li0, li1, li2;
-    if (vert_map[i0] < 0) {
-      vert_map[i0] = (int32_t)local_vert_count;
-      local_verts[local_vert_count++] = i0;
+/* Best next triangle among those sharing a vertex with the open meshlet:
+ * fewest new vertices first, then closest to the meshlet center and best
+ * aligned with its average normal.  Candidates that were taken or no
+ * longer fit are dropped along the way.  UINT32_MAX if none fits. */
+static uint32_t open_pick(Cluster *c, const Open *o) {
+  float inv = 1.0f / (float)o->tri_count;
+  float center[3] = {o->centroid_sum[0] * inv, o->centroid_sum[1] * inv,
+                     o->centroid_sum[2] * inv};
+  float nl = sqrtf(o->normal_sum[0] * o->normal_sum[0] +
+                   o->normal_sum[1] * o->normal_sum[1] +
+                   o->normal_sum[2] * o->normal_sum[2]);
+  float axis[3] = {0, 0, 0};
+  if (nl > 1e-8f)
+    for (int k = 0; k < 3; k++)
+      axis[k] = o->normal_sum[k] / nl;
+  float inv_r = 1.0f / fmaxf(o->radius, 1e-6f);
+
+  uint32_t best = UINT32_MAX, best_extra = 4;
+  float best_score = FLT_MAX;
+  uint32_t kept = 0;
+  for (uint32_t i = 0; i < c->cand_count; i++) {
+    uint32_t t = c->cand[i];
+    uint32_t extra = c->emitted[t] ? 4 : new_vertex_count(c, t);
+    if (extra == 4 || o->vert_count + extra > MOP_MESHLET_MAX_VERTICES) {
+      c->queued[t] = false;
+      continue;
+    }
+    c->cand[kept++] = t;
+    if (extra > best_extra)
+      continue;
+    const float *ce = &c->centroid[t * 3];
+    const float *n = &c->normal[t * 3];
+    float dx = ce[0] - center[0], dy = ce[1] - center[1],
+          dz = ce[2] - center[2];
+    float spread = sqrtf(dx * dx + dy * dy + dz * dz) * inv_r;
+    float align = n[0] * axis[0] + n[1] * axis[1] + n[2] * axis[2];
+    float score = spread + CONE_WEIGHT * (1.0f - align);
+    if (extra < best_extra || score < best_score) {
+      best = t;
+      best_extra = extra;
+      best_score = score;
     }
-    li0 = (uint32_t)vert_map[i0];
+  }
+  c->cand_count = kept;
+  return best;
+}
 
-    if (vert_map[i1] < 0) {
-      vert_map[i1] = (int32_t)local_vert_count;
-      local_verts[local_vert_count++] = i1;
+/* Seed for the next meshlet: the live triangle on the previous meshlet's
+ * border with the fewest live neighbours (growing from the most hemmed-in
+ * spot leaves fewer stragglers), else the next one in Morton order. */
+static uint32_t next_seed(const Cluster *c, const Open *prev,
+                          uint32_t *cursor) {
+  uint32_t best = UINT32_MAX, best_live = UINT32_MAX;
+  for (uint32_t i = 0; i < prev->vert_count; i++) {
+    uint32_t v = prev->verts[i];
+    if (c->live[v] == 0)
+      continue;
+    for (uint32_t a = c->adj_start[v]; a < c->adj_start[v + 1]; a++) {
+      uint32_t t = c->adj[a];
+      if (c->emitted[t])
+        continue;
+      const uint32_t *tv = &c->corners[t * 3];
+      uint32_t l = c->live[tv[0]] + c->live[tv[1]] + c->live[tv[2]];
+      if (l < best_live) {
+        best = t;
+        best_live = l;
+      }
     }
-    li1 = (uint32_t)vert_map[i1];
+  }
+  if (best != UINT32_MAX)
+    return best;
+  while (c->emitted[*cursor])
+    (*cursor)++;
+  return *cursor;
+}
 
-    if (vert_map[i2] < 0) {
-      vert_map[i2] = (int32_t)local_vert_count;
-      local_verts[local_vert_count++] = i2;
+static void open_emit(Cluster *c, const BuildCtx *ctx, Partition *p,
+                      const Open *o) {
+  MopMeshlet *ml = &p->meshlets[p->meshlet_count];
+  ml->vertex_offset = p->vertex_index_count;
+  ml->vertex_count = o->vert_count;
+  ml->triangle_offset = p->prim_index_count;
+  ml->triangle_count = o->tri_count;
+
+  uint32_t *vi = p->vertex_indices + p->vertex_index_count;
+  for (uint32_t i = 0; i < o->vert_count; i++)
+    vi[i] = c->verts[o->verts[i]];
+
+  uint32_t global[MOP_MESHLET_MAX_INDICES];
+  uint8_t *prims = p->prim_indices + p->prim_index_count;
+  for (uint32_t t = 0; t < o->tri_count; t++)
+    for (int k = 0; k < 3; k++) {
+      uint32_t v = c->corners[o->tris[t] * 3 + k];
+      prims[t * 3 + k] = (uint8_t)c->slot[v];
+      global[t * 3 + k] = c->verts[v];
     }
-    li2 = (uint32_t)vert_map[i2];
 
-    /* Add triangle with local indices */
-    local_prims[local_prim_count++] = (uint8_t)li0;
-    local_prims[local_prim_count++] = (uint8_t)li1;
-    local_prims[local_prim_count++] = (uint8_t)li2;
+  compute_bounding_sphere(ctx->vertices, vi, o->vert_count, ml->center,
+                          &ml->radius);
+  compute_normal_cone(ctx->vertices, global, o->tri_count, ml->center,
+                      &p->cones[p->meshlet_count]);
+
+  for (uint32_t i = 0; i < o->vert_count; i++)
+    c->slot[o->verts[i]] = -1;
+  for (uint32_t i = 0; i < c->cand_count; i++)
+    c->queued[c->cand[i]] = false;
+  c->cand_count = 0;
+  p->vertex_index_count += o->vert_count;
+  p->prim_index_count += o->tri_count * 3;
+  p->meshlet_count++;
+}
+
+static void partition_build(void *vctx, int index) {
+  const BuildCtx *ctx = (const BuildCtx *)vctx;
+  Partition *p = &ctx->parts[index];
+  uint32_t n = p->tri_end - p->tri_begin;
+
+  /* Worst case one triangle per meshlet */
+  p->meshlets = malloc((size_t)n * sizeof(MopMeshlet));
+  p->cones = malloc((size_t)n * sizeof(MopMeshletCone));
+  p->vertex_indices = malloc((size_t)n * 3 * sizeof(uint32_t));
+  p->prim_indices = malloc((size_t)n * 3);
+  Cluster c;
+  memset(&c, 0, sizeof(c));
+  if (!p->meshlets || !p->cones || !p->vertex_indices || !p->prim_indices ||
+      !cluster_init(&c, ctx, p)) {
+    cluster_free(&c);
+    return;
   }
 
-  /* Emit final meshlet */
-  if (local_prim_count > 0) {
-    MopMeshlet *ml = &out->meshlets[meshlet_idx];
-    ml->vertex_offset = total_vert_indices;
-    ml->vertex_count = local_vert_count;
-    ml->triangle_offset = total_prim_indices;
-    ml->triangle_count = local_prim_count / 3;
+  Open o, prev = {0};
+  uint32_t remaining = n, cursor = 0;
+  while (remaining > 0) {
+    memset(&o, 0, sizeof(o));
+    open_add(&c, &o, next_seed(&c, &prev, &cursor));
+    while (o.tri_count < MOP_MESHLET_MAX_TRIANGLES) {
+      uint32_t t = open_pick(&c, &o);
+      if (t == UINT32_MAX)
+        break;
+      open_add(&c, &o, t);
+    }
+    open_emit(&c, ctx, p, &o);
+    remaining -= o.tri_count;
+    prev = o;
+  }
+  cluster_free(&c);
+  p->ok = true;
+}
 
-    compute_bounding_sphere(vertices, local_verts, local_vert_count, ml->center,
-                            &ml->radius);
-    compute_normal_cone(vertices, indices + meshlet_tri_start * 3,
-                        local_prim_count / 3, ml->center,
-                        &out->cones[meshlet_idx]);
+/* -------------------------------------------------------------------------
+ * Meshlet builder
+ * ------------------------------------------------------------------------- */
 
-    memcpy(out->vertex_indices + total_vert_indices, local_verts,
-           local_vert_count * sizeof(uint32_t));
-    total_vert_indices += local_vert_count;
+uint32_t mop_meshlet_count_estimate(uint32_t triangle_count) {
+  if (triangle_count == 0)
+    return 0;
+  return (triangle_count + MOP_MESHLET_MAX_TRIANGLES - 1) /
+         MOP_MESHLET_MAX_TRIANGLES;
+}
 
-    memcpy(out->prim_indices + total_prim_indices, local_prims,
-           local_prim_count);
-    total_prim_indices += local_prim_count;
+bool mop_meshlet_build_ex(MopViewport *viewport, const MopVertex *vertices,
+                          uint32_t vertex_count, const uint32_t *indices,
+                          uint32_t index_count, MopMeshletData *out) {
+  if (!out)
+    return false;
+  memset(out, 0, sizeof(*out));
+  if (!vertices || !indices || vertex_count == 0 || index_count == 0) {
+    MOP_WARN("mop_meshlet_build: invalid input");
+    return false;
+  }
+  if (index_count % 3 != 0) {
+    MOP_WARN("mop_meshlet_build: index_count must be multiple of 3");
+    return false;
+  }
+  for (uint32_t i = 0; i < index_count; i++) {
+    if (indices[i] >= vertex_count) {
+      MOP_WARN("mop_meshlet_build: index %u out of range", indices[i]);
+      return false;
+    }
+  }
 
-    meshlet_idx++;
+  uint32_t tri_count = index_count / 3;
+  uint32_t *order = morton_order(vertices, indices, tri_count);
+  uint32_t part_count = (tri_count + PARTITION_TRIS - 1) / PARTITION_TRIS;
+  Partition *parts = calloc(part_count, sizeof(Partition));
+  if (!order || !parts) {
+    free(order);
+    free(parts);
+    return false;
+  }
+  for (uint32_t i = 0; i < part_count; i++) {
+    parts[i].tri_begin = (uint32_t)((uint64_t)tri_count * i / part_count);
+    parts[i].tri_end = (uint32_t)((uint64_t)tri_count * (i + 1) / part_count);
   }
 
-  free(vert_map);
+  BuildCtx ctx = {.vertices = vertices,
+                  .indices = indices,
+                  .order = order,
+                  .parts = parts,
+                  .tri_count = tri_count,
+                  .part_count = part_count};
+  mop_threadpool_parallel_rows(viewport ? viewport->thread_pool : NULL,
+                               (int)part_count, partition_build, &ctx);
+
+  /* Concatenate partitions in Morton order */
+  bool ok = true;
+  uint32_t total_ml = 0, total_vi = 0, total_pi = 0;
+  for (uint32_t i = 0; i < part_count; i++) {
+    ok &= parts[i].ok;
+    total_ml += parts[i].meshlet_count;
+    total_vi += parts[i].vertex_index_count;
+    total_pi += parts[i].prim_index_count;
+  }
+  if (ok) {
+    out->meshlets = malloc((size_t)total_ml * sizeof(MopMeshlet));
+    out->cones = malloc((size_t)total_ml * sizeof(MopMeshletCone));
+    out->vertex_indices = malloc((size_t)total_vi * sizeof(uint32_t));
+    out->prim_indices = malloc(total_pi);
+    ok = out->meshlets && out->cones && out->vertex_indices &&
+         out->prim_indices;
+  }
+  if (ok) {
+    for (uint32_t i = 0; i < part_count; i++) {
+      const Partition *p = &parts[i];
+      for (uint32_t m = 0; m < p->meshlet_count; m++) {
+        MopMeshlet ml = p->meshlets[m];
+        ml.vertex_offset += out->vertex_index_count;
+        ml.triangle_offset += out->prim_index_count;
+        out->meshlets[out->meshlet_count] = ml;
+        out->cones[out->meshlet_count++] = p->cones[m];
+      }
+      memcpy(out->vertex_indices + out->vertex_index_count,
+             p->vertex_indices, p->vertex_index_count * sizeof(uint32_t));
+      out->vertex_index_count += p->vertex_index_count;
+      memcpy(out->prim_indices + out->prim_index_count, p->prim_indices,
+             p->prim_index_count);
+      out->prim_index_count += p->prim_index_count;
+    }
+  }
 
-  out->meshlet_count = meshlet_idx;
-  out->vertex_index_count = total_vert_indices;
-  out->prim_index_count = total_prim_indices;
+  for (uint32_t i = 0; i < part_count; i++) {
+    free(parts[i].meshlets);
+    free(parts[i].cones);
+    free(parts[i].vertex_indices);
+    free(parts[i].prim_indices);
+  }
+  free(parts);
+  free(order);
+  if (!ok)
+    mop_meshlet_free(out);
+  return ok;
+}
 
-  return true;
+bool mop_meshlet_build(const MopVertex *vertices, uint32_t vertex_count,
+                       const uint32_t *indices, uint32_t index_count,
+                       MopMeshletData *out) {
+  return mop_meshlet_build_ex(NULL, vertices, vertex_count, indices,
+                              index_count, out);
 }
 
 /* -------------------------------------------------------------------------
@@ -354,3 +755,52 @@ void mop_meshlet_free(MopMeshletData *data) {
   free(data->prim_indices);
   memset(data, 0, sizeof(*data));
 }
+
+/* -------------------------------------------------------------------------
+ * Mesh integration — meshlets consumed by the CPU backend's cluster culling
+ * ------------------------------------------------------------------------- */
+
+uint32_t mop_mesh_build_meshlets(MopMesh *mesh) {
+  if (!mesh || !mesh->viewport)
+    return 0;
+  if (mesh->vertex_format) {
+    MOP_WARN("mop_mesh_build_meshlets: flexible vertex formats unsupported");
+    return 0;
+  }
+
+  MopViewport *vp = mesh->viewport;
+  MOP_VP_LOCK(vp);
+  const MopVertex *vertices =
+      (const MopVertex *)vp->rhi->buffer_read(mesh->vertex_buffer);
+  const uint32_t *indices =
+      (const uint32_t *)vp->rhi->buffer_read(mesh->index_buffer);
+  uint32_t index_count = mesh->index_count / 3 * 3;
+  bool ok = vertices && indices && index_count > 0;
+  for (uint32_t i = 0; ok && i < index_count; i++)
+    ok = indices[i] < mesh->vertex_count;
+  if (!ok) {
+    MOP_VP_UNLOCK(vp);
+    MOP_WARN("mop_mesh_build_meshlets: mesh has no valid index buffer");
+    return 0;
+  }
+
+  MopMeshletData *data = malloc(sizeof(MopMeshletData));
+  if (!data || !mop_meshlet_build_ex(vp, vertices, mesh->vertex_count,
+                                     indices, index_count, data)) {
+    free(data);
+    MOP_VP_UNLOCK(vp);
+    return 0;
+  }
+  if (mesh->meshlets) {
+    mop_meshlet_free(mesh->meshlets);
+    free(mesh->meshlets);
+  }
+  mesh->meshlets = data;
+  uint32_t count = data->meshlet_count;
+  MOP_VP_UNLOCK(vp);
+  return count;
+}
+
+uint32_t mop_mesh_get_meshlet_count(const MopMesh *mesh) {
+  return (mesh && mesh->meshlets) ? mesh->meshlets->meshlet_count : 0;
+}
@@ -470,7 +470,7 @@ void mop_overlay_builtin_normals(MopViewport *vp, void *user_data) {
       continue;
     if (m->object_id == 0)
       continue;
-    if (m->object_id >= 0xFFFE0000u)
+    if (m->object_id >= 0xFFFE0000u || m->vertex_format)
       continue;
 
     const MopVertex *verts =
@@ -577,7 +577,7 @@ void mop_overlay_builtin_bounds(MopViewport *vp, void *user_data) {
       continue;
     if (m->object_id == 0)
       continue;
-    if (m->object_id >= 0xFFFE0000u)
+    if (m->object_id >= 0xFFFE0000u || m->vertex_format)
       continue;
 
     const MopVertex *verts =
@@ -844,11 +844,7 @@ void mop_overlay_builtin_skeleton(MopViewport *vp, void *user_data) {
  * ------------------------------------------------------------------------- */
 
 static bool is_id_selected(const MopViewport *vp, uint32_t id) {
-  for (uint32_t i = 0; i < vp->selected_count; i++) {
-    if (vp->selected_ids[i] == id)
-      return true;
-  }
-  return false;
+  return mop_id_set_contains(&vp->selected_set, id);
 }
 
 void mop_overlay_builtin_selection(MopViewport *vp, void *user_data) {
@@ -902,12 +898,8 @@ void mop_overlay_builtin_selection(MopViewport *vp, void *user_data) {
  * Helper: check if an element index is in the current selection
  * ------------------------------------------------------------------------- */
 
-static bool is_element_selected(const MopSelection *sel, uint32_t index) {
-  for (uint32_t i = 0; i < sel->element_count; i++) {
-    if (sel->elements[i] == index)
-      return true;
-  }
-  return false;
+static bool is_element_selected(const MopViewport *vp, uint32_t index) {
+  return mop_id_set_contains(&vp->element_set, index);
 }
 
 /* -------------------------------------------------------------------------
@@ -942,7 +934,7 @@ void mop_overlay_edit_vertices(MopViewport *vp, void *user_data) {
     return;
 
   struct MopMesh *m = find_edit_mesh(vp);
-  if (!m || !m->vertex_buffer)
+  if (!m || !m->vertex_buffer || m->vertex_format)
     return;
 
   const MopVertex *verts =
@@ -974,7 +966,7 @@ void mop_overlay_edit_vertices(MopViewport *vp, void *user_data) {
 
   for (uint32_t j = 0; j < vc; j++) {
     MopColor c =
-        is_element_selected(&vp->selection, j) ? sel_color : unsorted_color;
+        is_element_selected(vp, j) ? sel_color : unsorted_color;
     MopVec3 p = verts[j].position;
     /* Degenerate line (point) at the vertex position */
     line_v[j * 2 + 0] = (MopVertex){p, n_up, c, 0, 0};
@@ -1052,7 +1044,7 @@ void mop_overlay_edit_edges(MopViewport *vp, void *user_data) {
     return;
 
   struct MopMesh *m = find_edit_mesh(vp);
-  if (!m || !m->vertex_buffer || !m->index_buffer)
+  if (!m || !m->vertex_buffer || !m->index_buffer || m->vertex_format)
     return;
 
   const MopVertex *verts =
@@ -1099,8 +1091,8 @@ void mop_overlay_edit_edges(MopViewport *vp, void *user_data) {
       uint32_t hi = ea < eb ? eb : ea;
       uint32_t edge_id = (lo << 16) | hi;
 
-      MopColor c = is_element_selected(&vp->selection, edge_id) ? sel_color
-                                                                : default_color;
+      MopColor c =
+          is_element_selected(vp, edge_id) ? sel_color : default_color;
 
       line_v[out_idx * 2 + 0] = (MopVertex){verts[ea].position, n_up, c, 0, 0};
       line_v[out_idx * 2 + 1] = (MopVertex){verts[eb].position, n_up, c, 0, 0};
@@ -1184,7 +1176,7 @@ void mop_overlay_edit_faces(MopViewport *vp, void *user_data) {
     return;
 
   struct MopMesh *m = find_edit_mesh(vp);
-  if (!m || !m->vertex_buffer || !m->index_buffer)
+  if (!m || !m->vertex_buffer || !m->index_buffer || m->vertex_format)
     return;
 
   const MopVertex *verts =
@@ -0,0 +1,290 @@
+/*
+ * Master of Puppets — Sub-Element Selection
+ * pick_bvh.c — Morton-ordered BVH build over vertices and edges
+ *
+ * Items are radix sorted by the Morton code of their centroid, then every
+ * node splits its run where the highest differing code bit flips, which
+ * cuts space in half along one axis: the boxes are as tight as an octree's
+ * and the build is a handful of linear passes, so rebuilding after an edit
+ * stays cheap on multi-million vertex meshes.  Runs sharing one code are
+ * split in half by count.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "core/pick_bvh.h"
+#include "core/mesh_topology.h"
+
+#include <float.h>
+#include <stdlib.h>
+
+static inline float axis_of(MopVec3 p, int axis) {
+  return axis == 0 ? p.x : axis == 1 ? p.y : p.z;
+}
+
+/* Spread the low 10 bits of x to every third bit */
+static inline uint32_t morton_spread(uint32_t x) {
+  x &= 0x3FFu;
+  x = (x | (x << 16)) & 0x030000FFu;
+  x = (x | (x << 8)) & 0x0300F00Fu;
+  x = (x | (x << 4)) & 0x030C30C3u;
+  x = (x | (x << 2)) & 0x09249249u;
+  return x;
+}
+
+typedef struct BuildSrc {
+  const MopVertex *vertices;
+  const uint32_t *indices; /* NULL: items are vertices */
+} BuildSrc;
+
+static void item_ends(const BuildSrc *s, uint32_t id, MopVec3 *a,
+                      MopVec3 *b) {
+  if (s->indices) {
+    uint32_t ia, ib;
+    mop_pick_edge_ends(s->indices, id, &ia, &ib);
+    *a = s->vertices[ia].position;
+    *b = s->vertices[ib].position;
+  } else {
+    *a = *b = s->vertices[id].position;
+  }
+}
+
+/* Centroid (twice the midpoint for edges; only the order matters) */
+static inline MopVec3 item_centroid(const BuildSrc *s, uint32_t id) {
+  MopVec3 a, b;
+  item_ends(s, id, &a, &b);
+  return (MopVec3){a.x + b.x, a.y + b.y, a.z + b.z};
+}
+
+/* Sort ids[0, n) by the Morton code of their centroids.  Returns the
+ * sorted codes (n entries, caller frees), NULL on allocation failure. */
+static uint32_t *morton_sort(const BuildSrc *s, uint32_t *ids, uint32_t n) {
+  float lo[3] = {FLT_MAX, FLT_MAX, FLT_MAX};
+  float hi[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+  for (uint32_t i = 0; i < n; i++) {
+    MopVec3 c = item_centroid(s, ids[i]);
+    for (int k = 0; k < 3; k++) {
+      float x = axis_of(c, k);
+      if (x < lo[k])
+        lo[k] = x;
+      if (x > hi[k])
+        hi[k] = x;
+    }
+  }
+
+  /* (code, id) pairs, ping-ponged between two buffers */
+  uint32_t *keys = malloc((size_t)n * 2 * sizeof(uint32_t));
+  uint32_t *tmp = malloc((size_t)n * 2 * sizeof(uint32_t));
+  if (!keys || !tmp) {
+    free(keys);
+    free(tmp);
+    return NULL;
+  }
+  /* One scale for all axes: a cube keeps the cells of thin meshes from
+   * being sliced along their flat axis */
+  float extent = 0.0f;
+  for (int k = 0; k < 3; k++)
+    extent = hi[k] - lo[k] > extent ? hi[k] - lo[k] : extent;
+  float scale = extent > 0.0f ? 1023.0f / extent : 0.0f;
+  for (uint32_t i = 0; i < n; i++) {
+    MopVec3 c = item_centroid(s, ids[i]);
+    uint32_t code = 0;
+    for (int k = 0; k < 3; k++)
+      code |= morton_spread((uint32_t)((axis_of(c, k) - lo[k]) * scale))
+              << k;
+    keys[2 * i] = code;
+    keys[2 * i + 1] = ids[i];
+  }
+
+  /* LSD radix sort over the 30 code bits */
+  for (int shift = 0; shift < 30; shift += 8) {
+    uint32_t count[257] = {0};
+    for (uint32_t i = 0; i < n; i++)
+      count[((keys[2 * i] >> shift) & 0xFFu) + 1]++;
+    for (int d = 0; d < 256; d++)
+      count[d + 1] += count[d];
+    for (uint32_t i = 0; i < n; i++) {
+      uint32_t dst = count[(keys[2 * i] >> shift) & 0xFFu]++;
+      tmp[2 * dst] = keys[2 * i];
+      tmp[2 * dst + 1] = keys[2 * i + 1];
+    }
+    uint32_t *t = keys;
+    keys = tmp;
+    tmp = t;
+  }
+  for (uint32_t i = 0; i < n; i++) {
+    ids[i] = keys[2 * i + 1];
+    tmp[i] = keys[2 * i];
+  }
+  free(keys);
+  return tmp;
+}
+
+/* First index of a sorted code run where the highest bit that differs
+ * across it is set */
+static uint32_t split_run(const uint32_t *codes, uint32_t first,
+                          uint32_t count) {
+  uint32_t diff = codes[first] ^ codes[first + count - 1];
+  if (diff == 0)
+    return first + count / 2;
+  uint32_t bit = 1u << 31;
+  while (!(diff & bit))
+    bit >>= 1;
+  uint32_t lo = first, hi = first + count - 1;
+  while (lo < hi) {
+    uint32_t m = lo + (hi - lo) / 2;
+    if (codes[m] & bit)
+      hi = m;
+    else
+      lo = m + 1;
+  }
+  return lo;
+}
+
+typedef struct BuildTask {
+  uint32_t right_of; /* parent whose right child this is, or UINT32_MAX */
+  uint32_t first;
+  uint32_t count;
+} BuildTask;
+
+/* Takes ownership of ids */
+static MopPickBvh *build(const BuildSrc *s, uint32_t *ids, uint32_t n) {
+  MopPickBvh *b = calloc(1, sizeof(MopPickBvh));
+  uint32_t cap = n / (MOP_PICK_LEAF_SIZE / 2) * 2 + 1;
+  MopPickNode *nodes = malloc((size_t)cap * sizeof(MopPickNode));
+  uint32_t *codes = b && nodes ? morton_sort(s, ids, n) : NULL;
+  if (!codes) {
+    free(b);
+    free(nodes);
+    free(ids);
+    return NULL;
+  }
+  b->items = ids;
+  b->item_count = n;
+
+  BuildTask stack[128];
+  int sp = 0;
+  stack[sp++] = (BuildTask){UINT32_MAX, 0, n};
+  while (sp > 0) {
+    BuildTask t = stack[--sp];
+    if (b->node_count == cap) {
+      /* Uneven splits can leave small leaves */
+      MopPickNode *grown =
+          realloc(nodes, (size_t)cap * 2 * sizeof(MopPickNode));
+      if (!grown) {
+        free(nodes);
+        free(codes);
+        mop_pick_bvh_free(b);
+        return NULL;
+      }
+      nodes = grown;
+      cap *= 2;
+    }
+    uint32_t ni = b->node_count++;
+    if (t.right_of != UINT32_MAX)
+      nodes[t.right_of].first = ni;
+    MopPickNode *node = &nodes[ni];
+
+    if (t.count > MOP_PICK_LEAF_SIZE) {
+      /* Left child is popped next, so it lands at ni + 1 */
+      uint32_t mid = split_run(codes, t.first, t.count);
+      node->count = 0;
+      stack[sp++] = (BuildTask){ni, mid, t.first + t.count - mid};
+      stack[sp++] = (BuildTask){UINT32_MAX, t.first, mid - t.first};
+      continue;
+    }
+
+    node->first = t.first;
+    node->count = t.count;
+    for (int k = 0; k < 3; k++) {
+      node->min[k] = FLT_MAX;
+      node->max[k] = -FLT_MAX;
+    }
+    for (uint32_t i = t.first; i < t.first + t.count; i++) {
+      MopVec3 pa, pb;
+      item_ends(s, ids[i], &pa, &pb);
+      for (int k = 0; k < 3; k++) {
+        float x = axis_of(pa, k), y = axis_of(pb, k);
+        if (x > y) {
+          float tx = x;
+          x = y;
+          y = tx;
+        }
+        if (x < node->min[k])
+          node->min[k] = x;
+        if (y > node->max[k])
+          node->max[k] = y;
+      }
+    }
+  }
+
+  free(codes);
+  b->nodes = nodes;
+
+  /* Children always follow their parent: refit bottom up */
+  for (uint32_t ni = b->node_count; ni-- > 0;) {
+    MopPickNode *node = &nodes[ni];
+    if (node->count > 0)
+      continue;
+    const MopPickNode *l = &nodes[ni + 1], *r = &nodes[node->first];
+    for (int k = 0; k < 3; k++) {
+      node->min[k] = l->min[k] < r->min[k] ? l->min[k] : r->min[k];
+      node->max[k] = l->max[k] > r->max[k] ? l->max[k] : r->max[k];
+    }
+  }
+  return b;
+}
+
+MopPickBvh *mop_pick_bvh_build_vertices(const MopVertex *vertices,
+                                        uint32_t vertex_count) {
+  if (!vertices || vertex_count == 0)
+    return NULL;
+  uint32_t *ids = malloc((size_t)vertex_count * sizeof(uint32_t));
+  if (!ids)
+    return NULL;
+  for (uint32_t i = 0; i < vertex_count; i++)
+    ids[i] = i;
+  BuildSrc s = {vertices, NULL};
+  return build(&s, ids, vertex_count);
+}
+
+MopPickBvh *mop_pick_bvh_build_edges(const MopVertex *vertices,
+                                     uint32_t vertex_count,
+                                     const uint32_t *indices,
+                                     uint32_t index_count,
+                                     const MopMeshTopology *topology) {
+  if (!vertices || !indices)
+    return NULL;
+  index_count -= index_count % 3;
+  if (topology && topology->face_count * 3 != index_count)
+    topology = NULL;
+  uint32_t *ids =
+      malloc((size_t)(index_count ? index_count : 1) * sizeof(uint32_t));
+  if (!ids)
+    return NULL;
+  uint32_t n = 0;
+  for (uint32_t he = 0; he < index_count; he++) {
+    uint32_t a, b;
+    mop_pick_edge_ends(indices, he, &a, &b);
+    if (a == b || a >= vertex_count || b >= vertex_count)
+      continue;
+    /* Keep one half-edge per shared edge */
+    if (topology && topology->edges[he].twin < he)
+      continue;
+    ids[n++] = he;
+  }
+  if (n == 0) {
+    free(ids);
+    return NULL;
+  }
+  BuildSrc s = {vertices, indices};
+  return build(&s, ids, n);
+}
+
+void mop_pick_bvh_free(MopPickBvh *bvh) {
+  if (!bvh)
+    return;
+  free(bvh->nodes);
+  free(bvh->items);
+  free(bvh);
+}
@@ -0,0 +1,71 @@
+/*
+ * Master of Puppets — Sub-Element Selection
+ * pick_bvh.h — Bounding volume hierarchies for vertex and edge picking
+ *
+ * One tree over a mesh's local-space vertices, another over the edges of
+ * its triangles.  Both are built the first time a pick needs them and kept
+ * on the mesh (MopMesh.pick_vertices / .pick_edges) until its geometry
+ * changes.  They do not depend on the camera: a pick walks the tree with
+ * the screen-space bounds of each node, so orbiting costs nothing and a
+ * hover only visits the nodes that project near the cursor.
+ *
+ * Nodes are stored depth first: an inner node's left child follows it,
+ * its right child is at MopPickNode.first.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef MOP_CORE_PICK_BVH_H
+#define MOP_CORE_PICK_BVH_H
+
+#include <mop/types.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+struct MopMeshTopology;
+
+typedef struct MopPickNode {
+  float min[3];
+  float max[3];
+  uint32_t first; /* leaf: first item; inner: right child */
+  uint32_t count; /* leaf: item count; 0 for inner nodes */
+} MopPickNode;
+
+typedef struct MopPickBvh {
+  MopPickNode *nodes; /* nodes[0] is the root */
+  uint32_t node_count;
+  uint32_t *items; /* vertex ids, or half-edges (3 * face + corner) */
+  uint32_t item_count;
+} MopPickBvh;
+
+/* Items per leaf */
+#define MOP_PICK_LEAF_SIZE 8
+
+/* Build over vertex positions.  Returns NULL on allocation failure or an
+ * empty mesh. */
+MopPickBvh *mop_pick_bvh_build_vertices(const MopVertex *vertices,
+                                        uint32_t vertex_count);
+
+/* Build over the edges of a triangle index buffer, one item per
+ * non-degenerate half-edge.  With the mesh's topology (optional, must
+ * match the indices) an edge shared by two faces is listed once instead
+ * of twice.  Indices past vertex_count are skipped.  Returns NULL on
+ * allocation failure or when there is no edge. */
+MopPickBvh *mop_pick_bvh_build_edges(const MopVertex *vertices,
+                                     uint32_t vertex_count,
+                                     const uint32_t *indices,
+                                     uint32_t index_count,
+                                     const struct MopMeshTopology *topology);
+
+void mop_pick_bvh_free(MopPickBvh *bvh);
+
+/* Endpoints of half-edge item he */
+static inline void mop_pick_edge_ends(const uint32_t *indices, uint32_t he,
+                                      uint32_t *a, uint32_t *b) {
+  uint32_t base = he - he % 3;
+  *a = indices[he];
+  *b = indices[base + (he - base + 1) % 3];
+}
+
+#endif /* MOP_CORE_PICK_BVH_H */
@@ -0,0 +1,765 @@
+/*
+ * Master of Puppets — Backend-Agnostic Viewport Rendering Engine
+ * simplify.c — Quadric error metric simplification and automatic LODs
+ *
+ * Vertices are first welded twice: exact duplicates (all attributes
+ * equal) collapse to one index, and vertices with equal positions form a
+ * "class".  A class with more than one distinct vertex sits on an
+ * attribute seam and is locked.  Quadrics live per class.
+ *
+ * Simplification runs in passes.  Each pass rebuilds vertex->triangle
+ * adjacency and the edge table, scores every half-edge collapse, sorts
+ * by cost and applies the cheapest ones that do not touch a class
+ * already modified in the same pass.  Each applied collapse is checked
+ * for triangle flips and for the link condition, so the result stays
+ * manifold wherever the input was.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "core/thread_pool.h"
+#include "core/viewport_internal.h"
+
+#include <float.h>
+#include <math.h>
+#include <mop/core/simplify.h>
+#include <mop/util/log.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SIMPLIFY_FLIP_COS 0.5f      /* min cos between old/new face normal */
+#define SIMPLIFY_BORDER_WEIGHT 10.0 /* border plane weight vs. face planes */
+
+enum {
+  KIND_MANIFOLD = 0,
+  KIND_BORDER = 1, /* on an open boundary: may only slide along it */
+  KIND_LOCKED = 2, /* seam, non-manifold edge or locked border */
+};
+
+/* -------------------------------------------------------------------------
+ * Quadrics
+ * ------------------------------------------------------------------------- */
+
+typedef struct Quadric {
+  double a00, a01, a02, a11, a12, a22; /* symmetric 3x3 */
+  double b0, b1, b2;
+  double c;
+  double w; /* accumulated weight (area) */
+} Quadric;
+
+static void quadric_add_plane(Quadric *q, const double n[3], double d,
+                              double w) {
+  q->a00 += w * n[0] * n[0];
+  q->a01 += w * n[0] * n[1];
+  q->a02 += w * n[0] * n[2];
+  q->a11 += w * n[1] * n[1];
+  q->a12 += w * n[1] * n[2];
+  q->a22 += w * n[2] * n[2];
+  q->b0 += w * d * n[0];
+  q->b1 += w * d * n[1];
+  q->b2 += w * d * n[2];
+  q->c += w * d * d;
+  q->w += w;
+}
+
+static void quadric_accumulate(Quadric *dst, const Quadric *src) {
+  dst->a00 += src->a00;
+  dst->a01 += src->a01;
+  dst->a02 += src->a02;
+  dst->a11 += src->a11;
+  dst->a12 += src->a12;
+  dst->a22 += src->a22;
+  dst->b0 += src->b0;
+  dst->b1 += src->b1;
+  dst->b2 += src->b2;
+  dst->c += src->c;
+  dst->w += src->w;
+}
+
+/* Mean squared distance from p to the accumulated planes */
+static double quadric_error(const Quadric *q, const double p[3]) {
+  double x = p[0], y = p[1], z = p[2];
+  double e = q->a00 * x * x + q->a11 * y * y + q->a22 * z * z +
+             2.0 * (q->a01 * x * y + q->a02 * x * z + q->a12 * y * z) +
+             2.0 * (q->b0 * x + q->b1 * y + q->b2 * z) + q->c;
+  e = e < 0.0 ? 0.0 : e;
+  return q->w > 0.0 ? e / q->w : e;
+}
+
+/* -------------------------------------------------------------------------
+ * Hashing helpers
+ * ------------------------------------------------------------------------- */
+
+static uint32_t hash_bytes(const void *data, size_t size) {
+  const uint8_t *p = (const uint8_t *)data;
+  uint32_t h = 2166136261u;
+  for (size_t i = 0; i < size; i++) {
+    h ^= p[i];
+    h *= 16777619u;
+  }
+  return h;
+}
+
+static uint32_t table_size_for(uint32_t count) {
+  uint32_t size = 16;
+  while (size < count * 2)
+    size *= 2;
+  return size;
+}
+
+/* Normalizes -0.0 so equal positions hash equally */
+static MopVec3 canonical_position(MopVec3 p) {
+  return (MopVec3){p.x + 0.0f, p.y + 0.0f, p.z + 0.0f};
+}
+
+/* Edge table: undirected class pair -> number of incident triangles */
+typedef struct EdgeSlot {
+  uint64_t key; /* (lo << 32 | hi) + 1, 0 = empty */
+  uint32_t count;
+} EdgeSlot;
+
+static uint64_t edge_key(uint32_t a, uint32_t b) {
+  uint32_t lo = a < b ? a : b, hi = a < b ? b : a;
+  return ((uint64_t)lo << 32 | hi) + 1;
+}
+
+static EdgeSlot *edge_slot(EdgeSlot *table, uint32_t mask, uint64_t key) {
+  uint32_t i = (uint32_t)((key * 0x9E3779B97F4A7C15ULL) >> 32) & mask;
+  while (table[i].key && table[i].key != key)
+    i = (i + 1) & mask;
+  return &table[i];
+}
+
+/* -------------------------------------------------------------------------
+ * Simplifier state
+ * ------------------------------------------------------------------------- */
+
+typedef struct Collapse {
+  uint32_t from, to; /* vertex indices (canonical) */
+  float cost;        /* positional + attribute cost (sort key) */
+  float error;       /* positional error, squared, normalized */
+} Collapse;
+
+typedef struct Simplifier {
+  const MopVertex *verts;
+  uint32_t vertex_count;
+  double (*pos)[3];   /* normalized positions */
+  uint32_t *cls;      /* vertex -> position class (representative) */
+  uint32_t *next;     /* circular list of vertices in the same class */
+  uint8_t *seam;      /* per class: distinct attribute sets share it */
+  uint8_t *kind;      /* per class, rebuilt every pass */
+  Quadric *quadrics;  /* per class */
+  uint32_t *tris;     /* working index buffer */
+  uint32_t tri_count; /* triangles in tris (live + dead) */
+  uint8_t *dead;      /* per triangle: degenerate after a collapse */
+  uint32_t *adj_off;  /* vertex -> [adj_off[v], adj_off[v+1]) */
+  uint32_t *adj;      /* triangle ids */
+  uint32_t *stamp;    /* per class scratch for the link test */
+  uint32_t stamp_id;
+  EdgeSlot *edges;
+  uint32_t edge_mask;
+  float attribute_weight;
+} Simplifier;
+
+static void vec_sub(double out[3], const double a[3], const double b[3]) {
+  out[0] = a[0] - b[0];
+  out[1] = a[1] - b[1];
+  out[2] = a[2] - b[2];
+}
+
+static void vec_cross(double out[3], const double a[3], const double b[3]) {
+  out[0] = a[1] * b[2] - a[2] * b[1];
+  out[1] = a[2] * b[0] - a[0] * b[2];
+  out[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+static double vec_dot(const double a[3], const double b[3]) {
+  return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+/* Squared distance between the shading attributes of two vertices */
+static float attribute_distance(const MopVertex *a, const MopVertex *b) {
+  float d[9] = {a->normal.x - b->normal.x, a->normal.y - b->normal.y,
+                a->normal.z - b->normal.z, a->u - b->u,
+                a->v - b->v,               a->color.r - b->color.r,
+                a->color.g - b->color.g,   a->color.b - b->color.b,
+                a->color.a - b->color.a};
+  float s = 0.0f;
+  for (int i = 0; i < 9; i++)
+    s += d[i] * d[i];
+  return s;
+}
+
+/* Weld exact duplicates into `canon` and positions into classes.
+ * Returns false on OOM. */
+static bool simplify_weld(Simplifier *s, uint32_t *canon) {
+  uint32_t n = s->vertex_count;
+  uint32_t size = table_size_for(n), mask = size - 1;
+  uint32_t *table = malloc(size * sizeof(uint32_t));
+  if (!table)
+    return false;
+
+  memset(table, 0xFF, size * sizeof(uint32_t));
+  for (uint32_t v = 0; v < n; v++) {
+    uint32_t i = hash_bytes(&s->verts[v], sizeof(MopVertex)) & mask;
+    while (table[i] != UINT32_MAX &&
+           memcmp(&s->verts[table[i]], &s->verts[v], sizeof(MopVertex)) != 0)
+      i = (i + 1) & mask;
+    if (table[i] == UINT32_MAX)
+      table[i] = v;
+    canon[v] = table[i];
+  }
+
+  memset(table, 0xFF, size * sizeof(uint32_t));
+  for (uint32_t v = 0; v < n; v++) {
+    s->next[v] = v;
+    if (canon[v] != v) {
+      s->cls[v] = UINT32_MAX;
+      continue;
+    }
+    MopVec3 p = canonical_position(s->verts[v].position);
+    uint32_t i = hash_bytes(&p, sizeof(p)) & mask;
+    while (table[i] != UINT32_MAX) {
+      MopVec3 q = canonical_position(s->verts[table[i]].position);
+      if (memcmp(&p, &q, sizeof(p)) == 0)
+        break;
+      i = (i + 1) & mask;
+    }
+    if (table[i] == UINT32_MAX) {
+      table[i] = v;
+      s->cls[v] = v;
+    } else {
+      /* Second distinct vertex at this position: splice into the ring */
+      uint32_t rep = table[i];
+      s->cls[v] = rep;
+      s->next[v] = s->next[rep];
+      s->next[rep] = v;
+      s->seam[rep] = 1;
+    }
+  }
+  free(table);
+  return true;
+}
+
+/* Rebuild adjacency, edge counts and vertex kinds for the live triangles.
+ * `lock_border` turns border classes into locked ones. */
+static bool simplify_prepare_pass(Simplifier *s, bool lock_border) {
+  uint32_t n = s->vertex_count;
+  memset(s->adj_off, 0, (n + 1) * sizeof(uint32_t));
+  for (uint32_t t = 0; t < s->tri_count; t++)
+    for (int k = 0; k < 3; k++)
+      s->adj_off[s->tris[t * 3 + k] + 1]++;
+  for (uint32_t v = 0; v < n; v++)
+    s->adj_off[v + 1] += s->adj_off[v];
+  uint32_t *fill = malloc(n * sizeof(uint32_t));
+  if (!fill)
+    return false;
+  memcpy(fill, s->adj_off, n * sizeof(uint32_t));
+  for (uint32_t t = 0; t < s->tri_count; t++)
+    for (int k = 0; k < 3; k++)
+      s->adj[fill[s->tris[t * 3 + k]]++] = t;
+  free(fill);
+
+  memset(s->edges, 0, (s->edge_mask + 1) * sizeof(EdgeSlot));
+  for (uint32_t t = 0; t < s->tri_count; t++) {
+    const uint32_t *tri = s->tris + t * 3;
+    for (int k = 0; k < 3; k++) {
+      uint64_t key = edge_key(s->cls[tri[k]], s->cls[tri[(k + 1) % 3]]);
+      EdgeSlot *e = edge_slot(s->edges, s->edge_mask, key);
+      e->key = key;
+      e->count++;
+    }
+  }
+
+  for (uint32_t v = 0; v < n; v++)
+    s->kind[v] = s->seam[v] ? KIND_LOCKED : KIND_MANIFOLD;
+  for (uint32_t t = 0; t < s->tri_count; t++) {
+    const uint32_t *tri = s->tris + t * 3;
+    for (int k = 0; k < 3; k++) {
+      uint32_t ca = s->cls[tri[k]], cb = s->cls[tri[(k + 1) % 3]];
+      uint32_t count =
+          edge_slot(s->edges, s->edge_mask, edge_key(ca, cb))->count;
+      if (count == 2)
+        continue;
+      uint8_t kind = count == 1 && !lock_border ? KIND_BORDER : KIND_LOCKED;
+      if (s->kind[ca] < kind)
+        s->kind[ca] = kind;
+      if (s->kind[cb] < kind)
+        s->kind[cb] = kind;
+    }
+  }
+  return true;
+}
+
+static void simplify_init_quadrics(Simplifier *s) {
+  for (uint32_t t = 0; t < s->tri_count; t++) {
+    const uint32_t *tri = s->tris + t * 3;
+    double e1[3], e2[3], n[3];
+    vec_sub(e1, s->pos[tri[1]], s->pos[tri[0]]);
+    vec_sub(e2, s->pos[tri[2]], s->pos[tri[0]]);
+    vec_cross(n, e1, e2);
+    double len = sqrt(vec_dot(n, n));
+    if (len < 1e-20)
+      continue;
+    for (int k = 0; k < 3; k++)
+      n[k] /= len;
+    double d = -vec_dot(n, s->pos[tri[0]]);
+    double area = 0.5 * len;
+    for (int k = 0; k < 3; k++)
+      quadric_add_plane(&s->quadrics[s->cls[tri[k]]], n, d, area);
+
+    /* Border edges get a perpendicular plane so open boundaries keep
+     * their outline when they are allowed to move. */
+    for (int k = 0; k < 3; k++) {
+      uint32_t a = tri[k], b = tri[(k + 1) % 3];
+      uint64_t key = edge_key(s->cls[a], s->cls[b]);
+      if (edge_slot(s->edges, s->edge_mask, key)->count != 1)
+        continue;
+      double edge[3], bn[3];
+      vec_sub(edge, s->pos[b], s->pos[a]);
+      vec_cross(bn, edge, n);
+      double blen = sqrt(vec_dot(bn, bn));
+      if (blen < 1e-20)
+        continue;
+      for (int j = 0; j < 3; j++)
+        bn[j] /= blen;
+      double bd = -vec_dot(bn, s->pos[a]);
+      double w = vec_dot(edge, edge) * SIMPLIFY_BORDER_WEIGHT;
+      quadric_add_plane(&s->quadrics[s->cls[a]], bn, bd, w);
+      quadric_add_plane(&s->quadrics[s->cls[b]], bn, bd, w);
+    }
+  }
+}
+
+/* Would moving `from` onto `to` flip or collapse a surviving triangle? */
+static bool collapse_flips(const Simplifier *s, uint32_t from, uint32_t to) {
+  uint32_t cto = s->cls[to];
+  for (uint32_t i = s->adj_off[from]; i < s->adj_off[from + 1]; i++) {
+    uint32_t t = s->adj[i];
+    if (s->dead[t])
+      continue;
+    const uint32_t *tri = s->tris + t * 3;
+    int k = tri[0] == from ? 0 : (tri[1] == from ? 1 : 2);
+    uint32_t v1 = tri[(k + 1) % 3], v2 = tri[(k + 2) % 3];
+    if (s->cls[v1] == cto || s->cls[v2] == cto)
+      continue; /* becomes degenerate and is removed */
+
+    double e1[3], e2[3], n0[3], n1[3];
+    vec_sub(e1, s->pos[v1], s->pos[from]);
+    vec_sub(e2, s->pos[v2], s->pos[from]);
+    vec_cross(n0, e1, e2);
+    vec_sub(e1, s->pos[v1], s->pos[to]);
+    vec_sub(e2, s->pos[v2], s->pos[to]);
+    vec_cross(n1, e1, e2);
+    double dot = vec_dot(n0, n1);
+    double lim = SIMPLIFY_FLIP_COS * sqrt(vec_dot(n0, n0) * vec_dot(n1, n1));
+    if (dot <= lim)
+      return true;
+  }
+  return false;
+}
+
+/* Link condition: the classes adjacent to both endpoints must be exactly
+ * the apexes of the triangles on the collapsed edge. */
+static bool collapse_keeps_manifold(Simplifier *s, uint32_t from,
+                                    uint32_t to) {
+  uint32_t cfrom = s->cls[from], cto = s->cls[to];
+  uint32_t mark = ++s->stamp_id;
+  uint32_t shared = 0;
+  for (uint32_t i = s->adj_off[from]; i < s->adj_off[from + 1]; i++) {
+    uint32_t t = s->adj[i];
+    if (s->dead[t])
+      continue;
+    const uint32_t *tri = s->tris + t * 3;
+    bool has_to = false;
+    for (int k = 0; k < 3; k++)
+      has_to |= s->cls[tri[k]] == cto;
+    shared += has_to;
+    for (int k = 0; k < 3; k++)
+      s->stamp[s->cls[tri[k]]] = mark;
+  }
+
+  uint32_t counted = ++s->stamp_id;
+  uint32_t common = 0;
+  uint32_t v = cto;
+  do {
+    for (uint32_t i = s->adj_off[v]; i < s->adj_off[v + 1]; i++) {
+      uint32_t t = s->adj[i];
+      if (s->dead[t])
+        continue;
+      for (int k = 0; k < 3; k++) {
+        uint32_t c = s->cls[s->tris[t * 3 + k]];
+        if (c == cfrom || c == cto || s->stamp[c] != mark)
+          continue;
+        s->stamp[c] = counted;
+        common++;
+      }
+    }
+    v = s->next[v];
+  } while (v != cto);
+  return common == shared;
+}
+
+static int collapse_cmp(const void *a, const void *b) {
+  float ca = ((const Collapse *)a)->cost, cb = ((const Collapse *)b)->cost;
+  return (ca > cb) - (ca < cb);
+}
+
+/* Score every valid half-edge collapse of the live triangles. */
+static uint32_t simplify_collect(const Simplifier *s, Collapse *out) {
+  uint32_t count = 0;
+  for (uint32_t t = 0; t < s->tri_count; t++) {
+    const uint32_t *tri = s->tris + t * 3;
+    for (int k = 0; k < 6; k++) {
+      uint32_t from = tri[k % 3];
+      uint32_t to = tri[(k % 3 + (k < 3 ? 1 : 2)) % 3];
+      uint32_t cfrom = s->cls[from], cto = s->cls[to];
+      if (s->kind[cfrom] == KIND_LOCKED)
+        continue;
+      if (s->kind[cfrom] == KIND_BORDER &&
+          edge_slot(s->edges, s->edge_mask, edge_key(cfrom, cto))->count != 1)
+        continue;
+      double err = quadric_error(&s->quadrics[cfrom], s->pos[to]);
+      float attr = s->attribute_weight *
+                   attribute_distance(&s->verts[from], &s->verts[to]);
+      out[count++] = (Collapse){.from = from,
+                                .to = to,
+                                .cost = (float)err + attr,
+                                .error = (float)err};
+    }
+  }
+  return count;
+}
+
+/* One pass: apply the cheapest independent collapses.  Returns the number
+ * of triangles removed. */
+static uint32_t simplify_pass(Simplifier *s, Collapse *cand, uint32_t *live,
+                              uint32_t target_tris, float error_limit,
+                              float *max_error) {
+  uint32_t count = simplify_collect(s, cand);
+  qsort(cand, count, sizeof(Collapse), collapse_cmp);
+
+  uint32_t removed = 0;
+  memset(s->dead, 0, s->tri_count);
+  uint8_t *touched = calloc(s->vertex_count, 1);
+  if (!touched)
+    return 0;
+
+  for (uint32_t i = 0; i < count && *live > target_tris; i++) {
+    const Collapse *c = &cand[i];
+    uint32_t cfrom = s->cls[c->from], cto = s->cls[c->to];
+    if (c->error > error_limit)
+      continue;
+    if (touched[cfrom] || touched[cto])
+      continue;
+    if (collapse_flips(s, c->from, c->to) ||
+        !collapse_keeps_manifold(s, c->from, c->to))
+      continue;
+
+    for (uint32_t j = s->adj_off[c->from]; j < s->adj_off[c->from + 1];
+         j++) {
+      uint32_t t = s->adj[j];
+      if (s->dead[t])
+        continue;
+      uint32_t *tri = s->tris + t * 3;
+      for (int k = 0; k < 3; k++)
+        if (tri[k] == c->from)
+          tri[k] = c->to;
+      uint32_t a = s->cls[tri[0]], b = s->cls[tri[1]], d = s->cls[tri[2]];
+      if (a == b || b == d || a == d) {
+        s->dead[t] = 1;
+        (*live)--;
+        removed++;
+      }
+    }
+    quadric_accumulate(&s->quadrics[cto], &s->quadrics[cfrom]);
+    touched[cfrom] = touched[cto] = 1;
+    if (c->error > *max_error)
+      *max_error = c->error;
+  }
+  free(touched);
+
+  /* Compact the live triangles */
+  uint32_t w = 0;
+  for (uint32_t t = 0; t < s->tri_count; t++) {
+    if (s->dead[t])
+      continue;
+    memmove(s->tris + w * 3, s->tris + t * 3, 3 * sizeof(uint32_t));
+    w++;
+  }
+  s->tri_count = w;
+  return removed;
+}
+
+static void simplifier_free(Simplifier *s) {
+  free(s->pos);
+  free(s->cls);
+  free(s->next);
+  free(s->seam);
+  free(s->kind);
+  free(s->quadrics);
+  free(s->tris);
+  free(s->dead);
+  free(s->adj_off);
+  free(s->adj);
+  free(s->stamp);
+  free(s->edges);
+}
+
+uint32_t mop_mesh_simplify(const MopVertex *vertices, uint32_t vertex_count,
+                           const uint32_t *indices, uint32_t index_count,
+                           const MopSimplifyDesc *desc, uint32_t *out_indices,
+                           float *out_error) {
+  if (out_error)
+    *out_error = 0.0f;
+  if (!vertices || !indices || !desc || !out_indices || vertex_count == 0 ||
+      index_count % 3 != 0) {
+    MOP_WARN("mop_mesh_simplify: invalid input");
+    return 0;
+  }
+  for (uint32_t i = 0; i < index_count; i++) {
+    if (indices[i] >= vertex_count) {
+      MOP_WARN("mop_mesh_simplify: index %u out of range", indices[i]);
+      return 0;
+    }
+  }
+
+  uint32_t n = vertex_count;
+  uint32_t tri_count = index_count / 3;
+  Simplifier s = {.verts = vertices,
+                  .vertex_count = n,
+                  .attribute_weight = desc->attribute_weight};
+  s.pos = malloc(n * sizeof(*s.pos));
+  s.cls = malloc(n * sizeof(uint32_t));
+  s.next = malloc(n * sizeof(uint32_t));
+  s.seam = calloc(n, 1);
+  s.kind = calloc(n, 1);
+  s.quadrics = calloc(n, sizeof(Quadric));
+  s.tris = malloc((size_t)index_count * sizeof(uint32_t));
+  s.dead = calloc(tri_count ? tri_count : 1, 1);
+  s.adj_off = malloc((n + 1) * sizeof(uint32_t));
+  s.adj = malloc((size_t)index_count * sizeof(uint32_t) + 1);
+  s.stamp = calloc(n, sizeof(uint32_t));
+  uint32_t edge_size = table_size_for(index_count);
+  s.edges = malloc(edge_size * sizeof(EdgeSlot));
+  s.edge_mask = edge_size - 1;
+  uint32_t *canon = malloc(n * sizeof(uint32_t));
+  Collapse *cand = malloc(((size_t)tri_count * 6 + 1) * sizeof(Collapse));
+  if (!s.pos || !s.cls || !s.next || !s.seam || !s.kind || !s.quadrics ||
+      !s.tris || !s.dead || !s.adj_off || !s.adj || !s.stamp || !s.edges ||
+      !canon || !cand || !simplify_weld(&s, canon)) {
+    MOP_WARN("mop_mesh_simplify: out of memory");
+    simplifier_free(&s);
+    free(canon);
+    free(cand);
+    return 0;
+  }
+
+  /* Normalize positions so errors are relative to the largest extent */
+  float lo[3] = {FLT_MAX, FLT_MAX, FLT_MAX};
+  float hi[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+  for (uint32_t i = 0; i < index_count; i++) {
+    const float *p = &vertices[indices[i]].position.x;
+    for (int k = 0; k < 3; k++) {
+      lo[k] = p[k] < lo[k] ? p[k] : lo[k];
+      hi[k] = p[k] > hi[k] ? p[k] : hi[k];
+    }
+  }
+  float extent = 0.0f;
+  for (int k = 0; k < 3; k++)
+    extent = hi[k] - lo[k] > extent ? hi[k] - lo[k] : extent;
+  double scale = extent > 0.0f ? 1.0 / extent : 1.0;
+  for (uint32_t v = 0; v < n; v++) {
+    const float *p = &vertices[v].position.x;
+    for (int k = 0; k < 3; k++)
+      s.pos[v][k] = (p[k] - lo[k]) * scale;
+  }
+
+  /* Working triangles on welded indices, dropping degenerate input */
+  uint32_t live = 0;
+  for (uint32_t t = 0; t < tri_count; t++) {
+    uint32_t a = canon[indices[t * 3 + 0]];
+    uint32_t b = canon[indices[t * 3 + 1]];
+    uint32_t c = canon[indices[t * 3 + 2]];
+    if (s.cls[a] == s.cls[b] || s.cls[b] == s.cls[c] || s.cls[a] == s.cls[c])
+      continue;
+    s.tris[live * 3 + 0] = a;
+    s.tris[live * 3 + 1] = b;
+    s.tris[live * 3 + 2] = c;
+    live++;
+  }
+  s.tri_count = live;
+
+  uint32_t target_tris = desc->target_index_count / 3;
+  float error_limit = desc->target_error > 0.0f
+                          ? desc->target_error * desc->target_error
+                          : FLT_MAX;
+  float max_error = 0.0f;
+  bool ok = simplify_prepare_pass(&s, desc->lock_border);
+  if (ok)
+    simplify_init_quadrics(&s);
+  while (ok && live > target_tris) {
+    if (simplify_pass(&s, cand, &live, target_tris, error_limit,
+                      &max_error) == 0)
+      break;
+    ok = simplify_prepare_pass(&s, desc->lock_border);
+  }
+
+  memcpy(out_indices, s.tris, (size_t)s.tri_count * 3 * sizeof(uint32_t));
+  uint32_t result = s.tri_count * 3;
+  if (out_error)
+    *out_error = sqrtf(max_error);
+
+  simplifier_free(&s);
+  free(canon);
+  free(cand);
+  return result;
+}
+
+/* -------------------------------------------------------------------------
+ * Automatic LOD chain
+ *
+ * Each level is simplified from the base mesh on its own worker task.
+ * A level is used while its error projects to under one pixel: with the
+ * error e given as a fraction of the mesh extent, that holds while the
+ * projected diameter stays below 1 / e pixels.
+ * ------------------------------------------------------------------------- */
+
+#define LOD_PIXEL_ERROR 1.0f /* screen-space error budget, pixels */
+#define LOD_MIN_REDUCTION 0.95f /* drop levels that shrink less than 5% */
+
+typedef struct LodJob {
+  const MopVertex *vertices;
+  uint32_t vertex_count;
+  const uint32_t *indices;
+  uint32_t index_count;
+  uint32_t target_index_count;
+  uint32_t *out_indices; /* index_count capacity */
+  uint32_t out_count;
+  float error;
+} LodJob;
+
+static void lod_job_run(void *arg) {
+  LodJob *job = (LodJob *)arg;
+  MopSimplifyDesc desc = {.target_index_count = job->target_index_count,
+                          .attribute_weight = 0.05f};
+  job->out_count = mop_mesh_simplify(job->vertices, job->vertex_count,
+                                     job->indices, job->index_count, &desc,
+                                     job->out_indices, &job->error);
+}
+
+/* Compact the vertices a level references and add it to the mesh. */
+static bool lod_add_compacted(MopMesh *mesh, MopViewport *vp,
+                              const MopVertex *vertices,
+                              uint32_t vertex_count, const LodJob *job,
+                              float threshold) {
+  uint32_t *map = malloc(vertex_count * sizeof(uint32_t));
+  MopVertex *verts = malloc(vertex_count * sizeof(MopVertex));
+  uint32_t *idx = malloc((size_t)job->out_count * sizeof(uint32_t));
+  bool ok = map && verts && idx;
+  if (ok) {
+    memset(map, 0xFF, vertex_count * sizeof(uint32_t));
+    uint32_t used = 0;
+    for (uint32_t i = 0; i < job->out_count; i++) {
+      uint32_t v = job->out_indices[i];
+      if (map[v] == UINT32_MAX) {
+        map[v] = used;
+        verts[used++] = vertices[v];
+      }
+      idx[i] = map[v];
+    }
+    MopMeshDesc d = {.vertices = verts,
+                     .vertex_count = used,
+                     .indices = idx,
+                     .index_count = job->out_count,
+                     .object_id = mesh->object_id};
+    ok = mop_mesh_add_lod(mesh, vp, &d, threshold) > 0;
+  }
+  free(map);
+  free(verts);
+  free(idx);
+  return ok;
+}
+
+int32_t mop_mesh_generate_lods(MopMesh *mesh, uint32_t levels, float ratio) {
+  if (!mesh || !mesh->viewport || levels == 0 || !(ratio > 0.0f) ||
+      ratio >= 1.0f)
+    return -1;
+  if (mesh->vertex_format) {
+    MOP_WARN("mop_mesh_generate_lods: flexible vertex formats unsupported");
+    return -1;
+  }
+  if (levels > MOP_MAX_LOD_LEVELS - 1)
+    levels = MOP_MAX_LOD_LEVELS - 1;
+
+  MopViewport *vp = mesh->viewport;
+  MOP_VP_LOCK(vp);
+  const MopVertex *vertices =
+      (const MopVertex *)vp->rhi->buffer_read(mesh->vertex_buffer);
+  const uint32_t *indices =
+      (const uint32_t *)vp->rhi->buffer_read(mesh->index_buffer);
+  if (!vertices || !indices) {
+    MOP_VP_UNLOCK(vp);
+    return -1;
+  }
+
+  LodJob jobs[MOP_MAX_LOD_LEVELS - 1];
+  memset(jobs, 0, sizeof(jobs));
+  bool oom = false;
+  double target = (double)mesh->index_count;
+  for (uint32_t i = 0; i < levels; i++) {
+    target *= ratio;
+    jobs[i] = (LodJob){.vertices = vertices,
+                       .vertex_count = mesh->vertex_count,
+                       .indices = indices,
+                       .index_count = mesh->index_count,
+                       .target_index_count = (uint32_t)target / 3 * 3};
+    jobs[i].out_indices = malloc((size_t)mesh->index_count * sizeof(uint32_t));
+    oom |= !jobs[i].out_indices;
+  }
+
+  int32_t added = -1;
+  if (!oom) {
+    for (uint32_t i = 0; i < levels; i++)
+      if (!vp->thread_pool ||
+          !mop_threadpool_submit(vp->thread_pool, lod_job_run, &jobs[i]))
+        lod_job_run(&jobs[i]);
+    if (vp->thread_pool)
+      mop_threadpool_wait(vp->thread_pool);
+
+    /* Replace any previous chain */
+    for (uint32_t li = 0; li < mesh->lod_level_count; li++) {
+      struct MopLodLevel *lod = &mesh->lod_levels[li];
+      if (lod->vertex_buffer)
+        vp->rhi->buffer_destroy(vp->device, lod->vertex_buffer);
+      if (lod->index_buffer)
+        vp->rhi->buffer_destroy(vp->device, lod->index_buffer);
+    }
+    mesh->lod_level_count = 0;
+    mesh->active_lod = 0;
+
+    added = 0;
+    uint32_t prev_count = mesh->index_count;
+    float prev_threshold = FLT_MAX;
+    for (uint32_t i = 0; i < levels; i++) {
+      const LodJob *job = &jobs[i];
+      if (job->out_count == 0 ||
+          (float)job->out_count > (float)prev_count * LOD_MIN_REDUCTION)
+        continue;
+      float threshold =
+          job->error > 0.0f ? LOD_PIXEL_ERROR / job->error : FLT_MAX;
+      if (threshold >= prev_threshold)
+        threshold = prev_threshold * LOD_MIN_REDUCTION;
+      if (!lod_add_compacted(mesh, vp, vertices, mesh->vertex_count, job,
+                             threshold))
+        break;
+      prev_count = job->out_count;
+      prev_threshold = threshold;
+      added++;
+    }
+  }
+  for (uint32_t i = 0; i < levels; i++)
+    free(jobs[i].out_indices);
+  MOP_VP_UNLOCK(vp);
+  return added;
+}
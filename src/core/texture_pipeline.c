@@ -5,10 +5,15 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include "core/texture_store.h"
+#include "core/thread_pool.h"
 #include "core/viewport_internal.h"
+#include "math/math_simd.h"
 
+#include <math.h>
 #include <mop/core/texture_pipeline.h>
 #include <mop/util/log.h>
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -29,119 +34,603 @@ static uint64_t fnv1a_hash(const uint8_t *data, size_t len) {
 }
 
 /* -------------------------------------------------------------------------
- * Box-filter mipmap generation (RGBA8)
+ * Mip chain generation (RGBA8)
  *
- * Generates the full mip chain from mip 0 data.  Returns a newly allocated
- * buffer containing all mip levels packed sequentially, or NULL on failure.
- * out_total_size receives the total size of the returned buffer.
- * out_levels receives the number of mip levels (including mip 0).
+ * Every level is filtered from the previous one, kept in float and never
+ * re-quantized, with a separable kernel evaluated in destination-texel
+ * units.  Odd sizes and non-square chains therefore use the same code.
+ * Each destination row is produced on its own: vertical taps accumulate
+ * into a source-width scratch row, then horizontal taps resolve it.  Rows
+ * are split into bands that run in parallel, each with its own scratch
+ * from one allocation made before the chain is filtered, so there is no
+ * full-size intermediate.  Inner loops work on whole RGBA texels with the
+ * shared v4 lanes of math_simd.h.
+ *
+ * sRGB color is filtered in linear space, normal maps are filtered as
+ * vectors and renormalized on output, and alpha can be rescaled per
+ * level so an alpha test keeps the same coverage as mip 0.
  * ------------------------------------------------------------------------- */
 
-static uint8_t *generate_mips_rgba8(const uint8_t *mip0, int w, int h,
+#define MIP_WIDE_RADIUS 3.0f /* Kaiser / Lanczos support (dest texels) */
+#define MIP_KAISER_ALPHA 4.0f
+#define MIP_SRGB_LUT_SIZE 4096
+#define MIP_COVERAGE_BINS 1024
+#define MIP_PARALLEL_MIN_TEXELS (64 * 64) /* smaller levels run inline */
+
+static float s_srgb_to_linear[256];
+static uint8_t s_linear_to_srgb[MIP_SRGB_LUT_SIZE];
+static pthread_once_t s_mip_lut_once = PTHREAD_ONCE_INIT;
+
+static void mip_lut_init(void) {
+  for (int i = 0; i < 256; i++) {
+    float c = (float)i / 255.0f;
+    s_srgb_to_linear[i] =
+        c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+  }
+  for (int i = 0; i < MIP_SRGB_LUT_SIZE; i++) {
+    float l = (float)i / (float)(MIP_SRGB_LUT_SIZE - 1);
+    float c = l <= 0.0031308f ? l * 12.92f
+                              : 1.055f * powf(l, 1.0f / 2.4f) - 0.055f;
+    s_linear_to_srgb[i] = (uint8_t)(c * 255.0f + 0.5f);
+  }
+}
+
+static float mip_sinc(float x) {
+  if (fabsf(x) < 1e-5f)
+    return 1.0f;
+  x *= 3.14159265358979f;
+  return sinf(x) / x;
+}
+
+/* Modified Bessel function of the first kind, order 0 (power series) */
+static float mip_bessel_i0(float x) {
+  float sum = 1.0f, term = 1.0f, q = x * x * 0.25f;
+  for (int k = 1; k < 32 && term > sum * 1e-8f; k++) {
+    term *= q / (float)(k * k);
+    sum += term;
+  }
+  return sum;
+}
+
+static float mip_filter_radius(MopMipFilter f) {
+  return f == MOP_MIP_FILTER_BOX ? 0.5f : MIP_WIDE_RADIUS;
+}
+
+/* Kernel value at distance t, in destination texels */
+static float mip_filter_eval(MopMipFilter f, float t) {
+  t = fabsf(t);
+  switch (f) {
+  case MOP_MIP_FILTER_KAISER: {
+    if (t >= MIP_WIDE_RADIUS)
+      return 0.0f;
+    float r = t / MIP_WIDE_RADIUS;
+    return mip_sinc(t) * mip_bessel_i0(MIP_KAISER_ALPHA * sqrtf(1.0f - r * r)) /
+           mip_bessel_i0(MIP_KAISER_ALPHA);
+  }
+  case MOP_MIP_FILTER_LANCZOS:
+    if (t >= MIP_WIDE_RADIUS)
+      return 0.0f;
+    return mip_sinc(t) * mip_sinc(t / MIP_WIDE_RADIUS);
+  default:
+    return t < 0.5f ? 1.0f : (t == 0.5f ? 0.5f : 0.0f);
+  }
+}
+
+/* Precomputed taps for one axis of one level: destination texel d reads
+ * source texels index[d * taps + k] with weight[d * taps + k].  Indices
+ * are clamped to the edge, weights sum to 1. */
+typedef struct MipAxis {
+  int taps;
+  int *index;
+  float *weight;
+} MipAxis;
+
+static bool mip_axis_build(MipAxis *ax, MopMipFilter f, int src, int dst) {
+  float scale = (float)src / (float)dst;
+  float support = mip_filter_radius(f) * scale;
+  int taps = (int)ceilf(support * 2.0f) + 1;
+  ax->taps = taps;
+  ax->index = malloc((size_t)dst * (size_t)taps * sizeof(int));
+  ax->weight = malloc((size_t)dst * (size_t)taps * sizeof(float));
+  if (!ax->index || !ax->weight) {
+    free(ax->index);
+    free(ax->weight);
+    return false;
+  }
+
+  for (int d = 0; d < dst; d++) {
+    float center = ((float)d + 0.5f) * scale;
+    int first = (int)floorf(center - support);
+    int *idx = ax->index + (size_t)d * taps;
+    float *w = ax->weight + (size_t)d * taps;
+    float sum = 0.0f;
+    for (int k = 0; k < taps; k++) {
+      int i = first + k;
+      w[k] = mip_filter_eval(f, ((float)i + 0.5f - center) / scale);
+      idx[k] = i < 0 ? 0 : (i >= src ? src - 1 : i);
+      sum += w[k];
+    }
+    float inv = sum != 0.0f ? 1.0f / sum : 0.0f;
+    for (int k = 0; k < taps; k++)
+      w[k] *= inv;
+  }
+  return true;
+}
+
+static void mip_axis_free(MipAxis *ax) {
+  free(ax->index);
+  free(ax->weight);
+}
+
+typedef struct MipFilterCtx {
+  const uint8_t *src8; /* mip 0 (first pass only), else NULL */
+  const float *srcf;   /* previous level, filter-space float RGBA */
+  int sw;              /* source width */
+  int dw;              /* destination width */
+  int dh;              /* destination height */
+  int bands;           /* row bands, one scratch slice each */
+  const MipAxis *ax, *ay;
+  const MopMipDesc *desc;
+  float *dst;     /* dw * dh * 4 floats */
+  float *scratch; /* bands slices of scratch_stride floats */
+  size_t scratch_stride;
+} MipFilterCtx;
+
+/* Decode one mip 0 row into filter space: linear for sRGB color,
+ * [-1,1] for normal maps, [0,1] otherwise. */
+static void mip_decode_row(const MopMipDesc *desc, const uint8_t *src, int w,
+                           float *out) {
+  for (int x = 0; x < w; x++) {
+    const uint8_t *p = src + (size_t)x * 4;
+    float *o = out + (size_t)x * 4;
+    if (desc->normal_map) {
+      for (int c = 0; c < 3; c++)
+        o[c] = (float)p[c] * (2.0f / 255.0f) - 1.0f;
+    } else if (desc->srgb) {
+      for (int c = 0; c < 3; c++)
+        o[c] = s_srgb_to_linear[p[c]];
+    } else {
+      for (int c = 0; c < 3; c++)
+        o[c] = (float)p[c] * (1.0f / 255.0f);
+    }
+    o[3] = (float)p[3] * (1.0f / 255.0f);
+  }
+}
+
+/* Filters destination rows [begin, end) of band `band`.  The band's
+ * scratch slice holds the accumulated row and, for mip 0, one decoded
+ * source row. */
+static void mip_filter_band(void *arg, int band) {
+  const MipFilterCtx *c = (const MipFilterCtx *)arg;
+  int sw = c->sw;
+  int begin = (int)((int64_t)c->dh * band / c->bands);
+  int end = (int)((int64_t)c->dh * (band + 1) / c->bands);
+  float *col = c->scratch + (size_t)band * c->scratch_stride;
+  float *decoded = col + (size_t)sw * 4;
+
+  for (int y = begin; y < end; y++) {
+    /* Vertical pass: weighted sum of source rows into one row */
+    memset(col, 0, (size_t)sw * 4 * sizeof(float));
+    const int *yi = c->ay->index + (size_t)y * c->ay->taps;
+    const float *yw = c->ay->weight + (size_t)y * c->ay->taps;
+    for (int k = 0; k < c->ay->taps; k++) {
+      if (yw[k] == 0.0f)
+        continue;
+      const float *row;
+      if (c->src8) {
+        mip_decode_row(c->desc, c->src8 + (size_t)yi[k] * sw * 4, sw,
+                       decoded);
+        row = decoded;
+      } else {
+        row = c->srcf + (size_t)yi[k] * sw * 4;
+      }
+      v4 w = v4_set1(yw[k]);
+      for (size_t i = 0; i < (size_t)sw * 4; i += 4)
+        v4_store(col + i,
+                 v4_add(v4_load(col + i), v4_mul(w, v4_load(row + i))));
+    }
+
+    /* Horizontal pass */
+    float *out = c->dst + (size_t)y * c->dw * 4;
+    for (int x = 0; x < c->dw; x++) {
+      const int *xi = c->ax->index + (size_t)x * c->ax->taps;
+      const float *xw = c->ax->weight + (size_t)x * c->ax->taps;
+      v4 acc = v4_set1(0.0f);
+      for (int k = 0; k < c->ax->taps; k++)
+        acc = v4_add(acc, v4_mul(v4_set1(xw[k]),
+                                 v4_load(col + (size_t)xi[k] * 4)));
+      v4_store(out + (size_t)x * 4, acc);
+    }
+  }
+}
+
+typedef struct MipQuantizeCtx {
+  const float *src; /* filter-space float RGBA */
+  uint8_t *dst;     /* RGBA8 */
+  int w;
+  const MopMipDesc *desc;
+  float alpha_scale; /* alpha-coverage correction for this level */
+} MipQuantizeCtx;
+
+static uint8_t mip_unorm8(float v) {
+  v = v < 0.0f ? 0.0f : (v > 1.0f ? 1.0f : v);
+  return (uint8_t)(v * 255.0f + 0.5f);
+}
+
+static void mip_quantize_row(void *arg, int y) {
+  const MipQuantizeCtx *c = (const MipQuantizeCtx *)arg;
+  const float *src = c->src + (size_t)y * c->w * 4;
+  uint8_t *dst = c->dst + (size_t)y * c->w * 4;
+  for (int x = 0; x < c->w; x++) {
+    const float *p = src + (size_t)x * 4;
+    uint8_t *o = dst + (size_t)x * 4;
+    if (c->desc->normal_map) {
+      float len = sqrtf(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+      float n[3] = {0.0f, 0.0f, 1.0f};
+      if (len > 1e-6f)
+        for (int ch = 0; ch < 3; ch++)
+          n[ch] = p[ch] / len;
+      for (int ch = 0; ch < 3; ch++)
+        o[ch] = mip_unorm8(n[ch] * 0.5f + 0.5f);
+    } else if (c->desc->srgb) {
+      for (int ch = 0; ch < 3; ch++) {
+        float l = p[ch] < 0.0f ? 0.0f : (p[ch] > 1.0f ? 1.0f : p[ch]);
+        o[ch] = s_linear_to_srgb[(int)(l * (MIP_SRGB_LUT_SIZE - 1) + 0.5f)];
+      }
+    } else {
+      for (int ch = 0; ch < 3; ch++)
+        o[ch] = mip_unorm8(p[ch]);
+    }
+    o[3] = mip_unorm8(p[3] * c->alpha_scale);
+  }
+}
+
+/* Alpha scale that makes a level's alpha-test coverage match `target`.
+ * Alpha is binned by rounding; scanning the bins from the top yields the
+ * coverage of every candidate threshold in one pass.  The chosen scale
+ * maps the lower edge of the best bin exactly onto the cutoff, so
+ * alpha * scale >= cutoff holds for precisely the counted texels. */
+static float mip_coverage_scale(const float *lvl, size_t n, float cutoff,
+                                float target) {
+  uint32_t hist[MIP_COVERAGE_BINS];
+  memset(hist, 0, sizeof(hist));
+  for (size_t i = 0; i < n; i++) {
+    float a = lvl[i * 4 + 3];
+    a = a < 0.0f ? 0.0f : (a > 1.0f ? 1.0f : a);
+    hist[(int)(a * (MIP_COVERAGE_BINS - 1) + 0.5f)]++;
+  }
+  /* Bin 0 (alpha ~ 0) can never pass */
+  uint64_t pass = 0;
+  int best = MIP_COVERAGE_BINS;
+  float best_err = target;
+  for (int b = MIP_COVERAGE_BINS - 1; b >= 1; b--) {
+    pass += hist[b];
+    float err = fabsf((float)pass / (float)n - target);
+    if (err < best_err) {
+      best_err = err;
+      best = b;
+    }
+  }
+  if (best == MIP_COVERAGE_BINS)
+    return 1.0f;
+  return cutoff * (float)(MIP_COVERAGE_BINS - 1) / ((float)best - 0.5f);
+}
+
+/* Generates the full mip chain from mip 0 data.  Returns a newly
+ * allocated buffer containing all mip levels packed sequentially, or NULL
+ * on failure.  out_total_size receives the total size of the returned
+ * buffer; out_levels receives the number of mip levels (including mip 0).
+ */
+static uint8_t *generate_mips_rgba8(MopThreadPool *pool, const uint8_t *mip0,
+                                    int w, int h, const MopMipDesc *desc,
                                     size_t *out_total_size, int *out_levels) {
   /* Public callers already guard this; repeat so gcc -O2's
    * -Wstringop-overflow inliner doesn't assume w/h could be <= 0. */
   if (w <= 0 || h <= 0)
     return NULL;
+  pthread_once(&s_mip_lut_once, mip_lut_init);
 
   /* Size of mip 0 — computed up front so we can use it as a lower bound on
    * the total allocation. */
   size_t mip0_size = (size_t)w * (size_t)h * 4;
 
-  /* Count mip levels */
+  /* Count mip levels and compute total size */
   int levels = 1;
+  size_t total = mip0_size;
   {
     int tw = w, th = h;
     while (tw > 1 || th > 1) {
       tw = tw > 1 ? tw / 2 : 1;
       th = th > 1 ? th / 2 : 1;
-      levels++;
-    }
-  }
-
-  /* Compute total size */
-  size_t total = 0;
-  {
-    int tw = w, th = h;
-    for (int i = 0; i < levels; i++) {
       total += (size_t)tw * (size_t)th * 4;
-      tw = tw > 1 ? tw / 2 : 1;
-      th = th > 1 ? th / 2 : 1;
+      levels++;
     }
   }
 
-  /* total must be at least mip0_size (we always walk at least one level).
-   * The explicit check makes this fact visible to gcc -O2, whose inliner
-   * can't otherwise connect the two-loop computation and would assume
-   * malloc(total) could be a zero-byte region when inlined at the
-   * caller. */
+  /* total must be at least mip0_size.  The explicit check makes this fact
+   * visible to gcc -O2, whose inliner would otherwise assume malloc(total)
+   * could be a zero-byte region when inlined at the caller. */
   if (total < mip0_size)
     return NULL;
 
   uint8_t *buf = malloc(total);
   if (!buf)
     return NULL;
-
-  /* Copy mip 0 */
   memcpy(buf, mip0, mip0_size);
 
-  /* Generate subsequent mips via 2x2 box filter */
-  uint8_t *prev = buf;
-  uint8_t *cur = buf + mip0_size;
+  /* Alpha-test coverage of mip 0 is the target for every level */
+  float cutoff = desc->alpha_cutoff;
+  float target_coverage = 0.0f;
+  if (cutoff > 0.0f) {
+    uint8_t ref = mip_unorm8(cutoff);
+    size_t pass = 0;
+    for (size_t i = 0; i < (size_t)w * h; i++)
+      pass += mip0[i * 4 + 3] >= ref;
+    target_coverage = (float)pass / (float)((size_t)w * h);
+  }
+
+  /* One scratch slice per row band, sized for the widest source (mip 0):
+   * an accumulated row plus a decoded row.  Bands are a few per worker,
+   * like mop_threadpool_parallel_rows' own chunks. */
+  int max_bands = pool ? mop_threadpool_num_threads(pool) * 4 : 1;
+  size_t scratch_stride = (size_t)w * 8;
+  float *scratch = malloc((size_t)max_bands * scratch_stride * sizeof(float));
+  if (!scratch) {
+    free(buf);
+    return NULL;
+  }
+
+  float *prev = NULL;
+  uint8_t *cur8 = buf + mip0_size;
   int pw = w, ph = h;
+  bool ok = true;
 
-  for (int level = 1; level < levels; level++) {
+  for (int level = 1; level < levels && ok; level++) {
     int cw = pw > 1 ? pw / 2 : 1;
     int ch = ph > 1 ? ph / 2 : 1;
 
-    for (int y = 0; y < ch; y++) {
-      for (int x = 0; x < cw; x++) {
-        int sx = x * 2;
-        int sy = y * 2;
-        /* Sample 2x2 block from previous mip (clamp at edges) */
-        int sx1 = sx + 1 < pw ? sx + 1 : sx;
-        int sy1 = sy + 1 < ph ? sy + 1 : sy;
-
-        const uint8_t *p00 = prev + ((size_t)sy * pw + sx) * 4;
-        const uint8_t *p10 = prev + ((size_t)sy * pw + sx1) * 4;
-        const uint8_t *p01 = prev + ((size_t)sy1 * pw + sx) * 4;
-        const uint8_t *p11 = prev + ((size_t)sy1 * pw + sx1) * 4;
-
-        uint8_t *dst = cur + ((size_t)y * cw + x) * 4;
-        for (int c = 0; c < 4; c++) {
-          dst[c] = (uint8_t)((p00[c] + p10[c] + p01[c] + p11[c] + 2) / 4);
-        }
-      }
+    MipAxis ax = {0}, ay = {0};
+    float *cur = malloc((size_t)cw * ch * 4 * sizeof(float));
+    ok = cur && mip_axis_build(&ax, desc->filter, pw, cw);
+    if (ok && !mip_axis_build(&ay, desc->filter, ph, ch)) {
+      mip_axis_free(&ax);
+      ok = false;
+    }
+    if (!ok) {
+      free(cur);
+      break;
     }
 
+    MopThreadPool *lp =
+        (size_t)cw * ch >= MIP_PARALLEL_MIN_TEXELS ? pool : NULL;
+    MipFilterCtx fctx = {
+        .src8 = level == 1 ? mip0 : NULL,
+        .srcf = prev,
+        .sw = pw,
+        .dw = cw,
+        .dh = ch,
+        .bands = lp ? (ch < max_bands ? ch : max_bands) : 1,
+        .ax = &ax,
+        .ay = &ay,
+        .desc = desc,
+        .dst = cur,
+        .scratch = scratch,
+        .scratch_stride = scratch_stride,
+    };
+    mop_threadpool_parallel_rows(lp, fctx.bands, mip_filter_band, &fctx);
+    mip_axis_free(&ax);
+    mip_axis_free(&ay);
+
+    MipQuantizeCtx qctx = {
+        .src = cur, .dst = cur8, .w = cw, .desc = desc, .alpha_scale = 1.0f};
+    if (target_coverage > 0.0f)
+      qctx.alpha_scale =
+          mip_coverage_scale(cur, (size_t)cw * ch, cutoff, target_coverage);
+    mop_threadpool_parallel_rows(lp, ch, mip_quantize_row, &qctx);
+
+    free(prev);
     prev = cur;
-    cur += (size_t)cw * (size_t)ch * 4;
+    cur8 += (size_t)cw * (size_t)ch * 4;
     pw = cw;
     ph = ch;
   }
+  free(prev);
+  free(scratch);
 
+  if (!ok) {
+    free(buf);
+    return NULL;
+  }
   *out_total_size = total;
   *out_levels = levels;
   return buf;
 }
 
 /* -------------------------------------------------------------------------
- * Texture cache lookup
+ * Path normalization
+ *
+ * Cache keys are normalized so "tex/a.png", "tex//a.png", "./tex/a.png"
+ * and "tex\\a.png" hit the same entry: backslashes become '/', repeated
+ * separators and "." segments are dropped, and "seg/.." pairs cancel.
+ * Leading ".." segments are kept.  Case is preserved.  Returns false if
+ * the result does not fit in `cap` bytes.
+ * ------------------------------------------------------------------------- */
+
+static bool tex_path_normalize(const char *in, char *out, size_t cap) {
+  size_t n = 0;
+  bool absolute = in[0] == '/' || in[0] == '\\';
+  if (absolute) {
+    if (cap < 2)
+      return false;
+    out[n++] = '/';
+  }
+  size_t root = n; /* ".." never pops past here */
+
+  const char *p = in;
+  while (*p) {
+    while (*p == '/' || *p == '\\')
+      p++;
+    if (!*p)
+      break;
+    const char *seg = p;
+    while (*p && *p != '/' && *p != '\\')
+      p++;
+    size_t len = (size_t)(p - seg);
+
+    if (len == 1 && seg[0] == '.')
+      continue;
+    if (len == 2 && seg[0] == '.' && seg[1] == '.') {
+      /* Pop the previous segment unless it is itself ".." */
+      size_t last = n;
+      while (last > root && out[last - 1] != '/')
+        last--;
+      bool prev_dotdot = n - last == 2 && out[last] == '.' &&
+                         out[last + 1] == '.';
+      if (n > root && !prev_dotdot) {
+        n = last > root ? last - 1 : root;
+        continue;
+      }
+      if (absolute && n == root)
+        continue; /* "/.." is "/" */
+    }
+
+    if (n > root) {
+      if (n + 1 >= cap)
+        return false;
+      out[n++] = '/';
+    }
+    if (n + len >= cap)
+      return false;
+    memcpy(out + n, seg, len);
+    n += len;
+  }
+
+  if (n == 0) {
+    if (cap < 2)
+      return false;
+    out[n++] = '.';
+  }
+  out[n] = '\0';
+  return true;
+}
+
+/* -------------------------------------------------------------------------
+ * Texture cache index
+ *
+ * Open addressing with linear probing over a power-of-two table.  Slots
+ * hold entry index + 1 (0 = empty).  Entries are never removed one at a
+ * time — mop_tex_cache_flush compacts the entry array and rebuilds both
+ * indices — so no tombstones are needed.
  * ------------------------------------------------------------------------- */
 
-static MopTexture *cache_lookup(MopViewport *vp, const char *path) {
+static uint32_t tex_slot_home(uint64_t key, uint32_t mask) {
+  key ^= key >> 33;
+  key *= 0xff51afd7ed558ccdULL;
+  key ^= key >> 33;
+  return (uint32_t)key & mask;
+}
+
+static void index_insert_path(MopViewport *vp, uint32_t entry) {
+  uint32_t mask = vp->tex_index_capacity - 1;
+  uint32_t i = tex_slot_home(vp->tex_cache[entry].path_hash, mask);
+  while (vp->tex_path_index[i])
+    i = (i + 1) & mask;
+  vp->tex_path_index[i] = entry + 1;
+}
+
+/* Returns the entry index of the first cached texture with this content,
+ * or UINT32_MAX. */
+static uint32_t index_find_content(const MopViewport *vp, uint64_t hash,
+                                   int w, int h) {
+  if (!vp->tex_index_capacity || !hash)
+    return UINT32_MAX;
+  uint32_t mask = vp->tex_index_capacity - 1;
+  uint32_t i = tex_slot_home(hash, mask);
+  while (vp->tex_content_index[i]) {
+    uint32_t e = vp->tex_content_index[i] - 1;
+    const MopTexture *t = vp->tex_cache[e].texture;
+    if (t->content_hash == hash && t->width == w && t->height == h)
+      return e;
+    i = (i + 1) & mask;
+  }
+  return UINT32_MAX;
+}
+
+static void index_insert_content(MopViewport *vp, uint32_t entry) {
+  const MopTexture *t = vp->tex_cache[entry].texture;
+  if (!t->content_hash ||
+      index_find_content(vp, t->content_hash, t->width, t->height) !=
+          UINT32_MAX)
+    return;
+  uint32_t mask = vp->tex_index_capacity - 1;
+  uint32_t i = tex_slot_home(t->content_hash, mask);
+  while (vp->tex_content_index[i])
+    i = (i + 1) & mask;
+  vp->tex_content_index[i] = entry + 1;
+}
+
+/* Size both indices for `entries` and re-insert every cache entry. */
+static bool index_rebuild(MopViewport *vp, uint32_t entries) {
+  uint32_t cap = vp->tex_index_capacity ? vp->tex_index_capacity : 32;
+  while (cap < entries * 2)
+    cap *= 2;
+  if (cap != vp->tex_index_capacity) {
+    uint32_t *path_idx = calloc(cap, sizeof(uint32_t));
+    uint32_t *content_idx = calloc(cap, sizeof(uint32_t));
+    if (!path_idx || !content_idx) {
+      free(path_idx);
+      free(content_idx);
+      return false;
+    }
+    free(vp->tex_path_index);
+    free(vp->tex_content_index);
+    vp->tex_path_index = path_idx;
+    vp->tex_content_index = content_idx;
+    vp->tex_index_capacity = cap;
+  } else {
+    memset(vp->tex_path_index, 0, cap * sizeof(uint32_t));
+    memset(vp->tex_content_index, 0, cap * sizeof(uint32_t));
+  }
   for (uint32_t i = 0; i < vp->tex_cache_count; i++) {
-    if (strcmp(vp->tex_cache[i].path, path) == 0) {
+    index_insert_path(vp, i);
+    index_insert_content(vp, i);
+  }
+  return true;
+}
+
+static MopTexture *cache_lookup(MopViewport *vp, const char *norm_path,
+                                uint64_t path_hash) {
+  if (!vp->tex_index_capacity)
+    return NULL;
+  uint32_t mask = vp->tex_index_capacity - 1;
+  uint32_t i = tex_slot_home(path_hash, mask);
+  while (vp->tex_path_index[i]) {
+    const struct MopTexCacheEntry *e =
+        &vp->tex_cache[vp->tex_path_index[i] - 1];
+    if (e->path_hash == path_hash && strcmp(e->path, norm_path) == 0) {
       vp->tex_cache_hits++;
-      MopTexture *tex = vp->tex_cache[i].texture;
-      tex->last_used_frame = vp->frame_counter;
-      return tex;
+      e->texture->last_used_frame = vp->frame_counter;
+      return e->texture;
     }
+    i = (i + 1) & mask;
   }
   return NULL;
 }
 
-static bool cache_insert(MopViewport *vp, const char *path, MopTexture *tex) {
+/* Content-hash dedup within this viewport: same pixels, different path */
+static MopTexture *cache_lookup_content(MopViewport *vp, uint64_t hash, int w,
+                                        int h) {
+  uint32_t e = index_find_content(vp, hash, w, h);
+  if (e == UINT32_MAX)
+    return NULL;
+  MopTexture *tex = vp->tex_cache[e].texture;
+  vp->tex_cache_hits++;
+  tex->last_used_frame = vp->frame_counter;
+  return tex;
+}
+
+static bool cache_insert(MopViewport *vp, const char *norm_path,
+                         uint64_t path_hash, MopTexture *tex) {
   if (vp->tex_cache_count >= vp->tex_cache_capacity) {
     uint32_t new_cap = vp->tex_cache_capacity ? vp->tex_cache_capacity * 2 : 16;
     struct MopTexCacheEntry *new_cache =
@@ -155,12 +644,109 @@ static bool cache_insert(MopViewport *vp, const char *path, MopTexture *tex) {
     vp->tex_cache_capacity = new_cap;
   }
 
-  struct MopTexCacheEntry *entry = &vp->tex_cache[vp->tex_cache_count++];
-  snprintf(entry->path, sizeof(entry->path), "%s", path);
+  uint32_t idx = vp->tex_cache_count;
+  struct MopTexCacheEntry *entry = &vp->tex_cache[idx];
+  snprintf(entry->path, sizeof(entry->path), "%s", norm_path);
+  entry->path_hash = path_hash;
   entry->texture = tex;
+
+  /* Keep the load factor <= 1/2 */
+  if ((idx + 1) * 2 > vp->tex_index_capacity) {
+    vp->tex_cache_count = idx + 1;
+    if (!index_rebuild(vp, idx + 1)) {
+      vp->tex_cache_count = idx;
+      return false;
+    }
+    tex->cache_refs++;
+    return true;
+  }
+  index_insert_path(vp, idx);
+  index_insert_content(vp, idx);
+  vp->tex_cache_count = idx + 1;
+  tex->cache_refs++;
   return true;
 }
 
+/* Release a cached/created texture's backend object, store reference and
+ * wrapper.  Shared by flush and viewport teardown. */
+static void tex_release(MopViewport *vp, MopTexture *t) {
+  if (vp->rhi && vp->device && t->rhi_texture)
+    vp->rhi->texture_destroy(vp->device, t->rhi_texture);
+  mop_tex_store_release(t->blob);
+  free(t);
+}
+
+/* -------------------------------------------------------------------------
+ * RGBA8 texture creation
+ *
+ * When the backend can sample host memory in place (texture_create_shared),
+ * the pixels are interned in the process-wide store and the texture keeps
+ * a reference, so identical images share one buffer across every viewport.
+ * Otherwise the backend uploads its own copy and the reference is dropped.
+ * `blob`, if non-NULL, is an already-acquired reference for desc->data
+ * whose ownership passes to this function.
+ * ------------------------------------------------------------------------- */
+
+static MopTexture *tex_create_rgba8(MopViewport *viewport,
+                                    const MopTextureDesc *desc, uint64_t hash,
+                                    MopTexBlob *blob) {
+  const MopRhiBackend *rhi = viewport->rhi;
+  MopRhiDevice *dev = viewport->device;
+  MopRhiTexture *rhi_tex = NULL;
+
+  if (rhi->texture_create_shared) {
+    if (!blob)
+      blob = mop_tex_store_acquire(desc->data, desc->width, desc->height, hash);
+    if (blob)
+      rhi_tex = rhi->texture_create_shared(dev, desc->width, desc->height,
+                                           blob->pixels);
+  }
+  if (!rhi_tex) {
+    rhi_tex = rhi->texture_create(dev, desc->width, desc->height, desc->data);
+    mop_tex_store_release(blob);
+    blob = NULL;
+  }
+  if (!rhi_tex)
+    return NULL;
+
+  MopTexture *tex = calloc(1, sizeof(MopTexture));
+  if (!tex) {
+    rhi->texture_destroy(dev, rhi_tex);
+    mop_tex_store_release(blob);
+    return NULL;
+  }
+
+  tex->rhi_texture = rhi_tex;
+  tex->blob = blob;
+  tex->width = desc->width;
+  tex->height = desc->height;
+  tex->srgb = desc->srgb;
+  tex->stream_state = MOP_TEX_STREAM_COMPLETE;
+  tex->last_used_frame = viewport->frame_counter;
+  tex->content_hash = hash;
+
+  /* Compute mip levels */
+  if (desc->mip_levels > 0) {
+    tex->mip_levels = desc->mip_levels;
+  } else {
+    int max_dim = desc->width > desc->height ? desc->width : desc->height;
+    tex->mip_levels = 1;
+    while (max_dim > 1) {
+      max_dim /= 2;
+      tex->mip_levels++;
+    }
+  }
+
+  /* Mip generation is deferred until the RHI gains per-mip upload.
+   * generate_mips_rgba8() is available for when backends support it.
+   * For now, the GPU driver or backend handles mip generation if needed,
+   * and we report mip_levels=1 (mip 0 only). */
+  if (!desc->generate_mips)
+    tex->mip_levels = 1;
+
+  return tex;
+}
+
 /* -------------------------------------------------------------------------
  * mop_tex_create — create texture from descriptor
  * ------------------------------------------------------------------------- */
@@ -229,51 +815,11 @@ MopTexture *mop_tex_create(MopViewport *viewport, const MopTextureDesc *desc) {
   }
 
   /* RGBA8 path */
-  rhi_tex = rhi->texture_create(dev, desc->width, desc->height, desc->data);
-  if (!rhi_tex) {
-    MOP_VP_UNLOCK(viewport);
-    return NULL;
-  }
-
-  MopTexture *tex = calloc(1, sizeof(MopTexture));
-  if (!tex) {
-    rhi->texture_destroy(dev, rhi_tex);
-    MOP_VP_UNLOCK(viewport);
-    return NULL;
-  }
-
-  tex->rhi_texture = rhi_tex;
-  tex->width = desc->width;
-  tex->height = desc->height;
-  tex->srgb = desc->srgb;
-  tex->stream_state = MOP_TEX_STREAM_COMPLETE;
-  tex->last_used_frame = viewport->frame_counter;
-
-  /* Compute content hash */
   size_t data_size = desc->data_size
                          ? desc->data_size
                          : (size_t)desc->width * (size_t)desc->height * 4;
-  tex->content_hash = fnv1a_hash(desc->data, data_size);
-
-  /* Compute mip levels */
-  if (desc->mip_levels > 0) {
-    tex->mip_levels = desc->mip_levels;
-  } else {
-    int max_dim = desc->width > desc->height ? desc->width : desc->height;
-    tex->mip_levels = 1;
-    while (max_dim > 1) {
-      max_dim /= 2;
-      tex->mip_levels++;
-    }
-  }
-
-  /* Mip generation is deferred until the RHI gains per-mip upload.
-   * generate_mips_rgba8() is available for when backends support it.
-   * For now, the GPU driver or backend handles mip generation if needed,
-   * and we report mip_levels=1 (mip 0 only). */
-  if (!desc->generate_mips)
-    tex->mip_levels = 1;
-
+  MopTexture *tex = tex_create_rgba8(viewport, desc,
+                                     fnv1a_hash(desc->data, data_size), NULL);
   MOP_VP_UNLOCK(viewport);
   return tex;
 }
@@ -283,43 +829,73 @@ MopTexture *mop_tex_create(MopViewport *viewport, const MopTextureDesc *desc) {
  *
  * True async loading would use a background thread + ring buffer.
  * For now, this loads synchronously via stb_image but provides the
- * full cache + dedup path.
+ * full cache + dedup path:
+ *
+ *   1. normalized path  -> this viewport's cache (O(1) hash lookup)
+ *   2. normalized path  -> process-wide store (another viewport already
+ *                          decoded the unchanged file; no decode)
+ *   3. decode, content hash -> this viewport's content index (same
+ *                          pixels under a different path)
+ *   4. intern the pixels in the process-wide store and create
  * ------------------------------------------------------------------------- */
 
 MopTexture *mop_tex_load_async(MopViewport *viewport, const char *path) {
   if (!viewport || !path || !path[0])
     return NULL;
 
+  char norm[sizeof(((struct MopTexCacheEntry *)0)->path)];
+  if (!tex_path_normalize(path, norm, sizeof(norm))) {
+    MOP_WARN("mop_tex_load_async: path too long '%s'", path);
+    return NULL;
+  }
+  uint64_t path_hash = fnv1a_hash((const uint8_t *)norm, strlen(norm));
+
   MOP_VP_LOCK(viewport);
   /* Check cache first (path-based) */
-  MopTexture *cached = cache_lookup(viewport, path);
+  MopTexture *cached = cache_lookup(viewport, norm, path_hash);
   if (cached) {
     MOP_VP_UNLOCK(viewport);
     return cached;
   }
 
-  /* Load via stb_image */
-  int w, h, channels;
-  uint8_t *pixels = stbi_load(path, &w, &h, &channels, 4 /* force RGBA */);
-  if (!pixels) {
-    MOP_WARN("mop_tex_load_async: failed to load '%s': %s", path,
-             stbi_failure_reason());
-    MOP_VP_UNLOCK(viewport);
-    return NULL;
-  }
+  /* Another viewport may already hold the decoded pixels */
+  MopTexBlob *blob = mop_tex_store_acquire_path(norm);
+  if (!blob) {
+    int w, h, channels;
+    uint8_t *pixels = stbi_load(path, &w, &h, &channels, 4 /* force RGBA */);
+    if (!pixels) {
+      MOP_WARN("mop_tex_load_async: failed to load '%s': %s", path,
+               stbi_failure_reason());
+      MOP_VP_UNLOCK(viewport);
+      return NULL;
+    }
 
-  /* Check for content-hash dedup: same pixel data loaded from a different path
-   */
-  size_t pixel_size = (size_t)w * (size_t)h * 4;
-  uint64_t hash = fnv1a_hash(pixels, pixel_size);
-  for (uint32_t i = 0; i < viewport->tex_cache_count; i++) {
-    MopTexture *t = viewport->tex_cache[i].texture;
-    if (t && t->content_hash == hash && t->width == w && t->height == h) {
-      /* Content match — reuse existing texture, add path alias to cache */
+    size_t pixel_size = (size_t)w * (size_t)h * 4;
+    uint64_t hash = fnv1a_hash(pixels, pixel_size);
+
+    /* Same pixel data loaded from a different path: alias it */
+    MopTexture *t = cache_lookup_content(viewport, hash, w, h);
+    if (t) {
       stbi_image_free(pixels);
-      viewport->tex_cache_hits++;
-      t->last_used_frame = viewport->frame_counter;
-      cache_insert(viewport, path, t);
+      cache_insert(viewport, norm, path_hash, t);
+      MOP_VP_UNLOCK(viewport);
+      return t;
+    }
+
+    blob = mop_tex_store_acquire(pixels, w, h, hash);
+    stbi_image_free(pixels);
+    if (!blob) {
+      MOP_WARN("mop_tex_load_async: out of memory interning '%s'", path);
+      MOP_VP_UNLOCK(viewport);
+      return NULL;
+    }
+    mop_tex_store_bind_path(norm, blob);
+  } else {
+    MopTexture *t =
+        cache_lookup_content(viewport, blob->hash, blob->width, blob->height);
+    if (t) {
+      mop_tex_store_release(blob);
+      cache_insert(viewport, norm, path_hash, t);
       MOP_VP_UNLOCK(viewport);
       return t;
     }
@@ -327,28 +903,28 @@ MopTexture *mop_tex_load_async(MopViewport *viewport, const char *path) {
 
   /* Create texture descriptor */
   MopTextureDesc desc = {
-      .width = w,
-      .height = h,
+      .width = blob->width,
+      .height = blob->height,
       .format = MOP_TEX_FORMAT_RGBA8,
-      .data = pixels,
-      .data_size = (uint32_t)pixel_size,
+      .data = blob->pixels,
+      .data_size = (uint32_t)((size_t)blob->width * blob->height * 4),
       .generate_mips = true,
       .srgb = true, /* assume sRGB for file-loaded textures */
   };
 
-  MopTexture *tex = mop_tex_create(viewport, &desc);
-  stbi_image_free(pixels);
-
+  MopTexture *tex = tex_create_rgba8(viewport, &desc, blob->hash, blob);
   if (!tex) {
     MOP_VP_UNLOCK(viewport);
     return NULL;
   }
 
   /* Store path and insert into cache */
-  snprintf(tex->path, sizeof(tex->path), "%s", path);
-  if (!cache_insert(viewport, path, tex)) {
+  snprintf(tex->path, sizeof(tex->path), "%s", norm);
+  if (!cache_insert(viewport, norm, path_hash, tex)) {
+    /* The cache owns loaded textures: one it cannot hold would leak */
     MOP_WARN("mop_tex_load_async: cache insert failed for '%s' (OOM)", path);
-    /* Texture is still usable, just won't be cached for dedup */
+    tex_release(viewport, tex);
+    tex = NULL;
   }
 
   MOP_VP_UNLOCK(viewport);
@@ -388,33 +964,24 @@ MopTexCacheStats mop_tex_cache_stats(const MopViewport *viewport) {
   stats.total_textures = viewport->tex_cache_count;
   stats.cache_hits = viewport->tex_cache_hits;
 
-  /* Count unique textures by hash */
+  /* Unique textures are the canonical entries of the content index;
+   * aliases (same pixels, another path) share memory and count once. */
   uint32_t unique = 0;
   for (uint32_t i = 0; i < viewport->tex_cache_count; i++) {
     const MopTexture *t = viewport->tex_cache[i].texture;
     if (!t)
       continue;
-    bool dup = false;
-    for (uint32_t j = 0; j < i; j++) {
-      const MopTexture *t2 = viewport->tex_cache[j].texture;
-      if (t2 && t->content_hash && t->content_hash == t2->content_hash) {
-        dup = true;
-        break;
-      }
-    }
-    if (!dup)
-      unique++;
-  }
-  stats.unique_textures = unique;
+    uint32_t canon =
+        index_find_content(viewport, t->content_hash, t->width, t->height);
+    if (canon != UINT32_MAX && canon != i)
+      continue;
+    unique++;
 
-  /* Estimate GPU memory (RGBA8 = 4 bytes/pixel, mip chain ~1.33x) */
-  for (uint32_t i = 0; i < viewport->tex_cache_count; i++) {
-    const MopTexture *t = viewport->tex_cache[i].texture;
-    if (t) {
-      uint64_t base = (uint64_t)t->width * (uint64_t)t->height * 4;
-      stats.memory_used += base + base / 3; /* approximate mip chain */
-    }
+    /* Estimate GPU memory (RGBA8 = 4 bytes/pixel, mip chain ~1.33x) */
+    uint64_t base = (uint64_t)t->width * (uint64_t)t->height * 4;
+    stats.memory_used += base + base / 3; /* approximate mip chain */
   }
+  stats.unique_textures = unique;
 
   return stats;
 }
@@ -431,23 +998,26 @@ void mop_tex_cache_flush(MopViewport *viewport, uint32_t max_age_frames) {
   uint32_t current_frame = viewport->frame_counter;
   uint32_t write = 0;
 
+  /* Path aliases share one MopTexture and therefore one last_used_frame,
+   * so they are evicted together; the texture is released with the last
+   * entry holding it. */
   for (uint32_t i = 0; i < viewport->tex_cache_count; i++) {
-    MopTexture *t = viewport->tex_cache[i].texture;
+    struct MopTexCacheEntry *e = &viewport->tex_cache[i];
+    MopTexture *t = e->texture;
     if (t && (current_frame - t->last_used_frame) > max_age_frames) {
-      /* Evict — destroy the texture via RHI */
-      if (viewport->rhi && viewport->device) {
-        viewport->rhi->texture_destroy(viewport->device, t->rhi_texture);
-      }
-      free(t);
+      if (--t->cache_refs == 0)
+        tex_release(viewport, t);
     } else {
       /* Keep */
       if (write != i)
-        viewport->tex_cache[write] = viewport->tex_cache[i];
+        viewport->tex_cache[write] = *e;
       write++;
     }
   }
 
   viewport->tex_cache_count = write;
+  if (viewport->tex_index_capacity)
+    index_rebuild(viewport, write);
   MOP_VP_UNLOCK(viewport);
 }
 
@@ -476,13 +1046,24 @@ bool mop_tex_read_rgba8(MopViewport *viewport, MopTexture *texture,
 void mop_tex_cache_destroy_all(MopViewport *vp) {
   if (!vp)
     return;
-  /* Note: we do NOT destroy the RHI textures here because they may be
-   * shared with meshes that are still being cleaned up.  The viewport
-   * destroy path handles RHI texture destruction separately. */
+  /* Viewport destroy calls this after the meshes are gone and before the
+   * device is: backend textures, wrappers and store references are all
+   * released, so the shared pixels outlive this viewport only while
+   * others still hold them. */
+  for (uint32_t i = 0; i < vp->tex_cache_count; i++) {
+    MopTexture *t = vp->tex_cache[i].texture;
+    if (t && --t->cache_refs == 0)
+      tex_release(vp, t);
+  }
   free(vp->tex_cache);
+  free(vp->tex_path_index);
+  free(vp->tex_content_index);
   vp->tex_cache = NULL;
+  vp->tex_path_index = NULL;
+  vp->tex_content_index = NULL;
   vp->tex_cache_count = 0;
   vp->tex_cache_capacity = 0;
+  vp->tex_index_capacity = 0;
   vp->tex_cache_hits = 0;
 }
 
@@ -490,10 +1071,31 @@ void mop_tex_cache_destroy_all(MopViewport *vp) {
  * mop_tex_generate_mips — standalone mip generation for external use
  * ------------------------------------------------------------------------- */
 
-uint8_t *mop_tex_generate_mips(const uint8_t *rgba_data, int width, int height,
-                               size_t *out_total_size, int *out_levels) {
+uint8_t *mop_tex_generate_mips_ex(MopViewport *viewport,
+                                  const uint8_t *rgba_data, int width,
+                                  int height, const MopMipDesc *desc,
+                                  size_t *out_total_size, int *out_levels) {
   if (!rgba_data || width <= 0 || height <= 0 || !out_total_size || !out_levels)
     return NULL;
-  return generate_mips_rgba8(rgba_data, width, height, out_total_size,
-                             out_levels);
+  static const MopMipDesc k_default = {.filter = MOP_MIP_FILTER_BOX};
+  if (!desc)
+    desc = &k_default;
+
+  /* The worker pool is shared with the render graph: hold the scene lock
+   * so a concurrent render cannot interleave its tasks with ours. */
+  if (!viewport)
+    return generate_mips_rgba8(NULL, rgba_data, width, height, desc,
+                               out_total_size, out_levels);
+  MOP_VP_LOCK(viewport);
+  uint8_t *buf =
+      generate_mips_rgba8(viewport->thread_pool, rgba_data, width, height,
+                          desc, out_total_size, out_levels);
+  MOP_VP_UNLOCK(viewport);
+  return buf;
+}
+
+uint8_t *mop_tex_generate_mips(const uint8_t *rgba_data, int width, int height,
+                               size_t *out_total_size, int *out_levels) {
+  return mop_tex_generate_mips_ex(NULL, rgba_data, width, height, NULL,
+                                  out_total_size, out_levels);
 }
@@ -0,0 +1,381 @@
+/*
+ * Master of Puppets — Content-Addressed Texture Store
+ * texture_store.c — Process-wide interning of decoded RGBA8 images
+ *
+ * Two open-addressing tables (linear probing, power-of-two capacity,
+ * load factor <= 1/2) behind one mutex:
+ *
+ *   blobs  — (content hash, width, height) -> MopTexBlob *.  A key match
+ *            is confirmed by comparing pixels, so images whose hashes
+ *            collide get blobs of their own in the same probe run.
+ *   paths  — normalized path -> PathRecord * (blob, file size, mtime).
+ *            Each blob lists the records naming it and drops them when
+ *            it is freed, so the table never outgrows the live blobs'
+ *            paths.
+ *
+ * Both tables use backward-shift deletion, so probes never see
+ * tombstones.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "core/texture_store.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+static pthread_mutex_t s_store_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static MopTexBlob **s_blobs;   /* open-addressing slots, NULL = empty */
+static uint32_t s_blob_cap;    /* power of two (0 = not allocated) */
+static uint32_t s_blob_count;  /* live blobs */
+static uint64_t s_blob_bytes;  /* sum of live pixel bytes */
+
+typedef struct MopTexPathRecord {
+  char *path;         /* normalized path */
+  uint64_t path_hash; /* FNV-1a of path */
+  MopTexBlob *blob;   /* what the file decoded to (no reference held) */
+  int64_t file_size;  /* st_size at decode time */
+  int64_t file_mtime; /* st_mtim at decode time, nanoseconds */
+  struct MopTexPathRecord *next; /* blob's next record */
+} PathRecord;
+
+static PathRecord **s_paths; /* open-addressing slots, NULL = empty */
+static uint32_t s_path_cap;
+static uint32_t s_path_count;
+
+/* -------------------------------------------------------------------------
+ * Hashing helpers
+ * ------------------------------------------------------------------------- */
+
+static uint64_t mix64(uint64_t h) {
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
+static uint64_t blob_key(uint64_t hash, int w, int h) {
+  return mix64(hash ^ ((uint64_t)(uint32_t)w << 32 | (uint32_t)h));
+}
+
+static uint64_t path_hash(const char *s) {
+  uint64_t h = 0xcbf29ce484222325ULL;
+  for (; *s; s++) {
+    h ^= (uint8_t)*s;
+    h *= 0x100000001b3ULL;
+  }
+  return h;
+}
+
+/* -------------------------------------------------------------------------
+ * Blob table
+ * ------------------------------------------------------------------------- */
+
+static uint32_t blob_home(const MopTexBlob *b, uint32_t mask) {
+  return (uint32_t)blob_key(b->hash, b->width, b->height) & mask;
+}
+
+/* Slot of the blob holding exactly these pixels, or the empty slot that
+ * ends the probe run. */
+static uint32_t blob_find_slot(const uint8_t *rgba, int w, int h,
+                               uint64_t hash) {
+  uint32_t mask = s_blob_cap - 1;
+  uint32_t i = (uint32_t)blob_key(hash, w, h) & mask;
+  while (s_blobs[i]) {
+    const MopTexBlob *b = s_blobs[i];
+    if (b->hash == hash && b->width == w && b->height == h &&
+        memcmp(b->pixels, rgba, (size_t)w * (size_t)h * 4) == 0)
+      return i;
+    i = (i + 1) & mask;
+  }
+  return i;
+}
+
+/* Slot holding `blob` itself */
+static uint32_t blob_slot_of(const MopTexBlob *blob) {
+  uint32_t mask = s_blob_cap - 1;
+  uint32_t i = blob_home(blob, mask);
+  while (s_blobs[i] != blob)
+    i = (i + 1) & mask;
+  return i;
+}
+
+static bool blob_table_grow(void) {
+  uint32_t new_cap = s_blob_cap ? s_blob_cap * 2 : 64;
+  MopTexBlob **slots = calloc(new_cap, sizeof(MopTexBlob *));
+  if (!slots)
+    return false;
+  MopTexBlob **old = s_blobs;
+  uint32_t old_cap = s_blob_cap;
+  s_blobs = slots;
+  s_blob_cap = new_cap;
+  for (uint32_t i = 0; i < old_cap; i++) {
+    if (!old[i])
+      continue;
+    uint32_t j = blob_home(old[i], new_cap - 1);
+    while (s_blobs[j])
+      j = (j + 1) & (new_cap - 1);
+    s_blobs[j] = old[i];
+  }
+  free(old);
+  return true;
+}
+
+/* Backward-shift deletion: pull later members of the probe run into the
+ * hole so lookups stay tombstone-free. */
+static void blob_table_remove(uint32_t hole) {
+  uint32_t mask = s_blob_cap - 1;
+  s_blobs[hole] = NULL;
+  uint32_t i = (hole + 1) & mask;
+  while (s_blobs[i]) {
+    uint32_t home = blob_home(s_blobs[i], mask);
+    /* Move if `home` does not lie cyclically within (hole, i] */
+    bool in_range = hole <= i ? (home > hole && home <= i)
+                              : (home > hole || home <= i);
+    if (!in_range) {
+      s_blobs[hole] = s_blobs[i];
+      s_blobs[i] = NULL;
+      hole = i;
+    }
+    i = (i + 1) & mask;
+  }
+}
+
+static void path_records_drop(MopTexBlob *blob);
+
+MopTexBlob *mop_tex_store_acquire(const uint8_t *rgba, int width, int height,
+                                  uint64_t hash) {
+  if (!rgba || width <= 0 || height <= 0)
+    return NULL;
+
+  pthread_mutex_lock(&s_store_mutex);
+  if ((s_blob_count + 1) * 2 > s_blob_cap && !blob_table_grow()) {
+    pthread_mutex_unlock(&s_store_mutex);
+    return NULL;
+  }
+
+  uint32_t slot = blob_find_slot(rgba, width, height, hash);
+  MopTexBlob *blob = s_blobs[slot];
+  if (blob) {
+    blob->refs++;
+    pthread_mutex_unlock(&s_store_mutex);
+    return blob;
+  }
+
+  size_t bytes = (size_t)width * (size_t)height * 4;
+  blob = malloc(sizeof(MopTexBlob));
+  uint8_t *pixels = blob ? malloc(bytes) : NULL;
+  if (!pixels) {
+    free(blob);
+    pthread_mutex_unlock(&s_store_mutex);
+    return NULL;
+  }
+  memcpy(pixels, rgba, bytes);
+  *blob = (MopTexBlob){.hash = hash,
+                       .width = width,
+                       .height = height,
+                       .refs = 1,
+                       .pixels = pixels,
+                       .paths = NULL};
+  s_blobs[slot] = blob;
+  s_blob_count++;
+  s_blob_bytes += bytes;
+  pthread_mutex_unlock(&s_store_mutex);
+  return blob;
+}
+
+void mop_tex_store_retain(MopTexBlob *blob) {
+  if (!blob)
+    return;
+  pthread_mutex_lock(&s_store_mutex);
+  blob->refs++;
+  pthread_mutex_unlock(&s_store_mutex);
+}
+
+void mop_tex_store_release(MopTexBlob *blob) {
+  if (!blob)
+    return;
+  pthread_mutex_lock(&s_store_mutex);
+  if (--blob->refs > 0) {
+    pthread_mutex_unlock(&s_store_mutex);
+    return;
+  }
+  blob_table_remove(blob_slot_of(blob));
+  path_records_drop(blob);
+  s_blob_count--;
+  s_blob_bytes -= (uint64_t)blob->width * (uint64_t)blob->height * 4;
+  pthread_mutex_unlock(&s_store_mutex);
+
+  free(blob->pixels);
+  free(blob);
+}
+
+void mop_tex_store_usage(uint32_t *out_blobs, uint64_t *out_bytes,
+                         uint32_t *out_paths) {
+  pthread_mutex_lock(&s_store_mutex);
+  if (out_blobs)
+    *out_blobs = s_blob_count;
+  if (out_bytes)
+    *out_bytes = s_blob_bytes;
+  if (out_paths)
+    *out_paths = s_path_count;
+  pthread_mutex_unlock(&s_store_mutex);
+}
+
+/* -------------------------------------------------------------------------
+ * Path records
+ * ------------------------------------------------------------------------- */
+
+static uint32_t path_find_slot(const char *path, uint64_t ph) {
+  uint32_t mask = s_path_cap - 1;
+  uint32_t i = (uint32_t)mix64(ph) & mask;
+  while (s_paths[i]) {
+    if (s_paths[i]->path_hash == ph && strcmp(s_paths[i]->path, path) == 0)
+      return i;
+    i = (i + 1) & mask;
+  }
+  return i;
+}
+
+static bool path_table_grow(void) {
+  uint32_t new_cap = s_path_cap ? s_path_cap * 2 : 64;
+  PathRecord **slots = calloc(new_cap, sizeof(PathRecord *));
+  if (!slots)
+    return false;
+  PathRecord **old = s_paths;
+  uint32_t old_cap = s_path_cap;
+  s_paths = slots;
+  s_path_cap = new_cap;
+  for (uint32_t i = 0; i < old_cap; i++) {
+    if (old[i])
+      s_paths[path_find_slot(old[i]->path, old[i]->path_hash)] = old[i];
+  }
+  free(old);
+  return true;
+}
+
+/* Backward-shift deletion, as blob_table_remove */
+static void path_table_remove(uint32_t hole) {
+  uint32_t mask = s_path_cap - 1;
+  s_paths[hole] = NULL;
+  uint32_t i = (hole + 1) & mask;
+  while (s_paths[i]) {
+    uint32_t home = (uint32_t)mix64(s_paths[i]->path_hash) & mask;
+    bool in_range = hole <= i ? (home > hole && home <= i)
+                              : (home > hole || home <= i);
+    if (!in_range) {
+      s_paths[hole] = s_paths[i];
+      s_paths[i] = NULL;
+      hole = i;
+    }
+    i = (i + 1) & mask;
+  }
+}
+
+static void path_record_unlink(PathRecord *rec) {
+  PathRecord **link = &rec->blob->paths;
+  while (*link != rec)
+    link = &(*link)->next;
+  *link = rec->next;
+}
+
+/* Remove every record naming `blob`, which is being freed */
+static void path_records_drop(MopTexBlob *blob) {
+  PathRecord *rec = blob->paths;
+  while (rec) {
+    PathRecord *next = rec->next;
+    path_table_remove(path_find_slot(rec->path, rec->path_hash));
+    s_path_count--;
+    free(rec->path);
+    free(rec);
+    rec = next;
+  }
+  blob->paths = NULL;
+}
+
+/* Size and modification time in nanoseconds: a whole-second mtime would
+ * miss a same-size rewrite within one second. */
+static bool file_signature(const char *path, int64_t *size, int64_t *mtime) {
+  struct stat st;
+  if (stat(path, &st) != 0)
+    return false;
+  *size = (int64_t)st.st_size;
+#if defined(MOP_PLATFORM_MACOS)
+  *mtime = (int64_t)st.st_mtimespec.tv_sec * 1000000000 +
+           (int64_t)st.st_mtimespec.tv_nsec;
+#else
+  *mtime = (int64_t)st.st_mtim.tv_sec * 1000000000 +
+           (int64_t)st.st_mtim.tv_nsec;
+#endif
+  return true;
+}
+
+MopTexBlob *mop_tex_store_acquire_path(const char *norm_path) {
+  if (!norm_path || !norm_path[0])
+    return NULL;
+  int64_t size, mtime;
+  if (!file_signature(norm_path, &size, &mtime))
+    return NULL;
+
+  uint64_t ph = path_hash(norm_path);
+  MopTexBlob *blob = NULL;
+  pthread_mutex_lock(&s_store_mutex);
+  if (s_path_count > 0) {
+    const PathRecord *rec = s_paths[path_find_slot(norm_path, ph)];
+    if (rec && rec->file_size == size && rec->file_mtime == mtime) {
+      blob = rec->blob;
+      blob->refs++;
+    }
+  }
+  pthread_mutex_unlock(&s_store_mutex);
+  return blob;
+}
+
+void mop_tex_store_bind_path(const char *norm_path, MopTexBlob *blob) {
+  if (!norm_path || !norm_path[0] || !blob)
+    return;
+  int64_t size, mtime;
+  if (!file_signature(norm_path, &size, &mtime))
+    return;
+
+  uint64_t ph = path_hash(norm_path);
+  pthread_mutex_lock(&s_store_mutex);
+  if ((s_path_count + 1) * 2 > s_path_cap && !path_table_grow()) {
+    pthread_mutex_unlock(&s_store_mutex);
+    return;
+  }
+  uint32_t slot = path_find_slot(norm_path, ph);
+  PathRecord *rec = s_paths[slot];
+  if (!rec) {
+    size_t len = strlen(norm_path) + 1;
+    rec = calloc(1, sizeof(PathRecord));
+    char *copy = rec ? malloc(len) : NULL;
+    if (!copy) {
+      free(rec);
+      pthread_mutex_unlock(&s_store_mutex);
+      return;
+    }
+    memcpy(copy, norm_path, len);
+    rec->path = copy;
+    rec->path_hash = ph;
+    s_paths[slot] = rec;
+    s_path_count++;
+  } else if (rec->blob != blob) {
+    path_record_unlink(rec); /* the file now decodes to other pixels */
+    rec->blob = NULL;
+  }
+  if (!rec->blob) {
+    rec->blob = blob;
+    rec->next = blob->paths;
+    blob->paths = rec;
+  }
+  rec->file_size = size;
+  rec->file_mtime = mtime;
+  pthread_mutex_unlock(&s_store_mutex);
+}
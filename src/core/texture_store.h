@@ -0,0 +1,60 @@
+/*
+ * Master of Puppets — Content-Addressed Texture Store
+ * texture_store.h — Process-wide, refcounted, immutable RGBA8 pixel blobs
+ *
+ * Decoded images are interned by content: a (hash, width, height) match
+ * is confirmed against the pixels.  Every viewport that loads the same
+ * pixels — from any path — receives the same blob, so identical images
+ * live in memory once per process.  A parallel path record remembers
+ * which blob a normalized file path decoded to (validated against the
+ * file's size and nanosecond mtime), letting a second viewport skip the
+ * decode entirely.  Records go away with their blob.
+ *
+ * Blob pixels are immutable once interned.  Thread-safe: all entry
+ * points serialize on one process-wide mutex.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef MOP_TEXTURE_STORE_H
+#define MOP_TEXTURE_STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct MopTexBlob {
+  uint64_t hash;   /* FNV-1a of the RGBA8 pixels */
+  int width;       /* pixels */
+  int height;      /* pixels */
+  uint32_t refs;   /* live references; freed when this reaches 0 */
+  uint8_t *pixels; /* width * height * 4 bytes, immutable */
+  struct MopTexPathRecord *paths; /* store-private: records naming it */
+} MopTexBlob;
+
+/* Intern `rgba` under `hash`.  Returns the existing blob with an extra
+ * reference if one holds the same pixels, otherwise copies them into a
+ * new blob with one reference.  Returns NULL on OOM. */
+MopTexBlob *mop_tex_store_acquire(const uint8_t *rgba, int width, int height,
+                                  uint64_t hash);
+
+/* Look up the blob a normalized file path last decoded to.  Returns a
+ * new reference, or NULL when the path is unknown, the file changed on
+ * disk, or the blob has since been released by every holder. */
+MopTexBlob *mop_tex_store_acquire_path(const char *norm_path);
+
+/* Record that `norm_path` decodes to `blob`.  Holds no reference — the
+ * record is removed when the last holder releases the blob. */
+void mop_tex_store_bind_path(const char *norm_path, MopTexBlob *blob);
+
+/* Add a reference to an already-held blob. */
+void mop_tex_store_retain(MopTexBlob *blob);
+
+/* Drop one reference; frees the pixels when the last holder releases. */
+void mop_tex_store_release(MopTexBlob *blob);
+
+/* Number of live blobs, their total pixel bytes and the path records
+ * naming them (for stats/tests).  Any output may be NULL. */
+void mop_tex_store_usage(uint32_t *out_blobs, uint64_t *out_bytes,
+                         uint32_t *out_paths);
+
+#endif /* MOP_TEXTURE_STORE_H */
@@ -245,3 +245,52 @@ void mop_threadpool_wait(MopThreadPool *pool) {
 int mop_threadpool_num_threads(const MopThreadPool *pool) {
   return pool ? pool->num_threads : 0;
 }
+
+/* -------------------------------------------------------------------------
+ * Row-parallel dispatch
+ * ------------------------------------------------------------------------- */
+
+#define MOP_MAX_ROW_JOBS 256
+
+typedef struct MopRowJob {
+  MopRowFn fn;
+  void *ctx;
+  int row_begin;
+  int row_end;
+} MopRowJob;
+
+static void row_job_task(void *arg) {
+  MopRowJob *job = (MopRowJob *)arg;
+  for (int y = job->row_begin; y < job->row_end; y++)
+    job->fn(job->ctx, y);
+}
+
+void mop_threadpool_parallel_rows(MopThreadPool *pool, int rows, MopRowFn fn,
+                                  void *ctx) {
+  if (!pool || rows < 2) {
+    for (int y = 0; y < rows; y++)
+      fn(ctx, y);
+    return;
+  }
+
+  /* A few chunks per worker keeps the tail short when rows differ in
+   * cost (prefilter levels, polar rows, image borders). */
+  int chunks = pool->num_threads * 4;
+  if (chunks > rows)
+    chunks = rows;
+  if (chunks > MOP_MAX_ROW_JOBS)
+    chunks = MOP_MAX_ROW_JOBS;
+
+  MopRowJob jobs[MOP_MAX_ROW_JOBS];
+  for (int c = 0; c < chunks; c++) {
+    jobs[c] = (MopRowJob){
+        .fn = fn,
+        .ctx = ctx,
+        .row_begin = (int)((int64_t)rows * c / chunks),
+        .row_end = (int)((int64_t)rows * (c + 1) / chunks),
+    };
+    if (!mop_threadpool_submit(pool, row_job_task, &jobs[c]))
+      row_job_task(&jobs[c]);
+  }
+  mop_threadpool_wait(pool);
+}
@@ -36,4 +36,13 @@ void mop_threadpool_wait(MopThreadPool *pool);
 /* Return the number of worker threads in the pool. */
 int mop_threadpool_num_threads(const MopThreadPool *pool);
 
+/* Row-parallel fork-join: call fn(ctx, row) for every row in [0, rows),
+ * split into a few contiguous chunks per worker, and wait for all of
+ * them.  A NULL pool runs the rows inline on the caller.  Rows must be
+ * independent.  Must not be called from a task running on `pool`, and
+ * waits for every task in the pool, not only its own. */
+typedef void (*MopRowFn)(void *ctx, int row);
+void mop_threadpool_parallel_rows(MopThreadPool *pool, int rows, MopRowFn fn,
+                                  void *ctx);
+
 #endif /* MOP_THREAD_POOL_H */
@@ -5,8 +5,10 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <math.h>
 #include <mop/core/vertex_format.h>
 #include <stddef.h>
+#include <string.h>
 
 uint32_t mop_attrib_format_size(MopAttribFormat fmt) {
   switch (fmt) {
@@ -19,7 +21,13 @@ uint32_t mop_attrib_format_size(MopAttribFormat fmt) {
   case MOP_FORMAT_FLOAT4:
     return 16;
   case MOP_FORMAT_UBYTE4:
+  case MOP_FORMAT_UNORM16X2:
+  case MOP_FORMAT_OCT16:
+  case MOP_FORMAT_HALF2:
+  case MOP_FORMAT_UNORM8X4:
     return 4;
+  case MOP_FORMAT_UNORM16X3:
+    return 6;
   }
   return 0;
 }
@@ -76,6 +84,31 @@ MopVertexFormat mop_vertex_format_pos_normal_uv(void) {
   return fmt;
 }
 
+MopVertexFormat mop_vertex_format_quantized(MopVec3 bbox_min,
+                                            MopVec3 bbox_max) {
+  /*
+   * Matches MopQuantizedVertex (loader/mop_scene.h):
+   *   uint16_t pos[3];   offset  0, unorm16x3 (6 bytes)
+   *   int16_t  nrm[2];   offset  6, oct16     (4 bytes)
+   *   uint8_t  color[4]; offset 10, unorm8x4  (4 bytes)
+   *   uint16_t uv[2];    offset 14, unorm16x2 (4 bytes)
+   *                      stride = 18 bytes
+   */
+  MopVertexFormat fmt = {
+      .attrib_count = 4,
+      .stride = 18,
+      .attribs = {
+          [0] = {MOP_ATTRIB_POSITION, MOP_FORMAT_UNORM16X3, 0},
+          [1] = {MOP_ATTRIB_NORMAL, MOP_FORMAT_OCT16, 6},
+          [2] = {MOP_ATTRIB_COLOR, MOP_FORMAT_UNORM8X4, 10},
+          [3] = {MOP_ATTRIB_TEXCOORD0, MOP_FORMAT_UNORM16X2, 14},
+      },
+      .pos_scale = {bbox_max.x - bbox_min.x, bbox_max.y - bbox_min.y,
+                    bbox_max.z - bbox_min.z},
+      .pos_offset = {bbox_min.x, bbox_min.y, bbox_min.z}};
+  return fmt;
+}
+
 const MopVertexAttrib *mop_vertex_format_find(const MopVertexFormat *fmt,
                                               MopAttribSemantic sem) {
   if (!fmt)
@@ -87,3 +120,96 @@ const MopVertexAttrib *mop_vertex_format_find(const MopVertexFormat *fmt,
   }
   return NULL;
 }
+
+/* -------------------------------------------------------------------------
+ * Attribute decoding
+ * ------------------------------------------------------------------------- */
+
+static float half_to_float(uint16_t h) {
+  uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+  uint32_t exp = (h >> 10) & 0x1F;
+  uint32_t man = h & 0x3FF;
+  uint32_t bits;
+  if (exp == 0x1F) {
+    bits = sign | 0x7F800000 | (man << 13); /* inf / NaN */
+  } else if (exp != 0) {
+    bits = sign | ((exp + 112) << 23) | (man << 13);
+  } else {
+    /* Zero or subnormal: exact as man * 2^-24 */
+    float f = (float)man * (1.0f / 16777216.0f);
+    return sign ? -f : f;
+  }
+  float f;
+  memcpy(&f, &bits, sizeof(f));
+  return f;
+}
+
+/* Octahedral decode (Cigolle et al. 2014), same mapping as .mop files */
+static void oct_decode(int16_t ix, int16_t iy, float out[3]) {
+  float ox = (float)ix / 32767.0f;
+  float oy = (float)iy / 32767.0f;
+  float oz = 1.0f - fabsf(ox) - fabsf(oy);
+  if (oz < 0.0f) {
+    float tx = (1.0f - fabsf(oy)) * (ox >= 0.0f ? 1.0f : -1.0f);
+    float ty = (1.0f - fabsf(ox)) * (oy >= 0.0f ? 1.0f : -1.0f);
+    ox = tx;
+    oy = ty;
+  }
+  float len = sqrtf(ox * ox + oy * oy + oz * oz);
+  float inv = len > 1e-8f ? 1.0f / len : 0.0f;
+  out[0] = ox * inv;
+  out[1] = oy * inv;
+  out[2] = oz * inv;
+}
+
+void mop_vertex_attrib_read(const MopVertexFormat *fmt,
+                            const MopVertexAttrib *attr, const void *vertex,
+                            float out[4]) {
+  out[0] = out[1] = out[2] = 0.0f;
+  out[3] = 1.0f;
+  if (!attr || !vertex)
+    return;
+  const uint8_t *p = (const uint8_t *)vertex + attr->offset;
+
+  switch (attr->format) {
+  case MOP_FORMAT_FLOAT4:
+  case MOP_FORMAT_FLOAT3:
+  case MOP_FORMAT_FLOAT2:
+  case MOP_FORMAT_FLOAT:
+    memcpy(out, p, mop_attrib_format_size(attr->format));
+    break;
+  case MOP_FORMAT_UBYTE4:
+    for (int i = 0; i < 4; i++)
+      out[i] = (float)p[i];
+    break;
+  case MOP_FORMAT_UNORM8X4:
+    for (int i = 0; i < 4; i++)
+      out[i] = (float)p[i] * (1.0f / 255.0f);
+    break;
+  case MOP_FORMAT_UNORM16X2:
+  case MOP_FORMAT_UNORM16X3: {
+    uint16_t q[3];
+    int n = attr->format == MOP_FORMAT_UNORM16X3 ? 3 : 2;
+    memcpy(q, p, (size_t)n * sizeof(uint16_t));
+    for (int i = 0; i < n; i++)
+      out[i] = (float)q[i] * (1.0f / 65535.0f);
+    if (n == 3 && fmt && attr->semantic == MOP_ATTRIB_POSITION)
+      for (int i = 0; i < 3; i++)
+        out[i] = fmt->pos_offset[i] + out[i] * fmt->pos_scale[i];
+    break;
+  }
+  case MOP_FORMAT_OCT16: {
+    int16_t q[2];
+    memcpy(q, p, sizeof(q));
+    oct_decode(q[0], q[1], out);
+    break;
+  }
+  case MOP_FORMAT_HALF2: {
+    uint16_t h[2];
+    memcpy(h, p, sizeof(h));
+    out[0] = half_to_float(h[0]);
+    out[1] = half_to_float(h[1]);
+    break;
+  }
+  }
+}
@@ -5,9 +5,13 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include "core/mesh_topology.h"
+#include "core/pick_bvh.h"
 #include "core/render_graph.h"
+#include "core/texture_store.h"
 #include "core/thread_pool.h"
 #include "core/viewport_internal.h"
+#include "math/math_simd.h"
 #include "rhi/rhi.h"
 
 #include <math.h>
@@ -142,6 +146,7 @@ static uint32_t mop_mesh_pool_acquire(MopViewport *vp) {
     /* The MopMesh in this slot was previously zeroed by remove_mesh. */
     vp->meshes[slot]->slot_index = slot;
     vp->meshes[slot]->viewport = vp;
+    vp->meshes[slot]->uid = ++vp->next_mesh_uid;
     return slot;
   }
   /* Grow the pointer array if needed. */
@@ -165,6 +170,7 @@ static uint32_t mop_mesh_pool_acquire(MopViewport *vp) {
   uint32_t slot = vp->mesh_count++;
   mesh->slot_index = slot;
   mesh->viewport = vp;
+  mesh->uid = ++vp->next_mesh_uid;
   vp->meshes[slot] = mesh;
   return slot;
 }
@@ -648,6 +654,8 @@ MopViewport *mop_viewport_create(const MopViewportDesc *desc) {
   vp->bloom_threshold = 1.0f;
   vp->bloom_intensity = 0.5f;
   vp->ssr_intensity = 0.5f;
+  vp->lod_hysteresis = 0.1f;
+  vp->meshlet_culling = true;
   vp->volumetric_params = (MopVolumetricParams){
       .density = 0.02f,
       .color = {1.0f, 1.0f, 1.0f, 1.0f},
@@ -710,6 +718,7 @@ MopViewport *mop_viewport_create(const MopViewportDesc *desc) {
 
   vp->undo_capacity = MOP_INITIAL_UNDO_CAPACITY;
   vp->undo_entries = calloc(vp->undo_capacity, sizeof(MopUndoEntry));
+  vp->undo_budget = MOP_DEFAULT_UNDO_BUDGET;
 
   vp->selection.element_capacity = MOP_INITIAL_SELECTED_ELEMENTS_CAPACITY;
   vp->selection.elements =
@@ -836,7 +845,6 @@ void mop_viewport_destroy(MopViewport *viewport) {
   free(viewport->env_hdr_data);
   free(viewport->env_irradiance_data);
   free(viewport->env_prefiltered_data);
-  free(viewport->env_brdf_lut_data);
 
   /* Destroy gradient background buffers */
   if (viewport->bg_vb)
@@ -871,6 +879,15 @@ void mop_viewport_destroy(MopViewport *viewport) {
       free(mesh->morph_targets);
       free(mesh->morph_weights);
       free(mesh->tangents);
+      free(mesh->material_program);
+      free(mesh->shader);
+      if (mesh->meshlets) {
+        mop_meshlet_free(mesh->meshlets);
+        free(mesh->meshlets);
+      }
+      mop_topology_free(mesh->topology);
+      mop_pick_bvh_free(mesh->pick_vertices);
+      mop_pick_bvh_free(mesh->pick_edges);
       for (uint32_t li = 0; li < mesh->lod_level_count; li++) {
         if (mesh->lod_levels[li].vertex_buffer)
           viewport->rhi->buffer_destroy(viewport->device,
@@ -896,6 +913,9 @@ void mop_viewport_destroy(MopViewport *viewport) {
     free(im);
   }
 
+  /* Destroy texture cache (meshes sampling it are gone, the device not) */
+  mop_tex_cache_destroy_all(viewport);
+
   if (viewport->framebuffer) {
     viewport->rhi->framebuffer_destroy(viewport->device, viewport->framebuffer);
   }
@@ -922,19 +942,19 @@ void mop_viewport_destroy(MopViewport *viewport) {
   free(viewport->overlays);
   free(viewport->overlay_enabled);
   free(viewport->selected_ids);
+  mop_id_set_free(&viewport->selected_set);
   free(viewport->events);
-  /* Free batch heap memory in undo entries before freeing the array */
-  for (uint32_t i = 0; i < viewport->undo_capacity; i++) {
-    if (viewport->undo_entries[i].type == MOP_UNDO_BATCH &&
-        viewport->undo_entries[i].batch.entries) {
-      free(viewport->undo_entries[i].batch.entries);
-    }
-  }
+  /* Free heap memory held by undo entries before freeing the array */
+  mop_undo_clear(viewport);
   free(viewport->undo_entries);
   free(viewport->selection.elements);
+  mop_id_set_free(&viewport->element_set);
 
-  /* Destroy texture cache */
-  mop_tex_cache_destroy_all(viewport);
+
+  mop_sw_ssao_free(&viewport->ssao);
+  mop_sw_bloom_free(&viewport->bloom);
+  mop_sw_ssr_free(&viewport->ssr);
+  mop_sw_oit_free(&viewport->oit);
 
   /* Destroy thread pool (Phase 1B) */
   mop_threadpool_destroy(viewport->thread_pool);
@@ -1185,6 +1205,44 @@ MopMesh *mop_viewport_add_mesh(MopViewport *viewport, const MopMeshDesc *desc) {
     MOP_ERROR("mesh has zero vertices or indices");
     return NULL;
   }
+  /* Opt-in reordering (mesh_optimize.c) runs on a private copy, then the
+   * reordered copy is added like any other mesh */
+  if (desc->optimize) {
+    size_t stride = desc->vertex_format ? desc->vertex_format->stride
+                                        : sizeof(MopVertex);
+    void *verts = malloc((size_t)desc->vertex_count * stride);
+    uint32_t *idx = malloc((size_t)desc->index_count * sizeof(uint32_t));
+    uint32_t vcount = 0;
+    MopMeshOptStats stats;
+    if (verts && idx) {
+      memcpy(verts, desc->vertices, (size_t)desc->vertex_count * stride);
+      memcpy(idx, desc->indices, (size_t)desc->index_count * sizeof(uint32_t));
+      vcount = mop_mesh_optimize(verts, desc->vertex_count, desc->vertex_format,
+                                 idx, desc->index_count, desc->optimize,
+                                 &stats);
+    }
+    if (vcount > 0) {
+      MopMeshDesc opt = *desc;
+      opt.vertices = verts;
+      opt.vertex_count = vcount;
+      opt.indices = idx;
+      opt.optimize = 0;
+      MopMesh *mesh = mop_viewport_add_mesh(viewport, &opt);
+      free(verts);
+      free(idx);
+      if (mesh) {
+        MOP_VP_LOCK(viewport);
+        mesh->opt_stats = stats;
+        mesh->has_opt_stats = true;
+        MOP_VP_UNLOCK(viewport);
+      }
+      return mesh;
+    }
+    free(verts);
+    free(idx);
+    MOP_WARN("mesh %u: optimization skipped, using the given order",
+             desc->object_id);
+  }
   /* Flexible format path — reinterpret the vertex pointer as raw bytes
    * with the given layout and route through the _ex implementation. */
   if (desc->vertex_format) {
@@ -1273,6 +1331,13 @@ MopMesh *mop_viewport_add_mesh(MopViewport *viewport, const MopMeshDesc *desc) {
   return mesh;
 }
 
+bool mop_mesh_get_optimize_stats(const MopMesh *mesh, MopMeshOptStats *out) {
+  if (!mesh || !out || !mesh->has_opt_stats)
+    return false;
+  *out = mesh->opt_stats;
+  return true;
+}
+
 MopMesh *mop_viewport_add_mesh_ex(MopViewport *viewport,
                                   const MopMeshDescEx *desc) {
   if (!viewport || !desc || !desc->vertex_data || !desc->indices ||
@@ -1322,13 +1387,14 @@ MopMesh *mop_viewport_add_mesh_ex(MopViewport *viewport,
   MopColor avg = {0.8f, 0.8f, 0.8f, 1.0f};
   const MopVertexAttrib *color_attr =
       mop_vertex_format_find(desc->vertex_format, MOP_ATTRIB_COLOR);
-  if (color_attr && color_attr->format == MOP_FORMAT_FLOAT4) {
+  if (color_attr && color_attr->format != MOP_FORMAT_UBYTE4) {
     float r_sum = 0, g_sum = 0, b_sum = 0;
     const uint8_t *raw = (const uint8_t *)desc->vertex_data;
     for (uint32_t i = 0; i < desc->vertex_count; i++) {
-      const float *c =
-          (const float *)(raw + (size_t)i * desc->vertex_format->stride +
-                          color_attr->offset);
+      float c[4];
+      mop_vertex_attrib_read(desc->vertex_format, color_attr,
+                             raw + (size_t)i * desc->vertex_format->stride,
+                             c);
       r_sum += c[0];
       g_sum += c[1];
       b_sum += c[2];
@@ -1377,6 +1443,15 @@ MopMesh *mop_viewport_add_mesh_ex(MopViewport *viewport,
   return mesh;
 }
 
+/* Pick BVHs hold positions, so any vertex write drops them, including
+ * skinning and morph targets that leave the rest of the mesh alone */
+static void mesh_drop_pick_bvh(MopMesh *mesh) {
+  mop_pick_bvh_free(mesh->pick_vertices);
+  mop_pick_bvh_free(mesh->pick_edges);
+  mesh->pick_vertices = NULL;
+  mesh->pick_edges = NULL;
+}
+
 void mop_viewport_remove_mesh(MopViewport *viewport, MopMesh *mesh) {
   if (!viewport || !mesh)
     return;
@@ -1416,17 +1491,49 @@ void mop_viewport_remove_mesh(MopViewport *viewport, MopMesh *mesh) {
   }
   mesh->lod_level_count = 0;
   mesh->active_lod = 0;
+  mesh->prev_lod = 0;
+  mesh->lod_fade_frame = 0;
+
+  if (mesh->meshlets) {
+    mop_meshlet_free(mesh->meshlets);
+    free(mesh->meshlets);
+    mesh->meshlets = NULL;
+  }
+  mop_topology_free(mesh->topology);
+  mesh->topology = NULL;
+  mesh_drop_pick_bvh(mesh);
 
   /* Clear tangents (normal mapping) */
   free(mesh->tangents);
   mesh->tangents = NULL;
   mesh->tangent_count = 0;
 
+  free(mesh->material_program);
+  mesh->material_program = NULL;
+  free(mesh->shader);
+  mesh->shader = NULL;
+  mesh->shader_plugin = NULL;
+
   mesh->active = false;
   mop_mesh_pool_release(viewport, mesh->slot_index);
   MOP_VP_UNLOCK(viewport);
 }
 
+/* Drop what was derived from the old geometry.  Mesh edits hand their
+ * incrementally updated topology back after their writes. */
+static void mesh_geometry_changed(MopMesh *mesh) {
+  mesh->geometry_serial = ++mesh->viewport->geometry_serial;
+  mesh->aabb_valid = false;
+  if (mesh->meshlets) {
+    mop_meshlet_free(mesh->meshlets);
+    free(mesh->meshlets);
+    mesh->meshlets = NULL;
+  }
+  mop_topology_free(mesh->topology);
+  mesh->topology = NULL;
+  mesh_drop_pick_bvh(mesh);
+}
+
 void mop_mesh_update_geometry(MopMesh *mesh, MopViewport *viewport,
                               const MopVertex *vertices, uint32_t vertex_count,
                               const uint32_t *indices, uint32_t index_count) {
@@ -1442,6 +1549,8 @@ void mop_mesh_update_geometry(MopMesh *mesh, MopViewport *viewport,
     MOP_VP_UNLOCK(viewport);
     return;
   }
+  mop_undo_capture_vertices(viewport, mesh, 0, mesh->vertex_count);
+  mop_undo_capture_indices(viewport, mesh, 0, mesh->index_count);
 
   /* --- Vertex buffer --- */
   if (vertex_count <= mesh->vertex_capacity) {
@@ -1505,9 +1614,100 @@ void mop_mesh_update_geometry(MopMesh *mesh, MopViewport *viewport,
     mesh->index_capacity = new_cap;
   }
   mesh->index_count = index_count;
+  mesh_geometry_changed(mesh);
   MOP_VP_UNLOCK(viewport);
 }
 
+/* Grow *buf to hold count elements, keeping its first `keep` */
+static bool mesh_buffer_grow(MopViewport *vp, MopRhiBuffer **buf,
+                             uint32_t *capacity, uint32_t keep,
+                             uint32_t count, size_t stride) {
+  if (count <= *capacity)
+    return true;
+  uint32_t new_cap = *capacity;
+  while (new_cap < count)
+    new_cap = new_cap ? new_cap * 2 : 64;
+
+  void *tmp = calloc(new_cap, stride);
+  if (!tmp)
+    return false;
+  const void *old = *buf ? vp->rhi->buffer_read(*buf) : NULL;
+  if (old)
+    memcpy(tmp, old, (size_t)(keep < count ? keep : count) * stride);
+  MopRhiBufferDesc desc = {.data = tmp, .size = (size_t)new_cap * stride};
+  MopRhiBuffer *grown = vp->rhi->buffer_create(vp->device, &desc);
+  free(tmp);
+  if (!grown)
+    return false;
+  if (*buf)
+    vp->rhi->buffer_destroy(vp->device, *buf);
+  *buf = grown;
+  *capacity = new_cap;
+  return true;
+}
+
+bool mop_mesh_resize_geometry(MopMesh *mesh, MopViewport *vp,
+                              uint32_t vertex_count, uint32_t index_count) {
+  if (!mesh || !vp || vertex_count == 0 || index_count == 0)
+    return false;
+  if (vertex_count > 16 * 1024 * 1024) {
+    MOP_ERROR("vertex count exceeds maximum (%u)", vertex_count);
+    return false;
+  }
+  MOP_VP_LOCK(vp);
+  /* Shrinking drops elements an undo may have to bring back */
+  if (vertex_count < mesh->vertex_count)
+    mop_undo_capture_vertices(vp, mesh, vertex_count,
+                              mesh->vertex_count - vertex_count);
+  if (index_count < mesh->index_count)
+    mop_undo_capture_indices(vp, mesh, index_count,
+                             mesh->index_count - index_count);
+  bool ok = mesh_buffer_grow(vp, &mesh->vertex_buffer, &mesh->vertex_capacity,
+                             mesh->vertex_count, vertex_count,
+                             sizeof(MopVertex)) &&
+            mesh_buffer_grow(vp, &mesh->index_buffer, &mesh->index_capacity,
+                             mesh->index_count, index_count, sizeof(uint32_t));
+  if (ok) {
+    mesh->vertex_count = vertex_count;
+    mesh->index_count = index_count;
+    mesh_geometry_changed(mesh);
+  }
+  MOP_VP_UNLOCK(vp);
+  return ok;
+}
+
+void mop_mesh_patch_vertices(MopMesh *mesh, MopViewport *vp, uint32_t first,
+                             const MopVertex *vertices, uint32_t count) {
+  if (!mesh || !vp || !vertices || count == 0)
+    return;
+  MOP_VP_LOCK(vp);
+  if (mesh->vertex_buffer && first <= mesh->vertex_count &&
+      count <= mesh->vertex_count - first) {
+    mop_undo_capture_vertices(vp, mesh, first, count);
+    vp->rhi->buffer_update(vp->device, mesh->vertex_buffer, vertices,
+                           (size_t)first * sizeof(MopVertex),
+                           (size_t)count * sizeof(MopVertex));
+    mesh_geometry_changed(mesh);
+  }
+  MOP_VP_UNLOCK(vp);
+}
+
+void mop_mesh_patch_indices(MopMesh *mesh, MopViewport *vp, uint32_t first,
+                            const uint32_t *indices, uint32_t count) {
+  if (!mesh || !vp || !indices || count == 0)
+    return;
+  MOP_VP_LOCK(vp);
+  if (mesh->index_buffer && first <= mesh->index_count &&
+      count <= mesh->index_count - first) {
+    mop_undo_capture_indices(vp, mesh, first, count);
+    vp->rhi->buffer_update(vp->device, mesh->index_buffer, indices,
+                           (size_t)first * sizeof(uint32_t),
+                           (size_t)count * sizeof(uint32_t));
+    mesh_geometry_changed(mesh);
+  }
+  MOP_VP_UNLOCK(vp);
+}
+
 /* -------------------------------------------------------------------------
  * Skeletal skinning — set bone matrices and apply CPU-side deformation
  * ------------------------------------------------------------------------- */
@@ -1588,6 +1788,10 @@ static void mop_skin_apply(MopMesh *mesh, MopViewport *viewport) {
       mop_vertex_format_find(fmt, MOP_ATTRIB_WEIGHTS);
   if (!pos_attr || !joints_attr || !weights_attr)
     return;
+  /* Deformation writes positions back in place: float only */
+  if (pos_attr->format != MOP_FORMAT_FLOAT3 ||
+      (norm_attr && norm_attr->format != MOP_FORMAT_FLOAT3))
+    return;
 
   size_t vb_size = (size_t)mesh->vertex_count * fmt->stride;
   uint8_t *deformed = malloc(vb_size);
@@ -1677,6 +1881,7 @@ static void mop_skin_apply(MopMesh *mesh, MopViewport *viewport) {
                                0, vb_size);
   free(deformed);
   mesh->aabb_valid = false;
+  mesh_drop_pick_bvh(mesh);
 }
 
 /* -------------------------------------------------------------------------
@@ -1772,7 +1977,7 @@ static void mop_morph_apply(MopMesh *mesh, MopViewport *viewport) {
   if (fmt) {
     const MopVertexAttrib *pos_attr =
         mop_vertex_format_find(fmt, MOP_ATTRIB_POSITION);
-    if (!pos_attr)
+    if (!pos_attr || pos_attr->format != MOP_FORMAT_FLOAT3)
       return;
     pos_off = pos_attr->offset;
   }
@@ -1801,6 +2006,7 @@ static void mop_morph_apply(MopMesh *mesh, MopViewport *viewport) {
                                0, vb_size);
   free(deformed);
   mesh->aabb_valid = false;
+  mesh_drop_pick_bvh(mesh);
 }
 
 void mop_mesh_set_transform(MopMesh *mesh, const MopMat4 *transform) {
@@ -1850,12 +2056,14 @@ MopTexture *mop_viewport_create_texture(MopViewport *viewport, int width,
   if (!rhi_tex)
     return NULL;
 
-  MopTexture *tex = malloc(sizeof(MopTexture));
+  MopTexture *tex = calloc(1, sizeof(MopTexture));
   if (!tex) {
     viewport->rhi->texture_destroy(viewport->device, rhi_tex);
     return NULL;
   }
   tex->rhi_texture = rhi_tex;
+  tex->width = width;
+  tex->height = height;
   return tex;
 }
 
@@ -1863,6 +2071,7 @@ void mop_viewport_destroy_texture(MopViewport *viewport, MopTexture *texture) {
   if (!viewport || !texture)
     return;
   viewport->rhi->texture_destroy(viewport->device, texture->rhi_texture);
+  mop_tex_store_release(texture->blob);
   free(texture);
 }
 
@@ -1880,7 +2089,7 @@ void mop_mesh_set_texture(MopMesh *mesh, MopTexture *texture) {
 
 MopMaterial mop_material_default(void) {
   MopMaterial m = {0}; /* zero-init all fields (critical: texture
-                          pointers must default to NULL or EMIT_DRAW
+                          pointers must default to NULL or emit_draw_level
                           dereferences garbage) */
   m.base_color = (MopColor){1.0f, 1.0f, 1.0f, 1.0f};
   m.metallic = 0.0f;
@@ -1894,6 +2103,8 @@ void mop_mesh_set_material(MopMesh *mesh, const MopMaterial *material) {
   MOP_VP_LOCK(mesh->viewport);
   mesh->material = *material;
   mesh->has_material = true;
+  free(mesh->material_program); /* replaces an attached material graph */
+  mesh->material_program = NULL;
   MOP_VP_UNLOCK(mesh->viewport);
 }
 
@@ -1992,7 +2203,7 @@ static uint32_t s_lod_transitions;
 /* Forward declaration for LOD selection (defined after mop_viewport_set_chrome)
  */
 static uint32_t lod_select(const MopMesh *mesh, float projected_diameter,
-                           float lod_bias);
+                           float lod_bias, float hysteresis);
 
 /* True when at least one active directional light has cast_shadows=true.
  * Drives MopRhiDrawCall.cast_shadows so backends can skip the shadow pass
@@ -2008,84 +2219,113 @@ static inline bool mop_viewport_shadows_enabled_(const MopViewport *vp) {
   return false;
 }
 
-/* ---- Helper macro: issue a draw call for a mesh ---- */
+/* ---- Helper: issue a draw call for a mesh ---- */
 /* Chrome meshes (grid = MOP_GRID_ID, >= 0xFFFE0000 for gizmo/indicators)
  * are rendered fully unlit (ambient=1, no lights) so they keep their vertex
- * colors without being darkened or brightened by scene lighting. */
-#define EMIT_DRAW(vp, mesh_ptr)                                                \
-  do {                                                                         \
-    struct MopMesh *m_ = (mesh_ptr);                                           \
-    /* LOD selection (Phase 9C): use active LOD's buffers if available */      \
-    MopRhiBuffer *vb_ = m_->vertex_buffer;                                     \
-    MopRhiBuffer *ib_ = m_->index_buffer;                                      \
-    uint32_t vcnt_ = m_->vertex_count;                                         \
-    uint32_t icnt_ = m_->index_count;                                          \
-    if (m_->active_lod > 0 && m_->active_lod <= m_->lod_level_count) {         \
-      uint32_t li_ = m_->active_lod - 1;                                       \
-      if (m_->lod_levels[li_].vertex_buffer) {                                 \
-        vb_ = m_->lod_levels[li_].vertex_buffer;                               \
-        ib_ = m_->lod_levels[li_].index_buffer;                                \
-        vcnt_ = m_->lod_levels[li_].vertex_count;                              \
-        icnt_ = m_->lod_levels[li_].index_count;                               \
-      }                                                                        \
-    }                                                                          \
-    s_triangle_count += icnt_ / 3;                                             \
-    s_vertex_count += vcnt_;                                                   \
-    s_draw_call_count++;                                                       \
-    bool chrome_ = (m_->object_id >= 0xFFFD0000u);                             \
-    MopMat4 mvp_ = mop_mat4_multiply(                                          \
-        (vp)->projection_matrix,                                               \
-        mop_mat4_multiply((vp)->view_matrix, m_->world_transform));            \
-    MopRhiDrawCall call_ = {                                                   \
-        .vertex_buffer = vb_,                                                  \
-        .index_buffer = ib_,                                                   \
-        .vertex_count = vcnt_,                                                 \
-        .index_count = icnt_,                                                  \
-        .object_id = m_->object_id,                                            \
-        .model = m_->world_transform,                                          \
-        .view = (vp)->view_matrix,                                             \
-        .projection = (vp)->projection_matrix,                                 \
-        .mvp = mvp_,                                                           \
-        .base_color = m_->base_color,                                          \
-        .opacity = m_->opacity,                                                \
-        .light_dir = (vp)->light_dir,                                          \
-        .ambient = chrome_ ? 1.0f : (vp)->ambient,                             \
-        .shading_mode = (m_->shading_mode_override >= 0                        \
-                             ? (MopShadingMode)m_->shading_mode_override       \
-                             : (vp)->shading_mode),                            \
-        .wireframe =                                                           \
-            ((vp)->render_mode == MOP_RENDER_WIREFRAME) && m_->object_id != 0, \
-        .depth_test = (m_->object_id < 0xFFFD0000u),                           \
-        .depth_write = true,                                                   \
-        .backface_cull = (m_->object_id < 0xFFFD0000u),                        \
-        .texture = (m_->has_material && m_->material.albedo_map)               \
-                       ? m_->material.albedo_map->rhi_texture                  \
-                       : (m_->texture ? m_->texture->rhi_texture : NULL),      \
-        .normal_map = (m_->has_material && m_->material.normal_map)            \
-                          ? m_->material.normal_map->rhi_texture               \
-                          : NULL,                                              \
-        .metallic_roughness_map =                                              \
-            (m_->has_material && m_->material.metallic_roughness_map)          \
-                ? m_->material.metallic_roughness_map->rhi_texture             \
-                : NULL,                                                        \
-        .ao_map = (m_->has_material && m_->material.ao_map)                    \
-                      ? m_->material.ao_map->rhi_texture                       \
-                      : NULL,                                                  \
-        .blend_mode = m_->blend_mode,                                          \
-        .metallic = m_->has_material ? m_->material.metallic : 0.0f,           \
-        .roughness = m_->has_material ? m_->material.roughness : 0.5f,         \
-        .emissive =                                                            \
-            m_->has_material ? m_->material.emissive : (MopVec3){0, 0, 0},     \
-        .lights = chrome_ ? NULL : (vp)->lights,                               \
-        .light_count = chrome_ ? 0 : (vp)->light_count,                        \
-        .cam_eye = (vp)->cam_eye,                                              \
-        .vertex_format = m_->vertex_format,                                    \
-        .aabb_min = m_->aabb_valid ? m_->aabb_local.min : (MopVec3){0, 0, 0},  \
-        .aabb_max = m_->aabb_valid ? m_->aabb_local.max : (MopVec3){0, 0, 0},  \
-        .cast_shadows = !chrome_ && mop_viewport_shadows_enabled_(vp),         \
-    };                                                                         \
-    (vp)->rhi->draw((vp)->device, (vp)->framebuffer, &call_);                  \
-  } while (0)
+ * colors without being darkened or brightened by scene lighting.
+ *
+ * `lod` picks the level's buffers (Phase 9C); `dither` > 0 draws it
+ * screen-door dithered (see MopRhiDrawCall). */
+static void emit_draw_level(MopViewport *vp, struct MopMesh *m, uint32_t lod,
+                            float dither, bool dither_invert) {
+  MopRhiBuffer *vb = m->vertex_buffer;
+  MopRhiBuffer *ib = m->index_buffer;
+  uint32_t vcnt = m->vertex_count;
+  uint32_t icnt = m->index_count;
+  /* Meshlet bounds hold for the undeformed base geometry only */
+  const MopMeshletData *meshlets =
+      (vp->meshlet_culling && m->bone_count == 0 &&
+       m->morph_target_count == 0)
+          ? m->meshlets
+          : NULL;
+  if (lod > 0 && lod <= m->lod_level_count) {
+    uint32_t li = lod - 1;
+    if (m->lod_levels[li].vertex_buffer) {
+      vb = m->lod_levels[li].vertex_buffer;
+      ib = m->lod_levels[li].index_buffer;
+      vcnt = m->lod_levels[li].vertex_count;
+      icnt = m->lod_levels[li].index_count;
+      meshlets = NULL;
+    }
+  }
+  s_triangle_count += icnt / 3;
+  s_vertex_count += vcnt;
+  s_draw_call_count++;
+  bool chrome = (m->object_id >= 0xFFFD0000u);
+  MopMat4 mvp = mop_mat4_multiply(
+      vp->projection_matrix,
+      mop_mat4_multiply(vp->view_matrix, m->world_transform));
+  MopRhiDrawCall call = {
+      .vertex_buffer = vb,
+      .index_buffer = ib,
+      .vertex_count = vcnt,
+      .index_count = icnt,
+      .object_id = m->object_id,
+      .model = m->world_transform,
+      .view = vp->view_matrix,
+      .projection = vp->projection_matrix,
+      .mvp = mvp,
+      .base_color = m->base_color,
+      .opacity = m->opacity,
+      .light_dir = vp->light_dir,
+      .ambient = chrome ? 1.0f : vp->ambient,
+      .shading_mode = (m->shading_mode_override >= 0
+                           ? (MopShadingMode)m->shading_mode_override
+                           : vp->shading_mode),
+      .wireframe = (vp->render_mode == MOP_RENDER_WIREFRAME) &&
+                   m->object_id != 0,
+      .depth_test = (m->object_id < 0xFFFD0000u),
+      .depth_write = true,
+      .backface_cull = (m->object_id < 0xFFFD0000u),
+      .texture = (m->has_material && m->material.albedo_map)
+                     ? m->material.albedo_map->rhi_texture
+                     : (m->texture ? m->texture->rhi_texture : NULL),
+      .normal_map = (m->has_material && m->material.normal_map)
+                        ? m->material.normal_map->rhi_texture
+                        : NULL,
+      .metallic_roughness_map =
+          (m->has_material && m->material.metallic_roughness_map)
+              ? m->material.metallic_roughness_map->rhi_texture
+              : NULL,
+      .ao_map = (m->has_material && m->material.ao_map)
+                    ? m->material.ao_map->rhi_texture
+                    : NULL,
+      .blend_mode = m->blend_mode,
+      .metallic = m->has_material ? m->material.metallic : 0.0f,
+      .roughness = m->has_material ? m->material.roughness : 0.5f,
+      .emissive = m->has_material ? m->material.emissive : (MopVec3){0, 0, 0},
+      .lights = chrome ? NULL : vp->lights,
+      .light_count = chrome ? 0 : vp->light_count,
+      .cam_eye = vp->cam_eye,
+      .vertex_format = m->vertex_format,
+      .aabb_min = m->aabb_valid ? m->aabb_local.min : (MopVec3){0, 0, 0},
+      .aabb_max = m->aabb_valid ? m->aabb_local.max : (MopVec3){0, 0, 0},
+      .cast_shadows = !chrome && mop_viewport_shadows_enabled_(vp),
+      .dither_threshold = dither,
+      .dither_invert = dither_invert,
+      .meshlets = meshlets,
+      .material_program = m->material_program,
+      .shader = m->shader,
+  };
+  vp->rhi->draw(vp->device, vp->framebuffer, &call);
+}
+
+/* Draw a mesh at its active LOD.  During a LOD cross-fade on the CPU
+ * backend the outgoing level is drawn too: both share one dither
+ * threshold with opposite polarity, so together they cover every pixel
+ * exactly once while coverage shifts to the new level frame by frame. */
+static void emit_draw(MopViewport *vp, struct MopMesh *m) {
+  uint32_t frames = vp->lod_fade_frames;
+  if (vp->backend_type == MOP_BACKEND_CPU && m->lod_fade_frame < frames &&
+      m->lod_fade_from != m->active_lod &&
+      m->lod_fade_from <= m->lod_level_count) {
+    float t = (float)(m->lod_fade_frame + 1) / (float)(frames + 1);
+    emit_draw_level(vp, m, m->active_lod, t, false);
+    emit_draw_level(vp, m, m->lod_fade_from, t, true);
+    return;
+  }
+  emit_draw_level(vp, m, m->active_lod, 0.0f, false);
+}
 
 /* ---- Pass: gradient background ---- */
 
@@ -2423,16 +2663,46 @@ static void pass_shadow(MopViewport *vp) {
       continue;
 
     /* Read vertex data from the RHI buffer */
-    const MopVertex *verts =
-        (const MopVertex *)vp->rhi->buffer_read(mesh->vertex_buffer);
+    const uint8_t *raw =
+        (const uint8_t *)vp->rhi->buffer_read(mesh->vertex_buffer);
     const uint32_t *indices =
         (const uint32_t *)vp->rhi->buffer_read(mesh->index_buffer);
-    if (!verts || !indices)
+    if (!raw || !indices)
       continue;
 
-    mop_sw_shadow_render_mesh(verts, mesh->vertex_count, indices,
-                              mesh->index_count, mesh->world_transform,
-                              light_vp, &vp->shadow_fb);
+    /* Float positions are read in place; quantized ones are decoded to
+     * a temporary float3 array for this pass */
+    const float *positions = (const float *)raw;
+    size_t stride = sizeof(MopVertex);
+    float *decoded = NULL;
+    const MopVertexFormat *fmt = mesh->vertex_format;
+    if (fmt) {
+      const MopVertexAttrib *pa =
+          mop_vertex_format_find(fmt, MOP_ATTRIB_POSITION);
+      if (!pa)
+        continue;
+      stride = fmt->stride;
+      positions = (const float *)(raw + pa->offset);
+      if (pa->format != MOP_FORMAT_FLOAT3 &&
+          pa->format != MOP_FORMAT_FLOAT4) {
+        decoded = malloc((size_t)mesh->vertex_count * 3 * sizeof(float));
+        if (!decoded)
+          continue;
+        for (uint32_t v = 0; v < mesh->vertex_count; v++) {
+          float p[4];
+          mop_vertex_attrib_read(fmt, pa, raw + (size_t)v * fmt->stride, p);
+          memcpy(&decoded[v * 3], p, 3 * sizeof(float));
+        }
+        positions = decoded;
+        stride = 3 * sizeof(float);
+      }
+    }
+
+    mop_sw_shadow_render_mesh(positions, stride, mesh->vertex_count,
+                              indices, mesh->index_count,
+                              mesh->world_transform, light_vp,
+                              &vp->shadow_fb);
+    free(decoded);
   }
 
   /* Set shadow state for the main render */
@@ -2462,11 +2732,47 @@ static void pass_scene_opaque(MopViewport *vp) {
     MopAABB world_aabb = mop_mesh_get_aabb_world(mesh, vp);
     if (mop_frustum_test_aabb(&frustum, world_aabb) == -1)
       continue;
-    EMIT_DRAW(vp, mesh);
+    emit_draw(vp, mesh);
   }
 }
 
 /* ---- Pass: transparent scene meshes (back-to-front) ---- */
+/* CPU OIT: fragments are collected per pixel and composited in depth
+ * order at the end (rasterizer_oit.h), so draws go out in scene order.
+ * If the exact mode's fragment pool overflowed it has grown to fit and
+ * the alpha draws run once more; additive and multiply draws blend
+ * straight into the color target and must not be repeated.  Returns
+ * false if OIT storage is unavailable; the caller then sorts as usual. */
+static bool pass_transparent_oit(MopViewport *vp, const MopFrustum *frustum) {
+  MopSwFramebuffer *sw_fb = (MopSwFramebuffer *)vp->framebuffer;
+  MopSwOitMode mode =
+      vp->oit_mode == MOP_OIT_EXACT ? MOP_SW_OIT_EXACT : MOP_SW_OIT_WEIGHTED;
+  for (int attempt = 0; attempt < 2; attempt++) {
+    if (!mop_sw_oit_begin(&vp->oit, mode, sw_fb->width, sw_fb->height,
+                          &vp->projection_matrix))
+      return false;
+    sw_fb->oit = &vp->oit;
+    for (uint32_t i = 0; i < vp->mesh_count; i++) {
+      struct MopMesh *mesh = vp->meshes[i];
+      if (!mesh->active || mesh->blend_mode == MOP_BLEND_OPAQUE)
+        continue;
+      if (attempt > 0 && mesh->blend_mode != MOP_BLEND_ALPHA)
+        continue;
+      if (mesh->object_id >= 0xFFFE0000u)
+        continue;
+      MopAABB world_aabb = mop_mesh_get_aabb_world(mesh, vp);
+      if (mop_frustum_test_aabb(frustum, world_aabb) == -1)
+        continue;
+      emit_draw(vp, mesh);
+    }
+    sw_fb->oit = NULL;
+    if (!mop_sw_oit_grow(&vp->oit))
+      break;
+  }
+  mop_sw_oit_resolve(&vp->oit, sw_fb, vp->thread_pool);
+  return true;
+}
+
 static void pass_scene_transparent(MopViewport *vp) {
   MopFrustum frustum = mop_viewport_get_frustum(vp);
   uint32_t trans_count = 0;
@@ -2485,6 +2791,10 @@ static void pass_scene_transparent(MopViewport *vp) {
   if (trans_count == 0)
     return;
 
+  if (vp->backend_type == MOP_BACKEND_CPU &&
+      (vp->post_effects & MOP_POST_OIT) && pass_transparent_oit(vp, &frustum))
+    return;
+
   /* Grow persistent sort arrays if needed */
   if (trans_count > vp->trans_sort_capacity) {
     uint32_t new_cap = trans_count + (trans_count >> 1); /* 1.5x growth */
@@ -2503,7 +2813,7 @@ static void pass_scene_transparent(MopViewport *vp) {
           continue;
         if (mesh->object_id >= 0xFFFE0000u)
           continue;
-        EMIT_DRAW(vp, mesh);
+        emit_draw(vp, mesh);
       }
       return;
     }
@@ -2548,7 +2858,7 @@ static void pass_scene_transparent(MopViewport *vp) {
   }
 
   for (uint32_t j = 0; j < trans_count; j++) {
-    EMIT_DRAW(vp, vp->meshes[trans_idx[j]]);
+    emit_draw(vp, vp->meshes[trans_idx[j]]);
   }
 }
 
@@ -2562,7 +2872,7 @@ static void pass_gizmo(MopViewport *vp) {
       continue; /* light indicators + gizmo handles */
     if (mesh->opacity < 0.01f)
       continue; /* invisible chrome — 2D overlay + screen-space picking */
-    EMIT_DRAW(vp, mesh);
+    emit_draw(vp, mesh);
   }
 }
 
@@ -2645,7 +2955,6 @@ static void pass_instanced(MopViewport *vp) {
   }
 }
 
-#undef EMIT_DRAW
 
 /* =========================================================================
  * Render graph node callbacks
@@ -2939,6 +3248,46 @@ static void replay_post_frame_overlays_cpu(MopViewport *vp) {
                          vp->text_prim_count, (float)vp->ssaa_factor);
 }
 
+/* Decals: backends with a draw_decals hook (CPU) project them here,
+ * after opaque geometry and before transparents; GPU backends do the
+ * same inside their own frame. */
+static void rg_decals(MopViewport *vp, void *ud) {
+  (void)ud;
+  MopMat4 view_proj = mop_mat4_multiply(vp->projection_matrix, vp->view_matrix);
+  vp->rhi->draw_decals(vp->device, vp->framebuffer, view_proj.d,
+                       vp->thread_pool);
+}
+
+/* SSR (CPU backend): GPU backends trace inside their own frame.  Runs
+ * before bloom and SSAO, so reflections bloom and are occluded like the
+ * surfaces they land on.  Traced at half the output resolution. */
+static void rg_ssr(MopViewport *vp, void *ud) {
+  (void)ud;
+  MopSwFramebuffer *sw_fb = (MopSwFramebuffer *)vp->framebuffer;
+  mop_sw_ssr_apply(&vp->ssr, sw_fb, &vp->projection_matrix,
+                   2 * vp->ssaa_factor, vp->ssr_intensity, vp->thread_pool);
+}
+
+/* Bloom (CPU backend): GPU backends run the chain inside frame_end.
+ * Runs before SSAO so AO darkens scene and bloom alike, as the GPU
+ * tonemap pass does. */
+static void rg_bloom(MopViewport *vp, void *ud) {
+  (void)ud;
+  MopSwFramebuffer *sw_fb = (MopSwFramebuffer *)vp->framebuffer;
+  mop_sw_bloom_apply(&vp->bloom, sw_fb, vp->bloom_threshold,
+                     vp->bloom_intensity, vp->thread_pool);
+}
+
+/* SSAO (CPU backend): GPU backends run GTAO inside their own frame.
+ * AO is evaluated at half the output resolution, whatever the SSAA
+ * factor. */
+static void rg_ssao(MopViewport *vp, void *ud) {
+  (void)ud;
+  MopSwFramebuffer *sw_fb = (MopSwFramebuffer *)vp->framebuffer;
+  mop_sw_ssao_apply(&vp->ssao, sw_fb, &vp->projection_matrix,
+                    2 * vp->ssaa_factor, vp->thread_pool);
+}
+
 /* Submit — finalize and submit the GPU command buffer after overlays */
 static void rg_frame_submit(MopViewport *vp, void *ud) {
   (void)ud;
@@ -3102,8 +3451,8 @@ MopRenderResult mop_viewport_render(MopViewport *viewport) {
               !viewport->meshes[pi]->active || state[pi] != ST_DONE) {
             im->world_transform = im->transform;
           } else {
-            im->world_transform = mop_mat4_multiply(
-                viewport->meshes[pi]->world_transform, im->transform);
+            mop_m4_mul(&viewport->meshes[pi]->world_transform,
+                       &im->transform, &im->world_transform);
           }
           state[idx] = ST_DONE;
         }
@@ -3123,12 +3472,13 @@ MopRenderResult mop_viewport_render(MopViewport *viewport) {
       if (!mesh->active || mesh->lod_level_count == 0)
         continue;
 
-      /* Compute projected diameter from AABB */
+      /* Compute projected diameter from AABB (computed and cached on
+       * first use, so generated LOD thresholds see the real size) */
       float radius = 1.0f;
+      MopAABB box = mop_mesh_get_aabb_local(mesh, viewport);
       if (mesh->aabb_valid) {
-        MopVec3 ext = {mesh->aabb_local.max.x - mesh->aabb_local.min.x,
-                       mesh->aabb_local.max.y - mesh->aabb_local.min.y,
-                       mesh->aabb_local.max.z - mesh->aabb_local.min.z};
+        MopVec3 ext = {box.max.x - box.min.x, box.max.y - box.min.y,
+                       box.max.z - box.min.z};
         radius = 0.5f * sqrtf(ext.x * ext.x + ext.y * ext.y + ext.z * ext.z);
       }
 
@@ -3147,11 +3497,21 @@ MopRenderResult mop_viewport_render(MopViewport *viewport) {
       else
         projected_diameter = 1e6f; /* very close — use highest detail */
 
+      /* A running cross-fade advances one step per frame */
+      if (mesh->lod_fade_frame < viewport->lod_fade_frames)
+        mesh->lod_fade_frame++;
+
       mesh->prev_lod = mesh->active_lod;
-      mesh->active_lod =
-          lod_select(mesh, projected_diameter, viewport->lod_bias);
-      if (mesh->active_lod != mesh->prev_lod)
+      mesh->active_lod = lod_select(mesh, projected_diameter,
+                                    viewport->lod_bias,
+                                    viewport->lod_hysteresis);
+      if (mesh->active_lod != mesh->prev_lod) {
         s_lod_transitions++;
+        /* Fade out whichever level was on screen; a switch mid-fade
+         * restarts from the level that was fading in */
+        mesh->lod_fade_from = mesh->prev_lod;
+        mesh->lod_fade_frame = 0;
+      }
     }
   }
 
@@ -3201,6 +3561,8 @@ MopRenderResult mop_viewport_render(MopViewport *viewport) {
   static const MopRgResourceId w_color[] = {MOP_RG_RES_COLOR_HDR};
   static const MopRgResourceId w_shadow[] = {MOP_RG_RES_SHADOW_MAP};
   static const MopRgResourceId w_scene[] = {MOP_RG_RES_COLOR_HDR, MOP_RG_RES_DEPTH, MOP_RG_RES_PICK};
+  static const MopRgResourceId w_ssao[] = {MOP_RG_RES_SSAO, MOP_RG_RES_COLOR_HDR};
+  static const MopRgResourceId w_bloom[] = {MOP_RG_RES_BLOOM, MOP_RG_RES_COLOR_HDR};
   static const MopRgResourceId r_shadow[] = {MOP_RG_RES_SHADOW_MAP};
   static const MopRgResourceId r_depth[] = {MOP_RG_RES_DEPTH};
   static const MopRgResourceId r_hdr[] = {MOP_RG_RES_COLOR_HDR};
@@ -3235,6 +3597,9 @@ MopRenderResult mop_viewport_render(MopViewport *viewport) {
          (void *)(uintptr_t)MOP_SHADER_PLUGIN_POST_OPAQUE, r_depth, 1, w_scene,
          3);
 
+  if (viewport->rhi->draw_decals)
+    rg_add(&rg, "decals", rg_decals, NULL, r_depth, 1, w_color, 1);
+
   rg_add(&rg, "transparent", rg_transparent, NULL, r_depth, 1, w_scene, 3);
 
   rg_add(&rg, "instanced", rg_instanced, NULL, r_depth, 1, w_scene, 3);
@@ -3246,6 +3611,18 @@ MopRenderResult mop_viewport_render(MopViewport *viewport) {
          (void *)(uintptr_t)MOP_SHADER_PLUGIN_POST_SCENE, r_depth, 1, w_scene,
          3);
 
+  if (viewport->backend_type == MOP_BACKEND_CPU &&
+      (viewport->post_effects & MOP_POST_SSR))
+    rg_add(&rg, "ssr", rg_ssr, NULL, r_depth, 1, w_color, 1);
+
+  if (viewport->backend_type == MOP_BACKEND_CPU &&
+      (viewport->post_effects & MOP_POST_BLOOM))
+    rg_add(&rg, "bloom", rg_bloom, NULL, r_hdr, 1, w_bloom, 2);
+
+  if (viewport->backend_type == MOP_BACKEND_CPU &&
+      (viewport->post_effects & MOP_POST_SSAO))
+    rg_add(&rg, "ssao", rg_ssao, NULL, r_depth, 1, w_ssao, 2);
+
   rg_add(&rg, "overlays", rg_overlays, NULL, NULL, 0, w_color, 1);
 
   if (viewport->show_chrome)
@@ -3293,6 +3670,10 @@ MopRenderResult mop_viewport_render(MopViewport *viewport) {
 
   double t_frame_end = mop_profile_now_ms();
 
+  MopRhiMeshletStats ml_stats = {0};
+  if (viewport->rhi->meshlet_stats)
+    viewport->rhi->meshlet_stats(viewport->device, &ml_stats);
+
   /* Store profiling stats */
   viewport->last_stats = (MopFrameStats){
       .frame_time_ms = t_frame_end - t_frame_start,
@@ -3304,6 +3685,10 @@ MopRenderResult mop_viewport_render(MopViewport *viewport) {
       .draw_call_count = s_draw_call_count,
       .vertex_count = s_vertex_count,
       .lod_transitions = s_lod_transitions,
+      .meshlets_visible = ml_stats.visible,
+      .meshlets_culled_frustum = ml_stats.frustum,
+      .meshlets_culled_backface = ml_stats.backface,
+      .meshlets_culled_occlusion = ml_stats.occlusion,
       .gpu_frame_ms = viewport->rhi->frame_gpu_time_ms
                           ? viewport->rhi->frame_gpu_time_ms(viewport->device)
                           : 0.0,
@@ -4007,20 +4392,59 @@ int32_t mop_mesh_add_lod(MopMesh *mesh, MopViewport *viewport,
 }
 
 /* Select LOD level based on screen-space projected size.
- * Returns the LOD level index (0 = highest detail). */
+ * Returns the LOD level index (0 = highest detail).
+ *
+ * Each threshold is widened into a band of +-hysteresis (relative) around
+ * it, and the side the mesh currently sits on decides which edge applies:
+ * a mesh must shrink below the lower edge to coarsen and grow past the
+ * upper edge to refine.  A mesh hovering at a threshold keeps its level. */
 static uint32_t lod_select(const MopMesh *mesh, float projected_diameter,
-                           float lod_bias) {
+                           float lod_bias, float hysteresis) {
   if (mesh->lod_level_count == 0)
     return 0;
 
+  /* Thresholds shrink with each coarser level: take the coarsest level
+   * whose threshold the mesh is still below. */
   float effective = projected_diameter - lod_bias;
-  for (uint32_t i = 0; i < mesh->lod_level_count; i++) {
-    if (effective < mesh->lod_levels[i].screen_threshold)
-      return i + 1; /* lower detail LOD */
+  for (uint32_t i = mesh->lod_level_count; i > 0; i--) {
+    float t = mesh->lod_levels[i - 1].screen_threshold;
+    t *= (mesh->active_lod >= i) ? 1.0f + hysteresis : 1.0f - hysteresis;
+    if (effective < t)
+      return i; /* lower detail LOD */
   }
   return 0; /* highest detail */
 }
 
+void mop_viewport_set_lod_hysteresis(MopViewport *viewport, float band) {
+  if (!viewport)
+    return;
+  if (!(band >= 0.0f))
+    band = 0.0f;
+  viewport->lod_hysteresis = band > 0.5f ? 0.5f : band;
+}
+
+float mop_viewport_get_lod_hysteresis(const MopViewport *viewport) {
+  return viewport ? viewport->lod_hysteresis : 0.0f;
+}
+
+void mop_viewport_set_lod_fade_frames(MopViewport *viewport, uint32_t frames) {
+  if (viewport)
+    viewport->lod_fade_frames = frames > 64 ? 64 : frames;
+}
+
+uint32_t mop_viewport_get_lod_fade_frames(const MopViewport *viewport) {
+  return viewport ? viewport->lod_fade_frames : 0;
+}
+
+void mop_viewport_set_meshlet_culling(MopViewport *viewport, bool enabled) {
+  if (viewport)
+    viewport->meshlet_culling = enabled;
+}
+
+bool mop_viewport_get_meshlet_culling(const MopViewport *viewport) {
+  return viewport ? viewport->meshlet_culling : false;
+}
+
 int mop_viewport_pick_axis_indicator(MopViewport *vp, float mx, float my) {
   if (!vp)
     return 0;
@@ -8,7 +8,12 @@
 #ifndef MOP_VIEWPORT_INTERNAL_H
 #define MOP_VIEWPORT_INTERNAL_H
 
+#include "core/id_set.h"
 #include "rasterizer/rasterizer.h"
+#include "rasterizer/rasterizer_oit.h"
+#include "render/bloom.h"
+#include "render/ssao.h"
+#include "render/ssr.h"
 #include "rhi/rhi.h"
 
 #include <pthread.h>
@@ -38,10 +43,12 @@ struct MopTexture {
   MopTexStreamState stream_state; /* streaming state */
   char path[256];           /* source file path (empty = created from data) */
   uint32_t last_used_frame; /* frame counter for cache eviction */
+  uint32_t cache_refs;      /* tex_cache entries (path aliases) holding it */
   int width;
   int height;
   int mip_levels;
   bool srgb;
+  struct MopTexBlob *blob; /* shared store pixels (NULL = not interned) */
 };
 
 /* -------------------------------------------------------------------------
@@ -80,6 +87,15 @@ struct MopMesh {
   MopMaterial material;
   bool has_material;
 
+  /* Per-pixel program of the attached material graph (CPU backend, NULL =
+   * none); see mop_mesh_set_material_graph */
+  struct MopSwMatProgram *material_program;
+
+  /* CPU shader plugin binding with its uniform copy (NULL = none); see
+   * mop_mesh_set_shader_plugin */
+  struct MopShaderPlugin *shader_plugin;
+  struct MopSwShader *shader;
+
   /* Blend mode (Phase 6A) */
   MopBlendMode blend_mode;
 
@@ -100,6 +116,10 @@ struct MopMesh {
   MopAABB aabb_local;
   bool aabb_valid;
 
+  /* Reorder statistics from MopMeshDesc.optimize */
+  MopMeshOptStats opt_stats;
+  bool has_opt_stats;
+
   /* Skeletal skinning — bind-pose data + bone matrices.
    * When bone_count > 0, the mesh is considered skinned. Each frame,
    * CPU skinning transforms bind_pose_data → vertex_buffer using
@@ -135,6 +155,32 @@ struct MopMesh {
   uint32_t lod_level_count; /* number of extra LOD levels (0 = no LOD) */
   uint32_t active_lod;      /* currently selected LOD (0 = highest detail) */
   uint32_t prev_lod;        /* previous frame's LOD (for transition detect) */
+  uint32_t lod_fade_from;   /* level being faded out (valid while fading) */
+  uint32_t lod_fade_frame;  /* frames into the cross-fade (>= fade = done) */
+
+  /* Meshlets of the base geometry for CPU cluster culling (NULL = none) */
+  MopMeshletData *meshlets;
+
+  /* Half-edge adjacency kept between mesh edit operations (NULL = built
+   * by the next edit).  Geometry uploads from anywhere else drop it. */
+  struct MopMeshTopology *topology;
+
+  /* Local-space BVHs for vertex and edge picking (NULL = built by the
+   * next pick).  Dropped with the topology on every geometry write. */
+  struct MopPickBvh *pick_vertices;
+  struct MopPickBvh *pick_edges;
+
+  /* Geometry undo delta being recorded by the current edit (NULL = not
+   * recording); see mop_undo_geometry_begin */
+  struct MopUndoGeometry *undo_rec;
+
+  /* Bumped from MopViewport.geometry_serial by every write to the base
+   * geometry.  Geometry undo entries apply only on the serial they left. */
+  uint32_t geometry_serial;
+
+  /* Viewport-unique id, never reused by a recycled slot.  Undo entries
+   * key meshes by slot and uid so stale entries are skipped. */
+  uint32_t uid;
 
   /* Slot index in viewport->meshes[] — used for O(1) free-list removal.
    * The mesh pool stores pointers, so pointer arithmetic can't recover
@@ -193,6 +239,9 @@ struct MopInstancedMesh {
 #define MOP_INITIAL_OVERLAY_CAPACITY 16
 #define MOP_INITIAL_HOOK_CAPACITY 64
 #define MOP_INITIAL_UNDO_CAPACITY 256
+
+/* Bytes of undo history kept by default (mop_viewport_set_undo_budget) */
+#define MOP_DEFAULT_UNDO_BUDGET ((size_t)64 << 20)
 #define MOP_INITIAL_SELECTED_ELEMENTS_CAPACITY 4096
 
 /* -------------------------------------------------------------------------
@@ -297,6 +346,7 @@ typedef enum MopUndoEntryType {
   MOP_UNDO_TRS = 0,
   MOP_UNDO_MATERIAL = 1,
   MOP_UNDO_BATCH = 2,
+  MOP_UNDO_GEOMETRY = 3,
 } MopUndoEntryType;
 
 typedef struct MopUndoEntry {
@@ -304,18 +354,25 @@ typedef struct MopUndoEntry {
   union {
     struct {
       uint32_t mesh_index;
+      uint32_t mesh_uid;
       MopVec3 pos;
       MopVec3 rot;
       MopVec3 scale;
     } trs;
     struct {
       uint32_t mesh_index;
+      uint32_t mesh_uid;
       MopMaterial material;
     } mat;
     struct {
       uint32_t count;
       struct MopUndoEntry *entries; /* heap-allocated sub-entries */
     } batch;
+    struct {
+      uint32_t mesh_index;
+      uint32_t mesh_uid;
+      struct MopUndoGeometry *delta; /* heap-allocated, see undo.c */
+    } geom;
   };
 } MopUndoEntry;
 
@@ -427,14 +484,16 @@ struct MopViewport {
   uint32_t axis_ind_vcnt[3];
   uint32_t axis_ind_icnt[3];
 
-  /* Selection (multi-object) — dynamic array */
+  /* Selection (multi-object) — dynamic array, indexed by selected_set */
   uint32_t *selected_ids;
   uint32_t selected_count;
   uint32_t selected_capacity;
   uint32_t selected_id; /* backward compat: selected_ids[0] or 0 */
+  MopIdSet selected_set;
 
-  /* Sub-element selection (Phase 3) */
+  /* Sub-element selection (Phase 3); element_set indexes its elements */
   MopSelection selection;
+  MopIdSet element_set;
 
   /* Interaction state */
   MopInteractState interact_state;
@@ -450,12 +509,17 @@ struct MopViewport {
   /* Profiling (Phase 5C) */
   MopFrameStats last_stats;
 
-  /* Undo/redo (Phase 4B) — dynamic ring buffer */
+  /* Undo/redo (Phase 4B) — dynamic ring buffer, grown on demand and
+   * trimmed from the oldest end to stay within undo_budget bytes */
   MopUndoEntry *undo_entries;
   uint32_t undo_capacity;
   int undo_head;
   int undo_count;
   int redo_count;
+  size_t undo_bytes;  /* entries plus their heap data, undo and redo */
+  size_t undo_budget;
+  uint32_t next_mesh_uid;
+  uint32_t geometry_serial;
 
   /* Time tracking for simulation */
   float last_frame_time;
@@ -503,6 +567,15 @@ struct MopViewport {
   MopSwFramebuffer shadow_fb;
   bool shadow_fb_valid; /* true after shadow pass rendered this frame */
 
+  /* SSAO scratch (CPU backend only, MOP_POST_SSAO) */
+  MopSwSsao ssao;
+
+  /* Bloom mip chain (CPU backend only, MOP_POST_BLOOM) */
+  MopSwBloom bloom;
+
+  /* SSR depth pyramid and scratch (CPU backend only, MOP_POST_SSR) */
+  MopSwSsr ssr;
+
   /* Chrome visibility (grid, axis indicator, background, gizmo) */
   bool show_chrome; /* true by default */
 
@@ -541,13 +614,15 @@ struct MopViewport {
   MopRhiTexture *env_irradiance; /* precomputed diffuse irradiance map */
   float *env_irradiance_data;    /* raw float RGBA irradiance for CPU */
   int env_irradiance_w, env_irradiance_h;
+  float env_irradiance_sh[9][3]; /* L2 SH, cosine-convolved, / pi */
+  bool env_irradiance_sh_valid;  /* false until SH projected or loaded */
   MopRhiTexture *env_prefiltered; /* prefiltered specular map */
   float *env_prefiltered_data;    /* raw float RGBA prefiltered for CPU */
   int env_prefiltered_w, env_prefiltered_h;
-  int env_prefiltered_levels;    /* number of roughness mip levels */
-  MopRhiTexture *env_brdf_lut;   /* split-sum BRDF LUT texture */
-  float *env_brdf_lut_data;      /* raw float RG BRDF LUT for CPU */
-  MopProceduralSkyDesc sky_desc; /* procedural sky parameters */
+  int env_prefiltered_levels;     /* number of roughness mip levels */
+  MopRhiTexture *env_brdf_lut;    /* split-sum BRDF LUT texture */
+  const float *env_brdf_lut_data; /* process-wide RG BRDF LUT (shared) */
+  MopProceduralSkyDesc sky_desc;  /* procedural sky parameters */
 
   /* Reversed-Z depth buffer — improves depth precision for large scenes */
   bool reverse_z;
@@ -580,6 +655,10 @@ struct MopViewport {
   float *trans_sort_dist;
   uint32_t trans_sort_capacity;
 
+  /* CPU order-independent transparency (MOP_POST_OIT) */
+  MopOitMode oit_mode; /* default MOP_OIT_WEIGHTED */
+  MopSwOit oit;
+
   /* Shader plugins — custom render passes injected by host app */
   struct MopShaderPlugin **shader_plugins;
   uint32_t shader_plugin_count;
@@ -597,6 +676,9 @@ struct MopViewport {
 
   /* LOD bias (Phase 9C) — shifts LOD level selection */
   float lod_bias;
+  float lod_hysteresis;     /* relative band around each threshold */
+  uint32_t lod_fade_frames; /* dithered cross-fade length, 0 = pop */
+  bool meshlet_culling;     /* pass mesh meshlets to the backend */
 
   /* Error tracking for mop_viewport_render */
   MopRenderResult last_render_result;
@@ -618,13 +700,21 @@ struct MopViewport {
    * Single-threaded hosts pay only the uncontended fast path (~20 ns). */
   pthread_mutex_t scene_mutex;
 
-  /* Texture cache — path-keyed dedup cache for mop_tex_load_async */
+  /* Texture cache — path-keyed dedup cache for mop_tex_load_async.
+   * Entries are dense (iteration, eviction); the two open-addressing
+   * indices hold entry index + 1 (0 = empty slot) and are rebuilt
+   * whenever entries are compacted. */
   struct MopTexCacheEntry {
-    char path[256];
+    char path[256];     /* normalized path */
+    uint64_t path_hash; /* FNV-1a of path */
     MopTexture *texture;
   } *tex_cache;
   uint32_t tex_cache_count;
   uint32_t tex_cache_capacity;
+  uint32_t *tex_path_index;    /* keyed on path_hash */
+  uint32_t *tex_content_index; /* keyed on texture content_hash; first
+                                  entry per unique texture */
+  uint32_t tex_index_capacity; /* power of two, >= 2 * tex_cache_count */
   uint32_t tex_cache_hits; /* cumulative hit count for stats */
   uint32_t frame_counter;  /* monotonic frame counter for cache eviction */
 };
@@ -675,6 +765,55 @@ MopVec3 mop_gizmo_get_axis_dir(const MopGizmo *gizmo, int axis);
 uint32_t mop_gizmo_get_handle_id(const MopGizmo *gizmo, int axis);
 void mop_gizmo_set_handles_opacity(MopGizmo *gizmo, float opacity);
 
+/* Localized geometry writes for mesh edits.  Resizing keeps the existing
+ * contents and grows capacity 2x, so appended geometry is amortized;
+ * patches upload one sub-range of the base buffers.  Like
+ * mop_mesh_update_geometry they drop the mesh's AABB, meshlets and
+ * topology.  Patches outside the current counts are ignored. */
+bool mop_mesh_resize_geometry(MopMesh *mesh, MopViewport *vp,
+                              uint32_t vertex_count, uint32_t index_count);
+void mop_mesh_patch_vertices(MopMesh *mesh, MopViewport *vp, uint32_t first,
+                             const MopVertex *vertices, uint32_t count);
+void mop_mesh_patch_indices(MopMesh *mesh, MopViewport *vp, uint32_t first,
+                            const uint32_t *indices, uint32_t count);
+
+/* Geometry undo (undo.c).  Between begin and end, every write to the
+ * mesh's base buffers through the functions above or
+ * mop_mesh_update_geometry saves the elements it is about to overwrite
+ * or truncate; end diffs them against the result and pushes what
+ * actually changed as one undo entry.  Call with the viewport locked. */
+void mop_undo_geometry_begin(MopViewport *vp, MopMesh *mesh);
+void mop_undo_geometry_end(MopViewport *vp, MopMesh *mesh);
+void mop_undo_capture_vertices(MopViewport *vp, MopMesh *mesh, uint32_t first,
+                               uint32_t count);
+void mop_undo_capture_indices(MopViewport *vp, MopMesh *mesh, uint32_t first,
+                              uint32_t count);
+
+/* Free every undo and redo entry (mop_viewport_destroy) */
+void mop_undo_clear(MopViewport *vp);
+
+/* Sub-element picking (selection.c).  Screen coordinates are viewport
+ * pixels.  Candidates within threshold_px are found through the mesh's
+ * pick BVHs and, once a frame has been rendered, tested against its
+ * depth buffer so elements hidden behind geometry are not returned.
+ *
+ * pick_vertex returns the vertex index; pick_edge returns the edge as
+ * (lo << 16 | hi) and writes the full endpoints to out_lo / out_hi when
+ * non-NULL (the packed value is only unambiguous below 65536 vertices).
+ * Both return UINT32_MAX when nothing is in range. */
+uint32_t mop_selection_pick_vertex(MopViewport *vp, MopMesh *mesh,
+                                   float screen_x, float screen_y,
+                                   float threshold_px);
+uint32_t mop_selection_pick_edge(MopViewport *vp, MopMesh *mesh,
+                                 float screen_x, float screen_y,
+                                 float threshold_px, uint32_t *out_lo,
+                                 uint32_t *out_hi);
+bool mop_selection_project_to_screen(const MopMat4 *mvp, MopVec3 world_pos,
+                                     int vp_width, int vp_height, float *out_sx,
+                                     float *out_sy);
+float mop_selection_point_seg_dist_sq(float px, float py, float ax, float ay,
+                                      float bx, float by);
+
 /* -------------------------------------------------------------------------
  * Overlay command buffer push helpers
  * ------------------------------------------------------------------------- */
@@ -156,6 +156,7 @@ static void deselect(MopViewport *vp) {
   uint32_t old_id = vp->selected_id;
   vp->selected_count = 0;
   vp->selected_id = 0;
+  mop_id_set_clear(&vp->selected_set);
   mop_gizmo_hide(vp->gizmo);
 
   push_event(vp, (MopEvent){.type = MOP_EVENT_DESELECTED, .object_id = old_id});
@@ -5,6 +5,7 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include "core/mesh_topology.h"
 #include "core/viewport_internal.h"
 #include <mop/mop.h>
 
@@ -13,80 +14,161 @@
 #include <string.h>
 
 /* -------------------------------------------------------------------------
- * Half-edge auxiliary structure
+ * Half-edge topology
  *
- * Built on demand from the mesh's index buffer.  Used internally by
- * editing operations that need adjacency information.
+ * The mesh keeps its adjacency (core/mesh_topology.h) between edits.  An
+ * operation takes it off the mesh, building it if an earlier upload
+ * dropped it, patches the faces it rewrites, and hands it back once its
+ * own upload has gone through.  Operations that renumber vertices let
+ * the upload drop it instead.
  * ------------------------------------------------------------------------- */
 
-typedef struct MopHalfEdge {
-  uint32_t vertex; /* destination vertex */
-  uint32_t face;   /* adjacent face */
-  uint32_t next;   /* next half-edge in face */
-  uint32_t twin;   /* opposite half-edge (UINT32_MAX if boundary) */
-} MopHalfEdge;
-
-#define MOP_INVALID_HE UINT32_MAX
-
-/* Build half-edge structure from triangle index buffer.
- * Returns allocated array of half-edges (3 per face).
- * Caller must free().  Returns NULL on failure. */
-MopHalfEdge *mop_mesh_build_half_edges(const uint32_t *indices,
-                                       uint32_t index_count,
-                                       uint32_t vertex_count) {
-  uint32_t face_count = index_count / 3;
-  uint32_t he_count = face_count * 3;
-  if (he_count == 0)
-    return NULL;
-
-  MopHalfEdge *edges = (MopHalfEdge *)calloc(he_count, sizeof(MopHalfEdge));
-  if (!edges)
-    return NULL;
-
-  /* Initialize half-edges from triangles */
-  for (uint32_t f = 0; f < face_count; f++) {
-    uint32_t base = f * 3;
-    for (uint32_t e = 0; e < 3; e++) {
-      uint32_t he_idx = base + e;
-      uint32_t next_e = (e + 1) % 3;
-      edges[he_idx].vertex = indices[base + next_e];
-      edges[he_idx].face = f;
-      edges[he_idx].next = base + next_e;
-      edges[he_idx].twin = MOP_INVALID_HE;
-    }
+/* Detach the mesh's topology; build it from indices when there is none
+ * (indices NULL detaches only) */
+static MopMeshTopology *topology_take(MopMesh *mesh, MopViewport *vp,
+                                      const uint32_t *indices,
+                                      uint32_t index_count) {
+  MOP_VP_LOCK(vp);
+  MopMeshTopology *t = mesh->topology;
+  mesh->topology = NULL;
+  if (!t && indices)
+    t = mop_topology_build(indices, index_count, vp->thread_pool);
+  MOP_VP_UNLOCK(vp);
+  return t;
+}
+
+/* Reattach t if it was kept up to date and describes the mesh's faces */
+static void topology_keep(MopMesh *mesh, MopViewport *vp, MopMeshTopology *t,
+                          bool valid) {
+  MOP_VP_LOCK(vp);
+  if (t && valid && !mesh->topology &&
+      mesh->index_count == t->face_count * 3) {
+    mesh->topology = t;
+    t = NULL;
   }
+  MOP_VP_UNLOCK(vp);
+  mop_topology_free(t);
+}
 
-  /* Find twins: brute force O(n^2) for simplicity — acceptable for edit ops */
-  for (uint32_t i = 0; i < he_count; i++) {
-    if (edges[i].twin != MOP_INVALID_HE)
-      continue;
-    /* This half-edge goes from src -> dst */
-    uint32_t dst_i = edges[i].vertex;
-    uint32_t base_i = (i / 3) * 3;
-    uint32_t local_i = i - base_i;
-    /* Source vertex is the previous edge's destination, or the triangle's
-     * vertex at the current local index */
-    uint32_t src_i = indices[base_i + local_i];
-
-    for (uint32_t j = i + 1; j < he_count; j++) {
-      if (edges[j].twin != MOP_INVALID_HE)
-        continue;
-      uint32_t dst_j = edges[j].vertex;
-      uint32_t base_j = (j / 3) * 3;
-      uint32_t local_j = j - base_j;
-      uint32_t src_j = indices[base_j + local_j];
-
-      /* Twin: opposite direction */
-      if (src_i == dst_j && dst_i == src_j) {
-        edges[i].twin = j;
-        edges[j].twin = i;
-        break;
-      }
+/* Faces holding the edge (v0, v1) in either direction.  Returns the
+ * count written to *out (malloc'd, NULL when empty), or UINT32_MAX on
+ * allocation failure.  he_out receives the matching half-edge of each. */
+static uint32_t topology_edge_faces(const MopMeshTopology *t, uint32_t v0,
+                                    uint32_t v1, uint32_t **he_out) {
+  *he_out = NULL;
+  uint32_t n = 0;
+  for (int dir = 0; dir < 2; dir++) {
+    for (uint32_t h = dir ? mop_topology_find(t, v1, v0)
+                          : mop_topology_find(t, v0, v1);
+         h != MOP_INVALID_HE; h = t->same[h])
+      n++;
+  }
+  if (n == 0)
+    return 0;
+  uint32_t *hes = (uint32_t *)malloc(n * sizeof(uint32_t));
+  if (!hes)
+    return UINT32_MAX;
+
+  /* A degenerate face can hold both directions; list it once */
+  uint32_t count = 0;
+  for (int dir = 0; dir < 2; dir++) {
+    for (uint32_t h = dir ? mop_topology_find(t, v1, v0)
+                          : mop_topology_find(t, v0, v1);
+         h != MOP_INVALID_HE; h = t->same[h]) {
+      bool dup = false;
+      for (uint32_t i = 0; i < count; i++)
+        dup |= hes[i] / 3 == h / 3;
+      if (!dup)
+        hes[count++] = h;
     }
   }
+  *he_out = hes;
+  return count;
+}
+
+/* -------------------------------------------------------------------------
+ * Localized uploads
+ *
+ * Edits upload only what they touch: rewritten vertices and faces go up
+ * one run of consecutive ids at a time, appended geometry as one range
+ * past the old end (mop_mesh_resize_geometry absorbs the growth).  Each
+ * operation's writes sit between mop_undo_geometry_begin and _end, which
+ * turn them into one undo entry.
+ * ------------------------------------------------------------------------- */
+
+typedef struct FacePatch {
+  uint32_t face;
+  uint32_t idx[3];
+} FacePatch;
+
+/* Faces per staged index upload */
+#define PATCH_RUN 64
+
+static int cmp_u32(const void *a, const void *b) {
+  uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+  return (x > y) - (x < y);
+}
+
+static int cmp_face_patch(const void *a, const void *b) {
+  return cmp_u32(&((const FacePatch *)a)->face, &((const FacePatch *)b)->face);
+}
+
+/* Sort ids and drop repeats; returns the new count */
+static uint32_t sort_unique(uint32_t *ids, uint32_t n) {
+  if (n == 0)
+    return 0;
+  qsort(ids, n, sizeof(uint32_t), cmp_u32);
+  uint32_t w = 1;
+  for (uint32_t i = 1; i < n; i++) {
+    if (ids[i] != ids[w - 1])
+      ids[w++] = ids[i];
+  }
+  return w;
+}
+
+/* Position of id in ascending ids, or UINT32_MAX */
+static uint32_t sorted_find(const uint32_t *ids, uint32_t n, uint32_t id) {
+  const uint32_t *p = bsearch(&id, ids, n, sizeof(uint32_t), cmp_u32);
+  return p ? (uint32_t)(p - ids) : UINT32_MAX;
+}
+
+/* Upload vals[i] to vertex ids[i] (ascending, unique), one buffer update
+ * per run of consecutive ids */
+static void patch_vertex_runs(MopMesh *mesh, MopViewport *vp,
+                              const uint32_t *ids, const MopVertex *vals,
+                              uint32_t n) {
+  for (uint32_t s = 0, e; s < n; s = e) {
+    for (e = s + 1; e < n && ids[e] == ids[e - 1] + 1; e++)
+      ;
+    mop_mesh_patch_vertices(mesh, vp, ids[s], &vals[s], e - s);
+  }
+}
+
+/* Rewrite faces in place (unique face ids, sorted here), one buffer
+ * update per run of consecutive faces */
+static void patch_faces(MopMesh *mesh, MopViewport *vp, FacePatch *p,
+                        uint32_t n) {
+  qsort(p, n, sizeof(FacePatch), cmp_face_patch);
+  uint32_t run[PATCH_RUN * 3];
+  for (uint32_t s = 0, e; s < n; s = e) {
+    memcpy(run, p[s].idx, sizeof(p[s].idx));
+    for (e = s + 1;
+         e < n && e - s < PATCH_RUN && p[e].face == p[e - 1].face + 1; e++)
+      memcpy(&run[(e - s) * 3], p[e].idx, sizeof(p[e].idx));
+    mop_mesh_patch_indices(mesh, vp, p[s].face * 3, run, (e - s) * 3);
+  }
+}
 
-  (void)vertex_count;
-  return edges;
+/* Relink the rewritten faces, then the appended tail */
+static bool topology_patch(MopMeshTopology *t, const FacePatch *p, uint32_t n,
+                           const uint32_t *tail, uint32_t tail_faces) {
+  if (!t)
+    return false;
+  for (uint32_t i = 0; i < n; i++) {
+    if (!mop_topology_set_faces(t, p[i].face, p[i].idx, 1))
+      return false;
+  }
+  return mop_topology_set_faces(t, t->face_count, tail, tail_faces);
 }
 
 /* -------------------------------------------------------------------------
@@ -98,45 +180,110 @@ void mop_mesh_move_vertices(MopMesh *mesh, MopViewport *vp,
                             MopVec3 delta) {
   if (!mesh || !vp || !indices || count == 0)
     return;
-  if (!mesh->vertex_buffer)
+  if (!mesh->vertex_buffer || mesh->vertex_format)
     return;
 
   const MopVertex *src =
       (const MopVertex *)vp->rhi->buffer_read(mesh->vertex_buffer);
   if (!src)
     return;
+  const uint32_t *idx_src = NULL;
+  if (mesh->index_buffer)
+    idx_src = (const uint32_t *)vp->rhi->buffer_read(mesh->index_buffer);
 
   uint32_t vc = mesh->vertex_count;
-  MopVertex *verts = (MopVertex *)malloc(vc * sizeof(MopVertex));
-  if (!verts)
+  uint32_t *moved = (uint32_t *)malloc(count * sizeof(uint32_t));
+  if (!moved)
     return;
-  memcpy(verts, src, vc * sizeof(MopVertex));
-
+  uint32_t n = 0;
   for (uint32_t i = 0; i < count; i++) {
-    uint32_t idx = indices[i];
-    if (idx < vc) {
-      verts[idx].position.x += delta.x;
-      verts[idx].position.y += delta.y;
-      verts[idx].position.z += delta.z;
+    if (indices[i] < vc)
+      moved[n++] = indices[i];
+  }
+  /* A vertex listed k times moves k * delta */
+  qsort(moved, n, sizeof(uint32_t), cmp_u32);
+
+  /* Dirty set: the moved vertices and every vertex sharing a face with
+   * one, whose normal depends on the moved positions */
+  MopMeshTopology *topo = topology_take(mesh, vp, idx_src, mesh->index_count);
+  uint32_t dirty_cap = n + 64;
+  uint32_t nd = 0;
+  uint32_t *dirty = (uint32_t *)malloc(dirty_cap * sizeof(uint32_t));
+  bool ok = dirty != NULL;
+  for (uint32_t i = 0; i < n && ok; i++) {
+    if (i > 0 && moved[i] == moved[i - 1])
+      continue;
+    dirty[nd++] = moved[i];
+    for (uint32_t h = topo ? mop_topology_first_out(topo, moved[i])
+                           : MOP_INVALID_HE;
+         h != MOP_INVALID_HE && ok; h = topo->out_next[h]) {
+      if (nd + 3 > dirty_cap) {
+        uint32_t *grown =
+            (uint32_t *)realloc(dirty, dirty_cap * 2 * sizeof(uint32_t));
+        ok = grown != NULL;
+        if (!ok)
+          break;
+        dirty = grown;
+        dirty_cap *= 2;
+      }
+      uint32_t base = h - h % 3;
+      for (uint32_t k = 0; k < 3; k++)
+        dirty[nd++] = topo->edges[base + k].vertex;
     }
   }
+  nd = ok ? sort_unique(dirty, nd) : 0;
+  MopVertex *vals = (MopVertex *)malloc((nd ? nd : 1) * sizeof(MopVertex));
+  if (!ok || !vals) {
+    free(moved);
+    free(dirty);
+    free(vals);
+    topology_keep(mesh, vp, topo, true);
+    return;
+  }
 
-  /* Read index data to pass through unchanged */
-  const uint32_t *idx_src = NULL;
-  if (mesh->index_buffer)
-    idx_src = (const uint32_t *)vp->rhi->buffer_read(mesh->index_buffer);
+  for (uint32_t i = 0; i < nd; i++)
+    vals[i] = src[dirty[i]];
+  for (uint32_t i = 0; i < n; i++) {
+    MopVertex *v = &vals[sorted_find(dirty, nd, moved[i])];
+    v->position = mop_vec3_add(v->position, delta);
+  }
 
-  if (idx_src) {
-    mop_mesh_update_geometry(mesh, vp, verts, vc, idx_src, mesh->index_count);
+  /* Area-weighted normals over the faces around each dirty vertex */
+  for (uint32_t i = 0; topo && i < nd; i++) {
+    MopVec3 sum = {0, 0, 0};
+    for (uint32_t h = mop_topology_first_out(topo, dirty[i]);
+         h != MOP_INVALID_HE; h = topo->out_next[h]) {
+      uint32_t base = h - h % 3;
+      MopVec3 p[3];
+      for (uint32_t k = 0; k < 3; k++) {
+        uint32_t c = topo->edges[base + k].vertex;
+        uint32_t d = sorted_find(dirty, nd, c);
+        p[k] = d != UINT32_MAX ? vals[d].position : src[c].position;
+      }
+      sum = mop_vec3_add(sum, mop_vec3_cross(mop_vec3_sub(p[1], p[0]),
+                                             mop_vec3_sub(p[2], p[0])));
+    }
+    if (mop_vec3_length(sum) > 1e-12f)
+      vals[i].normal = mop_vec3_normalize(sum);
   }
-  free(verts);
+
+  MOP_VP_LOCK(vp);
+  mop_undo_geometry_begin(vp, mesh);
+  patch_vertex_runs(mesh, vp, dirty, vals, nd);
+  mop_undo_geometry_end(vp, mesh);
+  MOP_VP_UNLOCK(vp);
+  topology_keep(mesh, vp, topo, true);
+
+  free(moved);
+  free(dirty);
+  free(vals);
 }
 
 void mop_mesh_delete_vertices(MopMesh *mesh, MopViewport *vp,
                               const uint32_t *indices, uint32_t count) {
   if (!mesh || !vp || !indices || count == 0)
     return;
-  if (!mesh->vertex_buffer || !mesh->index_buffer)
+  if (!mesh->vertex_buffer || !mesh->index_buffer || mesh->vertex_format)
     return;
 
   const MopVertex *src =
@@ -218,7 +365,11 @@ void mop_mesh_delete_vertices(MopMesh *mesh, MopViewport *vp,
   }
 
   if (new_vc > 0 && new_ic > 0) {
+    MOP_VP_LOCK(vp);
+    mop_undo_geometry_begin(vp, mesh);
     mop_mesh_update_geometry(mesh, vp, new_verts, new_vc, new_indices, new_ic);
+    mop_undo_geometry_end(vp, mesh);
+    MOP_VP_UNLOCK(vp);
   }
 
   free(deleted);
@@ -231,7 +382,7 @@ void mop_mesh_merge_vertices(MopMesh *mesh, MopViewport *vp, uint32_t v0,
                              uint32_t v1) {
   if (!mesh || !vp)
     return;
-  if (!mesh->vertex_buffer || !mesh->index_buffer)
+  if (!mesh->vertex_buffer || !mesh->index_buffer || mesh->vertex_format)
     return;
   if (v0 == v1)
     return;
@@ -346,7 +497,11 @@ void mop_mesh_merge_vertices(MopMesh *mesh, MopViewport *vp, uint32_t v0,
   }
 
   if (new_vc > 0 && new_ic > 0) {
+    MOP_VP_LOCK(vp);
+    mop_undo_geometry_begin(vp, mesh);
     mop_mesh_update_geometry(mesh, vp, final_verts, new_vc, clean_idx, new_ic);
+    mop_undo_geometry_end(vp, mesh);
+    MOP_VP_UNLOCK(vp);
   }
 
   free(verts);
@@ -364,7 +519,7 @@ void mop_mesh_split_edge(MopMesh *mesh, MopViewport *vp, uint32_t edge_v0,
                          uint32_t edge_v1) {
   if (!mesh || !vp)
     return;
-  if (!mesh->vertex_buffer || !mesh->index_buffer)
+  if (!mesh->vertex_buffer || !mesh->index_buffer || mesh->vertex_format)
     return;
 
   const MopVertex *src =
@@ -405,90 +560,117 @@ void mop_mesh_split_edge(MopMesh *mesh, MopViewport *vp, uint32_t edge_v0,
 
   uint32_t mid_idx = vc; /* index of the new vertex */
 
-  /* New vertex array: original + 1 new */
-  uint32_t new_vc = vc + 1;
-  MopVertex *new_verts = (MopVertex *)malloc(new_vc * sizeof(MopVertex));
-  if (!new_verts)
+  MopMeshTopology *topo = topology_take(mesh, vp, idx_src, ic);
+  if (!topo)
+    return;
+  uint32_t *hes;
+  uint32_t split = topology_edge_faces(topo, edge_v0, edge_v1, &hes);
+  if (split == UINT32_MAX) {
+    mop_topology_free(topo);
     return;
-  memcpy(new_verts, src, vc * sizeof(MopVertex));
-  new_verts[mid_idx] = mid_vert;
+  }
 
-  /* For each triangle containing the edge (v0,v1), split into 2 triangles.
-   * Max new indices: original + 3 per split face (each split adds 1 face = 3
-   * more indices) */
-  uint32_t face_count = ic / 3;
-  uint32_t max_new_ic = ic + face_count * 3; /* upper bound */
-  uint32_t *new_indices = (uint32_t *)malloc(max_new_ic * sizeof(uint32_t));
-  if (!new_indices) {
-    free(new_verts);
+  /* Each split face is rewritten in place and its second half appended,
+   * so the indices of every existing face stay put */
+  FacePatch *first = (FacePatch *)malloc((split ? split : 1) *
+                                         sizeof(FacePatch));
+  uint32_t *second = (uint32_t *)malloc((split ? split : 1) * 3 *
+                                        sizeof(uint32_t));
+  if (!first || !second) {
+    free(first);
+    free(second);
+    free(hes);
+    mop_topology_free(topo);
     return;
   }
 
-  uint32_t new_ic = 0;
-  for (uint32_t f = 0; f < face_count; f++) {
-    uint32_t i0 = idx_src[f * 3 + 0];
-    uint32_t i1 = idx_src[f * 3 + 1];
-    uint32_t i2 = idx_src[f * 3 + 2];
+  for (uint32_t i = 0; i < split; i++) {
+    /* The edge is tri[e] -> tri[e + 1], tri[e + 2] is opposite */
+    uint32_t f = hes[i] / 3;
+    uint32_t e = hes[i] % 3;
+    uint32_t va = idx_src[f * 3 + e];
+    uint32_t vb = idx_src[f * 3 + (e + 1) % 3];
+    uint32_t vc_opp = idx_src[f * 3 + (e + 2) % 3];
+
+    /* Triangle 1: va, mid, vc_opp */
+    first[i] = (FacePatch){f, {va, mid_idx, vc_opp}};
+
+    /* Triangle 2: mid, vb, vc_opp */
+    second[i * 3 + 0] = mid_idx;
+    second[i * 3 + 1] = vb;
+    second[i * 3 + 2] = vc_opp;
+  }
 
-    /* Check if this face contains edge (edge_v0, edge_v1) */
-    int edge_local = -1; /* which edge of the triangle: 0=(i0,i1), 1=(i1,i2),
-                            2=(i2,i0) */
-    uint32_t tri[3] = {i0, i1, i2};
-    for (int e = 0; e < 3; e++) {
-      uint32_t ea = tri[e];
-      uint32_t eb = tri[(e + 1) % 3];
-      if ((ea == edge_v0 && eb == edge_v1) ||
-          (ea == edge_v1 && eb == edge_v0)) {
-        edge_local = e;
-        break;
-      }
-    }
+  bool valid = topology_patch(topo, first, split, second, split);
 
-    if (edge_local < 0) {
-      /* Face doesn't contain the edge — keep as-is */
-      new_indices[new_ic + 0] = i0;
-      new_indices[new_ic + 1] = i1;
-      new_indices[new_ic + 2] = i2;
-      new_ic += 3;
-    } else {
-      /* Split the face into two triangles.
-       * Edge is tri[edge_local] -> tri[(edge_local+1)%3].
-       * Opposite vertex is tri[(edge_local+2)%3]. */
-      uint32_t va = tri[edge_local];
-      uint32_t vb = tri[(edge_local + 1) % 3];
-      uint32_t vc_opp = tri[(edge_local + 2) % 3];
-
-      /* Triangle 1: va, mid, vc_opp */
-      new_indices[new_ic + 0] = va;
-      new_indices[new_ic + 1] = mid_idx;
-      new_indices[new_ic + 2] = vc_opp;
-      new_ic += 3;
-
-      /* Triangle 2: mid, vb, vc_opp */
-      new_indices[new_ic + 0] = mid_idx;
-      new_indices[new_ic + 1] = vb;
-      new_indices[new_ic + 2] = vc_opp;
-      new_ic += 3;
-    }
+  MOP_VP_LOCK(vp);
+  mop_undo_geometry_begin(vp, mesh);
+  if (mop_mesh_resize_geometry(mesh, vp, vc + 1, ic + split * 3)) {
+    mop_mesh_patch_vertices(mesh, vp, mid_idx, &mid_vert, 1);
+    mop_mesh_patch_indices(mesh, vp, ic, second, split * 3);
+    patch_faces(mesh, vp, first, split);
+  } else {
+    valid = false;
   }
+  mop_undo_geometry_end(vp, mesh);
+  MOP_VP_UNLOCK(vp);
+  topology_keep(mesh, vp, topo, valid);
 
-  mop_mesh_update_geometry(mesh, vp, new_verts, new_vc, new_indices, new_ic);
-  free(new_verts);
-  free(new_indices);
+  free(first);
+  free(second);
+  free(hes);
+}
+
+/* Drop the flagged faces, shifting the rest down, and upload the index
+ * buffer from the first dropped face on.  Returns false if nothing was
+ * dropped or the mesh would be left empty (the mesh is then unchanged). */
+static bool remove_faces(MopMesh *mesh, MopViewport *vp,
+                         const uint32_t *idx_src, uint32_t ic,
+                         const bool *del) {
+  uint32_t face_count = ic / 3;
+  uint32_t first = 0;
+  while (first < face_count && !del[first])
+    first++;
+  if (first == face_count)
+    return false;
+
+  uint32_t *tail = (uint32_t *)malloc((face_count - first) * 3 *
+                                      sizeof(uint32_t));
+  if (!tail)
+    return false;
+  uint32_t n = 0;
+  for (uint32_t f = first; f < face_count; f++) {
+    if (del[f])
+      continue;
+    memcpy(&tail[n], &idx_src[f * 3], 3 * sizeof(uint32_t));
+    n += 3;
+  }
+
+  bool done = false;
+  MOP_VP_LOCK(vp);
+  mop_undo_geometry_begin(vp, mesh);
+  if (first * 3 + n > 0 &&
+      mop_mesh_resize_geometry(mesh, vp, mesh->vertex_count, first * 3 + n)) {
+    if (n > 0)
+      mop_mesh_patch_indices(mesh, vp, first * 3, tail, n);
+    done = true;
+  }
+  mop_undo_geometry_end(vp, mesh);
+  MOP_VP_UNLOCK(vp);
+  free(tail);
+  return done;
 }
 
 void mop_mesh_dissolve_edge(MopMesh *mesh, MopViewport *vp, uint32_t edge_v0,
                             uint32_t edge_v1) {
   if (!mesh || !vp)
     return;
-  if (!mesh->vertex_buffer || !mesh->index_buffer)
+  if (!mesh->vertex_buffer || !mesh->index_buffer || mesh->vertex_format)
     return;
 
-  const MopVertex *src =
-      (const MopVertex *)vp->rhi->buffer_read(mesh->vertex_buffer);
   const uint32_t *idx_src =
       (const uint32_t *)vp->rhi->buffer_read(mesh->index_buffer);
-  if (!src || !idx_src)
+  if (!idx_src)
     return;
 
   uint32_t vc = mesh->vertex_count;
@@ -497,53 +679,30 @@ void mop_mesh_dissolve_edge(MopMesh *mesh, MopViewport *vp, uint32_t edge_v0,
   if (edge_v0 >= vc || edge_v1 >= vc)
     return;
 
-  /* Remove all faces that contain the edge (edge_v0, edge_v1) */
-  uint32_t face_count = ic / 3;
-  uint32_t *new_indices = (uint32_t *)malloc(ic * sizeof(uint32_t));
-  if (!new_indices)
+  MopMeshTopology *topo = topology_take(mesh, vp, idx_src, ic);
+  if (!topo)
     return;
-
-  uint32_t new_ic = 0;
-  for (uint32_t f = 0; f < face_count; f++) {
-    uint32_t i0 = idx_src[f * 3 + 0];
-    uint32_t i1 = idx_src[f * 3 + 1];
-    uint32_t i2 = idx_src[f * 3 + 2];
-
-    /* Check if face contains the edge */
-    bool has_edge = false;
-    uint32_t tri[3] = {i0, i1, i2};
-    for (int e = 0; e < 3; e++) {
-      uint32_t ea = tri[e];
-      uint32_t eb = tri[(e + 1) % 3];
-      if ((ea == edge_v0 && eb == edge_v1) ||
-          (ea == edge_v1 && eb == edge_v0)) {
-        has_edge = true;
-        break;
-      }
-    }
-
-    if (!has_edge) {
-      new_indices[new_ic + 0] = i0;
-      new_indices[new_ic + 1] = i1;
-      new_indices[new_ic + 2] = i2;
-      new_ic += 3;
-    }
-  }
-
-  /* Copy vertices unchanged */
-  MopVertex *new_verts = (MopVertex *)malloc(vc * sizeof(MopVertex));
-  if (!new_verts) {
-    free(new_indices);
+  uint32_t *hes;
+  uint32_t hit = topology_edge_faces(topo, edge_v0, edge_v1, &hes);
+  bool *del = (bool *)calloc(ic / 3 ? ic / 3 : 1, sizeof(bool));
+  if (hit == UINT32_MAX || !del) {
+    free(hes);
+    free(del);
+    mop_topology_free(topo);
     return;
   }
-  memcpy(new_verts, src, vc * sizeof(MopVertex));
 
-  if (new_ic > 0) {
-    mop_mesh_update_geometry(mesh, vp, new_verts, vc, new_indices, new_ic);
-  }
+  /* Remove all faces that contain the edge (edge_v0, edge_v1) */
+  for (uint32_t i = 0; i < hit; i++)
+    del[hes[i] / 3] = true;
 
-  free(new_verts);
-  free(new_indices);
+  bool valid = true;
+  if (remove_faces(mesh, vp, idx_src, ic, del))
+    valid = mop_topology_remove_faces(topo, del);
+  topology_keep(mesh, vp, topo, valid);
+
+  free(hes);
+  free(del);
 }
 
 /* -------------------------------------------------------------------------
@@ -555,7 +714,7 @@ void mop_mesh_extrude_faces(MopMesh *mesh, MopViewport *vp,
                             float distance) {
   if (!mesh || !vp || !face_indices || count == 0)
     return;
-  if (!mesh->vertex_buffer || !mesh->index_buffer)
+  if (!mesh->vertex_buffer || !mesh->index_buffer || mesh->vertex_format)
     return;
 
   const MopVertex *src =
@@ -574,37 +733,39 @@ void mop_mesh_extrude_faces(MopMesh *mesh, MopViewport *vp,
   if (!extrude_flag)
     return;
 
+  uint32_t extruded_count = 0;
   for (uint32_t i = 0; i < count; i++) {
-    if (face_indices[i] < face_count)
-      extrude_flag[face_indices[i]] = true;
+    uint32_t f = face_indices[i];
+    if (f < face_count && !extrude_flag[f]) {
+      extrude_flag[f] = true;
+      extruded_count++;
+    }
+  }
+  if (extruded_count == 0) {
+    free(extrude_flag);
+    return;
   }
 
   /* For each extruded face, we duplicate its 3 vertices (offset by normal *
    * distance), replace the original face indices to use the new vertices, and
-   * create 3 side-wall quads (6 triangles). */
-
-  /* Upper bound: original verts + 3 per extruded face */
-  uint32_t max_new_vc = vc + count * 3;
-  /* Upper bound: original indices + 18 per extruded face (3 quads * 2 tris * 3
-   * indices) */
-  uint32_t max_new_ic = ic + count * 18;
-
-  MopVertex *new_verts = (MopVertex *)malloc(max_new_vc * sizeof(MopVertex));
-  uint32_t *new_indices = (uint32_t *)malloc(max_new_ic * sizeof(uint32_t));
-  if (!new_verts || !new_indices) {
+   * create 3 side-wall quads (6 triangles).  Only the new vertices, the
+   * rewritten faces and the new walls are uploaded. */
+  MopVertex *new_verts =
+      (MopVertex *)malloc(extruded_count * 3 * sizeof(MopVertex));
+  uint32_t *new_indices =
+      (uint32_t *)malloc(extruded_count * 18 * sizeof(uint32_t));
+  FacePatch *caps = (FacePatch *)malloc(extruded_count * sizeof(FacePatch));
+  if (!new_verts || !new_indices || !caps) {
     free(extrude_flag);
     free(new_verts);
     free(new_indices);
+    free(caps);
     return;
   }
 
-  /* Copy original vertices */
-  memcpy(new_verts, src, vc * sizeof(MopVertex));
   uint32_t cur_vc = vc;
-
-  /* Copy original indices */
-  memcpy(new_indices, idx_src, ic * sizeof(uint32_t));
-  uint32_t cur_ic = ic;
+  uint32_t added_ic = 0;
+  uint32_t cap_count = 0;
 
   for (uint32_t f = 0; f < face_count; f++) {
     if (!extrude_flag[f])
@@ -629,18 +790,17 @@ void mop_mesh_extrude_faces(MopMesh *mesh, MopViewport *vp,
     uint32_t ni1 = cur_vc + 1;
     uint32_t ni2 = cur_vc + 2;
 
-    new_verts[ni0] = src[i0];
-    new_verts[ni0].position = mop_vec3_add(src[i0].position, offset);
-    new_verts[ni1] = src[i1];
-    new_verts[ni1].position = mop_vec3_add(src[i1].position, offset);
-    new_verts[ni2] = src[i2];
-    new_verts[ni2].position = mop_vec3_add(src[i2].position, offset);
+    MopVertex *nv = &new_verts[cur_vc - vc];
+    nv[0] = src[i0];
+    nv[0].position = mop_vec3_add(src[i0].position, offset);
+    nv[1] = src[i1];
+    nv[1].position = mop_vec3_add(src[i1].position, offset);
+    nv[2] = src[i2];
+    nv[2].position = mop_vec3_add(src[i2].position, offset);
     cur_vc += 3;
 
     /* Replace the original face to use new (extruded) vertices */
-    new_indices[f * 3 + 0] = ni0;
-    new_indices[f * 3 + 1] = ni1;
-    new_indices[f * 3 + 2] = ni2;
+    caps[cap_count++] = (FacePatch){f, {ni0, ni1, ni2}};
 
     /* Create 3 side-wall quads (each as 2 triangles).
      * Edge 0: i0-i1 to ni0-ni1
@@ -656,23 +816,38 @@ void mop_mesh_extrude_faces(MopMesh *mesh, MopViewport *vp,
       uint32_t nb = extruded[(e + 1) % 3];
 
       /* Quad: a, b, nb, na — as 2 triangles */
-      new_indices[cur_ic + 0] = a;
-      new_indices[cur_ic + 1] = b;
-      new_indices[cur_ic + 2] = nb;
-      cur_ic += 3;
-
-      new_indices[cur_ic + 0] = a;
-      new_indices[cur_ic + 1] = nb;
-      new_indices[cur_ic + 2] = na;
-      cur_ic += 3;
+      new_indices[added_ic + 0] = a;
+      new_indices[added_ic + 1] = b;
+      new_indices[added_ic + 2] = nb;
+      added_ic += 3;
+
+      new_indices[added_ic + 0] = a;
+      new_indices[added_ic + 1] = nb;
+      new_indices[added_ic + 2] = na;
+      added_ic += 3;
     }
   }
 
-  mop_mesh_update_geometry(mesh, vp, new_verts, cur_vc, new_indices, cur_ic);
+  MopMeshTopology *topo = topology_take(mesh, vp, idx_src, ic);
+  bool valid = topology_patch(topo, caps, cap_count, new_indices, added_ic / 3);
+
+  MOP_VP_LOCK(vp);
+  mop_undo_geometry_begin(vp, mesh);
+  if (mop_mesh_resize_geometry(mesh, vp, cur_vc, ic + added_ic)) {
+    mop_mesh_patch_vertices(mesh, vp, vc, new_verts, cur_vc - vc);
+    mop_mesh_patch_indices(mesh, vp, ic, new_indices, added_ic);
+    patch_faces(mesh, vp, caps, cap_count);
+  } else {
+    valid = false;
+  }
+  mop_undo_geometry_end(vp, mesh);
+  MOP_VP_UNLOCK(vp);
+  topology_keep(mesh, vp, topo, valid);
 
   free(extrude_flag);
   free(new_verts);
   free(new_indices);
+  free(caps);
 }
 
 void mop_mesh_inset_faces(MopMesh *mesh, MopViewport *vp,
@@ -680,7 +855,7 @@ void mop_mesh_inset_faces(MopMesh *mesh, MopViewport *vp,
                           float inset) {
   if (!mesh || !vp || !face_indices || count == 0)
     return;
-  if (!mesh->vertex_buffer || !mesh->index_buffer)
+  if (!mesh->vertex_buffer || !mesh->index_buffer || mesh->vertex_format)
     return;
 
   const MopVertex *src =
@@ -697,28 +872,28 @@ void mop_mesh_inset_faces(MopMesh *mesh, MopViewport *vp,
   /* For each inset face: create 3 new vertices (inset toward centroid),
    * replace original face with inset face, add 3 connecting quads */
 
-  /* Upper bound allocations */
-  uint32_t max_new_vc = vc + count * 3;
-  uint32_t max_new_ic = ic + count * 18;
-
-  MopVertex *new_verts = (MopVertex *)malloc(max_new_vc * sizeof(MopVertex));
-  uint32_t *new_indices = (uint32_t *)malloc(max_new_ic * sizeof(uint32_t));
-  if (!new_verts || !new_indices) {
+  /* Upper bound allocations, for the new geometry only */
+  MopVertex *new_verts = (MopVertex *)malloc(count * 3 * sizeof(MopVertex));
+  uint32_t *new_indices = (uint32_t *)malloc(count * 18 * sizeof(uint32_t));
+  FacePatch *caps = (FacePatch *)malloc(count * sizeof(FacePatch));
+  bool *seen = (bool *)calloc(face_count ? face_count : 1, sizeof(bool));
+  if (!new_verts || !new_indices || !caps || !seen) {
     free(new_verts);
     free(new_indices);
+    free(caps);
+    free(seen);
     return;
   }
 
-  memcpy(new_verts, src, vc * sizeof(MopVertex));
-  memcpy(new_indices, idx_src, ic * sizeof(uint32_t));
-
   uint32_t cur_vc = vc;
-  uint32_t cur_ic = ic;
+  uint32_t added_ic = 0;
+  uint32_t cap_count = 0;
 
   for (uint32_t fi = 0; fi < count; fi++) {
     uint32_t f = face_indices[fi];
-    if (f >= face_count)
+    if (f >= face_count || seen[f])
       continue;
+    seen[f] = true;
 
     uint32_t i0 = idx_src[f * 3 + 0];
     uint32_t i1 = idx_src[f * 3 + 1];
@@ -744,22 +919,21 @@ void mop_mesh_inset_faces(MopMesh *mesh, MopViewport *vp,
     uint32_t ni2 = cur_vc + 2;
 
     uint32_t orig_verts[3] = {i0, i1, i2};
+    MopVertex *nv = &new_verts[cur_vc - vc];
     for (int k = 0; k < 3; k++) {
       uint32_t oi = orig_verts[k];
-      new_verts[cur_vc + (uint32_t)k] = src[oi];
-      new_verts[cur_vc + (uint32_t)k].position.x =
+      nv[k] = src[oi];
+      nv[k].position.x =
           src[oi].position.x + (centroid.x - src[oi].position.x) * t;
-      new_verts[cur_vc + (uint32_t)k].position.y =
+      nv[k].position.y =
           src[oi].position.y + (centroid.y - src[oi].position.y) * t;
-      new_verts[cur_vc + (uint32_t)k].position.z =
+      nv[k].position.z =
           src[oi].position.z + (centroid.z - src[oi].position.z) * t;
     }
     cur_vc += 3;
 
     /* Replace the original face with the inset face */
-    new_indices[f * 3 + 0] = ni0;
-    new_indices[f * 3 + 1] = ni1;
-    new_indices[f * 3 + 2] = ni2;
+    caps[cap_count++] = (FacePatch){f, {ni0, ni1, ni2}};
 
     /* Create 3 connecting quads */
     uint32_t orig[3] = {i0, i1, i2};
@@ -771,29 +945,48 @@ void mop_mesh_inset_faces(MopMesh *mesh, MopViewport *vp,
       uint32_t na = inset_v[e];
       uint32_t nb = inset_v[(e + 1) % 3];
 
-      new_indices[cur_ic + 0] = a;
-      new_indices[cur_ic + 1] = b;
-      new_indices[cur_ic + 2] = nb;
-      cur_ic += 3;
+      new_indices[added_ic + 0] = a;
+      new_indices[added_ic + 1] = b;
+      new_indices[added_ic + 2] = nb;
+      added_ic += 3;
 
-      new_indices[cur_ic + 0] = a;
-      new_indices[cur_ic + 1] = nb;
-      new_indices[cur_ic + 2] = na;
-      cur_ic += 3;
+      new_indices[added_ic + 0] = a;
+      new_indices[added_ic + 1] = nb;
+      new_indices[added_ic + 2] = na;
+      added_ic += 3;
     }
   }
 
-  mop_mesh_update_geometry(mesh, vp, new_verts, cur_vc, new_indices, cur_ic);
+  if (cap_count > 0) {
+    MopMeshTopology *topo = topology_take(mesh, vp, idx_src, ic);
+    bool valid =
+        topology_patch(topo, caps, cap_count, new_indices, added_ic / 3);
+
+    MOP_VP_LOCK(vp);
+    mop_undo_geometry_begin(vp, mesh);
+    if (mop_mesh_resize_geometry(mesh, vp, cur_vc, ic + added_ic)) {
+      mop_mesh_patch_vertices(mesh, vp, vc, new_verts, cur_vc - vc);
+      mop_mesh_patch_indices(mesh, vp, ic, new_indices, added_ic);
+      patch_faces(mesh, vp, caps, cap_count);
+    } else {
+      valid = false;
+    }
+    mop_undo_geometry_end(vp, mesh);
+    MOP_VP_UNLOCK(vp);
+    topology_keep(mesh, vp, topo, valid);
+  }
 
   free(new_verts);
   free(new_indices);
+  free(caps);
+  free(seen);
 }
 
 void mop_mesh_delete_faces(MopMesh *mesh, MopViewport *vp,
                            const uint32_t *face_indices, uint32_t count) {
   if (!mesh || !vp || !face_indices || count == 0)
     return;
-  if (!mesh->vertex_buffer || !mesh->index_buffer)
+  if (!mesh->vertex_buffer || !mesh->index_buffer || mesh->vertex_format)
     return;
 
   const MopVertex *src =
@@ -817,9 +1010,9 @@ void mop_mesh_delete_faces(MopMesh *mesh, MopViewport *vp,
       del[face_indices[i]] = true;
   }
 
-  /* Build new index array without deleted faces */
-  uint32_t *new_indices = (uint32_t *)malloc(ic * sizeof(uint32_t));
-  if (!new_indices) {
+  /* Find referenced vertices */
+  bool *referenced = (bool *)calloc(vc, sizeof(bool));
+  if (!referenced) {
     free(del);
     return;
   }
@@ -828,66 +1021,72 @@ void mop_mesh_delete_faces(MopMesh *mesh, MopViewport *vp,
   for (uint32_t f = 0; f < face_count; f++) {
     if (del[f])
       continue;
-    new_indices[new_ic + 0] = idx_src[f * 3 + 0];
-    new_indices[new_ic + 1] = idx_src[f * 3 + 1];
-    new_indices[new_ic + 2] = idx_src[f * 3 + 2];
+    for (uint32_t k = 0; k < 3; k++) {
+      if (idx_src[f * 3 + k] < vc)
+        referenced[idx_src[f * 3 + k]] = true;
+    }
     new_ic += 3;
   }
 
-  /* Find referenced vertices */
-  bool *referenced = (bool *)calloc(vc, sizeof(bool));
-  if (!referenced) {
+  uint32_t new_vc = 0;
+  for (uint32_t i = 0; i < vc; i++)
+    new_vc += referenced[i];
+
+  /* Without orphaned vertices the ids hold: only the index buffer from
+   * the first deleted face on changes, and the adjacency only loses
+   * faces */
+  if (new_vc == vc) {
+    MopMeshTopology *topo = topology_take(mesh, vp, idx_src, ic);
+    bool valid = topo != NULL;
+    if (remove_faces(mesh, vp, idx_src, ic, del))
+      valid = valid && mop_topology_remove_faces(topo, del);
+    topology_keep(mesh, vp, topo, valid);
     free(del);
-    free(new_indices);
+    free(referenced);
     return;
   }
 
-  for (uint32_t i = 0; i < new_ic; i++) {
-    if (new_indices[i] < vc)
-      referenced[new_indices[i]] = true;
-  }
-
-  /* Build vertex remap */
+  /* Otherwise compact the vertices, which renumbers them: rebuild both
+   * arrays and let the upload drop the adjacency */
+  uint32_t *new_indices = (uint32_t *)malloc(ic * sizeof(uint32_t));
   uint32_t *remap = (uint32_t *)malloc(vc * sizeof(uint32_t));
-  if (!remap) {
+  MopVertex *new_verts =
+      (MopVertex *)malloc((new_vc ? new_vc : 1) * sizeof(MopVertex));
+  if (!new_indices || !remap || !new_verts) {
     free(del);
-    free(new_indices);
     free(referenced);
+    free(new_indices);
+    free(remap);
+    free(new_verts);
     return;
   }
 
-  uint32_t new_vc = 0;
+  new_vc = 0;
   for (uint32_t i = 0; i < vc; i++) {
     if (referenced[i]) {
       remap[i] = new_vc;
-      new_vc++;
+      new_verts[new_vc++] = src[i];
     } else {
       remap[i] = UINT32_MAX;
     }
   }
 
-  /* Build compacted vertex array */
-  MopVertex *new_verts = (MopVertex *)malloc(new_vc * sizeof(MopVertex));
-  if (!new_verts) {
-    free(del);
-    free(new_indices);
-    free(referenced);
-    free(remap);
-    return;
-  }
-
-  for (uint32_t i = 0; i < vc; i++) {
-    if (referenced[i])
-      new_verts[remap[i]] = src[i];
-  }
-
-  /* Remap indices */
-  for (uint32_t i = 0; i < new_ic; i++) {
-    new_indices[i] = remap[new_indices[i]];
+  new_ic = 0;
+  for (uint32_t f = 0; f < face_count; f++) {
+    if (del[f])
+      continue;
+    new_indices[new_ic + 0] = remap[idx_src[f * 3 + 0]];
+    new_indices[new_ic + 1] = remap[idx_src[f * 3 + 1]];
+    new_indices[new_ic + 2] = remap[idx_src[f * 3 + 2]];
+    new_ic += 3;
   }
 
   if (new_vc > 0 && new_ic > 0) {
+    MOP_VP_LOCK(vp);
+    mop_undo_geometry_begin(vp, mesh);
     mop_mesh_update_geometry(mesh, vp, new_verts, new_vc, new_indices, new_ic);
+    mop_undo_geometry_end(vp, mesh);
+    MOP_VP_UNLOCK(vp);
   }
 
   free(del);
@@ -901,7 +1100,7 @@ void mop_mesh_flip_normals(MopMesh *mesh, MopViewport *vp,
                            const uint32_t *face_indices, uint32_t count) {
   if (!mesh || !vp || !face_indices || count == 0)
     return;
-  if (!mesh->vertex_buffer || !mesh->index_buffer)
+  if (!mesh->vertex_buffer || !mesh->index_buffer || mesh->vertex_format)
     return;
 
   const MopVertex *src =
@@ -915,51 +1114,73 @@ void mop_mesh_flip_normals(MopMesh *mesh, MopViewport *vp,
   uint32_t ic = mesh->index_count;
   uint32_t face_count = ic / 3;
 
-  MopVertex *new_verts = (MopVertex *)malloc(vc * sizeof(MopVertex));
-  uint32_t *new_indices = (uint32_t *)malloc(ic * sizeof(uint32_t));
-  if (!new_verts || !new_indices) {
-    free(new_verts);
-    free(new_indices);
+  /* A face listed twice flips back, and every listing negates the normals
+   * of its vertices once, so only odd counts change anything */
+  uint32_t *faces = (uint32_t *)malloc(count * sizeof(uint32_t));
+  uint32_t *verts = (uint32_t *)malloc(count * 3 * sizeof(uint32_t));
+  FacePatch *patch = (FacePatch *)malloc(count * sizeof(FacePatch));
+  MopVertex *vals = (MopVertex *)malloc(count * 3 * sizeof(MopVertex));
+  if (!faces || !verts || !patch || !vals) {
+    free(faces);
+    free(verts);
+    free(patch);
+    free(vals);
     return;
   }
 
-  memcpy(new_verts, src, vc * sizeof(MopVertex));
-  memcpy(new_indices, idx_src, ic * sizeof(uint32_t));
-
+  uint32_t nf = 0, nv = 0;
   for (uint32_t fi = 0; fi < count; fi++) {
     uint32_t f = face_indices[fi];
     if (f >= face_count)
       continue;
-
-    /* Reverse winding order: swap indices 1 and 2 */
-    uint32_t tmp = new_indices[f * 3 + 1];
-    new_indices[f * 3 + 1] = new_indices[f * 3 + 2];
-    new_indices[f * 3 + 2] = tmp;
-
-    /* Negate normals of the face's vertices */
-    uint32_t i0 = new_indices[f * 3 + 0];
-    uint32_t i1 = new_indices[f * 3 + 1];
-    uint32_t i2 = new_indices[f * 3 + 2];
-
-    if (i0 < vc) {
-      new_verts[i0].normal.x = -new_verts[i0].normal.x;
-      new_verts[i0].normal.y = -new_verts[i0].normal.y;
-      new_verts[i0].normal.z = -new_verts[i0].normal.z;
-    }
-    if (i1 < vc) {
-      new_verts[i1].normal.x = -new_verts[i1].normal.x;
-      new_verts[i1].normal.y = -new_verts[i1].normal.y;
-      new_verts[i1].normal.z = -new_verts[i1].normal.z;
-    }
-    if (i2 < vc) {
-      new_verts[i2].normal.x = -new_verts[i2].normal.x;
-      new_verts[i2].normal.y = -new_verts[i2].normal.y;
-      new_verts[i2].normal.z = -new_verts[i2].normal.z;
+    faces[nf++] = f;
+    for (uint32_t k = 0; k < 3; k++) {
+      if (idx_src[f * 3 + k] < vc)
+        verts[nv++] = idx_src[f * 3 + k];
     }
   }
+  qsort(faces, nf, sizeof(uint32_t), cmp_u32);
+  qsort(verts, nv, sizeof(uint32_t), cmp_u32);
+
+  /* Reverse winding order: swap indices 1 and 2 */
+  uint32_t np = 0;
+  for (uint32_t s = 0, e; s < nf; s = e) {
+    for (e = s + 1; e < nf && faces[e] == faces[s]; e++)
+      ;
+    if ((e - s) % 2 == 0)
+      continue;
+    const uint32_t *tri = &idx_src[faces[s] * 3];
+    patch[np++] = (FacePatch){faces[s], {tri[0], tri[2], tri[1]}};
+  }
 
-  mop_mesh_update_geometry(mesh, vp, new_verts, vc, new_indices, ic);
+  /* Negate normals of the face's vertices */
+  uint32_t nn = 0;
+  for (uint32_t s = 0, e; s < nv; s = e) {
+    for (e = s + 1; e < nv && verts[e] == verts[s]; e++)
+      ;
+    if ((e - s) % 2 == 0)
+      continue;
+    MopVertex v = src[verts[s]];
+    v.normal.x = -v.normal.x;
+    v.normal.y = -v.normal.y;
+    v.normal.z = -v.normal.z;
+    verts[nn] = verts[s];
+    vals[nn++] = v;
+  }
 
-  free(new_verts);
-  free(new_indices);
+  MopMeshTopology *topo = topology_take(mesh, vp, np ? idx_src : NULL, ic);
+  bool valid = np == 0 || topology_patch(topo, patch, np, NULL, 0);
+
+  MOP_VP_LOCK(vp);
+  mop_undo_geometry_begin(vp, mesh);
+  patch_vertex_runs(mesh, vp, verts, vals, nn);
+  patch_faces(mesh, vp, patch, np);
+  mop_undo_geometry_end(vp, mesh);
+  MOP_VP_UNLOCK(vp);
+  topology_keep(mesh, vp, topo, valid);
+
+  free(faces);
+  free(verts);
+  free(patch);
+  free(vals);
 }
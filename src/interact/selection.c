@@ -5,9 +5,12 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include "core/pick_bvh.h"
+#include "core/thread_pool.h"
 #include "core/viewport_internal.h"
 #include <mop/mop.h>
 
+#include <float.h>
 #include <math.h>
 #include <string.h>
 
@@ -44,20 +47,8 @@ void mop_viewport_select_element(MopViewport *vp, uint32_t element_index) {
     return;
   MOP_VP_LOCK(vp);
   MopSelection *sel = &vp->selection;
-
-  /* Check if already selected */
-  for (uint32_t i = 0; i < sel->element_count; i++) {
-    if (sel->elements[i] == element_index) {
-      MOP_VP_UNLOCK(vp);
-      return;
-    }
-  }
-
-  /* Add if not at max */
-  if (sel->element_count < sel->element_capacity) {
-    sel->elements[sel->element_count] = element_index;
-    sel->element_count++;
-  }
+  mop_id_list_add(&vp->element_set, &sel->elements, &sel->element_count,
+                  &sel->element_capacity, element_index);
   MOP_VP_UNLOCK(vp);
 }
 
@@ -66,15 +57,8 @@ void mop_viewport_deselect_element(MopViewport *vp, uint32_t element_index) {
     return;
   MOP_VP_LOCK(vp);
   MopSelection *sel = &vp->selection;
-
-  for (uint32_t i = 0; i < sel->element_count; i++) {
-    if (sel->elements[i] == element_index) {
-      /* Swap with last and shrink */
-      sel->elements[i] = sel->elements[sel->element_count - 1];
-      sel->element_count--;
-      break;
-    }
-  }
+  mop_id_list_remove(&vp->element_set, sel->elements, &sel->element_count,
+                     element_index);
   MOP_VP_UNLOCK(vp);
 }
 
@@ -83,6 +67,7 @@ void mop_viewport_clear_selection(MopViewport *vp) {
     return;
   MOP_VP_LOCK(vp);
   vp->selection.element_count = 0;
+  mop_id_set_clear(&vp->element_set);
   MOP_VP_UNLOCK(vp);
 }
 
@@ -91,23 +76,10 @@ void mop_viewport_toggle_element(MopViewport *vp, uint32_t element_index) {
     return;
   MOP_VP_LOCK(vp);
   MopSelection *sel = &vp->selection;
-
-  /* Check if present */
-  for (uint32_t i = 0; i < sel->element_count; i++) {
-    if (sel->elements[i] == element_index) {
-      /* Remove: swap with last */
-      sel->elements[i] = sel->elements[sel->element_count - 1];
-      sel->element_count--;
-      MOP_VP_UNLOCK(vp);
-      return;
-    }
-  }
-
-  /* Not present — add */
-  if (sel->element_count < sel->element_capacity) {
-    sel->elements[sel->element_count] = element_index;
-    sel->element_count++;
-  }
+  if (!mop_id_list_remove(&vp->element_set, sel->elements,
+                          &sel->element_count, element_index))
+    mop_id_list_add(&vp->element_set, &sel->elements, &sel->element_count,
+                    &sel->element_capacity, element_index);
   MOP_VP_UNLOCK(vp);
 }
 
@@ -115,6 +87,24 @@ void mop_viewport_toggle_element(MopViewport *vp, uint32_t element_index) {
  * Multi-object selection
  * ------------------------------------------------------------------------- */
 
+static void object_add(MopViewport *vp, uint32_t id) {
+  mop_id_list_add(&vp->selected_set, &vp->selected_ids, &vp->selected_count,
+                  &vp->selected_capacity, id);
+  vp->selected_id = vp->selected_count > 0 ? vp->selected_ids[0] : 0;
+}
+
+static void object_remove(MopViewport *vp, uint32_t id) {
+  mop_id_list_remove(&vp->selected_set, vp->selected_ids, &vp->selected_count,
+                     id);
+  vp->selected_id = vp->selected_count > 0 ? vp->selected_ids[0] : 0;
+}
+
+static void objects_clear(MopViewport *vp) {
+  vp->selected_count = 0;
+  vp->selected_id = 0;
+  mop_id_set_clear(&vp->selected_set);
+}
+
 void mop_viewport_select_object(MopViewport *vp, uint32_t id, bool additive) {
   if (!vp || id == 0)
     return;
@@ -122,31 +112,14 @@ void mop_viewport_select_object(MopViewport *vp, uint32_t id, bool additive) {
   MOP_VP_LOCK(vp);
   if (!additive) {
     /* Clear existing selection, then add */
-    vp->selected_count = 0;
-  }
-
-  /* Check if already selected */
-  for (uint32_t i = 0; i < vp->selected_count; i++) {
-    if (vp->selected_ids[i] == id) {
-      if (additive) {
-        /* Toggle: remove it */
-        vp->selected_ids[i] = vp->selected_ids[vp->selected_count - 1];
-        vp->selected_count--;
-        vp->selected_id = vp->selected_count > 0 ? vp->selected_ids[0] : 0;
-      }
-      MOP_VP_UNLOCK(vp);
-      return;
-    }
-  }
-
-  /* Add to selection */
-  if (vp->selected_count < vp->selected_capacity) {
-    vp->selected_ids[vp->selected_count] = id;
-    vp->selected_count++;
+    objects_clear(vp);
+  } else if (mop_id_set_contains(&vp->selected_set, id)) {
+    /* Toggle: remove it */
+    object_remove(vp, id);
+    MOP_VP_UNLOCK(vp);
+    return;
   }
-
-  /* Update backward-compat single-select field */
-  vp->selected_id = vp->selected_ids[0];
+  object_add(vp, id);
   MOP_VP_UNLOCK(vp);
 }
 
@@ -154,25 +127,14 @@ void mop_viewport_deselect_object(MopViewport *vp, uint32_t id) {
   if (!vp)
     return;
   MOP_VP_LOCK(vp);
-  for (uint32_t i = 0; i < vp->selected_count; i++) {
-    if (vp->selected_ids[i] == id) {
-      vp->selected_ids[i] = vp->selected_ids[vp->selected_count - 1];
-      vp->selected_count--;
-      vp->selected_id = vp->selected_count > 0 ? vp->selected_ids[0] : 0;
-      break;
-    }
-  }
+  object_remove(vp, id);
   MOP_VP_UNLOCK(vp);
 }
 
 bool mop_viewport_is_object_selected(const MopViewport *vp, uint32_t id) {
   if (!vp)
     return false;
-  for (uint32_t i = 0; i < vp->selected_count; i++) {
-    if (vp->selected_ids[i] == id)
-      return true;
-  }
-  return false;
+  return mop_id_set_contains(&vp->selected_set, id);
 }
 
 uint32_t mop_viewport_get_selected_count(const MopViewport *vp) {
@@ -238,98 +200,790 @@ float mop_selection_point_seg_dist_sq(float px, float py, float ax, float ay,
   return cx * cx + cy * cy;
 }
 
-/* Find the nearest vertex to a screen point within a pixel threshold.
- * Returns the vertex index, or UINT32_MAX if none found. */
-uint32_t mop_selection_pick_vertex(const MopViewport *vp, const MopMesh *mesh,
-                                   float screen_x, float screen_y,
-                                   float threshold_px) {
-  if (!vp || !mesh || !mesh->vertex_buffer)
-    return UINT32_MAX;
+/* -------------------------------------------------------------------------
+ * Accelerated vertex and edge picking
+ *
+ * The mesh's pick BVHs (core/pick_bvh.h) are walked nearest node first.
+ * A node's bound is the screen distance from the cursor to the rectangle
+ * of its 8 projected corners, so a hover visits only the nodes projecting
+ * within the threshold of the cursor, whatever the vertex count.  A node
+ * straddling the camera plane cannot be bounded and is always entered.
+ *
+ * A candidate only wins if the last rendered frame's depth buffer has no
+ * surface in front of it.  The depth of the element's own faces equals
+ * its depth up to rasterization error, hence the tolerance, and the
+ * farthest of a 3x3 pixel block is used so vertices and edges on a
+ * silhouette, half covered by the background, stay pickable.
+ * ------------------------------------------------------------------------- */
 
-  const MopVertex *verts =
-      (const MopVertex *)vp->rhi->buffer_read(mesh->vertex_buffer);
-  if (!verts)
-    return UINT32_MAX;
+typedef struct PickQuery {
+  MopViewport *vp;
+  const MopVertex *verts;
+  const uint32_t *indices;
+  MopMat4 mv;  /* local -> view, for candidate depth */
+  MopMat4 mvp; /* local -> clip */
+  float sx, sy;
+  float best_sq;
+  uint32_t best; /* vertex or half-edge */
+  /* Whole depth buffer when read back once for a region query; NULL
+   * samples it pixel by pixel */
+  const float *depth;
+  int depth_w, depth_h;
+} PickQuery;
+
+static void pick_query_init(PickQuery *q, MopViewport *vp, MopMesh *mesh,
+                            float screen_x, float screen_y,
+                            float threshold_px) {
+  q->vp = vp;
+  q->mv = mop_mat4_multiply(vp->view_matrix, mesh->world_transform);
+  q->mvp = mop_mat4_multiply(vp->projection_matrix, q->mv);
+  q->sx = screen_x;
+  q->sy = screen_y;
+  q->best_sq = threshold_px * threshold_px;
+  q->best = UINT32_MAX;
+  q->depth = NULL;
+}
+
+/* Project to viewport pixels; false behind the camera */
+static bool pick_project(const PickQuery *q, MopVec3 p, float *sx, float *sy,
+                         float *w) {
+  MopVec4 clip = mop_mat4_mul_vec4(q->mvp, (MopVec4){p.x, p.y, p.z, 1.0f});
+  if (clip.w <= 1e-6f)
+    return false;
+  float inv_w = 1.0f / clip.w;
+  *sx = (clip.x * inv_w * 0.5f + 0.5f) * (float)q->vp->width;
+  *sy = (0.5f - clip.y * inv_w * 0.5f) * (float)q->vp->height;
+  *w = clip.w;
+  return true;
+}
 
-  MopMat4 mvp = mop_mat4_multiply(
-      vp->projection_matrix,
-      mop_mat4_multiply(vp->view_matrix, mesh->world_transform));
+/* Screen rectangle {x0, y0, x1, y1} of the node's 8 projected corners.
+ * False when the node straddles the camera plane and has none. */
+static bool node_screen_rect(const PickQuery *q, const MopPickNode *n,
+                             float r[4]) {
+  r[0] = r[1] = FLT_MAX;
+  r[2] = r[3] = -FLT_MAX;
+  for (int c = 0; c < 8; c++) {
+    MopVec3 p = {(c & 1) ? n->max[0] : n->min[0],
+                 (c & 2) ? n->max[1] : n->min[1],
+                 (c & 4) ? n->max[2] : n->min[2]};
+    float sx, sy, w;
+    if (!pick_project(q, p, &sx, &sy, &w))
+      return false;
+    r[0] = fminf(r[0], sx);
+    r[1] = fminf(r[1], sy);
+    r[2] = fmaxf(r[2], sx);
+    r[3] = fmaxf(r[3], sy);
+  }
+  return true;
+}
 
-  float best_dist_sq = threshold_px * threshold_px;
-  uint32_t best_idx = UINT32_MAX;
+/* Lower bound on the squared screen distance of anything in the node */
+static float node_dist_sq(const PickQuery *q, const MopPickNode *n) {
+  float r[4];
+  if (!node_screen_rect(q, n, r))
+    return 0.0f;
+  float dx = q->sx < r[0] ? r[0] - q->sx : (q->sx > r[2] ? q->sx - r[2] : 0.0f);
+  float dy = q->sy < r[1] ? r[1] - q->sy : (q->sy > r[3] ? q->sy - r[3] : 0.0f);
+  return dx * dx + dy * dy;
+}
+
+static float sample_depth(const PickQuery *q, int x, int y) {
+  if (!q->depth)
+    return q->vp->rhi->pick_read_depth(q->vp->device, q->vp->framebuffer, x,
+                                       y);
+  if (x < 0 || x >= q->depth_w || y < 0 || y >= q->depth_h)
+    return q->vp->reverse_z ? 0.0f : 1.0f;
+  return q->depth[(size_t)y * (size_t)q->depth_w + (size_t)x];
+}
 
-  for (uint32_t i = 0; i < mesh->vertex_count; i++) {
-    float sx, sy;
-    if (!mop_selection_project_to_screen(&mvp, verts[i].position, vp->width,
-                                         vp->height, &sx, &sy))
+/* Whether local-space point p, at viewport pixel (px, py), is in front of
+ * or on the surfaces of the last rendered frame.  The depth buffer holds
+ * (ndc_z + 1) / 2, or ndc_z itself with reverse-z; both are turned back
+ * into view-space distance through the projection matrix. */
+static bool point_visible(const PickQuery *q, MopVec3 p, float px, float py) {
+  MopViewport *vp = q->vp;
+  if (vp->frame_counter == 0 || !vp->framebuffer ||
+      !vp->rhi->pick_read_depth)
+    return true;
+
+  int sf = q->depth ? q->depth_w / (vp->width > 0 ? vp->width : 1)
+                   : vp->ssaa_factor;
+  sf = sf > 0 ? sf : 1;
+  int cx = (int)(px * (float)sf), cy = (int)(py * (float)sf);
+  float depth = vp->reverse_z ? FLT_MAX : -FLT_MAX;
+  for (int dy = -1; dy <= 1; dy++) {
+    for (int dx = -1; dx <= 1; dx++) {
+      float d = sample_depth(q, cx + dx * sf, cy + dy * sf);
+      depth = vp->reverse_z ? fminf(depth, d) : fmaxf(depth, d);
+    }
+  }
+  /* Background */
+  if (vp->reverse_z ? depth <= 0.0f : depth >= 1.0f)
+    return true;
+
+  const float *m = vp->projection_matrix.d;
+  float ndc = vp->reverse_z ? depth : depth * 2.0f - 1.0f;
+  float den = ndc * m[11] - m[10];
+  if (fabsf(den) < 1e-12f)
+    return true;
+  float buf_dist = -(m[14] - ndc * m[15]) / den;
+
+  MopVec4 view = mop_mat4_mul_vec4(q->mv, (MopVec4){p.x, p.y, p.z, 1.0f});
+  float dist = -view.z;
+  return buf_dist >= dist * (1.0f - 1e-2f) - 1e-4f;
+}
+
+typedef void (*PickLeafFn)(PickQuery *q, const uint32_t *items,
+                           uint32_t count);
+
+typedef struct PickEntry {
+  uint32_t node;
+  float dist_sq;
+} PickEntry;
+
+static void pick_walk(PickQuery *q, const MopPickBvh *bvh, PickLeafFn leaf) {
+  /* Each pop pushes at most two, so depth + 1 entries suffice: at most
+   * 30 Morton bits plus the halving of runs sharing one code */
+  PickEntry stack[96];
+  int sp = 0;
+  float d = node_dist_sq(q, &bvh->nodes[0]);
+  if (d < q->best_sq)
+    stack[sp++] = (PickEntry){0, d};
+
+  while (sp > 0) {
+    PickEntry e = stack[--sp];
+    if (e.dist_sq >= q->best_sq)
+      continue;
+    uint32_t ni = e.node;
+    const MopPickNode *n = &bvh->nodes[ni];
+    if (n->count > 0) {
+      leaf(q, &bvh->items[n->first], n->count);
       continue;
+    }
+    /* Push the farther child first so the nearer one is visited first */
+    uint32_t l = ni + 1, r = n->first;
+    float dl = node_dist_sq(q, &bvh->nodes[l]);
+    float dr = node_dist_sq(q, &bvh->nodes[r]);
+    if (dl < dr) {
+      uint32_t ti = l;
+      l = r;
+      r = ti;
+      float td = dl;
+      dl = dr;
+      dr = td;
+    }
+    if (dl < q->best_sq)
+      stack[sp++] = (PickEntry){l, dl};
+    if (dr < q->best_sq)
+      stack[sp++] = (PickEntry){r, dr};
+  }
+}
 
-    float dx = sx - screen_x;
-    float dy = sy - screen_y;
-    float dist_sq = dx * dx + dy * dy;
-    if (dist_sq < best_dist_sq) {
-      best_dist_sq = dist_sq;
-      best_idx = i;
+static void vertex_leaf(PickQuery *q, const uint32_t *items, uint32_t count) {
+  for (uint32_t i = 0; i < count; i++) {
+    MopVec3 p = q->verts[items[i]].position;
+    float sx, sy, w;
+    if (!pick_project(q, p, &sx, &sy, &w))
+      continue;
+    float dx = sx - q->sx, dy = sy - q->sy;
+    float d = dx * dx + dy * dy;
+    if (d < q->best_sq && point_visible(q, p, sx, sy)) {
+      q->best_sq = d;
+      q->best = items[i];
     }
   }
+}
 
-  return best_idx;
+static void edge_leaf(PickQuery *q, const uint32_t *items, uint32_t count) {
+  for (uint32_t i = 0; i < count; i++) {
+    uint32_t ia, ib;
+    mop_pick_edge_ends(q->indices, items[i], &ia, &ib);
+    MopVec3 a = q->verts[ia].position, b = q->verts[ib].position;
+    float ax, ay, wa, bx, by, wb;
+    if (!pick_project(q, a, &ax, &ay, &wa) ||
+        !pick_project(q, b, &bx, &by, &wb))
+      continue;
+    float d = mop_selection_point_seg_dist_sq(q->sx, q->sy, ax, ay, bx, by);
+    if (d >= q->best_sq)
+      continue;
+
+    /* Closest point on screen, and the point of the edge under it: 1/w
+     * is linear in screen space, the edge parameter is not */
+    float ex = bx - ax, ey = by - ay, len_sq = ex * ex + ey * ey;
+    float t = 0.0f;
+    if (len_sq > 1e-12f)
+      t = fminf(fmaxf(((q->sx - ax) * ex + (q->sy - ay) * ey) / len_sq, 0.0f),
+                1.0f);
+    float s = (t / wb) / ((1.0f - t) / wa + t / wb);
+    MopVec3 p = {a.x + (b.x - a.x) * s, a.y + (b.y - a.y) * s,
+                 a.z + (b.z - a.z) * s};
+    if (point_visible(q, p, ax + ex * t, ay + ey * t)) {
+      q->best_sq = d;
+      q->best = items[i];
+    }
+  }
 }
 
-/* Find the nearest edge to a screen point within a pixel threshold.
- * Encodes the edge as (lo << 16 | hi) where lo < hi.
- * Returns UINT32_MAX if none found. */
-uint32_t mop_selection_pick_edge(const MopViewport *vp, const MopMesh *mesh,
-                                 float screen_x, float screen_y,
-                                 float threshold_px) {
-  if (!vp || !mesh || !mesh->vertex_buffer || !mesh->index_buffer)
-    return UINT32_MAX;
+/* Vertices of the mesh with its vertex BVH built, or NULL when it has
+ * none (empty, custom vertex format, allocation failure) */
+static const MopVertex *mesh_vertex_bvh(MopViewport *vp, MopMesh *mesh) {
+  if (!mesh->vertex_buffer || mesh->vertex_format)
+    return NULL;
+  const MopVertex *verts =
+      (const MopVertex *)vp->rhi->buffer_read(mesh->vertex_buffer);
+  if (verts && !mesh->pick_vertices)
+    mesh->pick_vertices =
+        mop_pick_bvh_build_vertices(verts, mesh->vertex_count);
+  return mesh->pick_vertices ? verts : NULL;
+}
 
+/* Same for the edge BVH; also returns the index buffer */
+static const MopVertex *mesh_edge_bvh(MopViewport *vp, MopMesh *mesh,
+                                      const uint32_t **out_indices) {
+  if (!mesh->vertex_buffer || !mesh->index_buffer || mesh->vertex_format)
+    return NULL;
   const MopVertex *verts =
       (const MopVertex *)vp->rhi->buffer_read(mesh->vertex_buffer);
   const uint32_t *indices =
       (const uint32_t *)vp->rhi->buffer_read(mesh->index_buffer);
-  if (!verts || !indices)
+  if (verts && indices && !mesh->pick_edges)
+    mesh->pick_edges =
+        mop_pick_bvh_build_edges(verts, mesh->vertex_count, indices,
+                                 mesh->index_count, mesh->topology);
+  *out_indices = indices;
+  return mesh->pick_edges ? verts : NULL;
+}
+
+/* Find the nearest visible vertex to a screen point within a pixel
+ * threshold.  Returns the vertex index, or UINT32_MAX if none found. */
+uint32_t mop_selection_pick_vertex(MopViewport *vp, MopMesh *mesh,
+                                   float screen_x, float screen_y,
+                                   float threshold_px) {
+  if (!vp || !mesh || !mesh->vertex_buffer)
+    return UINT32_MAX;
+  MOP_VP_LOCK(vp);
+  const MopVertex *verts = mesh_vertex_bvh(vp, mesh);
+  if (!verts) {
+    MOP_VP_UNLOCK(vp);
     return UINT32_MAX;
+  }
 
-  MopMat4 mvp = mop_mat4_multiply(
-      vp->projection_matrix,
-      mop_mat4_multiply(vp->view_matrix, mesh->world_transform));
+  PickQuery q;
+  pick_query_init(&q, vp, mesh, screen_x, screen_y, threshold_px);
+  q.verts = verts;
+  q.indices = NULL;
+  pick_walk(&q, mesh->pick_vertices, vertex_leaf);
+  MOP_VP_UNLOCK(vp);
+  return q.best;
+}
 
-  float best_dist_sq = threshold_px * threshold_px;
-  uint32_t best_edge = UINT32_MAX;
+/* Find the nearest visible edge to a screen point within a pixel
+ * threshold.  Encodes the edge as (lo << 16 | hi) where lo < hi.
+ * Returns UINT32_MAX if none found. */
+uint32_t mop_selection_pick_edge(MopViewport *vp, MopMesh *mesh,
+                                 float screen_x, float screen_y,
+                                 float threshold_px, uint32_t *out_lo,
+                                 uint32_t *out_hi) {
+  if (!vp || !mesh || !mesh->vertex_buffer || !mesh->index_buffer)
+    return UINT32_MAX;
+  MOP_VP_LOCK(vp);
+  const uint32_t *indices;
+  const MopVertex *verts = mesh_edge_bvh(vp, mesh, &indices);
+  if (!verts) {
+    MOP_VP_UNLOCK(vp);
+    return UINT32_MAX;
+  }
 
-  uint32_t tri_count = mesh->index_count / 3;
-  for (uint32_t t = 0; t < tri_count; t++) {
-    uint32_t i0 = indices[t * 3 + 0];
-    uint32_t i1 = indices[t * 3 + 1];
-    uint32_t i2 = indices[t * 3 + 2];
+  PickQuery q;
+  pick_query_init(&q, vp, mesh, screen_x, screen_y, threshold_px);
+  q.verts = verts;
+  q.indices = indices;
+  pick_walk(&q, mesh->pick_edges, edge_leaf);
+  if (q.best == UINT32_MAX) {
+    MOP_VP_UNLOCK(vp);
+    return UINT32_MAX;
+  }
 
-    /* 3 edges per triangle */
-    uint32_t edge_pairs[6] = {i0, i1, i1, i2, i2, i0};
-    for (int e = 0; e < 3; e++) {
-      uint32_t ea = edge_pairs[e * 2 + 0];
-      uint32_t eb = edge_pairs[e * 2 + 1];
+  /* Encode edge: smaller index in upper bits for canonical ordering */
+  uint32_t ea, eb;
+  mop_pick_edge_ends(indices, q.best, &ea, &eb);
+  MOP_VP_UNLOCK(vp);
+  uint32_t lo = ea < eb ? ea : eb;
+  uint32_t hi = ea < eb ? eb : ea;
+  if (out_lo)
+    *out_lo = lo;
+  if (out_hi)
+    *out_hi = hi;
+  return (lo << 16) | hi;
+}
+
+/* -------------------------------------------------------------------------
+ * Rectangle and lasso selection
+ *
+ * The region is rasterized once into a bitmask over its bounding box, one
+ * scanline per thread-pool row, sampling pixel centers even-odd.  Objects
+ * are then read from the object-id buffer under the mask, again a row at
+ * a time in parallel: what the last frame shows is exactly what gets
+ * selected, however many objects are in the scene.  There is no per-face
+ * id buffer, so elements are projected instead — through the pick BVHs
+ * for vertices and edges, which cull everything outside the region — and
+ * kept if the depth buffer has nothing in front of them.
+ *
+ * With `through`, occlusion is ignored: elements only need to project
+ * inside the region, and objects are found by walking each mesh's vertex
+ * BVH for a vertex inside it, which is a frustum query bounded by the
+ * region's silhouette.
+ * ------------------------------------------------------------------------- */
+
+/* Object ids at and above this are chrome (gizmo, lights, cameras) */
+#define REGION_CHROME_ID 0xFFFD0000u
+
+/* Distinct ids one id-buffer row keeps before falling back */
+#define REGION_ROW_IDS 32
+
+/* Crossings handled without allocating */
+#define REGION_STACK_CROSSINGS 64
+
+typedef struct RegionMask {
+  uint64_t *bits;
+  int x0, y0, w, h; /* bounding box in viewport pixels */
+  int stride;       /* 64-bit words per row */
+  const float *pts; /* polygon */
+  uint32_t n;
+} RegionMask;
+
+static inline bool mask_test_px(const RegionMask *m, int x, int y) {
+  x -= m->x0;
+  y -= m->y0;
+  if (x < 0 || x >= m->w || y < 0 || y >= m->h)
+    return false;
+  return (m->bits[(size_t)y * (size_t)m->stride + (size_t)(x >> 6)] >>
+          (x & 63)) &
+         1u;
+}
+
+static inline bool mask_test(const RegionMask *m, float sx, float sy) {
+  return sx >= 0.0f && sy >= 0.0f && mask_test_px(m, (int)sx, (int)sy);
+}
+
+static void mask_fill_row(void *ctx, int row) {
+  RegionMask *m = ctx;
+  float yc = (float)(m->y0 + row) + 0.5f;
+  float stack_xs[REGION_STACK_CROSSINGS];
+  float *xs = m->n > REGION_STACK_CROSSINGS ? malloc(m->n * sizeof(float))
+                                            : stack_xs;
+  if (!xs)
+    return;
+
+  uint32_t nx = 0;
+  for (uint32_t i = 0, j = m->n - 1; i < m->n; j = i++) {
+    float ax = m->pts[2 * j], ay = m->pts[2 * j + 1];
+    float bx = m->pts[2 * i], by = m->pts[2 * i + 1];
+    if ((ay <= yc) == (by <= yc))
+      continue;
+    float x = ax + (yc - ay) * (bx - ax) / (by - ay);
+    uint32_t k = nx++;
+    while (k > 0 && xs[k - 1] > x) {
+      xs[k] = xs[k - 1];
+      k--;
+    }
+    xs[k] = x;
+  }
+
+  /* Pixels whose centers lie in [xs[2k], xs[2k + 1]) */
+  uint64_t *bits = &m->bits[(size_t)row * (size_t)m->stride];
+  for (uint32_t k = 0; k + 1 < nx; k += 2) {
+    int a = (int)ceilf(xs[k] - 0.5f) - m->x0;
+    int b = (int)ceilf(xs[k + 1] - 0.5f) - m->x0;
+    a = a < 0 ? 0 : a;
+    b = b > m->w ? m->w : b;
+    for (int x = a; x < b; x++)
+      bits[x >> 6] |= 1ull << (x & 63);
+  }
+  if (xs != stack_xs)
+    free(xs);
+}
+
+/* Rasterize the region; false if it is empty or off screen */
+static bool mask_build(RegionMask *m, MopViewport *vp,
+                       const MopSelectRegion *region, float rect[8]) {
+  memset(m, 0, sizeof(*m));
+  if (!region || !region->points || region->point_count < 2)
+    return false;
+  m->pts = region->points;
+  m->n = region->point_count;
+  if (m->n == 2) {
+    const float *p = region->points;
+    float r[8] = {p[0], p[1], p[2], p[1], p[2], p[3], p[0], p[3]};
+    memcpy(rect, r, sizeof(r));
+    m->pts = rect;
+    m->n = 4;
+  }
+
+  float lx = FLT_MAX, ly = FLT_MAX, hx = -FLT_MAX, hy = -FLT_MAX;
+  for (uint32_t i = 0; i < m->n; i++) {
+    float x = m->pts[2 * i], y = m->pts[2 * i + 1];
+    if (!isfinite(x) || !isfinite(y))
+      return false;
+    lx = x < lx ? x : lx;
+    hx = x > hx ? x : hx;
+    ly = y < ly ? y : ly;
+    hy = y > hy ? y : hy;
+  }
+  float vw = (float)vp->width, vh = (float)vp->height;
+  lx = lx < 0.0f ? 0.0f : lx;
+  ly = ly < 0.0f ? 0.0f : ly;
+  hx = hx > vw ? vw : hx;
+  hy = hy > vh ? vh : hy;
+  if (lx >= hx || ly >= hy)
+    return false;
+
+  m->x0 = (int)lx;
+  m->y0 = (int)ly;
+  m->w = (int)ceilf(hx) - m->x0;
+  m->h = (int)ceilf(hy) - m->y0;
+  m->stride = (m->w + 63) / 64;
+  m->bits = calloc((size_t)m->stride * (size_t)m->h, sizeof(uint64_t));
+  if (!m->bits)
+    return false;
+  mop_threadpool_parallel_rows(vp->thread_pool, m->h, mask_fill_row, m);
+  return true;
+}
+
+/* Ids one region query hit, each once */
+typedef struct RegionHits {
+  MopIdSet set;
+  uint32_t *ids;
+  uint32_t count, capacity;
+} RegionHits;
+
+static void hits_add(RegionHits *h, uint32_t id) {
+  mop_id_list_add(&h->set, &h->ids, &h->count, &h->capacity, id);
+}
+
+static void hits_free(RegionHits *h) {
+  mop_id_set_free(&h->set);
+  free(h->ids);
+}
+
+/* ---- objects from the id buffer ---- */
+
+typedef struct IdScan {
+  const RegionMask *mask;
+  const uint32_t *ids;
+  int fw, sf;
+  uint32_t *row_ids; /* REGION_ROW_IDS per framebuffer row */
+  uint8_t *row_count; /* REGION_ROW_IDS + 1 marks an overflowed row */
+} IdScan;
+
+static void id_scan_row(void *ctx, int row) {
+  IdScan *s = ctx;
+  const RegionMask *m = s->mask;
+  int fy = m->y0 * s->sf + row;
+  const uint32_t *src = &s->ids[(size_t)fy * (size_t)s->fw];
+  uint32_t *out = &s->row_ids[(size_t)row * REGION_ROW_IDS];
+  uint32_t n = 0, last = 0;
+  for (int fx = m->x0 * s->sf; fx < (m->x0 + m->w) * s->sf; fx++) {
+    uint32_t id = src[fx];
+    if (id == last || id == 0 || id >= REGION_CHROME_ID)
+      continue;
+    if (!mask_test_px(m, fx / s->sf, fy / s->sf))
+      continue;
+    last = id;
+    uint32_t k = 0;
+    while (k < n && out[k] != id)
+      k++;
+    if (k < n)
+      continue;
+    if (n == REGION_ROW_IDS) {
+      s->row_count[row] = REGION_ROW_IDS + 1;
+      return;
+    }
+    out[n++] = id;
+  }
+  s->row_count[row] = (uint8_t)n;
+}
+
+static void objects_in_id_buffer(MopViewport *vp, const RegionMask *m,
+                                 RegionHits *hits) {
+  if (vp->frame_counter == 0 || !vp->framebuffer ||
+      !vp->rhi->framebuffer_read_object_id)
+    return;
+  int fw = 0, fh = 0;
+  const uint32_t *ids = vp->rhi->framebuffer_read_object_id(
+      vp->device, vp->framebuffer, &fw, &fh);
+  int sf = vp->width > 0 ? fw / vp->width : 0;
+  if (!ids || sf < 1 || fh < (m->y0 + m->h) * sf)
+    return;
 
-      float sax, say, sbx, sby;
-      if (!mop_selection_project_to_screen(&mvp, verts[ea].position, vp->width,
-                                           vp->height, &sax, &say))
+  int rows = m->h * sf;
+  IdScan s = {m, ids, fw, sf,
+              malloc((size_t)rows * REGION_ROW_IDS * sizeof(uint32_t)),
+              malloc((size_t)rows)};
+  if (!s.row_ids || !s.row_count) {
+    free(s.row_ids);
+    free(s.row_count);
+    return;
+  }
+  mop_threadpool_parallel_rows(vp->thread_pool, rows, id_scan_row, &s);
+
+  for (int row = 0; row < rows; row++) {
+    if (s.row_count[row] <= REGION_ROW_IDS) {
+      for (uint32_t k = 0; k < s.row_count[row]; k++)
+        hits_add(hits, s.row_ids[(size_t)row * REGION_ROW_IDS + k]);
+      continue;
+    }
+    /* Too many objects in one row: merge it pixel by pixel */
+    int fy = m->y0 * sf + row;
+    for (int fx = m->x0 * sf; fx < (m->x0 + m->w) * sf; fx++) {
+      uint32_t id = ids[(size_t)fy * (size_t)fw + (size_t)fx];
+      if (id != 0 && id < REGION_CHROME_ID && mask_test_px(m, fx / sf, fy / sf))
+        hits_add(hits, id);
+    }
+  }
+  free(s.row_ids);
+  free(s.row_count);
+}
+
+/* ---- elements through the pick BVHs ---- */
+
+typedef struct RegionQuery {
+  PickQuery q;
+  const RegionMask *mask;
+  bool through;
+  bool any_only; /* stop at the first hit, setting found */
+  bool found;
+  RegionHits *hits;
+  uint32_t vertex_count;
+} RegionQuery;
+
+typedef bool (*RegionLeafFn)(RegionQuery *r, const uint32_t *items,
+                             uint32_t count);
+
+/* Visit every leaf whose projection may overlap the region; stops when
+ * the leaf function returns true */
+static void region_walk(RegionQuery *r, const MopPickBvh *bvh,
+                        RegionLeafFn leaf) {
+  const RegionMask *m = r->mask;
+  float bx0 = (float)m->x0, by0 = (float)m->y0;
+  float bx1 = (float)(m->x0 + m->w), by1 = (float)(m->y0 + m->h);
+  uint32_t stack[96];
+  int sp = 0;
+  stack[sp++] = 0;
+  while (sp > 0) {
+    uint32_t ni = stack[--sp];
+    const MopPickNode *n = &bvh->nodes[ni];
+    float rc[4];
+    if (node_screen_rect(&r->q, n, rc) &&
+        (rc[2] < bx0 || rc[0] >= bx1 || rc[3] < by0 || rc[1] >= by1))
+      continue;
+    if (n->count > 0) {
+      if (leaf(r, &bvh->items[n->first], n->count))
+        return;
+      continue;
+    }
+    stack[sp++] = n->first;
+    stack[sp++] = ni + 1;
+  }
+}
+
+static bool region_vertex_leaf(RegionQuery *r, const uint32_t *items,
+                               uint32_t count) {
+  for (uint32_t i = 0; i < count; i++) {
+    MopVec3 p = r->q.verts[items[i]].position;
+    float sx, sy, w;
+    if (!pick_project(&r->q, p, &sx, &sy, &w) || !mask_test(r->mask, sx, sy))
+      continue;
+    if (!r->through && !point_visible(&r->q, p, sx, sy))
+      continue;
+    if (r->any_only) {
+      r->found = true;
+      return true;
+    }
+    hits_add(r->hits, items[i]);
+  }
+  return false;
+}
+
+static bool region_edge_leaf(RegionQuery *r, const uint32_t *items,
+                             uint32_t count) {
+  for (uint32_t i = 0; i < count; i++) {
+    uint32_t ia, ib;
+    mop_pick_edge_ends(r->q.indices, items[i], &ia, &ib);
+    MopVec3 a = r->q.verts[ia].position, b = r->q.verts[ib].position;
+    float ax, ay, wa, bx, by, wb;
+    if (!pick_project(&r->q, a, &ax, &ay, &wa) ||
+        !pick_project(&r->q, b, &bx, &by, &wb) ||
+        !mask_test(r->mask, ax, ay) || !mask_test(r->mask, bx, by))
+      continue;
+    if (!r->through) {
+      /* The screen midpoint, and the point of the edge under it */
+      float s = (0.5f / wb) / (0.5f / wa + 0.5f / wb);
+      MopVec3 p = {a.x + (b.x - a.x) * s, a.y + (b.y - a.y) * s,
+                   a.z + (b.z - a.z) * s};
+      if (!point_visible(&r->q, p, 0.5f * (ax + bx), 0.5f * (ay + by)))
         continue;
-      if (!mop_selection_project_to_screen(&mvp, verts[eb].position, vp->width,
-                                           vp->height, &sbx, &sby))
+    }
+    uint32_t lo = ia < ib ? ia : ib, hi = ia < ib ? ib : ia;
+    hits_add(r->hits, (lo << 16) | hi);
+  }
+  return false;
+}
+
+/* Faces are not in a BVH: test their centroids in parallel chunks */
+#define REGION_FACE_CHUNK 4096
+
+typedef struct FaceScan {
+  const RegionQuery *r;
+  uint32_t face_count;
+  uint8_t *hit;
+} FaceScan;
+
+static void face_scan_chunk(void *ctx, int chunk) {
+  FaceScan *f = ctx;
+  const RegionQuery *r = f->r;
+  uint32_t end = (uint32_t)(chunk + 1) * REGION_FACE_CHUNK;
+  end = end < f->face_count ? end : f->face_count;
+  for (uint32_t t = (uint32_t)chunk * REGION_FACE_CHUNK; t < end; t++) {
+    const uint32_t *tri = &r->q.indices[t * 3];
+    if (tri[0] >= r->vertex_count || tri[1] >= r->vertex_count ||
+        tri[2] >= r->vertex_count)
+      continue;
+    MopVec3 a = r->q.verts[tri[0]].position;
+    MopVec3 b = r->q.verts[tri[1]].position;
+    MopVec3 c = r->q.verts[tri[2]].position;
+    MopVec3 p = {(a.x + b.x + c.x) / 3.0f, (a.y + b.y + c.y) / 3.0f,
+                 (a.z + b.z + c.z) / 3.0f};
+    float sx, sy, w;
+    if (!pick_project(&r->q, p, &sx, &sy, &w) || !mask_test(r->mask, sx, sy))
+      continue;
+    f->hit[t] = r->through || point_visible(&r->q, p, sx, sy);
+  }
+}
+
+static void region_query_init(RegionQuery *r, MopViewport *vp, MopMesh *mesh,
+                              const RegionMask *m, bool through,
+                              RegionHits *hits) {
+  pick_query_init(&r->q, vp, mesh, 0.0f, 0.0f, 0.0f);
+  r->mask = m;
+  r->through = through;
+  r->any_only = false;
+  r->found = false;
+  r->hits = hits;
+  r->vertex_count = mesh->vertex_count;
+  if (!through && vp->frame_counter > 0 && vp->framebuffer &&
+      vp->rhi->framebuffer_read_depth)
+    r->q.depth = vp->rhi->framebuffer_read_depth(
+        vp->device, vp->framebuffer, &r->q.depth_w, &r->q.depth_h);
+}
+
+static void apply_op(MopIdSet *set, uint32_t **list, uint32_t *count,
+                     uint32_t *capacity, MopSelectOp op,
+                     const RegionHits *hits) {
+  if (op == MOP_SELECT_REPLACE) {
+    *count = 0;
+    mop_id_set_clear(set);
+  }
+  for (uint32_t i = 0; i < hits->count; i++) {
+    if (op == MOP_SELECT_SUBTRACT)
+      mop_id_list_remove(set, *list, count, hits->ids[i]);
+    else
+      mop_id_list_add(set, list, count, capacity, hits->ids[i]);
+  }
+}
+
+uint32_t mop_viewport_select_region(MopViewport *vp,
+                                    const MopSelectRegion *region) {
+  if (!vp || !region)
+    return 0;
+  MOP_VP_LOCK(vp);
+  RegionMask m;
+  float rect[8];
+  RegionHits hits = {0};
+  if (mask_build(&m, vp, region, rect)) {
+    objects_in_id_buffer(vp, &m, &hits);
+    for (uint32_t i = 0; region->through && i < vp->mesh_count; i++) {
+      MopMesh *mesh = vp->meshes[i];
+      if (!mesh->active || mesh->object_id == 0 ||
+          mesh->object_id >= REGION_CHROME_ID ||
+          mop_id_set_contains(&hits.set, mesh->object_id) ||
+          !mesh_vertex_bvh(vp, mesh))
         continue;
+      RegionQuery r;
+      region_query_init(&r, vp, mesh, &m, true, &hits);
+      r.q.verts = vp->rhi->buffer_read(mesh->vertex_buffer);
+      r.any_only = true;
+      region_walk(&r, mesh->pick_vertices, region_vertex_leaf);
+      if (r.found)
+        hits_add(&hits, mesh->object_id);
+    }
+  }
+  apply_op(&vp->selected_set, &vp->selected_ids, &vp->selected_count,
+           &vp->selected_capacity, region->op, &hits);
+  vp->selected_id = vp->selected_count > 0 ? vp->selected_ids[0] : 0;
+  uint32_t n = hits.count;
+  free(m.bits);
+  hits_free(&hits);
+  MOP_VP_UNLOCK(vp);
+  return n;
+}
 
-      float d = mop_selection_point_seg_dist_sq(screen_x, screen_y, sax, say,
-                                                sbx, sby);
-      if (d < best_dist_sq) {
-        best_dist_sq = d;
-        /* Encode edge: smaller index in upper bits for canonical ordering */
-        uint32_t lo = ea < eb ? ea : eb;
-        uint32_t hi = ea < eb ? eb : ea;
-        best_edge = (lo << 16) | hi;
+uint32_t mop_mesh_select_region(MopMesh *mesh, MopViewport *vp,
+                                const MopSelectRegion *region) {
+  if (!mesh || !vp || !region || mesh->edit_mode == MOP_EDIT_NONE)
+    return 0;
+  MOP_VP_LOCK(vp);
+  MopSelection *sel = &vp->selection;
+  if (sel->mesh_object_id != mesh->object_id ||
+      sel->mode != mesh->edit_mode) {
+    sel->element_count = 0;
+    mop_id_set_clear(&vp->element_set);
+  }
+  sel->mode = mesh->edit_mode;
+  sel->mesh_object_id = mesh->object_id;
+
+  RegionMask m;
+  float rect[8];
+  RegionHits hits = {0};
+  if (mask_build(&m, vp, region, rect)) {
+    RegionQuery r;
+    region_query_init(&r, vp, mesh, &m, region->through, &hits);
+    const uint32_t *indices = NULL;
+    if (mesh->edit_mode == MOP_EDIT_VERTEX) {
+      r.q.verts = mesh_vertex_bvh(vp, mesh);
+      if (r.q.verts)
+        region_walk(&r, mesh->pick_vertices, region_vertex_leaf);
+    } else if (mesh->edit_mode == MOP_EDIT_EDGE) {
+      r.q.verts = mesh_edge_bvh(vp, mesh, &indices);
+      r.q.indices = indices;
+      if (r.q.verts)
+        region_walk(&r, mesh->pick_edges, region_edge_leaf);
+    } else if (mesh->edit_mode == MOP_EDIT_FACE && mesh->vertex_buffer &&
+               mesh->index_buffer && !mesh->vertex_format) {
+      r.q.verts = vp->rhi->buffer_read(mesh->vertex_buffer);
+      r.q.indices = vp->rhi->buffer_read(mesh->index_buffer);
+      FaceScan f = {&r, mesh->index_count / 3, NULL};
+      f.hit = r.q.verts && r.q.indices ? calloc(f.face_count ? f.face_count
+                                                             : 1, 1)
+                                       : NULL;
+      if (f.hit) {
+        int chunks = (int)((f.face_count + REGION_FACE_CHUNK - 1) /
+                           REGION_FACE_CHUNK);
+        mop_threadpool_parallel_rows(vp->thread_pool, chunks,
+                                     face_scan_chunk, &f);
+        for (uint32_t t = 0; t < f.face_count; t++)
+          if (f.hit[t])
+            hits_add(&hits, t);
+        free(f.hit);
       }
     }
   }
-
-  return best_edge;
+  apply_op(&vp->element_set, &sel->elements, &sel->element_count,
+           &sel->element_capacity, region->op, &hits);
+  uint32_t n = hits.count;
+  free(m.bits);
+  hits_free(&hits);
+  MOP_VP_UNLOCK(vp);
+  return n;
 }
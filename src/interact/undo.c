@@ -1,21 +1,230 @@
 /*
  * Master of Puppets — Undo/Redo
- * undo.c — Ring buffer of TRS/material/batch snapshots for undo/redo
+ * undo.c — Ring buffer of TRS/material/batch/geometry entries for undo/redo
  *
  * The undo stack is a dynamic ring buffer of undo_capacity entries
- * in the MopViewport struct.  Each entry is tagged (TRS, MATERIAL, BATCH)
- * and dispatched accordingly.  Batch entries heap-allocate sub-entries so
- * that multi-object transforms undo/redo atomically.
+ * in the MopViewport struct.  Each entry is tagged (TRS, MATERIAL, BATCH,
+ * GEOMETRY) and dispatched accordingly.  Batch entries heap-allocate
+ * sub-entries so that multi-object transforms undo/redo atomically.
+ *
+ * Geometry entries hold the delta of one mesh edit rather than a copy of
+ * the buffers: the element runs that differ between the two sides, plus
+ * the elements one side has past the other's count.  The history is
+ * bounded by bytes, not entries: the ring grows while entries and their
+ * heap data fit in undo_budget and sheds the oldest ones past it.
+ *
+ * Entries name meshes by slot and uid, so an entry whose mesh was removed
+ * (and whose slot may have been recycled) is skipped.
  *
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include "core/mesh_topology.h"
 #include "core/viewport_internal.h"
 #include <mop/mop.h>
 
 #include <stdlib.h>
 #include <string.h>
 
+/* -------------------------------------------------------------------------
+ * Geometry deltas
+ *
+ * Both base buffers are tracked as streams of fixed-size elements:
+ * vertices, and faces (three indices) so that every run maps onto whole
+ * faces of the mesh topology.  A stream stores the *other* side of the
+ * edit; applying the entry swaps it with the mesh, leaving the side it
+ * replaced for the opposite direction.
+ * ------------------------------------------------------------------------- */
+
+typedef struct UndoSpan {
+  uint32_t first; /* first element */
+  uint32_t count;
+  size_t offset; /* into UndoStream.data */
+} UndoSpan;
+
+typedef struct UndoStream {
+  uint32_t count;  /* elements on the stored side */
+  uint32_t stride; /* bytes per element */
+
+  /* Stored contents of runs below tail_first, back to back in data */
+  UndoSpan *spans;
+  uint32_t span_count;
+  uint32_t span_capacity;
+  uint8_t *data;
+  size_t data_size;
+  size_t data_capacity;
+  uint32_t captured_end; /* highest end of any span while recording */
+
+  /* Stored elements [tail_first, count); tail_first is the smaller of
+   * the two sides' counts */
+  uint32_t tail_first;
+  uint8_t *tail;
+} UndoStream;
+
+enum { UNDO_VERTICES = 0, UNDO_FACES = 1, UNDO_STREAMS = 2 };
+
+typedef struct MopUndoGeometry {
+  UndoStream streams[UNDO_STREAMS];
+  uint32_t serial[2]; /* geometry serial of the stored and the live side */
+  bool failed;        /* a capture ran out of memory */
+} MopUndoGeometry;
+
+static void stream_free(UndoStream *s) {
+  free(s->spans);
+  free(s->data);
+  free(s->tail);
+}
+
+static void geometry_free(MopUndoGeometry *g) {
+  if (!g)
+    return;
+  for (int k = 0; k < UNDO_STREAMS; k++)
+    stream_free(&g->streams[k]);
+  free(g);
+}
+
+static size_t geometry_bytes(const MopUndoGeometry *g) {
+  size_t bytes = sizeof(*g);
+  for (int k = 0; k < UNDO_STREAMS; k++) {
+    const UndoStream *s = &g->streams[k];
+    bytes += s->span_capacity * sizeof(UndoSpan) + s->data_capacity +
+             (size_t)(s->count - s->tail_first) * s->stride;
+  }
+  return bytes;
+}
+
+static bool stream_append(UndoStream *s, const uint8_t *src, uint32_t first,
+                          uint32_t count) {
+  size_t size = (size_t)count * s->stride;
+  if (s->span_count == s->span_capacity) {
+    uint32_t cap = s->span_capacity ? s->span_capacity * 2 : 16;
+    UndoSpan *spans = realloc(s->spans, cap * sizeof(UndoSpan));
+    if (!spans)
+      return false;
+    s->spans = spans;
+    s->span_capacity = cap;
+  }
+  if (s->data_size + size > s->data_capacity) {
+    size_t cap = s->data_capacity ? s->data_capacity * 2 : 4096;
+    while (cap < s->data_size + size)
+      cap *= 2;
+    uint8_t *data = realloc(s->data, cap);
+    if (!data)
+      return false;
+    s->data = data;
+    s->data_capacity = cap;
+  }
+  memcpy(s->data + s->data_size, src, size);
+  s->spans[s->span_count++] =
+      (UndoSpan){.first = first, .count = count, .offset = s->data_size};
+  s->data_size += size;
+  if (first + count > s->captured_end)
+    s->captured_end = first + count;
+  return true;
+}
+
+/* Save elements [first, end) of the stored side from cur, skipping what
+ * an earlier write already saved (that copy is the older one) */
+static bool stream_capture(UndoStream *s, const uint8_t *cur, uint32_t first,
+                           uint32_t end) {
+  if (end > s->count)
+    end = s->count;
+  if (first >= end)
+    return true;
+  if (!cur)
+    return false;
+  if (first < s->captured_end) {
+    for (uint32_t i = 0; i < s->span_count; i++) {
+      uint32_t sf = s->spans[i].first, se = sf + s->spans[i].count;
+      if (first < se && sf < end)
+        return stream_capture(s, cur, first, sf) &&
+               stream_capture(s, cur, se, end);
+    }
+  }
+  return stream_append(s, cur + (size_t)first * s->stride, first, end - first);
+}
+
+static int cmp_span(const void *a, const void *b) {
+  uint32_t x = ((const UndoSpan *)a)->first, y = ((const UndoSpan *)b)->first;
+  return (x > y) - (x < y);
+}
+
+/* Turn the captured elements into the stored side of a finished edit:
+ * below the live count, only runs that still differ from cur (gaps
+ * cheaper than a span header are kept); past it, the tail */
+static bool stream_finish(UndoStream *s, const uint8_t *cur,
+                          uint32_t live_count) {
+  size_t st = s->stride;
+  uint32_t m = live_count < s->count ? live_count : s->count;
+  s->tail_first = m;
+  if (s->count > m) {
+    /* Truncation saves everything it drops, so the tail is covered */
+    s->tail = calloc(s->count - m, st);
+    if (!s->tail)
+      return false;
+  }
+
+  UndoStream out = {.count = s->count, .stride = s->stride};
+  qsort(s->spans, s->span_count, sizeof(UndoSpan), cmp_span);
+  bool ok = true;
+  for (uint32_t i = 0; i < s->span_count && ok; i++) {
+    const UndoSpan *sp = &s->spans[i];
+    const uint8_t *old = s->data + sp->offset; /* element sp->first */
+    uint32_t end = sp->first + sp->count;
+    for (uint32_t e = m > sp->first ? m : sp->first; e < end; e++)
+      memcpy(s->tail + (size_t)(e - m) * st,
+             old + (size_t)(e - sp->first) * st, st);
+
+    uint32_t rs = UINT32_MAX, re = 0;
+    for (uint32_t e = sp->first; e < end && e < m && ok; e++) {
+      if (memcmp(old + (size_t)(e - sp->first) * st, cur + (size_t)e * st,
+                 st) == 0)
+        continue;
+      if (rs != UINT32_MAX && (size_t)(e - re) * st > sizeof(UndoSpan)) {
+        ok = stream_append(&out, old + (size_t)(rs - sp->first) * st, rs,
+                           re - rs);
+        rs = UINT32_MAX;
+      }
+      if (rs == UINT32_MAX)
+        rs = e;
+      re = e + 1;
+    }
+    if (ok && rs != UINT32_MAX)
+      ok = stream_append(&out, old + (size_t)(rs - sp->first) * st, rs,
+                         re - rs);
+  }
+  free(s->spans);
+  free(s->data);
+  s->spans = out.spans;
+  s->span_count = s->span_capacity = out.span_count;
+  s->data = out.data;
+  s->data_size = s->data_capacity = out.data_size;
+  if (!ok)
+    return false;
+
+  /* Trim to size: the undo budget counts capacity */
+  if (s->span_count) {
+    UndoSpan *spans = realloc(s->spans, s->span_count * sizeof(UndoSpan));
+    uint8_t *data = realloc(s->data, s->data_size);
+    if (spans)
+      s->spans = spans;
+    if (data)
+      s->data = data;
+  }
+  return true;
+}
+
+static const uint8_t *stream_buffer(MopViewport *vp, const MopMesh *mesh,
+                                    int k) {
+  MopRhiBuffer *buf = k == UNDO_VERTICES ? mesh->vertex_buffer
+                                         : mesh->index_buffer;
+  return buf ? (const uint8_t *)vp->rhi->buffer_read(buf) : NULL;
+}
+
+static uint32_t stream_live_count(const MopMesh *mesh, int k) {
+  return k == UNDO_VERTICES ? mesh->vertex_count : mesh->index_count / 3;
+}
+
 /* -------------------------------------------------------------------------
  * Internal: find mesh index in viewport array
  * ------------------------------------------------------------------------- */
@@ -33,45 +242,101 @@ static bool find_mesh_index(MopViewport *vp, MopMesh *mesh, uint32_t *out) {
   return false;
 }
 
+/* The mesh an entry was recorded for, or NULL once it has been removed
+ * (its slot may hold a newer mesh by now) */
+static MopMesh *resolve_mesh(MopViewport *vp, uint32_t index, uint32_t uid) {
+  if (index >= vp->mesh_count)
+    return NULL;
+  MopMesh *mesh = vp->meshes[index];
+  return mesh && mesh->active && mesh->uid == uid ? mesh : NULL;
+}
+
 /* -------------------------------------------------------------------------
- * Internal: free heap memory owned by a batch entry
+ * Internal: entry storage, accounted against the byte budget
  * ------------------------------------------------------------------------- */
 
-static void free_batch_entries(MopUndoEntry *entry) {
-  if (entry->type == MOP_UNDO_BATCH && entry->batch.entries) {
-    free(entry->batch.entries);
-    entry->batch.entries = NULL;
-    entry->batch.count = 0;
-  }
+static size_t entry_bytes(const MopUndoEntry *entry) {
+  size_t bytes = sizeof(MopUndoEntry);
+  if (entry->type == MOP_UNDO_BATCH)
+    bytes += entry->batch.count * sizeof(MopUndoEntry);
+  else if (entry->type == MOP_UNDO_GEOMETRY && entry->geom.delta)
+    bytes += geometry_bytes(entry->geom.delta);
+  return bytes;
 }
 
-/* -------------------------------------------------------------------------
- * Internal: allocate a ring slot, discarding oldest if full
- * ------------------------------------------------------------------------- */
+static void free_entry(MopViewport *vp, MopUndoEntry *entry) {
+  vp->undo_bytes -= entry_bytes(entry);
+  if (entry->type == MOP_UNDO_BATCH)
+    free(entry->batch.entries);
+  else if (entry->type == MOP_UNDO_GEOMETRY)
+    geometry_free(entry->geom.delta);
+  *entry = (MopUndoEntry){0};
+}
 
-static int alloc_slot(MopViewport *vp) {
-  int cap = (int)vp->undo_capacity;
-  int slot = (vp->undo_head + vp->undo_count) % cap;
+static int ring_slot(const MopViewport *vp, int i) {
+  return (vp->undo_head + i) % (int)vp->undo_capacity;
+}
 
-  if (vp->undo_count == cap) {
-    /* Discard oldest — free batch heap memory if present */
-    free_batch_entries(&vp->undo_entries[vp->undo_head]);
-    vp->undo_head = (vp->undo_head + 1) % cap;
-  } else {
-    vp->undo_count++;
-  }
+static void discard_oldest(MopViewport *vp) {
+  free_entry(vp, &vp->undo_entries[vp->undo_head]);
+  vp->undo_head = ring_slot(vp, 1);
+  vp->undo_count--;
+}
 
-  /* Free any stale redo entries that occupied this slot */
-  free_batch_entries(&vp->undo_entries[slot]);
+/* Double the ring, unrolling it so the oldest entry lands at 0 */
+static bool ring_grow(MopViewport *vp) {
+  uint32_t cap = vp->undo_capacity;
+  if (cap > (uint32_t)INT32_MAX / 2)
+    return false;
+  MopUndoEntry *grown = calloc((size_t)cap * 2, sizeof(MopUndoEntry));
+  if (!grown)
+    return false;
+  for (int i = 0; i < vp->undo_count + vp->redo_count; i++)
+    grown[i] = vp->undo_entries[ring_slot(vp, i)];
+  free(vp->undo_entries);
+  vp->undo_entries = grown;
+  vp->undo_capacity = cap * 2;
+  vp->undo_head = 0;
+  return true;
+}
 
-  /* Any new push invalidates redo history — free batch memory in redo zone */
-  for (int i = 0; i < vp->redo_count; i++) {
-    int redo_slot = (vp->undo_head + vp->undo_count + i) % cap;
-    free_batch_entries(&vp->undo_entries[redo_slot]);
+/* Shed history until it fits the budget: oldest undo entries first, then
+ * the redo entries furthest from the present */
+static void trim_to_budget(MopViewport *vp) {
+  while (vp->undo_bytes > vp->undo_budget && vp->undo_count > 0)
+    discard_oldest(vp);
+  while (vp->undo_bytes > vp->undo_budget && vp->redo_count > 0) {
+    vp->redo_count--;
+    free_entry(vp, &vp->undo_entries[ring_slot(
+                       vp, vp->undo_count + vp->redo_count)]);
   }
+}
+
+/* Append an entry, taking ownership of its heap data */
+static void push_entry(MopViewport *vp, MopUndoEntry entry) {
+  /* Any new push invalidates redo history */
+  for (int i = 0; i < vp->redo_count; i++)
+    free_entry(vp, &vp->undo_entries[ring_slot(vp, vp->undo_count + i)]);
   vp->redo_count = 0;
 
-  return slot;
+  if (vp->undo_count == (int)vp->undo_capacity && !ring_grow(vp))
+    discard_oldest(vp);
+  vp->undo_entries[ring_slot(vp, vp->undo_count)] = entry;
+  vp->undo_count++;
+  vp->undo_bytes += entry_bytes(&entry);
+  trim_to_budget(vp);
+}
+
+void mop_undo_clear(MopViewport *vp) {
+  if (!vp)
+    return;
+  MOP_VP_LOCK(vp);
+  for (int i = 0; i < vp->undo_count + vp->redo_count; i++)
+    free_entry(vp, &vp->undo_entries[ring_slot(vp, i)]);
+  vp->undo_head = 0;
+  vp->undo_count = 0;
+  vp->redo_count = 0;
+  MOP_VP_UNLOCK(vp);
 }
 
 /* -------------------------------------------------------------------------
@@ -89,14 +354,14 @@ void mop_viewport_push_undo(MopViewport *vp, MopMesh *mesh) {
     return;
   }
 
-  int slot = alloc_slot(vp);
-  vp->undo_entries[slot] = (MopUndoEntry){
-      .type = MOP_UNDO_TRS,
-      .trs = {.mesh_index = idx,
-              .pos = mesh->position,
-              .rot = mesh->rotation,
-              .scale = mesh->scale_val},
-  };
+  push_entry(vp, (MopUndoEntry){
+                     .type = MOP_UNDO_TRS,
+                     .trs = {.mesh_index = idx,
+                             .mesh_uid = mesh->uid,
+                             .pos = mesh->position,
+                             .rot = mesh->rotation,
+                             .scale = mesh->scale_val},
+                 });
   MOP_VP_UNLOCK(vp);
 }
 
@@ -115,11 +380,12 @@ void mop_viewport_push_undo_material(MopViewport *vp, MopMesh *mesh) {
     return;
   }
 
-  int slot = alloc_slot(vp);
-  vp->undo_entries[slot] = (MopUndoEntry){
-      .type = MOP_UNDO_MATERIAL,
-      .mat = {.mesh_index = idx, .material = mesh->material},
-  };
+  push_entry(vp, (MopUndoEntry){
+                     .type = MOP_UNDO_MATERIAL,
+                     .mat = {.mesh_index = idx,
+                             .mesh_uid = mesh->uid,
+                             .material = mesh->material},
+                 });
   MOP_VP_UNLOCK(vp);
 }
 
@@ -145,6 +411,7 @@ void mop_viewport_push_undo_batch(MopViewport *vp, MopMesh **meshes,
     sub[valid++] = (MopUndoEntry){
         .type = MOP_UNDO_TRS,
         .trs = {.mesh_index = idx,
+                .mesh_uid = meshes[i]->uid,
                 .pos = meshes[i]->position,
                 .rot = meshes[i]->rotation,
                 .scale = meshes[i]->scale_val},
@@ -157,23 +424,102 @@ void mop_viewport_push_undo_batch(MopViewport *vp, MopMesh **meshes,
     return;
   }
 
-  int slot = alloc_slot(vp);
-  vp->undo_entries[slot] = (MopUndoEntry){
-      .type = MOP_UNDO_BATCH,
-      .batch = {.count = valid, .entries = sub},
-  };
+  push_entry(vp, (MopUndoEntry){
+                     .type = MOP_UNDO_BATCH,
+                     .batch = {.count = valid, .entries = sub},
+                 });
   MOP_VP_UNLOCK(vp);
 }
 
+/* -------------------------------------------------------------------------
+ * Geometry recording — bracket one mesh edit
+ * ------------------------------------------------------------------------- */
+
+void mop_undo_geometry_begin(MopViewport *vp, MopMesh *mesh) {
+  if (!vp || !mesh || mesh->undo_rec)
+    return;
+  uint32_t idx;
+  if (vp->undo_budget == 0 || mesh->index_count % 3 != 0 ||
+      !find_mesh_index(vp, mesh, &idx))
+    return;
+
+  MopUndoGeometry *g = calloc(1, sizeof(MopUndoGeometry));
+  if (!g) {
+    /* Older entries of this mesh cannot be applied across an edit that
+     * went unrecorded */
+    MOP_WARN("undo: out of memory, history cleared");
+    mop_undo_clear(vp);
+    return;
+  }
+  g->streams[UNDO_VERTICES] = (UndoStream){.count = mesh->vertex_count,
+                                           .stride = sizeof(MopVertex)};
+  g->streams[UNDO_FACES] = (UndoStream){.count = mesh->index_count / 3,
+                                        .stride = 3 * sizeof(uint32_t)};
+  g->serial[0] = mesh->geometry_serial;
+  mesh->undo_rec = g;
+}
+
+void mop_undo_capture_vertices(MopViewport *vp, MopMesh *mesh, uint32_t first,
+                               uint32_t count) {
+  MopUndoGeometry *g = mesh ? mesh->undo_rec : NULL;
+  if (!g || g->failed)
+    return;
+  g->failed = !stream_capture(&g->streams[UNDO_VERTICES],
+                              stream_buffer(vp, mesh, UNDO_VERTICES), first,
+                              first + count);
+}
+
+void mop_undo_capture_indices(MopViewport *vp, MopMesh *mesh, uint32_t first,
+                              uint32_t count) {
+  MopUndoGeometry *g = mesh ? mesh->undo_rec : NULL;
+  if (!g || g->failed)
+    return;
+  g->failed = !stream_capture(&g->streams[UNDO_FACES],
+                              stream_buffer(vp, mesh, UNDO_FACES), first / 3,
+                              (first + count + 2) / 3);
+}
+
+void mop_undo_geometry_end(MopViewport *vp, MopMesh *mesh) {
+  MopUndoGeometry *g = mesh ? mesh->undo_rec : NULL;
+  if (!g)
+    return;
+  mesh->undo_rec = NULL;
+
+  bool ok = !g->failed && mesh->index_count % 3 == 0;
+  bool changed = false;
+  for (int k = 0; k < UNDO_STREAMS && ok; k++) {
+    UndoStream *s = &g->streams[k];
+    uint32_t live = stream_live_count(mesh, k);
+    ok = stream_finish(s, stream_buffer(vp, mesh, k), live);
+    changed |= s->span_count > 0 || s->count != live;
+  }
+  if (!ok) {
+    MOP_WARN("undo: out of memory recording a mesh edit, history cleared");
+    geometry_free(g);
+    mop_undo_clear(vp);
+    return;
+  }
+  if (!changed) {
+    geometry_free(g);
+    return;
+  }
+
+  g->serial[1] = mesh->geometry_serial;
+  push_entry(vp, (MopUndoEntry){
+                     .type = MOP_UNDO_GEOMETRY,
+                     .geom = {.mesh_index = mesh->slot_index,
+                              .mesh_uid = mesh->uid,
+                              .delta = g},
+                 });
+}
+
 /* -------------------------------------------------------------------------
  * Internal: undo/redo a single TRS entry (swap current ↔ stored)
  * ------------------------------------------------------------------------- */
 
 static void swap_trs(MopViewport *vp, MopUndoEntry *entry) {
-  if (entry->trs.mesh_index >= vp->mesh_count)
-    return;
-  MopMesh *mesh = vp->meshes[entry->trs.mesh_index];
-  if (!mesh->active)
+  MopMesh *mesh = resolve_mesh(vp, entry->trs.mesh_index, entry->trs.mesh_uid);
+  if (!mesh)
     return;
 
   MopVec3 cur_pos = mesh->position;
@@ -195,10 +541,8 @@ static void swap_trs(MopViewport *vp, MopUndoEntry *entry) {
  * ------------------------------------------------------------------------- */
 
 static void swap_material(MopViewport *vp, MopUndoEntry *entry) {
-  if (entry->mat.mesh_index >= vp->mesh_count)
-    return;
-  MopMesh *mesh = vp->meshes[entry->mat.mesh_index];
-  if (!mesh->active)
+  MopMesh *mesh = resolve_mesh(vp, entry->mat.mesh_index, entry->mat.mesh_uid);
+  if (!mesh)
     return;
 
   MopMaterial cur = mesh->material;
@@ -206,6 +550,124 @@ static void swap_material(MopViewport *vp, MopUndoEntry *entry) {
   entry->mat.material = cur;
 }
 
+/* -------------------------------------------------------------------------
+ * Internal: undo/redo a geometry entry (swap current ↔ stored)
+ *
+ * The mesh must still be on the side the entry left it on; geometry
+ * written by anything but a recorded edit since then skips the entry.
+ * The mesh's topology is patched along with the faces instead of being
+ * dropped.
+ * ------------------------------------------------------------------------- */
+
+static void swap_geometry(MopViewport *vp, MopUndoEntry *entry) {
+  MopMesh *mesh =
+      resolve_mesh(vp, entry->geom.mesh_index, entry->geom.mesh_uid);
+  MopUndoGeometry *g = entry->geom.delta;
+  if (!mesh || mesh->geometry_serial != g->serial[1] ||
+      mesh->index_count % 3 != 0)
+    return;
+
+  /* The live side's tails become the stored ones */
+  uint32_t live[UNDO_STREAMS];
+  uint8_t *tails[UNDO_STREAMS] = {NULL, NULL};
+  size_t scratch_size = 0;
+  bool ok = true;
+  for (int k = 0; k < UNDO_STREAMS; k++) {
+    UndoStream *s = &g->streams[k];
+    live[k] = stream_live_count(mesh, k);
+    size_t size = (size_t)(live[k] - s->tail_first) * s->stride;
+    const uint8_t *cur = stream_buffer(vp, mesh, k);
+    if (size && (!cur || !(tails[k] = malloc(size)))) {
+      ok = false;
+      continue;
+    }
+    if (size)
+      memcpy(tails[k], cur + (size_t)s->tail_first * s->stride, size);
+    for (uint32_t i = 0; i < s->span_count; i++) {
+      size_t bytes = (size_t)s->spans[i].count * s->stride;
+      if (bytes > scratch_size)
+        scratch_size = bytes;
+    }
+  }
+  uint8_t *scratch = ok && scratch_size ? malloc(scratch_size) : NULL;
+  MopMeshTopology *topo = mesh->topology;
+  mesh->topology = NULL;
+  UndoStream *vs = &g->streams[UNDO_VERTICES], *fs = &g->streams[UNDO_FACES];
+  if (!ok || (scratch_size && !scratch) ||
+      !mop_mesh_resize_geometry(mesh, vp, vs->count, fs->count * 3)) {
+    MOP_WARN("undo: could not apply a mesh edit");
+    free(tails[UNDO_VERTICES]);
+    free(tails[UNDO_FACES]);
+    free(scratch);
+    mesh->topology = topo;
+    return;
+  }
+
+  for (int k = 0; k < UNDO_STREAMS; k++) {
+    UndoStream *s = &g->streams[k];
+    for (uint32_t i = 0; i < s->span_count; i++) {
+      const UndoSpan *sp = &s->spans[i];
+      size_t bytes = (size_t)sp->count * s->stride;
+      memcpy(scratch, stream_buffer(vp, mesh, k) + (size_t)sp->first * s->stride,
+             bytes);
+      if (k == UNDO_VERTICES)
+        mop_mesh_patch_vertices(mesh, vp, sp->first,
+                                (const MopVertex *)(s->data + sp->offset),
+                                sp->count);
+      else
+        mop_mesh_patch_indices(mesh, vp, sp->first * 3,
+                               (const uint32_t *)(s->data + sp->offset),
+                               sp->count * 3);
+      if (k == UNDO_FACES && topo &&
+          !mop_topology_set_faces(topo, sp->first,
+                                  (const uint32_t *)(s->data + sp->offset),
+                                  sp->count)) {
+        mop_topology_free(topo);
+        topo = NULL;
+      }
+      memcpy(s->data + sp->offset, scratch, bytes);
+    }
+
+    uint32_t tail_count = s->count - s->tail_first;
+    if (tail_count && k == UNDO_VERTICES)
+      mop_mesh_patch_vertices(mesh, vp, s->tail_first,
+                              (const MopVertex *)s->tail, tail_count);
+    else if (tail_count)
+      mop_mesh_patch_indices(mesh, vp, s->tail_first * 3,
+                             (const uint32_t *)s->tail, tail_count * 3);
+    if (k == UNDO_FACES && topo) {
+      if (fs->count < live[k]) {
+        mop_topology_truncate(topo, fs->count);
+      } else if (tail_count &&
+                 !mop_topology_set_faces(topo, s->tail_first,
+                                         (const uint32_t *)s->tail,
+                                         tail_count)) {
+        mop_topology_free(topo);
+        topo = NULL;
+      }
+    }
+  }
+  free(scratch);
+
+  size_t before = geometry_bytes(g);
+  for (int k = 0; k < UNDO_STREAMS; k++) {
+    free(g->streams[k].tail);
+    g->streams[k].tail = tails[k];
+    g->streams[k].count = live[k];
+  }
+  vp->undo_bytes = vp->undo_bytes - before + geometry_bytes(g);
+
+  uint32_t serial = g->serial[0];
+  g->serial[0] = g->serial[1];
+  g->serial[1] = serial;
+  mesh->geometry_serial = serial;
+
+  if (topo && mesh->index_count == topo->face_count * 3)
+    mesh->topology = topo;
+  else
+    mop_topology_free(topo);
+}
+
 /* -------------------------------------------------------------------------
  * Internal: dispatch undo/redo for any entry type
  * ------------------------------------------------------------------------- */
@@ -222,6 +684,9 @@ static void apply_entry(MopViewport *vp, MopUndoEntry *entry) {
     for (uint32_t i = 0; i < entry->batch.count; i++)
       apply_entry(vp, &entry->batch.entries[i]);
     break;
+  case MOP_UNDO_GEOMETRY:
+    swap_geometry(vp, entry);
+    break;
   }
 }
 
@@ -238,13 +703,11 @@ void mop_viewport_undo(MopViewport *vp) {
     return;
   }
 
-  int cap = (int)vp->undo_capacity;
   vp->undo_count--;
-  int slot = (vp->undo_head + vp->undo_count) % cap;
-
-  apply_entry(vp, &vp->undo_entries[slot]);
-
+  apply_entry(vp, &vp->undo_entries[ring_slot(vp, vp->undo_count)]);
   vp->redo_count++;
+  /* Swapping a geometry entry can change its size */
+  trim_to_budget(vp);
   MOP_VP_UNLOCK(vp);
 }
 
@@ -261,12 +724,31 @@ void mop_viewport_redo(MopViewport *vp) {
     return;
   }
 
-  int cap = (int)vp->undo_capacity;
-  int slot = (vp->undo_head + vp->undo_count) % cap;
-
-  apply_entry(vp, &vp->undo_entries[slot]);
-
+  apply_entry(vp, &vp->undo_entries[ring_slot(vp, vp->undo_count)]);
   vp->undo_count++;
   vp->redo_count--;
+  trim_to_budget(vp);
+  MOP_VP_UNLOCK(vp);
+}
+
+/* -------------------------------------------------------------------------
+ * Budget
+ * ------------------------------------------------------------------------- */
+
+void mop_viewport_set_undo_budget(MopViewport *vp, size_t bytes) {
+  if (!vp)
+    return;
+  MOP_VP_LOCK(vp);
+  vp->undo_budget = bytes;
+  trim_to_budget(vp);
+  MOP_VP_UNLOCK(vp);
+}
+
+size_t mop_viewport_get_undo_usage(MopViewport *vp) {
+  if (!vp)
+    return 0;
+  MOP_VP_LOCK(vp);
+  size_t bytes = vp->undo_bytes;
   MOP_VP_UNLOCK(vp);
+  return bytes;
 }
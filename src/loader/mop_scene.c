@@ -10,6 +10,8 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <mop/core/scene.h>
+#include <mop/core/vertex_format.h>
 #include <mop/loader/loader.h>
 #include <mop/loader/mop_scene.h>
 #include <mop/query/camera_query.h>
@@ -394,12 +396,11 @@ uint32_t mop_scene_light_count(const MopSceneFile *s) {
   return count_sections(s, MOP_SECTION_LIGHT);
 }
 
-bool mop_scene_get_mesh(const MopSceneFile *s, uint32_t idx,
-                        MopLoadedMesh *out) {
-  if (!s || !out)
-    return false;
-  memset(out, 0, sizeof(*out));
-
+/* Locate mesh section idx: header plus vertex and index data, checked
+ * against the section size. */
+static bool mesh_section(const MopSceneFile *s, uint32_t idx,
+                         MopMeshSectionHeader *mhdr,
+                         const uint8_t **vtx_data, const uint8_t **idx_data) {
   const MopSceneTocEntry *entry = find_section(s, MOP_SECTION_MESH, idx);
   if (!entry)
     return false;
@@ -412,32 +413,59 @@ bool mop_scene_get_mesh(const MopSceneFile *s, uint32_t idx,
   const uint8_t *sec_data = s->data + entry->offset;
   if (entry->size < sizeof(MopMeshSectionHeader))
     return false;
-
-  MopMeshSectionHeader mhdr;
-  memcpy(&mhdr, sec_data, sizeof(mhdr));
-
-  uint32_t vcount = mhdr.vertex_count;
-  uint32_t icount = mhdr.index_count;
+  memcpy(mhdr, sec_data, sizeof(*mhdr));
 
   /* Compute data sizes */
-  size_t vtx_bytes;
-  bool quantized = (mhdr.vertex_encoding == MOP_VTX_QUANTIZED);
-  if (quantized) {
-    vtx_bytes = (size_t)vcount * sizeof(MopQuantizedVertex);
-  } else {
-    vtx_bytes = (size_t)vcount * sizeof(MopVertex);
+  size_t vtx_bytes = (size_t)mhdr->vertex_count *
+                     (mhdr->vertex_encoding == MOP_VTX_QUANTIZED
+                          ? sizeof(MopQuantizedVertex)
+                          : sizeof(MopVertex));
+  size_t idx_bytes = (size_t)mhdr->index_count *
+                     (mhdr->index_size == 2 ? sizeof(uint16_t)
+                                            : sizeof(uint32_t));
+  if (sizeof(MopMeshSectionHeader) + align8(vtx_bytes) + idx_bytes >
+      entry->size) {
+    MOP_ERROR("mop_scene_get_mesh: mesh data exceeds section");
+    return false;
   }
 
-  size_t idx_bytes;
-  bool idx16 = (mhdr.index_size == 2);
-  if (idx16) {
-    idx_bytes = (size_t)icount * sizeof(uint16_t);
+  *vtx_data = sec_data + sizeof(MopMeshSectionHeader);
+  *idx_data = *vtx_data + align8(vtx_bytes);
+  return true;
+}
+
+/* Widen the section's indices to a malloc'd uint32 array */
+static uint32_t *decode_indices(const MopMeshSectionHeader *mhdr,
+                                const uint8_t *idx_data) {
+  uint32_t icount = mhdr->index_count;
+  uint32_t *indices = malloc((size_t)icount * sizeof(uint32_t));
+  if (!indices)
+    return NULL;
+  if (mhdr->index_size == 2) {
+    const uint16_t *idx16_data = (const uint16_t *)idx_data;
+    for (uint32_t i = 0; i < icount; i++)
+      indices[i] = idx16_data[i];
   } else {
-    idx_bytes = (size_t)icount * sizeof(uint32_t);
+    memcpy(indices, idx_data, (size_t)icount * sizeof(uint32_t));
   }
+  return indices;
+}
+
+bool mop_scene_get_mesh(const MopSceneFile *s, uint32_t idx,
+                        MopLoadedMesh *out) {
+  if (!s || !out)
+    return false;
+  memset(out, 0, sizeof(*out));
+
+  MopMeshSectionHeader mhdr;
+  const uint8_t *vtx_data, *idx_data;
+  if (!mesh_section(s, idx, &mhdr, &vtx_data, &idx_data))
+    return false;
 
-  const uint8_t *vtx_data = sec_data + sizeof(MopMeshSectionHeader);
-  const uint8_t *idx_data = vtx_data + align8(vtx_bytes);
+  uint32_t vcount = mhdr.vertex_count;
+  uint32_t icount = mhdr.index_count;
+  bool quantized = (mhdr.vertex_encoding == MOP_VTX_QUANTIZED);
+  size_t vtx_bytes = (size_t)vcount * sizeof(MopVertex);
 
   /* Allocate and decode vertices */
   MopVertex *vertices = malloc(vcount * sizeof(MopVertex));
@@ -453,22 +481,12 @@ bool mop_scene_get_mesh(const MopSceneFile *s, uint32_t idx,
     memcpy(vertices, vtx_data, vtx_bytes);
   }
 
-  /* Allocate and decode indices */
-  uint32_t *indices = malloc(icount * sizeof(uint32_t));
+  uint32_t *indices = decode_indices(&mhdr, idx_data);
   if (!indices) {
     free(vertices);
     return false;
   }
 
-  if (idx16) {
-    const uint16_t *idx16_data = (const uint16_t *)idx_data;
-    for (uint32_t i = 0; i < icount; i++) {
-      indices[i] = idx16_data[i];
-    }
-  } else {
-    memcpy(indices, idx_data, idx_bytes);
-  }
-
   out->vertices = vertices;
   out->vertex_count = vcount;
   out->indices = indices;
@@ -486,6 +504,49 @@ bool mop_scene_get_mesh(const MopSceneFile *s, uint32_t idx,
   return true;
 }
 
+MopMesh *mop_scene_add_mesh(const MopSceneFile *s, uint32_t idx,
+                            MopViewport *vp, uint32_t object_id) {
+  if (!s || !vp)
+    return NULL;
+
+  MopMeshSectionHeader mhdr;
+  const uint8_t *vtx_data, *idx_data;
+  if (!mesh_section(s, idx, &mhdr, &vtx_data, &idx_data))
+    return NULL;
+
+  if (mhdr.vertex_encoding != MOP_VTX_QUANTIZED) {
+    MopLoadedMesh lm;
+    if (!mop_scene_get_mesh(s, idx, &lm))
+      return NULL;
+    MopMesh *mesh = mop_viewport_add_mesh(
+        vp, &(MopMeshDesc){.vertices = lm.vertices,
+                           .vertex_count = lm.vertex_count,
+                           .indices = lm.indices,
+                           .index_count = lm.index_count,
+                           .object_id = object_id});
+    mop_load_free(&lm);
+    return mesh;
+  }
+
+  /* Upload the quantized vertices as they are in the file; the bounding
+   * box becomes the format's position dequantization */
+  uint32_t *indices = decode_indices(&mhdr, idx_data);
+  if (!indices)
+    return NULL;
+  MopVertexFormat fmt = mop_vertex_format_quantized(
+      (MopVec3){mhdr.bbox_min[0], mhdr.bbox_min[1], mhdr.bbox_min[2]},
+      (MopVec3){mhdr.bbox_max[0], mhdr.bbox_max[1], mhdr.bbox_max[2]});
+  MopMesh *mesh = mop_viewport_add_mesh_ex(
+      vp, &(MopMeshDescEx){.vertex_data = vtx_data,
+                           .vertex_count = mhdr.vertex_count,
+                           .indices = indices,
+                           .index_count = mhdr.index_count,
+                           .object_id = object_id,
+                           .vertex_format = &fmt});
+  free(indices);
+  return mesh;
+}
+
 bool mop_scene_get_camera(const MopSceneFile *s, MopVec3 *eye, MopVec3 *target,
                           MopVec3 *up, float *fov, float *near_p,
                           float *far_p) {
@@ -7,6 +7,8 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include "math/math_simd.h"
+
 #include <math.h>
 #include <mop/types.h>
 #include <mop/util/log.h>
@@ -180,26 +182,36 @@ MopMat4 mop_mat4_scale(MopVec3 s) {
 }
 
 MopMat4 mop_mat4_multiply(MopMat4 a, MopMat4 b) {
-  MopMat4 r = {0};
-  for (int c = 0; c < 4; c++) {
-    for (int row = 0; row < 4; row++) {
-      float sum = 0.0f;
-      for (int k = 0; k < 4; k++) {
-        sum += M(a, row, k) * M(b, k, c);
-      }
-      M(r, row, c) = sum;
-    }
-  }
+  MopMat4 r;
+  mop_m4_mul(&a, &b, &r);
   return r;
 }
 
 MopVec4 mop_mat4_mul_vec4(MopMat4 m, MopVec4 v) {
-  return (MopVec4){
-      M(m, 0, 0) * v.x + M(m, 0, 1) * v.y + M(m, 0, 2) * v.z + M(m, 0, 3) * v.w,
-      M(m, 1, 0) * v.x + M(m, 1, 1) * v.y + M(m, 1, 2) * v.z + M(m, 1, 3) * v.w,
-      M(m, 2, 0) * v.x + M(m, 2, 1) * v.y + M(m, 2, 2) * v.z + M(m, 2, 3) * v.w,
-      M(m, 3, 0) * v.x + M(m, 3, 1) * v.y + M(m, 3, 2) * v.z +
-          M(m, 3, 3) * v.w};
+  return mop_m4_mul_xyzw(&m, v.x, v.y, v.z, v.w);
+}
+
+/* -------------------------------------------------------------------------
+ * Batch transforms
+ *
+ * One call per array instead of one per element: the matrix stays in
+ * registers and nothing 64 bytes wide is copied per item.
+ * ------------------------------------------------------------------------- */
+
+void mop_mat4_transform_points(const MopMat4 *m, const MopVec3 *points,
+                               size_t stride, size_t count, MopVec4 *out) {
+  if (stride == 0)
+    stride = sizeof(MopVec3);
+  const unsigned char *p = (const unsigned char *)points;
+  for (size_t i = 0; i < count; i++, p += stride)
+    out[i] = mop_m4_transform_point(m, (const float *)p);
+}
+
+void mop_mat4_multiply_batch(const MopMat4 *a, const MopMat4 *b, size_t count,
+                             MopMat4 *out) {
+  MopMat4 lhs = *a; /* out may overlap a */
+  for (size_t i = 0; i < count; i++)
+    mop_m4_mul(&lhs, &b[i], &out[i]);
 }
 
 MopMat4 mop_mat4_compose_trs(MopVec3 position, MopVec3 rotation,
@@ -0,0 +1,199 @@
+/*
+ * Master of Puppets — Math Library
+ * math_simd.h — Header-inline matrix kernels and 4-wide lanes for hot paths
+ *
+ * The public mop_mat4_* functions pass and return 64-byte matrices by
+ * value through an out-of-line call.  Per-vertex and per-instance loops
+ * use these inline kernels instead: matrices are passed by pointer and
+ * the column-major layout maps each column onto one 4-wide register, so
+ * M * v is four broadcast multiplies and three adds.
+ *
+ * The v4 type and its v4_* helpers wrap one 4-wide float register for
+ * loops over RGBA pixels or material lanes (bloom, the material
+ * interpreter, mip filtering).
+ *
+ * SSE2 (every x86-64) and NEON (every AArch64) are used when the
+ * compiler targets them; MOP_MATH_SCALAR forces the portable path.  All
+ * three accumulate in the same order as the scalar code — products are
+ * multiplied and added separately, never fused — so results are
+ * bit-identical across paths.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef MOP_MATH_SIMD_H
+#define MOP_MATH_SIMD_H
+
+#include <mop/types.h>
+
+#if !defined(MOP_MATH_SCALAR) && (defined(__SSE2__) || defined(_M_X64))
+#define MOP_MATH_SSE2 1
+#include <emmintrin.h>
+#elif !defined(MOP_MATH_SCALAR) && defined(__ARM_NEON)
+#define MOP_MATH_NEON 1
+#include <arm_neon.h>
+#endif
+
+/* out = a * b.  out may alias a or b. */
+static inline void mop_m4_mul(const MopMat4 *a, const MopMat4 *b,
+                              MopMat4 *out) {
+#if defined(MOP_MATH_SSE2)
+  __m128 a0 = _mm_loadu_ps(a->d + 0), a1 = _mm_loadu_ps(a->d + 4);
+  __m128 a2 = _mm_loadu_ps(a->d + 8), a3 = _mm_loadu_ps(a->d + 12);
+  __m128 r[4];
+  for (int c = 0; c < 4; c++) {
+    const float *bc = b->d + c * 4;
+    __m128 s = _mm_mul_ps(a0, _mm_set1_ps(bc[0]));
+    s = _mm_add_ps(s, _mm_mul_ps(a1, _mm_set1_ps(bc[1])));
+    s = _mm_add_ps(s, _mm_mul_ps(a2, _mm_set1_ps(bc[2])));
+    r[c] = _mm_add_ps(s, _mm_mul_ps(a3, _mm_set1_ps(bc[3])));
+  }
+  for (int c = 0; c < 4; c++)
+    _mm_storeu_ps(out->d + c * 4, r[c]);
+#elif defined(MOP_MATH_NEON)
+  float32x4_t a0 = vld1q_f32(a->d + 0), a1 = vld1q_f32(a->d + 4);
+  float32x4_t a2 = vld1q_f32(a->d + 8), a3 = vld1q_f32(a->d + 12);
+  float32x4_t r[4];
+  for (int c = 0; c < 4; c++) {
+    const float *bc = b->d + c * 4;
+    float32x4_t s = vmulq_n_f32(a0, bc[0]);
+    s = vaddq_f32(s, vmulq_n_f32(a1, bc[1]));
+    s = vaddq_f32(s, vmulq_n_f32(a2, bc[2]));
+    r[c] = vaddq_f32(s, vmulq_n_f32(a3, bc[3]));
+  }
+  for (int c = 0; c < 4; c++)
+    vst1q_f32(out->d + c * 4, r[c]);
+#else
+  MopMat4 r;
+  for (int c = 0; c < 4; c++) {
+    const float *bc = b->d + c * 4;
+    for (int row = 0; row < 4; row++) {
+      float s = a->d[row] * bc[0];
+      s += a->d[4 + row] * bc[1];
+      s += a->d[8 + row] * bc[2];
+      r.d[c * 4 + row] = s + a->d[12 + row] * bc[3];
+    }
+  }
+  *out = r;
+#endif
+}
+
+/* m * (x, y, z, w) */
+static inline MopVec4 mop_m4_mul_xyzw(const MopMat4 *m, float x, float y,
+                                      float z, float w) {
+  MopVec4 r;
+#if defined(MOP_MATH_SSE2)
+  __m128 s = _mm_mul_ps(_mm_loadu_ps(m->d + 0), _mm_set1_ps(x));
+  s = _mm_add_ps(s, _mm_mul_ps(_mm_loadu_ps(m->d + 4), _mm_set1_ps(y)));
+  s = _mm_add_ps(s, _mm_mul_ps(_mm_loadu_ps(m->d + 8), _mm_set1_ps(z)));
+  s = _mm_add_ps(s, _mm_mul_ps(_mm_loadu_ps(m->d + 12), _mm_set1_ps(w)));
+  _mm_storeu_ps(&r.x, s);
+#elif defined(MOP_MATH_NEON)
+  float32x4_t s = vmulq_n_f32(vld1q_f32(m->d + 0), x);
+  s = vaddq_f32(s, vmulq_n_f32(vld1q_f32(m->d + 4), y));
+  s = vaddq_f32(s, vmulq_n_f32(vld1q_f32(m->d + 8), z));
+  s = vaddq_f32(s, vmulq_n_f32(vld1q_f32(m->d + 12), w));
+  vst1q_f32(&r.x, s);
+#else
+  const float *d = m->d;
+  r.x = d[0] * x + d[4] * y + d[8] * z + d[12] * w;
+  r.y = d[1] * x + d[5] * y + d[9] * z + d[13] * w;
+  r.z = d[2] * x + d[6] * y + d[10] * z + d[14] * w;
+  r.w = d[3] * x + d[7] * y + d[11] * z + d[15] * w;
+#endif
+  return r;
+}
+
+/* m * (p, 1) — the w = 1 column is added rather than multiplied, which
+ * is exact, so this matches mop_m4_mul_xyzw(m, x, y, z, 1) bit for bit */
+static inline MopVec4 mop_m4_transform_point(const MopMat4 *m,
+                                             const float *p) {
+  MopVec4 r;
+#if defined(MOP_MATH_SSE2)
+  __m128 s = _mm_mul_ps(_mm_loadu_ps(m->d + 0), _mm_set1_ps(p[0]));
+  s = _mm_add_ps(s, _mm_mul_ps(_mm_loadu_ps(m->d + 4), _mm_set1_ps(p[1])));
+  s = _mm_add_ps(s, _mm_mul_ps(_mm_loadu_ps(m->d + 8), _mm_set1_ps(p[2])));
+  s = _mm_add_ps(s, _mm_loadu_ps(m->d + 12));
+  _mm_storeu_ps(&r.x, s);
+#elif defined(MOP_MATH_NEON)
+  float32x4_t s = vmulq_n_f32(vld1q_f32(m->d + 0), p[0]);
+  s = vaddq_f32(s, vmulq_n_f32(vld1q_f32(m->d + 4), p[1]));
+  s = vaddq_f32(s, vmulq_n_f32(vld1q_f32(m->d + 8), p[2]));
+  s = vaddq_f32(s, vld1q_f32(m->d + 12));
+  vst1q_f32(&r.x, s);
+#else
+  r = mop_m4_mul_xyzw(m, p[0], p[1], p[2], 1.0f);
+#endif
+  return r;
+}
+
+/* ---- 4-wide float lanes ---- */
+
+#if defined(MOP_MATH_SSE2)
+typedef __m128 v4;
+static inline v4 v4_load(const float *p) { return _mm_loadu_ps(p); }
+static inline void v4_store(float *p, v4 a) { _mm_storeu_ps(p, a); }
+static inline v4 v4_add(v4 a, v4 b) { return _mm_add_ps(a, b); }
+static inline v4 v4_sub(v4 a, v4 b) { return _mm_sub_ps(a, b); }
+static inline v4 v4_mul(v4 a, v4 b) { return _mm_mul_ps(a, b); }
+static inline v4 v4_set1(float s) { return _mm_set1_ps(s); }
+static inline v4 v4_rgb(float s) { return _mm_setr_ps(s, s, s, 0.0f); }
+/* Negative and NaN lanes to 0, the rest clamped to hi */
+static inline v4 v4_sanitize(v4 a, float hi) {
+  return _mm_min_ps(_mm_max_ps(a, _mm_setzero_ps()), _mm_set1_ps(hi));
+}
+#elif defined(MOP_MATH_NEON)
+typedef float32x4_t v4;
+static inline v4 v4_load(const float *p) { return vld1q_f32(p); }
+static inline void v4_store(float *p, v4 a) { vst1q_f32(p, a); }
+static inline v4 v4_add(v4 a, v4 b) { return vaddq_f32(a, b); }
+static inline v4 v4_sub(v4 a, v4 b) { return vsubq_f32(a, b); }
+static inline v4 v4_mul(v4 a, v4 b) { return vmulq_f32(a, b); }
+static inline v4 v4_set1(float s) { return vdupq_n_f32(s); }
+static inline v4 v4_rgb(float s) {
+  return vsetq_lane_f32(0.0f, vdupq_n_f32(s), 3);
+}
+static inline v4 v4_sanitize(v4 a, float hi) {
+  v4 zero = vdupq_n_f32(0.0f);
+  v4 pos = vbslq_f32(vcgtq_f32(a, zero), a, zero);
+  return vminq_f32(pos, vdupq_n_f32(hi));
+}
+#else
+typedef struct v4 {
+  float v[4];
+} v4;
+static inline v4 v4_load(const float *p) {
+  return (v4){{p[0], p[1], p[2], p[3]}};
+}
+static inline void v4_store(float *p, v4 a) {
+  for (int i = 0; i < 4; i++)
+    p[i] = a.v[i];
+}
+static inline v4 v4_add(v4 a, v4 b) {
+  for (int i = 0; i < 4; i++)
+    a.v[i] += b.v[i];
+  return a;
+}
+static inline v4 v4_sub(v4 a, v4 b) {
+  for (int i = 0; i < 4; i++)
+    a.v[i] -= b.v[i];
+  return a;
+}
+static inline v4 v4_mul(v4 a, v4 b) {
+  for (int i = 0; i < 4; i++)
+    a.v[i] *= b.v[i];
+  return a;
+}
+static inline v4 v4_set1(float s) { return (v4){{s, s, s, s}}; }
+static inline v4 v4_rgb(float s) { return (v4){{s, s, s, 0.0f}}; }
+static inline v4 v4_sanitize(v4 a, float hi) {
+  for (int i = 0; i < 4; i++)
+    a.v[i] = a.v[i] > 0.0f ? (a.v[i] < hi ? a.v[i] : hi) : 0.0f;
+  return a;
+}
+#endif
+
+/* Clamp to [0, 1], NaN to 0 */
+static inline v4 v4_sat(v4 a) { return v4_sanitize(a, 1.0f); }
+
+#endif /* MOP_MATH_SIMD_H */
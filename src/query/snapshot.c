@@ -6,6 +6,7 @@
  */
 
 #include "core/viewport_internal.h"
+#include "math/math_simd.h"
 
 #include <math.h>
 
@@ -172,19 +173,18 @@ bool mop_triangle_iter_next(MopTriangleIter *iter, MopTriangle *out) {
       const MopVertex *v1 = &mv->vertices[i1];
       const MopVertex *v2 = &mv->vertices[i2];
 
-      MopMat4 w = mv->world_transform;
-      MopMat4 nm = iter->_normal_matrix;
+      const MopMat4 *w = &mv->world_transform;
+      const MopMat4 *nm = &iter->_normal_matrix;
 
       /* Transform positions to world space */
       for (int k = 0; k < 3; k++) {
         const MopVertex *v = (k == 0) ? v0 : (k == 1) ? v1 : v2;
-        MopVec4 wp = mop_mat4_mul_vec4(
-            w, (MopVec4){v->position.x, v->position.y, v->position.z, 1.0f});
+        MopVec4 wp = mop_m4_transform_point(w, &v->position.x);
         out->p[k] = (MopVec3){wp.x, wp.y, wp.z};
 
         /* Transform normal (no translation, normalize) */
-        MopVec4 wn = mop_mat4_mul_vec4(
-            nm, (MopVec4){v->normal.x, v->normal.y, v->normal.z, 0.0f});
+        MopVec4 wn = mop_m4_mul_xyzw(nm, v->normal.x, v->normal.y,
+                                     v->normal.z, 0.0f);
         out->n[k] = mop_vec3_normalize((MopVec3){wn.x, wn.y, wn.z});
 
         out->c[k] = v->color;
@@ -6,6 +6,7 @@
  */
 
 #include "core/viewport_internal.h"
+#include "math/math_simd.h"
 
 #include <float.h>
 #include <math.h>
@@ -48,12 +49,13 @@ MopAABB mop_mesh_get_aabb_local(const MopMesh *mesh, const MopViewport *vp) {
 
     const uint8_t *bytes = (const uint8_t *)raw;
     uint32_t stride = mesh->vertex_format->stride;
-    const float *first = (const float *)(bytes + pos_attr->offset);
-    box.min = box.max = (MopVec3){first[0], first[1], first[2]};
+    float p[4];
+    mop_vertex_attrib_read(mesh->vertex_format, pos_attr, bytes, p);
+    box.min = box.max = (MopVec3){p[0], p[1], p[2]};
 
     for (uint32_t i = 1; i < count; i++) {
-      const float *p =
-          (const float *)(bytes + (size_t)i * stride + pos_attr->offset);
+      mop_vertex_attrib_read(mesh->vertex_format, pos_attr,
+                             bytes + (size_t)i * stride, p);
       if (p[0] < box.min.x)
         box.min.x = p[0];
       if (p[1] < box.min.y)
@@ -104,8 +106,6 @@ MopAABB mop_mesh_get_aabb_world(const MopMesh *mesh, const MopViewport *vp) {
   if (!mesh)
     return local;
 
-  MopMat4 w = mesh->world_transform;
-
   /* 8 corners of the local AABB */
   MopVec3 corners[8] = {
       {local.min.x, local.min.y, local.min.z},
@@ -117,27 +117,24 @@ MopAABB mop_mesh_get_aabb_world(const MopMesh *mesh, const MopViewport *vp) {
       {local.min.x, local.max.y, local.max.z},
       {local.max.x, local.max.y, local.max.z},
   };
+  MopVec4 tp[8];
+  mop_mat4_transform_points(&mesh->world_transform, corners, 0, 8, tp);
 
-  MopVec4 first = mop_mat4_mul_vec4(
-      w, (MopVec4){corners[0].x, corners[0].y, corners[0].z, 1.0f});
-  MopAABB result = {.min = {first.x, first.y, first.z},
-                    .max = {first.x, first.y, first.z}};
-
+  MopAABB result = {.min = {tp[0].x, tp[0].y, tp[0].z},
+                    .max = {tp[0].x, tp[0].y, tp[0].z}};
   for (int i = 1; i < 8; i++) {
-    MopVec4 tp = mop_mat4_mul_vec4(
-        w, (MopVec4){corners[i].x, corners[i].y, corners[i].z, 1.0f});
-    if (tp.x < result.min.x)
-      result.min.x = tp.x;
-    if (tp.y < result.min.y)
-      result.min.y = tp.y;
-    if (tp.z < result.min.z)
-      result.min.z = tp.z;
-    if (tp.x > result.max.x)
-      result.max.x = tp.x;
-    if (tp.y > result.max.y)
-      result.max.y = tp.y;
-    if (tp.z > result.max.z)
-      result.max.z = tp.z;
+    if (tp[i].x < result.min.x)
+      result.min.x = tp[i].x;
+    if (tp[i].y < result.min.y)
+      result.min.y = tp[i].y;
+    if (tp[i].z < result.min.z)
+      result.min.z = tp[i].z;
+    if (tp[i].x > result.max.x)
+      result.max.x = tp[i].x;
+    if (tp[i].y > result.max.y)
+      result.max.y = tp[i].y;
+    if (tp[i].z > result.max.z)
+      result.max.z = tp[i].z;
   }
 
   return result;
@@ -435,7 +432,7 @@ MopRayHit mop_viewport_raycast_ray(const MopViewport *vp, MopRay ray) {
     if (!verts || !indices)
       continue;
 
-    MopMat4 w = mesh->world_transform;
+    const MopMat4 *w = &mesh->world_transform;
     uint32_t tri_count = mesh->index_count / 3;
 
     for (uint32_t ti = 0; ti < tri_count; ti++) {
@@ -447,15 +444,9 @@ MopRayHit mop_viewport_raycast_ray(const MopViewport *vp, MopRay ray) {
         continue;
 
       /* Transform to world space */
-      MopVec4 wp0 = mop_mat4_mul_vec4(w, (MopVec4){verts[i0].position.x,
-                                                   verts[i0].position.y,
-                                                   verts[i0].position.z, 1.0f});
-      MopVec4 wp1 = mop_mat4_mul_vec4(w, (MopVec4){verts[i1].position.x,
-                                                   verts[i1].position.y,
-                                                   verts[i1].position.z, 1.0f});
-      MopVec4 wp2 = mop_mat4_mul_vec4(w, (MopVec4){verts[i2].position.x,
-                                                   verts[i2].position.y,
-                                                   verts[i2].position.z, 1.0f});
+      MopVec4 wp0 = mop_m4_transform_point(w, &verts[i0].position.x);
+      MopVec4 wp1 = mop_m4_transform_point(w, &verts[i1].position.x);
+      MopVec4 wp2 = mop_m4_transform_point(w, &verts[i2].position.x);
 
       MopVec3 p0 = {wp0.x, wp0.y, wp0.z};
       MopVec3 p1 = {wp1.x, wp1.y, wp1.z};
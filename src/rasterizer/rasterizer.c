@@ -3,7 +3,7 @@
  * rasterizer.c — Full software triangle rasterization
  *
  * Implements:
- *   - Sutherland-Hodgman frustum clipping
+ *   - Guard-band clipping (Sutherland-Hodgman on near/far, wide x/y band)
  *   - Perspective division and viewport transform
  *   - Half-space triangle rasterization
  *   - Depth buffering
@@ -16,6 +16,10 @@
  */
 
 #include "rasterizer.h"
+#include "rasterizer_material.h"
+#include "rasterizer_oit.h"
+#include "math/math_simd.h"
+
 #include <math.h>
 #include <mop/util/log.h>
 #include <stdlib.h>
@@ -156,6 +160,51 @@ void mop_sw_shadow_clear(void) {
   s_shadow_h = 0;
 }
 
+/* ---- Screen-door dither state (LOD cross-fades) ---- */
+
+static const uint8_t k_bayer4[4][4] = {
+    {0, 8, 2, 10}, {12, 4, 14, 6}, {3, 11, 1, 9}, {15, 7, 13, 5}};
+
+static bool s_dither_on = false;
+static bool s_dither_invert = false;
+static int s_dither_cut = 16; /* pattern values below this pass */
+
+void mop_sw_dither_set(float threshold, bool invert) {
+  if (!(threshold > 0.0f)) {
+    mop_sw_dither_clear();
+    return;
+  }
+  int cut = (int)(threshold * 16.0f + 0.5f);
+  s_dither_cut = cut > 16 ? 16 : cut;
+  s_dither_invert = invert;
+  s_dither_on = true;
+}
+
+void mop_sw_dither_clear(void) {
+  s_dither_on = false;
+  s_dither_invert = false;
+  s_dither_cut = 16;
+}
+
+/* True if pixel (x, y) belongs to the current draw's dither pattern */
+static inline bool dither_keep(int x, int y) {
+  if (!s_dither_on)
+    return true;
+  return (k_bayer4[y & 3][x & 3] < s_dither_cut) != s_dither_invert;
+}
+
+/* ---- Shader plugin binding (per draw) ---- */
+
+static const MopSwShader *s_shader = NULL;
+
+void mop_sw_shader_set(const MopSwShader *shader) {
+  s_shader = shader && shader->fragment ? shader : NULL;
+}
+
+void mop_sw_shader_clear(void) { s_shader = NULL; }
+
+const MopSwShader *mop_sw_shader_current(void) { return s_shader; }
+
 /* ---- IBL (Image-Based Lighting) state ---- */
 
 typedef struct MopSwIBLState {
@@ -306,8 +355,7 @@ static float shadow_test_pcf(MopVec3 world_pos) {
   if (!s_shadow_depth)
     return 1.0f;
 
-  MopVec4 p = {world_pos.x, world_pos.y, world_pos.z, 1.0f};
-  MopVec4 lp = mop_mat4_mul_vec4(s_shadow_vp, p);
+  MopVec4 lp = mop_m4_transform_point(&s_shadow_vp, &world_pos.x);
 
   if (lp.w <= 0.0f)
     return 1.0f;
@@ -354,13 +402,26 @@ static float shadow_test_pcf(MopVec3 world_pos) {
  * perspective.  No color, no object ID, no shading — just depth writes.
  * ------------------------------------------------------------------------- */
 
-void mop_sw_shadow_render_mesh(const MopVertex *vertices, uint32_t vertex_count,
+void mop_sw_shadow_render_mesh(const float *positions, size_t stride,
+                               uint32_t vertex_count,
                                const uint32_t *indices, uint32_t index_count,
                                MopMat4 model, MopMat4 light_vp,
                                MopSwFramebuffer *shadow_fb) {
-  MopMat4 mvp = mop_mat4_multiply(light_vp, model);
+  MopMat4 mvp;
+  mop_m4_mul(&light_vp, &model, &mvp);
   float half_w = (float)shadow_fb->width * 0.5f;
   float half_h = (float)shadow_fb->height * 0.5f;
+  const uint8_t *base = (const uint8_t *)positions;
+
+  /* Each vertex is shared by ~6 triangles: transform the buffer once
+   * unless the index list only touches a small part of it */
+  MopVec4 *clip = NULL;
+  if (index_count >= vertex_count) {
+    clip = malloc((size_t)vertex_count * sizeof(MopVec4));
+    if (clip)
+      mop_mat4_transform_points(&mvp, (const MopVec3 *)positions, stride,
+                                vertex_count, clip);
+  }
 
   for (uint32_t i = 0; i + 2 < index_count; i += 3) {
     uint32_t i0 = indices[i + 0];
@@ -369,16 +430,19 @@ void mop_sw_shadow_render_mesh(const MopVertex *vertices, uint32_t vertex_count,
     if (i0 >= vertex_count || i1 >= vertex_count || i2 >= vertex_count)
       continue;
 
-    MopVec4 p0 = {vertices[i0].position.x, vertices[i0].position.y,
-                  vertices[i0].position.z, 1.0f};
-    MopVec4 p1 = {vertices[i1].position.x, vertices[i1].position.y,
-                  vertices[i1].position.z, 1.0f};
-    MopVec4 p2 = {vertices[i2].position.x, vertices[i2].position.y,
-                  vertices[i2].position.z, 1.0f};
-
-    MopVec4 c0 = mop_mat4_mul_vec4(mvp, p0);
-    MopVec4 c1 = mop_mat4_mul_vec4(mvp, p1);
-    MopVec4 c2 = mop_mat4_mul_vec4(mvp, p2);
+    MopVec4 c0, c1, c2;
+    if (clip) {
+      c0 = clip[i0];
+      c1 = clip[i1];
+      c2 = clip[i2];
+    } else {
+      c0 = mop_m4_transform_point(
+          &mvp, (const float *)(base + (size_t)i0 * stride));
+      c1 = mop_m4_transform_point(
+          &mvp, (const float *)(base + (size_t)i1 * stride));
+      c2 = mop_m4_transform_point(
+          &mvp, (const float *)(base + (size_t)i2 * stride));
+    }
 
     /* Trivial reject */
     if ((c0.x < -c0.w && c1.x < -c1.w && c2.x < -c2.w) ||
@@ -490,6 +554,7 @@ void mop_sw_shadow_render_mesh(const MopVertex *vertices, uint32_t vertex_count,
       w2_row += e2_dy;
     }
   }
+  free(clip);
 }
 
 /* -------------------------------------------------------------------------
@@ -520,34 +585,61 @@ static const ClipPlane FRUSTUM_PLANES[6] = {
     {0.0f, 0.0f, -1.0f, 1.0f}, /* -Z: w - z >= 0 */
 };
 
+/* Guard band, in viewport half-extents from the centre.  The triangle
+ * setup clamps its bounding box to the framebuffer, so x and y only need
+ * clipping to keep screen coordinates small enough for float edge
+ * functions: at 8 half-extents an 8K target stays under 2^16 pixels,
+ * where floats still resolve 1/256 pixel.  Near and far are always
+ * clipped, which also removes w <= 0. */
+#define GUARD_BAND 8.0f
+
+static const ClipPlane GUARD_PLANES[6] = {
+    {1.0f, 0.0f, 0.0f, GUARD_BAND},  /* +X: G*w + x >= 0 */
+    {-1.0f, 0.0f, 0.0f, GUARD_BAND}, /* -X: G*w - x >= 0 */
+    {0.0f, 1.0f, 0.0f, GUARD_BAND},  /* +Y: G*w + y >= 0 */
+    {0.0f, -1.0f, 0.0f, GUARD_BAND}, /* -Y: G*w - y >= 0 */
+    {0.0f, 0.0f, 1.0f, 1.0f},        /* near: w + z >= 0 */
+    {0.0f, 0.0f, -1.0f, 1.0f},       /* far:  w - z >= 0 */
+};
+
 static float clip_distance(const ClipPlane *plane, MopVec4 pos) {
   return plane->nx * pos.x + plane->ny * pos.y + plane->nz * pos.z +
          plane->nw * pos.w;
 }
 
-static MopSwClipVertex lerp_vertex(MopSwClipVertex a, MopSwClipVertex b,
-                                   float t) {
-  MopSwClipVertex result;
-  result.position.x = a.position.x + t * (b.position.x - a.position.x);
-  result.position.y = a.position.y + t * (b.position.y - a.position.y);
-  result.position.z = a.position.z + t * (b.position.z - a.position.z);
-  result.position.w = a.position.w + t * (b.position.w - a.position.w);
-  result.normal.x = a.normal.x + t * (b.normal.x - a.normal.x);
-  result.normal.y = a.normal.y + t * (b.normal.y - a.normal.y);
-  result.normal.z = a.normal.z + t * (b.normal.z - a.normal.z);
-  result.world_pos.x = a.world_pos.x + t * (b.world_pos.x - a.world_pos.x);
-  result.world_pos.y = a.world_pos.y + t * (b.world_pos.y - a.world_pos.y);
-  result.world_pos.z = a.world_pos.z + t * (b.world_pos.z - a.world_pos.z);
-  result.color.r = a.color.r + t * (b.color.r - a.color.r);
-  result.color.g = a.color.g + t * (b.color.g - a.color.g);
-  result.color.b = a.color.b + t * (b.color.b - a.color.b);
-  result.color.a = a.color.a + t * (b.color.a - a.color.a);
-  result.u = a.u + t * (b.u - a.u);
-  result.v = a.v + t * (b.v - a.v);
-  result.tangent.x = a.tangent.x + t * (b.tangent.x - a.tangent.x);
-  result.tangent.y = a.tangent.y + t * (b.tangent.y - a.tangent.y);
-  result.tangent.z = a.tangent.z + t * (b.tangent.z - a.tangent.z);
-  return result;
+/* Bit i set = pos is outside planes[i].  NaN counts as outside. */
+static unsigned clip_outcode(const ClipPlane planes[6], MopVec4 pos) {
+  unsigned code = 0;
+  for (int i = 0; i < 6; i++)
+    if (!(clip_distance(&planes[i], pos) >= 0.0f))
+      code |= 1u << i;
+  return code;
+}
+
+static void lerp_vertex(const MopSwClipVertex *a, const MopSwClipVertex *b,
+                        float t, MopSwClipVertex *result) {
+  result->position.x = a->position.x + t * (b->position.x - a->position.x);
+  result->position.y = a->position.y + t * (b->position.y - a->position.y);
+  result->position.z = a->position.z + t * (b->position.z - a->position.z);
+  result->position.w = a->position.w + t * (b->position.w - a->position.w);
+  result->normal.x = a->normal.x + t * (b->normal.x - a->normal.x);
+  result->normal.y = a->normal.y + t * (b->normal.y - a->normal.y);
+  result->normal.z = a->normal.z + t * (b->normal.z - a->normal.z);
+  result->world_pos.x =
+      a->world_pos.x + t * (b->world_pos.x - a->world_pos.x);
+  result->world_pos.y =
+      a->world_pos.y + t * (b->world_pos.y - a->world_pos.y);
+  result->world_pos.z =
+      a->world_pos.z + t * (b->world_pos.z - a->world_pos.z);
+  result->color.r = a->color.r + t * (b->color.r - a->color.r);
+  result->color.g = a->color.g + t * (b->color.g - a->color.g);
+  result->color.b = a->color.b + t * (b->color.b - a->color.b);
+  result->color.a = a->color.a + t * (b->color.a - a->color.a);
+  result->u = a->u + t * (b->u - a->u);
+  result->v = a->v + t * (b->v - a->v);
+  result->tangent.x = a->tangent.x + t * (b->tangent.x - a->tangent.x);
+  result->tangent.y = a->tangent.y + t * (b->tangent.y - a->tangent.y);
+  result->tangent.z = a->tangent.z + t * (b->tangent.z - a->tangent.z);
 }
 
 static int clip_against_plane(const MopSwClipVertex *in, int n,
@@ -557,32 +649,30 @@ static int clip_against_plane(const MopSwClipVertex *in, int n,
     return 0;
 
   int out_count = 0;
-  MopSwClipVertex prev = in[n - 1];
-  float prev_dist = clip_distance(plane, prev.position);
+  const MopSwClipVertex *prev = &in[n - 1];
+  float prev_dist = clip_distance(plane, prev->position);
 
   for (int i = 0; i < n; i++) {
-    MopSwClipVertex curr = in[i];
-    float curr_dist = clip_distance(plane, curr.position);
+    const MopSwClipVertex *curr = &in[i];
+    float curr_dist = clip_distance(plane, curr->position);
 
     if (curr_dist >= 0.0f) {
       /* Current vertex is inside */
       if (prev_dist < 0.0f) {
         /* Previous was outside: emit intersection */
         float t = prev_dist / (prev_dist - curr_dist);
-        if (out_count < max_out) {
-          out[out_count++] = lerp_vertex(prev, curr, t);
-        }
+        if (out_count < max_out)
+          lerp_vertex(prev, curr, t, &out[out_count++]);
       }
       /* Emit current vertex */
       if (out_count < max_out) {
-        out[out_count++] = curr;
+        out[out_count++] = *curr;
       }
     } else if (prev_dist >= 0.0f) {
       /* Current is outside, previous was inside: emit intersection */
       float t = prev_dist / (prev_dist - curr_dist);
-      if (out_count < max_out) {
-        out[out_count++] = lerp_vertex(prev, curr, t);
-      }
+      if (out_count < max_out)
+        lerp_vertex(prev, curr, t, &out[out_count++]);
     }
 
     prev = curr;
@@ -625,6 +715,45 @@ int mop_sw_clip_polygon(const MopSwClipVertex *in_vertices, int n,
   return out_count;
 }
 
+/* Clip a triangle for rasterization: against near and far, and against
+ * the guard band only where a vertex lies beyond it.  Returns the vertex
+ * count of the polygon to fan (0 = nothing left) and points *poly at
+ * either in or out.  Most partially visible triangles need no clipping
+ * at all and are returned as-is. */
+static int clip_triangle(const MopSwClipVertex in[3],
+                         MopSwClipVertex out[MAX_CLIP_VERTICES],
+                         const MopSwClipVertex **poly) {
+  unsigned crossed = clip_outcode(GUARD_PLANES, in[0].position) |
+                     clip_outcode(GUARD_PLANES, in[1].position) |
+                     clip_outcode(GUARD_PLANES, in[2].position);
+  *poly = in;
+  if (!crossed)
+    return 3;
+
+  /* Ping-pong between out and tmp, starting so the last plane writes
+   * to out.  A plane no vertex crosses cannot cut the polygon, since
+   * clipping only adds points between existing vertices. */
+  MopSwClipVertex tmp[MAX_CLIP_VERTICES];
+  int planes = 0;
+  for (unsigned m = crossed; m; m &= m - 1)
+    planes++;
+  const MopSwClipVertex *src = in;
+  MopSwClipVertex *dst = (planes & 1) ? out : tmp;
+  int count = 3;
+  for (int p = 0; p < 6; p++) {
+    if (!(crossed & (1u << p)))
+      continue;
+    count = clip_against_plane(src, count, dst, MAX_CLIP_VERTICES,
+                               &GUARD_PLANES[p]);
+    if (count < 3)
+      return 0;
+    src = dst;
+    dst = (dst == out) ? tmp : out;
+  }
+  *poly = out;
+  return count;
+}
+
 /* -------------------------------------------------------------------------
  * Bresenham line drawing
  * ------------------------------------------------------------------------- */
@@ -647,7 +776,7 @@ void mop_sw_draw_line(MopSwFramebuffer *fb, int x0, int y0, float z0, int x1,
       float z = z0 + t * (z1 - z0);
       size_t idx = (size_t)y0 * (size_t)fb->width + (size_t)x0;
 
-      if (!depth_test || z < fb->depth[idx]) {
+      if ((!depth_test || z < fb->depth[idx]) && dither_keep(x0, y0)) {
         size_t ci = idx * 4;
         fb->color[ci + 0] = r;
         fb->color[ci + 1] = g;
@@ -695,7 +824,7 @@ static inline void aa_plot(MopSwFramebuffer *fb, int x, int y, float z,
 
   size_t idx = (size_t)y * (size_t)fb->width + (size_t)x;
 
-  if (depth_test && z >= fb->depth[idx])
+  if ((depth_test && z >= fb->depth[idx]) || !dither_keep(x, y))
     return;
 
   /* Alpha-blend with existing pixel */
@@ -879,6 +1008,21 @@ void mop_sw_draw_line_aa(MopSwFramebuffer *fb, float x0, float y0, float z0,
  * the bounding box.
  * ------------------------------------------------------------------------- */
 
+/* Narrow an inclusive pixel box to fb's scissor, if one is set */
+static inline void fb_scissor(const MopSwFramebuffer *fb, int *min_x,
+                              int *min_y, int *max_x, int *max_y) {
+  if (fb->clip_x1 <= fb->clip_x0)
+    return;
+  if (*min_x < fb->clip_x0)
+    *min_x = fb->clip_x0;
+  if (*min_y < fb->clip_y0)
+    *min_y = fb->clip_y0;
+  if (*max_x >= fb->clip_x1)
+    *max_x = fb->clip_x1 - 1;
+  if (*max_y >= fb->clip_y1)
+    *max_y = fb->clip_y1 - 1;
+}
+
 static float clamp01(float x) {
   if (x < 0.0f)
     return 0.0f;
@@ -927,6 +1071,7 @@ static void rasterize_filled_triangle(
     max_x = fb->width - 1;
   if (max_y >= fb->height)
     max_y = fb->height - 1;
+  fb_scissor(fb, &min_x, &min_y, &max_x, &max_y);
 
   /* Degenerate check */
   if (min_x > max_x || min_y > max_y)
@@ -998,7 +1143,7 @@ static void rasterize_filled_triangle(
       for (int x = min_x; x <= max_x; x++) {
         if (w0 >= 0.0f && w1 >= 0.0f && w2 >= 0.0f) {
           size_t idx = row + (size_t)x;
-          if (!depth_test || z < fb->depth[idx]) {
+          if ((!depth_test || z < fb->depth[idx]) && dither_keep(x, y)) {
             size_t ci = idx * 4;
             fb->color_hdr[ci + 0] = cr;
             fb->color_hdr[ci + 1] = cg;
@@ -1024,6 +1169,7 @@ static void rasterize_filled_triangle(
     }
   } else {
     /* ── Blended path: ALPHA, ADDITIVE, MULTIPLY ── */
+    MopSwOit *oit = blend_mode == MOP_BLEND_ALPHA ? fb->oit : NULL;
     float a_f = ca;
     float inv_a = 1.0f - a_f;
 
@@ -1035,42 +1181,46 @@ static void rasterize_filled_triangle(
       for (int x = min_x; x <= max_x; x++) {
         if (w0 >= 0.0f && w1 >= 0.0f && w2 >= 0.0f) {
           size_t idx = row + (size_t)x;
-          if (!depth_test || z < fb->depth[idx]) {
-            size_t ci = idx * 4;
-            float dr = fb->color_hdr[ci + 0];
-            float dg = fb->color_hdr[ci + 1];
-            float db = fb->color_hdr[ci + 2];
-            float or_, og, ob;
-
-            switch (blend_mode) {
-            case MOP_BLEND_ADDITIVE:
-              or_ = dr + cr * a_f;
-              og = dg + cg * a_f;
-              ob = db + cb * a_f;
-              break;
-            case MOP_BLEND_MULTIPLY:
-              or_ = dr * cr;
-              og = dg * cg;
-              ob = db * cb;
-              break;
-            default: /* MOP_BLEND_ALPHA / MOP_BLEND_OPAQUE with alpha < 1 */
-              or_ = cr * a_f + dr * inv_a;
-              og = cg * a_f + dg * inv_a;
-              ob = cb * a_f + db * inv_a;
-              break;
-            }
+          if ((!depth_test || z < fb->depth[idx]) && dither_keep(x, y)) {
+            if (oit) {
+              mop_sw_oit_add(fb, x, y, z, cr, cg, cb, a_f, object_id);
+            } else {
+              size_t ci = idx * 4;
+              float dr = fb->color_hdr[ci + 0];
+              float dg = fb->color_hdr[ci + 1];
+              float db = fb->color_hdr[ci + 2];
+              float or_, og, ob;
 
-            fb->color_hdr[ci + 0] = or_;
-            fb->color_hdr[ci + 1] = og;
-            fb->color_hdr[ci + 2] = ob;
-            fb->color_hdr[ci + 3] = 1.0f;
-            float c0 = or_ < 0.0f ? 0.0f : (or_ > 1.0f ? 1.0f : or_);
-            float c1 = og < 0.0f ? 0.0f : (og > 1.0f ? 1.0f : og);
-            float c2 = ob < 0.0f ? 0.0f : (ob > 1.0f ? 1.0f : ob);
-            fb->color[ci + 0] = (uint8_t)(c0 * 255.0f);
-            fb->color[ci + 1] = (uint8_t)(c1 * 255.0f);
-            fb->color[ci + 2] = (uint8_t)(c2 * 255.0f);
-            fb->color[ci + 3] = 255;
+              switch (blend_mode) {
+              case MOP_BLEND_ADDITIVE:
+                or_ = dr + cr * a_f;
+                og = dg + cg * a_f;
+                ob = db + cb * a_f;
+                break;
+              case MOP_BLEND_MULTIPLY:
+                or_ = dr * cr;
+                og = dg * cg;
+                ob = db * cb;
+                break;
+              default: /* MOP_BLEND_ALPHA / MOP_BLEND_OPAQUE with alpha < 1 */
+                or_ = cr * a_f + dr * inv_a;
+                og = cg * a_f + dg * inv_a;
+                ob = cb * a_f + db * inv_a;
+                break;
+              }
+
+              fb->color_hdr[ci + 0] = or_;
+              fb->color_hdr[ci + 1] = og;
+              fb->color_hdr[ci + 2] = ob;
+              fb->color_hdr[ci + 3] = 1.0f;
+              float c0 = or_ < 0.0f ? 0.0f : (or_ > 1.0f ? 1.0f : or_);
+              float c1 = og < 0.0f ? 0.0f : (og > 1.0f ? 1.0f : og);
+              float c2 = ob < 0.0f ? 0.0f : (ob > 1.0f ? 1.0f : ob);
+              fb->color[ci + 0] = (uint8_t)(c0 * 255.0f);
+              fb->color[ci + 1] = (uint8_t)(c1 * 255.0f);
+              fb->color[ci + 2] = (uint8_t)(c2 * 255.0f);
+              fb->color[ci + 3] = 255;
+            }
           }
         }
         w0 += e0_dx;
@@ -1122,26 +1272,13 @@ void mop_sw_rasterize_triangle(const MopSwClipVertex vertices[3],
       return;
   }
 
-  /* Trivial accept: all 3 vertices inside all 6 frustum planes.
-   * When true, skip the expensive Sutherland-Hodgman clipping.
-   * This is the common case for most visible triangles. */
+  /* Guard-band clip: triangles that merely overhang the viewport are
+   * rasterized as-is, the bounding box clamp acting as the scissor */
   const MopSwClipVertex *poly;
   MopSwClipVertex clipped[MAX_CLIP_VERTICES];
-  int poly_count;
-
-  if (a.w > 0.0f && b.w > 0.0f && c.w > 0.0f && a.x >= -a.w && a.x <= a.w &&
-      a.y >= -a.w && a.y <= a.w && a.z >= -a.w && a.z <= a.w && b.x >= -b.w &&
-      b.x <= b.w && b.y >= -b.w && b.y <= b.w && b.z >= -b.w && b.z <= b.w &&
-      c.x >= -c.w && c.x <= c.w && c.y >= -c.w && c.y <= c.w && c.z >= -c.w &&
-      c.z <= c.w) {
-    poly = vertices;
-    poly_count = 3;
-  } else {
-    poly_count = mop_sw_clip_polygon(vertices, 3, clipped, MAX_CLIP_VERTICES);
-    if (poly_count < 3)
-      return;
-    poly = clipped;
-  }
+  int poly_count = clip_triangle(vertices, clipped, &poly);
+  if (poly_count < 3)
+    return;
 
   /* Hoist invariants out of the triangle fan loop */
   MopVec3 norm_light = mop_vec3_normalize(light_dir);
@@ -1258,6 +1395,7 @@ void mop_sw_rasterize_triangle_smooth(const MopSwScreenVertex verts[3],
   float sx0 = verts[0].sx, sy0 = verts[0].sy, sz0 = verts[0].sz;
   float sx1 = verts[1].sx, sy1 = verts[1].sy, sz1 = verts[1].sz;
   float sx2 = verts[2].sx, sy2 = verts[2].sy, sz2 = verts[2].sz;
+  MopSwOit *oit = blend_mode == MOP_BLEND_ALPHA ? fb->oit : NULL;
 
   /* Bounding box */
   float fmin_x = sx0;
@@ -1294,6 +1432,7 @@ void mop_sw_rasterize_triangle_smooth(const MopSwScreenVertex verts[3],
     max_x = fb->width - 1;
   if (max_y >= fb->height)
     max_y = fb->height - 1;
+  fb_scissor(fb, &min_x, &min_y, &max_x, &max_y);
   if (min_x > max_x || min_y > max_y)
     return;
 
@@ -1370,7 +1509,7 @@ void mop_sw_rasterize_triangle_smooth(const MopSwScreenVertex verts[3],
           float z = b0 * sz0 + b1 * sz1 + b2 * sz2;
           size_t idx = (size_t)y * (size_t)width + (size_t)x;
 
-          if (!depth_test || z < fb->depth[idx]) {
+          if ((!depth_test || z < fb->depth[idx]) && dither_keep(x, y)) {
             /* Perspective-correct barycentric weights */
             float pc0 = b0 * iw0;
             float pc1 = b1 * iw1;
@@ -1443,6 +1582,8 @@ void mop_sw_rasterize_triangle_smooth(const MopSwScreenVertex verts[3],
               fb->color_hdr[ci + 3] = 1.0f;
               fb->depth[idx] = z;
               fb->object_id[idx] = object_id;
+            } else if (oit) {
+              mop_sw_oit_add(fb, x, y, z, pr, pg, pb, final_alpha, object_id);
             } else {
               float inv_fa = 1.0f - final_alpha;
               float dr = fb->color_hdr[ci + 0];
@@ -1820,15 +1961,429 @@ static void compute_multi_specular_ggx(MopVec3 normal, MopVec3 world_pos,
  *   - Perspective-correct interpolation
  *   - Edge anti-aliasing
  *   - Multi-light diffuse + GGX Cook-Torrance specular
+ *   - Per-pixel surfaces from a bound material program
+ *   - Shader plugin fragment callbacks, MOP_SHADER_BLOCK pixels at a time
  * ------------------------------------------------------------------------- */
 
+/* Per-triangle state shared by the pixels of smooth_ml */
+typedef struct MlTri {
+  const MopSwScreenVertex *verts;
+  uint32_t object_id;
+  float ambient;
+  float op; /* clamped opacity */
+  MopBlendMode blend_mode;
+  const MopLight *lights;
+  uint32_t light_count;
+  MopVec3 cam_eye;
+  float metallic, roughness;
+  MopSwOit *oit;
+  MopSwFramebuffer *fb;
+} MlTri;
+
+/* A covered pixel that passed the depth and dither tests */
+typedef struct MlPixel {
+  int x, y;
+  size_t idx;
+  float z;
+  float min_d;         /* edge distance, for AA coverage */
+  float pc0, pc1, pc2; /* perspective-correct barycentrics */
+} MlPixel;
+
+/* Per-pixel surface from a material program */
+typedef struct MlSurface {
+  float r, g, b;
+  float metallic, roughness;
+  float er, eg, eb; /* emissive */
+} MlSurface;
+
+/* Lit color of one pixel.  s = NULL shades the interpolated vertex
+ * color with the draw's metallic / roughness. */
+static void ml_light(const MlTri *t, const MlPixel *px, const MlSurface *s,
+                     float out[3]) {
+  const MopSwScreenVertex *verts = t->verts;
+  const MopLight *lights = t->lights;
+  uint32_t light_count = t->light_count;
+  float ambient = t->ambient;
+  float metallic = s ? s->metallic : t->metallic;
+  float roughness = s ? s->roughness : t->roughness;
+  float pc0 = px->pc0, pc1 = px->pc1, pc2 = px->pc2;
+
+  /* Interpolate normal */
+  MopVec3 n = {pc0 * verts[0].normal.x + pc1 * verts[1].normal.x +
+                   pc2 * verts[2].normal.x,
+               pc0 * verts[0].normal.y + pc1 * verts[1].normal.y +
+                   pc2 * verts[2].normal.y,
+               pc0 * verts[0].normal.z + pc1 * verts[1].normal.z +
+                   pc2 * verts[2].normal.z};
+  n = mop_vec3_normalize(n);
+
+  /* Base color: the material program's, else the interpolated vertex
+   * color */
+  float fr, fg, fb_;
+  if (s) {
+    fr = s->r;
+    fg = s->g;
+    fb_ = s->b;
+  } else {
+    fr = pc0 * verts[0].color.r + pc1 * verts[1].color.r +
+         pc2 * verts[2].color.r;
+    fg = pc0 * verts[0].color.g + pc1 * verts[1].color.g +
+         pc2 * verts[2].color.g;
+    fb_ = pc0 * verts[0].color.b + pc1 * verts[1].color.b +
+          pc2 * verts[2].color.b;
+  }
+
+  /* Interpolate world position for point/spot light attenuation */
+  MopVec3 world_pos = {
+      pc0 * verts[0].world_pos.x + pc1 * verts[1].world_pos.x +
+          pc2 * verts[2].world_pos.x,
+      pc0 * verts[0].world_pos.y + pc1 * verts[1].world_pos.y +
+          pc2 * verts[2].world_pos.y,
+      pc0 * verts[0].world_pos.z + pc1 * verts[1].world_pos.z +
+          pc2 * verts[2].world_pos.z};
+
+  /* Per-pixel view direction for specular */
+  MopVec3 view_dir = mop_vec3_normalize(mop_vec3_sub(t->cam_eye, world_pos));
+
+  /* Per-channel diffuse (applies light color per RGB) */
+  float lit_r, lit_g, lit_b;
+  compute_multi_light_rgb(n, world_pos, lights, light_count, ambient, &lit_r,
+                          &lit_g, &lit_b);
+
+  /* GGX specular (includes light color and π energy correction) */
+  float spec_r, spec_g, spec_b;
+  compute_multi_specular_ggx(n, world_pos, view_dir, lights, light_count,
+                             roughness, metallic, fr, fg, fb_, &spec_r, &spec_g,
+                             &spec_b);
+
+  /* PBR energy balance */
+  float diffuse_scale = 1.0f - metallic;
+
+  /* IBL (Image-Based Lighting) — uses precomputed maps when available,
+   * falls back to hemisphere gradient otherwise. */
+  float env_r = 0.0f, env_g = 0.0f, env_b = 0.0f;
+  float ibl_diff_r = 0.0f, ibl_diff_g = 0.0f, ibl_diff_b = 0.0f;
+
+  if (s_ibl.irradiance) {
+    /* IBL diffuse: irradiance map at surface normal */
+    float irr[3];
+    ibl_irradiance(n, irr);
+    ibl_diff_r = irr[0];
+    ibl_diff_g = irr[1];
+    ibl_diff_b = irr[2];
+  }
+
+  {
+    /* Reflect view direction around normal */
+    float vdn = mop_vec3_dot(view_dir, n);
+    MopVec3 refl = {2.0f * vdn * n.x - view_dir.x,
+                    2.0f * vdn * n.y - view_dir.y,
+                    2.0f * vdn * n.z - view_dir.z};
+
+    float ndv = mop_vec3_dot(n, view_dir);
+    if (ndv < 0.0f)
+      ndv = 0.0f;
+
+    /* F0: Fresnel at normal incidence */
+    float f0_r = 0.04f * (1.0f - metallic) + fr * metallic;
+    float f0_g = 0.04f * (1.0f - metallic) + fg * metallic;
+    float f0_b = 0.04f * (1.0f - metallic) + fb_ * metallic;
+
+    if (s_ibl.prefiltered && s_ibl.brdf_lut) {
+      /* IBL specular: split-sum approximation */
+      float pf[3];
+      ibl_prefiltered(refl, roughness, pf);
+      float brdf_s, brdf_b;
+      ibl_brdf(ndv, roughness, &brdf_s, &brdf_b);
+
+      env_r = pf[0] * (f0_r * brdf_s + brdf_b);
+      env_g = pf[1] * (f0_g * brdf_s + brdf_b);
+      env_b = pf[2] * (f0_b * brdf_s + brdf_b);
+    } else if (metallic > 0.01f) {
+      /* Fallback hemisphere gradient (no env map loaded) */
+      float sky_t = refl.y * 0.5f + 0.5f;
+      if (sky_t < 0.0f)
+        sky_t = 0.0f;
+      if (sky_t > 1.0f)
+        sky_t = 1.0f;
+
+      float sky_rv = 0.35f, sky_gv = 0.38f, sky_bv = 0.45f;
+      float gnd_rv = 0.08f, gnd_gv = 0.07f, gnd_bv = 0.06f;
+      float he_r = gnd_rv + sky_t * (sky_rv - gnd_rv);
+      float he_g = gnd_gv + sky_t * (sky_gv - gnd_gv);
+      float he_b = gnd_bv + sky_t * (sky_bv - gnd_bv);
+
+      float rough_mix = roughness * roughness;
+      float avg_env = (he_r + he_g + he_b) * (1.0f / 3.0f);
+      he_r += rough_mix * (avg_env - he_r);
+      he_g += rough_mix * (avg_env - he_g);
+      he_b += rough_mix * (avg_env - he_b);
+
+      float om = 1.0f - ndv;
+      float om2 = om * om;
+      float om5 = om2 * om2 * om;
+      float fe_r = f0_r + (1.0f - f0_r) * om5;
+      float fe_g = f0_g + (1.0f - f0_g) * om5;
+      float fe_b = f0_b + (1.0f - f0_b) * om5;
+
+      env_r = he_r * fe_r * ambient * 3.0f;
+      env_g = he_g * fe_g * ambient * 3.0f;
+      env_b = he_b * fe_b * ambient * 3.0f;
+    }
+  }
+
+  /* Final composition: IBL diffuse replaces flat ambient when
+   * irradiance map is available */
+  float pr, pg, pb;
+  if (s_ibl.irradiance) {
+    pr = fr * (lit_r + ibl_diff_r) * diffuse_scale + env_r + spec_r;
+    pg = fg * (lit_g + ibl_diff_g) * diffuse_scale + env_g + spec_g;
+    pb = fb_ * (lit_b + ibl_diff_b) * diffuse_scale + env_b + spec_b;
+  } else {
+    pr = fr * lit_r * diffuse_scale + env_r + spec_r;
+    pg = fg * lit_g * diffuse_scale + env_g + spec_g;
+    pb = fb_ * lit_b * diffuse_scale + env_b + spec_b;
+  }
+  if (s) {
+    pr += s->er;
+    pg += s->eg;
+    pb += s->eb;
+  }
+  if (pr < 0.0f)
+    pr = 0.0f;
+  if (pg < 0.0f)
+    pg = 0.0f;
+  if (pb < 0.0f)
+    pb = 0.0f;
+  out[0] = pr;
+  out[1] = pg;
+  out[2] = pb;
+}
+
+/* Blend color c at opacity op into one pixel */
+static void ml_write(const MlTri *t, const MlPixel *px, const float c[3],
+                     float op) {
+  MopBlendMode blend_mode = t->blend_mode;
+  MopSwFramebuffer *fb = t->fb;
+  float pr = c[0], pg = c[1], pb = c[2];
+  float z = px->z, min_d = px->min_d;
+  size_t idx = px->idx;
+
+  /* Edge AA coverage — disabled for opaque geometry to avoid
+   * seam artifacts at shared mesh edges.  FXAA post-process
+   * handles silhouette anti-aliasing instead. */
+  float cov =
+      (min_d < 1.0f && blend_mode != MOP_BLEND_OPAQUE) ? min_d : 1.0f;
+  float final_alpha = op * cov;
+
+  size_t ci = idx * 4;
+  if (blend_mode == MOP_BLEND_OPAQUE && final_alpha >= 1.0f) {
+    fb->color_hdr[ci + 0] = pr;
+    fb->color_hdr[ci + 1] = pg;
+    fb->color_hdr[ci + 2] = pb;
+    fb->color_hdr[ci + 3] = 1.0f;
+    fb->depth[idx] = z;
+    fb->object_id[idx] = t->object_id;
+  } else if (t->oit) {
+    mop_sw_oit_add(fb, px->x, px->y, z, pr, pg, pb, final_alpha,
+                   t->object_id);
+  } else {
+    float inv_fa = 1.0f - final_alpha;
+    float dr = fb->color_hdr[ci + 0];
+    float dg = fb->color_hdr[ci + 1];
+    float db = fb->color_hdr[ci + 2];
+
+    switch (blend_mode) {
+    case MOP_BLEND_ADDITIVE:
+      pr = dr + pr * final_alpha;
+      pg = dg + pg * final_alpha;
+      pb = db + pb * final_alpha;
+      break;
+    case MOP_BLEND_MULTIPLY:
+      pr = dr * pr;
+      pg = dg * pg;
+      pb = db * pb;
+      break;
+    default:
+      pr = pr * final_alpha + dr * inv_fa;
+      pg = pg * final_alpha + dg * inv_fa;
+      pb = pb * final_alpha + db * inv_fa;
+      break;
+    }
+    fb->color_hdr[ci + 0] = pr;
+    fb->color_hdr[ci + 1] = pg;
+    fb->color_hdr[ci + 2] = pb;
+    fb->color_hdr[ci + 3] = 1.0f;
+    if (final_alpha > 0.5f) {
+      fb->depth[idx] = z;
+      fb->object_id[idx] = t->object_id;
+    }
+  }
+}
+
+/* Light and write one pixel */
+static void ml_shade(const MlTri *t, const MlPixel *px, const MlSurface *s) {
+  float c[3];
+  ml_light(t, px, s, c);
+  ml_write(t, px, c, t->op);
+}
+
+static inline float ml_sat(float x) {
+  return x < 0.0f ? 0.0f : (x > 1.0f ? 1.0f : x);
+}
+
+/* Surfaces of n <= MOP_SW_MAT_LANES queued pixels from the bound
+ * material program */
+static void ml_surfaces(const MlTri *t, const MopSwMatProgram *prog,
+                        const MlPixel *q, int n, MlSurface *out) {
+  float regs[MOP_SW_MAT_MAX_REGS][MOP_SW_MAT_LANES];
+  const MopSwScreenVertex *v = t->verts;
+  bool need_ndv = prog->varyings & (1u << MOP_SW_MAT_REG_NDOTV);
+
+  for (int l = 0; l < MOP_SW_MAT_LANES; l++) {
+    if (l >= n) {
+      for (int r = 0; r < MOP_SW_MAT_REG_VARYINGS; r++)
+        regs[r][l] = 0.0f;
+      continue;
+    }
+    float w0 = q[l].pc0, w1 = q[l].pc1, w2 = q[l].pc2;
+    regs[MOP_SW_MAT_REG_U][l] = w0 * v[0].u + w1 * v[1].u + w2 * v[2].u;
+    regs[MOP_SW_MAT_REG_V][l] = w0 * v[0].v + w1 * v[1].v + w2 * v[2].v;
+    regs[MOP_SW_MAT_REG_R][l] =
+        w0 * v[0].color.r + w1 * v[1].color.r + w2 * v[2].color.r;
+    regs[MOP_SW_MAT_REG_G][l] =
+        w0 * v[0].color.g + w1 * v[1].color.g + w2 * v[2].color.g;
+    regs[MOP_SW_MAT_REG_B][l] =
+        w0 * v[0].color.b + w1 * v[1].color.b + w2 * v[2].color.b;
+    regs[MOP_SW_MAT_REG_A][l] =
+        w0 * v[0].color.a + w1 * v[1].color.a + w2 * v[2].color.a;
+    float ndv = 0.0f;
+    if (need_ndv) {
+      MopVec3 nrm = mop_vec3_normalize((MopVec3){
+          w0 * v[0].normal.x + w1 * v[1].normal.x + w2 * v[2].normal.x,
+          w0 * v[0].normal.y + w1 * v[1].normal.y + w2 * v[2].normal.y,
+          w0 * v[0].normal.z + w1 * v[1].normal.z + w2 * v[2].normal.z});
+      MopVec3 wp = {
+          w0 * v[0].world_pos.x + w1 * v[1].world_pos.x +
+              w2 * v[2].world_pos.x,
+          w0 * v[0].world_pos.y + w1 * v[1].world_pos.y +
+              w2 * v[2].world_pos.y,
+          w0 * v[0].world_pos.z + w1 * v[1].world_pos.z +
+              w2 * v[2].world_pos.z};
+      MopVec3 view = mop_vec3_normalize(mop_vec3_sub(t->cam_eye, wp));
+      ndv = ml_sat(mop_vec3_dot(nrm, view));
+    }
+    regs[MOP_SW_MAT_REG_NDOTV][l] = ndv;
+  }
+
+  mop_sw_material_run(regs, n);
+
+  const uint8_t *o = prog->out;
+  for (int l = 0; l < n; l++) {
+    MlSurface *s = &out[l];
+    *s = (MlSurface){
+        .r = ml_sat(regs[o[MOP_SW_MAT_OUT_BASE_R]][l]),
+        .g = ml_sat(regs[o[MOP_SW_MAT_OUT_BASE_G]][l]),
+        .b = ml_sat(regs[o[MOP_SW_MAT_OUT_BASE_B]][l]),
+        .metallic = ml_sat(regs[o[MOP_SW_MAT_OUT_METALLIC]][l]),
+        .roughness = ml_sat(regs[o[MOP_SW_MAT_OUT_ROUGHNESS]][l]),
+        .er = regs[o[MOP_SW_MAT_OUT_EMISSIVE_R]][l],
+        .eg = regs[o[MOP_SW_MAT_OUT_EMISSIVE_G]][l],
+        .eb = regs[o[MOP_SW_MAT_OUT_EMISSIVE_B]][l],
+    };
+    s->er = s->er > 0.0f ? s->er : 0.0f;
+    s->eg = s->eg > 0.0f ? s->eg : 0.0f;
+    s->eb = s->eb > 0.0f ? s->eb : 0.0f;
+  }
+}
+
+/* Hand n queued pixels to the bound fragment callback and write what it
+ * returns.  surf = NULL: no material program. */
+static void ml_fragment(const MlTri *t, const MopSwShader *sh,
+                        const MlPixel *q, int n, const MlSurface *surf) {
+  const MopSwScreenVertex *v = t->verts;
+  MopShaderFragmentBlock blk;
+  blk.count = (uint32_t)n;
+
+  for (int l = 0; l < n; l++) {
+    float w0 = q[l].pc0, w1 = q[l].pc1, w2 = q[l].pc2;
+#define ML_LERP(f) (w0 * v[0].f + w1 * v[1].f + w2 * v[2].f)
+    MopVec3 nrm = mop_vec3_normalize(
+        (MopVec3){ML_LERP(normal.x), ML_LERP(normal.y), ML_LERP(normal.z)});
+    blk.x[l] = q[l].x;
+    blk.y[l] = q[l].y;
+    blk.depth[l] = q[l].z;
+    blk.px[l] = ML_LERP(world_pos.x);
+    blk.py[l] = ML_LERP(world_pos.y);
+    blk.pz[l] = ML_LERP(world_pos.z);
+    blk.nx[l] = nrm.x;
+    blk.ny[l] = nrm.y;
+    blk.nz[l] = nrm.z;
+    blk.u[l] = ML_LERP(u);
+    blk.v[l] = ML_LERP(v);
+    blk.r[l] = surf ? surf[l].r : ML_LERP(color.r);
+    blk.g[l] = surf ? surf[l].g : ML_LERP(color.g);
+    blk.b[l] = surf ? surf[l].b : ML_LERP(color.b);
+    blk.a[l] = ML_LERP(color.a);
+#undef ML_LERP
+    if (sh->lit) {
+      float c[3];
+      ml_light(t, &q[l], surf ? &surf[l] : NULL, c);
+      blk.out_r[l] = c[0];
+      blk.out_g[l] = c[1];
+      blk.out_b[l] = c[2];
+    } else {
+      blk.out_r[l] = blk.r[l];
+      blk.out_g[l] = blk.g[l];
+      blk.out_b[l] = blk.b[l];
+    }
+    blk.out_a[l] = t->op;
+  }
+
+  sh->fragment(&blk, sh->uniform_size ? sh->uniforms : NULL, sh->user_data);
+
+  for (int l = 0; l < n; l++) {
+    if (!(blk.out_a[l] > 0.0f))
+      continue;
+    float c[3] = {blk.out_r[l] > 0.0f ? blk.out_r[l] : 0.0f,
+                  blk.out_g[l] > 0.0f ? blk.out_g[l] : 0.0f,
+                  blk.out_b[l] > 0.0f ? blk.out_b[l] : 0.0f};
+    ml_write(t, &q[l], c, ml_sat(blk.out_a[l]));
+  }
+}
+
+/* Pixels queued per flush: one fragment block, a whole number of
+ * material program batches */
+#define ML_QUEUE MOP_SHADER_BLOCK
+
+/* Shade n <= ML_QUEUE queued pixels of one row: material program
+ * surfaces first, then the fragment callback or the built-in lighting */
+static void ml_flush(const MlTri *t, const MopSwMatProgram *prog,
+                     const MopSwShader *sh, const MlPixel *q, int n) {
+  MlSurface surf[ML_QUEUE];
+  if (prog) {
+    for (int i = 0; i < n; i += MOP_SW_MAT_LANES) {
+      int m = n - i < MOP_SW_MAT_LANES ? n - i : MOP_SW_MAT_LANES;
+      ml_surfaces(t, prog, q + i, m, surf + i);
+    }
+  }
+  if (sh) {
+    ml_fragment(t, sh, q, n, prog ? surf : NULL);
+    return;
+  }
+  for (int l = 0; l < n; l++)
+    ml_shade(t, &q[l], prog ? &surf[l] : NULL);
+}
+
 void mop_sw_rasterize_triangle_smooth_ml(
     const MopSwScreenVertex verts[3], uint32_t object_id, bool depth_test,
     MopVec3 light_dir, float ambient, float opacity, MopBlendMode blend_mode,
     const MopLight *lights, uint32_t light_count, MopVec3 cam_eye,
     float metallic, float roughness, MopSwFramebuffer *fb) {
-  /* If no multi-light, fall back to standard smooth */
-  if (!lights || light_count == 0) {
+  /* If no multi-light, fall back to standard smooth (a fragment callback
+   * still gets its pixels, lit by the ambient term only) */
+  const MopSwShader *sh = mop_sw_shader_current();
+  if ((!lights || light_count == 0) && !sh) {
     mop_sw_rasterize_triangle_smooth(verts, object_id, depth_test, light_dir,
                                      ambient, opacity, blend_mode, fb);
     return;
@@ -1837,6 +2392,7 @@ void mop_sw_rasterize_triangle_smooth_ml(
   float sx0 = verts[0].sx, sy0 = verts[0].sy, sz0 = verts[0].sz;
   float sx1 = verts[1].sx, sy1 = verts[1].sy, sz1 = verts[1].sz;
   float sx2 = verts[2].sx, sy2 = verts[2].sy, sz2 = verts[2].sz;
+  MopSwOit *oit = blend_mode == MOP_BLEND_ALPHA ? fb->oit : NULL;
 
   /* Bounding box */
   float fmin_x = sx0;
@@ -1873,6 +2429,7 @@ void mop_sw_rasterize_triangle_smooth_ml(
     max_x = fb->width - 1;
   if (max_y >= fb->height)
     max_y = fb->height - 1;
+  fb_scissor(fb, &min_x, &min_y, &max_x, &max_y);
   if (min_x > max_x || min_y > max_y)
     return;
 
@@ -1917,8 +2474,26 @@ void mop_sw_rasterize_triangle_smooth_ml(
     w2_row = -w2_row;
   }
 
-  float op = clamp01(opacity);
   int width = fb->width;
+  MlTri tri = {.verts = verts,
+               .object_id = object_id,
+               .ambient = ambient,
+               .op = clamp01(opacity),
+               .blend_mode = blend_mode,
+               .lights = lights,
+               .light_count = light_count,
+               .cam_eye = cam_eye,
+               .metallic = metallic,
+               .roughness = roughness,
+               .oit = oit,
+               .fb = fb};
+
+  /* With a material program or fragment callback bound, covered pixels
+   * are queued and shaded ML_QUEUE at a time; the queue drains per row */
+  const MopSwMatProgram *prog = mop_sw_material_current();
+  bool batch = prog || sh;
+  MlPixel queue[ML_QUEUE];
+  int queued = 0;
 
   /* Per-vertex 1/w for perspective-correct interpolation */
   float iw0 = verts[0].inv_w, iw1 = verts[1].inv_w, iw2 = verts[2].inv_w;
@@ -1945,7 +2520,7 @@ void mop_sw_rasterize_triangle_smooth_ml(
           float z = b0 * sz0 + b1 * sz1 + b2 * sz2;
           size_t idx = (size_t)y * (size_t)width + (size_t)x;
 
-          if (!depth_test || z < fb->depth[idx]) {
+          if ((!depth_test || z < fb->depth[idx]) && dither_keep(x, y)) {
             /* Perspective-correct weights */
             float pc0 = b0 * iw0;
             float pc1 = b1 * iw1;
@@ -1955,187 +2530,14 @@ void mop_sw_rasterize_triangle_smooth_ml(
             pc1 *= inv_pc;
             pc2 *= inv_pc;
 
-            /* Interpolate normal */
-            MopVec3 n = {pc0 * verts[0].normal.x + pc1 * verts[1].normal.x +
-                             pc2 * verts[2].normal.x,
-                         pc0 * verts[0].normal.y + pc1 * verts[1].normal.y +
-                             pc2 * verts[2].normal.y,
-                         pc0 * verts[0].normal.z + pc1 * verts[1].normal.z +
-                             pc2 * verts[2].normal.z};
-            n = mop_vec3_normalize(n);
-
-            /* Interpolate color */
-            float fr = pc0 * verts[0].color.r + pc1 * verts[1].color.r +
-                       pc2 * verts[2].color.r;
-            float fg = pc0 * verts[0].color.g + pc1 * verts[1].color.g +
-                       pc2 * verts[2].color.g;
-            float fb_ = pc0 * verts[0].color.b + pc1 * verts[1].color.b +
-                        pc2 * verts[2].color.b;
-
-            /* Interpolate world position for point/spot light attenuation */
-            MopVec3 world_pos = {
-                pc0 * verts[0].world_pos.x + pc1 * verts[1].world_pos.x +
-                    pc2 * verts[2].world_pos.x,
-                pc0 * verts[0].world_pos.y + pc1 * verts[1].world_pos.y +
-                    pc2 * verts[2].world_pos.y,
-                pc0 * verts[0].world_pos.z + pc1 * verts[1].world_pos.z +
-                    pc2 * verts[2].world_pos.z};
-
-            /* Per-pixel view direction for specular */
-            MopVec3 view_dir =
-                mop_vec3_normalize(mop_vec3_sub(cam_eye, world_pos));
-
-            /* Per-channel diffuse (applies light color per RGB) */
-            float lit_r, lit_g, lit_b;
-            compute_multi_light_rgb(n, world_pos, lights, light_count, ambient,
-                                    &lit_r, &lit_g, &lit_b);
-
-            /* GGX specular (includes light color and π energy correction) */
-            float spec_r, spec_g, spec_b;
-            compute_multi_specular_ggx(n, world_pos, view_dir, lights,
-                                       light_count, roughness, metallic, fr, fg,
-                                       fb_, &spec_r, &spec_g, &spec_b);
-
-            /* PBR energy balance */
-            float diffuse_scale = 1.0f - metallic;
-
-            /* IBL (Image-Based Lighting) — uses precomputed maps when
-             * available, falls back to hemisphere gradient otherwise. */
-            float env_r = 0.0f, env_g = 0.0f, env_b = 0.0f;
-            float ibl_diff_r = 0.0f, ibl_diff_g = 0.0f, ibl_diff_b = 0.0f;
-
-            if (s_ibl.irradiance) {
-              /* IBL diffuse: irradiance map at surface normal */
-              float irr[3];
-              ibl_irradiance(n, irr);
-              ibl_diff_r = irr[0];
-              ibl_diff_g = irr[1];
-              ibl_diff_b = irr[2];
-            }
-
-            {
-              /* Reflect view direction around normal */
-              float vdn = mop_vec3_dot(view_dir, n);
-              MopVec3 refl = {2.0f * vdn * n.x - view_dir.x,
-                              2.0f * vdn * n.y - view_dir.y,
-                              2.0f * vdn * n.z - view_dir.z};
-
-              float ndv = mop_vec3_dot(n, view_dir);
-              if (ndv < 0.0f)
-                ndv = 0.0f;
-
-              /* F0: Fresnel at normal incidence */
-              float f0_r = 0.04f * (1.0f - metallic) + fr * metallic;
-              float f0_g = 0.04f * (1.0f - metallic) + fg * metallic;
-              float f0_b = 0.04f * (1.0f - metallic) + fb_ * metallic;
-
-              if (s_ibl.prefiltered && s_ibl.brdf_lut) {
-                /* IBL specular: split-sum approximation */
-                float pf[3];
-                ibl_prefiltered(refl, roughness, pf);
-                float brdf_s, brdf_b;
-                ibl_brdf(ndv, roughness, &brdf_s, &brdf_b);
-
-                env_r = pf[0] * (f0_r * brdf_s + brdf_b);
-                env_g = pf[1] * (f0_g * brdf_s + brdf_b);
-                env_b = pf[2] * (f0_b * brdf_s + brdf_b);
-              } else if (metallic > 0.01f) {
-                /* Fallback hemisphere gradient (no env map loaded) */
-                float sky_t = refl.y * 0.5f + 0.5f;
-                if (sky_t < 0.0f)
-                  sky_t = 0.0f;
-                if (sky_t > 1.0f)
-                  sky_t = 1.0f;
-
-                float sky_rv = 0.35f, sky_gv = 0.38f, sky_bv = 0.45f;
-                float gnd_rv = 0.08f, gnd_gv = 0.07f, gnd_bv = 0.06f;
-                float he_r = gnd_rv + sky_t * (sky_rv - gnd_rv);
-                float he_g = gnd_gv + sky_t * (sky_gv - gnd_gv);
-                float he_b = gnd_bv + sky_t * (sky_bv - gnd_bv);
-
-                float rough_mix = roughness * roughness;
-                float avg_env = (he_r + he_g + he_b) * (1.0f / 3.0f);
-                he_r += rough_mix * (avg_env - he_r);
-                he_g += rough_mix * (avg_env - he_g);
-                he_b += rough_mix * (avg_env - he_b);
-
-                float om = 1.0f - ndv;
-                float om2 = om * om;
-                float om5 = om2 * om2 * om;
-                float fe_r = f0_r + (1.0f - f0_r) * om5;
-                float fe_g = f0_g + (1.0f - f0_g) * om5;
-                float fe_b = f0_b + (1.0f - f0_b) * om5;
-
-                env_r = he_r * fe_r * ambient * 3.0f;
-                env_g = he_g * fe_g * ambient * 3.0f;
-                env_b = he_b * fe_b * ambient * 3.0f;
-              }
-            }
-
-            /* Final composition: IBL diffuse replaces flat ambient when
-             * irradiance map is available */
-            float pr, pg, pb;
-            if (s_ibl.irradiance) {
-              pr = fr * (lit_r + ibl_diff_r) * diffuse_scale + env_r + spec_r;
-              pg = fg * (lit_g + ibl_diff_g) * diffuse_scale + env_g + spec_g;
-              pb = fb_ * (lit_b + ibl_diff_b) * diffuse_scale + env_b + spec_b;
+            MlPixel px = {x, y, idx, z, min_d, pc0, pc1, pc2};
+            if (!batch) {
+              ml_shade(&tri, &px, NULL);
             } else {
-              pr = fr * lit_r * diffuse_scale + env_r + spec_r;
-              pg = fg * lit_g * diffuse_scale + env_g + spec_g;
-              pb = fb_ * lit_b * diffuse_scale + env_b + spec_b;
-            }
-            if (pr < 0.0f)
-              pr = 0.0f;
-            if (pg < 0.0f)
-              pg = 0.0f;
-            if (pb < 0.0f)
-              pb = 0.0f;
-
-            /* Edge AA coverage — disabled for opaque geometry to avoid
-             * seam artifacts at shared mesh edges.  FXAA post-process
-             * handles silhouette anti-aliasing instead. */
-            float cov =
-                (min_d < 1.0f && blend_mode != MOP_BLEND_OPAQUE) ? min_d : 1.0f;
-            float final_alpha = op * cov;
-
-            size_t ci = idx * 4;
-            if (blend_mode == MOP_BLEND_OPAQUE && final_alpha >= 1.0f) {
-              fb->color_hdr[ci + 0] = pr;
-              fb->color_hdr[ci + 1] = pg;
-              fb->color_hdr[ci + 2] = pb;
-              fb->color_hdr[ci + 3] = 1.0f;
-              fb->depth[idx] = z;
-              fb->object_id[idx] = object_id;
-            } else {
-              float inv_fa = 1.0f - final_alpha;
-              float dr = fb->color_hdr[ci + 0];
-              float dg = fb->color_hdr[ci + 1];
-              float db = fb->color_hdr[ci + 2];
-
-              switch (blend_mode) {
-              case MOP_BLEND_ADDITIVE:
-                pr = dr + pr * final_alpha;
-                pg = dg + pg * final_alpha;
-                pb = db + pb * final_alpha;
-                break;
-              case MOP_BLEND_MULTIPLY:
-                pr = dr * pr;
-                pg = dg * pg;
-                pb = db * pb;
-                break;
-              default:
-                pr = pr * final_alpha + dr * inv_fa;
-                pg = pg * final_alpha + dg * inv_fa;
-                pb = pb * final_alpha + db * inv_fa;
-                break;
-              }
-              fb->color_hdr[ci + 0] = pr;
-              fb->color_hdr[ci + 1] = pg;
-              fb->color_hdr[ci + 2] = pb;
-              fb->color_hdr[ci + 3] = 1.0f;
-              if (final_alpha > 0.5f) {
-                fb->depth[idx] = z;
-                fb->object_id[idx] = object_id;
+              queue[queued++] = px;
+              if (queued == ML_QUEUE) {
+                ml_flush(&tri, prog, sh, queue, queued);
+                queued = 0;
               }
             }
           }
@@ -2145,6 +2547,10 @@ void mop_sw_rasterize_triangle_smooth_ml(
       w1 += e1_dx;
       w2 += e2_dx;
     }
+    if (queued > 0) {
+      ml_flush(&tri, prog, sh, queue, queued);
+      queued = 0;
+    }
     w0_row += e0_dy;
     w1_row += e1_dy;
     w2_row += e2_dy;
@@ -2177,6 +2583,7 @@ void mop_sw_rasterize_triangle_smooth_nm(const MopSwScreenVertex verts[3],
   float sx0 = verts[0].sx, sy0 = verts[0].sy, sz0 = verts[0].sz;
   float sx1 = verts[1].sx, sy1 = verts[1].sy, sz1 = verts[1].sz;
   float sx2 = verts[2].sx, sy2 = verts[2].sy, sz2 = verts[2].sz;
+  MopSwOit *oit = blend_mode == MOP_BLEND_ALPHA ? fb->oit : NULL;
 
   /* Bounding box */
   float fmin_x = sx0;
@@ -2213,6 +2620,7 @@ void mop_sw_rasterize_triangle_smooth_nm(const MopSwScreenVertex verts[3],
     max_x = fb->width - 1;
   if (max_y >= fb->height)
     max_y = fb->height - 1;
+  fb_scissor(fb, &min_x, &min_y, &max_x, &max_y);
   if (min_x > max_x || min_y > max_y)
     return;
 
@@ -2288,7 +2696,7 @@ void mop_sw_rasterize_triangle_smooth_nm(const MopSwScreenVertex verts[3],
           float z = b0 * sz0 + b1 * sz1 + b2 * sz2;
           size_t idx = (size_t)y * (size_t)width + (size_t)x;
 
-          if (!depth_test || z < fb->depth[idx]) {
+          if ((!depth_test || z < fb->depth[idx]) && dither_keep(x, y)) {
             /* Perspective-correct weights */
             float pc0 = b0 * iw0;
             float pc1 = b1 * iw1;
@@ -2402,6 +2810,8 @@ void mop_sw_rasterize_triangle_smooth_nm(const MopSwScreenVertex verts[3],
               fb->color_hdr[ci + 3] = 1.0f;
               fb->depth[idx] = z;
               fb->object_id[idx] = object_id;
+            } else if (oit) {
+              mop_sw_oit_add(fb, x, y, z, pr, pg, pb, final_alpha, object_id);
             } else {
               float inv_fa = 1.0f - final_alpha;
               float dr = fb->color_hdr[ci + 0];
@@ -2484,24 +2894,12 @@ void mop_sw_rasterize_triangle_full(
       return;
   }
 
-  /* Clip */
+  /* Guard-band clip (see mop_sw_rasterize_triangle) */
   const MopSwClipVertex *poly;
   MopSwClipVertex clipped[MAX_CLIP_VERTICES];
-  int poly_count;
-
-  if (a.w > 0.0f && b.w > 0.0f && c.w > 0.0f && a.x >= -a.w && a.x <= a.w &&
-      a.y >= -a.w && a.y <= a.w && a.z >= -a.w && a.z <= a.w && b.x >= -b.w &&
-      b.x <= b.w && b.y >= -b.w && b.y <= b.w && b.z >= -b.w && b.z <= b.w &&
-      c.x >= -c.w && c.x <= c.w && c.y >= -c.w && c.y <= c.w && c.z >= -c.w &&
-      c.z <= c.w) {
-    poly = vertices;
-    poly_count = 3;
-  } else {
-    poly_count = mop_sw_clip_polygon(vertices, 3, clipped, MAX_CLIP_VERTICES);
-    if (poly_count < 3)
-      return;
-    poly = clipped;
-  }
+  int poly_count = clip_triangle(vertices, clipped, &poly);
+  if (poly_count < 3)
+    return;
 
   MopVec3 norm_light = mop_vec3_normalize(light_dir);
   float half_w = (float)fb->width * 0.5f;
@@ -2536,8 +2934,9 @@ void mop_sw_rasterize_triangle_full(
       continue;
     }
 
-    /* Smooth shading with multi-light */
-    if (smooth_shading && !wireframe) {
+    /* Smooth shading with multi-light; a fragment callback shades
+     * per pixel in every mode */
+    if ((smooth_shading || s_shader) && !wireframe) {
       MopSwScreenVertex sv[3] = {
           {sx0, sy0, sz0, inv_w0, v0->normal, v0->world_pos, v0->color, v0->u,
            v0->v, v0->tangent},
@@ -13,8 +13,10 @@
 #define MOP_SW_RASTERIZER_H
 
 #include <mop/core/light.h>
+#include <mop/render/shader_plugin.h>
 #include <mop/types.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 /* -------------------------------------------------------------------------
@@ -36,6 +38,12 @@ typedef struct MopSwFramebuffer {
   uint8_t *fxaa_scratch; /* RGBA8 scratch for FXAA (persistent) */
   bool
       color_external; /* true => `color` is host-owned, don't free on destroy */
+  struct MopSwOit *oit; /* non-NULL: MOP_BLEND_ALPHA fragments are recorded
+                         * for OIT (rasterizer_oit.h), not blended */
+  /* Scissor for filled triangles: when clip_x1 > clip_x0 only pixels in
+   * [clip_x0, clip_x1) x [clip_y0, clip_y1) are touched.  The tiled
+   * rasterizer sets it on per-tile copies so each worker owns its tile. */
+  int clip_x0, clip_y0, clip_x1, clip_y1;
 } MopSwFramebuffer;
 
 /* Allocate framebuffer storage.  Returns false on allocation failure. */
@@ -201,6 +209,43 @@ void mop_sw_draw_line_aa(MopSwFramebuffer *fb, float x0, float y0, float z0,
 void mop_sw_shadow_set(const float *depth, int w, int h, MopMat4 light_vp);
 void mop_sw_shadow_clear(void);
 
+/* -------------------------------------------------------------------------
+ * Screen-door dither state
+ *
+ * Set around a single draw (LOD cross-fades).  While set, every triangle
+ * write path skips pixels where the 4x4 Bayer pattern is not below
+ * `threshold` (or, with `invert`, where it is), so two draws with the
+ * same threshold and opposite polarity cover each pixel exactly once.
+ * threshold <= 0 disables dithering.
+ * ------------------------------------------------------------------------- */
+
+void mop_sw_dither_set(float threshold, bool invert);
+void mop_sw_dither_clear(void);
+
+/* -------------------------------------------------------------------------
+ * Shader plugin state
+ *
+ * A mesh's CPU shader plugin binding (see mop/render/shader_plugin.h),
+ * set around a single draw like the dither state.  While one with a
+ * fragment callback is set, filled triangles take the per-pixel
+ * multi-light path in every shading mode and their covered pixels are
+ * handed to the callback MOP_SHADER_BLOCK at a time.  The binding must
+ * outlive the draw.
+ * ------------------------------------------------------------------------- */
+
+typedef struct MopSwShader {
+  MopShaderVertexFn vertex;
+  MopShaderFragmentFn fragment;
+  bool lit; /* preset fragment outputs to the built-in lit color */
+  void *user_data;
+  size_t uniform_size;
+  double uniforms[MOP_SHADER_UNIFORMS_MAX / sizeof(double)]; /* copy */
+} MopSwShader;
+
+void mop_sw_shader_set(const MopSwShader *shader);
+void mop_sw_shader_clear(void);
+const MopSwShader *mop_sw_shader_current(void);
+
 /* -------------------------------------------------------------------------
  * IBL (Image-Based Lighting) state
  *
@@ -218,8 +263,11 @@ void mop_sw_ibl_clear(void);
 /* Render a depth-only pass for shadow mapping.
  * Transforms vertices by light_mvp and writes only to the depth buffer.
  * No color, no object_id, no shading.  Used by the viewport to build
- * the shadow map before the main render. */
-void mop_sw_shadow_render_mesh(const MopVertex *vertices, uint32_t vertex_count,
+ * the shadow map before the main render.  positions points at the first
+ * vertex's float3 position; stride is the byte distance between
+ * vertices, so any interleaved layout with float positions works. */
+void mop_sw_shadow_render_mesh(const float *positions, size_t stride,
+                               uint32_t vertex_count,
                                const uint32_t *indices, uint32_t index_count,
                                MopMat4 model, MopMat4 light_vp,
                                MopSwFramebuffer *shadow_fb);
@@ -0,0 +1,86 @@
+/*
+ * Master of Puppets — Software Rasterizer
+ * rasterizer_material.c — Per-pixel material program interpreter
+ *
+ * The bound program is a flat list of register instructions with no
+ * branches, so the interpreter is a single switch per instruction that
+ * works on all lanes at once.  Texture fetches go through the backend's
+ * sampler one lane at a time.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "rasterizer_material.h"
+#include "math/math_simd.h"
+
+#include <stddef.h>
+
+static const MopSwMatProgram *s_mat_prog = NULL;
+static MopSwMatSampleFn s_mat_sample = NULL;
+
+void mop_sw_material_set(const MopSwMatProgram *prog, MopSwMatSampleFn sample) {
+  s_mat_prog = prog;
+  s_mat_sample = sample;
+}
+
+void mop_sw_material_clear(void) {
+  s_mat_prog = NULL;
+  s_mat_sample = NULL;
+}
+
+const MopSwMatProgram *mop_sw_material_current(void) { return s_mat_prog; }
+
+/* ---- interpreter ---- */
+
+void mop_sw_material_run(float (*regs)[MOP_SW_MAT_LANES], int n) {
+  const MopSwMatProgram *p = s_mat_prog;
+  if (!p)
+    return;
+
+  for (uint32_t i = 0; i < p->const_count; i++)
+    v4_store(regs[MOP_SW_MAT_REG_VARYINGS + i], v4_set1(p->consts[i]));
+
+  for (uint32_t i = 0; i < p->code_count; i++) {
+    const MopSwMatInstr *in = &p->code[i];
+    float *d = regs[in->dst];
+    switch ((MopSwMatOp)in->op) {
+    case MOP_SW_MAT_OP_MUL:
+      v4_store(d, v4_mul(v4_load(regs[in->a]), v4_load(regs[in->b])));
+      break;
+    case MOP_SW_MAT_OP_ADD:
+      v4_store(d, v4_add(v4_load(regs[in->a]), v4_load(regs[in->b])));
+      break;
+    case MOP_SW_MAT_OP_MAD:
+      v4_store(d, v4_add(v4_mul(v4_load(regs[in->a]), v4_load(regs[in->b])),
+                         v4_load(regs[in->c])));
+      break;
+    case MOP_SW_MAT_OP_MIX: {
+      v4 a = v4_load(regs[in->a]);
+      v4 t = v4_mul(v4_sub(v4_load(regs[in->b]), a), v4_load(regs[in->c]));
+      v4_store(d, v4_add(a, t));
+      break;
+    }
+    case MOP_SW_MAT_OP_SCHLICK: {
+      v4 f0 = v4_load(regs[in->a]);
+      v4 one = v4_set1(1.0f);
+      v4 m = v4_sub(one, v4_sat(v4_load(regs[in->b])));
+      v4 m2 = v4_mul(m, m);
+      v4 m5 = v4_mul(v4_mul(m2, m2), m);
+      v4_store(d, v4_add(f0, v4_mul(v4_sub(one, f0), m5)));
+      break;
+    }
+    case MOP_SW_MAT_OP_TEX: {
+      const void *tex =
+          in->c < p->texture_count ? p->textures[in->c] : NULL;
+      for (int l = 0; l < MOP_SW_MAT_LANES; l++) {
+        float rgba[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+        if (l < n && tex && s_mat_sample)
+          s_mat_sample(tex, regs[in->a][l], regs[in->b][l], rgba);
+        for (int k = 0; k < 4; k++)
+          regs[in->dst + k][l] = rgba[k];
+      }
+      break;
+    }
+    }
+  }
+}
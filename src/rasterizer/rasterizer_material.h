@@ -0,0 +1,106 @@
+/*
+ * Master of Puppets — Software Rasterizer
+ * rasterizer_material.h — Per-pixel material programs for the CPU path
+ *
+ * A material graph lowered to straight-line register code (see
+ * core/material_program.h).  Every register holds one float per lane;
+ * the interpreter runs the program over MOP_SW_MAT_LANES pixels at a
+ * time with the shared v4 lanes of math_simd.h.  Registers are laid
+ * out as
+ *
+ *   [0, MOP_SW_MAT_REG_VARYINGS)            per-pixel inputs, loaded by
+ *                                            the rasterizer
+ *   [MOP_SW_MAT_REG_VARYINGS, + const_count) constants, splatted per batch
+ *   [.., reg_count)                          temporaries
+ *
+ * While a program is bound the smooth multi-light shading path takes
+ * base color, metallic, roughness and emissive from its output
+ * registers instead of the vertex color and the draw's constants.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef MOP_SW_RASTERIZER_MATERIAL_H
+#define MOP_SW_RASTERIZER_MATERIAL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define MOP_SW_MAT_LANES 4
+#define MOP_SW_MAT_MAX_REGS 128
+#define MOP_SW_MAT_MAX_CODE 256
+#define MOP_SW_MAT_MAX_TEXTURES 8
+
+/* Varying registers */
+enum {
+  MOP_SW_MAT_REG_U = 0,
+  MOP_SW_MAT_REG_V,
+  MOP_SW_MAT_REG_R, /* vertex color */
+  MOP_SW_MAT_REG_G,
+  MOP_SW_MAT_REG_B,
+  MOP_SW_MAT_REG_A,
+  MOP_SW_MAT_REG_NDOTV, /* saturate(dot(N, V)) */
+  MOP_SW_MAT_REG_VARYINGS
+};
+
+/* Output slots (MopSwMatProgram.out) */
+enum {
+  MOP_SW_MAT_OUT_BASE_R = 0,
+  MOP_SW_MAT_OUT_BASE_G,
+  MOP_SW_MAT_OUT_BASE_B,
+  MOP_SW_MAT_OUT_METALLIC,
+  MOP_SW_MAT_OUT_ROUGHNESS,
+  MOP_SW_MAT_OUT_EMISSIVE_R,
+  MOP_SW_MAT_OUT_EMISSIVE_G,
+  MOP_SW_MAT_OUT_EMISSIVE_B,
+  MOP_SW_MAT_OUT_COUNT
+};
+
+typedef enum MopSwMatOp {
+  MOP_SW_MAT_OP_MUL = 0, /* d = a * b */
+  MOP_SW_MAT_OP_ADD,     /* d = a + b */
+  MOP_SW_MAT_OP_MAD,     /* d = a * b + c */
+  MOP_SW_MAT_OP_MIX,     /* d = a + (b - a) * c */
+  MOP_SW_MAT_OP_SCHLICK, /* d = a + (1 - a) * (1 - b)^5 */
+  MOP_SW_MAT_OP_TEX      /* d..d+3 = RGBA of texture c at (a, b) */
+} MopSwMatOp;
+
+typedef struct MopSwMatInstr {
+  uint8_t op;
+  uint8_t dst;
+  uint8_t a, b, c;
+} MopSwMatInstr;
+
+typedef struct MopSwMatProgram {
+  MopSwMatInstr code[MOP_SW_MAT_MAX_CODE];
+  uint32_t code_count;
+  float consts[MOP_SW_MAT_MAX_REGS];
+  uint32_t const_count;
+  uint32_t reg_count;
+  uint8_t out[MOP_SW_MAT_OUT_COUNT]; /* register of each output */
+  uint32_t varyings;                 /* bit i = varying register i read */
+
+  /* Texture handles for MOP_SW_MAT_OP_TEX, resolved by the sampler */
+  const void *textures[MOP_SW_MAT_MAX_TEXTURES];
+  uint32_t texture_count;
+} MopSwMatProgram;
+
+/* Sample texture handle tex at (u, v), wrapping, into RGBA 0..1 */
+typedef void (*MopSwMatSampleFn)(const void *tex, float u, float v,
+                                 float out[4]);
+
+/* Bind a program for the draws that follow, as mop_sw_dither_set.  The
+ * program and textures must outlive the draw; sample may be NULL when
+ * the program has no texture instructions (textures read as white). */
+void mop_sw_material_set(const MopSwMatProgram *prog, MopSwMatSampleFn sample);
+void mop_sw_material_clear(void);
+
+/* The bound program, or NULL */
+const MopSwMatProgram *mop_sw_material_current(void);
+
+/* Run the bound program over one batch.  regs[i][lane]: the caller fills
+ * the varying registers of lanes [0, n); outputs are read back through
+ * MopSwMatProgram.out.  Lanes n.. are computed but not sampled. */
+void mop_sw_material_run(float (*regs)[MOP_SW_MAT_LANES], int n);
+
+#endif /* MOP_SW_RASTERIZER_MATERIAL_H */
@@ -11,6 +11,11 @@
  *      is assigned to exactly one tile, no two workers process the same
  *      triangle, making pixel writes race-free without locks.
  *
+ * Triangles recorded for OIT (rasterizer_oit.h) are the exception: their
+ * fragments read-modify-write per-pixel state, so a worker must own every
+ * pixel it touches.  They are binned into each tile their screen bounds
+ * overlap and rasterized through a per-tile scissor instead.
+ *
  * SPDX-License-Identifier: Apache-2.0
  */
 
@@ -19,12 +24,17 @@
 #endif
 
 #include "rasterizer_mt.h"
+#include "rasterizer_oit.h"
 
 #include <math.h>
 #include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
 
+/* OIT marks tiles used at this granularity; one worker per flag */
+_Static_assert(MOP_SW_OIT_TILE == MOP_TILE_SIZE,
+               "OIT tiles must match rasterizer tiles");
+
 /* -------------------------------------------------------------------------
  * Tile bin — dynamic array of triangle indices per tile
  * ------------------------------------------------------------------------- */
@@ -125,12 +135,35 @@ struct MopSwThreadPool {
 /* -------------------------------------------------------------------------
  * Worker: process tiles until none remain
  *
- * Each triangle is assigned to exactly one tile (centroid-based binning),
- * so we rasterize the full triangle without tile clipping.  Pixels may
- * land in adjacent tiles, but no other worker has the same triangle,
- * so there are no data races.
+ * Most triangles are assigned to exactly one tile (centroid-based
+ * binning), so we rasterize the full triangle without tile clipping.
+ * Pixels may land in adjacent tiles, but no other worker has the same
+ * triangle.  OIT triangles are binned to every tile they overlap and
+ * clipped to this one, so only this worker records their fragments here.
  * ------------------------------------------------------------------------- */
 
+/* Filled MOP_BLEND_ALPHA triangles drawn while fb records OIT */
+static bool tri_tile_owned(const MopSwPreparedTri *tri,
+                           const MopSwFramebuffer *fb) {
+  return fb->oit && tri->blend_mode == MOP_BLEND_ALPHA && !tri->wireframe;
+}
+
+static void rasterize_prepared(const MopSwPreparedTri *tri,
+                               MopSwFramebuffer *fb) {
+  if ((tri->lights && tri->light_count > 0) || mop_sw_shader_current()) {
+    mop_sw_rasterize_triangle_full(
+        tri->vertices, tri->object_id, tri->wireframe, tri->depth_test,
+        tri->cull_back, tri->light_dir, tri->ambient, tri->opacity,
+        tri->smooth_shading, tri->blend_mode, tri->lights, tri->light_count,
+        tri->cam_eye, tri->metallic, tri->roughness, fb);
+  } else {
+    mop_sw_rasterize_triangle(tri->vertices, tri->object_id, tri->wireframe,
+                              tri->depth_test, tri->cull_back, tri->light_dir,
+                              tri->ambient, tri->opacity, tri->smooth_shading,
+                              tri->blend_mode, fb);
+  }
+}
+
 static void process_tile(const MopSwTileWork *work, int tile_idx) {
   const MopTileBin *bin = &work->grid->bins[tile_idx];
   if (bin->count == 0)
@@ -138,21 +171,16 @@ static void process_tile(const MopSwTileWork *work, int tile_idx) {
 
   MopSwFramebuffer *fb = work->fb;
 
+  /* Same buffers, scissored to this tile */
+  MopSwFramebuffer tile_fb = *fb;
+  tile_fb.clip_x0 = (tile_idx % work->grid->tiles_x) * MOP_TILE_SIZE;
+  tile_fb.clip_y0 = (tile_idx / work->grid->tiles_x) * MOP_TILE_SIZE;
+  tile_fb.clip_x1 = tile_fb.clip_x0 + MOP_TILE_SIZE;
+  tile_fb.clip_y1 = tile_fb.clip_y0 + MOP_TILE_SIZE;
+
   for (uint32_t i = 0; i < bin->count; i++) {
     const MopSwPreparedTri *tri = &work->triangles[bin->tri_indices[i]];
-
-    if (tri->lights && tri->light_count > 0) {
-      mop_sw_rasterize_triangle_full(
-          tri->vertices, tri->object_id, tri->wireframe, tri->depth_test,
-          tri->cull_back, tri->light_dir, tri->ambient, tri->opacity,
-          tri->smooth_shading, tri->blend_mode, tri->lights, tri->light_count,
-          tri->cam_eye, tri->metallic, tri->roughness, fb);
-    } else {
-      mop_sw_rasterize_triangle(tri->vertices, tri->object_id, tri->wireframe,
-                                tri->depth_test, tri->cull_back, tri->light_dir,
-                                tri->ambient, tri->opacity, tri->smooth_shading,
-                                tri->blend_mode, fb);
-    }
+    rasterize_prepared(tri, tri_tile_owned(tri, fb) ? &tile_fb : fb);
   }
 }
 
@@ -290,17 +318,69 @@ void mop_sw_threadpool_destroy(MopSwThreadPool *pool) {
  * The triangle is rasterized fully by that tile's worker; pixels
  * may land in adjacent tiles, but since each triangle is processed
  * by exactly one worker, there are no data races.
+ *
+ * OIT triangles go to every tile their screen bounds overlap instead
+ * (all tiles if a vertex is at or behind the eye, where the projection
+ * says nothing); each tile rasterizes only its own pixels of them.
  * ------------------------------------------------------------------------- */
 
+static void bin_tri_bounds(MopTileGrid *grid, const MopSwPreparedTri *tri,
+                           uint32_t t, float half_w, float half_h) {
+  int tx0 = 0, ty0 = 0;
+  int tx1 = grid->tiles_x - 1, ty1 = grid->tiles_y - 1;
+
+  float min_x = 0.0f, min_y = 0.0f, max_x = 0.0f, max_y = 0.0f;
+  bool bounded = true;
+  for (int vi = 0; vi < 3; vi++) {
+    float w = tri->vertices[vi].position.w;
+    if (w < 1e-7f) {
+      bounded = false;
+      break;
+    }
+    float inv_w = 1.0f / w;
+    float sx = (tri->vertices[vi].position.x * inv_w + 1.0f) * half_w;
+    float sy = (1.0f - tri->vertices[vi].position.y * inv_w) * half_h;
+    min_x = vi == 0 || sx < min_x ? sx : min_x;
+    min_y = vi == 0 || sy < min_y ? sy : min_y;
+    max_x = vi == 0 || sx > max_x ? sx : max_x;
+    max_y = vi == 0 || sy > max_y ? sy : max_y;
+  }
+  if (bounded) {
+    /* Same floor / ceil pixel box as the rasterizer */
+    float tile = (float)MOP_TILE_SIZE;
+    float fx0 = floorf(min_x) / tile, fy0 = floorf(min_y) / tile;
+    float fx1 = ceilf(max_x) / tile, fy1 = ceilf(max_y) / tile;
+    if (fx1 < 0.0f || fy1 < 0.0f || fx0 >= (float)grid->tiles_x ||
+        fy0 >= (float)grid->tiles_y)
+      return; /* off screen */
+    if (fx0 > 0.0f)
+      tx0 = (int)fx0;
+    if (fy0 > 0.0f)
+      ty0 = (int)fy0;
+    if (fx1 < (float)tx1)
+      tx1 = (int)fx1;
+    if (fy1 < (float)ty1)
+      ty1 = (int)fy1;
+  }
+
+  for (int ty = ty0; ty <= ty1; ty++)
+    for (int tx = tx0; tx <= tx1; tx++)
+      tile_bin_push(&grid->bins[ty * grid->tiles_x + tx], t);
+}
+
 static void bin_triangles(MopTileGrid *grid, const MopSwPreparedTri *triangles,
-                          uint32_t triangle_count, int fb_width,
-                          int fb_height) {
-  float half_w = (float)fb_width * 0.5f;
-  float half_h = (float)fb_height * 0.5f;
+                          uint32_t triangle_count, const MopSwFramebuffer *fb) {
+  float half_w = (float)fb->width * 0.5f;
+  float half_h = (float)fb->height * 0.5f;
 
   for (uint32_t t = 0; t < triangle_count; t++) {
     const MopSwPreparedTri *tri = &triangles[t];
 
+    if (tri_tile_owned(tri, fb)) {
+      bin_tri_bounds(grid, tri, t, half_w, half_h);
+      continue;
+    }
+
     /* Quick screen-space centroid from clip positions */
     float cx = 0.0f, cy = 0.0f;
     bool valid = true;
@@ -357,7 +437,7 @@ void mop_sw_rasterize_tiled(MopSwThreadPool *pool,
     return;
 
   /* Bin triangles to tiles (single-threaded) */
-  bin_triangles(&grid, triangles, triangle_count, fb->width, fb->height);
+  bin_triangles(&grid, triangles, triangle_count, fb);
 
   /* Set up work descriptor */
   MopSwTileWork work;
@@ -0,0 +1,331 @@
+/*
+ * Master of Puppets — Software Rasterizer
+ * rasterizer_oit.c — Weighted blended and fragment-list OIT
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "rasterizer_oit.h"
+#include "core/thread_pool.h"
+
+#include <math.h>
+#include <mop/util/log.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define OIT_INITIAL_NODES 65536u
+
+/* ---- allocation ---- */
+
+static void oit_free_pixels(MopSwOit *oit) {
+  free(oit->pick_depth);
+  free(oit->tile_used);
+  free(oit->accum);
+  free(oit->reveal);
+  free(oit->head);
+  oit->pick_depth = oit->accum = oit->reveal = NULL;
+  oit->tile_used = NULL;
+  oit->head = NULL;
+  oit->width = oit->height = 0;
+}
+
+static bool oit_alloc_pixels(MopSwOit *oit, MopSwOitMode mode, int width,
+                             int height) {
+  size_t px = (size_t)width * (size_t)height;
+  int tx = (width + MOP_SW_OIT_TILE - 1) / MOP_SW_OIT_TILE;
+  int ty = (height + MOP_SW_OIT_TILE - 1) / MOP_SW_OIT_TILE;
+
+  oit->pick_depth = malloc(px * sizeof(float));
+  oit->tile_used = calloc((size_t)tx * ty, 1);
+  if (mode == MOP_SW_OIT_EXACT) {
+    oit->head = malloc(px * sizeof(uint32_t));
+  } else {
+    oit->accum = calloc(px * 4, sizeof(float));
+    oit->reveal = malloc(px * sizeof(float));
+  }
+  bool ok = oit->pick_depth && oit->tile_used &&
+            (mode == MOP_SW_OIT_EXACT ? oit->head != NULL
+                                      : oit->accum && oit->reveal);
+  if (!ok) {
+    oit_free_pixels(oit);
+    return false;
+  }
+  for (size_t i = 0; i < px; i++)
+    oit->pick_depth[i] = 1.0f;
+  if (oit->head)
+    memset(oit->head, 0xFF, px * sizeof(uint32_t));
+  if (oit->reveal)
+    for (size_t i = 0; i < px; i++)
+      oit->reveal[i] = 1.0f;
+
+  oit->mode = mode;
+  oit->width = width;
+  oit->height = height;
+  oit->tiles_x = tx;
+  oit->tiles_y = ty;
+  return true;
+}
+
+/* Return the pixels of one tile to the cleared state */
+static void oit_clear_tile(MopSwOit *oit, int tx, int ty) {
+  int x0 = tx * MOP_SW_OIT_TILE, y0 = ty * MOP_SW_OIT_TILE;
+  int x1 = x0 + MOP_SW_OIT_TILE, y1 = y0 + MOP_SW_OIT_TILE;
+  x1 = x1 < oit->width ? x1 : oit->width;
+  y1 = y1 < oit->height ? y1 : oit->height;
+  for (int y = y0; y < y1; y++) {
+    size_t row = (size_t)y * oit->width;
+    for (int x = x0; x < x1; x++) {
+      size_t i = row + x;
+      oit->pick_depth[i] = 1.0f;
+      if (oit->head) {
+        oit->head[i] = MOP_SW_OIT_EMPTY;
+      } else {
+        oit->accum[i * 4 + 0] = oit->accum[i * 4 + 1] = 0.0f;
+        oit->accum[i * 4 + 2] = oit->accum[i * 4 + 3] = 0.0f;
+        oit->reveal[i] = 1.0f;
+      }
+    }
+  }
+  oit->tile_used[(size_t)ty * oit->tiles_x + tx] = 0;
+}
+
+bool mop_sw_oit_begin(MopSwOit *oit, MopSwOitMode mode, int width,
+                      int height, const MopMat4 *proj) {
+  if (!oit || !proj || width <= 0 || height <= 0)
+    return false;
+
+  if (oit->width != width || oit->height != height || oit->mode != mode ||
+      !oit->pick_depth) {
+    oit_free_pixels(oit);
+    if (!oit_alloc_pixels(oit, mode, width, height)) {
+      MOP_WARN("oit: out of memory for %dx%d, blending in draw order", width,
+               height);
+      return false;
+    }
+  } else {
+    /* Leftovers of a pass that was repeated after a pool overflow */
+    for (int ty = 0; ty < oit->tiles_y; ty++)
+      for (int tx = 0; tx < oit->tiles_x; tx++)
+        if (oit->tile_used[(size_t)ty * oit->tiles_x + tx])
+          oit_clear_tile(oit, tx, ty);
+  }
+
+  if (mode == MOP_SW_OIT_EXACT && !oit->nodes) {
+    oit->nodes = malloc(OIT_INITIAL_NODES * sizeof(MopSwOitNode));
+    if (!oit->nodes) {
+      MOP_WARN("oit: out of memory for the fragment pool");
+      return false;
+    }
+    oit->node_capacity = OIT_INITIAL_NODES;
+  }
+  oit->node_count = 0;
+
+  /* Column-major: d[col * 4 + row] */
+  const float *m = proj->d;
+  oit->persp = m[11] != 0.0f;
+  oit->lin_a = oit->persp ? m[14] : -1.0f / m[10];
+  oit->lin_b = oit->persp ? m[10] : -m[14];
+  return true;
+}
+
+bool mop_sw_oit_grow(MopSwOit *oit) {
+  if (!oit || oit->node_count <= oit->node_capacity)
+    return false;
+  uint32_t need = oit->node_count;
+  uint32_t cap = need + need / 2;
+  MopSwOitNode *nodes = realloc(oit->nodes, (size_t)cap * sizeof(*nodes));
+  if (!nodes) {
+    MOP_WARN("oit: fragment pool cannot grow to %u, %u fragments dropped",
+             cap, need - oit->node_capacity);
+    return false;
+  }
+  oit->nodes = nodes;
+  oit->node_capacity = cap;
+  return true;
+}
+
+void mop_sw_oit_free(MopSwOit *oit) {
+  if (!oit)
+    return;
+  oit_free_pixels(oit);
+  free(oit->nodes);
+  *oit = (MopSwOit){0};
+}
+
+/* ---- fragment recording ---- */
+
+/* View distance for the weight, from [0,1] depth */
+static float oit_view_dist(const MopSwOit *oit, float z) {
+  float nz = z * 2.0f - 1.0f;
+  float d = oit->persp ? oit->lin_a / (nz + oit->lin_b)
+                       : (nz + oit->lin_b) * oit->lin_a;
+  return fabsf(d);
+}
+
+/* w(z, a) = a * clamp(0.03 / (1e-5 + (z / 200)^4), 1e-2, 3e3) */
+static float oit_weight(float dist, float a) {
+  float d = dist * (1.0f / 200.0f);
+  float d2 = d * d;
+  float w = 0.03f / (1e-5f + d2 * d2);
+  w = w < 1e-2f ? 1e-2f : (w > 3e3f ? 3e3f : w);
+  return a * w;
+}
+
+void mop_sw_oit_add(MopSwFramebuffer *fb, int x, int y, float z, float r,
+                    float g, float b, float a, uint32_t object_id) {
+  MopSwOit *oit = fb->oit;
+  if (!(a > 0.0f))
+    return;
+  a = a > 1.0f ? 1.0f : a;
+  size_t idx = (size_t)y * fb->width + x;
+  oit->tile_used[(size_t)(y / MOP_SW_OIT_TILE) * oit->tiles_x +
+                 x / MOP_SW_OIT_TILE] = 1;
+  if (a > 0.5f && z < oit->pick_depth[idx]) {
+    oit->pick_depth[idx] = z;
+    fb->object_id[idx] = object_id;
+  }
+
+  if (oit->mode == MOP_SW_OIT_EXACT) {
+    /* Pixels are tile-owned; only the pool is shared between workers */
+    uint32_t n = __atomic_fetch_add(&oit->node_count, 1, __ATOMIC_RELAXED);
+    if (n >= oit->node_capacity)
+      return; /* counted; mop_sw_oit_grow sizes the pool for a rerun */
+    MopSwOitNode *node = &oit->nodes[n];
+    node->depth = z;
+    node->r = r, node->g = g, node->b = b, node->a = a;
+    node->next = oit->head[idx];
+    oit->head[idx] = n;
+    return;
+  }
+
+  float w = oit_weight(oit_view_dist(oit, z), a);
+  float *acc = oit->accum + idx * 4;
+  acc[0] += r * a * w;
+  acc[1] += g * a * w;
+  acc[2] += b * a * w;
+  acc[3] += a * w;
+  oit->reveal[idx] *= 1.0f - a;
+}
+
+/* ---- resolve ---- */
+
+typedef struct OitLayer {
+  float depth;
+  float r, g, b; /* premultiplied */
+  float a;
+} OitLayer;
+
+/* back composited under front; front keeps its depth */
+static void layer_merge(OitLayer *front, const OitLayer *back) {
+  float t = 1.0f - front->a;
+  front->r += back->r * t;
+  front->g += back->g * t;
+  front->b += back->b * t;
+  front->a += back->a * t;
+}
+
+/* Insert into layers sorted nearest-first, keeping at most
+ * MOP_SW_OIT_LAYERS: beyond that the farthest two are merged */
+static void layer_insert(OitLayer *l, int *count, OitLayer f) {
+  int n = *count;
+  OitLayer tail;
+  bool spill = false;
+  if (n == MOP_SW_OIT_LAYERS) {
+    if (f.depth >= l[n - 1].depth) {
+      layer_merge(&l[n - 1], &f);
+      return;
+    }
+    tail = l[--n];
+    spill = true;
+  }
+  int i = n;
+  while (i > 0 && l[i - 1].depth > f.depth) {
+    l[i] = l[i - 1];
+    i--;
+  }
+  l[i] = f;
+  n++;
+  if (spill)
+    layer_merge(&l[n - 1], &tail);
+  *count = n;
+}
+
+typedef struct OitResolveCtx {
+  MopSwOit *oit;
+  MopSwFramebuffer *fb;
+} OitResolveCtx;
+
+static void oit_store(MopSwFramebuffer *fb, size_t idx, float r, float g,
+                      float b) {
+  float *hdr = fb->color_hdr + idx * 4;
+  uint8_t *ldr = fb->color + idx * 4;
+  hdr[0] = r, hdr[1] = g, hdr[2] = b, hdr[3] = 1.0f;
+  ldr[0] = (uint8_t)((r < 0.0f ? 0.0f : (r > 1.0f ? 1.0f : r)) * 255.0f);
+  ldr[1] = (uint8_t)((g < 0.0f ? 0.0f : (g > 1.0f ? 1.0f : g)) * 255.0f);
+  ldr[2] = (uint8_t)((b < 0.0f ? 0.0f : (b > 1.0f ? 1.0f : b)) * 255.0f);
+  ldr[3] = 255;
+}
+
+static void oit_resolve_pixel(MopSwOit *oit, MopSwFramebuffer *fb,
+                              size_t idx) {
+  const float *dst = fb->color_hdr + idx * 4;
+  float r = dst[0], g = dst[1], b = dst[2];
+
+  if (oit->head) {
+    uint32_t n = oit->head[idx];
+    if (n == MOP_SW_OIT_EMPTY)
+      return;
+    OitLayer layers[MOP_SW_OIT_LAYERS];
+    int count = 0;
+    for (; n != MOP_SW_OIT_EMPTY; n = oit->nodes[n].next) {
+      const MopSwOitNode *f = &oit->nodes[n];
+      layer_insert(layers, &count,
+                   (OitLayer){f->depth, f->r * f->a, f->g * f->a,
+                              f->b * f->a, f->a});
+    }
+    for (int i = count - 1; i >= 0; i--) {
+      float t = 1.0f - layers[i].a;
+      r = layers[i].r + r * t;
+      g = layers[i].g + g * t;
+      b = layers[i].b + b * t;
+    }
+  } else {
+    float rv = oit->reveal[idx];
+    if (rv >= 1.0f)
+      return;
+    const float *acc = oit->accum + idx * 4;
+    float inv = 1.0f / (acc[3] > 1e-5f ? acc[3] : 1e-5f);
+    float cov = 1.0f - rv;
+    r = acc[0] * inv * cov + r * rv;
+    g = acc[1] * inv * cov + g * rv;
+    b = acc[2] * inv * cov + b * rv;
+  }
+  oit_store(fb, idx, r, g, b);
+}
+
+static void oit_resolve_row(void *ctx_ptr, int ty) {
+  const OitResolveCtx *c = (const OitResolveCtx *)ctx_ptr;
+  MopSwOit *oit = c->oit;
+  for (int tx = 0; tx < oit->tiles_x; tx++) {
+    if (!oit->tile_used[(size_t)ty * oit->tiles_x + tx])
+      continue;
+    int x0 = tx * MOP_SW_OIT_TILE, y0 = ty * MOP_SW_OIT_TILE;
+    int x1 = x0 + MOP_SW_OIT_TILE, y1 = y0 + MOP_SW_OIT_TILE;
+    x1 = x1 < oit->width ? x1 : oit->width;
+    y1 = y1 < oit->height ? y1 : oit->height;
+    for (int y = y0; y < y1; y++)
+      for (int x = x0; x < x1; x++)
+        oit_resolve_pixel(oit, c->fb, (size_t)y * oit->width + x);
+    oit_clear_tile(oit, tx, ty);
+  }
+}
+
+void mop_sw_oit_resolve(MopSwOit *oit, MopSwFramebuffer *fb,
+                        struct MopThreadPool *pool) {
+  if (!oit || !fb || !oit->pick_depth || oit->width != fb->width ||
+      oit->height != fb->height)
+    return;
+  OitResolveCtx c = {oit, fb};
+  mop_threadpool_parallel_rows(pool, oit->tiles_y, oit_resolve_row, &c);
+  oit->node_count = 0;
+}
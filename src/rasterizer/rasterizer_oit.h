@@ -0,0 +1,99 @@
+/*
+ * Master of Puppets — Software Rasterizer
+ * rasterizer_oit.h — Order-independent transparency for the CPU path
+ *
+ * While MopSwFramebuffer.oit is set, MOP_BLEND_ALPHA fragments that pass
+ * the depth test are recorded here instead of being blended into the
+ * color buffer, so transparent draws need no back-to-front sort and
+ * intersecting surfaces composite per pixel.  Two modes:
+ *
+ *   WEIGHTED — weighted blended OIT (McGuire/Bavoil 2013) with the
+ *              weight of mop_oit_accum.frag: one weighted premultiplied
+ *              sum and one revealage product per pixel
+ *   EXACT    — per-pixel fragment lists in a shared node pool; the
+ *              resolve sorts the nearest MOP_SW_OIT_LAYERS fragments and
+ *              merges any farther ones into the last layer (multi-layer
+ *              alpha blending), so up to that many layers are exact
+ *
+ * Recording is a plain read-modify-write of per-pixel state, so the
+ * tiled rasterizer bins OIT triangles into every tile they overlap and
+ * clips each to its tile: one worker owns each pixel and its tile flag,
+ * and only the node pool claim is atomic.  Additive and multiply
+ * blending commute already and still blend directly.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef MOP_SW_RASTERIZER_OIT_H
+#define MOP_SW_RASTERIZER_OIT_H
+
+#include "rasterizer.h"
+
+#include <mop/types.h>
+#include <stddef.h>
+
+struct MopThreadPool;
+
+#define MOP_SW_OIT_LAYERS 16    /* exact layers per pixel */
+#define MOP_SW_OIT_TILE 32      /* resolve granularity, pixels */
+#define MOP_SW_OIT_EMPTY 0xFFFFFFFFu
+
+typedef enum MopSwOitMode {
+  MOP_SW_OIT_WEIGHTED = 0,
+  MOP_SW_OIT_EXACT = 1
+} MopSwOitMode;
+
+typedef struct MopSwOitNode {
+  float depth;
+  float r, g, b, a; /* straight (not premultiplied) color */
+  uint32_t next;    /* MOP_SW_OIT_EMPTY ends the list */
+} MopSwOitNode;
+
+/* Per-pixel buffers persist across frames and are left cleared by the
+ * resolve; only tiles that received fragments are visited. */
+typedef struct MopSwOit {
+  MopSwOitMode mode;
+  int width, height;
+  int tiles_x, tiles_y;
+  bool persp;
+  float lin_a, lin_b; /* view distance from [0,1] depth (weights) */
+
+  float *pick_depth;  /* nearest fragment with alpha > 0.5, for IDs */
+  uint8_t *tile_used; /* tile holds fragments since the last resolve */
+
+  /* WEIGHTED */
+  float *accum;  /* RGBA: sum of w * (a * rgb, a) */
+  float *reveal; /* product of (1 - a) */
+
+  /* EXACT */
+  uint32_t *head; /* first node per pixel */
+  MopSwOitNode *nodes;
+  uint32_t node_capacity;
+  uint32_t node_count; /* may pass node_capacity: fragments were dropped */
+} MopSwOit;
+
+/* Prepare for a transparent pass over a width x height framebuffer
+ * rendered with proj.  Allocates on first use or when the size or mode
+ * changes.  Returns false (with a warning) if memory is short; the
+ * caller then blends without OIT. */
+bool mop_sw_oit_begin(MopSwOit *oit, MopSwOitMode mode, int width,
+                      int height, const MopMat4 *proj);
+
+/* Record one fragment at (x, y) of fb, which must have fb->oit set.
+ * Writes object_id when alpha > 0.5 and the fragment is the nearest such
+ * one so far; depth is left untouched. */
+void mop_sw_oit_add(MopSwFramebuffer *fb, int x, int y, float z, float r,
+                    float g, float b, float a, uint32_t object_id);
+
+/* EXACT: if the node pool overflowed during the pass, grow it to fit and
+ * return true — the pass should be repeated from mop_sw_oit_begin. */
+bool mop_sw_oit_grow(MopSwOit *oit);
+
+/* Composite the recorded fragments over fb's HDR and RGBA8 color, tile
+ * rows spread over pool (NULL = caller's thread), and clear them. */
+void mop_sw_oit_resolve(MopSwOit *oit, MopSwFramebuffer *fb,
+                        struct MopThreadPool *pool);
+
+void mop_sw_oit_free(MopSwOit *oit);
+
+#endif /* MOP_SW_RASTERIZER_OIT_H */
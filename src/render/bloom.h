@@ -0,0 +1,43 @@
+/*
+ * Master of Puppets — Post-Processing
+ * bloom.h — HDR bloom for the CPU backend
+ *
+ * Mip-chain bloom on the software HDR color buffer, the CPU counterpart
+ * of the mop_bloom_*.frag passes: a soft-knee threshold at half
+ * resolution, a chain of 13-tap downsamples and a tent-filtered
+ * upsample that accumulates every level back up.  All passes are
+ * row-parallel on the viewport thread pool and work on RGBA float
+ * pixels, four lanes at a time.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef MOP_RENDER_BLOOM_H
+#define MOP_RENDER_BLOOM_H
+
+#include "rasterizer/rasterizer.h"
+
+#include <stddef.h>
+
+struct MopThreadPool;
+
+#define MOP_SW_BLOOM_LEVELS 5 /* as MOP_VK_BLOOM_LEVELS */
+
+/* Grow-only mip chain and scratch, owned by the viewport */
+typedef struct MopSwBloom {
+  float *buf;      /* RGBA levels, then scratch */
+  size_t capacity; /* floats allocated */
+} MopSwBloom;
+
+/* Add bloom to the geometry in fb's HDR color: pixels brighter than
+ * threshold (luminance, soft knee of threshold / 2) are blurred over the
+ * mip chain and added scaled by intensity, before the HDR resolve.
+ * Background pixels (object ID 0) are left unchanged, as in the GPU
+ * tonemap pass.  Rows are spread over pool (NULL = caller's thread).
+ * Skipped with a warning if the chain cannot be allocated. */
+void mop_sw_bloom_apply(MopSwBloom *b, MopSwFramebuffer *fb, float threshold,
+                        float intensity, struct MopThreadPool *pool);
+
+void mop_sw_bloom_free(MopSwBloom *b);
+
+#endif /* MOP_RENDER_BLOOM_H */
@@ -187,6 +187,14 @@ float mop_viewport_get_exposure(const MopViewport *vp) {
   return vp ? vp->exposure : 1.0f;
 }
 
+void mop_viewport_set_oit_mode(MopViewport *vp, MopOitMode mode) {
+  if (!vp)
+    return;
+  MOP_VP_LOCK(vp);
+  vp->oit_mode = mode == MOP_OIT_EXACT ? MOP_OIT_EXACT : MOP_OIT_WEIGHTED;
+  MOP_VP_UNLOCK(vp);
+}
+
 void mop_viewport_set_ssr(MopViewport *vp, float intensity) {
   if (!vp)
     return;
@@ -6,6 +6,7 @@
  */
 
 #include "core/viewport_internal.h"
+#include "rasterizer/rasterizer.h"
 
 #include <mop/render/shader_plugin.h>
 #include <stdlib.h>
@@ -23,6 +24,9 @@ struct MopShaderPlugin {
   MopRhiShader *vertex_shader;
   MopRhiShader *fragment_shader;
   MopRhiShader *compute_shader;
+  MopShaderVertexFn cpu_vertex;
+  MopShaderFragmentFn cpu_fragment;
+  bool cpu_fragment_lit;
   bool active;
 };
 
@@ -32,7 +36,9 @@ struct MopShaderPlugin {
 
 MopShaderPlugin *mop_viewport_register_shader(MopViewport *vp,
                                               const MopShaderPluginDesc *desc) {
-  if (!vp || !desc || !desc->draw || !desc->name)
+  if (!vp || !desc || !desc->name)
+    return NULL;
+  if (!desc->draw && !desc->cpu_vertex && !desc->cpu_fragment)
     return NULL;
   if ((unsigned)desc->stage >= MOP_SHADER_PLUGIN_STAGE_COUNT)
     return NULL;
@@ -54,6 +60,9 @@ MopShaderPlugin *mop_viewport_register_shader(MopViewport *vp,
   plugin->stage = desc->stage;
   plugin->draw = desc->draw;
   plugin->user_data = desc->user_data;
+  plugin->cpu_vertex = desc->cpu_vertex;
+  plugin->cpu_fragment = desc->cpu_fragment;
+  plugin->cpu_fragment_lit = desc->cpu_fragment_lit;
   plugin->active = true;
 
   /* Compile SPIR-V into shader modules via RHI (if backend supports it) */
@@ -119,6 +128,16 @@ void mop_viewport_unregister_shader(MopViewport *vp, MopShaderPlugin *plugin) {
     }
   }
 
+  /* Unbind from meshes */
+  for (uint32_t i = 0; i < vp->mesh_count; i++) {
+    struct MopMesh *m = vp->meshes[i];
+    if (m && m->shader_plugin == plugin) {
+      free(m->shader);
+      m->shader = NULL;
+      m->shader_plugin = NULL;
+    }
+  }
+
   /* Destroy shader modules */
   const MopRhiBackend *rhi = vp->rhi;
   MopRhiDevice *dev = vp->device;
@@ -135,6 +154,49 @@ void mop_viewport_unregister_shader(MopViewport *vp, MopShaderPlugin *plugin) {
   MOP_VP_UNLOCK(vp);
 }
 
+/* -------------------------------------------------------------------------
+ * Mesh binding — CPU shading callbacks plus a per-mesh uniform copy
+ * ------------------------------------------------------------------------- */
+
+bool mop_mesh_set_shader_plugin(MopMesh *mesh, MopShaderPlugin *plugin,
+                                const void *uniforms, size_t uniform_size) {
+  if (!mesh)
+    return false;
+  if (plugin && !plugin->cpu_vertex && !plugin->cpu_fragment)
+    return false;
+  if (uniform_size > MOP_SHADER_UNIFORMS_MAX || (uniform_size && !uniforms))
+    return false;
+
+  MOP_VP_LOCK(mesh->viewport);
+  if (!plugin) {
+    free(mesh->shader);
+    mesh->shader = NULL;
+    mesh->shader_plugin = NULL;
+    MOP_VP_UNLOCK(mesh->viewport);
+    return true;
+  }
+  MopSwShader *sh = mesh->shader;
+  if (!sh) {
+    sh = malloc(sizeof(*sh));
+    if (!sh) {
+      MOP_VP_UNLOCK(mesh->viewport);
+      return false;
+    }
+  }
+  sh->vertex = plugin->cpu_vertex;
+  sh->fragment = plugin->cpu_fragment;
+  sh->lit = plugin->cpu_fragment_lit;
+  sh->user_data = plugin->user_data;
+  sh->uniform_size = uniform_size;
+  memset(sh->uniforms, 0, sizeof(sh->uniforms));
+  if (uniform_size)
+    memcpy(sh->uniforms, uniforms, uniform_size);
+  mesh->shader = sh;
+  mesh->shader_plugin = plugin;
+  MOP_VP_UNLOCK(mesh->viewport);
+  return true;
+}
+
 /* -------------------------------------------------------------------------
  * Destroy all plugins — called from mop_viewport_destroy
  * ------------------------------------------------------------------------- */
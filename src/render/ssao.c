@@ -0,0 +1,394 @@
+/*
+ * Master of Puppets — Post-Processing
+ * ssao.c — CPU ground-truth ambient occlusion (GTAO)
+ *
+ * Four row-parallel passes over the viewport thread pool:
+ *   1. prepare  — view-space position of one framebuffer pixel per
+ *                 low-res texel, reconstructed from depth
+ *   2. horizon  — per texel, march two screen-space slices in both
+ *                 directions, keep the highest horizon on each side and
+ *                 integrate the cosine-weighted visible arc
+ *                 (Jimenez et al. 2016, as in XeGTAO)
+ *   3. blur     — depth-aware 4x4 box; slice rotation and step jitter
+ *                 follow a 4x4 Bayer pattern, so the box averages 32
+ *                 directions on flat surfaces
+ *   4. upsample — joint bilateral: the four nearest texels weighted by
+ *                 bilinear position and linear-depth similarity, then
+ *                 multiplied into the RGBA8 and HDR color
+ *
+ * Radius, intensity and step count match mop_gtao.frag.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "render/ssao.h"
+#include "core/thread_pool.h"
+
+#include <math.h>
+#include <mop/util/log.h>
+#include <stdlib.h>
+
+#define AO_RADIUS 0.3f     /* world units */
+#define AO_INTENSITY 0.6f  /* mix(1, visibility, intensity) */
+#define AO_STEPS 6         /* samples per side of a slice */
+#define AO_SLICES 2        /* slices per texel, rotated by the noise */
+#define AO_MAX_RADIUS 0.1f /* fraction of the low-res width */
+#define AO_DEPTH_TOL 0.1f  /* blur: relative linear-depth tolerance */
+#define AO_ANGLE_BIAS 0.1f /* min sine of a sample above the tangent plane */
+#define AO_FAR_DEPTH 0.9999f /* beyond: background gradient, as the shaders */
+#define AO_PI 3.14159265f
+
+static const uint8_t BAYER4[16] = {0, 8,  2, 10, 12, 4,  14, 6,
+                                   3, 11, 1, 9,  15, 7,  13, 5};
+
+typedef struct SsaoCtx {
+  MopSwSsao *s;
+  MopSwFramebuffer *fb;
+  int scale;
+  int lw, lh;
+  bool persp;
+  float za, zb;         /* view z from NDC z */
+  float kx, ox, ky, oy; /* view x/y from NDC x/y (scaled by z if persp) */
+  float px_per_unit;    /* low-res pixels per view unit at distance 1 */
+} SsaoCtx;
+
+static float view_z(const SsaoCtx *c, float nz) {
+  return c->persp ? c->za / (nz + c->zb) : nz * c->za + c->zb;
+}
+
+/* ---- 1. prepare ---- */
+
+static void ssao_prepare_row(void *ctx_ptr, int ly) {
+  const SsaoCtx *c = (const SsaoCtx *)ctx_ptr;
+  int w = c->fb->width, h = c->fb->height;
+  int fy = ly * c->scale + c->scale / 2;
+  if (fy >= h)
+    fy = h - 1;
+  float ny = 1.0f - ((float)fy + 0.5f) * 2.0f / (float)h;
+  float *out = c->s->pos + (size_t)ly * c->lw * 3;
+  for (int lx = 0; lx < c->lw; lx++, out += 3) {
+    int fx = lx * c->scale + c->scale / 2;
+    if (fx >= w)
+      fx = w - 1;
+    float d = c->fb->depth[(size_t)fy * w + fx];
+    if (d > AO_FAR_DEPTH) {
+      out[0] = out[1] = out[2] = 0.0f;
+      continue;
+    }
+    float nx = ((float)fx + 0.5f) * 2.0f / (float)w - 1.0f;
+    float z = view_z(c, d * 2.0f - 1.0f);
+    float sx = c->persp ? z : 1.0f;
+    out[0] = sx * (nx * c->kx + c->ox);
+    out[1] = sx * (ny * c->ky + c->oy);
+    out[2] = z;
+  }
+}
+
+/* ---- 2. horizon search ---- */
+
+/* Derivative along one axis from the neighbor on the same surface */
+static bool pick_delta(const float *p, const float *lo, const float *hi,
+                       float out[3]) {
+  bool has_lo = lo && lo[2] != 0.0f, has_hi = hi && hi[2] != 0.0f;
+  if (has_lo && has_hi) {
+    if (fabsf(hi[2] - p[2]) < fabsf(p[2] - lo[2]))
+      has_lo = false;
+    else
+      has_hi = false;
+  }
+  if (has_hi) {
+    for (int k = 0; k < 3; k++)
+      out[k] = hi[k] - p[k];
+    return true;
+  }
+  if (has_lo) {
+    for (int k = 0; k < 3; k++)
+      out[k] = p[k] - lo[k];
+    return true;
+  }
+  return false;
+}
+
+static float ssao_texel(const SsaoCtx *c, int lx, int ly) {
+  int lw = c->lw, lh = c->lh;
+  const float *pos = c->s->pos;
+  const float *p = pos + ((size_t)ly * lw + lx) * 3;
+
+  float v[3] = {0.0f, 0.0f, 1.0f};
+  if (c->persp) {
+    float il = 1.0f / sqrtf(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+    v[0] = -p[0] * il, v[1] = -p[1] * il, v[2] = -p[2] * il;
+  }
+
+  /* Normal from the depth derivatives; screen y runs down */
+  float dx[3], dy[3], n[3];
+  const float *row = pos + (size_t)ly * lw * 3;
+  bool ok_x = pick_delta(p, lx > 0 ? row + (lx - 1) * 3 : NULL,
+                         lx + 1 < lw ? row + (lx + 1) * 3 : NULL, dx);
+  bool ok_y = pick_delta(p, ly > 0 ? p - lw * 3 : NULL,
+                         ly + 1 < lh ? p + lw * 3 : NULL, dy);
+  if (!ok_x || !ok_y)
+    return 1.0f;
+  n[0] = dx[1] * dy[2] - dx[2] * dy[1];
+  n[1] = dx[2] * dy[0] - dx[0] * dy[2];
+  n[2] = dx[0] * dy[1] - dx[1] * dy[0];
+  float nl = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+  if (nl < 1e-20f)
+    return 1.0f;
+  if (n[0] * v[0] + n[1] * v[1] + n[2] * v[2] < 0.0f)
+    nl = -nl;
+  n[0] /= nl, n[1] /= nl, n[2] /= nl;
+
+  float radius_px = AO_RADIUS * c->px_per_unit;
+  if (c->persp)
+    radius_px /= fabsf(p[2]);
+  if (radius_px < 1.0f)
+    return 1.0f;
+  if (radius_px > AO_MAX_RADIUS * (float)lw)
+    radius_px = AO_MAX_RADIUS * (float)lw;
+
+  float rot = ((float)BAYER4[(ly & 3) * 4 + (lx & 3)] + 0.5f) / 16.0f;
+  float jit =
+      ((float)BAYER4[((ly + 2) & 3) * 4 + ((lx + 1) & 3)] + 0.5f) / 16.0f;
+  const float falloff_range = 0.615f * AO_RADIUS;
+  const float falloff_mul = -1.0f / falloff_range;
+  const float falloff_add = (AO_RADIUS - falloff_range) / falloff_range + 1.0f;
+
+  float visibility = 0.0f;
+  for (int sl = 0; sl < AO_SLICES; sl++) {
+    float phi = ((float)sl + rot) * (AO_PI / (float)AO_SLICES);
+    float cs = cosf(phi), sn = sinf(phi);
+
+    /* Slice plane through v and the view-space direction (cs, sn, 0);
+     * project the normal into it */
+    float dv = cs * v[0] + sn * v[1];
+    float od[3] = {cs - dv * v[0], sn - dv * v[1], -dv * v[2]};
+    float ax[3] = {od[1] * v[2] - od[2] * v[1], od[2] * v[0] - od[0] * v[2],
+                   od[0] * v[1] - od[1] * v[0]};
+    float axl = sqrtf(ax[0] * ax[0] + ax[1] * ax[1] + ax[2] * ax[2]);
+    if (axl < 1e-12f)
+      continue;
+    ax[0] /= axl, ax[1] /= axl, ax[2] /= axl;
+    float na = n[0] * ax[0] + n[1] * ax[1] + n[2] * ax[2];
+    float pn[3] = {n[0] - ax[0] * na, n[1] - ax[1] * na, n[2] - ax[2] * na};
+    float pnl = sqrtf(pn[0] * pn[0] + pn[1] * pn[1] + pn[2] * pn[2]);
+    if (pnl < 1e-6f)
+      continue;
+    float cos_n = (pn[0] * v[0] + pn[1] * v[1] + pn[2] * v[2]) / pnl;
+    cos_n = cos_n < -1.0f ? -1.0f : (cos_n > 1.0f ? 1.0f : cos_n);
+    float ang_n = acosf(cos_n);
+    if (od[0] * pn[0] + od[1] * pn[1] + od[2] * pn[2] < 0.0f)
+      ang_n = -ang_n;
+
+    /* Lowest horizons are the tangent plane; side 0 steps along +dir */
+    float low[2] = {cosf(ang_n + AO_PI * 0.5f), cosf(ang_n - AO_PI * 0.5f)};
+    float hc[2] = {low[0], low[1]};
+    for (int st = 0; st < AO_STEPS; st++) {
+      float off = 1.0f + ((float)st + jit) / (float)AO_STEPS * (radius_px - 1);
+      int ox = (int)lroundf(cs * off), oy = (int)lroundf(-sn * off);
+      for (int side = 0; side < 2; side++) {
+        int qx = side ? lx - ox : lx + ox;
+        int qy = side ? ly - oy : ly + oy;
+        if (qx < 0 || qy < 0 || qx >= lw || qy >= lh)
+          continue;
+        const float *q = pos + ((size_t)qy * lw + qx) * 3;
+        if (q[2] == 0.0f)
+          continue;
+        float d[3] = {q[0] - p[0], q[1] - p[1], q[2] - p[2]};
+        float len = sqrtf(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+        /* Rounded offsets leave the slice plane, so samples on the
+         * surface itself scatter around the tangent; ignore those */
+        if (len < 1e-6f ||
+            d[0] * n[0] + d[1] * n[1] + d[2] * n[2] < AO_ANGLE_BIAS * len)
+          continue;
+        float shc = (d[0] * v[0] + d[1] * v[1] + d[2] * v[2]) / len;
+        float wgt = len * falloff_mul + falloff_add;
+        wgt = wgt < 0.0f ? 0.0f : (wgt > 1.0f ? 1.0f : wgt);
+        shc = low[side] + (shc - low[side]) * wgt;
+        if (shc > hc[side])
+          hc[side] = shc;
+      }
+    }
+
+    float h1 = acosf(hc[0] > 1.0f ? 1.0f : hc[0]);
+    float h0 = -acosf(hc[1] > 1.0f ? 1.0f : hc[1]);
+    h0 = ang_n + fmaxf(h0 - ang_n, -AO_PI * 0.5f);
+    h1 = ang_n + fminf(h1 - ang_n, AO_PI * 0.5f);
+    float sin_n = sinf(ang_n);
+    float arc0 = cos_n + 2.0f * h0 * sin_n - cosf(2.0f * h0 - ang_n);
+    float arc1 = cos_n + 2.0f * h1 * sin_n - cosf(2.0f * h1 - ang_n);
+    visibility += pnl * 0.25f * (arc0 + arc1);
+  }
+  return visibility / (float)AO_SLICES;
+}
+
+static void ssao_horizon_row(void *ctx_ptr, int ly) {
+  const SsaoCtx *c = (const SsaoCtx *)ctx_ptr;
+  float *out = c->s->ao + (size_t)ly * c->lw;
+  for (int lx = 0; lx < c->lw; lx++)
+    out[lx] = c->s->pos[((size_t)ly * c->lw + lx) * 3 + 2] != 0.0f
+                  ? ssao_texel(c, lx, ly)
+                  : 1.0f;
+}
+
+/* ---- 3. blur ---- */
+
+static void ssao_blur_row(void *ctx_ptr, int ly) {
+  const SsaoCtx *c = (const SsaoCtx *)ctx_ptr;
+  const float *pos = c->s->pos;
+  for (int lx = 0; lx < c->lw; lx++) {
+    size_t i = (size_t)ly * c->lw + lx;
+    float zc = pos[i * 3 + 2];
+    if (zc == 0.0f) {
+      c->s->blur[i] = 1.0f;
+      continue;
+    }
+    float tol = AO_DEPTH_TOL * fabsf(zc);
+    float sum = 0.0f, wsum = 0.0f;
+    for (int dy = -1; dy <= 2; dy++) {
+      int qy = ly + dy;
+      if (qy < 0 || qy >= c->lh)
+        continue;
+      for (int dx = -1; dx <= 2; dx++) {
+        int qx = lx + dx;
+        if (qx < 0 || qx >= c->lw)
+          continue;
+        size_t q = (size_t)qy * c->lw + qx;
+        float zq = pos[q * 3 + 2];
+        if (zq == 0.0f || fabsf(zq - zc) > tol)
+          continue;
+        sum += c->s->ao[q];
+        wsum += 1.0f;
+      }
+    }
+    c->s->blur[i] = sum / wsum; /* the center always passes */
+  }
+}
+
+/* ---- 4. bilateral upsample and apply ---- */
+
+static void ssao_apply_row(void *ctx_ptr, int y) {
+  const SsaoCtx *c = (const SsaoCtx *)ctx_ptr;
+  MopSwFramebuffer *fb = c->fb;
+  int w = fb->width, half = c->scale / 2;
+  float inv_scale = 1.0f / (float)c->scale;
+
+  float fy = ((float)y - (float)half) * inv_scale;
+  int ly0 = (int)floorf(fy);
+  float ty = fy - (float)ly0;
+
+  for (int x = 0; x < w; x++) {
+    size_t idx = (size_t)y * w + x;
+    float d = fb->depth[idx];
+    if (d > AO_FAR_DEPTH)
+      continue;
+    float z = view_z(c, d * 2.0f - 1.0f);
+    float inv_z = 1.0f / fabsf(z);
+
+    float fx = ((float)x - (float)half) * inv_scale;
+    int lx0 = (int)floorf(fx);
+    float tx = fx - (float)lx0;
+
+    float sum = 0.0f, wsum = 0.0f;
+    for (int j = 0; j < 2; j++) {
+      int qy = ly0 + j;
+      qy = qy < 0 ? 0 : (qy >= c->lh ? c->lh - 1 : qy);
+      float wy = j ? ty : 1.0f - ty;
+      for (int i = 0; i < 2; i++) {
+        int qx = lx0 + i;
+        qx = qx < 0 ? 0 : (qx >= c->lw ? c->lw - 1 : qx);
+        size_t q = (size_t)qy * c->lw + qx;
+        float zq = c->s->pos[q * 3 + 2];
+        if (zq == 0.0f)
+          continue;
+        float wx = i ? tx : 1.0f - tx;
+        float rel = fabsf(zq - z) * inv_z;
+        float wgt = (wx * wy + 1e-3f) / (1e-3f + rel);
+        sum += c->s->blur[q] * wgt;
+        wsum += wgt;
+      }
+    }
+    if (wsum <= 0.0f)
+      continue;
+
+    float ao = 1.0f + (sum / wsum - 1.0f) * AO_INTENSITY;
+    if (ao >= 1.0f)
+      continue;
+    if (ao < 0.0f)
+      ao = 0.0f;
+    float *hdr = fb->color_hdr + idx * 4;
+    uint8_t *ldr = fb->color + idx * 4;
+    for (int k = 0; k < 3; k++) {
+      hdr[k] *= ao;
+      ldr[k] = (uint8_t)((float)ldr[k] * ao + 0.5f);
+    }
+  }
+}
+
+/* ---- entry points ---- */
+
+void mop_sw_ssao_apply(MopSwSsao *s, MopSwFramebuffer *fb,
+                       const MopMat4 *proj, int scale,
+                       struct MopThreadPool *pool) {
+  if (!s || !fb || !fb->depth || !fb->color || !fb->color_hdr || !proj)
+    return;
+  if (scale < 1)
+    scale = 1;
+  const float *m = proj->d;
+  if (m[0] == 0.0f || m[5] == 0.0f || (m[10] == 0.0f && m[11] == 0.0f))
+    return;
+
+  SsaoCtx c = {.s = s, .fb = fb, .scale = scale};
+  c.lw = (fb->width + scale - 1) / scale;
+  c.lh = (fb->height + scale - 1) / scale;
+  size_t need = (size_t)c.lw * c.lh;
+  if (need > s->capacity) {
+    float *pos = realloc(s->pos, need * 3 * sizeof(float));
+    if (pos)
+      s->pos = pos;
+    float *ao = realloc(s->ao, need * sizeof(float));
+    if (ao)
+      s->ao = ao;
+    float *blur = realloc(s->blur, need * sizeof(float));
+    if (blur)
+      s->blur = blur;
+    if (!pos || !ao || !blur) {
+      MOP_WARN("ssao: out of memory for %dx%d, pass skipped", c.lw, c.lh);
+      return;
+    }
+    s->capacity = need;
+  }
+
+  /* Column-major: d[col * 4 + row] */
+  c.persp = m[11] != 0.0f;
+  if (c.persp) {
+    c.za = -m[14];
+    c.zb = m[10];
+    c.kx = -1.0f / m[0];
+    c.ox = -m[8] / m[0];
+    c.ky = -1.0f / m[5];
+    c.oy = -m[9] / m[5];
+  } else {
+    c.za = 1.0f / m[10];
+    c.zb = -m[14] / m[10];
+    c.kx = 1.0f / m[0];
+    c.ox = -m[12] / m[0];
+    c.ky = 1.0f / m[5];
+    c.oy = -m[13] / m[5];
+  }
+  c.px_per_unit = fabsf(m[0]) * 0.5f * (float)fb->width / (float)scale;
+
+  mop_threadpool_parallel_rows(pool, c.lh, ssao_prepare_row, &c);
+  mop_threadpool_parallel_rows(pool, c.lh, ssao_horizon_row, &c);
+  mop_threadpool_parallel_rows(pool, c.lh, ssao_blur_row, &c);
+  mop_threadpool_parallel_rows(pool, fb->height, ssao_apply_row, &c);
+}
+
+void mop_sw_ssao_free(MopSwSsao *s) {
+  if (!s)
+    return;
+  free(s->pos);
+  free(s->ao);
+  free(s->blur);
+  *s = (MopSwSsao){0};
+}
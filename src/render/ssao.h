@@ -0,0 +1,42 @@
+/*
+ * Master of Puppets — Post-Processing
+ * ssao.h — Screen-space ambient occlusion for the CPU backend
+ *
+ * Horizon-based AO (GTAO) computed from the software depth buffer, the
+ * CPU counterpart of mop_gtao.frag.  Runs at reduced resolution on the
+ * viewport thread pool, then a depth-aware blur and a joint bilateral
+ * upsample modulate the scene color before overlays are drawn.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef MOP_RENDER_SSAO_H
+#define MOP_RENDER_SSAO_H
+
+#include "rasterizer/rasterizer.h"
+
+#include <mop/types.h>
+#include <stddef.h>
+
+struct MopThreadPool;
+
+/* Grow-only low-resolution scratch, owned by the viewport */
+typedef struct MopSwSsao {
+  float *pos;      /* view-space xyz per low-res pixel (z = 0: empty) */
+  float *ao;       /* raw AO */
+  float *blur;     /* blurred AO */
+  size_t capacity; /* low-res pixels allocated */
+} MopSwSsao;
+
+/* Darken the geometry in fb (RGBA8 and HDR color) by ambient occlusion.
+ * proj is the projection the depth buffer was rendered with; AO is
+ * evaluated on a grid `scale` framebuffer pixels apart.  Rows are
+ * spread over pool (NULL = caller's thread).  Skipped with a warning if
+ * the scratch cannot be allocated. */
+void mop_sw_ssao_apply(MopSwSsao *s, MopSwFramebuffer *fb,
+                       const MopMat4 *proj, int scale,
+                       struct MopThreadPool *pool);
+
+void mop_sw_ssao_free(MopSwSsao *s);
+
+#endif /* MOP_RENDER_SSAO_H */
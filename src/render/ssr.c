@@ -0,0 +1,496 @@
+/*
+ * Master of Puppets — Post-Processing
+ * ssr.c — CPU screen-space reflections over a Hi-Z depth pyramid
+ *
+ * Four passes over the viewport thread pool:
+ *   1. hiz      — min-depth pyramid of the framebuffer depth, one level
+ *                 at a time; level 0 is the depth buffer itself
+ *   2. trace    — per low-res texel, in tiles of SSR_TILE x SSR_TILE:
+ *                 view position and normal from depth, reflect the view
+ *                 ray and march it in screen space over the pyramid.
+ *                 Cells the ray passes in front of are skipped whole and
+ *                 the level is raised; cells it may enter are refined
+ *                 down to single pixels, where the hit is accepted
+ *                 within SSR_THICKNESS of the surface
+ *                 (Uludag 2014, "Hi-Z Screen-Space Cone-Traced
+ *                 Reflections", without the cone).  Depth stored as
+ *                 (ndc z + 1) / 2 is linear in screen space, so the ray
+ *                 is a straight line in (x, y, depth).  Misses add
+ *                 nothing: the main pass already reflects the
+ *                 prefiltered environment (IBL) there
+ *   3. blur     — 3x3 over texels on the same surface (linear depth and
+ *                 normal similarity); no history is kept
+ *   4. upsample — joint bilateral on linear depth, as ssao.c, added to
+ *                 the HDR color scaled by intensity
+ *
+ * Ray length, thickness and edge fade match mop_ssr.frag.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "render/ssr.h"
+#include "core/thread_pool.h"
+
+#include <float.h>
+#include <math.h>
+#include <mop/util/log.h>
+#include <stdlib.h>
+
+#define SSR_MAX_DISTANCE 50.0f /* view units, as the shader */
+#define SSR_THICKNESS 0.3f     /* view units behind the surface */
+#define SSR_MAX_ITER 128       /* pyramid steps per ray */
+#define SSR_START_PX 1.5f      /* skip the origin pixel */
+#define SSR_CELL_EPS 0.01f     /* pixels past a cell boundary */
+#define SSR_TILE 8             /* texels per tile side */
+#define SSR_DEPTH_TOL 0.1f     /* blur: relative linear-depth tolerance */
+#define SSR_NORMAL_TOL 0.9f    /* blur: min cosine between normals */
+#define SSR_FAR_DEPTH 0.9999f  /* beyond: background, as the shaders */
+
+typedef struct SsrCtx {
+  MopSwSsr *s;
+  MopSwFramebuffer *fb;
+  const float *m;    /* projection, column-major */
+  int scale;
+  int lw, lh;
+  int tiles_x;
+  float intensity;
+  bool persp;
+  float za, zb;         /* view z from NDC z */
+  float kx, ox, ky, oy; /* view x/y from NDC x/y (scaled by z if persp) */
+
+  int levels, build;
+  int lvl_w[MOP_SW_SSR_HIZ_LEVELS], lvl_h[MOP_SW_SSR_HIZ_LEVELS];
+  float *lvl[MOP_SW_SSR_HIZ_LEVELS]; /* [0] = fb->depth */
+
+  float *tz;   /* per texel: view z (0 = empty) */
+  float *tn;   /* view normal */
+  float *col;  /* reflected radiance */
+  float *blur; /* denoised radiance */
+} SsrCtx;
+
+/* fminf/fmaxf are libm calls without -ffinite-math-only */
+static inline float ssr_min(float a, float b) { return a < b ? a : b; }
+static inline float ssr_max(float a, float b) { return a > b ? a : b; }
+
+static float view_z(const SsrCtx *c, float nz) {
+  return c->persp ? c->za / (nz + c->zb) : nz * c->za + c->zb;
+}
+
+static bool ssr_view_pos(const SsrCtx *c, int x, int y, float out[3]) {
+  int w = c->fb->width, h = c->fb->height;
+  if (x < 0 || y < 0 || x >= w || y >= h)
+    return false;
+  float d = c->fb->depth[(size_t)y * w + x];
+  if (d > SSR_FAR_DEPTH)
+    return false;
+  float nx = ((float)x + 0.5f) * 2.0f / (float)w - 1.0f;
+  float ny = 1.0f - ((float)y + 0.5f) * 2.0f / (float)h;
+  float z = view_z(c, d * 2.0f - 1.0f);
+  float sx = c->persp ? z : 1.0f;
+  out[0] = sx * (nx * c->kx + c->ox);
+  out[1] = sx * (ny * c->ky + c->oy);
+  out[2] = z;
+  return true;
+}
+
+/* View position to framebuffer pixels and stored depth */
+static void ssr_project(const SsrCtx *c, const float p[3], float out[3]) {
+  const float *m = c->m;
+  float cx = m[0] * p[0] + m[4] * p[1] + m[8] * p[2] + m[12];
+  float cy = m[1] * p[0] + m[5] * p[1] + m[9] * p[2] + m[13];
+  float cz = m[2] * p[0] + m[6] * p[1] + m[10] * p[2] + m[14];
+  float cw = m[3] * p[0] + m[7] * p[1] + m[11] * p[2] + m[15];
+  float iw = 1.0f / cw;
+  out[0] = (cx * iw * 0.5f + 0.5f) * (float)c->fb->width;
+  out[1] = (0.5f - cy * iw * 0.5f) * (float)c->fb->height;
+  out[2] = cz * iw * 0.5f + 0.5f;
+}
+
+/* ---- 1. Hi-Z pyramid ---- */
+
+static void ssr_hiz_row(void *ctx_ptr, int y) {
+  const SsrCtx *c = (const SsrCtx *)ctx_ptr;
+  int k = c->build;
+  int pw = c->lvl_w[k - 1], ph = c->lvl_h[k - 1];
+  const float *src = c->lvl[k - 1];
+  float *dst = c->lvl[k] + (size_t)y * c->lvl_w[k];
+  const float *r0 = src + (size_t)(2 * y) * pw;
+  const float *r1 = src + (size_t)(2 * y + 1 < ph ? 2 * y + 1 : ph - 1) * pw;
+  for (int x = 0; x < c->lvl_w[k]; x++) {
+    int x0 = 2 * x, x1 = 2 * x + 1 < pw ? 2 * x + 1 : pw - 1;
+    float a = ssr_min(r0[x0], r0[x1]), b = ssr_min(r1[x0], r1[x1]);
+    dst[x] = ssr_min(a, b);
+  }
+}
+
+/* ---- 2. trace ---- */
+
+/* March p0 -> p1 (pixels, depth) over the pyramid; on a hit store the
+ * framebuffer pixel in hx, hy */
+static bool ssr_march(const SsrCtx *c, const float p0[3], const float p1[3],
+                      int *hx, int *hy) {
+  int w = c->fb->width, h = c->fb->height;
+  float d[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+  float span = ssr_max(fabsf(d[0]), fabsf(d[1]));
+  if (span < SSR_START_PX)
+    return false; /* reflects straight into the screen */
+
+  float t_end = 1.0f;
+  if (d[0] != 0.0f)
+    t_end = ssr_min(t_end, ((d[0] > 0.0f ? (float)w : 0.0f) - p0[0]) / d[0]);
+  if (d[1] != 0.0f)
+    t_end = ssr_min(t_end, ((d[1] > 0.0f ? (float)h : 0.0f) - p0[1]) / d[1]);
+
+  /* Reciprocals: no divides in the loop */
+  float ix = d[0] != 0.0f ? 1.0f / d[0] : 0.0f;
+  float iy = d[1] != 0.0f ? 1.0f / d[1] : 0.0f;
+  float iz = d[2] > 0.0f ? 1.0f / d[2] : 0.0f;
+  float eps = SSR_CELL_EPS / span;
+  float t = SSR_START_PX / span;
+  int level = 0;
+  for (int it = 0; it < SSR_MAX_ITER && t < t_end; it++) {
+    float x = p0[0] + t * d[0], y = p0[1] + t * d[1], z = p0[2] + t * d[2];
+    if (z >= 1.0f)
+      return false; /* past the far plane */
+    int px = (int)x, py = (int)y;
+    px = px < 0 ? 0 : (px >= w ? w - 1 : px);
+    py = py < 0 ? 0 : (py >= h ? h - 1 : py);
+    int cx = px >> level, cy = py >> level;
+
+    float bx = (float)((d[0] > 0.0f ? cx + 1 : cx) << level);
+    float by = (float)((d[1] > 0.0f ? cy + 1 : cy) << level);
+    float tx = d[0] != 0.0f ? (bx - p0[0]) * ix : FLT_MAX;
+    float ty = d[1] != 0.0f ? (by - p0[1]) * iy : FLT_MAX;
+    float t_exit = ssr_max(ssr_min(tx, ty), t);
+
+    float dmin = c->lvl[level][(size_t)cy * c->lvl_w[level] + cx];
+    float z_exit = p0[2] + t_exit * d[2];
+    if (ssr_max(z, z_exit) < dmin) {
+      /* In front of everything in the cell: skip it, coarsen */
+      t = t_exit + eps;
+      if (level + 1 < c->levels)
+        level++;
+      continue;
+    }
+
+    /* Advance to where the ray reaches the cell's nearest depth */
+    float t_in = t;
+    if (z < dmin && d[2] > 0.0f)
+      t_in = ssr_min((dmin - p0[2]) * iz, t_exit);
+    if (level > 0) {
+      t = t_in;
+      level--;
+      continue;
+    }
+
+    if (dmin <= SSR_FAR_DEPTH) {
+      float zr = p0[2] + t_in * d[2];
+      float zs = view_z(c, dmin * 2.0f - 1.0f);
+      if (zs - view_z(c, zr * 2.0f - 1.0f) <= SSR_THICKNESS) {
+        *hx = cx;
+        *hy = cy;
+        return true;
+      }
+    }
+    t = t_exit + eps; /* passed behind a thin surface */
+  }
+  return false;
+}
+
+/* Derivative along one axis from the neighbor on the same surface */
+static bool pick_delta(const float *p, const float *lo, const float *hi,
+                       float out[3]) {
+  bool has_lo = lo != NULL, has_hi = hi != NULL;
+  if (has_lo && has_hi) {
+    if (fabsf(hi[2] - p[2]) < fabsf(p[2] - lo[2]))
+      has_lo = false;
+    else
+      has_hi = false;
+  }
+  if (has_hi) {
+    for (int k = 0; k < 3; k++)
+      out[k] = hi[k] - p[k];
+    return true;
+  }
+  if (has_lo) {
+    for (int k = 0; k < 3; k++)
+      out[k] = p[k] - lo[k];
+    return true;
+  }
+  return false;
+}
+
+static float edge_fade(float u) {
+  float a = u < 0.1f ? u / 0.1f : 1.0f;
+  float b = u > 0.9f ? (1.0f - u) / 0.1f : 1.0f;
+  a = a < 0.0f ? 0.0f : a;
+  b = b < 0.0f ? 0.0f : b;
+  return a * a * (3.0f - 2.0f * a) * b * b * (3.0f - 2.0f * b);
+}
+
+static void ssr_texel(const SsrCtx *c, int lx, int ly) {
+  int w = c->fb->width, h = c->fb->height;
+  size_t i = (size_t)ly * c->lw + lx;
+  float *n = c->tn + i * 3, *col = c->col + i * 3;
+  col[0] = col[1] = col[2] = 0.0f;
+  c->tz[i] = 0.0f;
+
+  int fx = lx * c->scale + c->scale / 2, fy = ly * c->scale + c->scale / 2;
+  fx = fx < w ? fx : w - 1;
+  fy = fy < h ? fy : h - 1;
+  float p[3], lo[3], hi[3], dx[3], dy[3];
+  if (!ssr_view_pos(c, fx, fy, p))
+    return;
+  c->tz[i] = p[2];
+
+  /* Normal from the depth derivatives; screen y runs down */
+  n[0] = n[1] = 0.0f, n[2] = 1.0f;
+  bool ok_x = pick_delta(p, ssr_view_pos(c, fx - 1, fy, lo) ? lo : NULL,
+                         ssr_view_pos(c, fx + 1, fy, hi) ? hi : NULL, dx);
+  bool ok_y = pick_delta(p, ssr_view_pos(c, fx, fy - 1, lo) ? lo : NULL,
+                         ssr_view_pos(c, fx, fy + 1, hi) ? hi : NULL, dy);
+  if (!ok_x || !ok_y)
+    return;
+  float cn[3] = {dx[1] * dy[2] - dx[2] * dy[1], dx[2] * dy[0] - dx[0] * dy[2],
+                 dx[0] * dy[1] - dx[1] * dy[0]};
+  float nl = sqrtf(cn[0] * cn[0] + cn[1] * cn[1] + cn[2] * cn[2]);
+  if (nl < 1e-20f)
+    return;
+
+  /* Incident direction; the normal faces the viewer */
+  float v[3] = {0.0f, 0.0f, -1.0f};
+  if (c->persp) {
+    float il = 1.0f / sqrtf(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+    v[0] = p[0] * il, v[1] = p[1] * il, v[2] = p[2] * il;
+  }
+  if (cn[0] * v[0] + cn[1] * v[1] + cn[2] * v[2] > 0.0f)
+    nl = -nl;
+  n[0] = cn[0] / nl, n[1] = cn[1] / nl, n[2] = cn[2] / nl;
+  float vn = 2.0f * (v[0] * n[0] + v[1] * n[1] + v[2] * n[2]);
+  float r[3] = {v[0] - vn * n[0], v[1] - vn * n[1], v[2] - vn * n[2]};
+
+  /* Rays back towards the camera, misses and the faded part of hits are
+   * left to the main pass's prefiltered environment (rasterizer IBL), as
+   * the shader leaves them */
+  if (r[2] <= 0.0f) {
+    float q[3] = {p[0] + r[0] * SSR_MAX_DISTANCE,
+                  p[1] + r[1] * SSR_MAX_DISTANCE,
+                  p[2] + r[2] * SSR_MAX_DISTANCE};
+    float s0[3], s1[3];
+    int hx, hy;
+    ssr_project(c, p, s0);
+    ssr_project(c, q, s1);
+    s0[0] = (float)fx + 0.5f, s0[1] = (float)fy + 0.5f;
+    if (ssr_march(c, s0, s1, &hx, &hy)) {
+      /* rgb * a of the shader output: the fade counts twice */
+      float fade = edge_fade(((float)hx + 0.5f) / (float)w) *
+                   edge_fade(((float)hy + 0.5f) / (float)h);
+      const float *src = c->fb->color_hdr + ((size_t)hy * w + hx) * 4;
+      for (int k = 0; k < 3; k++)
+        col[k] = src[k] * fade * fade;
+    }
+  }
+}
+
+static void ssr_trace_row(void *ctx_ptr, int tile_y) {
+  const SsrCtx *c = (const SsrCtx *)ctx_ptr;
+  int y0 = tile_y * SSR_TILE;
+  int y1 = y0 + SSR_TILE < c->lh ? y0 + SSR_TILE : c->lh;
+  for (int tx = 0; tx < c->tiles_x; tx++) {
+    int x0 = tx * SSR_TILE;
+    int x1 = x0 + SSR_TILE < c->lw ? x0 + SSR_TILE : c->lw;
+    for (int ly = y0; ly < y1; ly++)
+      for (int lx = x0; lx < x1; lx++)
+        ssr_texel(c, lx, ly);
+  }
+}
+
+/* ---- 3. blur ---- */
+
+static void ssr_blur_row(void *ctx_ptr, int ly) {
+  const SsrCtx *c = (const SsrCtx *)ctx_ptr;
+  for (int lx = 0; lx < c->lw; lx++) {
+    size_t i = (size_t)ly * c->lw + lx;
+    float zc = c->tz[i];
+    float *out = c->blur + i * 3;
+    if (zc == 0.0f) {
+      out[0] = out[1] = out[2] = 0.0f;
+      continue;
+    }
+    const float *nc = c->tn + i * 3;
+    float tol = SSR_DEPTH_TOL * fabsf(zc);
+    float sum[3] = {0.0f, 0.0f, 0.0f}, wsum = 0.0f;
+    for (int dy = -1; dy <= 1; dy++) {
+      int qy = ly + dy;
+      if (qy < 0 || qy >= c->lh)
+        continue;
+      for (int dx = -1; dx <= 1; dx++) {
+        int qx = lx + dx;
+        if (qx < 0 || qx >= c->lw)
+          continue;
+        size_t q = (size_t)qy * c->lw + qx;
+        float zq = c->tz[q];
+        const float *nq = c->tn + q * 3;
+        if (zq == 0.0f || fabsf(zq - zc) > tol ||
+            nc[0] * nq[0] + nc[1] * nq[1] + nc[2] * nq[2] < SSR_NORMAL_TOL)
+          continue;
+        for (int k = 0; k < 3; k++)
+          sum[k] += c->col[q * 3 + k];
+        wsum += 1.0f;
+      }
+    }
+    for (int k = 0; k < 3; k++)
+      out[k] = sum[k] / wsum; /* the center always passes */
+  }
+}
+
+/* ---- 4. bilateral upsample and apply ---- */
+
+static void ssr_apply_row(void *ctx_ptr, int y) {
+  const SsrCtx *c = (const SsrCtx *)ctx_ptr;
+  MopSwFramebuffer *fb = c->fb;
+  int w = fb->width, half = c->scale / 2;
+  float inv_scale = 1.0f / (float)c->scale;
+
+  float fy = ((float)y - (float)half) * inv_scale;
+  int ly0 = (int)floorf(fy);
+  float ty = fy - (float)ly0;
+  int qy[2] = {ly0 < 0 ? 0 : (ly0 >= c->lh ? c->lh - 1 : ly0),
+               ly0 + 1 >= c->lh ? c->lh - 1 : (ly0 + 1 < 0 ? 0 : ly0 + 1)};
+
+  for (int x = 0; x < w; x++) {
+    size_t idx = (size_t)y * w + x;
+    float d = fb->depth[idx];
+    if (d > SSR_FAR_DEPTH || fb->object_id[idx] == 0)
+      continue;
+
+    float fx = ((float)x - (float)half) * inv_scale;
+    int lx0 = (int)floorf(fx);
+    float tx = fx - (float)lx0;
+    int qx[2] = {lx0 < 0 ? 0 : (lx0 >= c->lw ? c->lw - 1 : lx0),
+                 lx0 + 1 >= c->lw ? c->lw - 1 : (lx0 + 1 < 0 ? 0 : lx0 + 1)};
+    size_t q[4];
+    bool lit = false;
+    for (int k = 0; k < 4; k++) {
+      q[k] = (size_t)qy[k >> 1] * c->lw + qx[k & 1];
+      const float *b = c->blur + q[k] * 3;
+      lit |= b[0] + b[1] + b[2] > 0.0f;
+    }
+    if (!lit)
+      continue; /* most rays miss: skip the weights */
+
+    float z = view_z(c, d * 2.0f - 1.0f);
+    float inv_z = 1.0f / fabsf(z);
+    float sum[3] = {0.0f, 0.0f, 0.0f}, wsum = 0.0f;
+    for (int k = 0; k < 4; k++) {
+      float zq = c->tz[q[k]];
+      if (zq == 0.0f)
+        continue;
+      float wx = (k & 1) ? tx : 1.0f - tx;
+      float wy = (k >> 1) ? ty : 1.0f - ty;
+      float rel = fabsf(zq - z) * inv_z;
+      float wgt = (wx * wy + 1e-3f) / (1e-3f + rel);
+      for (int ch = 0; ch < 3; ch++)
+        sum[ch] += c->blur[q[k] * 3 + ch] * wgt;
+      wsum += wgt;
+    }
+    if (wsum <= 0.0f)
+      continue;
+
+    float g = c->intensity / wsum;
+    float *hdr = fb->color_hdr + idx * 4;
+    for (int k = 0; k < 3; k++)
+      hdr[k] += sum[k] * g;
+  }
+}
+
+/* ---- entry points ---- */
+
+void mop_sw_ssr_apply(MopSwSsr *s, MopSwFramebuffer *fb, const MopMat4 *proj,
+                      int scale, float intensity, struct MopThreadPool *pool) {
+  if (!s || !fb || !fb->depth || !fb->color_hdr || !fb->object_id || !proj ||
+      intensity <= 0.0f)
+    return;
+  if (scale < 1)
+    scale = 1;
+  const float *m = proj->d;
+  if (m[0] == 0.0f || m[5] == 0.0f || (m[10] == 0.0f && m[11] == 0.0f))
+    return;
+
+  SsrCtx c = {.s = s,
+              .fb = fb,
+              .m = m,
+              .scale = scale,
+              .intensity = intensity};
+  c.lw = (fb->width + scale - 1) / scale;
+  c.lh = (fb->height + scale - 1) / scale;
+  c.tiles_x = (c.lw + SSR_TILE - 1) / SSR_TILE;
+
+  /* Pyramid levels until 1x1 */
+  c.lvl_w[0] = fb->width;
+  c.lvl_h[0] = fb->height;
+  c.levels = 1;
+  size_t hiz = 0;
+  while (c.levels < MOP_SW_SSR_HIZ_LEVELS &&
+         (c.lvl_w[c.levels - 1] > 1 || c.lvl_h[c.levels - 1] > 1)) {
+    c.lvl_w[c.levels] = (c.lvl_w[c.levels - 1] + 1) / 2;
+    c.lvl_h[c.levels] = (c.lvl_h[c.levels - 1] + 1) / 2;
+    hiz += (size_t)c.lvl_w[c.levels] * c.lvl_h[c.levels];
+    c.levels++;
+  }
+
+  size_t texels = (size_t)c.lw * c.lh;
+  size_t need = hiz + texels * 10;
+  if (need > s->capacity) {
+    float *buf = realloc(s->buf, need * sizeof(float));
+    if (!buf) {
+      MOP_WARN("ssr: out of memory for %dx%d, pass skipped", fb->width,
+               fb->height);
+      return;
+    }
+    s->buf = buf;
+    s->capacity = need;
+  }
+  c.lvl[0] = fb->depth;
+  float *p = s->buf;
+  for (int k = 1; k < c.levels; k++) {
+    c.lvl[k] = p;
+    p += (size_t)c.lvl_w[k] * c.lvl_h[k];
+  }
+  c.tz = p;
+  c.tn = c.tz + texels;
+  c.col = c.tn + texels * 3;
+  c.blur = c.col + texels * 3;
+
+  /* Column-major: d[col * 4 + row] */
+  c.persp = m[11] != 0.0f;
+  if (c.persp) {
+    c.za = -m[14];
+    c.zb = m[10];
+    c.kx = -1.0f / m[0];
+    c.ox = -m[8] / m[0];
+    c.ky = -1.0f / m[5];
+    c.oy = -m[9] / m[5];
+  } else {
+    c.za = 1.0f / m[10];
+    c.zb = -m[14] / m[10];
+    c.kx = 1.0f / m[0];
+    c.ox = -m[12] / m[0];
+    c.ky = 1.0f / m[5];
+    c.oy = -m[13] / m[5];
+  }
+
+  for (c.build = 1; c.build < c.levels; c.build++)
+    mop_threadpool_parallel_rows(pool, c.lvl_h[c.build], ssr_hiz_row, &c);
+  mop_threadpool_parallel_rows(pool, (c.lh + SSR_TILE - 1) / SSR_TILE,
+                               ssr_trace_row, &c);
+  mop_threadpool_parallel_rows(pool, c.lh, ssr_blur_row, &c);
+  mop_threadpool_parallel_rows(pool, fb->height, ssr_apply_row, &c);
+}
+
+void mop_sw_ssr_free(MopSwSsr *s) {
+  if (!s)
+    return;
+  free(s->buf);
+  *s = (MopSwSsr){0};
+}
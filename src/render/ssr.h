@@ -0,0 +1,45 @@
+/*
+ * Master of Puppets — Post-Processing
+ * ssr.h — Screen-space reflections for the CPU backend
+ *
+ * The CPU counterpart of mop_ssr.frag: reflection rays are traced over a
+ * min-depth pyramid (Hi-Z) of the software depth buffer at reduced
+ * resolution, denoised spatially and upsampled with a joint bilateral
+ * filter, then added to the HDR color.  Rays that miss fall back to the
+ * prefiltered environment the rasterizer's IBL already applied.  Tiles
+ * of texels are spread over the viewport thread pool.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef MOP_RENDER_SSR_H
+#define MOP_RENDER_SSR_H
+
+#include "rasterizer/rasterizer.h"
+
+#include <mop/types.h>
+#include <stddef.h>
+
+struct MopThreadPool;
+
+#define MOP_SW_SSR_HIZ_LEVELS 8 /* full resolution plus 7 min levels */
+
+/* Grow-only Hi-Z pyramid and low-resolution scratch, owned by the
+ * viewport */
+typedef struct MopSwSsr {
+  float *buf;      /* Hi-Z levels 1.., then per-texel z, normal, color */
+  size_t capacity; /* floats allocated */
+} MopSwSsr;
+
+/* Add reflections to the geometry in fb's HDR color.  proj is the
+ * projection the depth buffer was rendered with; rays are traced on a
+ * grid `scale` framebuffer pixels apart and added scaled by intensity,
+ * before the HDR resolve.  Background pixels (object ID 0) are left
+ * unchanged.  Rows are spread over pool (NULL = caller's thread).
+ * Skipped with a warning if the scratch cannot be allocated. */
+void mop_sw_ssr_apply(MopSwSsr *s, MopSwFramebuffer *fb, const MopMat4 *proj,
+                      int scale, float intensity, struct MopThreadPool *pool);
+
+void mop_sw_ssr_free(MopSwSsr *s);
+
+#endif /* MOP_RENDER_SSR_H */
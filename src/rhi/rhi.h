@@ -12,6 +12,7 @@
 #define MOP_RHI_H
 
 #include <mop/core/light.h>
+#include <mop/core/meshlet.h>
 #include <mop/core/vertex_format.h>
 #include <mop/render/backend.h>
 #include <mop/types.h>
@@ -26,6 +27,10 @@ typedef struct MopRhiFramebuffer MopRhiFramebuffer;
 typedef struct MopRhiTexture MopRhiTexture;
 typedef struct MopRhiShader MopRhiShader;
 
+struct MopThreadPool; /* core/thread_pool.h */
+struct MopSwMatProgram; /* rasterizer/rasterizer_material.h */
+struct MopSwShader;     /* rasterizer/rasterizer.h */
+
 /* -------------------------------------------------------------------------
  * Buffer descriptor
  * ------------------------------------------------------------------------- */
@@ -107,8 +112,42 @@ typedef struct MopRhiDrawCall {
    * True when at least one active directional light has cast_shadows=true.
    * Backends use this to skip shadow-map capture and the shadow pass. */
   bool cast_shadows;
+
+  /* Screen-door dither for LOD cross-fades — 0 = draw every pixel.
+   * Otherwise a pixel is written only where the 4x4 ordered-dither
+   * pattern is below the threshold (above it when dither_invert), so two
+   * draws with the same threshold and opposite polarity tile the screen.
+   * Backends without dither support draw every pixel. */
+  float dither_threshold;
+  bool dither_invert;
+
+  /* Meshlet clusters of the vertex/index buffers (NULL = none).  The CPU
+   * backend culls whole meshlets against the frustum, their normal cones
+   * and its depth pyramid before transforming any vertex; other backends
+   * draw the full index buffer. */
+  const MopMeshletData *meshlets;
+
+  /* Per-pixel material program lowered from the mesh's material graph
+   * (NULL = none).  The CPU backend evaluates it in place of the vertex
+   * color and the constant metallic / roughness / emissive, and skips
+   * per-vertex texture modulation; other backends use the flat material
+   * fields above. */
+  const struct MopSwMatProgram *material_program;
+
+  /* CPU shader plugin bound to the mesh (NULL = none).  The CPU backend
+   * runs its vertex callback on the transformed vertices and hands its
+   * fragment callback the covered pixels; other backends ignore it. */
+  const struct MopSwShader *shader;
 } MopRhiDrawCall;
 
+/* Per-frame meshlet culling counters (see MopRhiBackend.meshlet_stats) */
+typedef struct MopRhiMeshletStats {
+  uint32_t visible;   /* meshlets drawn */
+  uint32_t frustum;   /* culled: outside the view frustum */
+  uint32_t backface;  /* culled: normal cone faces away from the camera */
+  uint32_t occlusion; /* culled: behind the depth pyramid */
+} MopRhiMeshletStats;
+
 /* -------------------------------------------------------------------------
  * Backend function table
  *
@@ -120,9 +159,11 @@ typedef struct MopRhiDrawCall {
  *                leaves any of them NULL will crash at first render.
  *
  *   Optional   — every set_* effect hook (bloom, ssao, ssr, oit, volumetric,
- *                taa, ibl, exposure), decal operations, draw_skybox,
+ *                taa, ibl, exposure), decal operations, draw_decals,
+ *                draw_skybox,
  *                draw_overlays, frame_submit, frame_gpu_time_ms,
- *                texture_create_ex, texture_create_hdr, shader_create,
+ *                texture_create_ex, texture_create_hdr,
+ *                texture_create_shared, shader_create,
  *                shader_destroy, framebuffer_copy_to_texture. Every
  *                caller guards these with a NULL check; a backend may
  *                leave them NULL if the feature is unsupported (CPU
@@ -212,6 +253,15 @@ typedef struct MopRhiBackend {
                                       int height, int format, int mip_levels,
                                       const uint8_t *data, size_t data_size);
 
+  /* Create an RGBA8 texture that references `rgba_data` instead of
+   * copying it (content-addressed texture store).  The caller keeps the
+   * pixels alive and unchanged until texture_destroy.  Backends that
+   * must upload to device memory leave this NULL and the caller falls
+   * back to texture_create. */
+  MopRhiTexture *(*texture_create_shared)(MopRhiDevice *device, int width,
+                                          int height,
+                                          const uint8_t *rgba_data);
+
   void (*texture_destroy)(MopRhiDevice *device, MopRhiTexture *texture);
 
   /* Instanced drawing (Phase 6B) */
@@ -262,6 +312,13 @@ typedef struct MopRhiBackend {
   void (*remove_decal)(MopRhiDevice *dev, int32_t decal_id);
   void (*clear_decals)(MopRhiDevice *dev);
 
+  /* Project the stored decals onto fb's color through its depth buffer,
+   * after opaque geometry.  view_proj: 16 floats, the frame's projection
+   * * view.  pool: the viewport's thread pool (NULL = caller's thread).
+   * GPU backends apply decals inside frame_end and leave this NULL. */
+  void (*draw_decals)(MopRhiDevice *dev, MopRhiFramebuffer *fb,
+                      const float *view_proj, struct MopThreadPool *pool);
+
   /* Volumetric fog control.  GPU backends store parameters; CPU is a no-op. */
   void (*set_volumetric)(MopRhiDevice *dev, float density, float r, float g,
                          float b, float anisotropy, int steps);
@@ -336,6 +393,10 @@ typedef struct MopRhiBackend {
    * render path still issues per-mesh draws; consuming the indirect
    * buffer requires pipeline bucketing work (see docs/TODO.md). */
   void (*set_gpu_driven_rendering)(MopRhiDevice *dev, bool enabled);
+
+  /* Meshlet culling counters since the last frame_begin.  May be NULL
+   * for backends that do not cull meshlets. */
+  void (*meshlet_stats)(MopRhiDevice *dev, MopRhiMeshletStats *out);
 } MopRhiBackend;
 
 /* -------------------------------------------------------------------------
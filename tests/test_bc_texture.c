@@ -0,0 +1,192 @@
+/*
+ * Master of Puppets — Block-compressed texture tests
+ * test_bc_texture.c — On-demand BC1/BC3/BC5/BC7 decoding in the CPU backend
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "test_harness.h"
+
+#include "backend/cpu/cpu_bc.h"
+
+#include <mop/mop.h>
+
+/* Little-endian bit writer for hand-built BC7 blocks */
+typedef struct BitWriter {
+  uint8_t bytes[16];
+  uint32_t pos;
+} BitWriter;
+
+static void put_bits(BitWriter *w, uint32_t value, uint32_t count) {
+  for (uint32_t i = 0; i < count; i++, w->pos++)
+    if (value & (1u << i))
+      w->bytes[w->pos >> 3] |= (uint8_t)(1u << (w->pos & 7));
+}
+
+/* BC1 block with both endpoints set to one RGB565 color */
+static void bc1_solid(uint8_t out[8], uint16_t rgb565) {
+  memset(out, 0, 8);
+  out[0] = out[2] = (uint8_t)(rgb565 & 0xFF);
+  out[1] = out[3] = (uint8_t)(rgb565 >> 8);
+}
+
+static void test_bc7_mode6_gradient(void) {
+  TEST_BEGIN("bc: BC7 mode 6 interpolates 4-bit indices");
+  /* Mode 6: 7-bit RGBA endpoints + per-endpoint P-bit, 4-bit indices.
+   * Endpoint 0 = 0, endpoint 1 = 127 with P-bit 1 -> 255. */
+  BitWriter w = {{0}, 0};
+  put_bits(&w, 1u << 6, 7); /* mode 6 */
+  for (int c = 0; c < 4; c++) {
+    put_bits(&w, 0, 7);
+    put_bits(&w, 127, 7);
+  }
+  put_bits(&w, 0, 1);
+  put_bits(&w, 1, 1);
+  put_bits(&w, 0, 3); /* texel 0 is the anchor: 3 bits */
+  for (uint32_t i = 1; i < 16; i++)
+    put_bits(&w, i, 4);
+  TEST_ASSERT(w.pos == 128);
+
+  static const uint8_t weights[16] = {0,  4,  9,  13, 17, 21, 26, 30,
+                                      34, 38, 43, 47, 51, 55, 60, 64};
+  uint8_t out[64];
+  mop_cpu_bc_decode_block(4, w.bytes, out);
+  for (int i = 0; i < 16; i++) {
+    uint8_t expect = (uint8_t)((weights[i] * 255 + 32) >> 6);
+    TEST_ASSERT(out[i * 4 + 0] == expect);
+    TEST_ASSERT(out[i * 4 + 3] == expect);
+  }
+  TEST_END();
+}
+
+static void test_bc7_mode5_rotation(void) {
+  TEST_BEGIN("bc: BC7 mode 5 rotation swaps alpha into red");
+  /* Mode 5, rotation 1: opaque-black color, alpha endpoints 0 -> 255 */
+  BitWriter w = {{0}, 0};
+  put_bits(&w, 1u << 5, 6);
+  put_bits(&w, 1, 2); /* rotation: swap A and R */
+  for (int c = 0; c < 3; c++) {
+    put_bits(&w, 0, 7);
+    put_bits(&w, 0, 7);
+  }
+  put_bits(&w, 255, 8);
+  put_bits(&w, 255, 8);
+  /* color + alpha indices left zero */
+
+  uint8_t out[64];
+  mop_cpu_bc_decode_block(4, w.bytes, out);
+  TEST_ASSERT(out[0] == 255); /* red carries the alpha channel */
+  TEST_ASSERT(out[3] == 0);   /* alpha carries the red channel */
+  TEST_END();
+}
+
+static void test_bc7_reserved_mode(void) {
+  TEST_BEGIN("bc: BC7 reserved mode decodes to transparent black");
+  uint8_t block[16] = {0};
+  uint8_t out[64];
+  memset(out, 0xAB, sizeof(out));
+  mop_cpu_bc_decode_block(4, block, out);
+  for (int i = 0; i < 64; i++)
+    TEST_ASSERT(out[i] == 0);
+  TEST_END();
+}
+
+static void test_bc_texture_stays_compressed(void) {
+  TEST_BEGIN("bc: CPU texture samples blocks on demand");
+  MopViewportDesc desc = {
+      .width = 64, .height = 64, .backend = MOP_BACKEND_CPU};
+  MopViewport *vp = mop_viewport_create(&desc);
+  TEST_ASSERT(vp != NULL);
+
+  /* 8x4 texture = two BC1 blocks: red | blue */
+  uint8_t blocks[16];
+  bc1_solid(blocks, 0xF800);
+  bc1_solid(blocks + 8, 0x001F);
+  MopTexture *tex = mop_tex_create(
+      vp, &(MopTextureDesc){.width = 8,
+                            .height = 4,
+                            .format = MOP_TEX_FORMAT_BC1,
+                            .data = blocks,
+                            .data_size = sizeof(blocks)});
+  TEST_ASSERT(tex != NULL);
+
+  uint8_t rgba[8 * 4 * 4];
+  TEST_ASSERT(mop_tex_read_rgba8(vp, tex, rgba, sizeof(rgba)));
+  TEST_ASSERT(rgba[0] == 255 && rgba[2] == 0);
+  TEST_ASSERT(rgba[(3 * 8 + 7) * 4 + 0] == 0);
+  TEST_ASSERT(rgba[(3 * 8 + 7) * 4 + 2] == 255);
+
+  /* Truncated block data is rejected rather than over-read */
+  MopTexture *bad = mop_tex_create(
+      vp, &(MopTextureDesc){.width = 16,
+                            .height = 16,
+                            .format = MOP_TEX_FORMAT_BC7,
+                            .data = blocks,
+                            .data_size = sizeof(blocks)});
+  TEST_ASSERT(bad == NULL);
+
+  mop_viewport_destroy_texture(vp, tex);
+  mop_viewport_destroy(vp);
+  TEST_END();
+}
+
+static void test_bc_render_modulates(void) {
+  TEST_BEGIN("bc: rendering a BC1-textured mesh tints the vertex color");
+  MopViewportDesc desc = {
+      .width = 64, .height = 64, .backend = MOP_BACKEND_CPU};
+  MopViewport *vp = mop_viewport_create(&desc);
+  TEST_ASSERT(vp != NULL);
+  mop_viewport_set_camera(vp, (MopVec3){0, 0, 3}, (MopVec3){0, 0, 0},
+                          (MopVec3){0, 1, 0}, 60.0f, 0.1f, 100.0f);
+
+  uint8_t block[8];
+  bc1_solid(block, 0xF800); /* pure red */
+  MopTexture *tex = mop_tex_create(
+      vp, &(MopTextureDesc){.width = 4,
+                            .height = 4,
+                            .format = MOP_TEX_FORMAT_BC1,
+                            .data = block,
+                            .data_size = sizeof(block)});
+  TEST_ASSERT(tex != NULL);
+
+  MopVertex verts[4] = {
+      {{-1, -1, 0}, {0, 0, 1}, {1, 1, 1, 1}, 0, 0},
+      {{1, -1, 0}, {0, 0, 1}, {1, 1, 1, 1}, 1, 0},
+      {{1, 1, 0}, {0, 0, 1}, {1, 1, 1, 1}, 1, 1},
+      {{-1, 1, 0}, {0, 0, 1}, {1, 1, 1, 1}, 0, 1},
+  };
+  uint32_t idx[6] = {0, 1, 2, 0, 2, 3};
+  MopMesh *mesh = mop_viewport_add_mesh(
+      vp, &(MopMeshDesc){.vertices = verts,
+                         .vertex_count = 4,
+                         .indices = idx,
+                         .index_count = 6,
+                         .object_id = 1});
+  TEST_ASSERT(mesh != NULL);
+  mop_mesh_set_texture(mesh, tex);
+  TEST_ASSERT(mop_viewport_render(vp) == MOP_RENDER_OK);
+
+  int w = 0, h = 0;
+  const uint8_t *px = mop_viewport_read_color(vp, &w, &h);
+  TEST_ASSERT(px != NULL);
+  const uint8_t *c = px + ((size_t)(h / 2) * w + w / 2) * 4;
+  TEST_ASSERT(c[0] > 0);
+  TEST_ASSERT(c[1] < c[0] / 4 && c[2] < c[0] / 4);
+
+  mop_viewport_destroy_texture(vp, tex);
+  mop_viewport_destroy(vp);
+  TEST_END();
+}
+
+int main(void) {
+  TEST_SUITE_BEGIN("bc_texture");
+
+  TEST_RUN(test_bc7_mode6_gradient);
+  TEST_RUN(test_bc7_mode5_rotation);
+  TEST_RUN(test_bc7_reserved_mode);
+  TEST_RUN(test_bc_texture_stays_compressed);
+  TEST_RUN(test_bc_render_modulates);
+
+  TEST_REPORT();
+  TEST_EXIT();
+}
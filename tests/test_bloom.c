@@ -0,0 +1,180 @@
+/*
+ * Master of Puppets — CPU bloom tests
+ * test_bloom.c — Mip-chain bloom on the software HDR buffer
+ *
+ * Tests validate:
+ *   - A bright quad on a dark backdrop spreads a halo onto the backdrop
+ *     that fades with distance; far pixels are unchanged
+ *   - Nothing below the threshold blooms: the frame is bit-identical
+ *   - Background pixels (object ID 0) never receive bloom
+ *   - Odd framebuffer sizes and SSAA work
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "test_harness.h"
+
+#include <mop/mop.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void add_quad(MopViewport *vp, float s, float z, MopColor c,
+                     uint32_t id) {
+  MopVertex v[4];
+  memset(v, 0, sizeof(v));
+  v[0].position = (MopVec3){-s, -s, z};
+  v[1].position = (MopVec3){s, -s, z};
+  v[2].position = (MopVec3){s, s, z};
+  v[3].position = (MopVec3){-s, s, z};
+  for (int i = 0; i < 4; i++) {
+    v[i].normal = (MopVec3){0, 0, 1};
+    v[i].color = c;
+  }
+  uint32_t idx[6] = {0, 1, 2, 0, 2, 3};
+  mop_viewport_add_mesh(vp, &(MopMeshDesc){.vertices = v,
+                                           .vertex_count = 4,
+                                           .indices = idx,
+                                           .index_count = 6,
+                                           .object_id = id});
+}
+
+/* Small white quad, optionally in front of a dark backdrop */
+static MopViewport *make_scene(int w, int h, int ssaa, uint32_t effects,
+                               float threshold, bool backdrop) {
+  MopViewport *vp = mop_viewport_create(&(MopViewportDesc){
+      .width = w,
+      .height = h,
+      .backend = MOP_BACKEND_CPU,
+      .ssaa_factor = ssaa});
+  if (!vp)
+    return NULL;
+  mop_viewport_set_post_effects(vp, effects);
+  mop_viewport_set_bloom(vp, threshold, 1.0f);
+  mop_viewport_set_chrome(vp, false);
+  mop_viewport_set_camera(vp, (MopVec3){0, 0, 5}, (MopVec3){0, 0, 0},
+                          (MopVec3){0, 1, 0}, 45.0f, 0.1f, 100.0f);
+  if (backdrop)
+    add_quad(vp, 4, -0.5f, (MopColor){0.05f, 0.05f, 0.05f, 1}, 1);
+  add_quad(vp, 0.2f, 0, (MopColor){1, 1, 1, 1}, 2);
+  return vp;
+}
+
+static uint8_t *render_copy(MopViewport *vp, int *w, int *h) {
+  mop_viewport_render(vp);
+  const uint8_t *px = mop_viewport_read_color(vp, w, h);
+  uint8_t *copy = malloc((size_t)*w * *h * 4);
+  memcpy(copy, px, (size_t)*w * *h * 4);
+  return copy;
+}
+
+typedef struct HaloResult {
+  bool ok;
+  int near_off, near_on; /* red just outside the quad */
+  int mid_off, mid_on;   /* red further out */
+  int far_diff;          /* max red change near the frame corner */
+} HaloResult;
+
+/* The quad covers about 9% of the height around the center */
+static HaloResult run_halo(int w, int h, int ssaa) {
+  HaloResult r = {0};
+  MopViewport *a = make_scene(w, h, ssaa, 0, 0.05f, true);
+  MopViewport *b = make_scene(w, h, ssaa, MOP_POST_BLOOM, 0.05f, true);
+  if (a && b) {
+    int ow, oh;
+    uint8_t *off = render_copy(a, &ow, &oh);
+    uint8_t *on = render_copy(b, &ow, &oh);
+    int cy = oh / 2, cx = ow / 2, q = oh * 6 / 100;
+    size_t near = ((size_t)cy * ow + cx + q) * 4;
+    size_t mid = ((size_t)cy * ow + cx + 3 * q) * 4;
+    r.ok = true;
+    r.near_off = off[near];
+    r.near_on = on[near];
+    r.mid_off = off[mid];
+    r.mid_on = on[mid];
+    for (int y = 0; y < oh / 8; y++)
+      for (int x = 0; x < ow / 8; x++) {
+        size_t i = ((size_t)y * ow + x) * 4;
+        int d = abs((int)on[i] - (int)off[i]);
+        r.far_diff = d > r.far_diff ? d : r.far_diff;
+      }
+    free(off);
+    free(on);
+  }
+  mop_viewport_destroy(a);
+  mop_viewport_destroy(b);
+  return r;
+}
+
+static void test_halo(void) {
+  TEST_BEGIN("bloom: bright quad spreads a fading halo");
+  HaloResult r = run_halo(128, 128, 1);
+  TEST_ASSERT(r.ok);
+  TEST_ASSERT(r.near_on > r.near_off + 2);
+  TEST_ASSERT(r.mid_on >= r.mid_off);
+  TEST_ASSERT(r.near_on - r.near_off > r.mid_on - r.mid_off);
+  TEST_ASSERT(r.far_diff <= 1);
+  TEST_END();
+}
+
+static void test_odd_size_ssaa(void) {
+  TEST_BEGIN("bloom: odd size and SSAA");
+  HaloResult r = run_halo(101, 67, 2);
+  TEST_ASSERT(r.ok);
+  TEST_ASSERT(r.near_on > r.near_off + 2);
+  TEST_ASSERT(r.far_diff <= 1);
+  TEST_END();
+}
+
+static void test_below_threshold(void) {
+  TEST_BEGIN("bloom: nothing above threshold leaves the frame unchanged");
+  MopViewport *a = make_scene(96, 64, 1, 0, 10.0f, true);
+  MopViewport *b = make_scene(96, 64, 1, MOP_POST_BLOOM, 10.0f, true);
+  TEST_ASSERT(a && b);
+  int w, h;
+  uint8_t *off = render_copy(a, &w, &h);
+  uint8_t *on = render_copy(b, &w, &h);
+  TEST_ASSERT(memcmp(off, on, (size_t)w * h * 4) == 0);
+  free(off);
+  free(on);
+  mop_viewport_destroy(a);
+  mop_viewport_destroy(b);
+  TEST_END();
+}
+
+static void test_background_untouched(void) {
+  TEST_BEGIN("bloom: background pixels are not bloomed");
+  MopViewport *a = make_scene(96, 96, 1, 0, 0.05f, false);
+  MopViewport *b = make_scene(96, 96, 1, MOP_POST_BLOOM, 0.05f, false);
+  TEST_ASSERT(a && b);
+  int w, h;
+  uint8_t *off = render_copy(a, &w, &h);
+  uint8_t *on = render_copy(b, &w, &h);
+  int bg_diff = 0, quad_gain = 0;
+  for (int i = 0; i < w * h; i++) {
+    MopPickResult p = mop_viewport_pick(b, i % w, i / w);
+    int d = (int)on[i * 4] - (int)off[i * 4];
+    if (!p.hit)
+      bg_diff = abs(d) > bg_diff ? abs(d) : bg_diff;
+    else
+      quad_gain = d > quad_gain ? d : quad_gain;
+  }
+  TEST_ASSERT(bg_diff == 0);
+  TEST_ASSERT(quad_gain > 0);
+  free(off);
+  free(on);
+  mop_viewport_destroy(a);
+  mop_viewport_destroy(b);
+  TEST_END();
+}
+
+int main(void) {
+  TEST_SUITE_BEGIN("bloom");
+
+  TEST_RUN(test_halo);
+  TEST_RUN(test_odd_size_ssaa);
+  TEST_RUN(test_below_threshold);
+  TEST_RUN(test_background_untouched);
+
+  TEST_REPORT();
+  TEST_EXIT();
+}
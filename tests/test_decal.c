@@ -3,7 +3,7 @@
  * test_decal.c — Phase 4E: Deferred Decal System
  *
  * Tests decal API, push constant layout, UBO layout, shader math
- * (edge fade, UV projection), and Vulkan struct fields.
+ * (edge fade, UV projection), CPU projection, and Vulkan struct fields.
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -13,6 +13,7 @@
 #include <math.h>
 #include <mop/mop.h>
 #include <mop/render/decal.h>
+#include <stdlib.h>
 #include <string.h>
 
 /* -------------------------------------------------------------------------
@@ -158,7 +159,7 @@ static void test_decal_discard_outside(void) {
 }
 
 /* -------------------------------------------------------------------------
- * Public API: add/remove decals via CPU backend (NULL function pointers)
+ * Public API: add/remove decals via the CPU backend
  * ------------------------------------------------------------------------- */
 
 static void test_decal_api_cpu(void) {
@@ -168,23 +169,185 @@ static void test_decal_api_cpu(void) {
   MopViewport *vp = mop_viewport_create(&desc);
   TEST_ASSERT(vp != NULL);
 
-  /* CPU backend has no decal support — should return -1 */
   MopDecalDesc dd = {
       .transform = mop_mat4_identity(),
       .opacity = 1.0f,
       .texture_idx = -1,
   };
-  int32_t id = mop_viewport_add_decal(vp, &dd);
-  TEST_ASSERT(id == -1);
+  TEST_ASSERT(mop_viewport_add_decal(vp, &dd) == 0);
+  TEST_ASSERT(mop_viewport_add_decal(vp, &dd) == 1);
 
-  /* Remove should be a safe no-op */
+  /* Freed IDs are reused; the table holds MOP_MAX_DECALS */
   mop_viewport_remove_decal(vp, 0);
+  TEST_ASSERT(mop_viewport_add_decal(vp, &dd) == 0);
+  for (int i = 2; i < MOP_MAX_DECALS; i++)
+    TEST_ASSERT(mop_viewport_add_decal(vp, &dd) == i);
+  TEST_ASSERT(mop_viewport_add_decal(vp, &dd) == -1);
+
   mop_viewport_clear_decals(vp);
+  TEST_ASSERT(mop_viewport_add_decal(vp, &dd) == 0);
+  mop_viewport_remove_decal(vp, -1); /* safe no-ops */
+  mop_viewport_remove_decal(vp, MOP_MAX_DECALS);
 
   mop_viewport_destroy(vp);
   TEST_END();
 }
 
+/* -------------------------------------------------------------------------
+ * CPU rendering: grey wall at z = 0 facing the camera
+ * ------------------------------------------------------------------------- */
+
+#define DECAL_VP 128
+
+static MopViewport *decal_scene(void) {
+  MopViewport *vp = mop_viewport_create(&(MopViewportDesc){
+      .width = DECAL_VP, .height = DECAL_VP, .backend = MOP_BACKEND_CPU});
+  if (!vp)
+    return NULL;
+  mop_viewport_set_post_effects(vp, 0);
+  mop_viewport_set_chrome(vp, false);
+  mop_viewport_set_camera(vp, (MopVec3){0, 0, 5}, (MopVec3){0, 0, 0},
+                          (MopVec3){0, 1, 0}, 45.0f, 0.1f, 100.0f);
+  MopVertex v[4];
+  memset(v, 0, sizeof(v));
+  v[0].position = (MopVec3){-1.5f, -1.5f, 0};
+  v[1].position = (MopVec3){1.5f, -1.5f, 0};
+  v[2].position = (MopVec3){1.5f, 1.5f, 0};
+  v[3].position = (MopVec3){-1.5f, 1.5f, 0};
+  for (int i = 0; i < 4; i++) {
+    v[i].normal = (MopVec3){0, 0, 1};
+    v[i].color = (MopColor){0.8f, 0.8f, 0.8f, 1};
+  }
+  uint32_t idx[6] = {0, 1, 2, 0, 2, 3};
+  mop_viewport_add_mesh(vp, &(MopMeshDesc){.vertices = v,
+                                           .vertex_count = 4,
+                                           .indices = idx,
+                                           .index_count = 6,
+                                           .object_id = 1});
+  return vp;
+}
+
+static uint8_t *decal_render(MopViewport *vp) {
+  int w = 0, h = 0;
+  mop_viewport_render(vp);
+  const uint8_t *px = mop_viewport_read_color(vp, &w, &h);
+  uint8_t *copy = malloc((size_t)w * h * 4);
+  if (copy)
+    memcpy(copy, px, (size_t)w * h * 4);
+  return copy;
+}
+
+static const uint8_t *decal_px(const uint8_t *img, int x, int y) {
+  return img + ((size_t)y * DECAL_VP + x) * 4;
+}
+
+/* Unit box at the origin covers about +-15 pixels around the center */
+static void test_decal_cpu_black(void) {
+  TEST_BEGIN("decal_cpu_black");
+  MopViewport *vp = decal_scene();
+  TEST_ASSERT(vp != NULL);
+  uint8_t *before = decal_render(vp);
+  int32_t id = mop_viewport_add_decal(
+      vp, &(MopDecalDesc){
+              .transform = mop_mat4_identity(), .opacity = 1.0f,
+              .texture_idx = 1});
+  TEST_ASSERT(id >= 0);
+  uint8_t *after = decal_render(vp);
+  TEST_ASSERT(before && after);
+  TEST_ASSERT(decal_px(before, 64, 64)[0] > 50);
+  TEST_ASSERT(decal_px(after, 64, 64)[0] < 10);
+  /* Edge fade: partly covered near the box side, untouched outside */
+  TEST_ASSERT(decal_px(after, 78, 64)[0] > decal_px(after, 64, 64)[0]);
+  TEST_ASSERT(memcmp(decal_px(after, 90, 64), decal_px(before, 90, 64), 4) ==
+              0);
+  TEST_ASSERT(memcmp(decal_px(after, 64, 10), decal_px(before, 64, 10), 4) ==
+              0);
+
+  /* Removing it restores the frame */
+  mop_viewport_remove_decal(vp, id);
+  uint8_t *removed = decal_render(vp);
+  TEST_ASSERT(removed != NULL);
+  TEST_ASSERT(memcmp(before, removed, (size_t)DECAL_VP * DECAL_VP * 4) == 0);
+  free(before);
+  free(after);
+  free(removed);
+  mop_viewport_destroy(vp);
+  TEST_END();
+}
+
+/* A box that overlaps the wall on screen but not in depth marks nothing */
+static void test_decal_cpu_depth(void) {
+  TEST_BEGIN("decal_cpu_depth");
+  MopViewport *vp = decal_scene();
+  TEST_ASSERT(vp != NULL);
+  uint8_t *before = decal_render(vp);
+  mop_viewport_add_decal(
+      vp, &(MopDecalDesc){.transform = mop_mat4_translate((MopVec3){0, 0, 2}),
+                          .opacity = 1.0f,
+                          .texture_idx = 1});
+  uint8_t *after = decal_render(vp);
+  TEST_ASSERT(before && after);
+  TEST_ASSERT(memcmp(before, after, (size_t)DECAL_VP * DECAL_VP * 4) == 0);
+  free(before);
+  free(after);
+  mop_viewport_destroy(vp);
+  TEST_END();
+}
+
+/* Texture index 2 + i is the i-th texture created: red | green maps
+ * across the box's local x */
+static void test_decal_cpu_texture(void) {
+  TEST_BEGIN("decal_cpu_texture");
+  MopViewport *vp = decal_scene();
+  TEST_ASSERT(vp != NULL);
+  const uint8_t rg[8] = {255, 0, 0, 255, 0, 255, 0, 255};
+  MopTexture *tex = mop_viewport_create_texture(vp, 2, 1, rg);
+  TEST_ASSERT(tex != NULL);
+  mop_viewport_add_decal(
+      vp, &(MopDecalDesc){.transform = mop_mat4_scale((MopVec3){2, 1, 1}),
+                          .opacity = 1.0f,
+                          .texture_idx = 2});
+  uint8_t *img = decal_render(vp);
+  TEST_ASSERT(img != NULL);
+  const uint8_t *left = decal_px(img, 50, 64), *right = decal_px(img, 78, 64);
+  TEST_ASSERT(left[0] > 2 * left[1]);
+  TEST_ASSERT(right[1] > 2 * right[0]);
+  free(img);
+  mop_viewport_destroy(vp);
+  TEST_END();
+}
+
+/* Many small decals: each pixel takes only the decal over it */
+static void test_decal_cpu_many(void) {
+  TEST_BEGIN("decal_cpu_many");
+  MopViewport *vp = decal_scene();
+  TEST_ASSERT(vp != NULL);
+  uint8_t *before = decal_render(vp);
+  for (int j = 0; j < 14; j++)
+    for (int i = 0; i < 14; i++) {
+      MopMat4 t = mop_mat4_multiply(
+          mop_mat4_translate((MopVec3){-1.3f + 0.2f * (float)i,
+                                       -1.3f + 0.2f * (float)j, 0}),
+          mop_mat4_scale((MopVec3){0.1f, 0.1f, 0.5f}));
+      TEST_ASSERT(mop_viewport_add_decal(
+                      vp, &(MopDecalDesc){.transform = t,
+                                          .opacity = 1.0f,
+                                          .texture_idx = 1}) >= 0);
+    }
+  uint8_t *after = decal_render(vp);
+  TEST_ASSERT(before && after);
+  /* Decal centers go black, the gaps between them stay unchanged */
+  int cx = 64 + (int)(0.1f / 2.07f * 64.0f);
+  TEST_ASSERT(decal_px(after, cx, cx)[0] < 10);
+  int gx = 64 + (int)(0.2f / 2.07f * 64.0f);
+  TEST_ASSERT(memcmp(decal_px(after, gx, gx), decal_px(before, gx, gx), 4) ==
+              0);
+  free(before);
+  free(after);
+  mop_viewport_destroy(vp);
+  TEST_END();
+}
+
 /* -------------------------------------------------------------------------
  * MOP_MAX_DECALS constant
  * ------------------------------------------------------------------------- */
@@ -267,6 +430,12 @@ int main(void) {
   test_decal_api_cpu();
   test_decal_max_constant();
 
+  /* CPU rendering */
+  test_decal_cpu_black();
+  test_decal_cpu_depth();
+  test_decal_cpu_texture();
+  test_decal_cpu_many();
+
 #if defined(MOP_HAS_VULKAN)
   test_decal_device_fields();
   test_decal_framebuffer_fields();
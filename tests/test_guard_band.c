@@ -0,0 +1,142 @@
+/*
+ * Master of Puppets — Guard-band clipping tests
+ * test_guard_band.c — Overhanging triangles rasterized without x/y clipping
+ *
+ * Tests validate:
+ *   - A quad overhanging the viewport inside the guard band and one
+ *     reaching far beyond it both cover every pixel at the same depth
+ *   - Triangles crossing the near plane are still clipped (a ground
+ *     plane running behind the camera stays below the horizon)
+ *   - Triangles entirely off one side of the viewport draw nothing
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "test_harness.h"
+
+#include <math.h>
+#include <mop/mop.h>
+#include <string.h>
+
+#define VP_SIZE 64
+
+static MopViewport *make_viewport(MopVec3 eye, MopVec3 target) {
+  MopViewport *vp = mop_viewport_create(&(MopViewportDesc){
+      .width = VP_SIZE, .height = VP_SIZE, .backend = MOP_BACKEND_CPU});
+  if (!vp)
+    return NULL;
+  mop_viewport_set_post_effects(vp, 0);
+  mop_viewport_set_camera(vp, eye, target, (MopVec3){0, 1, 0}, 45.0f, 0.1f,
+                          100.0f);
+  return vp;
+}
+
+/* Quad in the plane y = 0 (ground) or z = 0 (wall), facing the camera */
+static void add_quad(MopViewport *vp, bool ground, float x0, float x1,
+                     float c0, float c1, uint32_t id) {
+  MopVertex v[4];
+  memset(v, 0, sizeof(v));
+  MopVec3 n = ground ? (MopVec3){0, 1, 0} : (MopVec3){0, 0, 1};
+  float xs[4] = {x0, x1, x1, x0};
+  float cs[4] = {c0, c0, c1, c1};
+  for (int i = 0; i < 4; i++) {
+    v[i].position = ground ? (MopVec3){xs[i], 0, cs[i]}
+                           : (MopVec3){xs[i], cs[i], 0};
+    v[i].normal = n;
+    v[i].color = (MopColor){0.6f, 0.6f, 0.6f, 1.0f};
+  }
+  /* Counter-clockwise seen from +z (wall), or from +y when c0 > c1 */
+  uint32_t idx[6] = {0, 1, 2, 0, 2, 3};
+  mop_viewport_add_mesh(vp, &(MopMeshDesc){.vertices = v,
+                                           .vertex_count = 4,
+                                           .indices = idx,
+                                           .index_count = 6,
+                                           .object_id = id});
+}
+
+static void test_overhang_matches_far_overhang(void) {
+  TEST_BEGIN("guard_band: overhanging quads cover the whole viewport");
+  /* Visible half-extent at z = 0 is ~2.07: 6 stays inside the guard
+   * band, 500 is far outside it and gets clipped */
+  MopViewport *a = make_viewport((MopVec3){0, 0, 5}, (MopVec3){0, 0, 0});
+  MopViewport *b = make_viewport((MopVec3){0, 0, 5}, (MopVec3){0, 0, 0});
+  TEST_ASSERT(a && b);
+  add_quad(a, false, -6, 6, -6, 6, 7);
+  add_quad(b, false, -500, 500, -500, 500, 7);
+  mop_viewport_render(a);
+  mop_viewport_render(b);
+
+  int covered = 0;
+  float max_dz = 0.0f;
+  for (int y = 0; y < VP_SIZE; y++)
+    for (int x = 0; x < VP_SIZE; x++) {
+      MopPickResult pa = mop_viewport_pick(a, x, y);
+      MopPickResult pb = mop_viewport_pick(b, x, y);
+      if (pa.hit && pa.object_id == 7 && pb.hit && pb.object_id == 7)
+        covered++;
+      max_dz = fmaxf(max_dz, fabsf(pa.depth - pb.depth));
+    }
+  TEST_ASSERT(covered == VP_SIZE * VP_SIZE);
+  TEST_ASSERT(max_dz < 1e-5f);
+
+  mop_viewport_destroy(a);
+  mop_viewport_destroy(b);
+  TEST_END();
+}
+
+static void test_near_plane_still_clipped(void) {
+  TEST_BEGIN("guard_band: ground plane behind the camera is near-clipped");
+  /* Eye 1 unit above a ground plane that extends behind it, looking at
+   * the horizon: the plane fills exactly the lower half */
+  MopViewport *vp = make_viewport((MopVec3){0, 1, 0}, (MopVec3){0, 1, -10});
+  TEST_ASSERT(vp != NULL);
+  add_quad(vp, true, -50, 50, 50, -50, 3);
+  mop_viewport_render(vp);
+
+  int upper = 0, lower = 0;
+  for (int y = 0; y < VP_SIZE; y++)
+    for (int x = 0; x < VP_SIZE; x++) {
+      MopPickResult p = mop_viewport_pick(vp, x, y);
+      bool hit = p.hit && p.object_id == 3;
+      if (y < VP_SIZE / 2 - 2)
+        upper += hit;
+      else if (y >= VP_SIZE / 2 + 2)
+        lower += hit;
+    }
+  TEST_ASSERT(upper == 0);
+  TEST_ASSERT(lower == (VP_SIZE / 2 - 2) * VP_SIZE);
+
+  mop_viewport_destroy(vp);
+  TEST_END();
+}
+
+static void test_offscreen_rejected(void) {
+  TEST_BEGIN("guard_band: triangles beside the viewport draw nothing");
+  MopViewport *vp = make_viewport((MopVec3){0, 0, 5}, (MopVec3){0, 0, 0});
+  TEST_ASSERT(vp != NULL);
+  /* Inside the guard band but entirely right of the viewport, and far
+   * outside it on the left */
+  add_quad(vp, false, 2.5f, 8.0f, -1.0f, 1.0f, 4);
+  add_quad(vp, false, -900.0f, -3.0f, -1.0f, 1.0f, 5);
+  mop_viewport_render(vp);
+
+  int hits = 0;
+  for (int y = 0; y < VP_SIZE; y++)
+    for (int x = 0; x < VP_SIZE; x++)
+      hits += mop_viewport_pick(vp, x, y).hit;
+  TEST_ASSERT(hits == 0);
+
+  mop_viewport_destroy(vp);
+  TEST_END();
+}
+
+int main(void) {
+  TEST_SUITE_BEGIN("guard_band");
+
+  TEST_RUN(test_overhang_matches_far_overhang);
+  TEST_RUN(test_near_plane_still_clipped);
+  TEST_RUN(test_offscreen_rejected);
+
+  TEST_REPORT();
+  TEST_EXIT();
+}
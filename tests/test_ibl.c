@@ -0,0 +1,241 @@
+/*
+ * Master of Puppets — IBL precomputation tests
+ * test_ibl.c — SH irradiance, prefiltered chain, shared BRDF LUT and the
+ *              on-disk IBL cache
+ *
+ * HDRIs are synthesized with stb_image_write into a scratch directory,
+ * and HOME is pointed at the same directory so the disk cache never
+ * touches the real user cache.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "test_harness.h"
+
+#include "core/viewport_internal.h"
+#include "stb_image_write.h"
+
+#include <dirent.h>
+#include <mop/mop.h>
+#include <string.h>
+#include <sys/stat.h>
+
+/* Declared in environment.c — CPU-side IBL sampling */
+void mop_env_sample_irradiance(const MopViewport *vp, MopVec3 normal,
+                               float out[3]);
+void mop_env_sample_brdf_lut(const MopViewport *vp, float ndotv,
+                             float roughness, float *scale, float *bias);
+
+static char s_scratch[256];
+
+static MopViewport *make_viewport(void) {
+  MopViewportDesc desc = {
+      .width = 32, .height = 32, .backend = MOP_BACKEND_CPU};
+  return mop_viewport_create(&desc);
+}
+
+/* Write a w x h HDR whose radiance is `top` above the horizon and
+ * `bottom` below it. */
+static bool write_hdr(const char *path, int w, int h, float top,
+                      float bottom) {
+  float *px = malloc((size_t)w * h * 3 * sizeof(float));
+  if (!px)
+    return false;
+  for (int y = 0; y < h; y++) {
+    /* equirect v grows downward in the file, upward in direction space */
+    float val = y < h / 2 ? bottom : top;
+    for (int x = 0; x < w; x++) {
+      px[((size_t)y * w + x) * 3 + 0] = val;
+      px[((size_t)y * w + x) * 3 + 1] = val;
+      px[((size_t)y * w + x) * 3 + 2] = val;
+    }
+  }
+  int ok = stbi_write_hdr(path, w, h, 3, px);
+  free(px);
+  return ok != 0;
+}
+
+static bool file_exists(const char *path) {
+  struct stat st;
+  return stat(path, &st) == 0;
+}
+
+static void test_constant_env(void) {
+  TEST_BEGIN("ibl: constant environment integrates to itself");
+  char path[320];
+  snprintf(path, sizeof(path), "%s/const.hdr", s_scratch);
+  TEST_ASSERT(write_hdr(path, 128, 64, 2.0f, 2.0f));
+
+  MopViewport *vp = make_viewport();
+  TEST_ASSERT(vp != NULL);
+  MopEnvironmentDesc env = {
+      .type = MOP_ENV_HDRI, .hdr_path = path, .intensity = 1.0f};
+  TEST_ASSERT(mop_viewport_set_environment(vp, &env));
+
+  TEST_ASSERT(vp->env_irradiance_sh_valid);
+  TEST_ASSERT(vp->env_irradiance_data != NULL);
+  size_t irr_px = (size_t)vp->env_irradiance_w * vp->env_irradiance_h;
+  for (size_t i = 0; i < irr_px; i++)
+    TEST_ASSERT(fabsf(vp->env_irradiance_data[i * 4] - 2.0f) < 0.05f);
+
+  TEST_ASSERT(vp->env_prefiltered_data != NULL);
+  TEST_ASSERT(vp->env_prefiltered_levels == 5);
+  size_t pf_px = 0;
+  for (int l = 0; l < vp->env_prefiltered_levels; l++)
+    pf_px += (size_t)(vp->env_prefiltered_w >> l) *
+             (size_t)(vp->env_prefiltered_h >> l);
+  for (size_t i = 0; i < pf_px; i++)
+    TEST_ASSERT(fabsf(vp->env_prefiltered_data[i * 4] - 2.0f) < 0.05f);
+
+  mop_viewport_destroy(vp);
+  TEST_END();
+}
+
+static void test_sh_directional(void) {
+  TEST_BEGIN("ibl: SH irradiance follows the bright hemisphere");
+  char path[320];
+  snprintf(path, sizeof(path), "%s/split.hdr", s_scratch);
+  TEST_ASSERT(write_hdr(path, 128, 64, 1.0f, 0.0f));
+
+  MopViewport *vp = make_viewport();
+  TEST_ASSERT(vp != NULL);
+  MopEnvironmentDesc env = {
+      .type = MOP_ENV_HDRI, .hdr_path = path, .intensity = 1.0f};
+  TEST_ASSERT(mop_viewport_set_environment(vp, &env));
+
+  /* Analytic cosine-weighted mean radiance: 1 facing up, 0 facing down,
+   * 0.5 sideways.  L2 SH is within a few percent of each. */
+  float up[3], down[3], side[3];
+  mop_env_sample_irradiance(vp, (MopVec3){0, 1, 0}, up);
+  mop_env_sample_irradiance(vp, (MopVec3){0, -1, 0}, down);
+  mop_env_sample_irradiance(vp, (MopVec3){1, 0, 0}, side);
+  TEST_ASSERT(fabsf(up[0] - 1.0f) < 0.1f);
+  TEST_ASSERT(down[0] < 0.1f);
+  TEST_ASSERT(fabsf(side[0] - 0.5f) < 0.05f);
+
+  mop_viewport_destroy(vp);
+  TEST_END();
+}
+
+static void test_brdf_lut_shared(void) {
+  TEST_BEGIN("ibl: BRDF LUT computed once and shared across viewports");
+  MopViewport *a = make_viewport();
+  MopViewport *b = make_viewport();
+  TEST_ASSERT(a != NULL && b != NULL);
+
+  MopEnvironmentDesc env = {.type = MOP_ENV_PROCEDURAL_SKY, .intensity = 1.0f};
+  TEST_ASSERT(mop_viewport_set_environment(a, &env));
+  TEST_ASSERT(mop_viewport_set_environment(b, &env));
+  TEST_ASSERT(a->env_brdf_lut_data != NULL);
+  TEST_ASSERT(a->env_brdf_lut_data == b->env_brdf_lut_data);
+
+  /* Split-sum sanity: a smooth surface seen head-on reflects ~everything */
+  float scale, bias;
+  mop_env_sample_brdf_lut(a, 1.0f, 0.0f, &scale, &bias);
+  TEST_ASSERT(scale + bias > 0.9f && scale + bias < 1.05f);
+
+  mop_viewport_destroy(a);
+  /* b must still see valid LUT data after a is gone */
+  mop_env_sample_brdf_lut(b, 0.5f, 0.5f, &scale, &bias);
+  TEST_ASSERT(scale > 0.0f && scale < 1.0f);
+  mop_viewport_destroy(b);
+  TEST_END();
+}
+
+/* Overwrite the last float of the single cache file in `dir` (the last
+ * texel of the prefiltered chain) with `value`. */
+static bool patch_cache_tail(const char *dir, float value) {
+  DIR *d = opendir(dir);
+  if (!d)
+    return false;
+  char path[768] = {0};
+  int found = 0;
+  struct dirent *e;
+  while ((e = readdir(d)) != NULL) {
+    size_t n = strlen(e->d_name);
+    if (n > 4 && strcmp(e->d_name + n - 4, ".bin") == 0) {
+      snprintf(path, sizeof(path), "%s/%s", dir, e->d_name);
+      found++;
+    }
+  }
+  closedir(d);
+  if (found != 1)
+    return false;
+  FILE *f = fopen(path, "r+b");
+  if (!f)
+    return false;
+  bool ok = fseek(f, -(long)sizeof(float), SEEK_END) == 0 &&
+            fwrite(&value, sizeof(value), 1, f) == 1;
+  return fclose(f) == 0 && ok;
+}
+
+static void test_disk_cache_roundtrip(void) {
+  TEST_BEGIN("ibl: disk cache hit reproduces computed maps");
+  char path[320];
+  snprintf(path, sizeof(path), "%s/cached.hdr", s_scratch);
+  TEST_ASSERT(write_hdr(path, 96, 48, 3.0f, 0.5f));
+
+  /* A HOME of its own, so this HDRI's file is the only one in the cache */
+  char home[320];
+  snprintf(home, sizeof(home), "%s/cache_home", s_scratch);
+  mkdir(home, 0755);
+  setenv("HOME", home, 1);
+
+  MopViewport *a = make_viewport();
+  TEST_ASSERT(a != NULL);
+  MopEnvironmentDesc env = {
+      .type = MOP_ENV_HDRI, .hdr_path = path, .intensity = 1.0f};
+  TEST_ASSERT(mop_viewport_set_environment(a, &env));
+
+  char cache_dir[384];
+  snprintf(cache_dir, sizeof(cache_dir), "%s/.cache/mop/ibl", home);
+  TEST_ASSERT(file_exists(cache_dir));
+
+  MopViewport *b = make_viewport();
+  TEST_ASSERT(b != NULL);
+  TEST_ASSERT(mop_viewport_set_environment(b, &env));
+
+  TEST_ASSERT(memcmp(a->env_irradiance_sh, b->env_irradiance_sh,
+                     sizeof(a->env_irradiance_sh)) == 0);
+  size_t pf_px = 0;
+  for (int l = 0; l < a->env_prefiltered_levels; l++)
+    pf_px += (size_t)(a->env_prefiltered_w >> l) *
+             (size_t)(a->env_prefiltered_h >> l);
+  TEST_ASSERT(memcmp(a->env_prefiltered_data, b->env_prefiltered_data,
+                     pf_px * 4 * sizeof(float)) == 0);
+
+  /* Equal maps could also mean a deterministic recompute: alter the file
+   * and check that the next load returns the altered value. */
+  const float marker = 12345.0f;
+  TEST_ASSERT(a->env_prefiltered_data[pf_px * 4 - 1] != marker);
+  TEST_ASSERT(patch_cache_tail(cache_dir, marker));
+  MopViewport *c = make_viewport();
+  TEST_ASSERT(c != NULL);
+  TEST_ASSERT(mop_viewport_set_environment(c, &env));
+  TEST_ASSERT(c->env_prefiltered_data[pf_px * 4 - 1] == marker);
+  TEST_ASSERT(memcmp(a->env_prefiltered_data, c->env_prefiltered_data,
+                     (pf_px * 4 - 1) * sizeof(float)) == 0);
+
+  mop_viewport_destroy(a);
+  mop_viewport_destroy(b);
+  mop_viewport_destroy(c);
+  setenv("HOME", s_scratch, 1);
+  TEST_END();
+}
+
+int main(void) {
+  snprintf(s_scratch, sizeof(s_scratch), "/tmp/mop_test_ibl_XXXXXX");
+  if (!mkdtemp(s_scratch))
+    MOP_TEST_SKIP("ibl: mkdtemp failed, skipping\n");
+  setenv("HOME", s_scratch, 1);
+
+  TEST_SUITE_BEGIN("ibl");
+
+  TEST_RUN(test_constant_env);
+  TEST_RUN(test_sh_directional);
+  TEST_RUN(test_brdf_lut_shared);
+  TEST_RUN(test_disk_cache_roundtrip);
+
+  TEST_REPORT();
+  TEST_EXIT();
+}
@@ -0,0 +1,218 @@
+/*
+ * Master of Puppets — LOD transition tests
+ * test_lod_transition.c — Hysteresis bands and dithered LOD cross-fades
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "test_harness.h"
+
+#include "core/viewport_internal.h"
+
+#include <mop/mop.h>
+
+#include <stdlib.h>
+
+#define VP_SIZE 128
+#define THRESHOLD 40.0f
+
+/* n x n grid of quads spanning [-1, 1]^2 at z = 0, one flat color.
+ * 16 x 16 = 512 triangles, enough to take the tiled rasterizer path. */
+static void make_grid(int n, MopColor color, MopVertex **out_v,
+                      uint32_t **out_idx, uint32_t *out_vc,
+                      uint32_t *out_ic) {
+  uint32_t vc = (uint32_t)((n + 1) * (n + 1));
+  uint32_t ic = (uint32_t)(n * n * 6);
+  MopVertex *v = calloc(vc, sizeof(MopVertex));
+  uint32_t *idx = malloc(ic * sizeof(uint32_t));
+  for (int y = 0; y <= n; y++)
+    for (int x = 0; x <= n; x++) {
+      MopVertex *p = &v[y * (n + 1) + x];
+      p->position = (MopVec3){-1.0f + 2.0f * x / n, -1.0f + 2.0f * y / n, 0};
+      p->normal = (MopVec3){0, 0, 1};
+      p->color = color;
+    }
+  uint32_t k = 0;
+  for (int y = 0; y < n; y++)
+    for (int x = 0; x < n; x++) {
+      uint32_t a = (uint32_t)(y * (n + 1) + x), b = a + 1;
+      uint32_t c = a + (uint32_t)(n + 1), d = c + 1;
+      idx[k++] = a, idx[k++] = b, idx[k++] = d;
+      idx[k++] = a, idx[k++] = d, idx[k++] = c;
+    }
+  *out_v = v;
+  *out_idx = idx;
+  *out_vc = vc;
+  *out_ic = ic;
+}
+
+/* Red full-detail grid with a single blue LOD level at THRESHOLD px */
+static MopMesh *add_two_level_mesh(MopViewport *vp) {
+  MopVertex *v;
+  uint32_t *idx, vc, ic;
+  make_grid(16, (MopColor){1, 0, 0, 1}, &v, &idx, &vc, &ic);
+  MopMesh *mesh = mop_viewport_add_mesh(
+      vp, &(MopMeshDesc){.vertices = v,
+                         .vertex_count = vc,
+                         .indices = idx,
+                         .index_count = ic,
+                         .object_id = 1});
+  free(v);
+  free(idx);
+  if (!mesh)
+    return NULL;
+
+  make_grid(16, (MopColor){0, 0, 1, 1}, &v, &idx, &vc, &ic);
+  int32_t lod = mop_mesh_add_lod(mesh, vp,
+                                 &(MopMeshDesc){.vertices = v,
+                                                .vertex_count = vc,
+                                                .indices = idx,
+                                                .index_count = ic,
+                                                .object_id = 1},
+                                 THRESHOLD);
+  free(v);
+  free(idx);
+  return lod == 1 ? mesh : NULL;
+}
+
+static MopViewport *make_viewport(void) {
+  MopViewportDesc desc = {.width = VP_SIZE,
+                          .height = VP_SIZE,
+                          .backend = MOP_BACKEND_CPU,
+                          .ssaa_factor = 1};
+  MopViewport *vp = mop_viewport_create(&desc);
+  if (vp)
+    mop_viewport_set_post_effects(vp, 0);
+  return vp;
+}
+
+/* Render with the camera placed so the grid projects to `diameter` px */
+static void render_at(MopViewport *vp, float diameter) {
+  float radius = sqrtf(8.0f) * 0.5f;
+  float dist = radius * (float)VP_SIZE / diameter;
+  mop_viewport_set_camera(vp, (MopVec3){0, 0, dist}, (MopVec3){0, 0, 0},
+                          (MopVec3){0, 1, 0}, 60.0f, 0.1f, 100.0f);
+  mop_viewport_render(vp);
+}
+
+/* Count red- and blue-dominant pixels in the central 16x16 block */
+static void count_center(MopViewport *vp, int *red, int *blue) {
+  int w = 0, h = 0;
+  const uint8_t *px = mop_viewport_read_color(vp, &w, &h);
+  *red = *blue = 0;
+  for (int y = h / 2 - 8; y < h / 2 + 8; y++)
+    for (int x = w / 2 - 8; x < w / 2 + 8; x++) {
+      const uint8_t *c = px + ((size_t)y * w + x) * 4;
+      if (c[0] > c[2] + 16)
+        (*red)++;
+      else if (c[2] > c[0] + 16)
+        (*blue)++;
+    }
+}
+
+static void test_hysteresis_band(void) {
+  TEST_BEGIN("lod: hysteresis keeps the level near a threshold");
+  MopViewport *vp = make_viewport();
+  TEST_ASSERT(vp != NULL);
+  MopMesh *mesh = add_two_level_mesh(vp);
+  TEST_ASSERT(mesh != NULL);
+  TEST_ASSERT(mop_viewport_get_lod_hysteresis(vp) > 0.0f);
+
+  render_at(vp, THRESHOLD * 1.5f);
+  TEST_ASSERT(mesh->active_lod == 0);
+
+  /* Inside the band on either side: no switch */
+  render_at(vp, THRESHOLD * 0.95f);
+  TEST_ASSERT(mesh->active_lod == 0);
+  render_at(vp, THRESHOLD * 1.05f);
+  TEST_ASSERT(mesh->active_lod == 0);
+
+  /* Past the lower edge: coarsen, then hold inside the band */
+  render_at(vp, THRESHOLD * 0.85f);
+  TEST_ASSERT(mesh->active_lod == 1);
+  render_at(vp, THRESHOLD * 1.05f);
+  TEST_ASSERT(mesh->active_lod == 1);
+  render_at(vp, THRESHOLD * 0.95f);
+  TEST_ASSERT(mesh->active_lod == 1);
+  render_at(vp, THRESHOLD * 1.15f);
+  TEST_ASSERT(mesh->active_lod == 0);
+
+  /* Band 0 restores the hard threshold */
+  mop_viewport_set_lod_hysteresis(vp, 0.0f);
+  render_at(vp, THRESHOLD * 0.95f);
+  TEST_ASSERT(mesh->active_lod == 1);
+  render_at(vp, THRESHOLD * 1.05f);
+  TEST_ASSERT(mesh->active_lod == 0);
+
+  mop_viewport_set_lod_hysteresis(vp, 5.0f);
+  TEST_ASSERT(mop_viewport_get_lod_hysteresis(vp) == 0.5f);
+  mop_viewport_destroy(vp);
+  TEST_END();
+}
+
+static void test_orbit_no_churn(void) {
+  TEST_BEGIN("lod: jitter around a threshold never switches levels");
+  MopViewport *vp = make_viewport();
+  TEST_ASSERT(vp != NULL);
+  MopMesh *mesh = add_two_level_mesh(vp);
+  TEST_ASSERT(mesh != NULL);
+
+  render_at(vp, THRESHOLD * 0.5f);
+  int switches = 0;
+  uint32_t last = mesh->active_lod;
+  for (int f = 0; f < 20; f++) {
+    render_at(vp, THRESHOLD * ((f & 1) ? 0.97f : 1.03f));
+    if (mesh->active_lod != last)
+      switches++;
+    last = mesh->active_lod;
+  }
+  TEST_ASSERT(switches == 0);
+  mop_viewport_destroy(vp);
+  TEST_END();
+}
+
+static void test_dithered_crossfade(void) {
+  TEST_BEGIN("lod: cross-fade dithers between levels over N frames");
+  MopViewport *vp = make_viewport();
+  TEST_ASSERT(vp != NULL);
+  MopMesh *mesh = add_two_level_mesh(vp);
+  TEST_ASSERT(mesh != NULL);
+  mop_viewport_set_lod_fade_frames(vp, 3);
+  TEST_ASSERT(mop_viewport_get_lod_fade_frames(vp) == 3);
+
+  int red, blue;
+  render_at(vp, THRESHOLD * 1.5f);
+  render_at(vp, THRESHOLD * 1.5f);
+  count_center(vp, &red, &blue);
+  TEST_ASSERT(red == 256 && blue == 0);
+
+  /* Switch to LOD 1: blue coverage grows 1/4, 2/4, 3/4, then all.
+   * Every pixel comes from exactly one level. */
+  static const int expect_blue[4] = {64, 128, 192, 256};
+  for (int f = 0; f < 4; f++) {
+    render_at(vp, THRESHOLD * 0.5f);
+    TEST_ASSERT(mesh->active_lod == 1);
+    count_center(vp, &red, &blue);
+    TEST_ASSERT(blue == expect_blue[f]);
+    TEST_ASSERT(red + blue == 256);
+  }
+
+  /* Fading disabled: switches are instant */
+  mop_viewport_set_lod_fade_frames(vp, 0);
+  render_at(vp, THRESHOLD * 1.5f);
+  count_center(vp, &red, &blue);
+  TEST_ASSERT(red == 256 && blue == 0);
+  mop_viewport_destroy(vp);
+  TEST_END();
+}
+
+int main(void) {
+  TEST_SUITE_BEGIN("lod_transition");
+
+  TEST_RUN(test_hysteresis_band);
+  TEST_RUN(test_orbit_no_churn);
+  TEST_RUN(test_dithered_crossfade);
+
+  TEST_REPORT();
+  TEST_EXIT();
+}
@@ -0,0 +1,152 @@
+/*
+ * Master of Puppets — Matrix kernel tests
+ * test_math_batch.c — Vectorized mat4 products and batch transforms
+ *
+ * Tests validate:
+ *   - mop_mat4_multiply / mop_mat4_mul_vec4 match a plain scalar
+ *     reference bit for bit (same accumulation order on every path)
+ *   - mop_mat4_transform_points equals mop_mat4_mul_vec4 with w = 1 for
+ *     packed and strided input
+ *   - mop_mat4_multiply_batch equals per-element products, in place too
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "test_harness.h"
+
+#include <mop/mop.h>
+#include <string.h>
+
+static uint32_t s_rng = 12345u;
+
+static float rnd(void) {
+  s_rng = s_rng * 1664525u + 1013904223u;
+  return (float)(s_rng >> 8) * (1.0f / 8388608.0f) - 1.0f; /* [-1, 1) */
+}
+
+static MopMat4 random_mat(void) {
+  MopMat4 m;
+  for (int i = 0; i < 16; i++)
+    m.d[i] = rnd() * 10.0f;
+  return m;
+}
+
+static MopMat4 ref_multiply(MopMat4 a, MopMat4 b) {
+  MopMat4 r;
+  for (int c = 0; c < 4; c++)
+    for (int row = 0; row < 4; row++) {
+      float s = a.d[row] * b.d[c * 4];
+      for (int k = 1; k < 4; k++)
+        s += a.d[k * 4 + row] * b.d[c * 4 + k];
+      r.d[c * 4 + row] = s;
+    }
+  return r;
+}
+
+static MopVec4 ref_mul_vec4(MopMat4 m, MopVec4 v) {
+  float in[4] = {v.x, v.y, v.z, v.w}, out[4];
+  for (int row = 0; row < 4; row++) {
+    float s = m.d[row] * in[0];
+    for (int k = 1; k < 4; k++)
+      s += m.d[k * 4 + row] * in[k];
+    out[row] = s;
+  }
+  return (MopVec4){out[0], out[1], out[2], out[3]};
+}
+
+static void test_products_match_reference(void) {
+  TEST_BEGIN("math: mat4 products match the scalar reference exactly");
+  int mismatches = 0;
+  for (int n = 0; n < 200; n++) {
+    MopMat4 a = random_mat(), b = random_mat();
+    MopMat4 got = mop_mat4_multiply(a, b);
+    MopMat4 ref = ref_multiply(a, b);
+    mismatches += memcmp(&got, &ref, sizeof(MopMat4)) != 0;
+
+    MopVec4 v = {rnd() * 50.0f, rnd() * 50.0f, rnd() * 50.0f, rnd()};
+    MopVec4 gv = mop_mat4_mul_vec4(a, v);
+    MopVec4 rv = ref_mul_vec4(a, v);
+    mismatches += memcmp(&gv, &rv, sizeof(MopVec4)) != 0;
+  }
+  TEST_ASSERT(mismatches == 0);
+  TEST_END();
+}
+
+static void test_transform_points(void) {
+  TEST_BEGIN("math: transform_points equals mul_vec4 with w = 1");
+  enum { N = 37 };
+  MopMat4 m = random_mat();
+  MopVertex verts[N];
+  MopVec3 packed[N];
+  memset(verts, 0, sizeof(verts));
+  for (int i = 0; i < N; i++) {
+    packed[i] = (MopVec3){rnd() * 100.0f, rnd() * 100.0f, rnd() * 100.0f};
+    verts[i].position = packed[i];
+    verts[i].normal = (MopVec3){1e30f, 1e30f, 1e30f}; /* must not be read */
+  }
+
+  MopVec4 a[N], b[N];
+  mop_mat4_transform_points(&m, packed, 0, N, a);
+  mop_mat4_transform_points(&m, &verts[0].position, sizeof(MopVertex), N, b);
+  int mismatches = 0;
+  for (int i = 0; i < N; i++) {
+    MopVec4 ref = mop_mat4_mul_vec4(
+        m, (MopVec4){packed[i].x, packed[i].y, packed[i].z, 1.0f});
+    mismatches += memcmp(&a[i], &ref, sizeof(MopVec4)) != 0;
+    mismatches += memcmp(&b[i], &ref, sizeof(MopVec4)) != 0;
+  }
+  TEST_ASSERT(mismatches == 0);
+
+  /* count 0 writes nothing */
+  MopVec4 sentinel = {7, 7, 7, 7};
+  mop_mat4_transform_points(&m, packed, 0, 0, &sentinel);
+  TEST_ASSERT(sentinel.x == 7.0f && sentinel.w == 7.0f);
+  TEST_END();
+}
+
+static void test_multiply_batch(void) {
+  TEST_BEGIN("math: multiply_batch equals per-element products");
+  enum { N = 19 };
+  MopMat4 a = random_mat();
+  MopMat4 b[N], out[N], ref[N];
+  for (int i = 0; i < N; i++) {
+    b[i] = random_mat();
+    ref[i] = mop_mat4_multiply(a, b[i]);
+  }
+  mop_mat4_multiply_batch(&a, b, N, out);
+  TEST_ASSERT(memcmp(out, ref, sizeof(out)) == 0);
+
+  /* In place: out == b */
+  mop_mat4_multiply_batch(&a, b, N, b);
+  TEST_ASSERT(memcmp(b, ref, sizeof(b)) == 0);
+
+  /* Chained view/projection products, as instancing uses them */
+  MopMat4 view = mop_mat4_look_at((MopVec3){3, 2, 5}, (MopVec3){0, 0, 0},
+                                  (MopVec3){0, 1, 0});
+  MopMat4 proj = mop_mat4_perspective(0.8f, 1.5f, 0.1f, 100.0f);
+  MopMat4 models[N], mvp[N];
+  for (int i = 0; i < N; i++)
+    models[i] = mop_mat4_compose_trs((MopVec3){rnd(), rnd(), rnd()},
+                                     (MopVec3){rnd(), rnd(), rnd()},
+                                     (MopVec3){1, 2, 1});
+  mop_mat4_multiply_batch(&view, models, N, mvp);
+  mop_mat4_multiply_batch(&proj, mvp, N, mvp);
+  int mismatches = 0;
+  for (int i = 0; i < N; i++) {
+    MopMat4 r = mop_mat4_multiply(proj, mop_mat4_multiply(view, models[i]));
+    mismatches += memcmp(&mvp[i], &r, sizeof(MopMat4)) != 0;
+  }
+  TEST_ASSERT(mismatches == 0);
+  TEST_END();
+}
+
+int main(void) {
+  TEST_SUITE_BEGIN("math_batch");
+
+  TEST_RUN(test_products_match_reference);
+  TEST_RUN(test_transform_points);
+  TEST_RUN(test_multiply_batch);
+
+  TEST_REPORT();
+  TEST_EXIT();
+}
@@ -0,0 +1,273 @@
+/*
+ * Master of Puppets — Mesh edit tests
+ * test_mesh_edit.c — Localized buffer updates for edit operations
+ *
+ * Tests validate:
+ *   - Moving a vertex uploads only its one-ring and recomputes the
+ *     normals there, leaving the rest of the mesh untouched
+ *   - Extrude and split upload the new geometry plus the rewritten faces,
+ *     and repeated appends grow the buffers a doubling at a time
+ *   - Deleting faces uploads the index buffer from the first deleted face
+ *     on and keeps the vertex buffer
+ *   - Flipping a face twice restores winding and normals
+ *
+ * Uploads are counted by wrapping the viewport's RHI table.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "test_harness.h"
+
+#include "core/viewport_internal.h"
+
+#include <math.h>
+#include <mop/mop.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const MopRhiBackend *s_real;
+static MopRhiBackend s_counting;
+static size_t s_upload_bytes;
+static size_t s_upload_min_offset;
+static int s_buffer_creates;
+
+static void counting_update(MopRhiDevice *device, MopRhiBuffer *buffer,
+                            const void *data, size_t offset, size_t size) {
+  s_upload_bytes += size;
+  if (offset < s_upload_min_offset)
+    s_upload_min_offset = offset;
+  s_real->buffer_update(device, buffer, data, offset, size);
+}
+
+static MopRhiBuffer *counting_create(MopRhiDevice *device,
+                                     const MopRhiBufferDesc *desc) {
+  s_buffer_creates++;
+  return s_real->buffer_create(device, desc);
+}
+
+static void count_reset(void) {
+  s_upload_bytes = 0;
+  s_upload_min_offset = SIZE_MAX;
+  s_buffer_creates = 0;
+}
+
+static void count_uploads(MopViewport *vp) {
+  s_real = vp->rhi;
+  s_counting = *vp->rhi;
+  s_counting.buffer_update = counting_update;
+  s_counting.buffer_create = counting_create;
+  vp->rhi = &s_counting;
+  count_reset();
+}
+
+/* n x n flat grid in the XY plane facing +Z */
+static MopMesh *add_grid(MopViewport *vp, uint32_t n) {
+  uint32_t vc = (n + 1) * (n + 1), ic = n * n * 6, k = 0;
+  MopVertex *v = calloc(vc, sizeof(MopVertex));
+  uint32_t *idx = malloc(ic * sizeof(uint32_t));
+  for (uint32_t i = 0; i < vc; i++) {
+    v[i].position = (MopVec3){(float)(i % (n + 1)), (float)(i / (n + 1)), 0};
+    v[i].normal = (MopVec3){0, 0, 1};
+    v[i].color = (MopColor){1, 1, 1, 1};
+  }
+  for (uint32_t y = 0; y < n; y++) {
+    for (uint32_t x = 0; x < n; x++) {
+      uint32_t a = y * (n + 1) + x, b = a + 1;
+      uint32_t c = a + n + 1, d = c + 1;
+      uint32_t q[6] = {a, b, d, a, d, c};
+      memcpy(&idx[k], q, sizeof(q));
+      k += 6;
+    }
+  }
+  MopMesh *m = mop_viewport_add_mesh(
+      vp, &(MopMeshDesc){.vertices = v,
+                         .vertex_count = vc,
+                         .indices = idx,
+                         .index_count = ic,
+                         .object_id = 1});
+  free(v);
+  free(idx);
+  return m;
+}
+
+static const MopVertex *verts_of(MopViewport *vp, MopMesh *m) {
+  return vp->rhi->buffer_read(m->vertex_buffer);
+}
+
+static const uint32_t *indices_of(MopViewport *vp, MopMesh *m) {
+  return vp->rhi->buffer_read(m->index_buffer);
+}
+
+static MopViewport *make_viewport(void) {
+  return mop_viewport_create(&(MopViewportDesc){
+      .width = 32, .height = 32, .backend = MOP_BACKEND_CPU});
+}
+
+/* ---- tests ---- */
+
+static void test_move_uploads_one_ring(void) {
+  TEST_BEGIN("move_uploads_one_ring");
+  MopViewport *vp = make_viewport();
+  if (!vp)
+    MOP_TEST_SKIP("no CPU viewport");
+  MopMesh *m = add_grid(vp, 64);
+  TEST_ASSERT(m != NULL);
+  uint32_t vc = m->vertex_count;
+
+  /* First move builds the adjacency; measure the second */
+  uint32_t center = 32 * 65 + 32;
+  mop_mesh_move_vertices(m, vp, &center, 1, (MopVec3){0, 0, 0.5f});
+  count_uploads(vp);
+  mop_mesh_move_vertices(m, vp, &center, 1, (MopVec3){0, 0, 0.5f});
+
+  /* The center and its 6 neighbours in this triangulation, in 3 runs */
+  TEST_ASSERT(s_upload_bytes == 7 * sizeof(MopVertex));
+  TEST_ASSERT(s_buffer_creates == 0);
+  TEST_ASSERT(m->vertex_count == vc);
+
+  const MopVertex *v = verts_of(vp, m);
+  TEST_ASSERT_FLOAT_EQ(v[center].position.z, 1.0f);
+  /* The raised vertex's own normal stays +Z by symmetry... */
+  TEST_ASSERT(v[center].normal.z > 0.99f);
+  /* ...its neighbours tilt away from it, the rest stays flat */
+  TEST_ASSERT(v[center + 1].normal.x > 0.1f);
+  TEST_ASSERT(v[center - 1].normal.x < -0.1f);
+  TEST_ASSERT(v[center + 65].normal.y > 0.1f);
+  TEST_ASSERT(v[center + 2].normal.z == 1.0f);
+  TEST_ASSERT(v[0].normal.z == 1.0f);
+  TEST_ASSERT(m->topology != NULL);
+
+  mop_viewport_destroy(vp);
+  TEST_END();
+}
+
+static void test_extrude_uploads_new_geometry(void) {
+  TEST_BEGIN("extrude_uploads_new_geometry");
+  MopViewport *vp = make_viewport();
+  if (!vp)
+    MOP_TEST_SKIP("no CPU viewport");
+  MopMesh *m = add_grid(vp, 64);
+  TEST_ASSERT(m != NULL);
+  uint32_t vc = m->vertex_count, ic = m->index_count;
+  uint32_t f10[3];
+  memcpy(f10, &indices_of(vp, m)[30], sizeof(f10));
+
+  count_uploads(vp);
+  uint32_t faces[2] = {10, 11};
+  mop_mesh_extrude_faces(m, vp, faces, 2, 1.0f);
+
+  /* 6 new vertices, 12 walls, 2 caps in one run */
+  TEST_ASSERT(s_upload_bytes ==
+              6 * sizeof(MopVertex) + (12 + 2) * 3 * sizeof(uint32_t));
+  TEST_ASSERT(m->vertex_count == vc + 6);
+  TEST_ASSERT(m->index_count == ic + 36);
+
+  const MopVertex *v = verts_of(vp, m);
+  const uint32_t *idx = indices_of(vp, m);
+  TEST_ASSERT(idx[30] == vc && idx[31] == vc + 1 && idx[32] == vc + 2);
+  TEST_ASSERT_FLOAT_EQ(v[vc].position.z, 1.0f);
+  TEST_ASSERT_FLOAT_EQ(v[vc].position.x, v[f10[0]].position.x);
+  /* First wall of face 10: original edge up to the cap */
+  TEST_ASSERT(idx[ic] == f10[0] && idx[ic + 1] == f10[1] &&
+              idx[ic + 2] == vc + 1);
+
+  mop_viewport_destroy(vp);
+  TEST_END();
+}
+
+static void test_appends_amortized(void) {
+  TEST_BEGIN("appends_amortized");
+  MopViewport *vp = make_viewport();
+  if (!vp)
+    MOP_TEST_SKIP("no CPU viewport");
+  MopMesh *m = add_grid(vp, 16);
+  TEST_ASSERT(m != NULL);
+  uint32_t ic = m->index_count;
+
+  count_uploads(vp);
+  size_t largest = 0;
+  for (uint32_t i = 0; i < 64; i++) {
+    size_t before = s_upload_bytes;
+    /* Split the diagonal of a different quad each time */
+    uint32_t a = (i / 16) * 17 + i % 16;
+    mop_mesh_split_edge(m, vp, a, a + 18);
+    if (s_upload_bytes - before > largest)
+      largest = s_upload_bytes - before;
+  }
+  /* 64 splits of 2 faces each: a handful of doublings, not one per op */
+  TEST_ASSERT(m->index_count == ic + 64 * 6);
+  TEST_ASSERT(s_buffer_creates <= 4);
+  TEST_ASSERT(largest < 16 * 16 * 6 * sizeof(uint32_t));
+
+  mop_viewport_destroy(vp);
+  TEST_END();
+}
+
+static void test_delete_faces_uploads_tail(void) {
+  TEST_BEGIN("delete_faces_uploads_tail");
+  MopViewport *vp = make_viewport();
+  if (!vp)
+    MOP_TEST_SKIP("no CPU viewport");
+  MopMesh *m = add_grid(vp, 32);
+  TEST_ASSERT(m != NULL);
+  uint32_t vc = m->vertex_count, ic = m->index_count;
+
+  count_uploads(vp);
+  uint32_t faces[2] = {ic / 3 - 10, ic / 3 - 3};
+  mop_mesh_delete_faces(m, vp, faces, 2);
+
+  TEST_ASSERT(m->index_count == ic - 6);
+  TEST_ASSERT(m->vertex_count == vc);
+  TEST_ASSERT(s_upload_min_offset == (size_t)(ic / 3 - 10) * 3 * 4);
+  TEST_ASSERT(s_upload_bytes == (size_t)(10 - 2) * 3 * 4);
+  TEST_ASSERT(m->topology != NULL);
+
+  mop_viewport_destroy(vp);
+  TEST_END();
+}
+
+static void test_flip_twice_restores(void) {
+  TEST_BEGIN("flip_twice_restores");
+  MopViewport *vp = make_viewport();
+  if (!vp)
+    MOP_TEST_SKIP("no CPU viewport");
+  MopMesh *m = add_grid(vp, 8);
+  TEST_ASSERT(m != NULL);
+  uint32_t ic = m->index_count;
+  uint32_t *before = malloc(ic * sizeof(uint32_t));
+  memcpy(before, indices_of(vp, m), ic * sizeof(uint32_t));
+
+  uint32_t faces[1] = {7};
+  mop_mesh_flip_normals(m, vp, faces, 1);
+  const uint32_t *idx = indices_of(vp, m);
+  TEST_ASSERT(idx[21] == before[21] && idx[22] == before[23] &&
+              idx[23] == before[22]);
+  TEST_ASSERT(verts_of(vp, m)[before[21]].normal.z == -1.0f);
+
+  mop_mesh_flip_normals(m, vp, faces, 1);
+  TEST_ASSERT(memcmp(indices_of(vp, m), before, ic * sizeof(uint32_t)) == 0);
+  TEST_ASSERT(verts_of(vp, m)[before[21]].normal.z == 1.0f);
+
+  /* Listed twice in one call: no change at all */
+  count_uploads(vp);
+  uint32_t twice[2] = {7, 7};
+  mop_mesh_flip_normals(m, vp, twice, 2);
+  TEST_ASSERT(s_upload_bytes == 0);
+
+  free(before);
+  mop_viewport_destroy(vp);
+  TEST_END();
+}
+
+int main(void) {
+  TEST_SUITE_BEGIN("mesh_edit");
+
+  TEST_RUN(test_move_uploads_one_ring);
+  TEST_RUN(test_extrude_uploads_new_geometry);
+  TEST_RUN(test_appends_amortized);
+  TEST_RUN(test_delete_faces_uploads_tail);
+  TEST_RUN(test_flip_twice_restores);
+
+  TEST_REPORT();
+  TEST_EXIT();
+}
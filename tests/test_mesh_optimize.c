@@ -0,0 +1,294 @@
+/*
+ * Master of Puppets — Mesh optimization tests
+ * test_mesh_optimize.c — Vertex cache, overdraw and vertex fetch reorder
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "test_harness.h"
+
+#include "core/viewport_internal.h"
+
+#include <math.h>
+#include <mop/mop.h>
+#include <stdlib.h>
+
+/* Appends a UV sphere of the given radius (outward winding) to v/idx */
+static void append_sphere(float radius, int rings, int segs, MopVertex *v,
+                          uint32_t *vcount, uint32_t *idx, uint32_t *icount) {
+  uint32_t base = *vcount;
+  for (int r = 0; r <= rings; r++) {
+    float phi = 3.14159265f * (float)r / (float)rings;
+    for (int s = 0; s <= segs; s++) {
+      float th = 2.0f * 3.14159265f * (float)s / (float)segs;
+      MopVec3 n = {sinf(phi) * cosf(th), cosf(phi), sinf(phi) * sinf(th)};
+      MopVertex *vx = &v[(*vcount)++];
+      vx->position = mop_vec3_scale(n, radius);
+      vx->normal = n;
+      vx->color = (MopColor){1, 1, 1, 1};
+    }
+  }
+  for (int r = 0; r < rings; r++)
+    for (int s = 0; s < segs; s++) {
+      uint32_t a = base + (uint32_t)(r * (segs + 1) + s);
+      uint32_t b = a + (uint32_t)segs + 1;
+      idx[(*icount)++] = a, idx[(*icount)++] = a + 1, idx[(*icount)++] = b;
+      idx[(*icount)++] = a + 1, idx[(*icount)++] = b + 1, idx[(*icount)++] = b;
+    }
+}
+
+/* Deterministic triangle shuffle (xorshift) */
+static void shuffle_tris(uint32_t *idx, uint32_t icount) {
+  uint32_t state = 0x9E3779B9u;
+  for (uint32_t t = icount / 3; t > 1; t--) {
+    state ^= state << 13, state ^= state >> 17, state ^= state << 5;
+    uint32_t j = state % t;
+    for (int k = 0; k < 3; k++) {
+      uint32_t tmp = idx[(t - 1) * 3 + (uint32_t)k];
+      idx[(t - 1) * 3 + (uint32_t)k] = idx[j * 3 + (uint32_t)k];
+      idx[j * 3 + (uint32_t)k] = tmp;
+    }
+  }
+}
+
+/* Canonical key of a triangle: rotate so the smallest index leads,
+ * which keeps winding in the key */
+static uint64_t tri_key(const uint32_t *t) {
+  int m = 0;
+  for (int k = 1; k < 3; k++)
+    if (t[k] < t[m])
+      m = k;
+  return ((uint64_t)t[m] << 42) | ((uint64_t)t[(m + 1) % 3] << 21) |
+         (uint64_t)t[(m + 2) % 3];
+}
+
+static int cmp_u64(const void *a, const void *b) {
+  uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+  return x < y ? -1 : (x > y);
+}
+
+/* Same set of triangles with the same winding, in any order */
+static bool same_triangles(const uint32_t *a, const uint32_t *b,
+                           uint32_t icount) {
+  uint32_t n = icount / 3;
+  uint64_t *ka = malloc(n * sizeof(uint64_t));
+  uint64_t *kb = malloc(n * sizeof(uint64_t));
+  for (uint32_t t = 0; t < n; t++) {
+    ka[t] = tri_key(a + t * 3);
+    kb[t] = tri_key(b + t * 3);
+  }
+  qsort(ka, n, sizeof(uint64_t), cmp_u64);
+  qsort(kb, n, sizeof(uint64_t), cmp_u64);
+  bool same = memcmp(ka, kb, n * sizeof(uint64_t)) == 0;
+  free(ka);
+  free(kb);
+  return same;
+}
+
+static void test_vertex_cache(void) {
+  TEST_BEGIN("mesh_opt: Tipsify restores cache reuse on shuffled triangles");
+  MopVertex *v = calloc(33 * 65, sizeof(MopVertex));
+  uint32_t *idx = malloc(32 * 64 * 6 * sizeof(uint32_t));
+  uint32_t vc = 0, ic = 0;
+  append_sphere(1.0f, 32, 64, v, &vc, idx, &ic);
+  shuffle_tris(idx, ic);
+
+  MopMeshStats before, after;
+  TEST_ASSERT(mop_mesh_analyze(v, vc, NULL, idx, ic, &before));
+  TEST_ASSERT(before.acmr > 2.0f);
+
+  uint32_t *opt = malloc(ic * sizeof(uint32_t));
+  mop_optimize_vertex_cache(opt, idx, ic, vc);
+  TEST_ASSERT(same_triangles(idx, opt, ic));
+  TEST_ASSERT(mop_mesh_analyze(v, vc, NULL, opt, ic, &after));
+  TEST_ASSERT(after.acmr < 0.8f);
+  TEST_ASSERT(after.atvr < before.atvr);
+
+  /* In place gives the same order */
+  mop_optimize_vertex_cache(idx, idx, ic, vc);
+  TEST_ASSERT(memcmp(idx, opt, ic * sizeof(uint32_t)) == 0);
+
+  free(opt);
+  free(idx);
+  free(v);
+  TEST_END();
+}
+
+static void test_overdraw(void) {
+  TEST_BEGIN("mesh_opt: outer shell is drawn before the hidden inner one");
+  MopVertex *v = calloc(2 * 17 * 33, sizeof(MopVertex));
+  uint32_t *idx = malloc(2 * 16 * 32 * 6 * sizeof(uint32_t));
+  uint32_t vc = 0, ic = 0;
+  append_sphere(0.9f, 16, 32, v, &vc, idx, &ic); /* hidden, drawn first */
+  append_sphere(1.0f, 16, 32, v, &vc, idx, &ic);
+  uint32_t *orig = malloc(ic * sizeof(uint32_t));
+  memcpy(orig, idx, ic * sizeof(uint32_t));
+
+  MopMeshStats before, after;
+  TEST_ASSERT(mop_mesh_analyze(v, vc, NULL, idx, ic, &before));
+  TEST_ASSERT(before.overdraw > 1.5f);
+
+  mop_optimize_vertex_cache(idx, idx, ic, vc);
+  float cache_acmr;
+  TEST_ASSERT(mop_mesh_analyze(v, vc, NULL, idx, ic, &after));
+  cache_acmr = after.acmr;
+  mop_optimize_overdraw(idx, idx, ic, &v[0].position.x, vc, sizeof(MopVertex),
+                        1.05f);
+  TEST_ASSERT(same_triangles(orig, idx, ic));
+  TEST_ASSERT(mop_mesh_analyze(v, vc, NULL, idx, ic, &after));
+  TEST_ASSERT(after.overdraw < before.overdraw * 0.75f);
+  TEST_ASSERT(after.acmr < cache_acmr * 1.25f);
+
+  free(orig);
+  free(idx);
+  free(v);
+  TEST_END();
+}
+
+static void test_vertex_fetch(void) {
+  TEST_BEGIN("mesh_opt: fetch order numbers vertices by first use");
+  /* Quad referencing vertices 5, 3, 1, 0 of a 6-vertex array */
+  float pos[6][3] = {{0, 1, 0}, {1, 1, 0}, {9, 9, 9},
+                     {1, 0, 0}, {9, 9, 9}, {0, 0, 0}};
+  uint32_t idx[6] = {5, 3, 1, 5, 1, 0};
+  float out[6][3];
+  uint32_t n = mop_optimize_vertex_fetch(out, idx, 6, pos, 6, sizeof(pos[0]));
+  TEST_ASSERT(n == 4);
+  static const uint32_t expect[6] = {0, 1, 2, 0, 2, 3};
+  TEST_ASSERT(memcmp(idx, expect, sizeof(expect)) == 0);
+  TEST_ASSERT(out[0][0] == 0 && out[0][1] == 0); /* old vertex 5 */
+  TEST_ASSERT(out[3][0] == 0 && out[3][1] == 1); /* old vertex 0 */
+  TEST_END();
+}
+
+static void test_out_of_range_rejected(void) {
+  TEST_BEGIN("mesh_opt: indices past vertex_count leave the order unchanged");
+  float pos[4][3] = {{0, 0, 0}, {1, 0, 0}, {1, 1, 0}, {0, 1, 0}};
+  static const uint32_t bad[6] = {0, 1, 2, 0, 2, 7};
+  uint32_t out[6];
+  mop_optimize_vertex_cache(out, bad, 6, 4);
+  TEST_ASSERT(memcmp(out, bad, sizeof(bad)) == 0);
+  mop_optimize_overdraw(out, bad, 6, &pos[0][0], 4, sizeof(pos[0]), 1.05f);
+  TEST_ASSERT(memcmp(out, bad, sizeof(bad)) == 0);
+  float fetched[4][3];
+  memcpy(out, bad, sizeof(bad));
+  TEST_ASSERT(mop_optimize_vertex_fetch(fetched, out, 6, pos, 4,
+                                        sizeof(pos[0])) == 0);
+  TEST_ASSERT(memcmp(out, bad, sizeof(bad)) == 0);
+  TEST_END();
+}
+
+static void test_mesh_optimize_flex(void) {
+  TEST_BEGIN("mesh_opt: whole-mesh pass on a flexible vertex format");
+  /* pos + normal, 24-byte stride; shuffled sphere plus a stray vertex */
+  MopVertex *v = calloc(17 * 33 + 1, sizeof(MopVertex));
+  uint32_t *idx = malloc(16 * 32 * 6 * sizeof(uint32_t));
+  uint32_t vc = 0, ic = 0;
+  append_sphere(1.0f, 16, 32, v, &vc, idx, &ic);
+  shuffle_tris(idx, ic);
+  vc++; /* unreferenced */
+
+  MopVertexFormat fmt = mop_vertex_format_pos_normal();
+  float *raw = malloc(vc * 6 * sizeof(float));
+  for (uint32_t i = 0; i < vc; i++) {
+    memcpy(raw + i * 6, &v[i].position, 12);
+    memcpy(raw + i * 6 + 3, &v[i].normal, 12);
+  }
+
+  MopMeshOptStats st;
+  uint32_t n =
+      mop_mesh_optimize(raw, vc, &fmt, idx, ic, MOP_MESH_OPT_ALL, &st);
+  TEST_ASSERT(n == vc - 1);
+  TEST_ASSERT(st.vertices_removed == 1);
+  TEST_ASSERT(st.after.acmr < st.before.acmr);
+  TEST_ASSERT(st.after.overfetch <= st.before.overfetch);
+  for (uint32_t i = 0; i < ic; i++)
+    TEST_ASSERT(idx[i] < n);
+
+  /* Out-of-range indices are rejected untouched */
+  uint32_t bad[3] = {0, 1, 99999};
+  TEST_ASSERT(mop_mesh_optimize(raw, n, &fmt, bad, 3, MOP_MESH_OPT_ALL,
+                                NULL) == 0);
+  TEST_ASSERT(bad[2] == 99999);
+
+  free(raw);
+  free(idx);
+  free(v);
+  TEST_END();
+}
+
+static void test_add_mesh_optimize(void) {
+  TEST_BEGIN("mesh_opt: add_mesh opt-in reorders and keeps the image");
+  MopVertex *v = calloc(17 * 33, sizeof(MopVertex));
+  uint32_t *idx = malloc(16 * 32 * 6 * sizeof(uint32_t));
+  uint32_t vc = 0, ic = 0;
+  append_sphere(1.0f, 16, 32, v, &vc, idx, &ic);
+  shuffle_tris(idx, ic);
+
+  const uint8_t *img[2];
+  uint8_t *copy = NULL;
+  int w = 0, h = 0;
+  MopViewport *vps[2];
+  for (int pass = 0; pass < 2; pass++) {
+    MopViewportDesc desc = {.width = 64,
+                            .height = 64,
+                            .backend = MOP_BACKEND_CPU,
+                            .ssaa_factor = 1};
+    vps[pass] = mop_viewport_create(&desc);
+    TEST_ASSERT(vps[pass] != NULL);
+    mop_viewport_set_camera(vps[pass], (MopVec3){0, 0, 3}, (MopVec3){0, 0, 0},
+                            (MopVec3){0, 1, 0}, 60.0f, 0.1f, 100.0f);
+    MopMesh *mesh = mop_viewport_add_mesh(
+        vps[pass],
+        &(MopMeshDesc){.vertices = v,
+                       .vertex_count = vc,
+                       .indices = idx,
+                       .index_count = ic,
+                       .object_id = 1,
+                       .optimize = pass ? MOP_MESH_OPT_ALL : 0});
+    TEST_ASSERT(mesh != NULL);
+    MopMeshOptStats st;
+    TEST_ASSERT(mop_mesh_get_optimize_stats(mesh, &st) == (pass == 1));
+    if (pass == 1) {
+      TEST_ASSERT(st.after.acmr < st.before.acmr);
+      TEST_ASSERT(mesh->index_count == ic);
+    }
+    TEST_ASSERT(mop_viewport_render(vps[pass]) == MOP_RENDER_OK);
+    img[pass] = mop_viewport_read_color(vps[pass], &w, &h);
+    if (pass == 0) {
+      copy = malloc((size_t)w * h * 4);
+      memcpy(copy, img[0], (size_t)w * h * 4);
+    }
+  }
+
+  /* Triangle order only affects depth ties along shared edges */
+  int differ = 0;
+  for (int i = 0; i < w * h; i++)
+    for (int c = 0; c < 3; c++)
+      if (abs((int)copy[i * 4 + c] - (int)img[1][i * 4 + c]) > 8) {
+        differ++;
+        break;
+      }
+  TEST_ASSERT(differ < w * h / 100);
+
+  free(copy);
+  mop_viewport_destroy(vps[0]);
+  mop_viewport_destroy(vps[1]);
+  free(idx);
+  free(v);
+  TEST_END();
+}
+
+int main(void) {
+  TEST_SUITE_BEGIN("mesh_optimize");
+
+  TEST_RUN(test_vertex_cache);
+  TEST_RUN(test_overdraw);
+  TEST_RUN(test_vertex_fetch);
+  TEST_RUN(test_out_of_range_rejected);
+  TEST_RUN(test_mesh_optimize_flex);
+  TEST_RUN(test_add_mesh_optimize);
+
+  TEST_REPORT();
+  TEST_EXIT();
+}
@@ -0,0 +1,356 @@
+/*
+ * Master of Puppets — Mesh topology tests
+ * test_mesh_topology.c — Hashed half-edge twins and incremental updates
+ *
+ * Tests validate:
+ *   - Twins built through the hash match a brute-force pair scan, inline
+ *     and on a thread pool, with and without non-manifold duplicates
+ *   - Rewriting, appending and removing faces keeps the adjacency equal
+ *     to what a rebuild of the same index buffer describes
+ *   - Mesh edit operations keep one topology on the mesh across edits
+ *     and leave it consistent with the uploaded index buffer
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "test_harness.h"
+
+#include "core/mesh_topology.h"
+#include "core/thread_pool.h"
+#include "core/viewport_internal.h"
+
+#include <mop/mop.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* n x n quads, two triangles each, over (n + 1)^2 vertices */
+static uint32_t *grid_indices(uint32_t n, uint32_t *count) {
+  uint32_t *idx = malloc((size_t)n * n * 6 * sizeof(uint32_t));
+  uint32_t k = 0;
+  for (uint32_t y = 0; y < n; y++) {
+    for (uint32_t x = 0; x < n; x++) {
+      uint32_t a = y * (n + 1) + x, b = a + 1;
+      uint32_t c = a + n + 1, d = c + 1;
+      uint32_t q[6] = {a, b, d, a, d, c};
+      memcpy(&idx[k], q, sizeof(q));
+      k += 6;
+    }
+  }
+  *count = k;
+  return idx;
+}
+
+/* Brute-force twin: the first half-edge (face order) running dst -> src,
+ * for half-edges that are themselves the first with their key */
+static uint32_t ref_twin(const uint32_t *idx, uint32_t ic, uint32_t h) {
+  uint32_t s = idx[h], d = idx[h - h % 3 + (h % 3 + 1) % 3];
+  if (s == d)
+    return MOP_INVALID_HE;
+  for (uint32_t j = 0; j < h; j++) {
+    if (idx[j] == s && idx[j - j % 3 + (j % 3 + 1) % 3] == d)
+      return MOP_INVALID_HE;
+  }
+  for (uint32_t j = 0; j < ic; j++) {
+    if (idx[j] == d && idx[j - j % 3 + (j % 3 + 1) % 3] == s)
+      return j;
+  }
+  return MOP_INVALID_HE;
+}
+
+/* Topology invariants against an index buffer: every half-edge matches
+ * its triangle, sits in the chain of its key, and is twinned exactly
+ * when it heads that chain and the reverse key exists */
+static bool consistent(const MopMeshTopology *t, const uint32_t *idx,
+                       uint32_t ic) {
+  if (t->face_count * 3 != ic)
+    return false;
+  for (uint32_t h = 0; h < ic; h++) {
+    const MopHalfEdge *he = &t->edges[h];
+    uint32_t n = h - h % 3 + (h % 3 + 1) % 3;
+    if (he->face != h / 3 || he->next != n || he->vertex != idx[n])
+      return false;
+    uint32_t s = mop_topology_src(t, h);
+    if (s != idx[h])
+      return false;
+    if (s == he->vertex) {
+      if (he->twin != MOP_INVALID_HE)
+        return false;
+      continue;
+    }
+
+    uint32_t head = mop_topology_find(t, s, he->vertex);
+    bool found = false;
+    for (uint32_t x = head; x != MOP_INVALID_HE; x = t->same[x])
+      found |= x == h;
+    if (!found)
+      return false;
+
+    uint32_t rev = mop_topology_find(t, he->vertex, s);
+    uint32_t want = head == h ? rev : MOP_INVALID_HE;
+    if (he->twin != want)
+      return false;
+    if (want != MOP_INVALID_HE && t->edges[want].twin != h)
+      return false;
+  }
+  return true;
+}
+
+/* ---- build ---- */
+
+static void test_build_matches_reference(void) {
+  TEST_BEGIN("build_matches_reference");
+  uint32_t ic;
+  uint32_t *idx = grid_indices(12, &ic);
+  MopMeshTopology *t = mop_topology_build(idx, ic, NULL);
+  TEST_ASSERT(t != NULL);
+  TEST_ASSERT(t->face_count * 3 == ic);
+
+  bool match = true;
+  uint32_t interior = 0;
+  for (uint32_t h = 0; h < ic; h++) {
+    match &= t->edges[h].twin == ref_twin(idx, ic, h);
+    interior += t->edges[h].twin != MOP_INVALID_HE;
+  }
+  TEST_ASSERT(match);
+  /* 12 x 12 quads: 3 * 12 * 11 shared edges of two half-edges each, plus
+   * one diagonal per quad */
+  TEST_ASSERT(interior == 2 * (2 * 12 * 11 + 12 * 12));
+  TEST_ASSERT(consistent(t, idx, ic));
+
+  /* Boundary corner edge has no twin */
+  uint32_t h = mop_topology_find(t, 0, 1);
+  TEST_ASSERT(h == 0);
+  TEST_ASSERT(t->edges[h].twin == MOP_INVALID_HE);
+  TEST_ASSERT(mop_topology_find(t, 0, 100) == MOP_INVALID_HE);
+
+  mop_topology_free(t);
+  free(idx);
+  TEST_END();
+}
+
+static void test_build_parallel_nonmanifold(void) {
+  TEST_BEGIN("build_parallel_nonmanifold");
+  uint32_t ic;
+  uint32_t *grid = grid_indices(48, &ic);
+  /* Repeat the first quad and add a degenerate sliver: a duplicated key
+   * chains behind the original, a repeated vertex is never linked */
+  uint32_t extra[9] = {grid[0], grid[1], grid[2], grid[3],
+                       grid[4], grid[5], 7,       7,       8};
+  uint32_t *idx = malloc((ic + 9) * sizeof(uint32_t));
+  memcpy(idx, grid, ic * sizeof(uint32_t));
+  memcpy(&idx[ic], extra, sizeof(extra));
+  ic += 9;
+
+  MopThreadPool *pool = mop_threadpool_create(4);
+  MopMeshTopology *a = mop_topology_build(idx, ic, pool);
+  MopMeshTopology *b = mop_topology_build(idx, ic, NULL);
+  TEST_ASSERT(a != NULL && b != NULL);
+
+  bool same = true;
+  for (uint32_t h = 0; h < ic; h++)
+    same &= a->edges[h].twin == b->edges[h].twin;
+  TEST_ASSERT(same);
+  TEST_ASSERT(consistent(a, idx, ic));
+
+  /* Spot-check the reference on the first and last rows */
+  bool match = true;
+  for (uint32_t h = 0; h < 600; h++)
+    match &= a->edges[h].twin == ref_twin(idx, ic, h);
+  for (uint32_t h = ic - 600; h < ic; h++)
+    match &= a->edges[h].twin == ref_twin(idx, ic, h);
+  TEST_ASSERT(match);
+
+  /* The duplicate of half-edge 0 follows it in the chain */
+  uint32_t dup = ic - 9;
+  TEST_ASSERT(a->same[0] == dup);
+  TEST_ASSERT(a->edges[dup].twin == MOP_INVALID_HE);
+
+  mop_topology_free(a);
+  mop_topology_free(b);
+  mop_threadpool_destroy(pool);
+  free(idx);
+  free(grid);
+  TEST_END();
+}
+
+/* ---- incremental ---- */
+
+static void test_incremental_updates(void) {
+  TEST_BEGIN("incremental_updates");
+  uint32_t ic;
+  uint32_t *grid = grid_indices(10, &ic);
+  uint32_t cap = ic * 4;
+  uint32_t *idx = malloc(cap * sizeof(uint32_t));
+  memcpy(idx, grid, ic * sizeof(uint32_t));
+  MopMeshTopology *t = mop_topology_build(idx, ic, NULL);
+  TEST_ASSERT(t != NULL);
+
+  uint32_t rng = 12345;
+  bool ok = true;
+  for (int step = 0; step < 200 && ok; step++) {
+    rng = rng * 1664525u + 1013904223u;
+    uint32_t faces = ic / 3;
+    uint32_t f = (rng >> 8) % faces;
+    switch (step % 4) {
+    case 0: { /* flip winding in place */
+      uint32_t tri[3] = {idx[f * 3], idx[f * 3 + 2], idx[f * 3 + 1]};
+      memcpy(&idx[f * 3], tri, sizeof(tri));
+      ok &= mop_topology_set_faces(t, f, tri, 1);
+      break;
+    }
+    case 1: { /* append a fan sharing an existing edge */
+      if (ic + 6 > cap)
+        break;
+      uint32_t v = 121 + (uint32_t)step;
+      uint32_t tris[6] = {idx[f * 3 + 1], idx[f * 3], v,
+                          idx[f * 3 + 2], idx[f * 3 + 1], v};
+      memcpy(&idx[ic], tris, sizeof(tris));
+      ok &= mop_topology_set_faces(t, faces, tris, 2);
+      ic += 6;
+      break;
+    }
+    case 2: { /* remove every 7th face from f */
+      bool *del = calloc(faces, sizeof(bool));
+      uint32_t w = 0;
+      for (uint32_t i = 0; i < faces; i++) {
+        del[i] = faces > 20 && i >= f && (i - f) % 7 == 0;
+        if (!del[i]) {
+          memmove(&idx[w * 3], &idx[i * 3], 3 * sizeof(uint32_t));
+          w++;
+        }
+      }
+      ok &= mop_topology_remove_faces(t, del);
+      ic = w * 3;
+      free(del);
+      break;
+    }
+    default: { /* rewrite a run of faces with a shifted vertex */
+      uint32_t n = faces - f < 3 ? faces - f : 3;
+      for (uint32_t i = f * 3; i < (f + n) * 3; i++)
+        idx[i] = (idx[i] + 1) % 121;
+      ok &= mop_topology_set_faces(t, f, &idx[f * 3], n);
+      break;
+    }
+    }
+    ok &= consistent(t, idx, ic);
+  }
+  TEST_ASSERT(ok);
+
+  /* Same adjacency as a rebuild, up to chain order */
+  MopMeshTopology *fresh = mop_topology_build(idx, ic, NULL);
+  uint32_t twins_a = 0, twins_b = 0;
+  for (uint32_t h = 0; h < ic; h++) {
+    twins_a += t->edges[h].twin != MOP_INVALID_HE;
+    twins_b += fresh->edges[h].twin != MOP_INVALID_HE;
+  }
+  TEST_ASSERT(twins_a == twins_b);
+
+  mop_topology_free(fresh);
+  mop_topology_free(t);
+  free(idx);
+  free(grid);
+  TEST_END();
+}
+
+/* ---- mesh edits ---- */
+
+static MopMesh *add_grid(MopViewport *vp, uint32_t n) {
+  uint32_t vc = (n + 1) * (n + 1), ic;
+  MopVertex *v = calloc(vc, sizeof(MopVertex));
+  for (uint32_t i = 0; i < vc; i++) {
+    v[i].position = (MopVec3){(float)(i % (n + 1)), (float)(i / (n + 1)), 0};
+    v[i].normal = (MopVec3){0, 0, 1};
+    v[i].color = (MopColor){1, 1, 1, 1};
+  }
+  uint32_t *idx = grid_indices(n, &ic);
+  MopMesh *m = mop_viewport_add_mesh(
+      vp, &(MopMeshDesc){.vertices = v,
+                         .vertex_count = vc,
+                         .indices = idx,
+                         .index_count = ic,
+                         .object_id = 1});
+  free(v);
+  free(idx);
+  return m;
+}
+
+static bool mesh_consistent(MopViewport *vp, MopMesh *m) {
+  const uint32_t *idx = vp->rhi->buffer_read(m->index_buffer);
+  return m->topology && idx && consistent(m->topology, idx, m->index_count);
+}
+
+static void test_mesh_edits_keep_topology(void) {
+  TEST_BEGIN("mesh_edits_keep_topology");
+  MopViewport *vp = mop_viewport_create(&(MopViewportDesc){
+      .width = 32, .height = 32, .backend = MOP_BACKEND_CPU});
+  if (!vp)
+    MOP_TEST_SKIP("no CPU viewport");
+  MopMesh *m = add_grid(vp, 8);
+  TEST_ASSERT(m != NULL);
+  TEST_ASSERT(m->topology == NULL);
+
+  uint32_t faces[2] = {5, 40};
+  mop_mesh_extrude_faces(m, vp, faces, 2, 0.5f);
+  TEST_ASSERT(mesh_consistent(vp, m));
+  MopMeshTopology *kept = m->topology;
+  TEST_ASSERT(m->index_count == (128 + 12) * 3);
+
+  /* Split the diagonal of quad 0: both triangles are rewritten in place
+   * and their second halves appended, so no other face moves */
+  mop_mesh_split_edge(m, vp, 0, 10);
+  TEST_ASSERT(m->topology == kept);
+  TEST_ASSERT(mesh_consistent(vp, m));
+  TEST_ASSERT(m->index_count == (140 + 2) * 3);
+  const uint32_t *idx = vp->rhi->buffer_read(m->index_buffer);
+  uint32_t mid = 81 + 6; /* after the extruded copies */
+  TEST_ASSERT(idx[0] == 10 && idx[1] == mid && idx[2] == 1);
+  TEST_ASSERT(idx[3] == 0 && idx[4] == mid && idx[5] == 9);
+  TEST_ASSERT(idx[6] == 1 && idx[7] == 2 && idx[8] == 11);
+  TEST_ASSERT(mop_topology_find(m->topology, 0, 10) == MOP_INVALID_HE);
+  TEST_ASSERT(mop_topology_find(m->topology, mid, 10) != MOP_INVALID_HE);
+
+  uint32_t inset[1] = {60};
+  mop_mesh_inset_faces(m, vp, inset, 1, 0.25f);
+  TEST_ASSERT(m->topology == kept);
+  TEST_ASSERT(mesh_consistent(vp, m));
+
+  uint32_t flip[2] = {3, 70};
+  mop_mesh_flip_normals(m, vp, flip, 2);
+  TEST_ASSERT(m->topology == kept);
+  TEST_ASSERT(mesh_consistent(vp, m));
+
+  uint32_t moved[1] = {4};
+  mop_mesh_move_vertices(m, vp, moved, 1, (MopVec3){0, 0, 1});
+  TEST_ASSERT(m->topology == kept);
+
+  uint32_t ic = m->index_count;
+  mop_mesh_dissolve_edge(m, vp, 20, 21);
+  TEST_ASSERT(m->index_count == ic - 6);
+  TEST_ASSERT(mesh_consistent(vp, m));
+
+  uint32_t del[1] = {30};
+  mop_mesh_delete_faces(m, vp, del, 1);
+  TEST_ASSERT(m->topology == kept);
+  TEST_ASSERT(mesh_consistent(vp, m));
+
+  /* Renumbering vertices drops it; the next edit rebuilds */
+  mop_mesh_merge_vertices(m, vp, 0, 1);
+  TEST_ASSERT(m->topology == NULL);
+  mop_mesh_flip_normals(m, vp, flip, 1);
+  TEST_ASSERT(mesh_consistent(vp, m));
+
+  mop_viewport_destroy(vp);
+  TEST_END();
+}
+
+int main(void) {
+  TEST_SUITE_BEGIN("mesh_topology");
+
+  TEST_RUN(test_build_matches_reference);
+  TEST_RUN(test_build_parallel_nonmanifold);
+  TEST_RUN(test_incremental_updates);
+  TEST_RUN(test_mesh_edits_keep_topology);
+
+  TEST_REPORT();
+  TEST_EXIT();
+}
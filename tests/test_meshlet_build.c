@@ -0,0 +1,234 @@
+/*
+ * Master of Puppets — Meshlet builder tests
+ * test_meshlet_build.c — Morton-partitioned, parallel meshlet construction
+ *
+ * Tests validate:
+ *   - Every input triangle lands in exactly one meshlet, winding intact,
+ *     across several spatial partitions
+ *   - Bounding spheres contain their vertices, cones their face normals
+ *   - Output is identical with and without a worker pool
+ *   - Clusters stay compact on a UV sphere (no ring-strip meshlets)
+ *   - Out-of-range indices are rejected
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "test_harness.h"
+
+#include <math.h>
+#include <mop/mop.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct Sphere {
+  MopVertex *v;
+  uint32_t *idx;
+  uint32_t vc, ic;
+} Sphere;
+
+/* Unit UV sphere with outward (counter-clockwise) winding */
+static Sphere make_sphere(int rings, int segs) {
+  Sphere s;
+  s.vc = (uint32_t)((rings + 1) * (segs + 1));
+  s.ic = (uint32_t)(rings * segs * 6);
+  s.v = calloc(s.vc, sizeof(MopVertex));
+  s.idx = malloc(s.ic * sizeof(uint32_t));
+  for (int r = 0; r <= rings; r++) {
+    float th = 3.14159265f * (float)r / (float)rings;
+    for (int k = 0; k <= segs; k++) {
+      float ph = 2.0f * 3.14159265f * (float)k / (float)segs;
+      MopVec3 n = {sinf(th) * cosf(ph), cosf(th), sinf(th) * sinf(ph)};
+      s.v[r * (segs + 1) + k].position = n;
+      s.v[r * (segs + 1) + k].normal = n;
+    }
+  }
+  uint32_t i = 0;
+  for (int r = 0; r < rings; r++)
+    for (int k = 0; k < segs; k++) {
+      uint32_t a = (uint32_t)(r * (segs + 1) + k), b = a + 1;
+      uint32_t c = a + (uint32_t)(segs + 1), d = c + 1;
+      s.idx[i++] = a, s.idx[i++] = b, s.idx[i++] = d;
+      s.idx[i++] = a, s.idx[i++] = d, s.idx[i++] = c;
+    }
+  return s;
+}
+
+static void free_sphere(Sphere *s) {
+  free(s->v);
+  free(s->idx);
+}
+
+/* Rotate so the smallest index leads (keeps winding), then pack */
+static uint64_t tri_key(uint32_t a, uint32_t b, uint32_t c) {
+  while (a > b || a > c) {
+    uint32_t t = a;
+    a = b, b = c, c = t;
+  }
+  return ((uint64_t)a << 42) | ((uint64_t)b << 21) | c;
+}
+
+static int cmp_u64(const void *x, const void *y) {
+  uint64_t a = *(const uint64_t *)x, b = *(const uint64_t *)y;
+  return (a > b) - (a < b);
+}
+
+static void test_covers_every_triangle(void) {
+  TEST_BEGIN("meshlet_build: each triangle emitted exactly once");
+  /* 102400 triangles: well over one partition */
+  Sphere s = make_sphere(160, 320);
+  MopMeshletData m;
+  TEST_ASSERT(mop_meshlet_build(s.v, s.vc, s.idx, s.ic, &m));
+
+  uint32_t tc = s.ic / 3;
+  TEST_ASSERT(m.prim_index_count == s.ic);
+  uint64_t *want = malloc(tc * sizeof(uint64_t));
+  uint64_t *got = malloc(tc * sizeof(uint64_t));
+  for (uint32_t t = 0; t < tc; t++)
+    want[t] = tri_key(s.idx[t * 3], s.idx[t * 3 + 1], s.idx[t * 3 + 2]);
+
+  uint32_t n = 0;
+  bool limits = true;
+  for (uint32_t i = 0; i < m.meshlet_count; i++) {
+    const MopMeshlet *ml = &m.meshlets[i];
+    limits &= ml->vertex_count <= MOP_MESHLET_MAX_VERTICES &&
+              ml->triangle_count <= MOP_MESHLET_MAX_TRIANGLES &&
+              ml->triangle_count > 0;
+    const uint32_t *vi = m.vertex_indices + ml->vertex_offset;
+    const uint8_t *pi = m.prim_indices + ml->triangle_offset;
+    for (uint32_t t = 0; t < ml->triangle_count && n < tc; t++) {
+      limits &= pi[t * 3] < ml->vertex_count &&
+                pi[t * 3 + 1] < ml->vertex_count &&
+                pi[t * 3 + 2] < ml->vertex_count;
+      got[n++] = tri_key(vi[pi[t * 3]], vi[pi[t * 3 + 1]], vi[pi[t * 3 + 2]]);
+    }
+  }
+  TEST_ASSERT(limits);
+  TEST_ASSERT(n == tc);
+  qsort(want, tc, sizeof(uint64_t), cmp_u64);
+  qsort(got, tc, sizeof(uint64_t), cmp_u64);
+  TEST_ASSERT(memcmp(want, got, tc * sizeof(uint64_t)) == 0);
+
+  free(want);
+  free(got);
+  mop_meshlet_free(&m);
+  free_sphere(&s);
+  TEST_END();
+}
+
+static void test_bounds_conservative(void) {
+  TEST_BEGIN("meshlet_build: spheres and cones bound their meshlet");
+  Sphere s = make_sphere(48, 96);
+  MopMeshletData m;
+  TEST_ASSERT(mop_meshlet_build(s.v, s.vc, s.idx, s.ic, &m));
+
+  bool inside = true, in_cone = true;
+  for (uint32_t i = 0; i < m.meshlet_count; i++) {
+    const MopMeshlet *ml = &m.meshlets[i];
+    const MopMeshletCone *cone = &m.cones[i];
+    const uint32_t *vi = m.vertex_indices + ml->vertex_offset;
+    for (uint32_t k = 0; k < ml->vertex_count; k++) {
+      MopVec3 p = s.v[vi[k]].position;
+      float dx = p.x - ml->center[0], dy = p.y - ml->center[1],
+            dz = p.z - ml->center[2];
+      inside &= sqrtf(dx * dx + dy * dy + dz * dz) <= ml->radius + 1e-5f;
+    }
+    const uint8_t *pi = m.prim_indices + ml->triangle_offset;
+    for (uint32_t t = 0; t < ml->triangle_count; t++) {
+      MopVec3 a = s.v[vi[pi[t * 3]]].position;
+      MopVec3 b = s.v[vi[pi[t * 3 + 1]]].position;
+      MopVec3 c = s.v[vi[pi[t * 3 + 2]]].position;
+      MopVec3 n = mop_vec3_cross(mop_vec3_sub(b, a), mop_vec3_sub(c, a));
+      float len = mop_vec3_length(n);
+      if (len < 1e-8f)
+        continue;
+      float d = (n.x * cone->axis[0] + n.y * cone->axis[1] +
+                 n.z * cone->axis[2]) /
+                len;
+      in_cone &= d >= cone->cutoff - 1e-5f;
+    }
+  }
+  TEST_ASSERT(inside);
+  TEST_ASSERT(in_cone);
+  mop_meshlet_free(&m);
+  free_sphere(&s);
+  TEST_END();
+}
+
+static void test_pool_deterministic(void) {
+  TEST_BEGIN("meshlet_build: worker pool does not change the output");
+  MopViewport *vp = mop_viewport_create(&(MopViewportDesc){
+      .width = 32, .height = 32, .backend = MOP_BACKEND_CPU});
+  TEST_ASSERT(vp != NULL);
+  Sphere s = make_sphere(128, 256);
+  MopMeshletData a, b;
+  TEST_ASSERT(mop_meshlet_build(s.v, s.vc, s.idx, s.ic, &a));
+  TEST_ASSERT(mop_meshlet_build_ex(vp, s.v, s.vc, s.idx, s.ic, &b));
+
+  TEST_ASSERT(a.meshlet_count == b.meshlet_count);
+  TEST_ASSERT(a.vertex_index_count == b.vertex_index_count);
+  TEST_ASSERT(a.prim_index_count == b.prim_index_count);
+  TEST_ASSERT(memcmp(a.meshlets, b.meshlets,
+                     a.meshlet_count * sizeof(MopMeshlet)) == 0);
+  TEST_ASSERT(memcmp(a.cones, b.cones,
+                     a.meshlet_count * sizeof(MopMeshletCone)) == 0);
+  TEST_ASSERT(memcmp(a.vertex_indices, b.vertex_indices,
+                     a.vertex_index_count * sizeof(uint32_t)) == 0);
+  TEST_ASSERT(memcmp(a.prim_indices, b.prim_indices, a.prim_index_count) ==
+              0);
+
+  mop_meshlet_free(&a);
+  mop_meshlet_free(&b);
+  free_sphere(&s);
+  mop_viewport_destroy(vp);
+  TEST_END();
+}
+
+static void test_compact_clusters(void) {
+  TEST_BEGIN("meshlet_build: clusters stay compact on a UV sphere");
+  Sphere s = make_sphere(64, 128);
+  MopMeshletData m;
+  TEST_ASSERT(mop_meshlet_build(s.v, s.vc, s.idx, s.ic, &m));
+
+  /* Scanning rings in index order yields strips a quarter of the way
+   * around the sphere (mean radius ~0.46).  Grown patches are ~0.16. */
+  float radius = 0.0f, cutoff = 0.0f;
+  for (uint32_t i = 0; i < m.meshlet_count; i++) {
+    radius += m.meshlets[i].radius;
+    cutoff += m.cones[i].cutoff;
+  }
+  radius /= (float)m.meshlet_count;
+  cutoff /= (float)m.meshlet_count;
+  TEST_ASSERT(radius < 0.2f);
+  TEST_ASSERT(cutoff > 0.95f);
+  /* Patches should still be reasonably full */
+  TEST_ASSERT(m.meshlet_count * 48 < s.ic / 3);
+
+  mop_meshlet_free(&m);
+  free_sphere(&s);
+  TEST_END();
+}
+
+static void test_rejects_bad_index(void) {
+  TEST_BEGIN("meshlet_build: out-of-range index rejected");
+  MopVertex v[3] = {{.position = {0, 0, 0}},
+                    {.position = {1, 0, 0}},
+                    {.position = {0, 1, 0}}};
+  uint32_t idx[3] = {0, 1, 3};
+  MopMeshletData m;
+  TEST_ASSERT(!mop_meshlet_build(v, 3, idx, 3, &m));
+  TEST_ASSERT(m.meshlet_count == 0 && m.meshlets == NULL);
+  TEST_END();
+}
+
+int main(void) {
+  TEST_SUITE_BEGIN("meshlet_build");
+
+  TEST_RUN(test_covers_every_triangle);
+  TEST_RUN(test_bounds_conservative);
+  TEST_RUN(test_pool_deterministic);
+  TEST_RUN(test_compact_clusters);
+  TEST_RUN(test_rejects_bad_index);
+
+  TEST_REPORT();
+  TEST_EXIT();
+}
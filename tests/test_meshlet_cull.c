@@ -0,0 +1,356 @@
+/*
+ * Master of Puppets — Meshlet culling tests
+ * test_meshlet_cull.c — CPU frustum, normal-cone and depth-pyramid culling
+ *
+ * Every test renders the same frame with meshlet culling on and off and
+ * requires identical color and object-id buffers: culling may only skip
+ * work, never change the image.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "test_harness.h"
+
+#include "core/viewport_internal.h"
+#include "rhi/rhi.h"
+
+#include <math.h>
+#include <mop/mop.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define VP_SIZE 128
+
+/* UV sphere with outward (counter-clockwise) winding */
+static MopMesh *add_sphere(MopViewport *vp, int rings, int segs,
+                           MopVec3 center, float radius, MopColor color,
+                           uint32_t object_id) {
+  uint32_t vc = (uint32_t)((rings + 1) * (segs + 1));
+  uint32_t ic = (uint32_t)(rings * segs * 6);
+  MopVertex *v = calloc(vc, sizeof(MopVertex));
+  uint32_t *idx = malloc(ic * sizeof(uint32_t));
+  for (int r = 0; r <= rings; r++) {
+    float th = 3.14159265f * (float)r / (float)rings;
+    for (int s = 0; s <= segs; s++) {
+      float ph = 2.0f * 3.14159265f * (float)s / (float)segs;
+      MopVec3 n = {sinf(th) * cosf(ph), cosf(th), sinf(th) * sinf(ph)};
+      MopVertex *p = &v[r * (segs + 1) + s];
+      p->position = (MopVec3){center.x + n.x * radius,
+                              center.y + n.y * radius,
+                              center.z + n.z * radius};
+      p->normal = n;
+      p->color = color;
+    }
+  }
+  uint32_t k = 0;
+  for (int r = 0; r < rings; r++)
+    for (int s = 0; s < segs; s++) {
+      uint32_t a = (uint32_t)(r * (segs + 1) + s), b = a + 1;
+      uint32_t c = a + (uint32_t)(segs + 1), d = c + 1;
+      idx[k++] = a, idx[k++] = b, idx[k++] = d;
+      idx[k++] = a, idx[k++] = d, idx[k++] = c;
+    }
+  MopMesh *mesh = mop_viewport_add_mesh(
+      vp, &(MopMeshDesc){.vertices = v,
+                         .vertex_count = vc,
+                         .indices = idx,
+                         .index_count = ic,
+                         .object_id = object_id});
+  free(v);
+  free(idx);
+  return mesh;
+}
+
+static MopViewport *make_viewport(void) {
+  MopViewportDesc desc = {.width = VP_SIZE,
+                          .height = VP_SIZE,
+                          .backend = MOP_BACKEND_CPU,
+                          .ssaa_factor = 1};
+  MopViewport *vp = mop_viewport_create(&desc);
+  if (vp)
+    mop_viewport_set_post_effects(vp, 0);
+  return vp;
+}
+
+static const uint32_t *read_ids(MopViewport *vp) {
+  int w = 0, h = 0;
+  return vp->rhi->framebuffer_read_object_id(vp->device, vp->framebuffer, &w,
+                                             &h);
+}
+
+/* Render with culling off, then on; returns true if both frames match.
+ * *stats receives the culled frame's statistics. */
+static bool render_matches(MopViewport *vp, MopFrameStats *stats) {
+  size_t n = (size_t)VP_SIZE * VP_SIZE;
+  uint8_t *ref = malloc(n * 4);
+  uint32_t *ref_id = malloc(n * sizeof(uint32_t));
+  if (!ref || !ref_id) {
+    free(ref);
+    free(ref_id);
+    return false;
+  }
+
+  int w = 0, h = 0;
+  mop_viewport_set_meshlet_culling(vp, false);
+  mop_viewport_render(vp);
+  memcpy(ref, mop_viewport_read_color(vp, &w, &h), n * 4);
+  memcpy(ref_id, read_ids(vp), n * sizeof(uint32_t));
+  MopFrameStats off = mop_viewport_get_stats(vp);
+
+  mop_viewport_set_meshlet_culling(vp, true);
+  mop_viewport_render(vp);
+  bool same = memcmp(ref, mop_viewport_read_color(vp, &w, &h), n * 4) == 0 &&
+              memcmp(ref_id, read_ids(vp), n * sizeof(uint32_t)) == 0;
+  *stats = mop_viewport_get_stats(vp);
+  free(ref);
+  free(ref_id);
+  return same && off.meshlets_visible == 0;
+}
+
+static uint32_t culled(const MopFrameStats *s) {
+  return s->meshlets_culled_frustum + s->meshlets_culled_backface +
+         s->meshlets_culled_occlusion;
+}
+
+static void test_backface_cones(void) {
+  TEST_BEGIN("meshlet: back half of a sphere is cone-culled");
+  MopViewport *vp = make_viewport();
+  TEST_ASSERT(vp != NULL);
+  MopMesh *sphere =
+      add_sphere(vp, 64, 128, (MopVec3){0, 0, 0}, 1.0f,
+                 (MopColor){1, 0, 0, 1}, 1);
+  TEST_ASSERT(sphere != NULL);
+  uint32_t count = mop_mesh_build_meshlets(sphere);
+  TEST_ASSERT(count > 0 && mop_mesh_get_meshlet_count(sphere) == count);
+
+  mop_viewport_set_camera(vp, (MopVec3){0, 0, 4}, (MopVec3){0, 0, 0},
+                          (MopVec3){0, 1, 0}, 45.0f, 0.1f, 100.0f);
+  MopFrameStats st;
+  TEST_ASSERT(render_matches(vp, &st));
+  TEST_ASSERT(st.meshlets_visible + culled(&st) == count);
+  TEST_ASSERT(st.meshlets_culled_frustum == 0);
+  /* Camera at 4 radii sees ~43% of the surface; compact clusters with
+   * narrow cones let the conservative test reject about half of them */
+  TEST_ASSERT(st.meshlets_culled_backface * 2 > count);
+  mop_viewport_destroy(vp);
+  TEST_END();
+}
+
+static void test_frustum(void) {
+  TEST_BEGIN("meshlet: off-screen clusters are frustum-culled");
+  MopViewport *vp = make_viewport();
+  TEST_ASSERT(vp != NULL);
+  MopMesh *sphere =
+      add_sphere(vp, 64, 128, (MopVec3){0, 0, 0}, 1.0f,
+                 (MopColor){0, 1, 0, 1}, 1);
+  TEST_ASSERT(sphere != NULL);
+  uint32_t count = mop_mesh_build_meshlets(sphere);
+  TEST_ASSERT(count > 0);
+
+  /* Close up on one side: most of the sphere is outside the view */
+  mop_viewport_set_camera(vp, (MopVec3){0.6f, 0.6f, 1.6f},
+                          (MopVec3){0.6f, 0.6f, 0}, (MopVec3){0, 1, 0}, 40.0f,
+                          0.1f, 100.0f);
+  MopFrameStats st;
+  TEST_ASSERT(render_matches(vp, &st));
+  TEST_ASSERT(st.meshlets_visible + culled(&st) == count);
+  TEST_ASSERT(st.meshlets_culled_frustum > 0);
+  TEST_ASSERT(st.meshlets_visible * 4 < count);
+  mop_viewport_destroy(vp);
+  TEST_END();
+}
+
+static void test_occlusion(void) {
+  TEST_BEGIN("meshlet: clusters behind nearer geometry are occlusion-culled");
+  MopViewport *vp = make_viewport();
+  TEST_ASSERT(vp != NULL);
+  /* The occluder is drawn first and fills the whole view */
+  MopMesh *front =
+      add_sphere(vp, 32, 64, (MopVec3){0, 0, 0}, 2.0f,
+                 (MopColor){0, 0, 1, 1}, 1);
+  MopMesh *back =
+      add_sphere(vp, 64, 128, (MopVec3){0, 0, -4}, 1.0f,
+                 (MopColor){1, 0, 0, 1}, 2);
+  TEST_ASSERT(front != NULL && back != NULL);
+  uint32_t count = mop_mesh_build_meshlets(back);
+  TEST_ASSERT(count > 0);
+
+  mop_viewport_set_camera(vp, (MopVec3){0, 0, 4}, (MopVec3){0, 0, 0},
+                          (MopVec3){0, 1, 0}, 45.0f, 0.1f, 100.0f);
+  MopFrameStats st;
+  TEST_ASSERT(render_matches(vp, &st));
+  TEST_ASSERT(st.meshlets_visible + culled(&st) == count);
+  TEST_ASSERT(st.meshlets_culled_occlusion > 0);
+  TEST_ASSERT(st.meshlets_visible == 0);
+  mop_viewport_destroy(vp);
+  TEST_END();
+}
+
+/* n x n quads over [x0,x1] x [y0,y1] at NDC depth z, drawn with identity
+ * matrices straight into a CPU framebuffer */
+typedef struct RhiGrid {
+  MopRhiBuffer *vb, *ib;
+  uint32_t vertex_count, index_count;
+  MopMeshletData meshlets;
+} RhiGrid;
+
+static bool rhi_grid(const MopRhiBackend *cpu, MopRhiDevice *dev, int n,
+                     float x0, float y0, float x1, float y1, float z,
+                     RhiGrid *g) {
+  uint32_t vc = (uint32_t)((n + 1) * (n + 1)), ic = (uint32_t)(n * n * 6);
+  MopVertex *v = calloc(vc, sizeof(MopVertex));
+  uint32_t *idx = malloc(ic * sizeof(uint32_t));
+  if (!v || !idx) {
+    free(v);
+    free(idx);
+    return false;
+  }
+  for (int y = 0; y <= n; y++)
+    for (int x = 0; x <= n; x++) {
+      MopVertex *p = &v[y * (n + 1) + x];
+      p->position = (MopVec3){x0 + (x1 - x0) * (float)x / (float)n,
+                              y0 + (y1 - y0) * (float)y / (float)n, z};
+      p->normal = (MopVec3){0, 0, 1};
+      p->color = (MopColor){1, 1, 1, 1};
+    }
+  uint32_t k = 0;
+  for (int y = 0; y < n; y++)
+    for (int x = 0; x < n; x++) {
+      uint32_t a = (uint32_t)(y * (n + 1) + x), b = a + 1;
+      uint32_t c = a + (uint32_t)(n + 1), d = c + 1;
+      idx[k++] = a, idx[k++] = b, idx[k++] = d;
+      idx[k++] = a, idx[k++] = d, idx[k++] = c;
+    }
+  *g = (RhiGrid){
+      .vb = cpu->buffer_create(
+          dev, &(MopRhiBufferDesc){.data = v, .size = vc * sizeof(MopVertex)}),
+      .ib = cpu->buffer_create(
+          dev, &(MopRhiBufferDesc){.data = idx, .size = ic * sizeof(uint32_t)}),
+      .vertex_count = vc,
+      .index_count = ic,
+  };
+  bool ok = g->vb && g->ib && mop_meshlet_build(v, vc, idx, ic, &g->meshlets);
+  free(v);
+  free(idx);
+  return ok;
+}
+
+static void rhi_grid_draw(const MopRhiBackend *cpu, MopRhiDevice *dev,
+                          MopRhiFramebuffer *fb, const RhiGrid *g,
+                          uint32_t object_id, bool depth_test,
+                          bool use_meshlets) {
+  MopMat4 id = mop_mat4_identity();
+  MopRhiDrawCall call = {
+      .vertex_buffer = g->vb,
+      .index_buffer = g->ib,
+      .vertex_count = g->vertex_count,
+      .index_count = g->index_count,
+      .object_id = object_id,
+      .model = id,
+      .view = id,
+      .projection = id,
+      .mvp = id,
+      .base_color = (MopColor){1, 1, 1, 1},
+      .opacity = 1.0f,
+      .ambient = 1.0f,
+      .depth_test = depth_test,
+      .depth_write = true,
+      .blend_mode = MOP_BLEND_OPAQUE,
+      .meshlets = use_meshlets ? &g->meshlets : NULL,
+  };
+  cpu->draw(dev, fb, &call);
+}
+
+static void rhi_grid_free(const MopRhiBackend *cpu, MopRhiDevice *dev,
+                          RhiGrid *g) {
+  if (g->vb)
+    cpu->buffer_destroy(dev, g->vb);
+  if (g->ib)
+    cpu->buffer_destroy(dev, g->ib);
+  mop_meshlet_free(&g->meshlets);
+}
+
+static void test_untested_depth_drops_pyramid(void) {
+  TEST_BEGIN("meshlet: depth writes without a depth test drop the pyramid");
+  const MopRhiBackend *cpu = mop_rhi_get_backend(MOP_BACKEND_CPU);
+  MopRhiDevice *dev = cpu->device_create();
+  TEST_ASSERT(dev != NULL);
+  MopRhiFramebuffer *fb = cpu->framebuffer_create(
+      dev, &(MopRhiFramebufferDesc){.width = 64, .height = 64});
+  TEST_ASSERT(fb != NULL);
+
+  RhiGrid wall = {0}, hidden = {0}, far = {0}, probe = {0};
+  TEST_ASSERT(rhi_grid(cpu, dev, 1, -1, -1, 1, 1, -0.8f, &wall));
+  TEST_ASSERT(rhi_grid(cpu, dev, 8, -0.5f, -0.5f, 0.5f, 0.5f, 0.5f, &hidden));
+  TEST_ASSERT(rhi_grid(cpu, dev, 1, -1, -1, 1, 1, 0.9f, &far));
+  TEST_ASSERT(rhi_grid(cpu, dev, 1, -0.1f, -0.1f, 0.1f, 0.1f, 0.0f, &probe));
+
+  cpu->frame_begin(dev, fb, (MopColor){0, 0, 0, 1});
+  /* The large draw behind the wall builds the pyramid from the wall */
+  rhi_grid_draw(cpu, dev, fb, &wall, 1, true, false);
+  rhi_grid_draw(cpu, dev, fb, &hidden, 2, true, true);
+  MopRhiMeshletStats st;
+  cpu->meshlet_stats(dev, &st);
+  TEST_ASSERT(st.occlusion > 0 && st.visible == 0);
+  /* An untested draw pushes depth back past the wall; the probe sits in
+   * front of it and is too small to rebuild the pyramid itself */
+  rhi_grid_draw(cpu, dev, fb, &far, 3, false, false);
+  rhi_grid_draw(cpu, dev, fb, &probe, 4, true, true);
+  cpu->frame_end(dev, fb);
+
+  int w = 0, h = 0;
+  const uint32_t *ids = cpu->framebuffer_read_object_id(dev, fb, &w, &h);
+  TEST_ASSERT(ids != NULL && ids[32 * w + 32] == 4);
+  TEST_ASSERT(ids[2 * w + 2] == 3);
+
+  rhi_grid_free(cpu, dev, &wall);
+  rhi_grid_free(cpu, dev, &hidden);
+  rhi_grid_free(cpu, dev, &far);
+  rhi_grid_free(cpu, dev, &probe);
+  cpu->framebuffer_destroy(dev, fb);
+  cpu->device_destroy(dev);
+  TEST_END();
+}
+
+static void test_lifecycle(void) {
+  TEST_BEGIN("meshlet: geometry updates drop meshlets");
+  MopViewport *vp = make_viewport();
+  TEST_ASSERT(vp != NULL);
+  MopMesh *sphere =
+      add_sphere(vp, 16, 32, (MopVec3){0, 0, 0}, 1.0f,
+                 (MopColor){1, 1, 1, 1}, 1);
+  TEST_ASSERT(sphere != NULL);
+  TEST_ASSERT(mop_viewport_get_meshlet_culling(vp));
+  TEST_ASSERT(mop_mesh_get_meshlet_count(sphere) == 0);
+  TEST_ASSERT(mop_mesh_build_meshlets(sphere) > 0);
+
+  MopVertex tri[3] = {{.position = {0, 0, 0}},
+                      {.position = {1, 0, 0}},
+                      {.position = {0, 1, 0}}};
+  uint32_t idx[3] = {0, 1, 2};
+  mop_mesh_update_geometry(sphere, vp, tri, 3, idx, 3);
+  TEST_ASSERT(mop_mesh_get_meshlet_count(sphere) == 0);
+  TEST_ASSERT(mop_mesh_build_meshlets(sphere) == 1);
+
+  mop_viewport_render(vp);
+  MopFrameStats st = mop_viewport_get_stats(vp);
+  TEST_ASSERT(st.meshlets_visible + culled(&st) == 1);
+
+  TEST_ASSERT(mop_mesh_build_meshlets(NULL) == 0);
+  mop_viewport_remove_mesh(vp, sphere);
+  mop_viewport_destroy(vp);
+  TEST_END();
+}
+
+int main(void) {
+  TEST_SUITE_BEGIN("meshlet_cull");
+
+  TEST_RUN(test_backface_cones);
+  TEST_RUN(test_frustum);
+  TEST_RUN(test_occlusion);
+  TEST_RUN(test_untested_depth_drops_pyramid);
+  TEST_RUN(test_lifecycle);
+
+  TEST_REPORT();
+  TEST_EXIT();
+}
@@ -0,0 +1,195 @@
+/*
+ * Master of Puppets — Mip generation tests
+ * test_mip_gen.c — Filters, linear-space sRGB, normal renormalization,
+ *                  alpha-coverage preservation and parallel determinism
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "test_harness.h"
+
+#include <math.h>
+#include <mop/mop.h>
+
+static uint8_t *make_image(int w, int h, uint32_t seed) {
+  uint8_t *px = malloc((size_t)w * h * 4);
+  if (!px)
+    return NULL;
+  for (size_t i = 0; i < (size_t)w * h * 4; i++) {
+    seed = seed * 1664525u + 1013904223u;
+    px[i] = (uint8_t)(seed >> 24);
+  }
+  return px;
+}
+
+static void test_box_matches_legacy_average(void) {
+  TEST_BEGIN("mips: box filter averages 2x2 blocks");
+  uint8_t *px = make_image(16, 8, 7);
+  TEST_ASSERT(px != NULL);
+  size_t size = 0;
+  int levels = 0;
+  uint8_t *mips = mop_tex_generate_mips(px, 16, 8, &size, &levels);
+  TEST_ASSERT(mips != NULL);
+  TEST_ASSERT(levels == 5);
+  TEST_ASSERT(size == (size_t)(16 * 8 + 8 * 4 + 4 * 2 + 2 * 1 + 1) * 4);
+  TEST_ASSERT(memcmp(mips, px, 16 * 8 * 4) == 0);
+
+  const uint8_t *l1 = mips + 16 * 8 * 4;
+  for (int y = 0; y < 4; y++)
+    for (int x = 0; x < 8; x++)
+      for (int c = 0; c < 4; c++) {
+        int s = px[((2 * y) * 16 + 2 * x) * 4 + c] +
+                px[((2 * y) * 16 + 2 * x + 1) * 4 + c] +
+                px[((2 * y + 1) * 16 + 2 * x) * 4 + c] +
+                px[((2 * y + 1) * 16 + 2 * x + 1) * 4 + c];
+        int got = l1[(y * 8 + x) * 4 + c];
+        TEST_ASSERT(abs(got - (s + 2) / 4) <= 1);
+      }
+  free(mips);
+  free(px);
+  TEST_END();
+}
+
+static void test_srgb_linear_average(void) {
+  TEST_BEGIN("mips: sRGB color is averaged in linear space");
+  /* Black/white checkerboard: the linear mean is 0.5, which encodes to
+   * sRGB 188 — a gamma-space average would give 128. */
+  uint8_t px[4 * 4 * 4];
+  for (int i = 0; i < 16; i++) {
+    uint8_t v = ((i % 4) + (i / 4)) % 2 ? 255 : 0;
+    px[i * 4 + 0] = px[i * 4 + 1] = px[i * 4 + 2] = v;
+    px[i * 4 + 3] = 255;
+  }
+  MopMipDesc d = {.filter = MOP_MIP_FILTER_BOX, .srgb = true};
+  size_t size = 0;
+  int levels = 0;
+  uint8_t *mips = mop_tex_generate_mips_ex(NULL, px, 4, 4, &d, &size, &levels);
+  TEST_ASSERT(mips != NULL);
+  const uint8_t *l1 = mips + sizeof(px);
+  TEST_ASSERT(abs(l1[0] - 188) <= 1);
+  TEST_ASSERT(l1[3] == 255);
+  free(mips);
+  TEST_END();
+}
+
+static void test_normal_map_renormalized(void) {
+  TEST_BEGIN("mips: normal map texels stay unit length");
+  uint8_t *px = make_image(32, 32, 99);
+  TEST_ASSERT(px != NULL);
+  MopMipDesc d = {.filter = MOP_MIP_FILTER_KAISER, .normal_map = true};
+  size_t size = 0;
+  int levels = 0;
+  uint8_t *mips =
+      mop_tex_generate_mips_ex(NULL, px, 32, 32, &d, &size, &levels);
+  TEST_ASSERT(mips != NULL);
+  for (size_t i = 32 * 32; i < size / 4; i++) {
+    float n[3];
+    for (int c = 0; c < 3; c++)
+      n[c] = mips[i * 4 + c] / 255.0f * 2.0f - 1.0f;
+    float len = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+    TEST_ASSERT(fabsf(len - 1.0f) < 0.02f);
+  }
+  free(mips);
+  free(px);
+  TEST_END();
+}
+
+static void test_alpha_coverage_preserved(void) {
+  TEST_BEGIN("mips: alpha-test coverage is preserved per level");
+  /* Sparse foliage-like mask: ~30% of texels opaque, rest clear */
+  enum { W = 64 };
+  uint8_t *px = make_image(W, W, 3);
+  TEST_ASSERT(px != NULL);
+  for (int i = 0; i < W * W; i++)
+    px[i * 4 + 3] = px[i * 4 + 3] < 77 ? 255 : 0;
+
+  MopMipDesc d = {.filter = MOP_MIP_FILTER_BOX, .alpha_cutoff = 0.5f};
+  size_t size = 0;
+  int levels = 0;
+  uint8_t *mips = mop_tex_generate_mips_ex(NULL, px, W, W, &d, &size, &levels);
+  TEST_ASSERT(mips != NULL);
+
+  int pass0 = 0;
+  for (int i = 0; i < W * W; i++)
+    pass0 += px[i * 4 + 3] >= 128;
+  float target = (float)pass0 / (W * W);
+
+  const uint8_t *lvl = mips + W * W * 4;
+  for (int w = W / 2; w >= 8; w /= 2) {
+    int pass = 0;
+    for (int i = 0; i < w * w; i++)
+      pass += lvl[i * 4 + 3] >= 128;
+    TEST_ASSERT(fabsf((float)pass / (w * w) - target) < 0.08f);
+    lvl += (size_t)w * w * 4;
+  }
+  free(mips);
+  free(px);
+  TEST_END();
+}
+
+static void test_parallel_matches_serial(void) {
+  TEST_BEGIN("mips: worker-pool generation matches the serial path");
+  MopViewportDesc vd = {.width = 32, .height = 32, .backend = MOP_BACKEND_CPU};
+  MopViewport *vp = mop_viewport_create(&vd);
+  TEST_ASSERT(vp != NULL);
+  uint8_t *px = make_image(300, 130, 11);
+  TEST_ASSERT(px != NULL);
+
+  static const MopMipFilter filters[] = {
+      MOP_MIP_FILTER_BOX, MOP_MIP_FILTER_KAISER, MOP_MIP_FILTER_LANCZOS};
+  for (int f = 0; f < 3; f++) {
+    MopMipDesc d = {.filter = filters[f], .srgb = true, .alpha_cutoff = 0.3f};
+    size_t s0 = 0, s1 = 0;
+    int l0 = 0, l1 = 0;
+    uint8_t *a = mop_tex_generate_mips_ex(NULL, px, 300, 130, &d, &s0, &l0);
+    uint8_t *b = mop_tex_generate_mips_ex(vp, px, 300, 130, &d, &s1, &l1);
+    TEST_ASSERT(a != NULL && b != NULL);
+    TEST_ASSERT(s0 == s1 && l0 == l1 && l0 == 9);
+    TEST_ASSERT(memcmp(a, b, s0) == 0);
+    free(a);
+    free(b);
+  }
+  free(px);
+  mop_viewport_destroy(vp);
+  TEST_END();
+}
+
+static void test_wide_filters_preserve_flat(void) {
+  TEST_BEGIN("mips: Kaiser and Lanczos keep a flat image flat");
+  uint8_t px[12 * 5 * 4];
+  for (size_t i = 0; i < sizeof(px); i += 4) {
+    px[i + 0] = 200;
+    px[i + 1] = 90;
+    px[i + 2] = 10;
+    px[i + 3] = 128;
+  }
+  for (int f = MOP_MIP_FILTER_KAISER; f <= MOP_MIP_FILTER_LANCZOS; f++) {
+    MopMipDesc d = {.filter = (MopMipFilter)f};
+    size_t size = 0;
+    int levels = 0;
+    uint8_t *mips = mop_tex_generate_mips_ex(NULL, px, 12, 5, &d, &size,
+                                             &levels);
+    TEST_ASSERT(mips != NULL);
+    TEST_ASSERT(levels == 4);
+    for (size_t i = sizeof(px); i < size; i += 4) {
+      TEST_ASSERT(mips[i + 0] == 200 && mips[i + 1] == 90);
+      TEST_ASSERT(mips[i + 2] == 10 && mips[i + 3] == 128);
+    }
+    free(mips);
+  }
+  TEST_END();
+}
+
+int main(void) {
+  TEST_SUITE_BEGIN("mip_gen");
+
+  TEST_RUN(test_box_matches_legacy_average);
+  TEST_RUN(test_srgb_linear_average);
+  TEST_RUN(test_normal_map_renormalized);
+  TEST_RUN(test_alpha_coverage_preserved);
+  TEST_RUN(test_parallel_matches_serial);
+  TEST_RUN(test_wide_filters_preserve_flat);
+
+  TEST_REPORT();
+  TEST_EXIT();
+}
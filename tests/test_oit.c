@@ -3,7 +3,8 @@
  * test_oit.c — Phase 4C: Order-Independent Transparency (OIT)
  *
  * Tests OIT flag, public API, shader weight function, composite formula,
- * draw deferral struct layout, and Vulkan struct layout.
+ * CPU weighted and exact OIT rendering, draw deferral struct layout, and
+ * Vulkan struct layout.
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -12,6 +13,7 @@
 #include <math.h>
 #include <mop/mop.h>
 #include <mop/render/postprocess.h>
+#include <stdlib.h>
 #include <string.h>
 
 /* Access internal viewport struct for OIT state verification */
@@ -203,6 +205,255 @@ static void test_oit_framebuffer_fields(void) {
 }
 #endif /* MOP_HAS_VULKAN */
 
+/* -------------------------------------------------------------------------
+ * CPU OIT (rasterizer_oit.c)
+ * ------------------------------------------------------------------------- */
+
+#define OIT_VP 128
+
+/* Quad from (x0, -1, z0) to (x1, 1, z1), facing +z */
+static MopMesh *add_quad(MopViewport *vp, float x0, float z0, float x1,
+                         float z1, MopColor color, float opacity,
+                         uint32_t id) {
+  MopVertex v[4];
+  memset(v, 0, sizeof(v));
+  v[0].position = (MopVec3){x0, -1, z0};
+  v[1].position = (MopVec3){x1, -1, z1};
+  v[2].position = (MopVec3){x1, 1, z1};
+  v[3].position = (MopVec3){x0, 1, z0};
+  for (int i = 0; i < 4; i++) {
+    v[i].normal = (MopVec3){0, 0, 1};
+    v[i].color = color;
+  }
+  uint32_t idx[6] = {0, 1, 2, 0, 2, 3};
+  MopMesh *m = mop_viewport_add_mesh(vp, &(MopMeshDesc){.vertices = v,
+                                                        .vertex_count = 4,
+                                                        .indices = idx,
+                                                        .index_count = 6,
+                                                        .object_id = id});
+  mop_mesh_set_opacity(m, opacity);
+  return m;
+}
+
+static MopViewport *oit_viewport(uint32_t effects, MopOitMode mode) {
+  MopViewport *vp = mop_viewport_create(&(MopViewportDesc){
+      .width = OIT_VP, .height = OIT_VP, .backend = MOP_BACKEND_CPU});
+  if (!vp)
+    return NULL;
+  mop_viewport_set_post_effects(vp, effects);
+  mop_viewport_set_oit_mode(vp, mode);
+  mop_viewport_set_chrome(vp, false);
+  mop_viewport_set_camera(vp, (MopVec3){0, 0, 5}, (MopVec3){0, 0, 0},
+                          (MopVec3){0, 1, 0}, 45.0f, 0.1f, 100.0f);
+  return vp;
+}
+
+static uint8_t *render_copy(MopViewport *vp) {
+  int w = 0, h = 0;
+  mop_viewport_render(vp);
+  const uint8_t *px = mop_viewport_read_color(vp, &w, &h);
+  uint8_t *copy = malloc((size_t)w * h * 4);
+  if (copy)
+    memcpy(copy, px, (size_t)w * h * 4);
+  return copy;
+}
+
+static int max_diff(const uint8_t *a, const uint8_t *b) {
+  int m = 0;
+  for (size_t i = 0; i < (size_t)OIT_VP * OIT_VP * 4; i++) {
+    int d = abs((int)a[i] - (int)b[i]);
+    m = d > m ? d : m;
+  }
+  return m;
+}
+
+static const uint8_t *px_at(const uint8_t *img, int x, int y) {
+  return img + ((size_t)y * OIT_VP + x) * 4;
+}
+
+static const MopColor RED = {1, 0.1f, 0.1f, 1}, BLUE = {0.1f, 0.1f, 1, 1};
+
+/* Two quads crossing in an X: blue is in front on the left, red on the
+ * right.  No draw order gets both halves right; per-pixel sorting does. */
+static void test_oit_exact_intersecting(void) {
+  TEST_BEGIN("oit_exact_intersecting");
+  MopViewport *vp = oit_viewport(MOP_POST_OIT, MOP_OIT_EXACT);
+  TEST_ASSERT(vp != NULL);
+  add_quad(vp, -1, -0.5f, 1, 0.5f, RED, 0.6f, 1);
+  add_quad(vp, -1, 0.5f, 1, -0.5f, BLUE, 0.6f, 2);
+  uint8_t *img = render_copy(vp);
+  TEST_ASSERT(img != NULL);
+  const uint8_t *left = px_at(img, 45, 64), *right = px_at(img, 83, 64);
+  TEST_ASSERT(left[2] > 2 * left[0]);
+  TEST_ASSERT(right[0] > 2 * right[2]);
+  /* Picking sees the nearer surface on each side */
+  TEST_ASSERT(mop_viewport_pick(vp, 45, 64).object_id == 2);
+  TEST_ASSERT(mop_viewport_pick(vp, 83, 64).object_id == 1);
+  free(img);
+  mop_viewport_destroy(vp);
+  TEST_END();
+}
+
+/* Scene order must not matter in either mode */
+static void test_oit_order_independent(void) {
+  TEST_BEGIN("oit_order_independent");
+  for (int mode = MOP_OIT_WEIGHTED; mode <= MOP_OIT_EXACT; mode++) {
+    MopViewport *a = oit_viewport(MOP_POST_OIT, (MopOitMode)mode);
+    MopViewport *b = oit_viewport(MOP_POST_OIT, (MopOitMode)mode);
+    TEST_ASSERT(a && b);
+    add_quad(a, -1, 0.3f, 1, 0.3f, RED, 0.5f, 1);
+    add_quad(a, -0.5f, -0.3f, 1.5f, -0.3f, BLUE, 0.5f, 2);
+    add_quad(b, -0.5f, -0.3f, 1.5f, -0.3f, BLUE, 0.5f, 2);
+    add_quad(b, -1, 0.3f, 1, 0.3f, RED, 0.5f, 1);
+    uint8_t *ia = render_copy(a), *ib = render_copy(b);
+    TEST_ASSERT(ia && ib);
+    TEST_ASSERT(max_diff(ia, ib) <= 1);
+    free(ia);
+    free(ib);
+    mop_viewport_destroy(a);
+    mop_viewport_destroy(b);
+  }
+  TEST_END();
+}
+
+/* 24 stacked layers: more than MOP_SW_OIT_LAYERS per pixel and more
+ * fragments than the initial node pool.  The first frame regrows the
+ * pool and redraws; the result matches a correctly sorted blend. */
+static void test_oit_exact_many_layers(void) {
+  TEST_BEGIN("oit_exact_many_layers");
+  MopViewport *oit = oit_viewport(MOP_POST_OIT, MOP_OIT_EXACT);
+  MopViewport *ref = oit_viewport(0, MOP_OIT_WEIGHTED);
+  TEST_ASSERT(oit && ref);
+  for (int i = 0; i < 24; i++) {
+    float z = -1.2f + 0.1f * (float)i;
+    MopColor c = (i & 1) ? RED : BLUE;
+    add_quad(oit, -1, z, 1, z, c, 0.3f, (uint32_t)i + 1);
+    add_quad(ref, -1, z, 1, z, c, 0.3f, (uint32_t)i + 1);
+  }
+  uint8_t *first = render_copy(oit), *second = render_copy(oit);
+  uint8_t *sorted = render_copy(ref);
+  TEST_ASSERT(first && second && sorted);
+  TEST_ASSERT(oit->oit.node_capacity > 65536);
+  TEST_ASSERT(memcmp(first, second, (size_t)OIT_VP * OIT_VP * 4) == 0);
+  TEST_ASSERT(max_diff(second, sorted) <= 2);
+  free(first);
+  free(second);
+  free(sorted);
+  mop_viewport_destroy(oit);
+  mop_viewport_destroy(ref);
+  TEST_END();
+}
+
+/* The overflowing first frame redraws its alpha meshes only: an additive
+ * quad blended straight into the color target must not be added twice */
+static void test_oit_regrow_keeps_direct_blend(void) {
+  TEST_BEGIN("oit_regrow_keeps_direct_blend");
+  MopViewport *vp = oit_viewport(MOP_POST_OIT, MOP_OIT_EXACT);
+  TEST_ASSERT(vp != NULL);
+  for (int i = 0; i < 24; i++) {
+    float z = -1.2f + 0.1f * (float)i;
+    add_quad(vp, -1, z, 1, z, (i & 1) ? RED : BLUE, 0.3f, (uint32_t)i + 1);
+  }
+  MopMesh *glow = add_quad(vp, -0.5f, 1.5f, 0.5f, 1.5f,
+                           (MopColor){0.2f, 0.2f, 0.2f, 1}, 0.5f, 100);
+  mop_mesh_set_blend_mode(glow, MOP_BLEND_ADDITIVE);
+  uint8_t *first = render_copy(vp), *second = render_copy(vp);
+  TEST_ASSERT(first && second);
+  TEST_ASSERT(vp->oit.node_capacity > 65536);
+  TEST_ASSERT(memcmp(first, second, (size_t)OIT_VP * OIT_VP * 4) == 0);
+  free(first);
+  free(second);
+  mop_viewport_destroy(vp);
+  TEST_END();
+}
+
+/* The quad of add_quad at depth z, split into n x n cells, as one mesh
+ * per band of rows cells high */
+static void add_grid_quad(MopViewport *vp, int n, int rows, float z,
+                          MopColor color, float opacity, uint32_t id) {
+  int vc = (rows + 1) * (n + 1), ic = rows * n * 6;
+  MopVertex *v = calloc((size_t)vc, sizeof(MopVertex));
+  uint32_t *idx = malloc((size_t)ic * sizeof(uint32_t));
+  for (int y0 = 0; y0 < n; y0 += rows) {
+    int k = 0;
+    for (int i = 0; i < vc; i++) {
+      int gx = i % (n + 1), gy = y0 + i / (n + 1);
+      v[i].position = (MopVec3){-1.0f + 2.0f * (float)gx / (float)n,
+                                -1.0f + 2.0f * (float)gy / (float)n, z};
+      v[i].normal = (MopVec3){0, 0, 1};
+      v[i].color = color;
+    }
+    for (int y = 0; y < rows; y++) {
+      for (int x = 0; x < n; x++) {
+        uint32_t a = (uint32_t)(y * (n + 1) + x), b = a + 1;
+        uint32_t c = a + (uint32_t)n + 1, d = c + 1;
+        uint32_t q[6] = {a, b, d, a, d, c};
+        memcpy(&idx[k], q, sizeof(q));
+        k += 6;
+      }
+    }
+    MopMesh *m = mop_viewport_add_mesh(
+        vp, &(MopMeshDesc){.vertices = v,
+                           .vertex_count = (uint32_t)vc,
+                           .indices = idx,
+                           .index_count = (uint32_t)ic,
+                           .object_id = id});
+    mop_mesh_set_opacity(m, opacity);
+  }
+  free(v);
+  free(idx);
+}
+
+/* Meshes of more than 100 triangles take the tiled rasterizer, which
+ * bins OIT triangles into every tile they overlap.  Each fragment must
+ * be recorded exactly once: the result matches the same triangles drawn
+ * as one-row meshes, which are rasterized on the calling thread, and is
+ * the same every frame. */
+static void test_oit_tiled_matches_single_thread(void) {
+  TEST_BEGIN("oit_tiled_matches_single_thread");
+  for (int mode = MOP_OIT_WEIGHTED; mode <= MOP_OIT_EXACT; mode++) {
+    MopViewport *tiled = oit_viewport(MOP_POST_OIT, (MopOitMode)mode);
+    MopViewport *single = oit_viewport(MOP_POST_OIT, (MopOitMode)mode);
+    TEST_ASSERT(tiled && single);
+    for (int i = 0; i < 12; i++) {
+      float z = -0.6f + 0.1f * (float)i;
+      MopColor c = (i & 1) ? RED : BLUE;
+      add_grid_quad(tiled, 48, 48, z, c, 0.3f, (uint32_t)i + 1);
+      add_grid_quad(single, 48, 1, z, c, 0.3f, (uint32_t)i + 1);
+    }
+    uint8_t *ref = render_copy(single);
+    TEST_ASSERT(ref != NULL);
+    for (int frame = 0; frame < 4; frame++) {
+      uint8_t *img = render_copy(tiled);
+      TEST_ASSERT(img != NULL);
+      TEST_ASSERT(max_diff(img, ref) <= 1);
+      free(img);
+    }
+    free(ref);
+    mop_viewport_destroy(tiled);
+    mop_viewport_destroy(single);
+  }
+  TEST_END();
+}
+
+/* One layer: weighted blended OIT reduces to plain alpha blending */
+static void test_oit_weighted_single_layer(void) {
+  TEST_BEGIN("oit_weighted_single_layer");
+  MopViewport *oit = oit_viewport(MOP_POST_OIT, MOP_OIT_WEIGHTED);
+  MopViewport *ref = oit_viewport(0, MOP_OIT_WEIGHTED);
+  TEST_ASSERT(oit && ref);
+  add_quad(oit, -1, 0, 1, 0, RED, 0.4f, 1);
+  add_quad(ref, -1, 0, 1, 0, RED, 0.4f, 1);
+  uint8_t *a = render_copy(oit), *b = render_copy(ref);
+  TEST_ASSERT(a && b);
+  TEST_ASSERT(max_diff(a, b) <= 1);
+  free(a);
+  free(b);
+  mop_viewport_destroy(oit);
+  mop_viewport_destroy(ref);
+  TEST_END();
+}
+
 /* -------------------------------------------------------------------------
  * Main
  * ------------------------------------------------------------------------- */
@@ -229,6 +480,14 @@ int main(void) {
   test_oit_composite_fully_transparent();
   test_oit_composite_half_transparent();
 
+  /* CPU OIT */
+  test_oit_exact_intersecting();
+  test_oit_order_independent();
+  test_oit_exact_many_layers();
+  test_oit_regrow_keeps_direct_blend();
+  test_oit_tiled_matches_single_thread();
+  test_oit_weighted_single_layer();
+
 #if defined(MOP_HAS_VULKAN)
   /* Vulkan struct layout */
   test_oit_deferred_draw_fields();
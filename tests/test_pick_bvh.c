@@ -0,0 +1,246 @@
+/*
+ * Master of Puppets — Pick BVH tests
+ * test_pick_bvh.c — Accelerated, occlusion-aware vertex and edge picking
+ *
+ * Tests validate:
+ *   - BVH vertex and edge picks find the same nearest distance as testing
+ *     every element, for cursors all over the viewport
+ *   - Elements behind rendered geometry are not picked, elements in front
+ *     of it and on its silhouette are
+ *   - Editing the mesh drops its BVHs and the next pick sees the new
+ *     positions; with topology at hand, shared edges are listed once
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "test_harness.h"
+
+#include "core/pick_bvh.h"
+#include "core/viewport_internal.h"
+
+#include <math.h>
+#include <mop/mop.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* n x n grid of the given cell size centered on (0, 0, z), facing +Z.
+ * bump != 0 displaces z pseudo-randomly to keep the tree honest. */
+static MopMesh *add_grid(MopViewport *vp, uint32_t n, float cell, float z,
+                         float bump, uint32_t object_id) {
+  uint32_t vc = (n + 1) * (n + 1), ic = n * n * 6, k = 0;
+  MopVertex *v = calloc(vc, sizeof(MopVertex));
+  uint32_t *idx = malloc(ic * sizeof(uint32_t));
+  float half = 0.5f * cell * (float)n;
+  for (uint32_t i = 0; i < vc; i++) {
+    uint32_t h = i * 2654435761u;
+    v[i].position = (MopVec3){(float)(i % (n + 1)) * cell - half,
+                              (float)(i / (n + 1)) * cell - half,
+                              z + bump * ((float)(h >> 16) / 65536.0f - 0.5f)};
+    v[i].normal = (MopVec3){0, 0, 1};
+    v[i].color = (MopColor){1, 1, 1, 1};
+  }
+  for (uint32_t y = 0; y < n; y++) {
+    for (uint32_t x = 0; x < n; x++) {
+      uint32_t a = y * (n + 1) + x, b = a + 1;
+      uint32_t c = a + n + 1, d = c + 1;
+      uint32_t q[6] = {a, b, d, a, d, c};
+      memcpy(&idx[k], q, sizeof(q));
+      k += 6;
+    }
+  }
+  MopMesh *m = mop_viewport_add_mesh(
+      vp, &(MopMeshDesc){.vertices = v,
+                         .vertex_count = vc,
+                         .indices = idx,
+                         .index_count = ic,
+                         .object_id = object_id});
+  free(v);
+  free(idx);
+  return m;
+}
+
+static MopViewport *make_viewport(void) {
+  MopViewport *vp = mop_viewport_create(&(MopViewportDesc){
+      .width = 64, .height = 64, .backend = MOP_BACKEND_CPU});
+  if (vp)
+    mop_viewport_set_camera(vp, (MopVec3){0.3f, 0.2f, 8}, (MopVec3){0, 0, 0},
+                            (MopVec3){0, 1, 0}, 60.0f, 0.1f, 100.0f);
+  return vp;
+}
+
+static MopMat4 mvp_of(MopViewport *vp, MopMesh *m) {
+  return mop_mat4_multiply(
+      vp->projection_matrix,
+      mop_mat4_multiply(vp->view_matrix, m->world_transform));
+}
+
+static bool screen_of(MopViewport *vp, MopMesh *m, uint32_t v, float *sx,
+                      float *sy) {
+  const MopVertex *verts = vp->rhi->buffer_read(m->vertex_buffer);
+  MopMat4 mvp = mvp_of(vp, m);
+  return mop_selection_project_to_screen(&mvp, verts[v].position, vp->width,
+                                         vp->height, sx, sy);
+}
+
+/* Squared distance of the nearest vertex / edge by testing them all */
+static float brute_vertex(MopViewport *vp, MopMesh *m, float x, float y) {
+  float best = INFINITY;
+  for (uint32_t i = 0; i < m->vertex_count; i++) {
+    float sx, sy;
+    if (screen_of(vp, m, i, &sx, &sy))
+      best = fminf(best, (sx - x) * (sx - x) + (sy - y) * (sy - y));
+  }
+  return best;
+}
+
+static float brute_edge(MopViewport *vp, MopMesh *m, float x, float y) {
+  const uint32_t *idx = vp->rhi->buffer_read(m->index_buffer);
+  float best = INFINITY;
+  for (uint32_t he = 0; he < m->index_count; he++) {
+    uint32_t a, b;
+    float ax, ay, bx, by;
+    mop_pick_edge_ends(idx, he, &a, &b);
+    if (screen_of(vp, m, a, &ax, &ay) && screen_of(vp, m, b, &bx, &by))
+      best = fminf(best,
+                   mop_selection_point_seg_dist_sq(x, y, ax, ay, bx, by));
+  }
+  return best;
+}
+
+/* ---- tests ---- */
+
+static void test_matches_brute_force(void) {
+  TEST_BEGIN("matches_brute_force");
+  MopViewport *vp = make_viewport();
+  if (!vp)
+    MOP_TEST_SKIP("no CPU viewport");
+  MopMesh *m = add_grid(vp, 40, 0.2f, 0.0f, 0.5f, 1);
+  TEST_ASSERT(m != NULL);
+  mop_mesh_set_rotation(m, (MopVec3){0.4f, 0.3f, 0.0f});
+  mop_viewport_render(vp);
+
+  const float thr = 3.0f;
+  bool same = true;
+  int hits = 0;
+  for (int y = 0; y < 64; y += 3) {
+    for (int x = 0; x < 64; x += 3) {
+      float px = (float)x + 0.37f, py = (float)y + 0.61f;
+      uint32_t v = mop_selection_pick_vertex(vp, m, px, py, thr);
+      float want = brute_vertex(vp, m, px, py);
+      if (v == UINT32_MAX) {
+        same &= !(want < thr * thr);
+      } else {
+        float sx, sy;
+        screen_of(vp, m, v, &sx, &sy);
+        same &= fabsf((sx - px) * (sx - px) + (sy - py) * (sy - py) -
+                      want) < 1e-3f;
+        hits++;
+      }
+
+      uint32_t lo, hi;
+      uint32_t e = mop_selection_pick_edge(vp, m, px, py, thr, &lo, &hi);
+      want = brute_edge(vp, m, px, py);
+      if (e == UINT32_MAX) {
+        same &= !(want < thr * thr);
+      } else {
+        float ax, ay, bx, by;
+        screen_of(vp, m, lo, &ax, &ay);
+        screen_of(vp, m, hi, &bx, &by);
+        float d = mop_selection_point_seg_dist_sq(px, py, ax, ay, bx, by);
+        same &= fabsf(d - want) < 1e-3f && e == ((lo << 16) | hi);
+      }
+    }
+  }
+  /* The grid is in front of nothing: no pick is lost to occlusion */
+  TEST_ASSERT(same);
+  TEST_ASSERT(hits > 50);
+  TEST_ASSERT(m->pick_vertices != NULL && m->pick_edges != NULL);
+  TEST_ASSERT(m->pick_vertices->item_count == m->vertex_count);
+
+  mop_viewport_destroy(vp);
+  TEST_END();
+}
+
+static void test_occluded_rejected(void) {
+  TEST_BEGIN("occluded_rejected");
+  MopViewport *vp = make_viewport();
+  if (!vp)
+    MOP_TEST_SKIP("no CPU viewport");
+  /* A 2x2 card at z = 1 hides the middle of an 8x8 grid at z = -1 */
+  MopMesh *card = add_grid(vp, 1, 2.0f, 1.0f, 0.0f, 1);
+  MopMesh *back = add_grid(vp, 8, 1.0f, -1.0f, 0.0f, 2);
+  TEST_ASSERT(card != NULL && back != NULL);
+
+  uint32_t center = 4 * 9 + 4, outer = 1 * 9 + 1;
+  float cx, cy, ox, oy;
+  screen_of(vp, back, center, &cx, &cy);
+  screen_of(vp, back, outer, &ox, &oy);
+
+  /* Nothing rendered yet: everything is visible */
+  TEST_ASSERT(mop_selection_pick_vertex(vp, back, cx, cy, 2.0f) == center);
+
+  mop_viewport_render(vp);
+  TEST_ASSERT(mop_selection_pick_vertex(vp, back, cx, cy, 2.0f) ==
+              UINT32_MAX);
+  TEST_ASSERT(mop_selection_pick_edge(vp, back, cx + 1.0f, cy, 2.0f, NULL,
+                                      NULL) == UINT32_MAX);
+  TEST_ASSERT(mop_selection_pick_vertex(vp, back, ox, oy, 2.0f) == outer);
+  TEST_ASSERT(mop_selection_pick_edge(vp, back, ox + 1.0f, oy, 2.0f, NULL,
+                                      NULL) != UINT32_MAX);
+
+  /* The card's own corners sit on its silhouette */
+  float kx, ky;
+  screen_of(vp, card, 3, &kx, &ky);
+  TEST_ASSERT(mop_selection_pick_vertex(vp, card, kx, ky, 2.0f) == 3);
+
+  mop_viewport_destroy(vp);
+  TEST_END();
+}
+
+static void test_edit_rebuilds(void) {
+  TEST_BEGIN("edit_rebuilds");
+  MopViewport *vp = make_viewport();
+  if (!vp)
+    MOP_TEST_SKIP("no CPU viewport");
+  MopMesh *m = add_grid(vp, 8, 1.0f, 0.0f, 0.0f, 1);
+  TEST_ASSERT(m != NULL);
+
+  uint32_t v = 2 * 9 + 6;
+  float sx, sy;
+  screen_of(vp, m, v, &sx, &sy);
+  TEST_ASSERT(mop_selection_pick_vertex(vp, m, sx, sy, 2.0f) == v);
+  TEST_ASSERT(m->pick_vertices != NULL);
+
+  mop_mesh_move_vertices(m, vp, &v, 1, (MopVec3){0.5f, 0.5f, 0});
+  TEST_ASSERT(m->pick_vertices == NULL);
+  TEST_ASSERT(mop_selection_pick_vertex(vp, m, sx, sy, 2.0f) != v);
+  screen_of(vp, m, v, &sx, &sy);
+  TEST_ASSERT(mop_selection_pick_vertex(vp, m, sx, sy, 2.0f) == v);
+
+  /* Appended geometry is pickable too */
+  uint32_t face = 0;
+  mop_mesh_extrude_faces(m, vp, &face, 1, 2.0f);
+  uint32_t top = m->vertex_count - 1;
+  screen_of(vp, m, top, &sx, &sy);
+  TEST_ASSERT(mop_selection_pick_vertex(vp, m, sx, sy, 0.5f) == top);
+
+  /* The edit left its topology behind: shared edges are listed once */
+  TEST_ASSERT(m->topology != NULL);
+  TEST_ASSERT(mop_selection_pick_edge(vp, m, sx, sy, 2.0f, NULL, NULL) !=
+              UINT32_MAX);
+  TEST_ASSERT(m->pick_edges->item_count < m->index_count * 2 / 3);
+
+  mop_viewport_destroy(vp);
+  TEST_END();
+}
+
+int main(void) {
+  TEST_SUITE_BEGIN("pick_bvh");
+
+  TEST_RUN(test_matches_brute_force);
+  TEST_RUN(test_occluded_rejected);
+  TEST_RUN(test_edit_rebuilds);
+
+  TEST_REPORT();
+  TEST_EXIT();
+}
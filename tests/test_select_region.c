@@ -0,0 +1,287 @@
+/*
+ * Master of Puppets — Region selection tests
+ * test_select_region.c — Rectangle and lasso selection, set-backed storage
+ *
+ * Tests validate:
+ *   - The id set survives interleaved inserts and removes of 100k ids
+ *     and keeps the selection list and its positions in step
+ *   - Rectangles and lassos select the objects the last frame shows, and
+ *     only those; "through" also selects hidden ones
+ *   - Vertex, edge and face rectangles select the visible elements inside
+ *     them, and ADD / SUBTRACT combine with the current selection
+ *   - Selecting 100k faces at once is unbounded and exact
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "test_harness.h"
+
+#include "core/id_set.h"
+#include "core/viewport_internal.h"
+
+#include <math.h>
+#include <mop/mop.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* n x n grid of the given cell size centered on (cx, cy, z), facing +Z */
+static MopMesh *add_grid(MopViewport *vp, uint32_t n, float cell, float cx,
+                         float cy, float z, uint32_t object_id) {
+  uint32_t vc = (n + 1) * (n + 1), ic = n * n * 6, k = 0;
+  MopVertex *v = calloc(vc, sizeof(MopVertex));
+  uint32_t *idx = malloc(ic * sizeof(uint32_t));
+  float half = 0.5f * cell * (float)n;
+  for (uint32_t i = 0; i < vc; i++) {
+    v[i].position = (MopVec3){cx + (float)(i % (n + 1)) * cell - half,
+                              cy + (float)(i / (n + 1)) * cell - half, z};
+    v[i].normal = (MopVec3){0, 0, 1};
+    v[i].color = (MopColor){1, 1, 1, 1};
+  }
+  for (uint32_t y = 0; y < n; y++) {
+    for (uint32_t x = 0; x < n; x++) {
+      uint32_t a = y * (n + 1) + x, b = a + 1;
+      uint32_t c = a + n + 1, d = c + 1;
+      uint32_t q[6] = {a, b, d, a, d, c};
+      memcpy(&idx[k], q, sizeof(q));
+      k += 6;
+    }
+  }
+  MopMesh *m = mop_viewport_add_mesh(
+      vp, &(MopMeshDesc){.vertices = v,
+                         .vertex_count = vc,
+                         .indices = idx,
+                         .index_count = ic,
+                         .object_id = object_id});
+  free(v);
+  free(idx);
+  return m;
+}
+
+/* Straight-on camera: at z = 0, one world unit is 10 pixels and the
+ * origin is the center of the 200 x 200 viewport */
+static MopViewport *make_viewport(void) {
+  MopViewport *vp = mop_viewport_create(&(MopViewportDesc){
+      .width = 200, .height = 200, .backend = MOP_BACKEND_CPU});
+  if (vp) {
+    float dist = 10.0f / tanf(30.0f * 3.14159265f / 180.0f);
+    mop_viewport_set_camera(vp, (MopVec3){0, 0, dist}, (MopVec3){0, 0, 0},
+                            (MopVec3){0, 1, 0}, 60.0f, 0.1f, 100.0f);
+  }
+  return vp;
+}
+
+static uint32_t select_rect(MopViewport *vp, MopMesh *mesh, float x0,
+                            float y0, float x1, float y1, MopSelectOp op,
+                            bool through) {
+  float pts[4] = {x0, y0, x1, y1};
+  MopSelectRegion r = {pts, 2, op, through};
+  return mesh ? mop_mesh_select_region(mesh, vp, &r)
+              : mop_viewport_select_region(vp, &r);
+}
+
+static bool element_selected(MopViewport *vp, uint32_t e) {
+  const MopSelection *sel = mop_viewport_get_selection(vp);
+  for (uint32_t i = 0; i < sel->element_count; i++)
+    if (sel->elements[i] == e)
+      return true;
+  return false;
+}
+
+/* ---- tests ---- */
+
+static void test_id_set_stress(void) {
+  TEST_BEGIN("id_set_stress");
+  MopIdSet set = {0};
+  uint32_t *list = NULL, count = 0, cap = 0;
+  const uint32_t n = 100000;
+
+  for (uint32_t i = 0; i < n; i++)
+    TEST_ASSERT(mop_id_list_add(&set, &list, &count, &cap, i * 7919u));
+  TEST_ASSERT(!mop_id_list_add(&set, &list, &count, &cap, 7919u));
+  TEST_ASSERT(count == n && set.count == n);
+
+  /* Drop every third, then check membership and positions */
+  for (uint32_t i = 0; i < n; i += 3)
+    TEST_ASSERT(mop_id_list_remove(&set, list, &count, i * 7919u));
+  TEST_ASSERT(!mop_id_list_remove(&set, list, &count, 0));
+  bool ok = count == n - (n + 2) / 3;
+  for (uint32_t i = 0; i < n; i++)
+    ok &= mop_id_set_contains(&set, i * 7919u) == (i % 3 != 0);
+  for (uint32_t i = 0; i < count; i++)
+    ok &= mop_id_set_find(&set, list[i]) == i;
+  TEST_ASSERT(ok);
+
+  /* The empty-slot sentinel is a valid id too */
+  TEST_ASSERT(mop_id_list_add(&set, &list, &count, &cap, UINT32_MAX));
+  TEST_ASSERT(mop_id_set_find(&set, UINT32_MAX) == count - 1);
+  mop_id_set_clear(&set);
+  TEST_ASSERT(!mop_id_set_contains(&set, UINT32_MAX));
+  TEST_ASSERT(!mop_id_set_contains(&set, 7919u));
+
+  mop_id_set_free(&set);
+  free(list);
+  TEST_END();
+}
+
+static void test_objects_rect_and_lasso(void) {
+  TEST_BEGIN("objects_rect_and_lasso");
+  MopViewport *vp = make_viewport();
+  if (!vp)
+    MOP_TEST_SKIP("no CPU viewport");
+  /* Three 2x2 cards left to right around pixels x = 40, 100, 160 */
+  TEST_ASSERT(add_grid(vp, 1, 2.0f, -6.0f, 0, 0, 1) != NULL);
+  TEST_ASSERT(add_grid(vp, 1, 2.0f, 0.0f, 0, 0, 2) != NULL);
+  TEST_ASSERT(add_grid(vp, 1, 2.0f, 6.0f, 0, 0, 3) != NULL);
+  mop_viewport_render(vp);
+
+  TEST_ASSERT(select_rect(vp, NULL, 30, 90, 110, 110, MOP_SELECT_REPLACE,
+                          false) == 2);
+  TEST_ASSERT(mop_viewport_is_object_selected(vp, 1));
+  TEST_ASSERT(mop_viewport_is_object_selected(vp, 2));
+  TEST_ASSERT(!mop_viewport_is_object_selected(vp, 3));
+
+  /* Reversed corners, ADD */
+  TEST_ASSERT(select_rect(vp, NULL, 170, 105, 150, 95, MOP_SELECT_ADD,
+                          false) == 1);
+  TEST_ASSERT(mop_viewport_get_selected_count(vp) == 3);
+
+  TEST_ASSERT(select_rect(vp, NULL, 95, 95, 105, 105, MOP_SELECT_SUBTRACT,
+                          false) == 1);
+  TEST_ASSERT(!mop_viewport_is_object_selected(vp, 2));
+  TEST_ASSERT(mop_viewport_get_selected_count(vp) == 2);
+
+  /* A V-shaped lasso around the outer cards, dipping above the middle */
+  float lasso[] = {30, 90, 100, 120, 170, 90, 170, 110, 100, 130, 30, 110};
+  MopSelectRegion r = {lasso, 6, MOP_SELECT_REPLACE, false};
+  TEST_ASSERT(mop_viewport_select_region(vp, &r) == 2);
+  TEST_ASSERT(mop_viewport_is_object_selected(vp, 1));
+  TEST_ASSERT(!mop_viewport_is_object_selected(vp, 2));
+  TEST_ASSERT(mop_viewport_is_object_selected(vp, 3));
+
+  /* Empty space clears on REPLACE */
+  TEST_ASSERT(select_rect(vp, NULL, 60, 10, 80, 20, MOP_SELECT_REPLACE,
+                          false) == 0);
+  TEST_ASSERT(mop_viewport_get_selected_count(vp) == 0);
+
+  mop_viewport_destroy(vp);
+  TEST_END();
+}
+
+static void test_objects_through(void) {
+  TEST_BEGIN("objects_through");
+  MopViewport *vp = make_viewport();
+  if (!vp)
+    MOP_TEST_SKIP("no CPU viewport");
+  /* A small card hidden behind a big one */
+  TEST_ASSERT(add_grid(vp, 1, 6.0f, 0, 0, 1.0f, 1) != NULL);
+  TEST_ASSERT(add_grid(vp, 1, 2.0f, 0, 0, -1.0f, 2) != NULL);
+  mop_viewport_render(vp);
+
+  TEST_ASSERT(select_rect(vp, NULL, 80, 80, 120, 120, MOP_SELECT_REPLACE,
+                          false) == 1);
+  TEST_ASSERT(mop_viewport_is_object_selected(vp, 1));
+  TEST_ASSERT(!mop_viewport_is_object_selected(vp, 2));
+
+  TEST_ASSERT(select_rect(vp, NULL, 80, 80, 120, 120, MOP_SELECT_REPLACE,
+                          true) == 2);
+  TEST_ASSERT(mop_viewport_is_object_selected(vp, 2));
+
+  mop_viewport_destroy(vp);
+  TEST_END();
+}
+
+static void test_elements(void) {
+  TEST_BEGIN("elements");
+  MopViewport *vp = make_viewport();
+  if (!vp)
+    MOP_TEST_SKIP("no CPU viewport");
+  /* 10x10 grid of unit cells (10 px) over pixels [50, 150), and a card
+   * in front hiding its right half */
+  MopMesh *m = add_grid(vp, 10, 1.0f, 0, 0, 0, 1);
+  TEST_ASSERT(add_grid(vp, 1, 6.0f, 3.0f, 0, 1.0f, 2) != NULL);
+  TEST_ASSERT(m != NULL);
+  mop_viewport_render(vp);
+
+  /* Not in edit mode */
+  TEST_ASSERT(select_rect(vp, m, 0, 0, 200, 200, MOP_SELECT_REPLACE,
+                          false) == 0);
+
+  /* Vertices: the 3 x 3 around pixel (80, 80), rows 6..8, columns 2..4 */
+  mop_mesh_set_edit_mode(m, MOP_EDIT_VERTEX);
+  TEST_ASSERT(select_rect(vp, m, 65, 65, 95, 95, MOP_SELECT_REPLACE,
+                          false) == 9);
+  const MopSelection *sel = mop_viewport_get_selection(vp);
+  TEST_ASSERT(sel->mode == MOP_EDIT_VERTEX && sel->mesh_object_id == 1);
+  TEST_ASSERT(element_selected(vp, 7 * 11 + 3));
+  TEST_ASSERT(!element_selected(vp, 5 * 11 + 3));
+
+  /* The hidden right half is skipped unless selecting through */
+  TEST_ASSERT(select_rect(vp, m, 116, 96, 146, 104, MOP_SELECT_REPLACE,
+                          false) == 0);
+  TEST_ASSERT(select_rect(vp, m, 116, 96, 146, 104, MOP_SELECT_REPLACE,
+                          true) == 3);
+
+  /* Edges: 2 x 1 cells, each split by one diagonal, hold 4 horizontal,
+   * 3 vertical and 2 diagonal edges */
+  mop_mesh_set_edit_mode(m, MOP_EDIT_EDGE);
+  TEST_ASSERT(select_rect(vp, m, 56, 56, 84, 74, MOP_SELECT_REPLACE,
+                          false) == 9);
+  TEST_ASSERT(sel->mode == MOP_EDIT_EDGE && sel->element_count == 9);
+  TEST_ASSERT(element_selected(vp, ((8u * 11 + 1) << 16) | (8 * 11 + 2)));
+
+  /* Faces: centroids of the 4 cells around pixel (70, 70), both
+   * triangles each; SUBTRACT one cell's row again */
+  mop_mesh_set_edit_mode(m, MOP_EDIT_FACE);
+  TEST_ASSERT(select_rect(vp, m, 60, 60, 80, 80, MOP_SELECT_REPLACE,
+                          false) == 8);
+  TEST_ASSERT(select_rect(vp, m, 60, 60, 80, 70, MOP_SELECT_SUBTRACT,
+                          false) == 4);
+  TEST_ASSERT(sel->element_count == 4);
+  TEST_ASSERT(select_rect(vp, m, 60, 60, 80, 70, MOP_SELECT_ADD, false) ==
+              4);
+  TEST_ASSERT(sel->element_count == 8);
+
+  mop_viewport_destroy(vp);
+  TEST_END();
+}
+
+static void test_100k_faces(void) {
+  TEST_BEGIN("100k_faces");
+  MopViewport *vp = make_viewport();
+  if (!vp)
+    MOP_TEST_SKIP("no CPU viewport");
+  /* 224 x 224 cells over pixels [44, 156): 100352 faces */
+  MopMesh *m = add_grid(vp, 224, 0.05f, 0, 0, 0, 1);
+  TEST_ASSERT(m != NULL);
+  mop_viewport_render(vp);
+  mop_mesh_set_edit_mode(m, MOP_EDIT_FACE);
+
+  uint32_t faces = m->index_count / 3;
+  TEST_ASSERT(select_rect(vp, m, 0, 0, 200, 200, MOP_SELECT_REPLACE,
+                          false) == faces);
+  const MopSelection *sel = mop_viewport_get_selection(vp);
+  TEST_ASSERT(sel->element_count == faces);
+  TEST_ASSERT(element_selected(vp, faces - 1));
+
+  /* Switching to vertices starts a fresh selection */
+  mop_mesh_set_edit_mode(m, MOP_EDIT_VERTEX);
+  TEST_ASSERT(select_rect(vp, m, 0, 0, 200, 200, MOP_SELECT_ADD, false) ==
+              m->vertex_count);
+  TEST_ASSERT(sel->element_count == m->vertex_count);
+
+  mop_viewport_destroy(vp);
+  TEST_END();
+}
+
+int main(void) {
+  TEST_SUITE_BEGIN("select_region");
+
+  TEST_RUN(test_id_set_stress);
+  TEST_RUN(test_objects_rect_and_lasso);
+  TEST_RUN(test_objects_through);
+  TEST_RUN(test_elements);
+  TEST_RUN(test_100k_faces);
+
+  TEST_REPORT();
+  TEST_EXIT();
+}
@@ -1,6 +1,7 @@
 /*
  * Master of Puppets — Shader Plugin Tests
  * test_shader_plugin.c — Phase 5A: Registration, dispatch, unregistration
+ *                        plus CPU vertex / fragment callbacks
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -8,6 +9,8 @@
 #include "test_harness.h"
 #include <mop/mop.h>
 #include <mop/render/shader_plugin.h>
+#include <stdlib.h>
+#include <string.h>
 
 static MopViewport *make_viewport(void) {
   MopViewportDesc desc = {
@@ -192,6 +195,175 @@ static void test_all_stages(void) {
   TEST_END();
 }
 
+/* ---- CPU shading callbacks ---- */
+
+typedef struct FalseColor {
+  float rgb[3];
+  float cut_x; /* discard pixels left of this world x */
+} FalseColor;
+
+static int s_frag_blocks = 0;
+static int s_frag_pixels = 0;
+static bool s_frag_block_ok = true;
+
+static void false_color_fn(MopShaderFragmentBlock *blk, const void *uniforms,
+                           void *user_data) {
+  (void)user_data;
+  const FalseColor *fc = uniforms;
+  s_frag_blocks++;
+  s_frag_pixels += (int)blk->count;
+  if (blk->count == 0 || blk->count > MOP_SHADER_BLOCK || !fc)
+    s_frag_block_ok = false;
+  for (uint32_t i = 0; i < blk->count; i++) {
+    if (blk->depth[i] < 0.0f || blk->depth[i] > 1.0f || blk->nz[i] < 0.99f)
+      s_frag_block_ok = false;
+    blk->out_r[i] = fc->rgb[0];
+    blk->out_g[i] = fc->rgb[1];
+    blk->out_b[i] = fc->rgb[2];
+    if (blk->px[i] < fc->cut_x)
+      blk->out_a[i] = 0.0f;
+  }
+}
+
+/* Pushes the surface out of view */
+static void push_away_fn(MopShaderVertexBlock *blk, const void *uniforms,
+                         void *user_data) {
+  (void)uniforms;
+  (void)user_data;
+  for (uint32_t i = 0; i < blk->count; i++)
+    blk->px[i] += 100.0f;
+}
+
+/* Quad facing the camera, filling the middle of the 64x64 view */
+static MopMesh *add_quad(MopViewport *vp) {
+  mop_viewport_set_chrome(vp, false);
+  mop_viewport_set_camera(vp, (MopVec3){0, 0, 3}, (MopVec3){0, 0, 0},
+                          (MopVec3){0, 1, 0}, 45.0f, 0.1f, 100.0f);
+  MopVertex v[4];
+  memset(v, 0, sizeof(v));
+  float pos[4][2] = {{-1, -1}, {1, -1}, {1, 1}, {-1, 1}};
+  for (int i = 0; i < 4; i++) {
+    v[i].position = (MopVec3){pos[i][0], pos[i][1], 0};
+    v[i].normal = (MopVec3){0, 0, 1};
+    v[i].color = (MopColor){1, 1, 1, 1};
+  }
+  uint32_t idx[6] = {0, 1, 2, 0, 2, 3};
+  return mop_viewport_add_mesh(vp, &(MopMeshDesc){.vertices = v,
+                                                  .vertex_count = 4,
+                                                  .indices = idx,
+                                                  .index_count = 6,
+                                                  .object_id = 7});
+}
+
+static const uint8_t *pixel(MopViewport *vp, int x, int y) {
+  int w, h;
+  const uint8_t *px = mop_viewport_read_color(vp, &w, &h);
+  return px + ((size_t)y * (size_t)w + (size_t)x) * 4;
+}
+
+static uint32_t id_at(MopViewport *vp, int x, int y) {
+  MopPickResult r = mop_viewport_pick(vp, x, y);
+  return r.hit ? r.object_id : 0;
+}
+
+static bool is_blue(const uint8_t *p) {
+  return p[2] > 200 && p[0] < 20 && p[1] < 20;
+}
+
+static void test_cpu_register_validation(void) {
+  TEST_BEGIN("cpu_register_validation");
+  MopViewport *vp = make_viewport();
+  MopMesh *mesh = add_quad(vp);
+
+  /* No callback at all */
+  MopShaderPluginDesc none = {.name = "none"};
+  TEST_ASSERT(mop_viewport_register_shader(vp, &none) == NULL);
+
+  /* CPU-only plugin needs no draw callback */
+  MopShaderPluginDesc frag = {.name = "frag", .cpu_fragment = false_color_fn};
+  MopShaderPlugin *p = mop_viewport_register_shader(vp, &frag);
+  TEST_ASSERT(p != NULL);
+
+  /* Draw-only plugins cannot be bound to meshes */
+  MopShaderPluginDesc draw = {.name = "draw", .draw = test_draw_fn};
+  MopShaderPlugin *d = mop_viewport_register_shader(vp, &draw);
+  TEST_ASSERT(!mop_mesh_set_shader_plugin(mesh, d, NULL, 0));
+
+  /* Uniform block size limit */
+  static unsigned char big[MOP_SHADER_UNIFORMS_MAX + 1];
+  TEST_ASSERT(!mop_mesh_set_shader_plugin(mesh, p, big, sizeof(big)));
+  TEST_ASSERT(mop_mesh_set_shader_plugin(mesh, p, big, sizeof(big) - 1));
+  TEST_ASSERT(mop_mesh_set_shader_plugin(mesh, NULL, NULL, 0));
+
+  mop_viewport_destroy(vp);
+  TEST_END();
+}
+
+static void test_cpu_fragment_false_color(void) {
+  TEST_BEGIN("cpu_fragment_false_color");
+  MopViewport *vp = make_viewport();
+  MopMesh *mesh = add_quad(vp);
+  MopShaderPlugin *p = mop_viewport_register_shader(
+      vp, &(MopShaderPluginDesc){.name = "false_color",
+                                 .cpu_fragment = false_color_fn});
+  TEST_ASSERT(p != NULL);
+
+  FalseColor fc = {{0.0f, 0.0f, 1.0f}, -10.0f};
+  TEST_ASSERT(mop_mesh_set_shader_plugin(mesh, p, &fc, sizeof(fc)));
+  s_frag_blocks = s_frag_pixels = 0;
+  s_frag_block_ok = true;
+  mop_viewport_render(vp);
+  TEST_ASSERT(s_frag_blocks > 0);
+  TEST_ASSERT(s_frag_block_ok);
+  TEST_ASSERT(s_frag_pixels >= s_frag_blocks);
+  TEST_ASSERT(is_blue(pixel(vp, 32, 32)));
+
+  /* Same callback in flat shading */
+  mop_viewport_set_shading(vp, MOP_SHADING_FLAT);
+  mop_viewport_render(vp);
+  TEST_ASSERT(is_blue(pixel(vp, 32, 32)));
+
+  /* Updated uniforms: discard the left half */
+  fc.cut_x = 0.0f;
+  TEST_ASSERT(mop_mesh_set_shader_plugin(mesh, p, &fc, sizeof(fc)));
+  mop_viewport_render(vp);
+  TEST_ASSERT(!is_blue(pixel(vp, 28, 32)));
+  TEST_ASSERT(is_blue(pixel(vp, 36, 32)));
+  TEST_ASSERT(id_at(vp, 28, 32) == 0);
+  TEST_ASSERT(id_at(vp, 36, 32) == 7);
+
+  /* Unregistering unbinds */
+  mop_viewport_unregister_shader(vp, p);
+  s_frag_blocks = 0;
+  mop_viewport_render(vp);
+  TEST_ASSERT(s_frag_blocks == 0);
+  TEST_ASSERT(!is_blue(pixel(vp, 36, 32)));
+
+  mop_viewport_destroy(vp);
+  TEST_END();
+}
+
+static void test_cpu_vertex_callback(void) {
+  TEST_BEGIN("cpu_vertex_callback");
+  MopViewport *vp = make_viewport();
+  MopMesh *mesh = add_quad(vp);
+  mop_viewport_render(vp);
+  TEST_ASSERT(id_at(vp, 32, 32) == 7);
+
+  MopShaderPlugin *p = mop_viewport_register_shader(
+      vp, &(MopShaderPluginDesc){.name = "push", .cpu_vertex = push_away_fn});
+  TEST_ASSERT(mop_mesh_set_shader_plugin(mesh, p, NULL, 0));
+  mop_viewport_render(vp);
+  TEST_ASSERT(id_at(vp, 32, 32) == 0);
+
+  TEST_ASSERT(mop_mesh_set_shader_plugin(mesh, NULL, NULL, 0));
+  mop_viewport_render(vp);
+  TEST_ASSERT(id_at(vp, 32, 32) == 7);
+
+  mop_viewport_destroy(vp);
+  TEST_END();
+}
+
 int main(void) {
   TEST_SUITE_BEGIN("shader_plugin");
 
@@ -203,6 +375,9 @@ int main(void) {
   TEST_RUN(test_plugin_invoked_on_render);
   TEST_RUN(test_multiple_plugins);
   TEST_RUN(test_all_stages);
+  TEST_RUN(test_cpu_register_validation);
+  TEST_RUN(test_cpu_fragment_false_color);
+  TEST_RUN(test_cpu_vertex_callback);
 
   TEST_REPORT();
   TEST_EXIT();
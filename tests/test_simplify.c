@@ -0,0 +1,253 @@
+/*
+ * Master of Puppets — Mesh simplification tests
+ * test_simplify.c — QEM edge collapse, seam/border locking, error
+ *                   budgets and automatic LOD generation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "test_harness.h"
+
+#include "core/viewport_internal.h"
+
+#include <math.h>
+#include <mop/mop.h>
+
+/* UV sphere: (rings + 1) * (segs + 1) vertices, UV seam along u = 0/1 */
+static uint32_t make_sphere(int rings, int segs, MopVertex **out_v,
+                            uint32_t **out_i, uint32_t *out_icount) {
+  uint32_t vcount = (uint32_t)((rings + 1) * (segs + 1));
+  MopVertex *v = calloc(vcount, sizeof(MopVertex));
+  uint32_t *idx = malloc((size_t)rings * segs * 6 * sizeof(uint32_t));
+  uint32_t n = 0;
+  for (int r = 0; r <= rings; r++) {
+    float phi = 3.14159265f * (float)r / (float)rings;
+    for (int s = 0; s <= segs; s++) {
+      float th = 2.0f * 3.14159265f * (float)s / (float)segs;
+      MopVec3 p = {sinf(phi) * cosf(th), cosf(phi), sinf(phi) * sinf(th)};
+      MopVertex *vx = &v[r * (segs + 1) + s];
+      vx->position = p;
+      vx->normal = p;
+      vx->color = (MopColor){1, 1, 1, 1};
+      vx->u = (float)s / (float)segs;
+      vx->v = (float)r / (float)rings;
+    }
+  }
+  for (int r = 0; r < rings; r++)
+    for (int s = 0; s < segs; s++) {
+      uint32_t a = (uint32_t)(r * (segs + 1) + s), b = a + (uint32_t)segs + 1;
+      if (r > 0) {
+        idx[n++] = a;
+        idx[n++] = a + 1;
+        idx[n++] = b;
+      }
+      if (r < rings - 1) {
+        idx[n++] = a + 1;
+        idx[n++] = b + 1;
+        idx[n++] = b;
+      }
+    }
+  *out_v = v;
+  *out_i = idx;
+  *out_icount = n;
+  return vcount;
+}
+
+/* Every triangle must still face away from the sphere center */
+static bool sphere_outward(const MopVertex *v, const uint32_t *idx,
+                           uint32_t count) {
+  for (uint32_t t = 0; t < count; t += 3) {
+    MopVec3 a = v[idx[t]].position, b = v[idx[t + 1]].position,
+            c = v[idx[t + 2]].position;
+    MopVec3 n = mop_vec3_cross(mop_vec3_sub(b, a), mop_vec3_sub(c, a));
+    MopVec3 m = {(a.x + b.x + c.x), (a.y + b.y + c.y), (a.z + b.z + c.z)};
+    if (mop_vec3_dot(n, m) <= 0.0f)
+      return false;
+  }
+  return true;
+}
+
+static void test_sphere_reaches_target(void) {
+  TEST_BEGIN("simplify: sphere reaches its triangle target");
+  MopVertex *v;
+  uint32_t *idx, icount;
+  uint32_t vcount = make_sphere(24, 48, &v, &idx, &icount);
+  uint32_t *out = malloc(icount * sizeof(uint32_t));
+  TEST_ASSERT(v && idx && out);
+
+  float err = -1.0f;
+  MopSimplifyDesc d = {.target_index_count = icount / 4};
+  uint32_t n = mop_mesh_simplify(v, vcount, idx, icount, &d, out, &err);
+  TEST_ASSERT(n > 0 && n <= icount / 4);
+  TEST_ASSERT(n % 3 == 0);
+  TEST_ASSERT(err > 0.0f && err < 0.05f);
+  for (uint32_t i = 0; i < n; i++)
+    TEST_ASSERT(out[i] < vcount);
+  TEST_ASSERT(sphere_outward(v, out, n));
+  free(out);
+  free(idx);
+  free(v);
+  TEST_END();
+}
+
+static void test_error_budget_stops(void) {
+  TEST_BEGIN("simplify: target error bounds the result");
+  MopVertex *v;
+  uint32_t *idx, icount;
+  uint32_t vcount = make_sphere(24, 48, &v, &idx, &icount);
+  uint32_t *out = malloc(icount * sizeof(uint32_t));
+  TEST_ASSERT(v && idx && out);
+
+  float err = 0.0f;
+  MopSimplifyDesc d = {.target_error = 0.002f};
+  uint32_t n = mop_mesh_simplify(v, vcount, idx, icount, &d, out, &err);
+  TEST_ASSERT(n > 0 && n < icount);
+  TEST_ASSERT(err <= 0.002f);
+
+  float err2 = 0.0f;
+  d.target_error = 0.02f;
+  uint32_t n2 = mop_mesh_simplify(v, vcount, idx, icount, &d, out, &err2);
+  TEST_ASSERT(n2 < n);
+  TEST_ASSERT(err2 <= 0.02f);
+  free(out);
+  free(idx);
+  free(v);
+  TEST_END();
+}
+
+static void test_flat_grid_lossless(void) {
+  TEST_BEGIN("simplify: flat grid collapses without error, border kept");
+  enum { N = 16 };
+  MopVertex v[(N + 1) * (N + 1)];
+  uint32_t idx[N * N * 6], out[N * N * 6];
+  uint32_t ic = 0;
+  for (int y = 0; y <= N; y++)
+    for (int x = 0; x <= N; x++)
+      v[y * (N + 1) + x] = (MopVertex){{(float)x, (float)y, 0},
+                                       {0, 0, 1},
+                                       {1, 1, 1, 1},
+                                       0,
+                                       0};
+  for (int y = 0; y < N; y++)
+    for (int x = 0; x < N; x++) {
+      uint32_t a = (uint32_t)(y * (N + 1) + x), b = a + N + 1;
+      uint32_t q[6] = {a, a + 1, b + 1, a, b + 1, b};
+      memcpy(idx + ic, q, sizeof(q));
+      ic += 6;
+    }
+
+  float err = 1.0f;
+  MopSimplifyDesc d = {.target_index_count = 6, .lock_border = true};
+  uint32_t n = mop_mesh_simplify(v, (N + 1) * (N + 1), idx, ic, &d, out, &err);
+  TEST_ASSERT(n > 0 && n < ic / 4);
+  TEST_ASSERT(err < 1e-4f);
+
+  /* Every border vertex is still referenced */
+  bool used[(N + 1) * (N + 1)] = {false};
+  for (uint32_t i = 0; i < n; i++)
+    used[out[i]] = true;
+  for (int i = 0; i <= N; i++) {
+    TEST_ASSERT(used[i]);
+    TEST_ASSERT(used[N * (N + 1) + i]);
+    TEST_ASSERT(used[i * (N + 1)]);
+    TEST_ASSERT(used[i * (N + 1) + N]);
+  }
+  TEST_END();
+}
+
+static void test_hard_edges_locked(void) {
+  TEST_BEGIN("simplify: split-normal cube keeps every corner");
+  /* 6 faces x 4 verts, each face with its own normal: all corners are
+   * attribute seams and must stay. */
+  static const float faces[6][3] = {{1, 0, 0},  {-1, 0, 0}, {0, 1, 0},
+                                    {0, -1, 0}, {0, 0, 1},  {0, 0, -1}};
+  MopVertex v[24];
+  uint32_t idx[36], out[36];
+  for (int f = 0; f < 6; f++) {
+    MopVec3 n = {faces[f][0], faces[f][1], faces[f][2]};
+    MopVec3 t = fabsf(n.x) > 0.5f ? (MopVec3){0, 1, 0} : (MopVec3){1, 0, 0};
+    MopVec3 b = mop_vec3_cross(n, t);
+    for (int k = 0; k < 4; k++) {
+      float su = (k == 1 || k == 2) ? 1.0f : -1.0f;
+      float sv = k >= 2 ? 1.0f : -1.0f;
+      v[f * 4 + k] = (MopVertex){
+          {n.x + su * t.x + sv * b.x, n.y + su * t.y + sv * b.y,
+           n.z + su * t.z + sv * b.z},
+          n,
+          {1, 1, 1, 1},
+          0,
+          0};
+    }
+    uint32_t q[6] = {0, 1, 2, 0, 2, 3};
+    for (int k = 0; k < 6; k++)
+      idx[f * 6 + k] = (uint32_t)(f * 4) + q[k];
+  }
+  MopSimplifyDesc d = {.target_index_count = 3};
+  uint32_t n = mop_mesh_simplify(v, 24, idx, 36, &d, out, NULL);
+  TEST_ASSERT(n == 36);
+  TEST_END();
+}
+
+static void test_generate_lods(void) {
+  TEST_BEGIN("simplify: generated LOD chain has descending thresholds");
+  MopViewportDesc vd = {
+      .width = 512, .height = 512, .backend = MOP_BACKEND_CPU};
+  MopViewport *vp = mop_viewport_create(&vd);
+  TEST_ASSERT(vp != NULL);
+
+  MopVertex *v;
+  uint32_t *idx, icount;
+  uint32_t vcount = make_sphere(32, 64, &v, &idx, &icount);
+  MopMesh *mesh = mop_viewport_add_mesh(
+      vp, &(MopMeshDesc){.vertices = v,
+                         .vertex_count = vcount,
+                         .indices = idx,
+                         .index_count = icount,
+                         .object_id = 1});
+  TEST_ASSERT(mesh != NULL);
+
+  int32_t added = mop_mesh_generate_lods(mesh, 4, 0.5f);
+  TEST_ASSERT(added >= 3);
+  TEST_ASSERT(mesh->lod_level_count == (uint32_t)added);
+  uint32_t prev_idx = icount;
+  float prev_thr = 1e30f;
+  for (int32_t i = 0; i < added; i++) {
+    TEST_ASSERT(mesh->lod_levels[i].index_count < prev_idx);
+    TEST_ASSERT(mesh->lod_levels[i].vertex_count <= vcount);
+    TEST_ASSERT(mesh->lod_levels[i].screen_threshold < prev_thr);
+    prev_idx = mesh->lod_levels[i].index_count;
+    prev_thr = mesh->lod_levels[i].screen_threshold;
+  }
+
+  /* Near: full detail.  Far away: a coarse level. */
+  mop_viewport_set_camera(vp, (MopVec3){0, 0, 3}, (MopVec3){0, 0, 0},
+                          (MopVec3){0, 1, 0}, 60.0f, 0.1f, 1000.0f);
+  TEST_ASSERT(mop_viewport_render(vp) == MOP_RENDER_OK);
+  TEST_ASSERT(mesh->active_lod == 0);
+  mop_viewport_set_camera(vp, (MopVec3){0, 0, 400}, (MopVec3){0, 0, 0},
+                          (MopVec3){0, 1, 0}, 60.0f, 0.1f, 1000.0f);
+  TEST_ASSERT(mop_viewport_render(vp) == MOP_RENDER_OK);
+  TEST_ASSERT(mesh->active_lod == mesh->lod_level_count);
+
+  TEST_ASSERT(mop_mesh_generate_lods(mesh, 2, 0.0f) == -1);
+  TEST_ASSERT(mop_mesh_generate_lods(mesh, 2, 0.25f) >= 1);
+  TEST_ASSERT(mesh->lod_level_count <= 2);
+
+  free(idx);
+  free(v);
+  mop_viewport_destroy(vp);
+  TEST_END();
+}
+
+int main(void) {
+  TEST_SUITE_BEGIN("simplify");
+
+  TEST_RUN(test_sphere_reaches_target);
+  TEST_RUN(test_error_budget_stops);
+  TEST_RUN(test_flat_grid_lossless);
+  TEST_RUN(test_hard_edges_locked);
+  TEST_RUN(test_generate_lods);
+
+  TEST_REPORT();
+  TEST_EXIT();
+}
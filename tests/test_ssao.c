@@ -0,0 +1,199 @@
+/*
+ * Master of Puppets — CPU SSAO tests
+ * test_ssao.c — Ambient occlusion from the software depth buffer
+ *
+ * Tests validate:
+ *   - The crease where a box meets a wall darkens with MOP_POST_SSAO
+ *   - Open, unoccluded surfaces (wall far from the box, the box's front
+ *     face) and the background stay unchanged
+ *   - Without SSAA (scale 2 instead of 4) the result is the same
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "test_harness.h"
+
+#include <math.h>
+#include <mop/mop.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define VP_SIZE 128
+
+typedef struct Geo {
+  MopVertex v[64];
+  uint32_t idx[96];
+  uint32_t vc, ic;
+} Geo;
+
+/* Quad p0..p3, wound so its front faces along n */
+static void geo_quad(Geo *g, MopVec3 p0, MopVec3 p1, MopVec3 p2, MopVec3 p3,
+                     MopVec3 n) {
+  MopVec3 p[4] = {p0, p1, p2, p3};
+  uint32_t b = g->vc;
+  for (int i = 0; i < 4; i++) {
+    MopVertex *v = &g->v[g->vc++];
+    memset(v, 0, sizeof(*v));
+    v->position = p[i];
+    v->normal = n;
+    v->color = (MopColor){0.7f, 0.7f, 0.7f, 1.0f};
+  }
+  MopVec3 f = mop_vec3_cross(mop_vec3_sub(p1, p0), mop_vec3_sub(p2, p0));
+  static const uint32_t ccw[6] = {0, 1, 2, 0, 2, 3}, cw[6] = {0, 2, 1, 0, 3, 2};
+  const uint32_t *o = mop_vec3_dot(f, n) >= 0.0f ? ccw : cw;
+  for (int i = 0; i < 6; i++)
+    g->idx[g->ic++] = b + o[i];
+}
+
+/* Wall at z = 0 and a unit box in front of it, touching it */
+static MopViewport *make_scene(int ssaa, uint32_t effects) {
+  MopViewport *vp = mop_viewport_create(&(MopViewportDesc){
+      .width = VP_SIZE,
+      .height = VP_SIZE,
+      .backend = MOP_BACKEND_CPU,
+      .ssaa_factor = ssaa});
+  if (!vp)
+    return NULL;
+  mop_viewport_set_post_effects(vp, effects);
+  mop_viewport_set_camera(vp, (MopVec3){1.5f, 1, 3}, (MopVec3){0, 0, 0.5f},
+                          (MopVec3){0, 1, 0}, 45.0f, 0.1f, 100.0f);
+
+  static Geo wall, box;
+  memset(&wall, 0, sizeof(wall));
+  memset(&box, 0, sizeof(box));
+  geo_quad(&wall, (MopVec3){-4, -4, 0}, (MopVec3){4, -4, 0},
+           (MopVec3){4, 4, 0}, (MopVec3){-4, 4, 0}, (MopVec3){0, 0, 1});
+
+  float h = 0.5f;
+  MopVec3 c[8] = {{-h, -h, 0}, {h, -h, 0}, {h, h, 0}, {-h, h, 0},
+                  {-h, -h, 1}, {h, -h, 1}, {h, h, 1}, {-h, h, 1}};
+  geo_quad(&box, c[4], c[5], c[6], c[7], (MopVec3){0, 0, 1});
+  geo_quad(&box, c[1], c[2], c[6], c[5], (MopVec3){1, 0, 0});
+  geo_quad(&box, c[0], c[3], c[7], c[4], (MopVec3){-1, 0, 0});
+  geo_quad(&box, c[3], c[2], c[6], c[7], (MopVec3){0, 1, 0});
+  geo_quad(&box, c[0], c[1], c[5], c[4], (MopVec3){0, -1, 0});
+
+  mop_viewport_add_mesh(vp, &(MopMeshDesc){.vertices = wall.v,
+                                           .vertex_count = wall.vc,
+                                           .indices = wall.idx,
+                                           .index_count = wall.ic,
+                                           .object_id = 1});
+  mop_viewport_add_mesh(vp, &(MopMeshDesc){.vertices = box.v,
+                                           .vertex_count = box.vc,
+                                           .indices = box.idx,
+                                           .index_count = box.ic,
+                                           .object_id = 2});
+  return vp;
+}
+
+static uint8_t *render_copy(MopViewport *vp) {
+  int w = 0, h = 0;
+  mop_viewport_render(vp);
+  const uint8_t *px = mop_viewport_read_color(vp, &w, &h);
+  uint8_t *copy = malloc((size_t)w * h * 4);
+  memcpy(copy, px, (size_t)w * h * 4);
+  return copy;
+}
+
+/* Mean red channel over a rectangle [x0, x1) x [y0, y1) */
+static float mean_red(const uint8_t *px, int x0, int y0, int x1, int y1) {
+  float sum = 0.0f;
+  for (int y = y0; y < y1; y++)
+    for (int x = x0; x < x1; x++)
+      sum += px[((size_t)y * VP_SIZE + x) * 4];
+  return sum / (float)((x1 - x0) * (y1 - y0));
+}
+
+static int max_diff(const uint8_t *a, const uint8_t *b, int x0, int y0,
+                    int x1, int y1) {
+  int m = 0;
+  for (int y = y0; y < y1; y++)
+    for (int x = x0; x < x1; x++) {
+      size_t i = ((size_t)y * VP_SIZE + x) * 4;
+      for (int k = 0; k < 3; k++) {
+        int d = abs((int)a[i + k] - (int)b[i + k]);
+        m = d > m ? d : m;
+      }
+    }
+  return m;
+}
+
+typedef struct SceneResult {
+  bool ok;
+  float crease_off, crease_on; /* mean red next to the box */
+  int corner_diff, face_diff;  /* max channel change, unoccluded areas */
+} SceneResult;
+
+/* Seen from the upper right, the box's +x side meets the wall in a
+ * vertical crease around x = 94..100; the top-left corner of the frame
+ * is open wall and the box's front face is unoccluded */
+static SceneResult run_scene(int ssaa) {
+  SceneResult r = {0};
+  MopViewport *a = make_scene(ssaa, 0);
+  MopViewport *b = make_scene(ssaa, MOP_POST_SSAO);
+  if (a && b) {
+    uint8_t *off = render_copy(a);
+    uint8_t *on = render_copy(b);
+    r.ok = true;
+    r.crease_off = mean_red(off, 94, 52, 100, 78);
+    r.crease_on = mean_red(on, 94, 52, 100, 78);
+    r.corner_diff = max_diff(off, on, 0, 0, 16, 16);
+    r.face_diff = max_diff(off, on, 40, 60, 70, 90);
+    free(off);
+    free(on);
+  }
+  mop_viewport_destroy(a);
+  mop_viewport_destroy(b);
+  return r;
+}
+
+static void test_crease_darkens(void) {
+  TEST_BEGIN("ssao: box against a wall darkens the crease only");
+  SceneResult r = run_scene(2);
+  TEST_ASSERT(r.ok);
+  TEST_ASSERT(r.crease_on < r.crease_off * 0.95f);
+  TEST_ASSERT(r.corner_diff <= 2);
+  TEST_ASSERT(r.face_diff <= 2);
+  TEST_END();
+}
+
+static void test_without_ssaa(void) {
+  TEST_BEGIN("ssao: same result without supersampling");
+  SceneResult r = run_scene(1);
+  TEST_ASSERT(r.ok);
+  TEST_ASSERT(r.crease_on < r.crease_off * 0.95f);
+  TEST_ASSERT(r.corner_diff <= 2);
+  TEST_ASSERT(r.face_diff <= 2);
+  TEST_END();
+}
+
+static void test_empty_frame(void) {
+  TEST_BEGIN("ssao: background-only frame is untouched");
+  MopViewport *a = mop_viewport_create(&(MopViewportDesc){
+      .width = 64, .height = 48, .backend = MOP_BACKEND_CPU});
+  MopViewport *b = mop_viewport_create(&(MopViewportDesc){
+      .width = 64, .height = 48, .backend = MOP_BACKEND_CPU});
+  TEST_ASSERT(a && b);
+  mop_viewport_set_post_effects(a, 0);
+  mop_viewport_set_post_effects(b, MOP_POST_SSAO);
+  int w = 0, h = 0;
+  mop_viewport_render(a);
+  mop_viewport_render(b);
+  const uint8_t *pa = mop_viewport_read_color(a, &w, &h);
+  const uint8_t *pb = mop_viewport_read_color(b, &w, &h);
+  TEST_ASSERT(memcmp(pa, pb, (size_t)w * h * 4) == 0);
+  mop_viewport_destroy(a);
+  mop_viewport_destroy(b);
+  TEST_END();
+}
+
+int main(void) {
+  TEST_SUITE_BEGIN("ssao");
+
+  TEST_RUN(test_crease_darkens);
+  TEST_RUN(test_without_ssaa);
+  TEST_RUN(test_empty_frame);
+
+  TEST_REPORT();
+  TEST_EXIT();
+}
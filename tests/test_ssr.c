@@ -3,7 +3,7 @@
  * test_ssr.c — Phase 4B: Screen-Space Reflections
  *
  * Tests SSR flag, public API, push constant layout, shader math,
- * and Vulkan struct layout.
+ * the CPU pass, and Vulkan struct layout.
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -12,6 +12,7 @@
 #include <math.h>
 #include <mop/mop.h>
 #include <mop/render/postprocess.h>
+#include <stdlib.h>
 #include <string.h>
 
 /* Access internal viewport struct for SSR state verification */
@@ -253,6 +254,142 @@ static void test_ssr_edge_fade_border(void) {
   TEST_END();
 }
 
+/* -------------------------------------------------------------------------
+ * CPU backend: red wall standing on a grey floor
+ * ------------------------------------------------------------------------- */
+
+static void add_quad(MopViewport *vp, const MopVec3 p[4], MopVec3 n,
+                     MopColor c, uint32_t id) {
+  MopVertex v[4];
+  memset(v, 0, sizeof(v));
+  for (int i = 0; i < 4; i++) {
+    v[i].position = p[i];
+    v[i].normal = n;
+    v[i].color = c;
+  }
+  uint32_t idx[6] = {0, 1, 2, 0, 2, 3};
+  mop_viewport_add_mesh(vp, &(MopMeshDesc){.vertices = v,
+                                           .vertex_count = 4,
+                                           .indices = idx,
+                                           .index_count = 6,
+                                           .object_id = id});
+}
+
+static MopViewport *make_scene(int w, int h, int ssaa, uint32_t effects,
+                               float intensity) {
+  MopViewport *vp = mop_viewport_create(&(MopViewportDesc){
+      .width = w,
+      .height = h,
+      .backend = MOP_BACKEND_CPU,
+      .ssaa_factor = ssaa});
+  if (!vp)
+    return NULL;
+  mop_viewport_set_post_effects(vp, effects);
+  mop_viewport_set_ssr(vp, intensity);
+  mop_viewport_set_chrome(vp, false);
+  mop_viewport_set_camera(vp, (MopVec3){0, 2, 6}, (MopVec3){0, 0.5f, 0},
+                          (MopVec3){0, 1, 0}, 50.0f, 0.1f, 100.0f);
+  const MopVec3 ground[4] = {{-5, 0, 5}, {5, 0, 5}, {5, 0, -5}, {-5, 0, -5}};
+  const MopVec3 wall[4] = {{-1, 0, 0}, {1, 0, 0}, {1, 2, 0}, {-1, 2, 0}};
+  add_quad(vp, ground, (MopVec3){0, 1, 0}, (MopColor){0.3f, 0.3f, 0.3f, 1},
+           1);
+  add_quad(vp, wall, (MopVec3){0, 0, 1}, (MopColor){1, 0.1f, 0.1f, 1}, 2);
+  return vp;
+}
+
+static uint8_t *render_copy(MopViewport *vp, int *w, int *h) {
+  mop_viewport_render(vp);
+  const uint8_t *px = mop_viewport_read_color(vp, w, h);
+  uint8_t *copy = malloc((size_t)*w * *h * 4);
+  memcpy(copy, px, (size_t)*w * *h * 4);
+  return copy;
+}
+
+typedef struct MirrorResult {
+  bool ok;
+  int below_off[3], below_on[3]; /* floor just in front of the wall */
+  int side_diff;                 /* max change on the floor beside it */
+  int bg_diff;                   /* max change on background pixels */
+} MirrorResult;
+
+/* The wall covers the middle fifth of the width, its foot at 58% of the
+ * height; its reflection lies below that on the floor */
+static MirrorResult run_mirror(int w, int h, int ssaa, float intensity) {
+  MirrorResult r = {0};
+  MopViewport *a = make_scene(w, h, ssaa, 0, intensity);
+  MopViewport *b = make_scene(w, h, ssaa, MOP_POST_SSR, intensity);
+  if (a && b) {
+    int ow, oh;
+    uint8_t *off = render_copy(a, &ow, &oh);
+    uint8_t *on = render_copy(b, &ow, &oh);
+    size_t below = ((size_t)(oh * 70 / 100) * ow + ow / 2) * 4;
+    r.ok = true;
+    for (int k = 0; k < 3; k++) {
+      r.below_off[k] = off[below + k];
+      r.below_on[k] = on[below + k];
+    }
+    for (int y = oh * 60 / 100; y < oh; y++)
+      for (int x = 0; x < ow / 8; x++) {
+        size_t i = ((size_t)y * ow + x) * 4;
+        int d = abs((int)on[i] - (int)off[i]);
+        r.side_diff = d > r.side_diff ? d : r.side_diff;
+      }
+    for (int i = 0; i < ow * oh; i++) {
+      if (mop_viewport_pick(b, i % ow, i / ow).hit)
+        continue;
+      for (int k = 0; k < 3; k++) {
+        int d = abs((int)on[i * 4 + k] - (int)off[i * 4 + k]);
+        r.bg_diff = d > r.bg_diff ? d : r.bg_diff;
+      }
+    }
+    free(off);
+    free(on);
+  }
+  mop_viewport_destroy(a);
+  mop_viewport_destroy(b);
+  return r;
+}
+
+static void test_ssr_cpu_reflects(void) {
+  TEST_BEGIN("ssr_cpu_reflects");
+  MirrorResult r = run_mirror(160, 120, 1, 0.8f);
+  TEST_ASSERT(r.ok);
+  /* The floor in front of the wall picks up its red */
+  TEST_ASSERT(r.below_on[0] > r.below_off[0] + 10);
+  TEST_ASSERT(r.below_on[0] - r.below_off[0] >
+              2 * (r.below_on[1] - r.below_off[1]));
+  /* Rays from the floor beside the wall leave the screen: no change */
+  TEST_ASSERT(r.side_diff <= 1);
+  TEST_ASSERT(r.bg_diff == 0);
+  TEST_END();
+}
+
+static void test_ssr_cpu_odd_size_ssaa(void) {
+  TEST_BEGIN("ssr_cpu_odd_size_ssaa");
+  MirrorResult r = run_mirror(101, 77, 2, 0.8f);
+  TEST_ASSERT(r.ok);
+  TEST_ASSERT(r.below_on[0] > r.below_off[0] + 10);
+  TEST_ASSERT(r.side_diff <= 1);
+  TEST_ASSERT(r.bg_diff == 0);
+  TEST_END();
+}
+
+static void test_ssr_cpu_zero_intensity(void) {
+  TEST_BEGIN("ssr_cpu_zero_intensity");
+  MopViewport *a = make_scene(96, 72, 1, 0, 0.0f);
+  MopViewport *b = make_scene(96, 72, 1, MOP_POST_SSR, 0.0f);
+  TEST_ASSERT(a && b);
+  int w, h;
+  uint8_t *off = render_copy(a, &w, &h);
+  uint8_t *on = render_copy(b, &w, &h);
+  TEST_ASSERT(memcmp(off, on, (size_t)w * h * 4) == 0);
+  free(off);
+  free(on);
+  mop_viewport_destroy(a);
+  mop_viewport_destroy(b);
+  TEST_END();
+}
+
 /* -------------------------------------------------------------------------
  * Vulkan struct layout (conditional)
  * ------------------------------------------------------------------------- */
@@ -311,6 +448,11 @@ int main(void) {
   test_ssr_edge_fade_center();
   test_ssr_edge_fade_border();
 
+  /* CPU backend */
+  test_ssr_cpu_reflects();
+  test_ssr_cpu_odd_size_ssaa();
+  test_ssr_cpu_zero_intensity();
+
 #if defined(MOP_HAS_VULKAN)
   /* Vulkan struct tests */
   test_ssr_device_fields();
@@ -0,0 +1,339 @@
+/*
+ * Master of Puppets — Texture cache tests
+ * test_texture_cache.c — Hashed path lookup, content dedup and the
+ *                        process-wide content-addressed texture store
+ *
+ * PNGs are synthesized with stb_image_write into a scratch directory.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "test_harness.h"
+
+#include "core/texture_store.h"
+#include "core/viewport_internal.h"
+#include "stb_image_write.h"
+
+#include <fcntl.h>
+#include <mop/mop.h>
+#include <sys/stat.h>
+#include <time.h>
+
+static char s_scratch[256];
+
+static MopViewport *make_viewport(void) {
+  MopViewportDesc desc = {
+      .width = 32, .height = 32, .backend = MOP_BACKEND_CPU};
+  return mop_viewport_create(&desc);
+}
+
+/* Write a w x h PNG filled with a pattern derived from `seed`. */
+static bool write_png(const char *name, int w, int h, uint8_t seed,
+                      uint8_t *out_first_px) {
+  char path[320];
+  snprintf(path, sizeof(path), "%s/%s", s_scratch, name);
+  uint8_t *px = malloc((size_t)w * h * 4);
+  if (!px)
+    return false;
+  for (int i = 0; i < w * h; i++) {
+    px[i * 4 + 0] = (uint8_t)(seed + i);
+    px[i * 4 + 1] = (uint8_t)(seed * 3);
+    px[i * 4 + 2] = (uint8_t)(i * 7);
+    px[i * 4 + 3] = 255;
+  }
+  if (out_first_px)
+    memcpy(out_first_px, px, 4);
+  int ok = stbi_write_png(path, w, h, 4, px, w * 4);
+  free(px);
+  return ok != 0;
+}
+
+static void test_path_normalization(void) {
+  TEST_BEGIN("tex cache: equivalent path spellings hit one entry");
+  TEST_ASSERT(write_png("norm.png", 4, 4, 1, NULL));
+  char sub[320];
+  snprintf(sub, sizeof(sub), "%s/sub", s_scratch);
+  mkdir(sub, 0700);
+
+  MopViewport *vp = make_viewport();
+  TEST_ASSERT(vp != NULL);
+
+  char p0[320], p1[320], p2[320];
+  snprintf(p0, sizeof(p0), "%s/norm.png", s_scratch);
+  snprintf(p1, sizeof(p1), "%s//./norm.png", s_scratch);
+  snprintf(p2, sizeof(p2), "%s/sub/../norm.png", s_scratch);
+
+  MopTexture *a = mop_tex_load_async(vp, p0);
+  TEST_ASSERT(a != NULL);
+  MopTexture *b = mop_tex_load_async(vp, p1);
+  MopTexture *c = mop_tex_load_async(vp, p2);
+  TEST_ASSERT(a == b);
+  TEST_ASSERT(a == c);
+
+  MopTexCacheStats st = mop_tex_cache_stats(vp);
+  TEST_ASSERT(st.total_textures == 1);
+  TEST_ASSERT(st.cache_hits == 2);
+
+  mop_viewport_destroy(vp);
+  TEST_END();
+}
+
+static void test_content_dedup_aliases(void) {
+  TEST_BEGIN("tex cache: identical pixels under two paths share a texture");
+  TEST_ASSERT(write_png("same_a.png", 8, 8, 9, NULL));
+  TEST_ASSERT(write_png("same_b.png", 8, 8, 9, NULL));
+  TEST_ASSERT(write_png("other.png", 8, 8, 10, NULL));
+
+  MopViewport *vp = make_viewport();
+  TEST_ASSERT(vp != NULL);
+  char pa[320], pb[320], po[320];
+  snprintf(pa, sizeof(pa), "%s/same_a.png", s_scratch);
+  snprintf(pb, sizeof(pb), "%s/same_b.png", s_scratch);
+  snprintf(po, sizeof(po), "%s/other.png", s_scratch);
+
+  MopTexture *a = mop_tex_load_async(vp, pa);
+  MopTexture *b = mop_tex_load_async(vp, pb);
+  MopTexture *o = mop_tex_load_async(vp, po);
+  TEST_ASSERT(a != NULL && o != NULL);
+  TEST_ASSERT(a == b);
+  TEST_ASSERT(a != o);
+
+  MopTexCacheStats st = mop_tex_cache_stats(vp);
+  TEST_ASSERT(st.total_textures == 3);
+  TEST_ASSERT(st.unique_textures == 2);
+  TEST_ASSERT(a->cache_refs == 2 && o->cache_refs == 1);
+
+  /* Aliases age together; eviction must release the texture once */
+  vp->frame_counter += 10;
+  mop_tex_cache_flush(vp, 1);
+  st = mop_tex_cache_stats(vp);
+  TEST_ASSERT(st.total_textures == 0);
+  TEST_ASSERT(mop_tex_load_async(vp, pb) != NULL);
+
+  mop_viewport_destroy(vp);
+  TEST_END();
+}
+
+static void test_store_shared_across_viewports(void) {
+  TEST_BEGIN("tex store: viewports share one copy of decoded pixels");
+  uint8_t first[4];
+  TEST_ASSERT(write_png("shared.png", 16, 16, 42, first));
+  char path[320];
+  snprintf(path, sizeof(path), "%s/shared.png", s_scratch);
+
+  uint32_t blobs_before;
+  mop_tex_store_usage(&blobs_before, NULL, NULL);
+
+  MopViewport *v1 = make_viewport();
+  MopViewport *v2 = make_viewport();
+  TEST_ASSERT(v1 != NULL && v2 != NULL);
+  MopTexture *t1 = mop_tex_load_async(v1, path);
+  MopTexture *t2 = mop_tex_load_async(v2, path);
+  TEST_ASSERT(t1 != NULL && t2 != NULL);
+  TEST_ASSERT(t1 != t2);
+  TEST_ASSERT(t1->blob != NULL && t1->blob == t2->blob);
+  TEST_ASSERT(t1->content_hash == t2->content_hash);
+
+  /* Explicit creation from the same pixels lands in the same blob */
+  uint8_t *px = malloc(16 * 16 * 4);
+  TEST_ASSERT(px != NULL);
+  memcpy(px, t1->blob->pixels, 16 * 16 * 4);
+  MopTexture *t3 = mop_tex_create(
+      v2, &(MopTextureDesc){.width = 16,
+                            .height = 16,
+                            .format = MOP_TEX_FORMAT_RGBA8,
+                            .data = px,
+                            .data_size = 16 * 16 * 4});
+  free(px);
+  TEST_ASSERT(t3 != NULL && t3->blob == t1->blob);
+
+  uint32_t blobs;
+  mop_tex_store_usage(&blobs, NULL, NULL);
+  TEST_ASSERT(blobs == blobs_before + 1);
+
+  /* Readback goes through the borrowed pixels */
+  uint8_t *rb = malloc(16 * 16 * 4);
+  TEST_ASSERT(rb != NULL);
+  TEST_ASSERT(mop_tex_read_rgba8(v2, t3, rb, 16 * 16 * 4));
+  TEST_ASSERT(memcmp(rb, first, 4) == 0);
+  free(rb);
+
+  mop_viewport_destroy_texture(v2, t3);
+  mop_viewport_destroy(v1);
+  mop_tex_store_usage(&blobs, NULL, NULL);
+  TEST_ASSERT(blobs == blobs_before + 1);
+  mop_viewport_destroy(v2);
+  mop_tex_store_usage(&blobs, NULL, NULL);
+  TEST_ASSERT(blobs == blobs_before);
+  TEST_END();
+}
+
+static void test_render_target_detaches(void) {
+  TEST_BEGIN("tex store: rendering into a shared texture leaves the blob");
+  uint8_t first[4];
+  TEST_ASSERT(write_png("target.png", 16, 16, 77, first));
+  char path[320];
+  snprintf(path, sizeof(path), "%s/target.png", s_scratch);
+
+  MopViewport *v1 = make_viewport();
+  MopViewport *v2 = make_viewport();
+  TEST_ASSERT(v1 != NULL && v2 != NULL);
+  MopTexture *t1 = mop_tex_load_async(v1, path);
+  MopTexture *t2 = mop_tex_load_async(v2, path);
+  TEST_ASSERT(t1 != NULL && t2 != NULL && t1->blob == t2->blob);
+
+  MopViewport *rt = mop_viewport_create(&(MopViewportDesc){
+      .width = 16,
+      .height = 16,
+      .backend = MOP_BACKEND_CPU,
+      .render_target = t1});
+  TEST_ASSERT(rt != NULL);
+  mop_viewport_set_clear_color(rt, (MopColor){0, 1, 0, 1});
+  mop_viewport_render(rt);
+
+  /* The other viewport still samples the original pixels */
+  uint8_t rb[16 * 16 * 4];
+  TEST_ASSERT(mop_tex_read_rgba8(v2, t2, rb, sizeof(rb)));
+  TEST_ASSERT(memcmp(rb, first, 4) == 0);
+  TEST_ASSERT(memcmp(t1->blob->pixels, first, 4) == 0);
+  /* ... and the render target got the frame */
+  TEST_ASSERT(mop_tex_read_rgba8(v1, t1, rb, sizeof(rb)));
+  TEST_ASSERT(memcmp(rb, first, 4) != 0);
+
+  mop_viewport_destroy(rt);
+  mop_viewport_destroy(v1);
+  mop_viewport_destroy(v2);
+  TEST_END();
+}
+
+static void test_store_hash_collision(void) {
+  TEST_BEGIN("tex store: equal hashes with different pixels stay apart");
+  uint8_t a[16], b[16], a2[16];
+  for (int i = 0; i < 16; i++) {
+    a[i] = (uint8_t)i;
+    b[i] = (uint8_t)(255 - i);
+  }
+  memcpy(a2, a, sizeof(a));
+  uint32_t blobs_before, blobs;
+  mop_tex_store_usage(&blobs_before, NULL, NULL);
+
+  /* Same claimed hash and size: only the pixels tell them apart */
+  const uint64_t hash = 0x5eed;
+  MopTexBlob *ba = mop_tex_store_acquire(a, 2, 2, hash);
+  MopTexBlob *bb = mop_tex_store_acquire(b, 2, 2, hash);
+  MopTexBlob *ba2 = mop_tex_store_acquire(a2, 2, 2, hash);
+  TEST_ASSERT(ba != NULL && bb != NULL && ba != bb && ba2 == ba);
+  TEST_ASSERT(memcmp(ba->pixels, a, sizeof(a)) == 0);
+  TEST_ASSERT(memcmp(bb->pixels, b, sizeof(b)) == 0);
+  mop_tex_store_usage(&blobs, NULL, NULL);
+  TEST_ASSERT(blobs == blobs_before + 2);
+
+  /* Freeing the first of the run must keep the second reachable */
+  mop_tex_store_release(ba);
+  mop_tex_store_release(ba2);
+  TEST_ASSERT(mop_tex_store_acquire(b, 2, 2, hash) == bb);
+  mop_tex_store_release(bb);
+  mop_tex_store_release(bb);
+  mop_tex_store_usage(&blobs, NULL, NULL);
+  TEST_ASSERT(blobs == blobs_before);
+  TEST_END();
+}
+
+/* Write a 4x4 BMP (fixed file size) of one color and stamp its mtime */
+static bool write_bmp_at(const char *path, uint8_t shade, time_t sec,
+                         long nsec) {
+  uint8_t px[4 * 4 * 4];
+  for (int i = 0; i < 16; i++) {
+    px[i * 4 + 0] = shade;
+    px[i * 4 + 1] = (uint8_t)(shade / 2);
+    px[i * 4 + 2] = 9;
+    px[i * 4 + 3] = 255;
+  }
+  if (!stbi_write_bmp(path, 4, 4, 4, px))
+    return false;
+  struct timespec ts[2] = {{sec, nsec}, {sec, nsec}};
+  return utimensat(AT_FDCWD, path, ts, 0) == 0;
+}
+
+static void test_path_records(void) {
+  TEST_BEGIN("tex store: path records track rewrites and die with blobs");
+  char path[320];
+  snprintf(path, sizeof(path), "%s/rewrite.bmp", s_scratch);
+  uint32_t paths_before, paths;
+  mop_tex_store_usage(NULL, NULL, &paths_before);
+
+  time_t sec = time(NULL);
+  TEST_ASSERT(write_bmp_at(path, 40, sec, 100));
+  MopViewport *v1 = make_viewport();
+  TEST_ASSERT(v1 != NULL);
+  MopTexture *t1 = mop_tex_load_async(v1, path);
+  TEST_ASSERT(t1 != NULL && t1->blob != NULL);
+  mop_tex_store_usage(NULL, NULL, &paths);
+  TEST_ASSERT(paths == paths_before + 1);
+
+  /* Same size, same second: only the nanoseconds differ */
+  struct stat st;
+  TEST_ASSERT(stat(path, &st) == 0);
+  off_t size = st.st_size;
+  TEST_ASSERT(write_bmp_at(path, 200, sec, 200));
+  TEST_ASSERT(stat(path, &st) == 0 && st.st_size == size);
+  MopViewport *v2 = make_viewport();
+  TEST_ASSERT(v2 != NULL);
+  MopTexture *t2 = mop_tex_load_async(v2, path);
+  TEST_ASSERT(t2 != NULL && t2->blob != NULL && t2->blob != t1->blob);
+  TEST_ASSERT(t2->blob->pixels[0] == 200 && t1->blob->pixels[0] == 40);
+  mop_tex_store_usage(NULL, NULL, &paths);
+  TEST_ASSERT(paths == paths_before + 1);
+
+  /* The record now names v2's blob and goes away with it */
+  mop_viewport_destroy(v2);
+  mop_tex_store_usage(NULL, NULL, &paths);
+  TEST_ASSERT(paths == paths_before);
+  mop_viewport_destroy(v1);
+  TEST_END();
+}
+
+static void test_many_textures(void) {
+  TEST_BEGIN("tex cache: index survives growth across many entries");
+  enum { N = 96 };
+  MopViewport *vp = make_viewport();
+  TEST_ASSERT(vp != NULL);
+  MopTexture *tex[N];
+  for (int i = 0; i < N; i++) {
+    char name[64], path[320];
+    snprintf(name, sizeof(name), "many_%d.png", i);
+    TEST_ASSERT(write_png(name, 2, 2, (uint8_t)(i * 2 + 100), NULL));
+    snprintf(path, sizeof(path), "%s/%s", s_scratch, name);
+    tex[i] = mop_tex_load_async(vp, path);
+    TEST_ASSERT(tex[i] != NULL);
+  }
+  for (int i = 0; i < N; i++) {
+    char path[320];
+    snprintf(path, sizeof(path), "%s/many_%d.png", s_scratch, i);
+    TEST_ASSERT(mop_tex_load_async(vp, path) == tex[i]);
+  }
+  MopTexCacheStats st = mop_tex_cache_stats(vp);
+  TEST_ASSERT(st.total_textures == N);
+  TEST_ASSERT(st.cache_hits == N);
+  mop_viewport_destroy(vp);
+  TEST_END();
+}
+
+int main(void) {
+  snprintf(s_scratch, sizeof(s_scratch), "/tmp/mop_test_texcache_XXXXXX");
+  if (!mkdtemp(s_scratch))
+    MOP_TEST_SKIP("tex cache: mkdtemp failed, skipping\n");
+
+  TEST_SUITE_BEGIN("texture_cache");
+
+  TEST_RUN(test_path_normalization);
+  TEST_RUN(test_content_dedup_aliases);
+  TEST_RUN(test_store_shared_across_viewports);
+  TEST_RUN(test_render_target_detaches);
+  TEST_RUN(test_store_hash_collision);
+  TEST_RUN(test_path_records);
+  TEST_RUN(test_many_textures);
+
+  TEST_REPORT();
+  TEST_EXIT();
+}
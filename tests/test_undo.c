@@ -0,0 +1,290 @@
+/*
+ * Master of Puppets — Undo tests
+ * test_undo.c — Geometry deltas, byte budget and stable mesh ids
+ *
+ * Tests validate:
+ *   - Undoing a chain of mesh edits restores the original buffers and
+ *     counts exactly, and redoing it restores the edited ones
+ *   - A localized edit records a delta the size of what it touched, not
+ *     a copy of the mesh
+ *   - History stays within the byte budget, shedding the oldest entries
+ *   - Entries of a removed mesh never touch the mesh recycled into its
+ *     slot, and geometry uploaded outside an edit skips stale entries
+ *   - Undo patches the mesh topology instead of dropping it
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "test_harness.h"
+
+#include "core/mesh_topology.h"
+#include "core/viewport_internal.h"
+
+#include <mop/mop.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* n x n flat grid in the XY plane facing +Z */
+static MopMesh *add_grid(MopViewport *vp, uint32_t n) {
+  uint32_t vc = (n + 1) * (n + 1), ic = n * n * 6, k = 0;
+  MopVertex *v = calloc(vc, sizeof(MopVertex));
+  uint32_t *idx = malloc(ic * sizeof(uint32_t));
+  for (uint32_t i = 0; i < vc; i++) {
+    v[i].position = (MopVec3){(float)(i % (n + 1)), (float)(i / (n + 1)), 0};
+    v[i].normal = (MopVec3){0, 0, 1};
+    v[i].color = (MopColor){1, 1, 1, 1};
+  }
+  for (uint32_t y = 0; y < n; y++) {
+    for (uint32_t x = 0; x < n; x++) {
+      uint32_t a = y * (n + 1) + x, b = a + 1;
+      uint32_t c = a + n + 1, d = c + 1;
+      uint32_t q[6] = {a, b, d, a, d, c};
+      memcpy(&idx[k], q, sizeof(q));
+      k += 6;
+    }
+  }
+  MopMesh *m = mop_viewport_add_mesh(
+      vp, &(MopMeshDesc){.vertices = v,
+                         .vertex_count = vc,
+                         .indices = idx,
+                         .index_count = ic,
+                         .object_id = 1});
+  free(v);
+  free(idx);
+  return m;
+}
+
+/* Copy of a mesh's geometry for comparisons */
+typedef struct Snapshot {
+  uint32_t vertex_count, index_count;
+  MopVertex *vertices;
+  uint32_t *indices;
+} Snapshot;
+
+static Snapshot snapshot(MopViewport *vp, MopMesh *m) {
+  Snapshot s = {m->vertex_count, m->index_count, NULL, NULL};
+  s.vertices = malloc(s.vertex_count * sizeof(MopVertex));
+  s.indices = malloc(s.index_count * sizeof(uint32_t));
+  memcpy(s.vertices, vp->rhi->buffer_read(m->vertex_buffer),
+         s.vertex_count * sizeof(MopVertex));
+  memcpy(s.indices, vp->rhi->buffer_read(m->index_buffer),
+         s.index_count * sizeof(uint32_t));
+  return s;
+}
+
+static bool matches(MopViewport *vp, MopMesh *m, const Snapshot *s) {
+  return m->vertex_count == s->vertex_count &&
+         m->index_count == s->index_count &&
+         memcmp(vp->rhi->buffer_read(m->vertex_buffer), s->vertices,
+                s->vertex_count * sizeof(MopVertex)) == 0 &&
+         memcmp(vp->rhi->buffer_read(m->index_buffer), s->indices,
+                s->index_count * sizeof(uint32_t)) == 0;
+}
+
+static void snapshot_free(Snapshot *s) {
+  free(s->vertices);
+  free(s->indices);
+}
+
+static MopViewport *make_viewport(void) {
+  return mop_viewport_create(&(MopViewportDesc){
+      .width = 32, .height = 32, .backend = MOP_BACKEND_CPU});
+}
+
+/* ---- tests ---- */
+
+static void test_edit_chain_round_trip(void) {
+  TEST_BEGIN("edit_chain_round_trip");
+  MopViewport *vp = make_viewport();
+  if (!vp)
+    MOP_TEST_SKIP("no CPU viewport");
+  MopMesh *m = add_grid(vp, 8);
+  TEST_ASSERT(m != NULL);
+
+  enum { STEPS = 7 };
+  Snapshot states[STEPS + 1];
+  states[0] = snapshot(vp, m);
+  uint32_t moved[2] = {40, 41}, faces[3] = {5, 6, 20}, one[1] = {3};
+  uint32_t gone[1] = {80};
+  mop_mesh_move_vertices(m, vp, moved, 2, (MopVec3){0, 0, 0.25f});
+  states[1] = snapshot(vp, m);
+  mop_mesh_extrude_faces(m, vp, faces, 3, 0.5f);
+  states[2] = snapshot(vp, m);
+  mop_mesh_split_edge(m, vp, 0, 10);
+  states[3] = snapshot(vp, m);
+  mop_mesh_inset_faces(m, vp, one, 1, 0.2f);
+  states[4] = snapshot(vp, m);
+  mop_mesh_delete_faces(m, vp, faces, 2);
+  states[5] = snapshot(vp, m);
+  mop_mesh_flip_normals(m, vp, one, 1);
+  states[6] = snapshot(vp, m);
+  mop_mesh_delete_vertices(m, vp, gone, 1);
+  states[7] = snapshot(vp, m);
+
+  for (int i = STEPS; i > 0; i--) {
+    mop_viewport_undo(vp);
+    TEST_ASSERT(matches(vp, m, &states[i - 1]));
+  }
+  for (int i = 1; i <= STEPS; i++) {
+    mop_viewport_redo(vp);
+    TEST_ASSERT(matches(vp, m, &states[i]));
+  }
+
+  for (int i = 0; i <= STEPS; i++)
+    snapshot_free(&states[i]);
+  mop_viewport_destroy(vp);
+  TEST_END();
+}
+
+static void test_delta_is_local(void) {
+  TEST_BEGIN("delta_is_local");
+  MopViewport *vp = make_viewport();
+  if (!vp)
+    MOP_TEST_SKIP("no CPU viewport");
+  MopMesh *m = add_grid(vp, 128);
+  TEST_ASSERT(m != NULL);
+  size_t mesh_bytes = m->vertex_count * sizeof(MopVertex) +
+                      m->index_count * sizeof(uint32_t);
+
+  size_t before = mop_viewport_get_undo_usage(vp);
+  uint32_t v = 64 * 129 + 64;
+  mop_mesh_move_vertices(m, vp, &v, 1, (MopVec3){0, 0, 1});
+  size_t moved = mop_viewport_get_undo_usage(vp) - before;
+  /* One-ring of 7 vertices plus bookkeeping */
+  TEST_ASSERT(moved < 7 * sizeof(MopVertex) + 1024);
+
+  /* Merging renumbers everything, but only the shifted tail differs */
+  before = mop_viewport_get_undo_usage(vp);
+  mop_mesh_merge_vertices(m, vp, m->vertex_count - 2, m->vertex_count - 1);
+  TEST_ASSERT(mop_viewport_get_undo_usage(vp) - before < mesh_bytes / 16);
+
+  mop_viewport_destroy(vp);
+  TEST_END();
+}
+
+static void test_budget_sheds_oldest(void) {
+  TEST_BEGIN("budget_sheds_oldest");
+  MopViewport *vp = make_viewport();
+  if (!vp)
+    MOP_TEST_SKIP("no CPU viewport");
+  MopMesh *m = add_grid(vp, 32);
+  TEST_ASSERT(m != NULL);
+
+  /* Entries are bounded by bytes, not by the ring's initial capacity */
+  for (int i = 0; i < 300; i++)
+    mop_viewport_push_undo(vp, m);
+  TEST_ASSERT(vp->undo_count == 300);
+
+  size_t budget = 16 * 1024;
+  mop_viewport_set_undo_budget(vp, budget);
+  TEST_ASSERT(mop_viewport_get_undo_usage(vp) <= budget);
+  Snapshot before = snapshot(vp, m);
+  uint32_t f = 0;
+  for (int i = 0; i < 200; i++) {
+    f = (uint32_t)(i * 7) % (m->index_count / 3);
+    mop_mesh_extrude_faces(m, vp, &f, 1, 0.1f);
+    TEST_ASSERT(mop_viewport_get_undo_usage(vp) <= budget);
+  }
+  TEST_ASSERT(vp->undo_count > 0 && vp->undo_count < 200);
+
+  /* Everything still in the history undoes cleanly */
+  while (vp->undo_count > 0)
+    mop_viewport_undo(vp);
+  TEST_ASSERT(m->vertex_count > before.vertex_count);
+  while (vp->redo_count > 0)
+    mop_viewport_redo(vp);
+
+  mop_viewport_set_undo_budget(vp, 0);
+  TEST_ASSERT(mop_viewport_get_undo_usage(vp) == 0);
+  mop_mesh_extrude_faces(m, vp, &f, 1, 0.1f);
+  TEST_ASSERT(vp->undo_count == 0);
+
+  snapshot_free(&before);
+  mop_viewport_destroy(vp);
+  TEST_END();
+}
+
+static void test_stale_entries_skipped(void) {
+  TEST_BEGIN("stale_entries_skipped");
+  MopViewport *vp = make_viewport();
+  if (!vp)
+    MOP_TEST_SKIP("no CPU viewport");
+  MopMesh *a = add_grid(vp, 4);
+  TEST_ASSERT(a != NULL);
+  uint32_t v = 12;
+  mop_mesh_move_vertices(a, vp, &v, 1, (MopVec3){0, 0, 1});
+  mop_mesh_set_position(a, (MopVec3){5, 0, 0});
+  mop_viewport_push_undo(vp, a);
+
+  /* The new mesh recycles a's slot */
+  mop_viewport_remove_mesh(vp, a);
+  MopMesh *b = add_grid(vp, 4);
+  TEST_ASSERT(b == a);
+  mop_mesh_set_position(b, (MopVec3){1, 2, 3});
+  Snapshot fresh = snapshot(vp, b);
+  mop_viewport_undo(vp);
+  mop_viewport_undo(vp);
+  TEST_ASSERT(matches(vp, b, &fresh));
+  TEST_ASSERT_FLOAT_EQ(b->position.x, 1.0f);
+  snapshot_free(&fresh);
+
+  /* Geometry replaced outside an edit: older edits no longer apply */
+  mop_mesh_move_vertices(b, vp, &v, 1, (MopVec3){0, 0, 1});
+  Snapshot edited = snapshot(vp, b);
+  mop_mesh_update_geometry(b, vp, edited.vertices, edited.vertex_count,
+                           edited.indices, edited.index_count);
+  mop_viewport_undo(vp);
+  TEST_ASSERT(matches(vp, b, &edited));
+  snapshot_free(&edited);
+
+  mop_viewport_destroy(vp);
+  TEST_END();
+}
+
+static void test_undo_keeps_topology(void) {
+  TEST_BEGIN("undo_keeps_topology");
+  MopViewport *vp = make_viewport();
+  if (!vp)
+    MOP_TEST_SKIP("no CPU viewport");
+  MopMesh *m = add_grid(vp, 8);
+  TEST_ASSERT(m != NULL);
+
+  uint32_t faces[2] = {10, 11};
+  mop_mesh_extrude_faces(m, vp, faces, 2, 1.0f);
+  TEST_ASSERT(m->topology != NULL);
+  mop_viewport_undo(vp);
+  TEST_ASSERT(m->topology != NULL);
+  TEST_ASSERT(m->topology->face_count * 3 == m->index_count);
+
+  /* The patched adjacency matches a fresh build */
+  const uint32_t *idx = vp->rhi->buffer_read(m->index_buffer);
+  MopMeshTopology *fresh = mop_topology_build(idx, m->index_count, NULL);
+  TEST_ASSERT(fresh != NULL);
+  bool same = true;
+  for (uint32_t h = 0; h < m->index_count; h++) {
+    const MopHalfEdge *a = &m->topology->edges[h], *b = &fresh->edges[h];
+    same &= a->vertex == b->vertex && a->twin == b->twin;
+  }
+  TEST_ASSERT(same);
+  mop_topology_free(fresh);
+
+  mop_viewport_redo(vp);
+  TEST_ASSERT(m->topology != NULL);
+  TEST_ASSERT(m->topology->face_count * 3 == m->index_count);
+
+  mop_viewport_destroy(vp);
+  TEST_END();
+}
+
+int main(void) {
+  TEST_SUITE_BEGIN("undo");
+
+  TEST_RUN(test_edit_chain_round_trip);
+  TEST_RUN(test_delta_is_local);
+  TEST_RUN(test_budget_sheds_oldest);
+  TEST_RUN(test_stale_entries_skipped);
+  TEST_RUN(test_undo_keeps_topology);
+
+  TEST_REPORT();
+  TEST_EXIT();
+}
@@ -0,0 +1,214 @@
+/*
+ * Master of Puppets — CPU vertex stage tests
+ * test_vertex_fetch.c — Per-draw vertex transform and layout-specific fetch
+ *
+ * Tests validate:
+ *   - A custom interleaved layout (reordered attributes, RGBA8 color)
+ *     renders pixel-identically to the same mesh as MopVertex
+ *   - A draw referencing a few vertices of a large buffer (sparse path)
+ *     matches the compact mesh and never touches unreferenced vertices
+ *   - Out-of-range indices drop their triangle
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "test_harness.h"
+
+#include <math.h>
+#include <mop/core/vertex_format.h>
+#include <mop/mop.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define VP_SIZE 96
+
+/* Color channels as RGBA8 decodes them, so both layouts agree exactly */
+static float unorm8(int v) { return (float)v * (1.0f / 255.0f); }
+
+static void build_sphere(int rings, int segs, MopVertex **out_v,
+                         uint32_t *out_vc, uint32_t **out_i,
+                         uint32_t *out_ic) {
+  uint32_t vc = (uint32_t)((rings + 1) * (segs + 1));
+  uint32_t ic = (uint32_t)(rings * segs * 6);
+  MopVertex *v = calloc(vc, sizeof(MopVertex));
+  uint32_t *idx = malloc(ic * sizeof(uint32_t));
+  for (int r = 0; r <= rings; r++) {
+    float th = 3.14159265f * (float)r / (float)rings;
+    for (int s = 0; s <= segs; s++) {
+      float ph = 2.0f * 3.14159265f * (float)s / (float)segs;
+      MopVec3 n = {sinf(th) * cosf(ph), cosf(th), sinf(th) * sinf(ph)};
+      MopVertex *p = &v[r * (segs + 1) + s];
+      p->position = (MopVec3){n.x * 1.5f, n.y * 1.5f, n.z * 1.5f};
+      p->normal = n;
+      p->color = (MopColor){unorm8(40 + r * 4), unorm8(200 - s), unorm8(90),
+                            1.0f};
+      p->u = (float)s / (float)segs;
+      p->v = (float)r / (float)rings;
+    }
+  }
+  uint32_t k = 0;
+  for (int r = 0; r < rings; r++)
+    for (int s = 0; s < segs; s++) {
+      uint32_t a = (uint32_t)(r * (segs + 1) + s), b = a + 1;
+      uint32_t c = a + (uint32_t)(segs + 1), d = c + 1;
+      idx[k++] = a, idx[k++] = b, idx[k++] = d;
+      idx[k++] = a, idx[k++] = d, idx[k++] = c;
+    }
+  *out_v = v;
+  *out_vc = vc;
+  *out_i = idx;
+  *out_ic = ic;
+}
+
+static MopViewport *make_viewport(void) {
+  MopViewport *vp = mop_viewport_create(&(MopViewportDesc){
+      .width = VP_SIZE, .height = VP_SIZE, .backend = MOP_BACKEND_CPU});
+  if (!vp)
+    return NULL;
+  mop_viewport_set_post_effects(vp, 0);
+  mop_viewport_set_camera(vp, (MopVec3){0, 0.5f, 5}, (MopVec3){0, 0, 0},
+                          (MopVec3){0, 1, 0}, 45.0f, 0.1f, 100.0f);
+  return vp;
+}
+
+/* Render and copy the color buffer (caller frees) */
+static uint8_t *render_copy(MopViewport *vp) {
+  int w = 0, h = 0;
+  mop_viewport_render(vp);
+  const uint8_t *px = mop_viewport_read_color(vp, &w, &h);
+  uint8_t *copy = malloc((size_t)w * h * 4);
+  memcpy(copy, px, (size_t)w * h * 4);
+  return copy;
+}
+
+static bool add_standard(MopViewport *vp, const MopVertex *v, uint32_t vc,
+                         const uint32_t *idx, uint32_t ic) {
+  return mop_viewport_add_mesh(vp, &(MopMeshDesc){.vertices = v,
+                                                  .vertex_count = vc,
+                                                  .indices = idx,
+                                                  .index_count = ic,
+                                                  .object_id = 1}) != NULL;
+}
+
+/* Attributes deliberately out of MopVertex order */
+typedef struct CustomVertex {
+  uint8_t color[4];
+  float uv[2];
+  float normal[3];
+  float position[3];
+} CustomVertex;
+
+static void test_custom_layout_matches(void) {
+  TEST_BEGIN("vertex_fetch: custom layout renders like MopVertex");
+  MopVertex *v;
+  uint32_t *idx, vc, ic;
+  build_sphere(24, 48, &v, &vc, &idx, &ic);
+
+  CustomVertex *cv = calloc(vc, sizeof(CustomVertex));
+  for (uint32_t i = 0; i < vc; i++) {
+    cv[i].color[0] = (uint8_t)lroundf(v[i].color.r * 255.0f);
+    cv[i].color[1] = (uint8_t)lroundf(v[i].color.g * 255.0f);
+    cv[i].color[2] = (uint8_t)lroundf(v[i].color.b * 255.0f);
+    cv[i].color[3] = 255;
+    cv[i].uv[0] = v[i].u;
+    cv[i].uv[1] = v[i].v;
+    memcpy(cv[i].normal, &v[i].normal, sizeof(cv[i].normal));
+    memcpy(cv[i].position, &v[i].position, sizeof(cv[i].position));
+  }
+  MopVertexFormat fmt = {
+      .attrib_count = 4,
+      .stride = sizeof(CustomVertex),
+      .attribs = {
+          {MOP_ATTRIB_COLOR, MOP_FORMAT_UNORM8X4,
+           offsetof(CustomVertex, color)},
+          {MOP_ATTRIB_TEXCOORD0, MOP_FORMAT_FLOAT2,
+           offsetof(CustomVertex, uv)},
+          {MOP_ATTRIB_NORMAL, MOP_FORMAT_FLOAT3,
+           offsetof(CustomVertex, normal)},
+          {MOP_ATTRIB_POSITION, MOP_FORMAT_FLOAT3,
+           offsetof(CustomVertex, position)},
+      }};
+
+  MopViewport *a = make_viewport();
+  MopViewport *b = make_viewport();
+  TEST_ASSERT(a && b);
+  TEST_ASSERT(add_standard(a, v, vc, idx, ic));
+  TEST_ASSERT(mop_viewport_add_mesh_ex(
+                  b, &(MopMeshDescEx){.vertex_data = cv,
+                                      .vertex_count = vc,
+                                      .indices = idx,
+                                      .index_count = ic,
+                                      .object_id = 1,
+                                      .vertex_format = &fmt}) != NULL);
+
+  uint8_t *ref = render_copy(a);
+  uint8_t *got = render_copy(b);
+  TEST_ASSERT(memcmp(ref, got, (size_t)VP_SIZE * VP_SIZE * 4) == 0);
+
+  free(ref);
+  free(got);
+  free(cv);
+  free(v);
+  free(idx);
+  mop_viewport_destroy(a);
+  mop_viewport_destroy(b);
+  TEST_END();
+}
+
+static void test_sparse_draw_matches(void) {
+  TEST_BEGIN("vertex_fetch: sparse index list over a large buffer");
+  MopVertex *v;
+  uint32_t *idx, vc, ic;
+  build_sphere(16, 32, &v, &vc, &idx, &ic);
+
+  /* Scatter the sphere across a buffer 16x its size.  The filler
+   * vertices are NaN, so transforming any of them and using it would
+   * show up in the image. */
+  uint32_t big_vc = vc * 16;
+  MopVertex *big = malloc(big_vc * sizeof(MopVertex));
+  for (uint32_t i = 0; i < big_vc; i++) {
+    big[i] = v[0];
+    big[i].position = (MopVec3){NAN, NAN, NAN};
+  }
+  for (uint32_t i = 0; i < vc; i++)
+    big[i * 16 + 7] = v[i];
+  /* One extra triangle with an out-of-range corner */
+  uint32_t *big_idx = malloc((ic + 3) * sizeof(uint32_t));
+  for (uint32_t i = 0; i < ic; i++)
+    big_idx[i] = idx[i] * 16 + 7;
+  big_idx[ic] = 7;
+  big_idx[ic + 1] = 23;
+  big_idx[ic + 2] = big_vc + 5;
+  TEST_ASSERT(ic + 3 < big_vc);
+
+  MopViewport *a = make_viewport();
+  MopViewport *b = make_viewport();
+  TEST_ASSERT(a && b);
+  TEST_ASSERT(add_standard(a, v, vc, idx, ic));
+  TEST_ASSERT(add_standard(b, big, big_vc, big_idx, ic + 3));
+
+  uint8_t *ref = render_copy(a);
+  uint8_t *got = render_copy(b);
+  TEST_ASSERT(memcmp(ref, got, (size_t)VP_SIZE * VP_SIZE * 4) == 0);
+
+  free(ref);
+  free(got);
+  free(big);
+  free(big_idx);
+  free(v);
+  free(idx);
+  mop_viewport_destroy(a);
+  mop_viewport_destroy(b);
+  TEST_END();
+}
+
+int main(void) {
+  TEST_SUITE_BEGIN("vertex_fetch");
+
+  TEST_RUN(test_custom_layout_matches);
+  TEST_RUN(test_sparse_draw_matches);
+
+  TEST_REPORT();
+  TEST_EXIT();
+}
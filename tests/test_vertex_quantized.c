@@ -0,0 +1,259 @@
+/*
+ * Master of Puppets — Quantized vertex format tests
+ * test_vertex_quantized.c — Compact attribute decoding and native rendering
+ *
+ * Tests validate:
+ *   - Decoding of unorm16 (with position dequantization), octahedral,
+ *     half-float and RGBA8 attributes
+ *   - A mesh uploaded with 18-byte quantized vertices renders like its
+ *     float MopVertex original on the CPU backend
+ *   - mop_scene_add_mesh keeps .mop quantized meshes quantized
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "test_harness.h"
+
+#include <math.h>
+#include <mop/core/vertex_format.h>
+#include <mop/loader/mop_scene.h>
+#include <mop/mop.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define VP_SIZE 96
+
+/* Same encodings as .mop files (loader/mop_scene.c) */
+static void oct_encode(MopVec3 n, int16_t out[2]) {
+  float sum = fabsf(n.x) + fabsf(n.y) + fabsf(n.z);
+  float ox = n.x / sum, oy = n.y / sum;
+  if (n.z < 0.0f) {
+    float tx = (1.0f - fabsf(oy)) * (ox >= 0.0f ? 1.0f : -1.0f);
+    float ty = (1.0f - fabsf(ox)) * (oy >= 0.0f ? 1.0f : -1.0f);
+    ox = tx;
+    oy = ty;
+  }
+  out[0] = (int16_t)(ox * 32767.0f);
+  out[1] = (int16_t)(oy * 32767.0f);
+}
+
+static void build_sphere(int rings, int segs, MopVertex **out_v,
+                         uint32_t *out_vc, uint32_t **out_i,
+                         uint32_t *out_ic) {
+  uint32_t vc = (uint32_t)((rings + 1) * (segs + 1));
+  uint32_t ic = (uint32_t)(rings * segs * 6);
+  MopVertex *v = calloc(vc, sizeof(MopVertex));
+  uint32_t *idx = malloc(ic * sizeof(uint32_t));
+  for (int r = 0; r <= rings; r++) {
+    float th = 3.14159265f * (float)r / (float)rings;
+    for (int s = 0; s <= segs; s++) {
+      float ph = 2.0f * 3.14159265f * (float)s / (float)segs;
+      MopVec3 n = {sinf(th) * cosf(ph), cosf(th), sinf(th) * sinf(ph)};
+      MopVertex *p = &v[r * (segs + 1) + s];
+      p->position = (MopVec3){n.x * 1.5f, n.y * 1.5f + 0.25f, n.z * 1.5f};
+      p->normal = n;
+      p->color = (MopColor){0.9f, 0.4f, 0.2f, 1.0f};
+      p->u = (float)s / (float)segs;
+      p->v = (float)r / (float)rings;
+    }
+  }
+  uint32_t k = 0;
+  for (int r = 0; r < rings; r++)
+    for (int s = 0; s < segs; s++) {
+      uint32_t a = (uint32_t)(r * (segs + 1) + s), b = a + 1;
+      uint32_t c = a + (uint32_t)(segs + 1), d = c + 1;
+      idx[k++] = a, idx[k++] = b, idx[k++] = d;
+      idx[k++] = a, idx[k++] = d, idx[k++] = c;
+    }
+  *out_v = v;
+  *out_vc = vc;
+  *out_i = idx;
+  *out_ic = ic;
+}
+
+static MopViewport *make_viewport(void) {
+  MopViewport *vp = mop_viewport_create(&(MopViewportDesc){
+      .width = VP_SIZE, .height = VP_SIZE, .backend = MOP_BACKEND_CPU});
+  if (!vp)
+    return NULL;
+  mop_viewport_set_post_effects(vp, 0);
+  mop_viewport_set_camera(vp, (MopVec3){0, 0.5f, 5}, (MopVec3){0, 0, 0},
+                          (MopVec3){0, 1, 0}, 45.0f, 0.1f, 100.0f);
+  return vp;
+}
+
+/* Render and copy the color buffer (caller frees) */
+static uint8_t *render_copy(MopViewport *vp) {
+  int w = 0, h = 0;
+  mop_viewport_render(vp);
+  const uint8_t *px = mop_viewport_read_color(vp, &w, &h);
+  uint8_t *copy = malloc((size_t)w * h * 4);
+  memcpy(copy, px, (size_t)w * h * 4);
+  return copy;
+}
+
+/* Fraction of pixels whose color differs by more than tol in a channel */
+static float diff_fraction(const uint8_t *a, const uint8_t *b, int tol) {
+  int n = VP_SIZE * VP_SIZE, bad = 0;
+  for (int i = 0; i < n; i++)
+    for (int c = 0; c < 3; c++)
+      if (abs((int)a[i * 4 + c] - (int)b[i * 4 + c]) > tol) {
+        bad++;
+        break;
+      }
+  return (float)bad / (float)n;
+}
+
+static void test_decode(void) {
+  TEST_BEGIN("quantized: attribute decoding");
+  MopVertexFormat fmt = mop_vertex_format_quantized((MopVec3){-2, 0, 10},
+                                                    (MopVec3){2, 1, 14});
+  TEST_ASSERT(fmt.stride == sizeof(MopQuantizedVertex));
+  TEST_ASSERT(mop_attrib_format_size(MOP_FORMAT_UNORM16X3) == 6);
+  TEST_ASSERT(mop_attrib_format_size(MOP_FORMAT_OCT16) == 4);
+
+  MopQuantizedVertex q = {.pos = {0, 65535, 32768},
+                          .color = {255, 0, 51, 255},
+                          .uv = {0, 65535}};
+  oct_encode((MopVec3){0, 0, -1}, q.nrm);
+  float out[4];
+  mop_vertex_attrib_read(&fmt, &fmt.attribs[0], &q, out);
+  TEST_ASSERT(fabsf(out[0] + 2.0f) < 1e-6f);
+  TEST_ASSERT(fabsf(out[1] - 1.0f) < 1e-6f);
+  TEST_ASSERT(fabsf(out[2] - 12.0f) < 1e-3f);
+  mop_vertex_attrib_read(&fmt, &fmt.attribs[1], &q, out);
+  TEST_ASSERT(fabsf(out[2] + 1.0f) < 1e-4f && fabsf(out[0]) < 1e-4f);
+  mop_vertex_attrib_read(&fmt, &fmt.attribs[2], &q, out);
+  TEST_ASSERT(out[0] == 1.0f && out[1] == 0.0f);
+  TEST_ASSERT(fabsf(out[2] - 0.2f) < 1e-6f);
+  mop_vertex_attrib_read(&fmt, &fmt.attribs[3], &q, out);
+  TEST_ASSERT(out[0] == 0.0f && out[1] == 1.0f && out[3] == 1.0f);
+
+  /* 1.0, -2.0, 0.5, smallest subnormal */
+  uint16_t h[4] = {0x3C00, 0xC000, 0x3800, 0x0001};
+  MopVertexAttrib ha = {MOP_ATTRIB_TEXCOORD0, MOP_FORMAT_HALF2, 0};
+  mop_vertex_attrib_read(NULL, &ha, h, out);
+  TEST_ASSERT(out[0] == 1.0f && out[1] == -2.0f);
+  mop_vertex_attrib_read(NULL, &ha, h + 2, out);
+  TEST_ASSERT(out[0] == 0.5f && out[1] == ldexpf(1.0f, -24));
+  TEST_END();
+}
+
+static void test_render_matches_float(void) {
+  TEST_BEGIN("quantized: 18-byte vertices render like MopVertex");
+  MopVertex *v;
+  uint32_t *idx, vc, ic;
+  build_sphere(24, 48, &v, &vc, &idx, &ic);
+
+  MopVec3 lo = {-1.5f, -1.25f, -1.5f}, hi = {1.5f, 1.75f, 1.5f};
+  MopQuantizedVertex *q = calloc(vc, sizeof(MopQuantizedVertex));
+  for (uint32_t i = 0; i < vc; i++) {
+    const float *p = &v[i].position.x;
+    const float *l = &lo.x, *u = &hi.x;
+    for (int k = 0; k < 3; k++)
+      q[i].pos[k] =
+          (uint16_t)((p[k] - l[k]) / (u[k] - l[k]) * 65535.0f + 0.5f);
+    oct_encode(v[i].normal, q[i].nrm);
+    q[i].color[0] = (uint8_t)(v[i].color.r * 255.0f + 0.5f);
+    q[i].color[1] = (uint8_t)(v[i].color.g * 255.0f + 0.5f);
+    q[i].color[2] = (uint8_t)(v[i].color.b * 255.0f + 0.5f);
+    q[i].color[3] = 255;
+    q[i].uv[0] = (uint16_t)(v[i].u * 65535.0f + 0.5f);
+    q[i].uv[1] = (uint16_t)(v[i].v * 65535.0f + 0.5f);
+  }
+
+  MopViewport *a = make_viewport();
+  MopViewport *b = make_viewport();
+  TEST_ASSERT(a && b);
+  TEST_ASSERT(mop_viewport_add_mesh(a, &(MopMeshDesc){.vertices = v,
+                                                      .vertex_count = vc,
+                                                      .indices = idx,
+                                                      .index_count = ic,
+                                                      .object_id = 1}));
+  MopVertexFormat fmt = mop_vertex_format_quantized(lo, hi);
+  MopMesh *mq = mop_viewport_add_mesh_ex(
+      b, &(MopMeshDescEx){.vertex_data = q,
+                          .vertex_count = vc,
+                          .indices = idx,
+                          .index_count = ic,
+                          .object_id = 1,
+                          .vertex_format = &fmt});
+  TEST_ASSERT(mq != NULL);
+
+  /* Quantized bounds match the float mesh to the quantization step */
+  MopAABB box = mop_mesh_get_aabb_local(mq, b);
+  TEST_ASSERT(fabsf(box.min.y + 1.25f) < 1e-3f);
+  TEST_ASSERT(fabsf(box.max.y - 1.75f) < 1e-3f);
+
+  uint8_t *ref = render_copy(a);
+  uint8_t *got = render_copy(b);
+  /* Quantization error stays far below one pixel and one color level;
+   * the shadow pass must decode positions too, not read MopVertex */
+  TEST_ASSERT(diff_fraction(ref, got, 2) < 0.002f);
+
+  free(ref);
+  free(got);
+  free(q);
+  free(v);
+  free(idx);
+  mop_viewport_destroy(a);
+  mop_viewport_destroy(b);
+  TEST_END();
+}
+
+static void test_scene_file_stays_quantized(void) {
+  TEST_BEGIN("quantized: mop_scene_add_mesh uploads file vertices");
+  char path[] = "/tmp/mop_test_quant_XXXXXX";
+  int fd = mkstemp(path);
+  TEST_ASSERT(fd >= 0);
+  close(fd);
+
+  MopVertex *v;
+  uint32_t *idx, vc, ic;
+  build_sphere(24, 48, &v, &vc, &idx, &ic);
+  MopViewport *a = make_viewport();
+  TEST_ASSERT(a != NULL);
+  TEST_ASSERT(mop_viewport_add_mesh(a, &(MopMeshDesc){.vertices = v,
+                                                      .vertex_count = vc,
+                                                      .indices = idx,
+                                                      .index_count = ic,
+                                                      .object_id = 1}));
+  TEST_ASSERT(mop_scene_save(a, path, MOP_SAVE_QUANTIZE) == 0);
+
+  MopSceneFile *sf = mop_scene_load(path);
+  TEST_ASSERT(sf != NULL && mop_scene_mesh_count(sf) == 1);
+  MopViewport *b = make_viewport();
+  TEST_ASSERT(b != NULL);
+  MopMesh *m = mop_scene_add_mesh(sf, 0, b, 1);
+  TEST_ASSERT(m != NULL);
+  const MopVertexFormat *fmt = mop_mesh_get_vertex_format(m);
+  TEST_ASSERT(fmt && fmt->stride == sizeof(MopQuantizedVertex));
+  TEST_ASSERT(mop_scene_add_mesh(sf, 1, b, 2) == NULL);
+
+  uint8_t *ref = render_copy(a);
+  uint8_t *got = render_copy(b);
+  TEST_ASSERT(diff_fraction(ref, got, 2) < 0.002f);
+
+  free(ref);
+  free(got);
+  mop_scene_free(sf);
+  remove(path);
+  free(v);
+  free(idx);
+  mop_viewport_destroy(a);
+  mop_viewport_destroy(b);
+  TEST_END();
+}
+
+int main(void) {
+  TEST_SUITE_BEGIN("vertex_quantized");
+
+  TEST_RUN(test_decode);
+  TEST_RUN(test_render_matches_float);
+  TEST_RUN(test_scene_file_stays_quantized);
+
+  TEST_REPORT();
+  TEST_EXIT();
+}